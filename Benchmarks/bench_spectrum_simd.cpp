@@ -0,0 +1,206 @@
+﻿#include "benchmark.h"
+
+#include "shared/spectrum_types.h"
+
+#include <cstring>
+
+// JP: shared/host_simd.hでSIMD化したスペクトルの演算を、テンプレートの汎用実装と同じスカラーのループと比べる。
+//     要素ごとの演算と比較はビット単位で一致し、toXYZ()は総和の順序による丸め誤差の範囲で一致することを確認する。
+// EN: Compare spectrum operations vectorized with shared/host_simd.h against scalar loops identical to the generic template implementation.
+//     This checks that element-wise operations and comparisons match bitwise, and toXYZ() matches within rounding errors from the summation order.
+
+namespace {
+    using namespace VLR;
+
+    typedef SampledSpectrumTemplate<float, 4> SampledSpectrum4;
+    typedef DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrum16;
+
+    const uint32_t NumSpectra = 1024;
+    const uint32_t NumIterations = 1 << 20;
+
+    struct Random {
+        uint32_t state;
+
+        Random(uint32_t seed) : state(seed) {}
+        float operator()() {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / (1 << 24));
+        }
+    };
+
+    template <typename SpectrumType>
+    std::vector<SpectrumType> generateSpectra(uint32_t seed, float minValue, float maxValue) {
+        Random rng(seed);
+        std::vector<SpectrumType> spectra(NumSpectra);
+        for (SpectrumType &s : spectra) {
+            for (float &v : s.values)
+                v = minValue + (maxValue - minValue) * rng();
+        }
+        return spectra;
+    }
+
+    bool isBitwiseEqual(const float* a, const float* b, uint32_t n) {
+        return std::memcmp(a, b, sizeof(float) * n) == 0;
+    }
+
+
+
+    // JP: SpectrumStorageが蓄積に使う補償付きの総和。
+    // EN: Compensated sum that SpectrumStorage uses for accumulation.
+    void compensatedSumScalar(float result[16], float comp[16], const float value[16]) {
+        for (int i = 0; i < 16; ++i) {
+            float cInput = value[i] - comp[i];
+            float sumTemp = result[i] + cInput;
+            comp[i] = (sumTemp - result[i]) - cInput;
+            result[i] = sumTemp;
+        }
+    }
+
+    void toXYZScalar(const float values[16], float XYZ[3]) {
+        XYZ[0] = XYZ[1] = XYZ[2] = 0;
+        for (int i = 0; i < 16; ++i) {
+            XYZ[0] += DiscretizedSpectrum16::xbar[i] * values[i];
+            XYZ[1] += DiscretizedSpectrum16::ybar[i] * values[i];
+            XYZ[2] += DiscretizedSpectrum16::zbar[i] * values[i];
+        }
+        XYZ[0] /= DiscretizedSpectrum16::integralCMF;
+        XYZ[1] /= DiscretizedSpectrum16::integralCMF;
+        XYZ[2] /= DiscretizedSpectrum16::integralCMF;
+    }
+
+    float maxValueScalar(const float* values, uint32_t n) {
+        float maxVal = values[0];
+        for (uint32_t i = 1; i < n; ++i)
+            maxVal = std::fmax(values[i], maxVal);
+        return maxVal;
+    }
+
+    bool hasNaNScalar(const float* values, uint32_t n) {
+        for (uint32_t i = 0; i < n; ++i)
+            if (std::isnan(values[i]))
+                return true;
+        return false;
+    }
+
+    bool hasNonZeroScalar(const float* values, uint32_t n) {
+        for (uint32_t i = 0; i < n; ++i)
+            if (values[i] != 0)
+                return true;
+        return false;
+    }
+
+    bool isSameValue(float a, float b) {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+}
+
+
+
+VLR_BENCHMARK(DiscretizedSpectrum_CompensatedSum) {
+    std::vector<DiscretizedSpectrum16> values = generateSpectra<DiscretizedSpectrum16>(1, 0.0f, 10.0f);
+
+    CompensatedSum<DiscretizedSpectrum16> simdSum(DiscretizedSpectrum16::Zero());
+    double simdTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        simdSum += values[i % NumSpectra];
+    });
+
+    float scalarResult[16] = {}, scalarComp[16] = {};
+    double scalarTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        compensatedSumScalar(scalarResult, scalarComp, values[i % NumSpectra].values);
+    });
+    VLRBenchmark::doNotOptimize(scalarResult);
+
+    printf("  scalar: %.2f ns/op, SIMD: %.2f ns/op\n", scalarTime, simdTime);
+    VLRBenchmark::check(isBitwiseEqual(simdSum.result.values, scalarResult, 16) && isBitwiseEqual(simdSum.comp.values, scalarComp, 16),
+                        "sum and compensation match bitwise");
+}
+
+VLR_BENCHMARK(DiscretizedSpectrum_toXYZ) {
+    initializeColorSystem();
+    std::vector<DiscretizedSpectrum16> values = generateSpectra<DiscretizedSpectrum16>(2, 0.0f, 10.0f);
+
+    float XYZ[3];
+    double simdTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        values[i % NumSpectra].toXYZ(XYZ);
+        VLRBenchmark::doNotOptimize(XYZ);
+    });
+    double scalarTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        toXYZScalar(values[i % NumSpectra].values, XYZ);
+        VLRBenchmark::doNotOptimize(XYZ);
+    });
+
+    float maxRelError = 0.0f;
+    for (const DiscretizedSpectrum16 &value : values) {
+        float simdXYZ[3], scalarXYZ[3];
+        value.toXYZ(simdXYZ);
+        toXYZScalar(value.values, scalarXYZ);
+        for (int c = 0; c < 3; ++c)
+            maxRelError = std::max(maxRelError, std::fabs(simdXYZ[c] - scalarXYZ[c]) / std::fabs(scalarXYZ[c]));
+    }
+
+    printf("  scalar: %.2f ns/op, SIMD: %.2f ns/op\n", scalarTime, simdTime);
+    VLRBenchmark::check(maxRelError < 1e-5f, "max relative error %g", maxRelError);
+}
+
+VLR_BENCHMARK(DiscretizedSpectrum_Reductions) {
+    std::vector<DiscretizedSpectrum16> values = generateSpectra<DiscretizedSpectrum16>(3, -1.0f, 1.0f);
+    // JP: NaN、無限大、0を含む入力も混ぜる。
+    // EN: Also mix inputs including NaN, infinity and zero.
+    values[0] = DiscretizedSpectrum16::NaN();
+    values[1] = DiscretizedSpectrum16::Zero();
+    values[2][5] = VLR_NAN;
+    values[3][15] = VLR_INFINITY;
+    values[4][0] = -VLR_INFINITY;
+    values[5] = DiscretizedSpectrum16(-0.0f);
+
+    uint32_t count = 0;
+    double simdTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        const DiscretizedSpectrum16 &value = values[i % NumSpectra];
+        count += value.maxValue() > 0.5f;
+        count += value.hasNaN();
+        count += value.hasNonZero();
+    });
+    double scalarTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        const float* value = values[i % NumSpectra].values;
+        count += maxValueScalar(value, 16) > 0.5f;
+        count += hasNaNScalar(value, 16);
+        count += hasNonZeroScalar(value, 16);
+    });
+    VLRBenchmark::doNotOptimize(count);
+
+    uint32_t numMismatches = 0;
+    for (const DiscretizedSpectrum16 &value : values) {
+        if (!isSameValue(value.maxValue(), maxValueScalar(value.values, 16)) ||
+            value.hasNaN() != hasNaNScalar(value.values, 16) ||
+            value.hasNonZero() != hasNonZeroScalar(value.values, 16))
+            ++numMismatches;
+    }
+
+    printf("  scalar: %.2f ns/op, SIMD: %.2f ns/op (maxValue + hasNaN + hasNonZero)\n", scalarTime, simdTime);
+    VLRBenchmark::check(numMismatches == 0, "%u mismatches in %u spectra", numMismatches, NumSpectra);
+}
+
+VLR_BENCHMARK(SampledSpectrum_PathThroughputUpdate) {
+    std::vector<SampledSpectrum4> Les = generateSpectra<SampledSpectrum4>(4, 0.0f, 10.0f);
+    std::vector<SampledSpectrum4> fss = generateSpectra<SampledSpectrum4>(5, 0.0f, 1.0f);
+    SampledSpectrum4 alpha(0.75f);
+
+    // JP: 次のイベント推定で寄与を加える際の演算。
+    // EN: The operation adding a contribution in next event estimation.
+    SampledSpectrum4 simdContribution = SampledSpectrum4::Zero();
+    double simdTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        uint32_t idx = i % NumSpectra;
+        simdContribution += alpha * Les[idx] * fss[idx] * 0.125f;
+    });
+
+    float scalarContribution[4] = {};
+    double scalarTime = VLRBenchmark::measureNanoseconds(NumIterations, [&](uint32_t i) {
+        uint32_t idx = i % NumSpectra;
+        for (int j = 0; j < 4; ++j)
+            scalarContribution[j] += alpha.values[j] * Les[idx].values[j] * fss[idx].values[j] * 0.125f;
+    });
+    VLRBenchmark::doNotOptimize(scalarContribution);
+
+    printf("  scalar: %.2f ns/op, SIMD: %.2f ns/op\n", scalarTime, simdTime);
+    VLRBenchmark::check(isBitwiseEqual(simdContribution.values, scalarContribution, 4), "contribution matches bitwise");
+}
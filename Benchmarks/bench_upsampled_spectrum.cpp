@@ -0,0 +1,292 @@
+﻿#include "benchmark.h"
+
+#include "shared/spectrum_types.h"
+
+// JP: UpsampledSpectrumの隣接点の選択を、表を使う実装と従来の扇を辿る実装で比べる。
+//     表の候補の一覧が完全であること(点を含む三角形がすべて候補に入っていること)と、評価したスペクトルの誤差を確認する。
+// EN: Compare selection of adjacent points of UpsampledSpectrum between the implementation using the tables and the former one walking the fan.
+//     This checks that the candidate lists of the tables are complete (all triangles containing a point are candidates) and the error of evaluated spectra.
+
+namespace {
+    using namespace VLR;
+
+    typedef UpsampledSpectrumTemplate<float, NumSpectralSamples> UpsampledSpectrumN;
+    typedef WavelengthSamplesTemplate<float, NumSpectralSamples> WavelengthSamplesN;
+    typedef SampledSpectrumTemplate<float, NumSpectralSamples> SampledSpectrumN;
+
+    const uint32_t NumRandomPoints = 1 << 22;
+
+    struct Random {
+        uint32_t state;
+
+        Random(uint32_t seed) : state(seed) {}
+        float operator()() {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / (1 << 24));
+        }
+    };
+
+    struct AdjacentPoints {
+        uint8_t indices[3];
+        float b0, b1;
+    };
+
+    const UpsampledSpectrumN::spectrum_grid_cell_t &getCell(float u, float v) {
+        uint32_t ui = std::min<uint32_t>(u, UpsampledSpectrumN::GridWidth() - 1);
+        uint32_t vi = std::min<uint32_t>(v, UpsampledSpectrumN::GridHeight() - 1);
+        return UpsampledSpectrumN::spectrum_grid[ui + UpsampledSpectrumN::GridWidth() * vi];
+    }
+
+    // JP: 表を導入する前のcomputeAdjacents()の三角形の扇を辿る部分。RealTypeをdoubleにしたものを精度の基準に使う。
+    // EN: The part of computeAdjacents() before introducing the tables which walks the triangle fan. The one with double RealType is used as the accuracy reference.
+    template <typename RealType>
+    bool walkFan(float u, float v, AdjacentPoints* adj) {
+        const UpsampledSpectrumN::spectrum_grid_cell_t &cell = getCell(u, v);
+        const uint8_t* indices = cell.idx;
+        const uint8_t numPoints = cell.num_points;
+        const UpsampledSpectrumN::spectrum_data_point_t* points = UpsampledSpectrumN::spectrum_data_points;
+
+        const RealType ex = (RealType)u - points[indices[0]].uv[0];
+        const RealType ey = (RealType)v - points[indices[0]].uv[1];
+        RealType e0x = (RealType)points[indices[1]].uv[0] - points[indices[0]].uv[0];
+        RealType e0y = (RealType)points[indices[1]].uv[1] - points[indices[0]].uv[1];
+        RealType uu = e0x * ey - ex * e0y;
+        for (int i = 1; i < numPoints; ++i) {
+            uint32_t idx = indices[i % (numPoints - 1) + 1];
+            RealType e1x = (RealType)points[idx].uv[0] - points[indices[0]].uv[0];
+            RealType e1y = (RealType)points[idx].uv[1] - points[indices[0]].uv[1];
+            RealType vv = ex * e1y - e1x * ey;
+
+            const RealType area = e0x * e1y - e1x * e0y;
+            const RealType b0 = uu / area;
+            const RealType b1 = vv / area;
+            RealType b2 = 1 - b0 - b1;
+            if (b0 < -1e-6 || b1 < -1e-6 || b2 < -1e-6) {
+                uu = -vv;
+                e0x = e1x;
+                e0y = e1y;
+                continue;
+            }
+
+            adj->indices[0] = idx;
+            adj->indices[1] = indices[i];
+            adj->indices[2] = indices[0];
+            adj->b0 = (float)b0;
+            adj->b1 = (float)b1;
+            return true;
+        }
+        return false;
+    }
+
+    // JP: UpsampledSpectrum::evaluate()と同じ補間を行う。quantizeが真の場合は重心座標をUpsampledSpectrumと同様に16ビットに量子化する。
+    // EN: Perform the same interpolation as UpsampledSpectrum::evaluate(). Barycentric coordinates are quantized into 16 bits as UpsampledSpectrum if quantize is true.
+    SampledSpectrumN evaluateAdjacents(const AdjacentPoints &adj, bool quantize, const WavelengthSamplesN &wls) {
+        float b0 = adj.b0;
+        float b1 = adj.b1;
+        if (quantize) {
+            b0 = (float)(uint16_t)std::fmax(b0 * (UINT16_MAX - 1), 0.0f) / (UINT16_MAX - 1);
+            b1 = (float)(uint16_t)std::fmax(b1 * (UINT16_MAX - 1), 0.0f) / (UINT16_MAX - 1);
+        }
+        const float weights[3] = { b0, b1, 1.0f - b0 - b1 };
+        SampledSpectrumN ret(0.0f);
+        for (int i = 0; i < NumSpectralSamples; ++i) {
+            float p = (wls[i] - UpsampledSpectrumN::MinWavelength()) / (UpsampledSpectrumN::MaxWavelength() - UpsampledSpectrumN::MinWavelength());
+            p = clamp<float>(p, 0.0f, 1.0f);
+            float sBinF = p * (UpsampledSpectrumN::NumWavelengthSamples() - 1);
+            uint32_t sBin = std::min<uint32_t>(sBinF, UpsampledSpectrumN::NumWavelengthSamples() - 1);
+            uint32_t sBinNext = std::min<uint32_t>(sBin + 1, UpsampledSpectrumN::NumWavelengthSamples() - 1);
+            float t = sBinF - sBin;
+            for (int j = 0; j < 3; ++j) {
+                const float* spectrum = UpsampledSpectrumN::spectrum_data_points[adj.indices[j]].spectrum;
+                ret[i] += weights[j] * (spectrum[sBin] * (1 - t) + spectrum[sBinNext] * t);
+            }
+        }
+        return ret;
+    }
+
+    // JP: 内側の四角形ではないセルの中の一様な乱数の点と、三角形の辺と頂点の上の点を作る。
+    //     辺と頂点の上の点は候補の一覧を作る際の境界の扱いを確かめるためのもの。
+    // EN: Generate uniformly random points in cells that are not inner quads, and points on edges and vertices of triangles.
+    //     Points on edges and vertices are to check the boundary handling in building the candidate lists.
+    void generatePoints(std::vector<float>* us, std::vector<float>* vs, std::vector<float>* edgeUs, std::vector<float>* edgeVs) {
+        Random rng(12345);
+        while (us->size() < NumRandomPoints) {
+            float u = rng() * UpsampledSpectrumN::GridWidth();
+            float v = rng() * UpsampledSpectrumN::GridHeight();
+            const UpsampledSpectrumN::spectrum_grid_cell_t &cell = getCell(u, v);
+            if (cell.inside || cell.num_points < 3)
+                continue;
+            us->push_back(u);
+            vs->push_back(v);
+        }
+
+        for (uint32_t triIdx = 0; triIdx < UpsampledSpectrumN::numTriangles; ++triIdx) {
+            uint32_t adjIndices = UpsampledSpectrumN::spectrum_triangles[triIdx].adjIndices;
+            const float* ps[3] = {
+                UpsampledSpectrumN::spectrum_data_points[(adjIndices >> 16) & 0xFF].uv,
+                UpsampledSpectrumN::spectrum_data_points[(adjIndices >> 8) & 0xFF].uv,
+                UpsampledSpectrumN::spectrum_data_points[(adjIndices >> 0) & 0xFF].uv
+            };
+            for (int e = 0; e < 3; ++e) {
+                const float* pA = ps[e];
+                const float* pB = ps[(e + 1) % 3];
+                for (int i = 0; i <= 256; ++i) {
+                    float t = i < 256 ? rng() : 0.0f;
+                    edgeUs->push_back(pA[0] + (pB[0] - pA[0]) * t);
+                    edgeVs->push_back(pA[1] + (pB[1] - pA[1]) * t);
+                }
+            }
+        }
+    }
+
+    // JP: initialize()と同じ順序でセルを辿り、各セルの三角形の範囲を求める。
+    // EN: Traverse cells in the same order as initialize(), and find the range of triangles of each cell.
+    void computeCellTriangleRanges(std::vector<uint32_t>* firstTriIndices, std::vector<uint32_t>* numTris) {
+        const uint32_t numCells = UpsampledSpectrumN::GridWidth() * UpsampledSpectrumN::GridHeight();
+        firstTriIndices->resize(numCells, 0);
+        numTris->resize(numCells, 0);
+        uint32_t triIdx = 0;
+        for (uint32_t cellIdx = 0; cellIdx < numCells; ++cellIdx) {
+            const UpsampledSpectrumN::spectrum_grid_cell_t &cell = UpsampledSpectrumN::spectrum_grid[cellIdx];
+            if (cell.inside || cell.num_points < 3)
+                continue;
+            (*firstTriIndices)[cellIdx] = triIdx;
+            (*numTris)[cellIdx] = cell.num_points - 1;
+            triIdx += cell.num_points - 1;
+        }
+    }
+
+    bool containsPoint(const UpsampledSpectrumN::spectrum_triangle_t &tri, float u, float v) {
+        const float ex = u - tri.origin[0];
+        const float ey = v - tri.origin[1];
+        const float b0 = tri.b0[0] * ex + tri.b0[1] * ey;
+        const float b1 = tri.b1[0] * ex + tri.b1[1] * ey;
+        const float b2 = 1.0f - b0 - b1;
+        return !(b0 < -1e-6 || b1 < -1e-6 || b2 < -1e-6);
+    }
+}
+
+
+
+VLR_BENCHMARK(UpsampledSpectrum_AdjacencyTableCompleteness) {
+    initializeColorSystem();
+
+    std::vector<float> us, vs, edgeUs, edgeVs;
+    generatePoints(&us, &vs, &edgeUs, &edgeVs);
+    us.insert(us.end(), edgeUs.begin(), edgeUs.end());
+    vs.insert(vs.end(), edgeVs.begin(), edgeVs.end());
+
+    std::vector<uint32_t> cellFirstTriIndices, cellNumTris;
+    computeCellTriangleRanges(&cellFirstTriIndices, &cellNumTris);
+
+    const uint32_t resolution = UpsampledSpectrumN::AdjacencyTableResolution();
+    const uint32_t tableWidth = UpsampledSpectrumN::GridWidth() * resolution;
+    const uint32_t tableHeight = UpsampledSpectrumN::GridHeight() * resolution;
+    uint32_t numPointsInCells = 0;
+    uint32_t numMissingCandidates = 0;
+    uint64_t numCandidates = 0;
+    for (uint32_t i = 0; i < us.size(); ++i) {
+        float u = clamp<float>(us[i], 0.0f, UpsampledSpectrumN::GridWidth());
+        float v = clamp<float>(vs[i], 0.0f, UpsampledSpectrumN::GridHeight());
+        uint32_t cellIdx = std::min<uint32_t>(u, UpsampledSpectrumN::GridWidth() - 1) +
+            UpsampledSpectrumN::GridWidth() * std::min<uint32_t>(v, UpsampledSpectrumN::GridHeight() - 1);
+        if (cellNumTris[cellIdx] == 0 || UpsampledSpectrumN::spectrum_grid[cellIdx].inside)
+            continue;
+        ++numPointsInCells;
+
+        // JP: computeAdjacents()と同じ添字の計算で候補の範囲を引く。
+        // EN: Look up the candidate range with the same index computation as computeAdjacents().
+        uint32_t su = std::min<uint32_t>(u * resolution, tableWidth - 1);
+        uint32_t sv = std::min<uint32_t>(v * resolution, tableHeight - 1);
+        uint16_t entry = UpsampledSpectrumN::adjacency_table[sv * tableWidth + su];
+        uint32_t firstCandidate = entry & 0xFF;
+        uint32_t endCandidate = firstCandidate + (entry >> 8);
+        numCandidates += entry >> 8;
+
+        for (uint32_t triIdx = cellFirstTriIndices[cellIdx]; triIdx < cellFirstTriIndices[cellIdx] + cellNumTris[cellIdx]; ++triIdx) {
+            const UpsampledSpectrumN::spectrum_triangle_t &tri = UpsampledSpectrumN::spectrum_triangles[triIdx];
+            if (!std::isfinite(tri.b0[0]) || !std::isfinite(tri.b1[0]))
+                continue;
+            if (containsPoint(tri, u, v) && (triIdx < firstCandidate || triIdx >= endCandidate)) {
+                ++numMissingCandidates;
+                break;
+            }
+        }
+    }
+
+    printf("  %u triangles, %u points (%zu on edges), %.2f candidates per lookup on average\n",
+           UpsampledSpectrumN::numTriangles, numPointsInCells, edgeUs.size(), (double)numCandidates / numPointsInCells);
+    VLRBenchmark::check(numMissingCandidates == 0, "%u points have a containing triangle missing from the candidates", numMissingCandidates);
+}
+
+VLR_BENCHMARK(UpsampledSpectrum_ComputeAdjacents) {
+    initializeColorSystem();
+
+    std::vector<float> us, vs, edgeUs, edgeVs;
+    generatePoints(&us, &vs, &edgeUs, &edgeVs);
+    const float scale = (float)UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR;
+
+    double fanTime = VLRBenchmark::measureNanoseconds(NumRandomPoints, [&](uint32_t i) {
+        AdjacentPoints adj;
+        bool found = walkFan<float>(us[i], vs[i], &adj);
+        VLRBenchmark::doNotOptimize(found);
+        VLRBenchmark::doNotOptimize(adj);
+    });
+    double tableTime = VLRBenchmark::measureNanoseconds(NumRandomPoints, [&](uint32_t i) {
+        UpsampledSpectrumN spectrum(us[i], vs[i], scale);
+        VLRBenchmark::doNotOptimize(spectrum);
+    });
+
+    // JP: 倍精度で扇を辿り、量子化しない重心座標で評価したものを基準に、表を使う実装と単精度で扇を辿る従来の実装の誤差を比べる。
+    //     細長い三角形(例えば頂点(1, 0)と(0.999998, 0)を持つもの)では単精度の重心座標自体が不正確で、最大誤差はどちらの実装でもそこで決まる。
+    //     そのため平均誤差が従来の実装と同等であることと、最大誤差が従来の実装と同程度であることを確認する。
+    // EN: Compare errors of the implementation using the tables and the former one walking the fan in single precision against
+    //     the reference walking the fan in double precision and evaluating with unquantized barycentric coordinates.
+    //     Barycentric coordinates in single precision are inaccurate by themselves for thin triangles (e.g. one with vertices (1, 0) and (0.999998, 0)),
+    //     and the max error of both implementations is determined there.
+    //     So this checks that the mean error is on par with the former implementation and the max error is comparable to it.
+    us.insert(us.end(), edgeUs.begin(), edgeUs.end());
+    vs.insert(vs.end(), edgeVs.begin(), edgeVs.end());
+    const uint32_t NumWavelengthSets = 24;
+    uint32_t numEvaluated = 0;
+    uint32_t numOutside = 0;
+    double sumTableError = 0.0, sumFanError = 0.0;
+    float maxTableError = 0.0f, maxFanError = 0.0f;
+    for (uint32_t i = 0; i < us.size(); ++i) {
+        AdjacentPoints refAdj, fanAdj;
+        if (!walkFan<double>(us[i], vs[i], &refAdj) || !walkFan<float>(us[i], vs[i], &fanAdj)) {
+            ++numOutside;
+            continue;
+        }
+
+        UpsampledSpectrumN spectrum(us[i], vs[i], scale);
+        for (uint32_t set = 0; set < NumWavelengthSets; ++set) {
+            float lambdas[NumSpectralSamples];
+            for (int j = 0; j < NumSpectralSamples; ++j)
+                lambdas[j] = UpsampledSpectrumN::MinWavelength() +
+                (UpsampledSpectrumN::MaxWavelength() - UpsampledSpectrumN::MinWavelength()) * (set * NumSpectralSamples + j + 0.5f) / (NumWavelengthSets * NumSpectralSamples);
+            WavelengthSamplesN wls(lambdas);
+            SampledSpectrumN refValue = evaluateAdjacents(refAdj, false, wls);
+            SampledSpectrumN tableValue = spectrum.evaluate(wls);
+            SampledSpectrumN fanValue = evaluateAdjacents(fanAdj, true, wls);
+            for (int j = 0; j < NumSpectralSamples; ++j) {
+                float denom = std::fmax(std::fabs(refValue[j]), 1e-3f);
+                float tableError = std::fabs(tableValue[j] - refValue[j]) / denom;
+                float fanError = std::fabs(fanValue[j] - refValue[j]) / denom;
+                maxTableError = std::fmax(maxTableError, tableError);
+                maxFanError = std::fmax(maxFanError, fanError);
+                sumTableError += tableError;
+                sumFanError += fanError;
+            }
+        }
+        ++numEvaluated;
+    }
+    const double numValues = (double)numEvaluated * NumWavelengthSets * NumSpectralSamples;
+
+    printf("  fan walk: %.2f ns/op, table: %.2f ns/op (construction from uvs, %u random points)\n", fanTime, tableTime, NumRandomPoints);
+    printf("  relative spectral error over %u points (%u outside the triangles skipped):\n", numEvaluated, numOutside);
+    printf("    fan walk: max %g, mean %g\n", maxFanError, sumFanError / numValues);
+    printf("    table   : max %g, mean %g\n", maxTableError, sumTableError / numValues);
+    VLRBenchmark::check(sumTableError <= sumFanError * 1.01, "mean error is within 1%% of the fan walk");
+    VLRBenchmark::check(maxTableError <= maxFanError * 2, "max error is within 2x of the fan walk");
+}
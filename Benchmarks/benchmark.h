@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+namespace VLRBenchmark {
+    typedef void (*BenchmarkFunction)();
+
+    struct Benchmark {
+        const char* name;
+        BenchmarkFunction function;
+    };
+
+    std::vector<Benchmark> &getBenchmarks();
+
+    struct BenchmarkRegistrar {
+        BenchmarkRegistrar(const char* name, BenchmarkFunction function) {
+            getBenchmarks().push_back(Benchmark{ name, function });
+        }
+    };
+
+    // JP: 計測結果が最適化で消されないように値を外部から観測可能にする。
+    // EN: Make a value externally observable so that measured code is not removed by optimization.
+    template <typename T>
+    inline void doNotOptimize(const T &value) {
+        static volatile const void* sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    // JP: funcを繰り返し呼ぶ計測を数回行い、最も速かった回の1回あたりのナノ秒を返す。
+    // EN: Measure calling func repeatedly several times, and return nanoseconds per call of the fastest run.
+    template <typename Func>
+    double measureNanoseconds(uint32_t numIterations, Func func) {
+        const uint32_t NumRuns = 5;
+        double bestTime = INFINITY;
+        for (uint32_t run = 0; run < NumRuns; ++run) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < numIterations; ++i)
+                func(i);
+            auto endTime = std::chrono::high_resolution_clock::now();
+            double time = std::chrono::duration<double, std::nano>(endTime - startTime).count() / numIterations;
+            bestTime = std::min(bestTime, time);
+        }
+        return bestTime;
+    }
+
+    // JP: 精度の確認の結果を出力し、失敗を記録する。失敗が1つでもあれば終了コードが0以外になる。
+    // EN: Print the result of an accuracy check, and record a failure. The exit code is nonzero if any check fails.
+    void check(bool passed, const char* format, ...);
+    bool allChecksPassed();
+}
+
+#define VLR_BENCHMARK(name) \
+    static void name(); \
+    static VLRBenchmark::BenchmarkRegistrar name ## _registrar(#name, &name); \
+    static void name()
@@ -0,0 +1,48 @@
+﻿#include "benchmark.h"
+
+#include <cstdarg>
+#include <cstring>
+
+// JP: libVLRの内部の演算のマイクロベンチマークと、最適化前の実装と結果が一致するかの確認。
+//     引数を与えると名前にその文字列を含むベンチマークだけを実行する。
+// EN: Micro benchmarks of internal operations of libVLR, and checks that results match those of the unoptimized implementation.
+//     Given an argument, only benchmarks whose names contain the string are run.
+
+namespace VLRBenchmark {
+    static bool s_allChecksPassed = true;
+
+    std::vector<Benchmark> &getBenchmarks() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    void check(bool passed, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        printf("  [%s] ", passed ? "OK" : "FAILED");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+
+        if (!passed)
+            s_allChecksPassed = false;
+    }
+
+    bool allChecksPassed() {
+        return s_allChecksPassed;
+    }
+}
+
+int32_t main(int32_t argc, const char* argv[]) {
+    using namespace VLRBenchmark;
+
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    for (const Benchmark &benchmark : getBenchmarks()) {
+        if (filter && std::strstr(benchmark.name, filter) == nullptr)
+            continue;
+        printf("%s\n", benchmark.name);
+        benchmark.function();
+    }
+
+    return allChecksPassed() ? 0 : 1;
+}
@@ -372,6 +372,14 @@ namespace GLTK {
             unbind();
         }
 
+        void subData(uint32_t startElement, uint32_t numElements, const void* data) {
+            bind();
+
+            glBufferSubData((GLenum)m_target, m_stride * startElement, m_stride * numElements, data); errorCheck();
+
+            unbind();
+        }
+
         void finalize() {
             if (m_handle) {
                 glDeleteBuffers(1, &m_handle); errorCheck();
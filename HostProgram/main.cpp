@@ -14,6 +14,16 @@
 // only for catching an exception.
 #include <optix_world.h>
 
+#include <ImfOutputFile.h>
+#include <ImfRgbaFile.h>
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
 #include "scene.h"
 
 #include "StopWatch.h"
@@ -113,13 +123,6 @@ static std::string readTxtFile(const std::string& filepath) {
 
 
 
-float sRGB_gamma_s(float value) {
-    VLRAssert(value >= 0, "Input value must be equal to or greater than 0: %g", value);
-    if (value <= 0.0031308f)
-        return 12.92f * value;
-    return 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
-};
-
 struct RGB {
     float r, g, b;
 
@@ -144,66 +147,178 @@ struct RGB {
     static constexpr RGB One() { return RGB(1.0f, 1.0f, 1.0f); }
 };
 
-RGB exp(const RGB &v) {
-    return RGB(std::exp(v.r), std::exp(v.g), std::exp(v.b));
-}
+static void saveOutputBufferAsImageFile(const VLRCpp::ContextRef &context, const std::string &filename) {
+    using namespace VLR;
+    using namespace VLRCpp;
 
-RGB sRGB_gamma(const RGB &v) {
-    return RGB(sRGB_gamma_s(v.r), sRGB_gamma_s(v.g), sRGB_gamma_s(v.b));
-}
+    uint32_t width, height;
+    context->getOutputBufferSize(&width, &height);
+    std::vector<uint32_t> data(width * height);
+
+    VLRResolveParameters params;
+    params.format = VLRResolveFormat_SRGB8;
+    params.exposure = g_brightnessCoeff;
+    params.tonemapOperator = VLRTonemapOperator_Exponential;
+    params.dither = false;
+    context->resolve(params, data.data());
 
-RGB min(const RGB &v, float minValue) {
-    return RGB(std::fmin(v.r, minValue), std::fmin(v.g, minValue), std::fmin(v.b, minValue));
+    stbi_write_bmp(filename.c_str(), width, height, 4, data.data());
 }
 
-RGB max(const RGB &v, float maxValue) {
-    return RGB(std::fmax(v.r, maxValue), std::fmax(v.g, maxValue), std::fmax(v.b, maxValue));
+// JP: 線形なRGBをクランプせずにEXRとして書き出す。
+//     ピクセルはvlrContextResolveの出力で、writeHalfならHalfRGBA、そうでなければLinearRGB。
+// EN: Write linear RGB as EXR without clamping.
+//     Pixels are the output of vlrContextResolve, HalfRGBA if writeHalf otherwise LinearRGB.
+static void writeEXR(const std::string &filename, const void* data, uint32_t width, uint32_t height, bool writeHalf) {
+    using namespace Imf;
+
+    if (writeHalf) {
+        RgbaOutputFile file(filename.c_str(), width, height, WRITE_RGB);
+        file.setFrameBuffer((const Rgba*)data, 1, width);
+        file.writePixels(height);
+    }
+    else {
+        const RGB* pixels = (const RGB*)data;
+        Header header(width, height);
+        header.channels().insert("R", Channel(FLOAT));
+        header.channels().insert("G", Channel(FLOAT));
+        header.channels().insert("B", Channel(FLOAT));
+
+        FrameBuffer frameBuffer;
+        const size_t xStride = sizeof(RGB);
+        const size_t yStride = sizeof(RGB) * width;
+        frameBuffer.insert("R", Slice(FLOAT, (char*)&pixels[0].r, xStride, yStride));
+        frameBuffer.insert("G", Slice(FLOAT, (char*)&pixels[0].g, xStride, yStride));
+        frameBuffer.insert("B", Slice(FLOAT, (char*)&pixels[0].b, xStride, yStride));
+
+        OutputFile file(filename.c_str(), header);
+        file.setFrameBuffer(frameBuffer);
+        file.writePixels(height);
+    }
 }
 
-static void saveOutputBufferAsImageFile(const VLRCpp::ContextRef &context, const std::string &filename) {
-    using namespace VLR;
-    using namespace VLRCpp;
+// JP: 画像の解決、トーンマップ、エンコードをレンダリングスレッドとは別のスレッドで行う。
+//     レンダリングスレッドでは蓄積バッファーのスナップショットを取るだけにする。
+//     書き出し待ちの画像は最新の1枚だけを保持し、書き出しが間に合わない場合は古いものを捨てる。
+// EN: Perform resolve, tonemapping and encoding of images on a thread separate from the rendering thread.
+//     The rendering thread only takes a snapshot of the accumulation buffer.
+//     Only the latest image waiting for writing is kept, and older ones are discarded if writing can't keep up.
+class AsyncImageWriter {
+    struct Job {
+        VLRCpp::AccumulationSnapshotRef snapshot;
+        std::string filename;
+        uint32_t numAccumFrames;
+    };
 
-    auto output = (const RGB*)context->mapOutputBuffer();
-    uint32_t width, height;
-    context->getOutputBufferSize(&width, &height);
-    auto data = new uint32_t[width * height];
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            RGB srcPix = output[y * width + x];
-            uint32_t &pix = data[y * width + x];
-
-            if (srcPix.r < 0.0f || srcPix.g < 0.0f || srcPix.b < 0.0f)
-                vlrprintf("Warning: Out of Color Gamut %d, %d: %g, %g, %g\n", x, y, srcPix.r, srcPix.g, srcPix.b);
-            srcPix *= g_brightnessCoeff;
-            srcPix = max(srcPix, 0.0f);
-            srcPix = RGB::One() - exp(-srcPix);
-            srcPix = sRGB_gamma(srcPix);
-
-            //float Y = srcPix.g;
-            //float b = srcPix.r + srcPix.g + srcPix.b;
-            //srcPix.r = srcPix.r / b;
-            //srcPix.g = srcPix.g / b;
-            //srcPix.b = Y * 0.6f;
-            //if (srcPix.r > 1.0f || srcPix.g > 1.0f || srcPix.b > 1.0f)
-            //    vlrprintf("Warning: Over 1.0 %d, %d: %g, %g, %g\n", x, y, srcPix.r, srcPix.g, srcPix.b);
-            //srcPix = min(srcPix, 1.0f);
-
-            Assert(srcPix.r <= 1.0f && srcPix.g <= 1.0f && srcPix.b <= 1.0f, "Pixel value should not be greater than 1.0.");
-
-            pix = ((std::min<uint32_t>(srcPix.r * 256, 255) << 0) |
-                   (std::min<uint32_t>(srcPix.g * 256, 255) << 8) |
-                   (std::min<uint32_t>(srcPix.b * 256, 255) << 16) |
-                   (0xFF << 24));
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    Job m_pendingJob;
+    bool m_hasPendingJob;
+    bool m_terminate;
+    bool m_writeHalf;
+    float m_brightnessCoeff;
+    VLRTonemapOperator m_tonemapOperator;
+    bool m_dither;
+
+    static std::string getExtension(const std::string &filename) {
+        std::string ext = filename.substr(filename.find_last_of('.') + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        return ext;
+    }
+
+    // JP: EXRは線形のまま、それ以外はトーンマップしてsRGBの8ビットに解決してから書き出す。
+    // EN: EXR is kept linear, others are tonemapped and resolved into 8-bit sRGB, then written.
+    void write(const Job &job) const {
+        const std::string &filename = job.filename;
+        std::string ext = getExtension(filename);
+
+        uint32_t width, height;
+        job.snapshot->getSize(&width, &height);
+
+        VLRResolveParameters params;
+        size_t pixelSize;
+        if (ext == "exr") {
+            params.format = m_writeHalf ? VLRResolveFormat_HalfRGBA : VLRResolveFormat_LinearRGB;
+            params.exposure = 1.0f;
+            pixelSize = m_writeHalf ? 4 * sizeof(uint16_t) : sizeof(RGB);
         }
+        else {
+            params.format = VLRResolveFormat_SRGB8;
+            params.exposure = m_brightnessCoeff;
+            pixelSize = sizeof(uint32_t);
+        }
+        params.tonemapOperator = m_tonemapOperator;
+        params.dither = m_dither;
+
+        std::vector<uint8_t> data(pixelSize * width * height);
+        job.snapshot->resolve(params, data.data());
+
+        if (ext == "exr") {
+            writeEXR(filename, data.data(), width, height, m_writeHalf);
+        }
+        else {
+            if (ext == "png")
+                stbi_write_png(filename.c_str(), width, height, 4, data.data(), sizeof(uint32_t) * width);
+            else
+                stbi_write_bmp(filename.c_str(), width, height, 4, data.data());
+        }
+        hpprintf("%u [spp]: %s\n", job.numAccumFrames, filename.c_str());
     }
 
-    stbi_write_bmp(filename.c_str(), width, height, 4, data);
-    delete[] data;
+    void process() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_hasPendingJob || m_terminate; });
+                if (!m_hasPendingJob)
+                    break;
+                job = std::move(m_pendingJob);
+                m_hasPendingJob = false;
+            }
+            write(job);
+        }
+    }
 
-    context->unmapOutputBuffer();
-}
+public:
+    AsyncImageWriter(bool writeHalf, float brightnessCoeff, VLRTonemapOperator tonemapOperator, bool dither) :
+        m_hasPendingJob(false), m_terminate(false), m_writeHalf(writeHalf), m_brightnessCoeff(brightnessCoeff),
+        m_tonemapOperator(tonemapOperator), m_dither(dither) {
+        m_thread = std::thread(&AsyncImageWriter::process, this);
+    }
+    ~AsyncImageWriter() {
+        finish();
+    }
+
+    // JP: 蓄積バッファーのスナップショットを取るだけで、解決と書き出しの完了は待たない。
+    // EN: This only takes a snapshot of the accumulation buffer and doesn't wait for the resolve and the writing to complete.
+    void enqueue(const VLRCpp::ContextRef &context, const std::string &filename, uint32_t numAccumFrames) {
+        Job job;
+        job.snapshot = context->createAccumulationSnapshot();
+        job.filename = filename;
+        job.numAccumFrames = numAccumFrames;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingJob = std::move(job);
+            m_hasPendingJob = true;
+        }
+        m_condition.notify_one();
+    }
+
+    // JP: 書き出し待ちの画像をすべて書き出してからスレッドを終了する。
+    // EN: Finish the thread after writing all the images waiting for writing.
+    void finish() {
+        if (!m_thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_terminate = true;
+        }
+        m_condition.notify_one();
+        m_thread.join();
+    }
+};
 
 
 
@@ -224,11 +339,26 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
     std::set<int32_t> devices;
     bool enableLogging = false;
     bool enableRTX = true;
+    VLRBackend backend = VLRBackend_OptiX;
+    VLRRenderingMode renderingMode = VLRRenderingMode_RGB;
     bool enableGUI = true;
     uint32_t renderImageSizeX = 1920;
     uint32_t renderImageSizeY = 1080;
     uint32_t maxCallableDepth = 8;
     uint32_t stackSize = 0;
+    float pixelErrorThreshold = 0.0f;
+    float targetError = 0.0f;
+    VLRAccumulationFormat accumulationFormat = VLRAccumulationFormat_Compensated;
+    uint32_t targetSPP = 0;
+    float timeBudget = 0.0f;
+    float checkpointInterval = 0.0f;
+    std::string outputFilename = "output.exr";
+    bool writeHalf = false;
+    VLRTonemapOperator tonemapOperator = VLRTonemapOperator_Exponential;
+    bool dither = false;
+    std::string accumulationFilename;
+    uint32_t sampleIndexOffset = 0;
+    std::vector<std::string> mergeFilenames;
 
     for (int i = 1; i < argc; ++i) {
         if (strncmp(argv[i], "--", 2) == 0) {
@@ -248,6 +378,12 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
             else if (strcmp(argv[i] + 2, "disableRTX") == 0) {
                 enableRTX = false;
             }
+            else if (strcmp(argv[i] + 2, "cpu") == 0) {
+                backend = VLRBackend_CPU;
+            }
+            else if (strcmp(argv[i] + 2, "spectral") == 0) {
+                renderingMode = VLRRenderingMode_Spectral;
+            }
             else if (strcmp(argv[i] + 2, "logging") == 0) {
                 enableLogging = true;
             }
@@ -270,6 +406,67 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
                 if (strncmp(argv[i], "--", 2) != 0)
                     stackSize = atoi(argv[i]);
             }
+            else if (strcmp(argv[i] + 2, "spp") == 0) {
+                ++i;
+                targetSPP = atoi(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "time-budget") == 0) {
+                ++i;
+                timeBudget = atof(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "checkpoint-interval") == 0) {
+                ++i;
+                checkpointInterval = atof(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "output") == 0) {
+                ++i;
+                outputFilename = argv[i];
+            }
+            else if (strcmp(argv[i] + 2, "half") == 0) {
+                writeHalf = true;
+            }
+            else if (strcmp(argv[i] + 2, "tonemap") == 0) {
+                ++i;
+                if (strcmp(argv[i], "clamp") == 0)
+                    tonemapOperator = VLRTonemapOperator_Clamp;
+                else if (strcmp(argv[i], "exponential") == 0)
+                    tonemapOperator = VLRTonemapOperator_Exponential;
+                else if (strcmp(argv[i], "reinhard") == 0)
+                    tonemapOperator = VLRTonemapOperator_Reinhard;
+                else
+                    vlrprintf("Unknown tonemap operator: %s\n", argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "dither") == 0) {
+                dither = true;
+            }
+            else if (strcmp(argv[i] + 2, "accumulation-file") == 0) {
+                ++i;
+                accumulationFilename = argv[i];
+            }
+            else if (strcmp(argv[i] + 2, "sample-range") == 0) {
+                ++i;
+                sampleIndexOffset = atoi(argv[i]);
+                ++i;
+                targetSPP = atoi(argv[i]) - sampleIndexOffset;
+            }
+            else if (strcmp(argv[i] + 2, "merge") == 0) {
+                ++i;
+                for (; i < argc; ++i) {
+                    if (strncmp(argv[i], "--", 2) == 0)
+                        break;
+                    mergeFilenames.push_back(argv[i]);
+                }
+                --i;
+            }
+            else if (strcmp(argv[i] + 2, "adaptive") == 0) {
+                ++i;
+                pixelErrorThreshold = atof(argv[i]);
+                ++i;
+                targetError = atof(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "compact-accumulation") == 0) {
+                accumulationFormat = VLRAccumulationFormat_CompactXYZ;
+            }
         }
     }
 
@@ -282,11 +479,17 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
         primaryDevice = deviceArray.front();
     }
 
-    char deviceName[128];
-    vlrGetDeviceName(primaryDevice, deviceName, lengthof(deviceName));
+    // JP: CPUバックエンドはGPUのない環境でも動くので、デバイスを問い合わせない。
+    // EN: The CPU backend works even without a GPU, so don't query the device.
+    char deviceName[128] = "CPU";
+    if (backend != VLRBackend_CPU)
+        vlrGetDeviceName(primaryDevice, deviceName, lengthof(deviceName));
 
     VLRCpp::ContextRef context = VLRCpp::Context::create(enableLogging, enableRTX, maxCallableDepth, stackSize,
-                                                         deviceArray.empty() ? nullptr : deviceArray.data(), deviceArray.size());
+                                                         deviceArray.empty() ? nullptr : deviceArray.data(), deviceArray.size(), backend,
+                                                         renderingMode);
+    context->setAdaptiveSampling(pixelErrorThreshold, 16, targetError);
+    context->setAccumulationFormat(accumulationFormat);
 
     Shot shot;
     createScene(context, &shot);
@@ -907,6 +1110,14 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
                 if (!firstFrame)
                     accumFrameTimes += sw.stop(StopWatch::Milliseconds);
 
+                // JP: CPUバックエンドの出力はOpenGLのバッファーと連携しないので、マップしてOpenGLのバッファーに転送する。
+                // EN: The output of the CPU backend doesn't interoperate with OpenGL buffers, so map it and transfer it to the OpenGL buffer.
+                if (backend == VLRBackend_CPU) {
+                    const void* output = context->mapOutputBuffer();
+                    outputBufferGL.subData(0, g_renderTargetSizeX * g_renderTargetSizeY, output);
+                    context->unmapOutputBuffer();
+                }
+
                 //// DELETE ME
                 //if (g_numAccumFrames == 32) {
                 //    devPrintf("Camera:\n");
@@ -1030,53 +1241,67 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
         vlrprintf("Setup: %g[s]\n", swGlobal.elapsed(StopWatch::Milliseconds) * 1e-3f);
         swGlobal.start();
 
+        // JP: 複数のプロセスがそれぞれ異なるサンプル範囲で保存した蓄積状態ファイルを合成して画像を出力する。
+        // EN: Merge accumulation state files saved by multiple processes each with a different sample range, and output the image.
+        if (!mergeFilenames.empty()) {
+            context->loadAccumulation(mergeFilenames[0]);
+            for (uint32_t i = 1; i < mergeFilenames.size(); ++i)
+                context->mergeAccumulation(mergeFilenames[i]);
+            if (!accumulationFilename.empty())
+                context->saveAccumulation(accumulationFilename);
+
+            AsyncImageWriter imageWriter(writeHalf, g_brightnessCoeff, tonemapOperator, dither);
+            imageWriter.enqueue(context, outputFilename, 0);
+            imageWriter.finish();
+
+            vlrprintf("Merged %u files: %g[s]\n", (uint32_t)mergeFilenames.size(), swGlobal.stop(StopWatch::Milliseconds) * 1e-3f);
+
+            return 0;
+        }
+
+        context->setSampleIndexOffset(sampleIndexOffset);
+
+        // JP: サンプル数、時間、収束のいずれも指定されていない場合は従来通り120秒で終了する。
+        // EN: Finish in 120 seconds as before when none of the number of samples, time and convergence is specified.
+        if (targetSPP == 0 && timeBudget <= 0.0f && targetError <= 0.0f)
+            timeBudget = 120.0f;
+        const uint64_t timeBudgetInMs = (uint64_t)(timeBudget * 1000);
+        const uint64_t checkpointIntervalInMs = (uint64_t)(checkpointInterval * 1000);
+
+        // JP: 蓄積状態ファイルが既にあれば、中断されたレンダリングを再開する。
+        // EN: Resume the interrupted rendering if the accumulation state file already exists.
+        if (!accumulationFilename.empty() && std::ifstream(accumulationFilename).good()) {
+            context->loadAccumulation(accumulationFilename);
+            vlrprintf("Resume from %s\n", accumulationFilename.c_str());
+        }
+
+        AsyncImageWriter imageWriter(writeHalf, g_brightnessCoeff, tonemapOperator, dither);
+
         uint32_t numAccumFrames = 0;
-        uint32_t imgIndex = 0;
-        uint32_t deltaTime = 15 * 1000;
-        uint32_t nextTimeToOutput = deltaTime;
-        uint32_t finishTime = 123 * 1000 - 3000;
-        auto data = new uint32_t[renderTargetSizeX * renderTargetSizeY];
+        uint64_t nextCheckpointTime = checkpointIntervalInMs;
         while (true) {
-            context->render(shot.scene, g_camera, 1, numAccumFrames == 0 ? true : false, &numAccumFrames);
+            bool converged;
+            context->render(shot.scene, g_camera, 1, numAccumFrames == 0 ? true : false, &numAccumFrames, &converged);
 
             uint64_t elapsed = swGlobal.elapsed(StopWatch::Milliseconds);
-            bool finish = swGlobal.elapsedFromRoot(StopWatch::Milliseconds) > finishTime;
-            if (elapsed > nextTimeToOutput || finish) {
-                auto output = (const RGB*)context->mapOutputBuffer();
-
-                for (int y = 0; y < renderTargetSizeY; ++y) {
-                    for (int x = 0; x < renderTargetSizeX; ++x) {
-                        RGB srcPix = output[y * renderTargetSizeX + x];
-                        uint32_t &pix = data[y * renderTargetSizeX + x];
-
-                        srcPix *= g_brightnessCoeff;
-                        srcPix = RGB::One() - exp(-srcPix);
-                        srcPix = sRGB_gamma(srcPix);
-
-                        pix = ((std::min<uint8_t>(srcPix.r * 256, 255) << 0) |
-                               (std::min<uint8_t>(srcPix.g * 256, 255) << 8) |
-                               (std::min<uint8_t>(srcPix.b * 256, 255) << 16) |
-                               (0xFF << 24));
-                    }
-                }
-
-                char filename[256];
-                //sprintf(filename, "%03u.png", imgIndex++);
-                //stbi_write_png(filename, renderTargetSizeX, renderTargetSizeY, 4, data, sizeof(data[0]) * renderTargetSizeX);
-                sprintf(filename, "%03u.bmp", imgIndex++);
-                stbi_write_bmp(filename, renderTargetSizeX, renderTargetSizeY, 4, data);
-                vlrprintf("%u [spp]: %s, %g [s]\n", numAccumFrames, filename, elapsed * 1e-3f);
-
-                context->unmapOutputBuffer();
+            bool finish = converged ||
+                (targetSPP > 0 && numAccumFrames >= targetSPP) ||
+                (timeBudgetInMs > 0 && elapsed >= timeBudgetInMs);
+            bool checkpoint = checkpointIntervalInMs > 0 && elapsed >= nextCheckpointTime;
+            if (finish || checkpoint) {
+                imageWriter.enqueue(context, outputFilename, numAccumFrames);
+                if (!accumulationFilename.empty())
+                    context->saveAccumulation(accumulationFilename);
+                vlrprintf("%u [spp]: %g [s]\n", numAccumFrames, elapsed * 1e-3f);
 
                 if (finish)
                     break;
 
-                nextTimeToOutput += deltaTime;
-                nextTimeToOutput = std::min(nextTimeToOutput, finishTime);
+                while (nextCheckpointTime <= elapsed)
+                    nextCheckpointTime += checkpointIntervalInMs;
             }
         }
-        delete[] data;
+        imageWriter.finish();
 
         swGlobal.stop();
 
@@ -292,6 +292,7 @@ VLRCpp::Image2DRef loadImage2D(const VLRCpp::ContextRef &context, const std::str
     std::transform(ext.begin(), ext.end(), ext.begin(), std::tolower);
 
 //#define OVERRIDE_BY_DDS
+//#define COMPRESS_LDR_TEXTURES
 
 #if defined(OVERRIDE_BY_DDS)
     std::string ddsFilepath = filepath;
@@ -332,9 +333,10 @@ VLRCpp::Image2DRef loadImage2D(const VLRCpp::ContextRef &context, const std::str
             curDataHead += width;
         }
 
-        ret = context->createLinearImage2D((uint8_t*)linearImageData, width, height, VLRDataFormat_RGBA16Fx4, applyDegamma);
-
-        delete[] linearImageData;
+        // JP: 画像側にデータを引き取らせ、不要になった時点で解放させる。
+        // EN: Let the image adopt the data and free it when it becomes unnecessary.
+        ret = context->createLinearImage2D((uint8_t*)linearImageData, width, height, VLRDataFormat_RGBA16Fx4, applyDegamma,
+                                           [](const uint8_t* data, void* userData) { delete[] (Rgba*)data; }, nullptr);
     }
     else if (ext == "dds") {
         int32_t width, height, mipCount;
@@ -412,17 +414,28 @@ VLRCpp::Image2DRef loadImage2D(const VLRCpp::ContextRef &context, const std::str
     else {
         int32_t width, height, n;
         uint8_t* linearImageData = stbi_load(filepath.c_str(), &width, &height, &n, 0);
+        const VLRImageDataReleaseCallback release = [](const uint8_t* data, void* userData) {
+            stbi_image_free(const_cast<uint8_t*>(data));
+        };
+        LinearImage2DRef linearImage;
         if (n == 4)
-            ret = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_RGBA8x4, applyDegamma);
+            linearImage = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_RGBA8x4, applyDegamma, release, nullptr);
         else if (n == 3)
-            ret = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_RGB8x3, applyDegamma);
+            linearImage = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_RGB8x3, applyDegamma, release, nullptr);
         else if (n == 2)
-            ret = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_GrayA8x2, applyDegamma);
+            linearImage = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_GrayA8x2, applyDegamma, release, nullptr);
         else if (n == 1)
-            ret = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_Gray8, applyDegamma);
+            linearImage = context->createLinearImage2D(linearImageData, width, height, VLRDataFormat_Gray8, applyDegamma, release, nullptr);
         else
             Assert_ShouldNotBeCalled();
-        stbi_image_free(linearImageData);
+        ret = linearImage;
+
+#if defined(COMPRESS_LDR_TEXTURES)
+        // JP: 読み込み時にBC形式に圧縮してGPUメモリーを減らす。圧縮結果は画像の隣にキャッシュする。
+        // EN: Compress into a BC format at load time to reduce GPU memory. The compressed result is cached next to the image.
+        VLRDataFormat bcFormat = n == 4 ? VLRDataFormat_BC7 : (n == 3 ? VLRDataFormat_BC1 : (n == 2 ? VLRDataFormat_BC3 : VLRDataFormat_BC4));
+        ret = context->convertImageToBlockCompressed(linearImage, bcFormat, (filepath + ".vlrbc").c_str());
+#endif
     }
 
     hpprintf("done.\n");
@@ -0,0 +1,801 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// JP: ブロック圧縮の展開の正解データ。
+//     ブロックはモードのビットを設定した上で残りをランダムに埋めたもので、BC7は全8モード、BC6Hは全14モードを2つずつ含む。
+//     期待する画素はMesa 22.3 (llvmpipe)でglCompressedTexImage2D()とglGetTexImage()を通して展開した結果。
+//     BC6Hは同じブロックを符号無しと符号付きの両方で展開した半精度浮動小数点数のビット列。
+//     ただし符号付きのBC4とBC5ではMesaが8ビット整数で補間して1段階ずれるため、D3Dの式から単精度で計算した値を使う。
+// EN: Golden data for decompression of block compression.
+//     Blocks are random bits with the mode bits set, with two blocks for each of all 8 BC7 modes and all 14 BC6H modes.
+//     Expected pixels are the results of decompression by Mesa 22.3 (llvmpipe) through glCompressedTexImage2D() and glGetTexImage().
+//     For BC6H, the same block is decompressed both as unsigned and signed, and the expected values are the bits of half floats.
+//     For signed BC4 and BC5, however, Mesa interpolates in 8-bit integers and is off by one step, so the values are computed in single precision from the D3D formula.
+
+namespace VLRTest {
+    template <typename PixelType, uint32_t NumComponents>
+    struct GoldenBlock {
+        uint8_t block[16];
+        PixelType pixels[16][NumComponents];
+    };
+
+    typedef GoldenBlock<uint8_t, 4> GoldenBlockRGBA8;
+    typedef GoldenBlock<uint8_t, 2> GoldenBlockRG8;
+    typedef GoldenBlock<uint8_t, 1> GoldenBlockGray8;
+    typedef GoldenBlock<float, 2> GoldenBlockFloat2;
+    typedef GoldenBlock<float, 1> GoldenBlockFloat1;
+
+    struct GoldenBlockBC6H {
+        uint8_t block[16];
+        uint16_t unsignedPixels[16][3];
+        uint16_t signedPixels[16][3];
+    };
+
+
+
+    const GoldenBlockRGBA8 BC7Blocks[] = {
+        // Mode 0
+        {
+            { 0x47, 0x07, 0x70, 0x2e, 0xa9, 0x1f, 0x7c, 0xe4, 0xcb, 0x86, 0xf0, 0x87, 0x85, 0xc0, 0x8e, 0xf1 },
+            {
+                { 0x84, 0x7d, 0x2d, 0xff }, { 0x73, 0xe7, 0x31, 0xff }, { 0x73, 0xe7, 0x31, 0xff }, { 0x31, 0x00, 0x63, 0xff },
+                { 0x62, 0x65, 0x28, 0xff }, { 0x52, 0x59, 0x26, 0xff }, { 0x31, 0x00, 0x63, 0xff }, { 0x44, 0x41, 0x55, 0xff },
+                { 0xa5, 0x94, 0x31, 0xff }, { 0x62, 0x65, 0x28, 0xff }, { 0x61, 0xf0, 0x83, 0xff }, { 0x3c, 0xe9, 0xb6, 0xff },
+                { 0x62, 0x65, 0x28, 0xff }, { 0x19, 0xe2, 0xe7, 0xff }, { 0x73, 0xf3, 0x6a, 0xff }, { 0x3c, 0xe9, 0xb6, 0xff },
+            }
+        },
+        {
+            { 0x8d, 0xdb, 0x54, 0x96, 0x2d, 0x7a, 0xec, 0xfa, 0x83, 0x65, 0x8c, 0x90, 0x16, 0x2d, 0xb5, 0x2f },
+            {
+                { 0xd0, 0xc0, 0x89, 0xff }, { 0xd7, 0x95, 0xb4, 0xff }, { 0x21, 0x31, 0xc6, 0xff }, { 0x4d, 0x41, 0x9a, 0xff },
+                { 0xd7, 0x95, 0xb4, 0xff }, { 0xdc, 0x79, 0xd0, 0xff }, { 0x4d, 0x41, 0x9a, 0xff }, { 0x7b, 0x53, 0x6b, 0xff },
+                { 0x9c, 0xba, 0x30, 0xff }, { 0x76, 0x48, 0xb6, 0xff }, { 0x76, 0x48, 0xb6, 0xff }, { 0x92, 0x9e, 0x51, 0xff },
+                { 0x92, 0x9e, 0x51, 0xff }, { 0xa5, 0xd6, 0x10, 0xff }, { 0x92, 0x9e, 0x51, 0xff }, { 0x63, 0x10, 0xf7, 0xff },
+            }
+        },
+        // Mode 1
+        {
+            { 0x2a, 0x40, 0x50, 0xe7, 0x73, 0xc3, 0x90, 0x22, 0xb5, 0xd9, 0x01, 0x53, 0xfa, 0x2d, 0xcc, 0x03 },
+            {
+                { 0x02, 0xcf, 0x8b, 0xff }, { 0x02, 0xcf, 0x8b, 0xff }, { 0x05, 0x4c, 0x5a, 0xff }, { 0x04, 0x77, 0x6a, 0xff },
+                { 0x03, 0xa4, 0x7b, 0xff }, { 0x03, 0xa4, 0x7b, 0xff }, { 0x06, 0x36, 0x52, 0xff }, { 0xe5, 0x91, 0xd9, 0xff },
+                { 0x05, 0x4c, 0x5a, 0xff }, { 0xda, 0x4b, 0x8b, 0xff }, { 0xd5, 0x30, 0x6c, 0xff }, { 0xdc, 0x59, 0x9a, 0xff },
+                { 0xe3, 0x83, 0xca, 0xff }, { 0xdc, 0x59, 0x9a, 0xff }, { 0xd5, 0x30, 0x6c, 0xff }, { 0xd5, 0x30, 0x6c, 0xff },
+            }
+        },
+        {
+            { 0x8e, 0x15, 0xc8, 0x5c, 0x52, 0x61, 0x82, 0x57, 0x7e, 0xe6, 0xf8, 0x61, 0xc4, 0x2a, 0x3d, 0x4e },
+            {
+                { 0x61, 0x39, 0x83, 0xff }, { 0x81, 0x14, 0xe5, 0xff }, { 0x43, 0x8f, 0xbb, 0xff }, { 0x30, 0x99, 0x9d, 0xff },
+                { 0x67, 0x32, 0x96, 0xff }, { 0x6e, 0x2a, 0xab, 0xff }, { 0x30, 0x99, 0x9d, 0xff }, { 0x43, 0x8f, 0xbb, 0xff },
+                { 0x36, 0x96, 0xa7, 0xff }, { 0x50, 0x88, 0xd1, 0xff }, { 0x6e, 0x2a, 0xab, 0xff }, { 0x7b, 0x1b, 0xd2, 0xff },
+                { 0x43, 0x8f, 0xbb, 0xff }, { 0x49, 0x8b, 0xc7, 0xff }, { 0x67, 0x32, 0x96, 0xff }, { 0x61, 0x39, 0x83, 0xff },
+            }
+        },
+        // Mode 2
+        {
+            { 0x54, 0x5a, 0x66, 0xcc, 0x52, 0x6d, 0x4d, 0x5d, 0x12, 0x23, 0xc6, 0xca, 0x92, 0x2c, 0xd7, 0x91 },
+            {
+                { 0x6b, 0xd6, 0xc6, 0xff }, { 0x8b, 0xcb, 0x9b, 0xff }, { 0xae, 0xc0, 0x6d, 0xff }, { 0x6b, 0xd6, 0xc6, 0xff },
+                { 0x63, 0xad, 0x63, 0xff }, { 0x63, 0x84, 0x63, 0xff }, { 0x63, 0x31, 0x63, 0xff }, { 0x63, 0x84, 0x63, 0xff },
+                { 0xa5, 0x94, 0x5a, 0xff }, { 0xaa, 0x81, 0x4a, 0xff }, { 0xaa, 0x81, 0x4a, 0xff }, { 0xa5, 0x94, 0x5a, 0xff },
+                { 0xb5, 0x5a, 0x29, 0xff }, { 0xaa, 0x81, 0x4a, 0xff }, { 0xb5, 0x5a, 0x29, 0xff }, { 0xb0, 0x6d, 0x39, 0xff },
+            }
+        },
+        {
+            { 0xbc, 0xe7, 0xee, 0x5a, 0x6a, 0xf8, 0x60, 0x09, 0x49, 0xa0, 0x4b, 0x4e, 0x28, 0x4e, 0xee, 0xfc },
+            {
+                { 0xb2, 0x81, 0x20, 0xff }, { 0xc8, 0x7e, 0x32, 0xff }, { 0x9c, 0x84, 0x10, 0xff }, { 0xc8, 0x7e, 0x32, 0xff },
+                { 0xde, 0x7b, 0x42, 0xff }, { 0x9c, 0x84, 0x10, 0xff }, { 0xb2, 0x81, 0x20, 0xff }, { 0xc8, 0x7e, 0x32, 0xff },
+                { 0xd6, 0x4a, 0x08, 0xff }, { 0xde, 0x47, 0x54, 0xff }, { 0xe7, 0x66, 0x8a, 0xff }, { 0xaa, 0x1e, 0x29, 0xff },
+                { 0xc0, 0x34, 0x18, 0xff }, { 0xd6, 0x29, 0x21, 0xff }, { 0xd6, 0x29, 0x21, 0xff }, { 0xaa, 0x1e, 0x29, 0xff },
+            }
+        },
+        // Mode 3
+        {
+            { 0x68, 0xc4, 0xad, 0xf8, 0x76, 0x14, 0x27, 0xb0, 0x6b, 0x01, 0x4a, 0x7d, 0xc4, 0x7d, 0xe8, 0xcb },
+            {
+                { 0xd1, 0x92, 0x7a, 0xff }, { 0xe3, 0xa3, 0xb5, 0xff }, { 0xbe, 0x81, 0x3b, 0xff }, { 0xda, 0xec, 0xf4, 0xff },
+                { 0xbe, 0x81, 0x3b, 0xff }, { 0xac, 0x70, 0x00, 0xff }, { 0xda, 0xec, 0xf4, 0xff }, { 0xf0, 0x04, 0x94, 0xff },
+                { 0xe3, 0xa3, 0xb5, 0xff }, { 0xe9, 0x50, 0xb4, 0xff }, { 0xda, 0xec, 0xf4, 0xff }, { 0xda, 0xec, 0xf4, 0xff },
+                { 0xe9, 0x50, 0xb4, 0xff }, { 0xe9, 0x50, 0xb4, 0xff }, { 0xe1, 0xa0, 0xd5, 0xff }, { 0xe9, 0x50, 0xb4, 0xff },
+            }
+        },
+        {
+            { 0xf8, 0x5a, 0x20, 0x16, 0xc4, 0x1f, 0x62, 0x2d, 0x57, 0x17, 0xa6, 0x7c, 0xd8, 0x26, 0x0e, 0x32 },
+            {
+                { 0x2d, 0xff, 0xab, 0xff }, { 0x20, 0x20, 0x16, 0xff }, { 0x24, 0x69, 0x47, 0xff }, { 0x29, 0xb6, 0x7a, 0xff },
+                { 0x20, 0x20, 0x16, 0xff }, { 0x2c, 0xac, 0x4c, 0xff }, { 0x23, 0xb6, 0x82, 0xff }, { 0x2d, 0xff, 0xab, 0xff },
+                { 0x24, 0x69, 0x47, 0xff }, { 0x10, 0xca, 0xf2, 0xff }, { 0x2c, 0xac, 0x4c, 0xff }, { 0x2d, 0xff, 0xab, 0xff },
+                { 0x24, 0x69, 0x47, 0xff }, { 0x2d, 0xff, 0xab, 0xff }, { 0x20, 0x20, 0x16, 0xff }, { 0x2d, 0xff, 0xab, 0xff },
+            }
+        },
+        // Mode 4
+        {
+            { 0x90, 0x7f, 0xeb, 0xf2, 0xf8, 0x27, 0x0c, 0x60, 0x12, 0xdc, 0x8c, 0xfd, 0x13, 0xe3, 0x2d, 0x73 },
+            {
+                { 0xf6, 0xa5, 0x99, 0x57 }, { 0xfa, 0xbe, 0x8a, 0x57 }, { 0xe3, 0x41, 0xd8, 0x7d }, { 0xe3, 0x41, 0xd8, 0x7d },
+                { 0xde, 0x29, 0xe7, 0x7d }, { 0xde, 0x29, 0xe7, 0x7d }, { 0xec, 0x72, 0xb9, 0x08 }, { 0xff, 0xd6, 0x7b, 0x7d },
+                { 0xf1, 0x8d, 0xa9, 0x57 }, { 0xec, 0x72, 0xb9, 0x2e }, { 0xde, 0x29, 0xe7, 0x7d }, { 0xe3, 0x41, 0xd8, 0x7d },
+                { 0xf6, 0xa5, 0x99, 0x2e }, { 0xe3, 0x41, 0xd8, 0x08 }, { 0xec, 0x72, 0xb9, 0x2e }, { 0xf1, 0x8d, 0xa9, 0x57 },
+            }
+        },
+        {
+            { 0xb0, 0x65, 0x82, 0x13, 0x1c, 0x39, 0xc1, 0xd7, 0xde, 0x9c, 0x4b, 0xcf, 0x80, 0x88, 0xe5, 0x07 },
+            {
+                { 0x92, 0x08, 0x17, 0x39 }, { 0x92, 0x08, 0x17, 0x39 }, { 0x64, 0x29, 0x55, 0x7c }, { 0x4d, 0x39, 0x73, 0x9c },
+                { 0x4d, 0x21, 0x46, 0x6b }, { 0x64, 0x08, 0x17, 0x39 }, { 0x64, 0x00, 0x08, 0x29 }, { 0x7b, 0x21, 0x46, 0x6b },
+                { 0x4d, 0x00, 0x08, 0x29 }, { 0x4d, 0x08, 0x17, 0x39 }, { 0x64, 0x31, 0x64, 0x8c }, { 0x7b, 0x10, 0x26, 0x49 },
+                { 0x64, 0x31, 0x64, 0x8c }, { 0x4d, 0x39, 0x73, 0x9c }, { 0x92, 0x08, 0x17, 0x39 }, { 0x4d, 0x00, 0x08, 0x29 },
+            }
+        },
+        // Mode 5
+        {
+            { 0xe0, 0x01, 0xa0, 0x1a, 0x36, 0x19, 0x02, 0x93, 0xe4, 0x1f, 0x81, 0xe8, 0xee, 0x71, 0x75, 0x4f },
+            {
+                { 0x2c, 0xaf, 0x8d, 0x46 }, { 0x02, 0xd5, 0x24, 0x26 }, { 0x81, 0x60, 0x57, 0x87 }, { 0x81, 0x60, 0x24, 0x87 },
+                { 0x81, 0x60, 0x8d, 0x87 }, { 0x81, 0x60, 0xc0, 0x87 }, { 0x02, 0xd5, 0x24, 0x26 }, { 0x57, 0x86, 0x8d, 0x67 },
+                { 0x02, 0xd5, 0x8d, 0x26 }, { 0x02, 0xd5, 0x8d, 0x26 }, { 0x02, 0xd5, 0x24, 0x26 }, { 0x2c, 0xaf, 0x8d, 0x46 },
+                { 0x02, 0xd5, 0x24, 0x26 }, { 0x2c, 0xaf, 0x24, 0x46 }, { 0x81, 0x60, 0xc0, 0x87 }, { 0x2c, 0xaf, 0x8d, 0x46 },
+            }
+        },
+        {
+            { 0x20, 0x82, 0x59, 0x7f, 0x5d, 0xcb, 0x65, 0x05, 0x70, 0xb1, 0x79, 0x5e, 0x69, 0xfd, 0x97, 0x4c },
+            {
+                { 0x04, 0xfb, 0x6a, 0x59 }, { 0x46, 0xe3, 0x6f, 0x1e }, { 0x66, 0xd7, 0x72, 0x1e }, { 0x46, 0xe3, 0x6f, 0x3c },
+                { 0x04, 0xfb, 0x6a, 0x3c }, { 0x46, 0xe3, 0x6f, 0x01 }, { 0x24, 0xef, 0x6d, 0x01 }, { 0x66, 0xd7, 0x72, 0x01 },
+                { 0x04, 0xfb, 0x6a, 0x01 }, { 0x66, 0xd7, 0x72, 0x3c }, { 0x66, 0xd7, 0x72, 0x3c }, { 0x04, 0xfb, 0x6a, 0x1e },
+                { 0x66, 0xd7, 0x72, 0x59 }, { 0x66, 0xd7, 0x72, 0x01 }, { 0x46, 0xe3, 0x6f, 0x59 }, { 0x46, 0xe3, 0x6f, 0x3c },
+            }
+        },
+        // Mode 6
+        {
+            { 0xc0, 0x1d, 0x03, 0x8a, 0x7e, 0xb1, 0x39, 0x25, 0x24, 0x94, 0x8e, 0x33, 0x73, 0xa6, 0xc3, 0x49 },
+            {
+                { 0x69, 0xa7, 0x6f, 0x3b }, { 0x69, 0xa7, 0x6f, 0x3b }, { 0x5d, 0xad, 0x7e, 0x3d }, { 0x3e, 0xbd, 0xa6, 0x43 },
+                { 0x1e, 0xcd, 0xd0, 0x49 }, { 0x44, 0xba, 0x9f, 0x42 }, { 0x63, 0xaa, 0x77, 0x3c }, { 0x63, 0xaa, 0x77, 0x3c },
+                { 0x63, 0xaa, 0x77, 0x3c }, { 0x4a, 0xb7, 0x97, 0x40 }, { 0x50, 0xb4, 0x90, 0x3f }, { 0x37, 0xc0, 0xb0, 0x44 },
+                { 0x63, 0xaa, 0x77, 0x3c }, { 0x2b, 0xc6, 0xbf, 0x46 }, { 0x3e, 0xbd, 0xa6, 0x43 }, { 0x5d, 0xad, 0x7e, 0x3d },
+            }
+        },
+        {
+            { 0x40, 0xf0, 0x96, 0x0c, 0x0a, 0xc3, 0xc0, 0xb1, 0x9b, 0x8c, 0xb8, 0x70, 0x06, 0x4a, 0xbd, 0x73 },
+            {
+                { 0xbe, 0x9c, 0xa3, 0xa2 }, { 0xbb, 0x78, 0x89, 0x89 }, { 0xb9, 0x5d, 0x75, 0x76 }, { 0xbc, 0x81, 0x8f, 0x8f },
+                { 0xbc, 0x81, 0x8f, 0x8f }, { 0xba, 0x65, 0x7b, 0x7c }, { 0xc1, 0xc9, 0xc3, 0xc1 }, { 0xbc, 0x89, 0x95, 0x95 },
+                { 0xbd, 0x92, 0x9b, 0x9b }, { 0xc1, 0xc9, 0xc3, 0xc1 }, { 0xba, 0x6e, 0x81, 0x82 }, { 0xbe, 0xa5, 0xa9, 0xa8 },
+                { 0xb8, 0x54, 0x6f, 0x70 }, { 0xba, 0x65, 0x7b, 0x7c }, { 0xbf, 0xad, 0xaf, 0xae }, { 0xbc, 0x89, 0x95, 0x95 },
+            }
+        },
+        // Mode 7
+        {
+            { 0x80, 0xcc, 0x06, 0xc1, 0x24, 0x0f, 0x61, 0xa0, 0x8b, 0x5b, 0x79, 0xdc, 0x3b, 0x93, 0x32, 0x79 },
+            {
+                { 0xdf, 0x4d, 0x0c, 0xb6 }, { 0x04, 0xf7, 0xa6, 0x96 }, { 0x97, 0x85, 0x3f, 0xac }, { 0x27, 0x86, 0xba, 0x62 },
+                { 0x97, 0x85, 0x3f, 0xac }, { 0x27, 0x86, 0xba, 0x62 }, { 0x0c, 0x86, 0x5d, 0x3c }, { 0x19, 0x86, 0x8a, 0x4f },
+                { 0x19, 0x86, 0x8a, 0x4f }, { 0x27, 0x86, 0xba, 0x62 }, { 0x19, 0x86, 0x8a, 0x4f }, { 0x27, 0x86, 0xba, 0x62 },
+                { 0x0c, 0x86, 0x5d, 0x3c }, { 0x34, 0x86, 0xe7, 0x75 }, { 0x34, 0x86, 0xe7, 0x75 }, { 0x0c, 0x86, 0x5d, 0x3c },
+            }
+        },
+        {
+            { 0x80, 0x1b, 0xc4, 0xf3, 0x5a, 0xd8, 0x85, 0x5c, 0x6b, 0x75, 0x93, 0x6d, 0x5d, 0x7a, 0x7c, 0x9f },
+            {
+                { 0x9a, 0xa5, 0x82, 0xb0 }, { 0xc3, 0x82, 0x59, 0x30 }, { 0x9e, 0xef, 0x5d, 0xcf }, { 0xa7, 0xa6, 0x5c, 0xc5 },
+                { 0xaf, 0x93, 0x6d, 0x6f }, { 0xb1, 0x59, 0x5a, 0xbc }, { 0xba, 0x10, 0x59, 0xb2 }, { 0x9a, 0xa5, 0x82, 0xb0 },
+                { 0x86, 0xb6, 0x96, 0xef }, { 0xba, 0x10, 0x59, 0xb2 }, { 0xba, 0x10, 0x59, 0xb2 }, { 0x9a, 0xa5, 0x82, 0xb0 },
+                { 0xba, 0x10, 0x59, 0xb2 }, { 0xba, 0x10, 0x59, 0xb2 }, { 0x9a, 0xa5, 0x82, 0xb0 }, { 0xaf, 0x93, 0x6d, 0x6f },
+            }
+        },
+    };
+
+    const GoldenBlockBC6H BC6HBlocks[] = {
+        // Mode 1
+        {
+            { 0xdc, 0x78, 0xf6, 0x78, 0x9a, 0x20, 0x81, 0x5a, 0x86, 0x8b, 0x73, 0x85, 0x02, 0x72, 0x83, 0x49 },
+            {
+                { 0x7509, 0x3ba3, 0x2653 }, { 0x7376, 0x3cba, 0x24fe }, { 0x7498, 0x3bf1, 0x25f3 }, { 0x7532, 0x39f9, 0x24a1 },
+                { 0x7420, 0x3c44, 0x258e }, { 0x74fd, 0x3a3f, 0x24a1 }, { 0x7566, 0x39b3, 0x24a1 }, { 0x7566, 0x39b3, 0x24a1 },
+                { 0x7532, 0x39f9, 0x24a1 }, { 0x7426, 0x3b5d, 0x24a1 }, { 0x745b, 0x3b18, 0x24a1 }, { 0x74d0, 0x3bca, 0x2623 },
+                { 0x7566, 0x39b3, 0x24a1 }, { 0x745f, 0x3c19, 0x25c3 }, { 0x7498, 0x3bf1, 0x25f3 }, { 0x7498, 0x3bf1, 0x25f3 },
+            },
+            {
+                { 0x8e2b, 0x7747, 0x4ca7 }, { 0x9151, 0x7975, 0x49fd }, { 0x8f0d, 0x77e3, 0x4be7 }, { 0x8dd9, 0x73f2, 0x4943 },
+                { 0x8ffc, 0x7889, 0x4b1c }, { 0x8e42, 0x747e, 0x4943 }, { 0x8d71, 0x7367, 0x4943 }, { 0x8d71, 0x7367, 0x4943 },
+                { 0x8dd9, 0x73f2, 0x4943 }, { 0x8ff0, 0x76bb, 0x4943 }, { 0x8f87, 0x7630, 0x4943 }, { 0x8e9c, 0x7795, 0x4c47 },
+                { 0x8d71, 0x7367, 0x4943 }, { 0x8f7f, 0x7832, 0x4b87 }, { 0x8f0d, 0x77e3, 0x4be7 }, { 0x8f0d, 0x77e3, 0x4be7 },
+            }
+        },
+        {
+            { 0xa4, 0x16, 0x05, 0x92, 0xc5, 0x85, 0x7e, 0x5a, 0x49, 0x5b, 0xbc, 0x5d, 0xcc, 0x70, 0x86, 0x63 },
+            {
+                { 0x1591, 0x34f8, 0x55c9 }, { 0x15bf, 0x47ed, 0x57dd }, { 0x15bf, 0x47ed, 0x57dd }, { 0x14c4, 0x0126, 0x5837 },
+                { 0x15b4, 0x23bc, 0x55fd }, { 0x157b, 0x34cc, 0x57f6 }, { 0x1639, 0x6a5c, 0x57b2 }, { 0x15bf, 0x47ed, 0x57dd },
+                { 0x15fa, 0x0145, 0x5666 }, { 0x14c4, 0x0126, 0x5837 }, { 0x157b, 0x34cc, 0x57f6 }, { 0x1639, 0x6a5c, 0x57b2 },
+                { 0x156b, 0x481e, 0x558f }, { 0x15bf, 0x47ed, 0x57dd }, { 0x157b, 0x34cc, 0x57f6 }, { 0x1639, 0x6a5c, 0x57b2 },
+            },
+            {
+                { 0x2b23, 0x0136, 0xccaa }, { 0x2b7e, 0x0057, 0xc882 }, { 0x2b7e, 0x0057, 0xc882 }, { 0x2989, 0x024d, 0xc7cf },
+                { 0x2b69, 0x01a8, 0xcc42 }, { 0x2af7, 0x00de, 0xc851 }, { 0x2c72, 0x809c, 0xc8d9 }, { 0x2b7e, 0x0057, 0xc882 },
+                { 0x2bf5, 0x028b, 0xcb71 }, { 0x2989, 0x024d, 0xc7cf }, { 0x2af7, 0x00de, 0xc851 }, { 0x2c72, 0x809c, 0xc8d9 },
+                { 0x2ad6, 0x00b9, 0xcd1f }, { 0x2b7e, 0x0057, 0xc882 }, { 0x2af7, 0x00de, 0xc851 }, { 0x2c72, 0x809c, 0xc8d9 },
+            }
+        },
+        // Mode 2
+        {
+            { 0x91, 0x60, 0xba, 0x7b, 0x5e, 0xdb, 0xe7, 0x1e, 0xea, 0x22, 0xe1, 0xc8, 0x31, 0x4e, 0x82, 0x1c },
+            {
+                { 0x045c, 0x70dc, 0x3b94 }, { 0x5d70, 0x6f31, 0x3914 }, { 0x6672, 0x1bb7, 0x4789 }, { 0x5730, 0x267a, 0x43fe },
+                { 0x5d70, 0x6f31, 0x3914 }, { 0x6672, 0x1bb7, 0x4789 }, { 0x1876, 0x52b8, 0x356e }, { 0x75b4, 0x10f4, 0x4b14 },
+                { 0x0934, 0x5d7c, 0x31e4 }, { 0x36fa, 0x3d32, 0x3c84 }, { 0x36fa, 0x3d32, 0x3c84 }, { 0x75b4, 0x10f4, 0x4b14 },
+                { 0x36fa, 0x3d32, 0x3c84 }, { 0x36fa, 0x3d32, 0x3c84 }, { 0x47ee, 0x313d, 0x4073 }, { 0x75b4, 0x10f4, 0x4b14 },
+            },
+            {
+                { 0x08b8, 0x9838, 0x7728 }, { 0x9be9, 0x9b8c, 0x7229 }, { 0x89e6, 0x1448, 0xc7b7 }, { 0x8544, 0x06a9, 0xaba7 },
+                { 0x9be9, 0x9b8c, 0x7229 }, { 0x89e6, 0x1448, 0xc7b7 }, { 0x0dc6, 0xb158, 0x47b7 }, { 0x8e88, 0x21e8, 0xe3c8 },
+                { 0x1268, 0xbef8, 0x63c8 }, { 0x0482, 0x9619, 0x0f97 }, { 0x0482, 0x9619, 0x0f97 }, { 0x8e88, 0x21e8, 0xe3c8 },
+                { 0x0482, 0x9619, 0x0f97 }, { 0x0482, 0x9619, 0x0f97 }, { 0x80a2, 0x86f6, 0x8f97 }, { 0x8e88, 0x21e8, 0xe3c8 },
+            }
+        },
+        {
+            { 0x1d, 0x83, 0xc9, 0x6e, 0x6c, 0x57, 0x30, 0x75, 0x43, 0x12, 0x76, 0xfe, 0x92, 0x89, 0x96, 0x8a },
+            {
+                { 0x1525, 0x1329, 0x32c4 }, { 0x0554, 0x14d4, 0x2074 }, { 0x0d17, 0x1402, 0x2971 }, { 0x0554, 0x14d4, 0x2074 },
+                { 0x789c, 0x0934, 0x4924 }, { 0x128e, 0x136f, 0x2fc5 }, { 0x128e, 0x136f, 0x2fc5 }, { 0x07ea, 0x148e, 0x2373 },
+                { 0x7762, 0x3905, 0x3862 }, { 0x75b4, 0x7a8c, 0x216c }, { 0x77ca, 0x2914, 0x3df8 }, { 0x0a81, 0x1448, 0x2672 },
+                { 0x7762, 0x3905, 0x3862 }, { 0x7685, 0x5aab, 0x2c97 }, { 0x761c, 0x6a9b, 0x2701 }, { 0x7685, 0x5aab, 0x2c97 },
+            },
+            {
+                { 0x2a4a, 0x2653, 0x6589 }, { 0x0aa8, 0x29a8, 0x40e8 }, { 0x1a2f, 0x2805, 0x52e3 }, { 0x0aa8, 0x29a8, 0x40e8 },
+                { 0x88b8, 0x1268, 0xe7a8 }, { 0x251d, 0x26df, 0x5f8b }, { 0x251d, 0x26df, 0x5f8b }, { 0x0fd5, 0x291c, 0x46e6 },
+                { 0x8b2b, 0x0899, 0x9fba }, { 0x8e88, 0x84d8, 0x42d8 }, { 0x8a5a, 0x0bde, 0xb7b4 }, { 0x1502, 0x2891, 0x4ce5 },
+                { 0x8b2b, 0x0899, 0x9fba }, { 0x8ce5, 0x01b2, 0x12e4 }, { 0x8db6, 0x8193, 0x2ade }, { 0x8ce5, 0x01b2, 0x12e4 },
+            }
+        },
+        // Mode 3
+        {
+            { 0x62, 0xbe, 0xb0, 0x6c, 0xf4, 0xec, 0x64, 0xc5, 0x66, 0x99, 0x7a, 0x45, 0xd5, 0xe7, 0x6f, 0x2c },
+            {
+                { 0x1e35, 0x1585, 0x2232 }, { 0x1e1f, 0x15d3, 0x21ef }, { 0x1d70, 0x1598, 0x2282 }, { 0x1d70, 0x1598, 0x2282 },
+                { 0x1e2c, 0x15a6, 0x2216 }, { 0x1e35, 0x1585, 0x2232 }, { 0x1e27, 0x15b5, 0x2209 }, { 0x1d67, 0x153f, 0x2232 },
+                { 0x1e1f, 0x15d3, 0x21ef }, { 0x1e2c, 0x15a6, 0x2216 }, { 0x1e1f, 0x15d3, 0x21ef }, { 0x1e1f, 0x15d3, 0x21ef },
+                { 0x1e23, 0x15c4, 0x21fc }, { 0x1e3e, 0x1567, 0x224c }, { 0x1e31, 0x1595, 0x2225 }, { 0x1e39, 0x1576, 0x223f },
+            },
+            {
+                { 0x3c6b, 0x2b0b, 0x4465 }, { 0x3c3e, 0x2ba7, 0x43df }, { 0x3ae0, 0x2b31, 0x4505 }, { 0x3ae0, 0x2b31, 0x4505 },
+                { 0x3c58, 0x2b4c, 0x442d }, { 0x3c6b, 0x2b0b, 0x4465 }, { 0x3c4f, 0x2b6a, 0x4413 }, { 0x3acf, 0x2a7e, 0x4464 },
+                { 0x3c3e, 0x2ba7, 0x43df }, { 0x3c58, 0x2b4c, 0x442d }, { 0x3c3e, 0x2ba7, 0x43df }, { 0x3c3e, 0x2ba7, 0x43df },
+                { 0x3c47, 0x2b89, 0x43f9 }, { 0x3c7c, 0x2ace, 0x4499 }, { 0x3c62, 0x2b2a, 0x444b }, { 0x3c73, 0x2aed, 0x447f },
+            }
+        },
+        {
+            { 0x62, 0x3a, 0x1f, 0xde, 0x55, 0x3f, 0x99, 0xc2, 0x8c, 0xfd, 0x74, 0xa6, 0xec, 0xf7, 0x8f, 0x39 },
+            {
+                { 0x5a64, 0x03b9, 0x2d8b }, { 0x5ae9, 0x035c, 0x2dcd }, { 0x5aa7, 0x038a, 0x2dad }, { 0x5a64, 0x03b9, 0x2d8b },
+                { 0x5abd, 0x037a, 0x2db7 }, { 0x5aa7, 0x038a, 0x2dad }, { 0x5abd, 0x037a, 0x2db7 }, { 0x5a00, 0x03f7, 0x2d04 },
+                { 0x5a8f, 0x039b, 0x2da1 }, { 0x5ae9, 0x035c, 0x2dcd }, { 0x5a00, 0x03f7, 0x2d04 }, { 0x5a63, 0x03d3, 0x2d81 },
+                { 0x5aa7, 0x038a, 0x2dad }, { 0x5a93, 0x03c1, 0x2dbe }, { 0x5a00, 0x03f7, 0x2d04 }, { 0x5aab, 0x03b9, 0x2ddd },
+            },
+            {
+                { 0xc356, 0x0773, 0x5b16 }, { 0xc24c, 0x06b8, 0x5b9b }, { 0xc2cf, 0x0714, 0x5b5a }, { 0xc356, 0x0773, 0x5b16 },
+                { 0xc2a3, 0x06f5, 0x5b6f }, { 0xc2cf, 0x0714, 0x5b5a }, { 0xc2a3, 0x06f5, 0x5b6f }, { 0xc41d, 0x07ee, 0x5a08 },
+                { 0xc2ff, 0x0736, 0x5b42 }, { 0xc24c, 0x06b8, 0x5b9b }, { 0xc41d, 0x07ee, 0x5a08 }, { 0xc357, 0x07a6, 0x5b03 },
+                { 0xc2cf, 0x0714, 0x5b5a }, { 0xc2f7, 0x0783, 0x5b7d }, { 0xc41d, 0x07ee, 0x5a08 }, { 0xc2c8, 0x0772, 0x5bba },
+            }
+        },
+        // Mode 4
+        {
+            { 0xc6, 0x3b, 0xd6, 0xc3, 0x69, 0xb7, 0xab, 0xb5, 0xc1, 0xba, 0x4d, 0xe8, 0xe1, 0x2c, 0x67, 0xfe },
+            {
+                { 0x1ce5, 0x38de, 0x0d86 }, { 0x1cde, 0x38d7, 0x0d7a }, { 0x1cf8, 0x38f1, 0x0da7 }, { 0x1ceb, 0x38e4, 0x0d91 },
+                { 0x1cca, 0x38c3, 0x0d59 }, { 0x1cf2, 0x38eb, 0x0d9c }, { 0x1cde, 0x38d7, 0x0d7a }, { 0x1ce5, 0x38de, 0x0d86 },
+                { 0x1d3b, 0x3854, 0x0d86 }, { 0x1d0e, 0x388a, 0x0d7d }, { 0x1d3b, 0x3854, 0x0d86 }, { 0x1d03, 0x3897, 0x0d7b },
+                { 0x1d19, 0x387d, 0x0d7f }, { 0x1d3b, 0x3854, 0x0d86 }, { 0x1d46, 0x3847, 0x0d88 }, { 0x1d19, 0x387d, 0x0d7f },
+            },
+            {
+                { 0x39ca, 0x71bc, 0x1b0d }, { 0x39bc, 0x71ae, 0x1af5 }, { 0x39f1, 0x71e3, 0x1b4e }, { 0x39d7, 0x71c9, 0x1b22 },
+                { 0x3994, 0x7186, 0x1ab3 }, { 0x39e4, 0x71d6, 0x1b39 }, { 0x39bc, 0x71ae, 0x1af5 }, { 0x39ca, 0x71bc, 0x1b0d },
+                { 0x3a77, 0x70a8, 0x1b0c }, { 0x3a1d, 0x7114, 0x1afa }, { 0x3a77, 0x70a8, 0x1b0c }, { 0x3a07, 0x712e, 0x1af6 },
+                { 0x3a33, 0x70fa, 0x1aff }, { 0x3a77, 0x70a8, 0x1b0c }, { 0x3a8c, 0x708e, 0x1b10 }, { 0x3a33, 0x70fa, 0x1aff },
+            }
+        },
+        {
+            { 0x66, 0x66, 0xba, 0xac, 0x3e, 0x6f, 0x5f, 0xe5, 0x8a, 0x52, 0x6d, 0x5a, 0xeb, 0x9e, 0xde, 0x11 },
+            {
+                { 0x31cc, 0x546d, 0x3395 }, { 0x31fb, 0x544b, 0x336c }, { 0x31dd, 0x5461, 0x3386 }, { 0x31fb, 0x544b, 0x336c },
+                { 0x31bc, 0x5477, 0x33a2 }, { 0x31cc, 0x546d, 0x3395 }, { 0x31ec, 0x5456, 0x3379 }, { 0x31eb, 0x54ab, 0x33c7 },
+                { 0x320a, 0x5440, 0x335f }, { 0x31eb, 0x54e0, 0x3408 }, { 0x31eb, 0x5474, 0x3382 }, { 0x31eb, 0x5440, 0x3340 },
+                { 0x31eb, 0x545a, 0x3361 }, { 0x31eb, 0x54e0, 0x3408 }, { 0x31eb, 0x54c5, 0x33e7 }, { 0x31eb, 0x54fa, 0x3429 },
+            },
+            {
+                { 0x6398, 0xcf44, 0x672b }, { 0x63f7, 0xcf88, 0x66d9 }, { 0x63ba, 0xcf5c, 0x670d }, { 0x63f7, 0xcf88, 0x66d9 },
+                { 0x6379, 0xcf2f, 0x6745 }, { 0x6398, 0xcf44, 0x672b }, { 0x63d8, 0xcf72, 0x66f3 }, { 0x63d7, 0xcec7, 0x678e },
+                { 0x6415, 0xcf9e, 0x66bf }, { 0x63d7, 0xce5e, 0x6811 }, { 0x63d7, 0xcf35, 0x6704 }, { 0x63d7, 0xcf9e, 0x6681 },
+                { 0x63d7, 0xcf6a, 0x66c3 }, { 0x63d7, 0xce5e, 0x6811 }, { 0x63d7, 0xce93, 0x67cf }, { 0x63d7, 0xce2a, 0x6852 },
+            }
+        },
+        // Mode 5
+        {
+            { 0x6a, 0x4a, 0xe6, 0x90, 0x63, 0x62, 0x76, 0x16, 0x3a, 0x7b, 0xa0, 0xae, 0x80, 0x0e, 0x74, 0x09 },
+            {
+                { 0x240e, 0x59e1, 0x59a3 }, { 0x23fc, 0x59ee, 0x59d8 }, { 0x23e1, 0x5a03, 0x5a29 }, { 0x241a, 0x59dd, 0x5983 },
+                { 0x23e1, 0x5a03, 0x5a29 }, { 0x240e, 0x59e1, 0x59a3 }, { 0x23df, 0x59f1, 0x59a3 }, { 0x2406, 0x59e4, 0x598d },
+                { 0x23d0, 0x5a10, 0x5a5d }, { 0x240e, 0x59e1, 0x59a3 }, { 0x23df, 0x59f1, 0x59a3 }, { 0x2444, 0x59cf, 0x596c },
+                { 0x23f4, 0x59f5, 0x59f2 }, { 0x23f3, 0x59ea, 0x5999 }, { 0x23f3, 0x59ea, 0x5999 }, { 0x23df, 0x59f1, 0x59a3 },
+            },
+            {
+                { 0x481c, 0xc45b, 0xc4d7 }, { 0x47f9, 0xc441, 0xc46e }, { 0x47c3, 0xc418, 0xc3cc }, { 0x4835, 0xc463, 0xc518 },
+                { 0x47c3, 0xc418, 0xc3cc }, { 0x481c, 0xc45b, 0xc4d7 }, { 0x47bf, 0xc43c, 0xc4d7 }, { 0x480d, 0xc456, 0xc503 },
+                { 0x47a0, 0xc3fe, 0xc363 }, { 0x481c, 0xc45b, 0xc4d7 }, { 0x47bf, 0xc43c, 0xc4d7 }, { 0x4888, 0xc47f, 0xc546 },
+                { 0x47e8, 0xc433, 0xc43a }, { 0x47e7, 0xc449, 0xc4ec }, { 0x47e7, 0xc449, 0xc4ec }, { 0x47bf, 0xc43c, 0xc4d7 },
+            }
+        },
+        {
+            { 0xca, 0x62, 0x05, 0x6f, 0x76, 0xb6, 0x58, 0x87, 0x3d, 0xab, 0xca, 0xfd, 0x06, 0x35, 0x8c, 0x60 },
+            {
+                { 0x2fd4, 0x1fb8, 0x3219 }, { 0x2fca, 0x1fcf, 0x3259 }, { 0x2fcf, 0x1fc3, 0x3237 }, { 0x2fbd, 0x1ff0, 0x32b5 },
+                { 0x3039, 0x1f55, 0x3103 }, { 0x2fc2, 0x1fe5, 0x3296 }, { 0x2fdc, 0x1fa2, 0x31dc }, { 0x2fca, 0x1fcf, 0x3259 },
+                { 0x2fe0, 0x1f55, 0x3224 }, { 0x3028, 0x1f55, 0x313b }, { 0x2fdc, 0x1fa2, 0x31dc }, { 0x2fc2, 0x1fe5, 0x3296 },
+                { 0x2fbd, 0x1f55, 0x3296 }, { 0x2fcf, 0x1f55, 0x325d }, { 0x2fbd, 0x1f55, 0x3296 }, { 0x2fcf, 0x1fc3, 0x3237 },
+            },
+            {
+                { 0x5fa8, 0x3f71, 0x6432 }, { 0x5f95, 0x3f9f, 0x64b3 }, { 0x5f9f, 0x3f87, 0x646f }, { 0x5f7b, 0x3fe0, 0x656a },
+                { 0x6073, 0x3eaa, 0x6206 }, { 0x5f84, 0x3fcb, 0x652d }, { 0x5fb9, 0x3f45, 0x63b8 }, { 0x5f95, 0x3f9f, 0x64b3 },
+                { 0x5fc1, 0x3eaa, 0x6449 }, { 0x6050, 0x3eaa, 0x6277 }, { 0x5fb9, 0x3f45, 0x63b8 }, { 0x5f84, 0x3fcb, 0x652d },
+                { 0x5f7b, 0x3eaa, 0x652c }, { 0x5f9e, 0x3eaa, 0x64bb }, { 0x5f7b, 0x3eaa, 0x652c }, { 0x5f9f, 0x3f87, 0x646f },
+            }
+        },
+        // Mode 6
+        {
+            { 0xce, 0xa0, 0xe3, 0x6d, 0x18, 0x6d, 0x84, 0x18, 0x2b, 0x3f, 0xcf, 0xd2, 0xd1, 0x69, 0xad, 0x57 },
+            {
+                { 0x3fe1, 0x6e9f, 0x0baa }, { 0x3ffe, 0x6ebc, 0x0b19 }, { 0x4018, 0x6ed6, 0x0a96 }, { 0x3ffe, 0x6ebc, 0x0b19 },
+                { 0x3ec8, 0x6aa5, 0x0fc2 }, { 0x3fad, 0x6e6b, 0x0cb0 }, { 0x3fc7, 0x6e85, 0x0c2d }, { 0x404d, 0x6f0b, 0x0991 },
+                { 0x3ce9, 0x6be5, 0x0f23 }, { 0x4018, 0x6ed6, 0x0a96 }, { 0x4018, 0x6ed6, 0x0a96 }, { 0x4032, 0x6ef0, 0x0a13 },
+                { 0x3d85, 0x6b7c, 0x0f57 }, { 0x3f17, 0x6a71, 0x0fdd }, { 0x4018, 0x6ed6, 0x0a96 }, { 0x3fc7, 0x6e85, 0x0c2d },
+            },
+            {
+                { 0xf8b9, 0x9b3d, 0x1755 }, { 0xf87e, 0x9b02, 0x1632 }, { 0xf84a, 0x9ace, 0x152d }, { 0xf87e, 0x9b02, 0x1632 },
+                { 0xd7f9, 0xa331, 0x1f85 }, { 0xf921, 0x9ba5, 0x1960 }, { 0xf8ed, 0x9b71, 0x185a }, { 0xf7e2, 0x9a66, 0x1322 },
+                { 0x79d2, 0xa0b2, 0x1e46 }, { 0xf84a, 0x9ace, 0x152d }, { 0xf84a, 0x9ace, 0x152d }, { 0xf816, 0x9a9a, 0x1427 },
+                { 0x3529, 0xa183, 0x1eae }, { 0xfa4e, 0xa39a, 0x1fba }, { 0xf84a, 0x9ace, 0x152d }, { 0xf8ed, 0x9b71, 0x185a },
+            }
+        },
+        {
+            { 0x6e, 0xf6, 0x11, 0xa1, 0x2e, 0x8f, 0x6e, 0xbb, 0x50, 0x72, 0x1e, 0x4e, 0x7b, 0x37, 0x7d, 0x85 },
+            {
+                { 0x69fb, 0x075f, 0x5079 }, { 0x6b46, 0x069f, 0x4f2c }, { 0x6b69, 0x066b, 0x4ed5 }, { 0x6a71, 0x07df, 0x5141 },
+                { 0x6a2c, 0x06ea, 0x5018 }, { 0x6a83, 0x0619, 0x4f6a }, { 0x6a93, 0x07aa, 0x50e9 }, { 0x6b00, 0x0707, 0x4fda },
+                { 0x6aaf, 0x05b1, 0x4f13 }, { 0x6a83, 0x0619, 0x4f6a }, { 0x6a2c, 0x06ea, 0x5018 }, { 0x6a93, 0x07aa, 0x50e9 },
+                { 0x6aaf, 0x05b1, 0x4f13 }, { 0x69d0, 0x07c7, 0x50d0 }, { 0x69a4, 0x0830, 0x5127 }, { 0x6a2c, 0x06ea, 0x5018 },
+            },
+            {
+                { 0xa484, 0x0ebe, 0xd789 }, { 0xa1ef, 0x0d3e, 0xda23 }, { 0xa1aa, 0x0cd6, 0xdad2 }, { 0xa39a, 0x0fbe, 0xd5fa },
+                { 0xa423, 0x0dd5, 0xd84a }, { 0xa375, 0x0c33, 0xd9a7 }, { 0xa354, 0x0f55, 0xd6a8 }, { 0xa27b, 0x0e0f, 0xd8c6 },
+                { 0xa31e, 0x0b62, 0xda56 }, { 0xa375, 0x0c33, 0xd9a7 }, { 0xa423, 0x0dd5, 0xd84a }, { 0xa354, 0x0f55, 0xd6a8 },
+                { 0xa31e, 0x0b62, 0xda56 }, { 0xa4db, 0x0f8f, 0xd6da }, { 0xa532, 0x1060, 0xd62c }, { 0xa423, 0x0dd5, 0xd84a },
+            }
+        },
+        // Mode 7
+        {
+            { 0xd2, 0x46, 0xd7, 0x79, 0xa0, 0x8b, 0xa3, 0xa4, 0x08, 0xd4, 0x85, 0x0c, 0x95, 0xd2, 0xec, 0x78 },
+            {
+                { 0x1994, 0x5440, 0x1dea }, { 0x1a66, 0x5486, 0x1d4e }, { 0x1994, 0x5440, 0x1dea }, { 0x17f2, 0x53b4, 0x1f24 },
+                { 0x1c56, 0x4f32, 0x17fa }, { 0x1296, 0x546a, 0x1d32 }, { 0x1885, 0x513d, 0x1a05 }, { 0x1885, 0x513d, 0x1a05 },
+                { 0x1a6d, 0x5037, 0x18ff }, { 0x1296, 0x546a, 0x1d32 }, { 0x1a6d, 0x5037, 0x18ff }, { 0x169d, 0x5242, 0x1b0a },
+                { 0x0ec6, 0x5676, 0x1f3e }, { 0x1c56, 0x4f32, 0x17fa }, { 0x0ec6, 0x5676, 0x1f3e }, { 0x1a6d, 0x5037, 0x18ff },
+            },
+            {
+                { 0x3329, 0xd077, 0x3bd5 }, { 0x34cc, 0xcfec, 0x3a9c }, { 0x3329, 0xd077, 0x3bd5 }, { 0x2fe4, 0xd18e, 0x3e49 },
+                { 0x38ac, 0xda94, 0x2ff4 }, { 0x252d, 0xd022, 0x3a65 }, { 0x310b, 0xd67d, 0x340a }, { 0x310b, 0xd67d, 0x340a },
+                { 0x34db, 0xd888, 0x31ff }, { 0x252d, 0xd022, 0x3a65 }, { 0x34db, 0xd888, 0x31ff }, { 0x2d3a, 0xd472, 0x3615 },
+                { 0x1d8c, 0xcc0c, 0x3e7c }, { 0x38ac, 0xda94, 0x2ff4 }, { 0x1d8c, 0xcc0c, 0x3e7c }, { 0x34db, 0xd888, 0x31ff },
+            }
+        },
+        {
+            { 0x52, 0x69, 0x38, 0x94, 0x8a, 0xae, 0xc9, 0xa1, 0xd5, 0x0f, 0xc1, 0xb1, 0x34, 0xe7, 0x1e, 0xb9 },
+            {
+                { 0x2416, 0x367e, 0x2416 }, { 0x28d8, 0x3a21, 0x24ed }, { 0x278f, 0x3926, 0x24b2 }, { 0x28d8, 0x3a21, 0x24ed },
+                { 0x2a01, 0x3b04, 0x2521 }, { 0x28d8, 0x3a21, 0x24ed }, { 0x2b29, 0x3be7, 0x2555 }, { 0x28d8, 0x3a21, 0x24ed },
+                { 0x278f, 0x3926, 0x24b2 }, { 0x2b29, 0x3be7, 0x2555 }, { 0x2a01, 0x3b04, 0x2521 }, { 0x331a, 0x331a, 0x27f6 },
+                { 0x2416, 0x367e, 0x2416 }, { 0x253e, 0x3760, 0x244a }, { 0x331a, 0x331a, 0x27f6 }, { 0x20a6, 0x37f9, 0x2421 },
+            },
+            {
+                { 0x482c, 0x6cfc, 0x482c }, { 0x51b1, 0x7443, 0x49da }, { 0x4f1e, 0x724c, 0x4965 }, { 0x51b1, 0x7443, 0x49da },
+                { 0x5402, 0x7609, 0x4a42 }, { 0x51b1, 0x7443, 0x49da }, { 0x5653, 0x77ce, 0x4aab }, { 0x51b1, 0x7443, 0x49da },
+                { 0x4f1e, 0x724c, 0x4965 }, { 0x5653, 0x77ce, 0x4aab }, { 0x5402, 0x7609, 0x4a42 }, { 0x6634, 0x6634, 0x4fec },
+                { 0x482c, 0x6cfc, 0x482c }, { 0x4a7c, 0x6ec1, 0x4894 }, { 0x6634, 0x6634, 0x4fec }, { 0x414c, 0x6ff3, 0x4843 },
+            }
+        },
+        // Mode 8
+        {
+            { 0xb6, 0x5e, 0xdf, 0xeb, 0xd9, 0xf9, 0x66, 0x19, 0x21, 0xf3, 0xcf, 0x66, 0xf4, 0x51, 0x53, 0x5b },
+            {
+                { 0x75e4, 0x5a6f, 0x740d }, { 0x7583, 0x59c0, 0x72fe }, { 0x70a9, 0x5c84, 0x744c }, { 0x73a8, 0x60e0, 0x76d1 },
+                { 0x7852, 0x67a8, 0x7abc }, { 0x76ea, 0x5c46, 0x76ea }, { 0x752c, 0x5923, 0x720a }, { 0x79d2, 0x69d6, 0x7bff },
+                { 0x70a9, 0x5c84, 0x744c }, { 0x763b, 0x5b0c, 0x7501 }, { 0x752c, 0x5923, 0x720a }, { 0x70a9, 0x5c84, 0x744c },
+                { 0x76d2, 0x657a, 0x797a }, { 0x7852, 0x67a8, 0x7abc }, { 0x74d5, 0x5886, 0x7116 }, { 0x763b, 0x5b0c, 0x7501 },
+            },
+            {
+                { 0x8d2f, 0xc419, 0x90dc }, { 0x8df0, 0xc576, 0x92fb }, { 0x97a4, 0xbff0, 0x9070 }, { 0x91a6, 0xb738, 0x8b88 },
+                { 0x8853, 0xa9a8, 0x83e7 }, { 0x8b24, 0xc06c, 0x8b24 }, { 0x8e9f, 0xc6b0, 0x94e3 }, { 0x8554, 0xa54c, 0x8174 },
+                { 0x97a4, 0xbff0, 0x9070 }, { 0x8c80, 0xc2df, 0x8ef4 }, { 0x8e9f, 0xc6b0, 0x94e3 }, { 0x97a4, 0xbff0, 0x9070 },
+                { 0x8b52, 0xae04, 0x865b }, { 0x8853, 0xa9a8, 0x83e7 }, { 0x8f4d, 0xc7ea, 0x96cb }, { 0x8c80, 0xc2df, 0x8ef4 },
+            }
+        },
+        {
+            { 0xb6, 0x9d, 0xf3, 0x38, 0x4a, 0x4b, 0x2b, 0xa9, 0xc4, 0x9f, 0x44, 0x19, 0x8d, 0xcf, 0x10, 0x16 },
+            {
+                { 0x73a6, 0x6077, 0x0cd9 }, { 0x758f, 0x2fb9, 0x09e2 }, { 0x7443, 0x50cc, 0x0be5 }, { 0x76c9, 0x1064, 0x07fa },
+                { 0x730a, 0x7022, 0x0dce }, { 0x762c, 0x200f, 0x08ee }, { 0x73a6, 0x6077, 0x0cd9 }, { 0x72c2, 0x69b7, 0x1323 },
+                { 0x7766, 0x00ba, 0x0706 }, { 0x758f, 0x2fb9, 0x09e2 }, { 0x73a6, 0x6077, 0x0cd9 }, { 0x732a, 0x6789, 0x122f },
+                { 0x730a, 0x7022, 0x0dce }, { 0x76c9, 0x1064, 0x07fa }, { 0x7399, 0x653c, 0x112e }, { 0x7402, 0x630e, 0x103a },
+            },
+            {
+                { 0x91aa, 0x9506, 0x19b3 }, { 0x8dd9, 0x8994, 0x13c4 }, { 0x9070, 0x9158, 0x17cb }, { 0x8b65, 0x8239, 0x0ff4 },
+                { 0x92e4, 0x98b4, 0x1b9c }, { 0x8c9f, 0x85e7, 0x11dc }, { 0x91aa, 0x9506, 0x19b3 }, { 0x9373, 0xa58a, 0x2647 },
+                { 0x8a2c, 0x0174, 0x0e0c }, { 0x8dd9, 0x8994, 0x13c4 }, { 0x91aa, 0x9506, 0x19b3 }, { 0x92a2, 0xa9e6, 0x245f },
+                { 0x92e4, 0x98b4, 0x1b9c }, { 0x8b65, 0x8239, 0x0ff4 }, { 0x91c5, 0xae80, 0x225c }, { 0x90f4, 0xb2dc, 0x2074 },
+            }
+        },
+        // Mode 9
+        {
+            { 0x7a, 0x17, 0x33, 0x36, 0x35, 0x6d, 0xd2, 0x61, 0x69, 0xa5, 0xe5, 0x5d, 0x8d, 0x2a, 0xea, 0xbe },
+            {
+                { 0x5b3a, 0x30c3, 0x4b86 }, { 0x5d51, 0x2c3c, 0x4c91 }, { 0x5c0b, 0x2efd, 0x4bee }, { 0x5dba, 0x2b5a, 0x4cc6 },
+                { 0x5ba3, 0x2fe0, 0x4bba }, { 0x5ce8, 0x2d1f, 0x4c5d }, { 0x5b3a, 0x30c3, 0x4b86 }, { 0x5ba3, 0x2fe0, 0x4bba },
+                { 0x5caa, 0x3060, 0x53c8 }, { 0x5801, 0x32eb, 0x51df }, { 0x5b2b, 0x3131, 0x532b }, { 0x5801, 0x32eb, 0x51df },
+                { 0x5faa, 0x2ebe, 0x5502 }, { 0x5e2a, 0x2f8f, 0x5465 }, { 0x5faa, 0x2ebe, 0x5502 }, { 0x5801, 0x32eb, 0x51df },
+            },
+            {
+                { 0xc282, 0x6186, 0xe1eb }, { 0xbe55, 0x5879, 0xdfd4 }, { 0xc0e0, 0x5dfb, 0xe11a }, { 0xbd84, 0x56b4, 0xdf6c },
+                { 0xc1b1, 0x5fc1, 0xe182 }, { 0xbf26, 0x5a3e, 0xe03d }, { 0xc282, 0x6186, 0xe1eb }, { 0xc1b1, 0x5fc1, 0xe182 },
+                { 0xbfa2, 0x60c1, 0xd167 }, { 0xc8f5, 0x65d7, 0xd538 }, { 0xc2a1, 0x6263, 0xd2a1 }, { 0xc8f5, 0x65d7, 0xd538 },
+                { 0xb9a4, 0x5d7c, 0xcef4 }, { 0xbca3, 0x5f1e, 0xd02d }, { 0xb9a4, 0x5d7c, 0xcef4 }, { 0xc8f5, 0x65d7, 0xd538 },
+            }
+        },
+        {
+            { 0x7a, 0xb2, 0xab, 0x14, 0xd7, 0x05, 0xe6, 0x26, 0x0f, 0xf4, 0x18, 0xda, 0x00, 0x97, 0x7b, 0xe3 },
+            {
+                { 0x46a0, 0x2834, 0x44db }, { 0x4709, 0x294b, 0x43f8 }, { 0x45c3, 0x25e7, 0x46b9 }, { 0x44f2, 0x23b9, 0x487f },
+                { 0x44f2, 0x23b9, 0x487f }, { 0x4772, 0x2a62, 0x4316 }, { 0x4772, 0x2a62, 0x4316 }, { 0x4b1d, 0x29ab, 0x3cfc },
+                { 0x4638, 0x271d, 0x45be }, { 0x4709, 0x294b, 0x43f8 }, { 0x4b52, 0x2872, 0x40aa }, { 0x4b40, 0x28da, 0x3f70 },
+                { 0x4638, 0x271d, 0x45be }, { 0x4b0a, 0x2a20, 0x3b9f }, { 0x4b1d, 0x29ab, 0x3cfc }, { 0x4b0a, 0x2a20, 0x3b9f },
+            },
+            {
+                { 0xebb6, 0x5068, 0xef41 }, { 0xeae5, 0x5296, 0xf106 }, { 0xed70, 0x4bce, 0xeb84 }, { 0xef12, 0x4772, 0xe7f9 },
+                { 0xef12, 0x4772, 0xe7f9 }, { 0xea14, 0x54c4, 0xf2cc }, { 0xea14, 0x54c4, 0xf2cc }, { 0xe2bc, 0x5357, 0x95f6 },
+                { 0xec87, 0x4e3a, 0xed7b }, { 0xeae5, 0x5296, 0xf106 }, { 0xe254, 0x50e4, 0xf7a4 }, { 0xe276, 0x51b5, 0xd714 },
+                { 0xec87, 0x4e3a, 0xed7b }, { 0xe2e3, 0x5440, 0x0e36 }, { 0xe2bc, 0x5357, 0x95f6 }, { 0xe2e3, 0x5440, 0x0e36 },
+            }
+        },
+        // Mode 10
+        {
+            { 0x7e, 0x42, 0x5f, 0x7b, 0xd4, 0x20, 0x91, 0xb8, 0xdf, 0x5d, 0x82, 0x3a, 0x55, 0x64, 0xc8, 0x56 },
+            {
+                { 0x25c8, 0x7918, 0x7728 }, { 0x25c8, 0x7918, 0x7728 }, { 0x2f87, 0x2f49, 0x6672 }, { 0x316f, 0x20d8, 0x632d },
+                { 0x27b0, 0x6aa7, 0x73e3 }, { 0x2f87, 0x2f49, 0x6672 }, { 0x2998, 0x5c36, 0x709e }, { 0x27b0, 0x6aa7, 0x73e3 },
+                { 0x6292, 0x1857, 0x5ea2 }, { 0x2d9f, 0x3dba, 0x69b7 }, { 0x27b0, 0x6aa7, 0x73e3 }, { 0x2d9f, 0x3dba, 0x69b7 },
+                { 0x6979, 0x1049, 0x44c0 }, { 0x6cbe, 0x0c79, 0x387d }, { 0x6cbe, 0x0c79, 0x387d }, { 0x2998, 0x5c36, 0x709e },
+            },
+            {
+                { 0x4b90, 0x89b0, 0x8d90 }, { 0x4b90, 0x89b0, 0x8d90 }, { 0x5f0f, 0x17bc, 0xaefc }, { 0x62df, 0x1e46, 0xb586 },
+                { 0x4f60, 0x8326, 0x941a }, { 0x5f0f, 0x17bc, 0xaefc }, { 0x5331, 0x0364, 0x9aa4 }, { 0x4f60, 0x8326, 0x941a },
+                { 0xb6bc, 0x30ae, 0x083c }, { 0x5b3e, 0x1132, 0xa872 }, { 0x4f60, 0x8326, 0x941a }, { 0x5b3e, 0x1132, 0xa872 },
+                { 0xa8ee, 0x2093, 0x1f3e }, { 0xa264, 0x18f2, 0x2a24 }, { 0xa264, 0x18f2, 0x2a24 }, { 0x5331, 0x0364, 0x9aa4 },
+            }
+        },
+        {
+            { 0x5e, 0x29, 0x23, 0x67, 0x7e, 0x18, 0xf7, 0x69, 0x5c, 0x42, 0xb7, 0x1b, 0xea, 0x92, 0x26, 0x8e },
+            {
+                { 0x15b4, 0x1a37, 0x5b10 }, { 0x37c3, 0x5cb2, 0x2d32 }, { 0x37c3, 0x5cb2, 0x2d32 }, { 0x1b4e, 0x5239, 0x3738 },
+                { 0x15b4, 0x1a37, 0x5b10 }, { 0x2b0c, 0x539d, 0x3b6d }, { 0x4335, 0x64df, 0x2064 }, { 0x1e08, 0x6d78, 0x25c8 },
+                { 0x1711, 0x27d7, 0x5258 }, { 0x4335, 0x64df, 0x2064 }, { 0x4335, 0x64df, 0x2064 }, { 0x186e, 0x3576, 0x49a0 },
+                { 0x1711, 0x27d7, 0x5258 }, { 0x2b0c, 0x539d, 0x3b6d }, { 0x37c3, 0x5cb2, 0x2d32 }, { 0x19f1, 0x4499, 0x3ff0 },
+            },
+            {
+                { 0x2b69, 0x1103, 0xa254 }, { 0xa216, 0x27c7, 0x8fdd }, { 0xa216, 0x27c7, 0x8fdd }, { 0x369d, 0x9097, 0x2799 },
+                { 0x2b69, 0x1103, 0xa254 }, { 0x9429, 0x3cf8, 0x9ac3 }, { 0xae9f, 0x14b5, 0x860e }, { 0x3c10, 0xa0f0, 0x4b90 },
+                { 0x2e23, 0x08d7, 0x9059 }, { 0xae9f, 0x14b5, 0x860e }, { 0xae9f, 0x14b5, 0x860e }, { 0x30dc, 0x00aa, 0x01a2 },
+                { 0x2e23, 0x08d7, 0x9059 }, { 0x9429, 0x3cf8, 0x9ac3 }, { 0xa216, 0x27c7, 0x8fdd }, { 0x33e3, 0x886a, 0x159d },
+            }
+        },
+        // Mode 11
+        {
+            { 0x03, 0xd8, 0xf4, 0x19, 0x18, 0x61, 0xaa, 0xf9, 0x75, 0x0d, 0xca, 0xe6, 0x30, 0xe2, 0x34, 0xb0 },
+            {
+                { 0x49eb, 0x6e00, 0x1286 }, { 0x2f56, 0x53b2, 0x3a38 }, { 0x0fb0, 0x3462, 0x6979 }, { 0x554f, 0x7946, 0x0183 },
+                { 0x1ee1, 0x436a, 0x52ca }, { 0x14c1, 0x3965, 0x61e9 }, { 0x3466, 0x58b5, 0x32a8 }, { 0x095c, 0x2e1f, 0x72ec },
+                { 0x554f, 0x7946, 0x0183 }, { 0x44da, 0x68fd, 0x1a16 }, { 0x49eb, 0x6e00, 0x1286 }, { 0x095c, 0x2e1f, 0x72ec },
+                { 0x3fca, 0x63fb, 0x21a5 }, { 0x44da, 0x68fd, 0x1a16 }, { 0x554f, 0x7946, 0x0183 }, { 0x19d1, 0x3e67, 0x5a5a },
+            },
+            {
+                { 0xc17f, 0x06ab, 0x0224 }, { 0xa534, 0x2384, 0x0013 }, { 0x8386, 0x45dc, 0x8262 }, { 0xcd9f, 0x85b1, 0x0307 },
+                { 0x93b1, 0x3560, 0x8134 }, { 0x88ea, 0x405d, 0x81fd }, { 0xaa98, 0x1e06, 0x0078 }, { 0x0335, 0x4cba, 0x82e0 },
+                { 0xcd9f, 0x85b1, 0x0307 }, { 0xbc1b, 0x0c2a, 0x01bf }, { 0xc17f, 0x06ab, 0x0224 }, { 0x0335, 0x4cba, 0x82e0 },
+                { 0xb6b8, 0x11a9, 0x015a }, { 0xbc1b, 0x0c2a, 0x01bf }, { 0xcd9f, 0x85b1, 0x0307 }, { 0x8e4d, 0x3ade, 0x8198 },
+            }
+        },
+        {
+            { 0x43, 0xf3, 0x8c, 0xdb, 0x22, 0xbb, 0xcf, 0x5f, 0xb1, 0xaa, 0x55, 0xd0, 0x15, 0xad, 0xe9, 0xe8 },
+            {
+                { 0x6fb5, 0x6016, 0x2c42 }, { 0x6ae8, 0x5237, 0x4a51 }, { 0x6b50, 0x5365, 0x47c2 }, { 0x6b50, 0x5365, 0x47c2 },
+                { 0x6d90, 0x59e3, 0x39b0 }, { 0x6d90, 0x59e3, 0x39b0 }, { 0x6fb5, 0x6016, 0x2c42 }, { 0x6a16, 0x4fda, 0x4f6f },
+                { 0x6d90, 0x59e3, 0x39b0 }, { 0x6f4c, 0x5ee8, 0x2ed1 }, { 0x6a16, 0x4fda, 0x4f6f }, { 0x6b50, 0x5365, 0x47c2 },
+                { 0x6bd3, 0x54df, 0x448f }, { 0x6994, 0x4e60, 0x52a1 }, { 0x6c3c, 0x560d, 0x4200 }, { 0x6994, 0x4e60, 0x52a1 },
+            },
+            {
+                { 0x98d3, 0xb811, 0x5885 }, { 0xa26d, 0xd3cf, 0xa1aa }, { 0xa19c, 0xd173, 0x9744 }, { 0xa19c, 0xd173, 0x9744 },
+                { 0x9d1d, 0xc476, 0x21ec }, { 0x9d1d, 0xc476, 0x21ec }, { 0x98d3, 0xb811, 0x5885 }, { 0xa410, 0xd888, 0xb677 },
+                { 0x9d1d, 0xc476, 0x21ec }, { 0x99a4, 0xba6d, 0x4e1e }, { 0xa410, 0xd888, 0xb677 }, { 0xa19c, 0xd173, 0x9744 },
+                { 0xa096, 0xce7f, 0x8a45 }, { 0xa515, 0xdb7c, 0xc376 }, { 0x9fc5, 0xcc23, 0x0020 }, { 0xa515, 0xdb7c, 0xc376 },
+            }
+        },
+        // Mode 12
+        {
+            { 0x27, 0x0f, 0x7f, 0xa4, 0xe0, 0x8d, 0x4b, 0xd2, 0x98, 0x0c, 0xc6, 0x5a, 0x5d, 0x5f, 0x29, 0xd9 },
+            {
+                { 0x0643, 0x4ee3, 0x2473 }, { 0x04e9, 0x50b7, 0x4b50 }, { 0x0413, 0x51d9, 0x635e }, { 0x075b, 0x4d68, 0x04fe },
+                { 0x05af, 0x4fac, 0x351b }, { 0x0413, 0x51d9, 0x635e }, { 0x0497, 0x5126, 0x5490 }, { 0x0601, 0x4f3c, 0x2bda },
+                { 0x03d1, 0x5232, 0x6ac5 }, { 0x0601, 0x4f3c, 0x2bda }, { 0x033d, 0x52fa, 0x7b6c }, { 0x0601, 0x4f3c, 0x2bda },
+                { 0x04e9, 0x50b7, 0x4b50 }, { 0x06c7, 0x4e31, 0x15a6 }, { 0x04e9, 0x50b7, 0x4b50 }, { 0x03d1, 0x5232, 0x6ac5 },
+            },
+            {
+                { 0x0c86, 0xda57, 0x0700 }, { 0x09d2, 0xd6b0, 0x034d }, { 0x0826, 0xd46c, 0x0104 }, { 0x0eb6, 0xdd4d, 0x09fd },
+                { 0x0b5e, 0xd8c6, 0x056a }, { 0x0826, 0xd46c, 0x0104 }, { 0x092e, 0xd5d1, 0x026c }, { 0x0c02, 0xd9a5, 0x064c },
+                { 0x07a2, 0xd3ba, 0x0050 }, { 0x0c02, 0xd9a5, 0x064c }, { 0x067a, 0xd229, 0x8145 }, { 0x0c02, 0xd9a5, 0x064c },
+                { 0x09d2, 0xd6b0, 0x034d }, { 0x0d8e, 0xdbbc, 0x0868 }, { 0x09d2, 0xd6b0, 0x034d }, { 0x07a2, 0xd3ba, 0x0050 },
+            }
+        },
+        {
+            { 0x27, 0x47, 0xbd, 0xbc, 0x75, 0xf0, 0x6b, 0x90, 0xea, 0xd8, 0x75, 0x39, 0xfc, 0x82, 0x23, 0xd5 },
+            {
+                { 0x60c2, 0x51b8, 0x2805 }, { 0x6146, 0x4bc7, 0x1fc1 }, { 0x60ee, 0x4fbd, 0x2544 }, { 0x6135, 0x4c8a, 0x20d1 },
+                { 0x60c2, 0x51b8, 0x2805 }, { 0x60e0, 0x5058, 0x261d }, { 0x60fc, 0x4f21, 0x246b }, { 0x60a7, 0x52f0, 0x29b7 },
+                { 0x6128, 0x4d26, 0x21aa }, { 0x6154, 0x4b2b, 0x1ee8 }, { 0x6099, 0x538c, 0x2a90 }, { 0x60ee, 0x4fbd, 0x2544 },
+                { 0x60a7, 0x52f0, 0x29b7 }, { 0x6099, 0x538c, 0x2a90 }, { 0x60c2, 0x51b8, 0x2805 }, { 0x6135, 0x4c8a, 0x20d1 },
+            },
+            {
+                { 0xb69a, 0xd4ae, 0x500b }, { 0xb591, 0xe090, 0x3f83 }, { 0xb641, 0xd8a4, 0x4a88 }, { 0xb5b3, 0xdf0a, 0x41a2 },
+                { 0xb69a, 0xd4ae, 0x500b }, { 0xb65d, 0xd76d, 0x4c3a }, { 0xb626, 0xd9dc, 0x48d6 }, { 0xb6d0, 0xd23e, 0x536f },
+                { 0xb5ce, 0xddd2, 0x4354 }, { 0xb576, 0xe1c8, 0x3dd1 }, { 0xb6eb, 0xd106, 0x5521 }, { 0xb641, 0xd8a4, 0x4a88 },
+                { 0xb6d0, 0xd23e, 0x536f }, { 0xb6eb, 0xd106, 0x5521 }, { 0xb69a, 0xd4ae, 0x500b }, { 0xb5b3, 0xdf0a, 0x41a2 },
+            }
+        },
+        // Mode 13
+        {
+            { 0xab, 0x06, 0x0a, 0x30, 0xd2, 0x88, 0x57, 0x14, 0xce, 0x9d, 0x56, 0xb4, 0xe8, 0x9a, 0x1d, 0xc7 },
+            {
+                { 0x3ffd, 0x1ea7, 0x090f }, { 0x403f, 0x1dfa, 0x0974 }, { 0x404c, 0x1dd9, 0x0988 }, { 0x4016, 0x1e65, 0x0935 },
+                { 0x3ff0, 0x1ec8, 0x08fb }, { 0x3fe0, 0x1ef1, 0x08e3 }, { 0x3fd4, 0x1f12, 0x08d0 }, { 0x4032, 0x1e1b, 0x0961 },
+                { 0x4009, 0x1e86, 0x0922 }, { 0x405b, 0x1db0, 0x09a0 }, { 0x4026, 0x1e3c, 0x094e }, { 0x4016, 0x1e65, 0x0935 },
+                { 0x404c, 0x1dd9, 0x0988 }, { 0x3fab, 0x1f7d, 0x0891 }, { 0x3ffd, 0x1ea7, 0x090f }, { 0x403f, 0x1dfa, 0x0974 },
+            },
+            {
+                { 0xf815, 0x3d4f, 0x121e }, { 0xf790, 0x3bf5, 0x12e9 }, { 0xf777, 0x3bb3, 0x1310 }, { 0xf7e2, 0x3ccb, 0x126b },
+                { 0xf82e, 0x3d91, 0x11f7 }, { 0xf84d, 0x3de3, 0x11c7 }, { 0xf866, 0x3e25, 0x11a0 }, { 0xf7a9, 0x3c37, 0x12c3 },
+                { 0xf7fc, 0x3d0d, 0x1245 }, { 0xf758, 0x3b61, 0x1341 }, { 0xf7c3, 0x3c79, 0x129c }, { 0xf7e2, 0x3ccb, 0x126b },
+                { 0xf777, 0x3bb3, 0x1310 }, { 0xf8b9, 0x3efb, 0x1122 }, { 0xf815, 0x3d4f, 0x121e }, { 0xf790, 0x3bf5, 0x12e9 },
+            }
+        },
+        {
+            { 0xcb, 0x86, 0xe4, 0x04, 0x0b, 0x24, 0xae, 0x37, 0x16, 0x33, 0x31, 0xc4, 0x80, 0x4c, 0xb2, 0x0a },
+            {
+                { 0x1a0e, 0x4c8b, 0x0c62 }, { 0x0928, 0x4c10, 0x0be9 }, { 0x1a0e, 0x4c8b, 0x0c62 }, { 0x1a0e, 0x4c8b, 0x0c62 },
+                { 0x0928, 0x4c10, 0x0be9 }, { 0x1a0e, 0x4c8b, 0x0c62 }, { 0x2190, 0x4cc2, 0x0c98 }, { 0x6166, 0x4e93, 0x0e60 },
+                { 0x01a6, 0x4bd9, 0x0bb3 }, { 0x417b, 0x4dab, 0x0d7c }, { 0x6166, 0x4e93, 0x0e60 }, { 0x2190, 0x4cc2, 0x0c98 },
+                { 0x128b, 0x4c54, 0x0c2c }, { 0x59e3, 0x4e5c, 0x0e2b }, { 0x5261, 0x4e26, 0x0df5 }, { 0x01a6, 0x4bd9, 0x0bb3 },
+            },
+            {
+                { 0x01b9, 0xdef8, 0x18c4 }, { 0x02d0, 0xdfee, 0x17d2 }, { 0x01b9, 0xdef8, 0x18c4 }, { 0x01b9, 0xdef8, 0x18c4 },
+                { 0x02d0, 0xdfee, 0x17d2 }, { 0x01b9, 0xdef8, 0x18c4 }, { 0x013d, 0xde8b, 0x1930 }, { 0x82e0, 0xdae8, 0x1cc1 },
+                { 0x034c, 0xe05c, 0x1766 }, { 0x80d1, 0xdcb9, 0x1af9 }, { 0x82e0, 0xdae8, 0x1cc1 }, { 0x013d, 0xde8b, 0x1930 },
+                { 0x0235, 0xdf66, 0x1858 }, { 0x8264, 0xdb55, 0x1c56 }, { 0x81e8, 0xdbc3, 0x1bea }, { 0x034c, 0xe05c, 0x1766 },
+            }
+        },
+        // Mode 14
+        {
+            { 0xcf, 0x14, 0xc9, 0x94, 0xda, 0xc9, 0xaa, 0x3c, 0x5e, 0xdc, 0x77, 0x8b, 0xd1, 0x34, 0xa4, 0x7c },
+            {
+                { 0x612f, 0x5224, 0x6d1e }, { 0x612f, 0x5223, 0x6d1e }, { 0x612e, 0x5225, 0x6d1c }, { 0x612e, 0x5225, 0x6d1c },
+                { 0x612f, 0x5224, 0x6d1e }, { 0x612f, 0x5224, 0x6d1e }, { 0x612e, 0x5224, 0x6d1d }, { 0x612e, 0x5224, 0x6d1d },
+                { 0x6130, 0x5222, 0x6d1f }, { 0x612e, 0x5225, 0x6d1c }, { 0x612f, 0x5223, 0x6d1e }, { 0x612f, 0x5223, 0x6d1f },
+                { 0x612f, 0x5223, 0x6d1e }, { 0x612e, 0x5224, 0x6d1d }, { 0x612e, 0x5225, 0x6d1c }, { 0x612f, 0x5224, 0x6d1e },
+            },
+            {
+                { 0xb5a1, 0xd3b7, 0x9dc3 }, { 0xb5a1, 0xd3b8, 0x9dc2 }, { 0xb5a3, 0xd3b5, 0x9dc6 }, { 0xb5a3, 0xd3b5, 0x9dc6 },
+                { 0xb5a1, 0xd3b7, 0x9dc3 }, { 0xb5a1, 0xd3b7, 0x9dc3 }, { 0xb5a3, 0xd3b6, 0x9dc5 }, { 0xb5a2, 0xd3b7, 0x9dc4 },
+                { 0xb59f, 0xd3ba, 0x9dc0 }, { 0xb5a3, 0xd3b5, 0x9dc6 }, { 0xb5a0, 0xd3b8, 0x9dc2 }, { 0xb5a0, 0xd3b9, 0x9dc1 },
+                { 0xb5a0, 0xd3b8, 0x9dc2 }, { 0xb5a2, 0xd3b6, 0x9dc5 }, { 0xb5a3, 0xd3b5, 0x9dc6 }, { 0xb5a1, 0xd3b7, 0x9dc3 },
+            }
+        },
+        {
+            { 0x4f, 0x62, 0xfe, 0x7e, 0x73, 0x98, 0x29, 0xe6, 0xdc, 0xf8, 0xd6, 0xd0, 0x67, 0xbe, 0x92, 0x91 },
+            {
+                { 0x074c, 0x1455, 0x1bf7 }, { 0x074b, 0x1454, 0x1bf7 }, { 0x074c, 0x1455, 0x1bf7 }, { 0x074b, 0x1454, 0x1bf6 },
+                { 0x074c, 0x1455, 0x1bf7 }, { 0x074b, 0x1454, 0x1bf7 }, { 0x074c, 0x1456, 0x1bf8 }, { 0x074b, 0x1454, 0x1bf7 },
+                { 0x074c, 0x1455, 0x1bf7 }, { 0x074c, 0x1455, 0x1bf7 }, { 0x074b, 0x1454, 0x1bf6 }, { 0x074c, 0x1454, 0x1bf7 },
+                { 0x074c, 0x1455, 0x1bf8 }, { 0x074c, 0x1455, 0x1bf7 }, { 0x074c, 0x1456, 0x1bf8 }, { 0x074c, 0x1455, 0x1bf7 },
+            },
+            {
+                { 0x0e98, 0x28aa, 0x37ef }, { 0x0e97, 0x28a9, 0x37ee }, { 0x0e98, 0x28aa, 0x37ef }, { 0x0e97, 0x28a8, 0x37ed },
+                { 0x0e98, 0x28aa, 0x37ef }, { 0x0e97, 0x28a9, 0x37ee }, { 0x0e99, 0x28ac, 0x37f1 }, { 0x0e97, 0x28a9, 0x37ee },
+                { 0x0e98, 0x28aa, 0x37ef }, { 0x0e98, 0x28aa, 0x37ef }, { 0x0e97, 0x28a8, 0x37ed }, { 0x0e98, 0x28a9, 0x37ee },
+                { 0x0e99, 0x28ab, 0x37f0 }, { 0x0e98, 0x28aa, 0x37ef }, { 0x0e99, 0x28ac, 0x37f1 }, { 0x0e98, 0x28aa, 0x37ef },
+            }
+        },
+    };
+
+    const GoldenBlockRGBA8 BC1Blocks[] = {
+        // c0 > c1
+        {
+            { 0xa7, 0x74, 0xa7, 0x72, 0xaa, 0x64, 0x76, 0xd2 },
+            {
+                { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x80, 0x39, 0xff },
+                { 0x73, 0x96, 0x39, 0xff }, { 0x73, 0x55, 0x39, 0xff }, { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x55, 0x39, 0xff },
+                { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x55, 0x39, 0xff }, { 0x73, 0x6a, 0x39, 0xff }, { 0x73, 0x55, 0x39, 0xff },
+                { 0x73, 0x80, 0x39, 0xff }, { 0x73, 0x96, 0x39, 0xff }, { 0x73, 0x55, 0x39, 0xff }, { 0x73, 0x6a, 0x39, 0xff },
+            }
+        },
+        {
+            { 0x81, 0xdf, 0x88, 0x25, 0x7d, 0x02, 0x2d, 0xff },
+            {
+                { 0x21, 0xb2, 0x42, 0xff }, { 0x60, 0xc7, 0x2e, 0xff }, { 0x60, 0xc7, 0x2e, 0xff }, { 0x21, 0xb2, 0x42, 0xff },
+                { 0x9f, 0xdd, 0x1b, 0xff }, { 0xde, 0xf3, 0x08, 0xff }, { 0xde, 0xf3, 0x08, 0xff }, { 0xde, 0xf3, 0x08, 0xff },
+                { 0x21, 0xb2, 0x42, 0xff }, { 0x60, 0xc7, 0x2e, 0xff }, { 0x9f, 0xdd, 0x1b, 0xff }, { 0xde, 0xf3, 0x08, 0xff },
+                { 0x60, 0xc7, 0x2e, 0xff }, { 0x60, 0xc7, 0x2e, 0xff }, { 0x60, 0xc7, 0x2e, 0xff }, { 0x60, 0xc7, 0x2e, 0xff },
+            }
+        },
+        // c0 <= c1
+        {
+            { 0x3d, 0x93, 0xbe, 0xcd, 0xed, 0xcf, 0x05, 0x2a },
+            {
+                { 0xce, 0xb6, 0xf7, 0xff }, { 0x00, 0x00, 0x00, 0x00 }, { 0xb1, 0x8e, 0xf3, 0xff }, { 0x00, 0x00, 0x00, 0x00 },
+                { 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x00, 0x00 }, { 0x94, 0x65, 0xef, 0xff }, { 0x00, 0x00, 0x00, 0x00 },
+                { 0xce, 0xb6, 0xf7, 0xff }, { 0xce, 0xb6, 0xf7, 0xff }, { 0x94, 0x65, 0xef, 0xff }, { 0x94, 0x65, 0xef, 0xff },
+                { 0xb1, 0x8e, 0xf3, 0xff }, { 0xb1, 0x8e, 0xf3, 0xff }, { 0xb1, 0x8e, 0xf3, 0xff }, { 0x94, 0x65, 0xef, 0xff },
+            }
+        },
+        {
+            { 0x01, 0x3f, 0xbc, 0xdf, 0x35, 0xf1, 0x4a, 0xa9 },
+            {
+                { 0xde, 0xf7, 0xe7, 0xff }, { 0xde, 0xf7, 0xe7, 0xff }, { 0x00, 0x00, 0x00, 0x00 }, { 0x39, 0xe3, 0x08, 0xff },
+                { 0xde, 0xf7, 0xe7, 0xff }, { 0x39, 0xe3, 0x08, 0xff }, { 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x00, 0x00 },
+                { 0x8c, 0xed, 0x78, 0xff }, { 0x8c, 0xed, 0x78, 0xff }, { 0x39, 0xe3, 0x08, 0xff }, { 0xde, 0xf7, 0xe7, 0xff },
+                { 0xde, 0xf7, 0xe7, 0xff }, { 0x8c, 0xed, 0x78, 0xff }, { 0x8c, 0xed, 0x78, 0xff }, { 0x8c, 0xed, 0x78, 0xff },
+            }
+        },
+    };
+
+    const GoldenBlockRGBA8 BC2Blocks[] = {
+        {
+            { 0x46, 0x81, 0xf6, 0xdd, 0xad, 0x77, 0xd8, 0x48, 0x76, 0xb2, 0xc0, 0x97, 0x2b, 0x4c, 0x69, 0x2b },
+            {
+                { 0x9f, 0xc0, 0x3c, 0x66 }, { 0xaa, 0x86, 0x78, 0x44 }, { 0xaa, 0x86, 0x78, 0x11 }, { 0xb5, 0x4d, 0xb5, 0x88 },
+                { 0xb5, 0x4d, 0xb5, 0x66 }, { 0x9f, 0xc0, 0x3c, 0xff }, { 0xb5, 0x4d, 0xb5, 0xdd }, { 0x94, 0xfb, 0x00, 0xdd },
+                { 0x94, 0xfb, 0x00, 0xdd }, { 0xaa, 0x86, 0x78, 0xaa }, { 0xaa, 0x86, 0x78, 0x77 }, { 0x94, 0xfb, 0x00, 0x77 },
+                { 0x9f, 0xc0, 0x3c, 0x88 }, { 0xaa, 0x86, 0x78, 0xdd }, { 0xaa, 0x86, 0x78, 0x88 }, { 0xb5, 0x4d, 0xb5, 0x44 },
+            }
+        },
+        {
+            { 0x4c, 0x0a, 0xd2, 0x2a, 0x65, 0x8f, 0x6c, 0xc9, 0xba, 0x1a, 0x9d, 0x7c, 0xcc, 0x77, 0x60, 0xcc },
+            {
+                { 0x18, 0x55, 0xd6, 0xcc }, { 0x59, 0x7d, 0xe6, 0x44 }, { 0x18, 0x55, 0xd6, 0xaa }, { 0x59, 0x7d, 0xe6, 0x00 },
+                { 0x59, 0x7d, 0xe6, 0x22 }, { 0x7b, 0x92, 0xef, 0xdd }, { 0x59, 0x7d, 0xe6, 0xaa }, { 0x7b, 0x92, 0xef, 0x22 },
+                { 0x18, 0x55, 0xd6, 0x55 }, { 0x18, 0x55, 0xd6, 0x66 }, { 0x38, 0x69, 0xde, 0xff }, { 0x7b, 0x92, 0xef, 0x88 },
+                { 0x18, 0x55, 0xd6, 0xcc }, { 0x59, 0x7d, 0xe6, 0x66 }, { 0x18, 0x55, 0xd6, 0x99 }, { 0x59, 0x7d, 0xe6, 0xcc },
+            }
+        },
+    };
+
+    const GoldenBlockRGBA8 BC3Blocks[] = {
+        // a0 > a1
+        {
+            { 0xc4, 0x3d, 0xe5, 0x6e, 0xdb, 0xfb, 0x12, 0xef, 0xdf, 0xa1, 0x38, 0x8d, 0x88, 0x50, 0x1c, 0x35 },
+            {
+                { 0xa5, 0x38, 0xff, 0x77 }, { 0x9c, 0x5c, 0xec, 0x8a }, { 0xa5, 0x38, 0xff, 0x9e }, { 0x9c, 0x5c, 0xec, 0x51 },
+                { 0xa5, 0x38, 0xff, 0x64 }, { 0xa5, 0x38, 0xff, 0x64 }, { 0x8c, 0xa6, 0xc6, 0x64 }, { 0x8c, 0xa6, 0xc6, 0x64 },
+                { 0xa5, 0x38, 0xff, 0x9e }, { 0x94, 0x81, 0xd9, 0x51 }, { 0x8c, 0xa6, 0xc6, 0x9e }, { 0xa5, 0x38, 0xff, 0x3d },
+                { 0x8c, 0xa6, 0xc6, 0x3d }, { 0x8c, 0xa6, 0xc6, 0x64 }, { 0x94, 0x81, 0xd9, 0x9e }, { 0xa5, 0x38, 0xff, 0x51 },
+            }
+        },
+        // a0 <= a1
+        {
+            { 0x2d, 0xfe, 0x5a, 0x94, 0x9e, 0x52, 0xa1, 0x43, 0x1a, 0x54, 0xc5, 0x7f, 0x57, 0x73, 0x13, 0x41 },
+            {
+                { 0x6d, 0xd2, 0x63, 0x56 }, { 0x7b, 0xfb, 0x29, 0x80 }, { 0x7b, 0xfb, 0x29, 0xfe }, { 0x7b, 0xfb, 0x29, 0x56 },
+                { 0x6d, 0xd2, 0x63, 0xfe }, { 0x52, 0x82, 0xd6, 0xd3 }, { 0x6d, 0xd2, 0x63, 0xff }, { 0x7b, 0xfb, 0x29, 0xa9 },
+                { 0x6d, 0xd2, 0x63, 0x56 }, { 0x52, 0x82, 0xd6, 0x56 }, { 0x7b, 0xfb, 0x29, 0xd3 }, { 0x52, 0x82, 0xd6, 0x2d },
+                { 0x7b, 0xfb, 0x29, 0x56 }, { 0x52, 0x82, 0xd6, 0xff }, { 0x52, 0x82, 0xd6, 0x2d }, { 0x7b, 0xfb, 0x29, 0x56 },
+            }
+        },
+    };
+
+    const GoldenBlockGray8 BC4Blocks[] = {
+        // a0 > a1
+        {
+            { 0xf9, 0x34, 0xa2, 0xb6, 0x5b, 0x81, 0xd7, 0x0a },
+            {
+                { 0xdd }, { 0xa5 }, { 0xdd }, { 0xc1 },
+                { 0xc1 }, { 0x51 }, { 0x6c }, { 0xdd },
+                { 0x34 }, { 0xf9 }, { 0x6c }, { 0xc1 },
+                { 0x89 }, { 0x89 }, { 0xdd }, { 0xf9 },
+            }
+        },
+        // a0 <= a1
+        {
+            { 0x98, 0xa5, 0xa6, 0x6c, 0xfe, 0x69, 0x5d, 0x27 },
+            {
+                { 0x00 }, { 0x9f }, { 0x9a }, { 0x00 },
+                { 0x00 }, { 0x9f }, { 0xff }, { 0xff },
+                { 0xa5 }, { 0xa2 }, { 0xa2 }, { 0x00 },
+                { 0xa2 }, { 0x00 }, { 0xa5 }, { 0xa5 },
+            }
+        },
+    };
+
+    const GoldenBlockRG8 BC5Blocks[] = {
+        {
+            { 0x6d, 0x04, 0x11, 0x0f, 0xc4, 0xa0, 0xf9, 0xcd, 0x1f, 0xf1, 0x9d, 0x03, 0x43, 0xee, 0x5f, 0x8a },
+            {
+                { 0x04, 0xc6 }, { 0x5e, 0x72 }, { 0x40, 0x00 }, { 0x13, 0xf1 },
+                { 0x6d, 0x1f }, { 0x6d, 0x00 }, { 0x04, 0x1f }, { 0x22, 0x48 },
+                { 0x6d, 0x00 }, { 0x40, 0xc6 }, { 0x22, 0xff }, { 0x40, 0xff },
+                { 0x13, 0xc6 }, { 0x4f, 0x9c }, { 0x4f, 0x48 }, { 0x22, 0x9c },
+            }
+        },
+        {
+            { 0x8e, 0xb8, 0xb6, 0x35, 0x69, 0x89, 0x7b, 0xc3, 0xf5, 0xe9, 0x5e, 0x46, 0x86, 0xe8, 0x50, 0x27 },
+            {
+                { 0x00, 0xec }, { 0x00, 0xf1 }, { 0x00, 0xe9 }, { 0x96, 0xf1 },
+                { 0x9e, 0xef }, { 0x96, 0xef }, { 0x96, 0xe9 }, { 0x9e, 0xef },
+                { 0xb8, 0xf5 }, { 0xb8, 0xee }, { 0x00, 0xf1 }, { 0xaf, 0xf5 },
+                { 0xff, 0xee }, { 0x00, 0xec }, { 0x8e, 0xe9 }, { 0x00, 0xe9 },
+            }
+        },
+    };
+
+    const GoldenBlockFloat1 BC4SignedBlocks[] = {
+        // a0 > a1
+        {
+            { 0x61, 0x1e, 0x3b, 0xda, 0x45, 0xc2, 0xe8, 0x1f },
+            {
+                { 0.613048375f }, { 0.311586052f }, { 0.763779521f }, { 0.462317199f },
+                { 0.462317199f }, { 0.613048375f }, { 0.236220479f }, { 0.688413978f },
+                { 0.688413978f }, { 0.763779521f }, { 0.613048375f }, { 0.537682772f },
+                { 0.386951625f }, { 0.311586052f }, { 0.311586052f }, { 0.763779521f },
+            }
+        },
+        // a0 <= a1
+        {
+            { 0xc9, 0x25, 0xb9, 0x61, 0xda, 0x65, 0x70, 0x12 },
+            {
+                { 0.291338593f }, { 1.0f }, { -1.0f }, { -0.433070868f },
+                { -1.0f }, { 0.00157480314f }, { -1.0f }, { -1.0f },
+                { 0.146456689f }, { 0.00157480314f }, { 0.291338593f }, { -0.433070868f },
+                { 1.0f }, { 0.00157480314f }, { 0.00157480314f }, { -0.433070868f },
+            }
+        },
+    };
+
+    const GoldenBlockFloat2 BC5SignedBlocks[] = {
+        {
+            { 0x6b, 0xa7, 0xe2, 0x37, 0x33, 0x6a, 0x93, 0x07, 0xcb, 0x38, 0x1a, 0xd4, 0x42, 0x4d, 0x03, 0x1d },
+            {
+                { 0.622047246f, -0.24566929f }, { 0.181102365f, -0.0740157515f }, { -0.48031497f, -0.417322844f }, { 0.40157479f, -0.24566929f },
+                { 0.40157479f, 0.269291341f }, { -0.259842515f, 0.269291341f }, { 0.181102365f, -0.417322844f }, { -0.700787425f, -0.24566929f },
+                { 0.622047246f, 0.269291341f }, { -0.0393700786f, 0.44094488f }, { -0.0393700786f, 0.269291341f }, { -0.700787425f, 0.44094488f },
+                { -0.700787425f, -0.417322844f }, { -0.48031497f, -0.24566929f }, { -0.700787425f, 1.0f }, { 0.842519701f, -0.417322844f },
+            }
+        },
+        {
+            { 0xe4, 0x56, 0xc2, 0xe2, 0x81, 0xd9, 0xa5, 0xcf, 0x78, 0x9c, 0xc6, 0xc3, 0x3e, 0xce, 0x9c, 0x5c },
+            {
+                { -0.0409448817f, -0.292463452f }, { -0.22047244f, 0.944881916f }, { 0.138582677f, -0.539932489f }, { 0.677165329f, -0.787401557f },
+                { -1.0f, 0.202474684f }, { 0.138582677f, -0.0449943766f }, { -0.22047244f, -0.539932489f }, { 0.318110228f, -0.787401557f },
+                { 0.677165329f, -0.292463452f }, { 0.138582677f, -0.787401557f }, { 1.0f, 0.449943751f }, { -0.0409448817f, -0.292463452f },
+                { -0.0409448817f, -0.787401557f }, { 1.0f, -0.787401557f }, { 0.138582677f, -0.539932489f }, { -1.0f, 0.697412848f },
+            }
+        },
+    };
+}
@@ -0,0 +1,48 @@
+﻿#include "test.h"
+
+#include <cstdarg>
+#include <cstring>
+
+// JP: libVLRの内部の処理の単体テスト。
+//     引数を与えると名前にその文字列を含むテストだけを実行する。
+// EN: Unit tests of internal processing of libVLR.
+//     Given an argument, only tests whose names contain the string are run.
+
+namespace VLRTest {
+    static bool s_allChecksPassed = true;
+
+    std::vector<Test> &getTests() {
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    void check(bool passed, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        printf("  [%s] ", passed ? "OK" : "FAILED");
+        vprintf(format, args);
+        printf("\n");
+        va_end(args);
+
+        if (!passed)
+            s_allChecksPassed = false;
+    }
+
+    bool allChecksPassed() {
+        return s_allChecksPassed;
+    }
+}
+
+int32_t main(int32_t argc, const char* argv[]) {
+    using namespace VLRTest;
+
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    for (const Test &test : getTests()) {
+        if (filter && std::strstr(test.name, filter) == nullptr)
+            continue;
+        printf("%s\n", test.name);
+        test.function();
+    }
+
+    return allChecksPassed() ? 0 : 1;
+}
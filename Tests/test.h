@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace VLRTest {
+    typedef void (*TestFunction)();
+
+    struct Test {
+        const char* name;
+        TestFunction function;
+    };
+
+    std::vector<Test> &getTests();
+
+    struct TestRegistrar {
+        TestRegistrar(const char* name, TestFunction function) {
+            getTests().push_back(Test{ name, function });
+        }
+    };
+
+    // JP: 確認の結果を出力し、失敗を記録する。失敗が1つでもあれば終了コードが0以外になる。
+    // EN: Print the result of a check, and record a failure. The exit code is nonzero if any check fails.
+    void check(bool passed, const char* format, ...);
+    bool allChecksPassed();
+}
+
+#define VLR_TEST(name) \
+    static void name(); \
+    static VLRTest::TestRegistrar name ## _registrar(#name, &name); \
+    static void name()
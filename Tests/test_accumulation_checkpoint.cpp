@@ -0,0 +1,187 @@
+﻿#include "test.h"
+
+#include "context.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+// JP: 蓄積値、乱数の状態、画素の統計情報の保存と復元が元のバイト列を再現し、壊れたファイルでは現在の蓄積を変えないことを確かめる。
+//     CPUバックエンドのコンテキストはGPUなしで作れるので、バッファーに直接パターンを書き込んで比べる。
+// EN: Check that saving and restoring the accumulated values, random number states and pixel statistics reproduces the original bytes,
+//     and that a broken file leaves the current accumulation unchanged.
+//     A context of the CPU backend can be created without a GPU, so patterns are written directly to the buffers and compared.
+
+namespace {
+    using namespace VLR;
+    using namespace VLRTest;
+
+    const uint32_t Width = 37;
+    const uint32_t Height = 23;
+
+    // JP: ファイルに保存されるバッファー。蓄積バッファーは蓄積形式で変わる。
+    // EN: Buffers saved to a file. The accumulation buffer changes with the accumulation format.
+    std::vector<Backend::Buffer> getCheckpointBuffers(const Context &context, VLRAccumulationFormat format) {
+        const Backend::Context &optixContext = context.getOptiXContext();
+        const char* accumBufferName = format == VLRAccumulationFormat_CompactXYZ ? "VLR::pv_compactOutputBuffer" : "VLR::pv_spectrumBuffer";
+        return std::vector<Backend::Buffer>{
+            optixContext->queryVariable(accumBufferName)->getBuffer(),
+            optixContext->queryVariable("VLR::pv_rngBuffer")->getBuffer(),
+            optixContext->queryVariable("VLR::pv_pixelStatisticsBuffer")->getBuffer()
+        };
+    }
+
+    size_t getBufferSize(const Backend::Buffer &buffer) {
+        RTsize width, height;
+        buffer->getSize(width, height);
+        return (size_t)width * height * buffer->getElementSize();
+    }
+
+    void fillPattern(const std::vector<Backend::Buffer> &buffers, uint32_t seed) {
+        for (const Backend::Buffer &buffer : buffers) {
+            auto data = (uint8_t*)buffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+            size_t size = getBufferSize(buffer);
+            for (size_t i = 0; i < size; ++i)
+                data[i] = (uint8_t)((i * 31 + seed) ^ (i >> 8));
+            buffer->unmap();
+        }
+    }
+
+    bool matchesPattern(const std::vector<Backend::Buffer> &buffers, uint32_t seed) {
+        bool matched = true;
+        for (const Backend::Buffer &buffer : buffers) {
+            auto data = (const uint8_t*)buffer->map(0, RT_BUFFER_MAP_READ);
+            size_t size = getBufferSize(buffer);
+            for (size_t i = 0; i < size; ++i)
+                matched &= data[i] == (uint8_t)((i * 31 + seed) ^ (i >> 8));
+            buffer->unmap();
+        }
+        return matched;
+    }
+
+    std::vector<char> readFile(const char* filePath) {
+        std::ifstream ifs(filePath, std::ios::in | std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const char* filePath, const char* data, size_t size) {
+        std::ofstream ofs(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+        ofs.write(data, size);
+    }
+
+    bool fileExists(const char* filePath) {
+        std::ifstream ifs(filePath, std::ios::in | std::ios::binary);
+        return !ifs.fail();
+    }
+
+    void testRoundTrip(VLRRenderingMode renderingMode, VLRAccumulationFormat format) {
+        const char* filePath = "test_accumulation_checkpoint.vlra";
+        const char* brokenFilePath = "test_accumulation_checkpoint_broken.vlra";
+
+        Context context(false, false, 8, 0, nullptr, 0, VLRBackend_CPU, renderingMode);
+        context.setAccumulationFormat(format);
+        context.bindOutputBuffer(Width, Height, 0);
+        std::vector<Backend::Buffer> buffers = getCheckpointBuffers(context, format);
+
+        fillPattern(buffers, 1);
+        check(context.saveAccumulation(filePath), "save");
+        check(!fileExists((std::string(filePath) + ".tmp").c_str()), "the temporary file is replaced");
+
+        fillPattern(buffers, 2);
+        check(context.loadAccumulation(filePath) && matchesPattern(buffers, 1), "load restores the saved bytes");
+
+        // JP: 途中で切れたファイルや余分なデータが続くファイルは読み込まず、現在の蓄積を保つ。
+        // EN: A file cut midway or followed by extra data is not loaded, keeping the current accumulation.
+        std::vector<char> fileData = readFile(filePath);
+        fillPattern(buffers, 3);
+        writeFile(brokenFilePath, fileData.data(), fileData.size() - 1);
+        check(!context.loadAccumulation(brokenFilePath) && matchesPattern(buffers, 3), "a truncated file is rejected");
+        fileData.push_back(0);
+        writeFile(brokenFilePath, fileData.data(), fileData.size());
+        check(!context.loadAccumulation(brokenFilePath) && matchesPattern(buffers, 3), "a file with trailing data is rejected");
+
+        // JP: 画像の大きさが異なる蓄積は読み込まない。
+        // EN: An accumulation of a different image size is not loaded.
+        context.bindOutputBuffer(Width + 1, Height, 0);
+        check(!context.loadAccumulation(filePath), "a file of a different size is rejected");
+
+        std::remove(filePath);
+        std::remove(brokenFilePath);
+    }
+
+    // JP: ファイルヘッダー中の蓄積フレーム数とサンプル番号の範囲の位置。
+    // EN: Positions of the number of accumulated frames and the range of sample indices in the file header.
+    const size_t NumAccumFramesPosition = 24;
+    const size_t SampleOffsetPosition = 40;
+    const size_t SampleCountPosition = 48;
+
+    template <typename T>
+    void writeHeaderValue(std::vector<char>* fileData, size_t position, T value) {
+        std::copy_n((const char*)&value, sizeof(value), fileData->data() + position);
+    }
+
+    template <typename T>
+    T readHeaderValue(const std::vector<char> &fileData, size_t position) {
+        T value;
+        std::copy_n(fileData.data() + position, sizeof(value), (char*)&value);
+        return value;
+    }
+
+    void writeRangeFile(const char* filePath, std::vector<char> fileData, uint64_t sampleOffset, uint64_t sampleCount) {
+        writeHeaderValue(&fileData, NumAccumFramesPosition, (uint32_t)sampleCount);
+        writeHeaderValue(&fileData, SampleOffsetPosition, sampleOffset);
+        writeHeaderValue(&fileData, SampleCountPosition, sampleCount);
+        writeFile(filePath, fileData.data(), fileData.size());
+    }
+
+    void testMerge(VLRRenderingMode renderingMode, VLRAccumulationFormat format) {
+        const char* filePaths[] = {
+            "test_accumulation_merge_a.vlra", "test_accumulation_merge_b.vlra", "test_accumulation_merge_c.vlra",
+            "test_accumulation_merge_d.vlra", "test_accumulation_merge_out.vlra"
+        };
+
+        Context context(false, false, 8, 0, nullptr, 0, VLRBackend_CPU, renderingMode);
+        context.setAccumulationFormat(format);
+        context.bindOutputBuffer(Width, Height, 0);
+
+        // JP: 空の蓄積を元に、サンプル番号の範囲だけが異なるファイルを作る。
+        // EN: Make files that differ only in the range of sample indices based on an empty accumulation.
+        check(context.saveAccumulation(filePaths[4]), "save");
+        std::vector<char> fileData = readFile(filePaths[4]);
+        writeRangeFile(filePaths[0], fileData, 0, 4);
+        writeRangeFile(filePaths[1], fileData, 4, 4);
+        writeRangeFile(filePaths[2], fileData, 2, 4);
+        fileData.push_back(0);
+        writeRangeFile(filePaths[3], fileData, 8, 4);
+
+        check(context.loadAccumulation(filePaths[0]), "load [0, 4)");
+        check(context.mergeAccumulation(filePaths[1]), "merge a disjoint range [4, 8)");
+        check(!context.mergeAccumulation(filePaths[1]), "merging the same file twice is rejected");
+        check(!context.mergeAccumulation(filePaths[2]), "an overlapping range [2, 6) is rejected");
+        check(!context.mergeAccumulation(filePaths[3]), "a file with trailing data is rejected");
+
+        check(context.saveAccumulation(filePaths[4]), "save the merged accumulation");
+        std::vector<char> mergedData = readFile(filePaths[4]);
+        check(readHeaderValue<uint32_t>(mergedData, NumAccumFramesPosition) == 8 &&
+              readHeaderValue<uint64_t>(mergedData, SampleOffsetPosition) == 0 &&
+              readHeaderValue<uint64_t>(mergedData, SampleCountPosition) == 8,
+              "the merged accumulation has 8 frames of the range [0, 8)");
+
+        for (const char* filePath : filePaths)
+            std::remove(filePath);
+    }
+}
+
+
+
+VLR_TEST(AccumulationCheckpoint_RoundTrip) {
+    testRoundTrip(VLRRenderingMode_RGB, VLRAccumulationFormat_Compensated);
+    testRoundTrip(VLRRenderingMode_Spectral, VLRAccumulationFormat_Compensated);
+    testRoundTrip(VLRRenderingMode_RGB, VLRAccumulationFormat_CompactXYZ);
+}
+
+VLR_TEST(AccumulationCheckpoint_Merge) {
+    testMerge(VLRRenderingMode_RGB, VLRAccumulationFormat_Compensated);
+    testMerge(VLRRenderingMode_RGB, VLRAccumulationFormat_CompactXYZ);
+}
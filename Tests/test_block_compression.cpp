@@ -0,0 +1,160 @@
+﻿#include "test.h"
+
+#include "block_compression.h"
+#include "block_compression_vectors.h"
+
+#include <cstring>
+
+// JP: ブロック圧縮の展開をMesaの展開結果の正解データと比べる。
+//     BC6HとBC7は補間と量子化の手順が仕様で決まっているのでビット単位で一致させる。
+//     BC1からBC5は補間の丸めが実装に任されていて、Mesaは8ビット整数で補間するため、8ビットで1段階の差まで許す。
+// EN: Compare decompression of block compression against golden data decompressed by Mesa.
+//     BC6H and BC7 specify the exact interpolation and quantization steps, so they must match bitwise.
+//     BC1 to BC5 leave the rounding of interpolation to implementations, and Mesa interpolates in 8-bit integers, so a difference of one 8-bit step is allowed.
+
+namespace {
+    using namespace VLR;
+    using namespace VLRTest;
+
+    const uint32_t BlockSize = 4;
+
+    uint32_t getBlockByteSize(VLRDataFormat bcFormat) {
+        return (bcFormat == VLRDataFormat_BC1 || bcFormat == VLRDataFormat_BC4 || bcFormat == VLRDataFormat_BC4_Signed) ? 8 : 16;
+    }
+
+    template <typename PixelType, uint32_t NumComponents>
+    std::vector<PixelType> decompressBlock(const uint8_t block[16], VLRDataFormat bcFormat) {
+        std::vector<PixelType> pixels(BlockSize * BlockSize * NumComponents);
+        decompressBlocks(block, bcFormat, BlockSize, BlockSize, reinterpret_cast<uint8_t*>(pixels.data()));
+        return pixels;
+    }
+
+    // JP: 8ビットの値を出力する形式の展開結果を正解と比べ、許容差を超える成分の数を返す。
+    // EN: Compare decompressed results of a format outputting 8-bit values with the golden data, and return the number of components exceeding the tolerance.
+    template <uint32_t NumComponents, size_t NumBlocks>
+    uint32_t countMismatches(const GoldenBlock<uint8_t, NumComponents> (&golden)[NumBlocks], VLRDataFormat bcFormat, int32_t tolerance) {
+        uint32_t numMismatches = 0;
+        for (const GoldenBlock<uint8_t, NumComponents> &g : golden) {
+            std::vector<uint8_t> pixels = decompressBlock<uint8_t, NumComponents>(g.block, bcFormat);
+            for (uint32_t i = 0; i < BlockSize * BlockSize; ++i) {
+                for (uint32_t c = 0; c < NumComponents; ++c) {
+                    if (std::abs((int32_t)pixels[NumComponents * i + c] - (int32_t)g.pixels[i][c]) > tolerance)
+                        ++numMismatches;
+                }
+            }
+        }
+        return numMismatches;
+    }
+
+    // JP: 単精度浮動小数点数を出力する形式の展開結果を、正解の値をscaleで割ったものと比べる。
+    // EN: Compare decompressed results of a format outputting single-precision floats with golden values divided by scale.
+    template <typename PixelType, uint32_t NumComponents, size_t NumBlocks>
+    uint32_t countMismatches(const GoldenBlock<PixelType, NumComponents> (&golden)[NumBlocks], VLRDataFormat bcFormat, float scale, float tolerance) {
+        uint32_t numMismatches = 0;
+        for (const GoldenBlock<PixelType, NumComponents> &g : golden) {
+            std::vector<float> pixels = decompressBlock<float, NumComponents>(g.block, bcFormat);
+            for (uint32_t i = 0; i < BlockSize * BlockSize; ++i) {
+                for (uint32_t c = 0; c < NumComponents; ++c) {
+                    if (std::fabs(pixels[NumComponents * i + c] - g.pixels[i][c] / scale) > tolerance)
+                        ++numMismatches;
+                }
+            }
+        }
+        return numMismatches;
+    }
+}
+
+
+
+VLR_TEST(BlockCompression_BC7) {
+    const uint32_t NumBlocksPerMode = 2;
+    uint32_t numMismatches[8] = {};
+    for (uint32_t b = 0; b < sizeof(BC7Blocks) / sizeof(BC7Blocks[0]); ++b) {
+        const GoldenBlockRGBA8 &g = BC7Blocks[b];
+        std::vector<uint8_t> pixels = decompressBlock<uint8_t, 4>(g.block, VLRDataFormat_BC7);
+        if (std::memcmp(pixels.data(), g.pixels, sizeof(g.pixels)) != 0)
+            ++numMismatches[b / NumBlocksPerMode];
+    }
+    for (uint32_t mode = 0; mode < 8; ++mode)
+        check(numMismatches[mode] == 0, "mode %u: %u of %u blocks mismatch", mode, numMismatches[mode], NumBlocksPerMode);
+
+    // JP: モードのビットが無い無効なブロックは透明な黒になる。
+    // EN: An invalid block without mode bits becomes transparent black.
+    uint8_t invalidBlock[16] = {};
+    invalidBlock[1] = 0xFF;
+    std::vector<uint8_t> pixels = decompressBlock<uint8_t, 4>(invalidBlock, VLRDataFormat_BC7);
+    check(std::all_of(pixels.begin(), pixels.end(), [](uint8_t v) { return v == 0; }), "invalid mode decodes to transparent black");
+}
+
+VLR_TEST(BlockCompression_BC6H) {
+    const uint32_t NumBlocksPerMode = 2;
+    const uint16_t HalfOne = 0x3C00;
+    for (int signedness = 0; signedness < 2; ++signedness) {
+        VLRDataFormat bcFormat = signedness ? VLRDataFormat_BC6H_Signed : VLRDataFormat_BC6H;
+        uint32_t numMismatches[14] = {};
+        for (uint32_t b = 0; b < sizeof(BC6HBlocks) / sizeof(BC6HBlocks[0]); ++b) {
+            const GoldenBlockBC6H &g = BC6HBlocks[b];
+            const uint16_t (&expected)[16][3] = signedness ? g.signedPixels : g.unsignedPixels;
+            std::vector<uint16_t> pixels = decompressBlock<uint16_t, 4>(g.block, bcFormat);
+            bool matched = true;
+            for (uint32_t i = 0; i < BlockSize * BlockSize; ++i) {
+                matched &= pixels[4 * i + 0] == expected[i][0] && pixels[4 * i + 1] == expected[i][1] && pixels[4 * i + 2] == expected[i][2];
+                matched &= pixels[4 * i + 3] == HalfOne;
+            }
+            if (!matched)
+                ++numMismatches[b / NumBlocksPerMode];
+        }
+        for (uint32_t mode = 0; mode < 14; ++mode)
+            check(numMismatches[mode] == 0, "%s mode %u: %u of %u blocks mismatch",
+                  signedness ? "signed" : "unsigned", mode + 1, numMismatches[mode], NumBlocksPerMode);
+    }
+}
+
+VLR_TEST(BlockCompression_BC1_BC2_BC3) {
+    uint32_t numMismatches = countMismatches(BC1Blocks, VLRDataFormat_BC1, 1);
+    check(numMismatches == 0, "BC1: %u components differ by more than one step", numMismatches);
+    numMismatches = countMismatches(BC2Blocks, VLRDataFormat_BC2, 1);
+    check(numMismatches == 0, "BC2: %u components differ by more than one step", numMismatches);
+    numMismatches = countMismatches(BC3Blocks, VLRDataFormat_BC3, 1);
+    check(numMismatches == 0, "BC3: %u components differ by more than one step", numMismatches);
+}
+
+VLR_TEST(BlockCompression_BC4_BC5) {
+    uint32_t numMismatches = countMismatches(BC4Blocks, VLRDataFormat_BC4, 1);
+    check(numMismatches == 0, "BC4: %u components differ by more than one step", numMismatches);
+    numMismatches = countMismatches(BC5Blocks, VLRDataFormat_BC5, 255.0f, 1.0f / 255);
+    check(numMismatches == 0, "BC5: %u components differ by more than one step", numMismatches);
+    numMismatches = countMismatches(BC4SignedBlocks, VLRDataFormat_BC4_Signed, 1.0f, 1e-6f);
+    check(numMismatches == 0, "BC4_Signed: %u components mismatch", numMismatches);
+    numMismatches = countMismatches(BC5SignedBlocks, VLRDataFormat_BC5_Signed, 1.0f, 1e-6f);
+    check(numMismatches == 0, "BC5_Signed: %u components mismatch", numMismatches);
+}
+
+VLR_TEST(BlockCompression_PartialBlocks) {
+    // JP: 4の倍数でない解像度では、端のブロックの画像内の部分だけが出力される。
+    // EN: With a resolution not a multiple of 4, only the parts of edge blocks inside the image are output.
+    const uint32_t Width = 6, Height = 5;
+    const uint32_t WidthInBlocks = 2, HeightInBlocks = 2;
+    uint8_t blocks[HeightInBlocks][WidthInBlocks][16];
+    for (uint32_t by = 0; by < HeightInBlocks; ++by) {
+        for (uint32_t bx = 0; bx < WidthInBlocks; ++bx)
+            std::memcpy(blocks[by][bx], BC7Blocks[2 * (WidthInBlocks * by + bx)].block, 16);
+    }
+
+    uint8_t pixels[Height][Width][4];
+    decompressBlocks(&blocks[0][0][0], VLRDataFormat_BC7, Width, Height, &pixels[0][0][0]);
+
+    uint32_t numMismatches = 0;
+    for (uint32_t y = 0; y < Height; ++y) {
+        for (uint32_t x = 0; x < Width; ++x) {
+            const GoldenBlockRGBA8 &g = BC7Blocks[2 * (WidthInBlocks * (y / BlockSize) + x / BlockSize)];
+            if (std::memcmp(pixels[y][x], g.pixels[BlockSize * (y % BlockSize) + x % BlockSize], 4) != 0)
+                ++numMismatches;
+        }
+    }
+    check(numMismatches == 0, "%u of %u pixels mismatch in a %ux%u image", numMismatches, Width * Height, Width, Height);
+
+    check(getCompressedSize(VLRDataFormat_BC7, Width, Height) == WidthInBlocks * HeightInBlocks * getBlockByteSize(VLRDataFormat_BC7) &&
+          getCompressedSize(VLRDataFormat_BC1, Width, Height) == WidthInBlocks * HeightInBlocks * getBlockByteSize(VLRDataFormat_BC1),
+          "compressed size counts partial blocks");
+}
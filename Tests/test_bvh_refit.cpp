@@ -0,0 +1,151 @@
+﻿#include "test.h"
+
+#include "cpu_traversal.h"
+
+#include <random>
+
+// JP: BVHの再フィットが構築時のトポロジーを保ったまま、移動後のプリミティブを包む隙間の無いAABBを作ることを確かめる。
+//     TriangleAcceleratorについては、再フィットした加速構造の交差結果が構築し直したものと一致することを確かめる。
+// EN: Check that refitting a BVH makes tight AABBs enclosing the moved primitives while keeping the topology at build time.
+//     For TriangleAccelerator, check that intersection results of a refitted acceleration structure match those of a rebuilt one.
+
+namespace {
+    using namespace VLR;
+    using namespace VLR::CPU;
+    using namespace VLRTest;
+
+    const uint32_t NumPrimitives = 2000;
+
+    bool equals(const BoundingBox3D &a, const BoundingBox3D &b) {
+        return (a.minP.x == b.minP.x && a.minP.y == b.minP.y && a.minP.z == b.minP.z &&
+                a.maxP.x == b.maxP.x && a.maxP.y == b.maxP.y && a.maxP.z == b.maxP.z);
+    }
+
+    std::vector<BoundingBox3D> createBoxes(std::mt19937 &rng) {
+        std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+        std::vector<BoundingBox3D> boxes(NumPrimitives);
+        for (BoundingBox3D &box : boxes) {
+            Point3D p(100 * u01(rng), 100 * u01(rng), 100 * u01(rng));
+            box = BoundingBox3D(p, p + Vector3D(u01(rng), u01(rng), u01(rng)));
+        }
+        return boxes;
+    }
+
+    // JP: 葉はプリミティブの和、中間ノードは2つの子の和と一致するか。
+    // EN: Whether a leaf equals the union of its primitives and an inner node equals the union of its two children.
+    bool nodesAreTight(const BVH &bvh, const std::vector<BoundingBox3D> &boxes) {
+        const std::vector<BVH::Node> &nodes = bvh.getNodes();
+        const std::vector<uint32_t> &primIndices = bvh.getPrimitiveIndices();
+        for (uint32_t nodeIdx = 0; nodeIdx < nodes.size(); ++nodeIdx) {
+            const BVH::Node &node = nodes[nodeIdx];
+            BoundingBox3D bbox;
+            if (node.numPrimitives > 0) {
+                for (uint32_t i = 0; i < node.numPrimitives; ++i)
+                    bbox.unify(boxes[primIndices[node.offset + i]]);
+            }
+            else {
+                bbox.unify(nodes[nodeIdx + 1].bbox);
+                bbox.unify(nodes[node.offset].bbox);
+            }
+            if (!equals(bbox, node.bbox))
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<Triangle> createTriangles(std::mt19937 &rng) {
+        std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+        std::vector<Triangle> triangles(NumPrimitives);
+        for (uint32_t i = 0; i < NumPrimitives; ++i) {
+            Triangle &tri = triangles[i];
+            tri.p0 = Point3D(10 * u01(rng), 10 * u01(rng), 10 * u01(rng));
+            tri.p1 = tri.p0 + Vector3D(u01(rng) - 0.5f, u01(rng) - 0.5f, u01(rng) - 0.5f);
+            tri.p2 = tri.p0 + Vector3D(u01(rng) - 0.5f, u01(rng) - 0.5f, u01(rng) - 0.5f);
+            tri.instIndex = 0;
+            tri.primIndex = i;
+        }
+        return triangles;
+    }
+}
+
+
+
+VLR_TEST(BVH_RefitMatchesBuild) {
+    std::mt19937 rng(8172531);
+    std::vector<BoundingBox3D> boxes = createBoxes(rng);
+
+    BVH bvh;
+    bvh.build(boxes);
+    std::vector<BVH::Node> builtNodes = bvh.getNodes();
+    std::vector<uint32_t> builtPrimIndices = bvh.getPrimitiveIndices();
+    float builtSAHCost = bvh.getStatistics().SAHCost;
+
+    // JP: 同じボックスでの再フィットは構築結果をそのまま再現する。
+    // EN: Refitting with the same boxes reproduces the build result as is.
+    bvh.refit(boxes);
+    bool sameBoxes = bvh.getNodes().size() == builtNodes.size();
+    for (uint32_t i = 0; sameBoxes && i < builtNodes.size(); ++i)
+        sameBoxes &= equals(bvh.getNodes()[i].bbox, builtNodes[i].bbox);
+    check(sameBoxes, "refitting unchanged boxes keeps node AABBs");
+    check(std::fabs(bvh.getStatistics().SAHCost - builtSAHCost) <= 1e-4f * builtSAHCost,
+          "refitting unchanged boxes keeps the SAH cost: %g, %g", bvh.getStatistics().SAHCost, builtSAHCost);
+
+    std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+    for (BoundingBox3D &box : boxes) {
+        Vector3D d(u01(rng) - 0.5f, u01(rng) - 0.5f, u01(rng) - 0.5f);
+        box = BoundingBox3D(box.minP + 5 * d, box.maxP + 5 * d + Vector3D(u01(rng)));
+    }
+    bvh.refit(boxes);
+
+    const std::vector<BVH::Node> &nodes = bvh.getNodes();
+    bool sameTopology = nodes.size() == builtNodes.size() && bvh.getPrimitiveIndices() == builtPrimIndices;
+    for (uint32_t i = 0; sameTopology && i < nodes.size(); ++i)
+        sameTopology &= nodes[i].offset == builtNodes[i].offset && nodes[i].numPrimitives == builtNodes[i].numPrimitives;
+    check(sameTopology, "refitting keeps the topology");
+    check(nodesAreTight(bvh, boxes), "refitted node AABBs are tight");
+
+    BVH rebuiltBVH;
+    rebuiltBVH.build(boxes);
+    check(equals(nodes[0].bbox, rebuiltBVH.getNodes()[0].bbox), "the root AABB equals that of a rebuilt BVH");
+    check(nodesAreTight(rebuiltBVH, boxes), "rebuilt node AABBs are tight");
+}
+
+VLR_TEST(TriangleAccelerator_UpdateMatchesBuild) {
+    std::mt19937 rng(5361847);
+    std::vector<Triangle> triangles = createTriangles(rng);
+
+    TriangleAccelerator refitted;
+    refitted.build(std::vector<Triangle>(triangles));
+
+    // JP: 小さな移動ではSAHコストが大きく悪化しないので、再構築せずに再フィットする。
+    // EN: A small movement doesn't degrade the SAH cost much, so this refits without rebuilding.
+    std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+    for (Triangle &tri : triangles) {
+        Vector3D d(0.1f * (u01(rng) - 0.5f), 0.1f * (u01(rng) - 0.5f), 0.1f * (u01(rng) - 0.5f));
+        tri.p0 += d;
+        tri.p1 += d;
+        tri.p2 += d;
+    }
+    check(!refitted.update(std::vector<Triangle>(triangles)), "a small movement is refitted");
+
+    TriangleAccelerator rebuilt;
+    rebuilt.build(std::vector<Triangle>(triangles));
+
+    const uint32_t NumRays = 4096;
+    uint32_t numHits = 0;
+    uint32_t numMismatches = 0;
+    for (uint32_t i = 0; i < NumRays; ++i) {
+        Point3D org(-5.0f, 10 * u01(rng), 10 * u01(rng));
+        Vector3D dir = normalize(Point3D(15.0f, 10 * u01(rng), 10 * u01(rng)) - org);
+        RayHit refittedHit, rebuiltHit;
+        bool refittedHitFound = refitted.intersect(org, dir, 0.0f, INFINITY, nullptr, nullptr, &refittedHit);
+        bool rebuiltHitFound = rebuilt.intersect(org, dir, 0.0f, INFINITY, nullptr, nullptr, &rebuiltHit);
+        if (refittedHitFound != rebuiltHitFound ||
+            (refittedHitFound && (refittedHit.primIndex != rebuiltHit.primIndex || refittedHit.t != rebuiltHit.t)))
+            ++numMismatches;
+        if (rebuiltHitFound)
+            ++numHits;
+    }
+    check(numHits > 0, "%u / %u rays hit", numHits, NumRays);
+    check(numMismatches == 0, "%u mismatches between refitted and rebuilt accelerators", numMismatches);
+}
@@ -0,0 +1,119 @@
+﻿#include "test.h"
+
+#include "backend.h"
+
+// JP: CPUバックエンドが使うホストのコンテキストが、GPUやOptiXのDLLなしでバッファーや変数、変換を保持することを確かめる。
+//     libVLRと同じくバックエンドのインターフェースを通して操作する。
+// EN: Check that the host context used by the CPU backend holds buffers, variables and transforms without a GPU or the OptiX DLL.
+//     Operate through the backend interface as libVLR does.
+
+namespace {
+    using namespace VLR;
+    using namespace VLRTest;
+
+    VLR_TEST(HostBackend_Buffer) {
+        Backend::Context context = Backend::createHostContext();
+
+        Backend::Buffer buffer = context->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_FLOAT4, 4, 2);
+        {
+            auto values = (float*)buffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+            for (int i = 0; i < 4 * 4 * 2; ++i)
+                values[i] = (float)i;
+            buffer->unmap();
+        }
+        Backend::Buffer bufferFromID = context->getBufferFromId(buffer->getId());
+        check(bufferFromID == buffer, "buffer from ID %d", buffer->getId());
+        {
+            auto values = (const float*)bufferFromID->map(0, RT_BUFFER_MAP_READ);
+            check(values[0] == 0.0f && values[31] == 31.0f, "contents are kept: %g, %g", values[0], values[31]);
+            bufferFromID->unmap();
+        }
+
+        RTsize width, height;
+        buffer->getSize(width, height);
+        check(width == 4 && height == 2, "size: %u x %u", (uint32_t)width, (uint32_t)height);
+
+        buffer->setMipLevelCount(3);
+        buffer->getMipLevelSize(2, width, height);
+        check(width == 1 && height == 1, "mip level 2 size: %u x %u", (uint32_t)width, (uint32_t)height);
+        check(buffer->map(2, RT_BUFFER_MAP_WRITE_DISCARD) != nullptr, "mip level 2 can be mapped");
+        buffer->unmap(2);
+
+        // JP: ブロック圧縮形式の大きさはブロック単位なので、要素はブロックのバイト数になる。
+        // EN: The size of a block compressed format is in blocks, so an element is the bytes of a block.
+        Backend::Buffer bc1Buffer = context->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BC1, 2, 2);
+        Backend::Buffer bc7Buffer = context->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BC7, 2, 2);
+        check(bc1Buffer->getElementSize() == 8 && bc7Buffer->getElementSize() == 16,
+              "BC block sizes: %u, %u", (uint32_t)bc1Buffer->getElementSize(), (uint32_t)bc7Buffer->getElementSize());
+
+        Backend::TextureSampler sampler = context->createTextureSampler();
+        sampler->setBuffer(buffer);
+        sampler->setWrapMode(0, RT_WRAP_CLAMP_TO_EDGE);
+        Backend::TextureSampler samplerFromID = context->getTextureSamplerFromId(sampler->getId());
+        check(samplerFromID == sampler && samplerFromID->getBuffer() == buffer &&
+              samplerFromID->getWrapMode(0) == RT_WRAP_CLAMP_TO_EDGE, "texture sampler from ID %d", sampler->getId());
+
+        int32_t bufferID = buffer->getId();
+        sampler->destroy();
+        buffer->destroy();
+        check(!context->getBufferFromId(bufferID), "destroyed buffer is not found from ID %d", bufferID);
+
+        context->destroy();
+    }
+
+    VLR_TEST(HostBackend_Variables) {
+        Backend::Context context = Backend::createHostContext();
+
+        check(!context->queryVariable("VLR::pv_test"), "undeclared variable is null");
+        context["VLR::pv_test"]->setFloat(1.5f);
+        check(context->queryVariable("VLR::pv_test")->getFloat() == 1.5f, "float variable");
+
+        optix::uint2 size = optix::make_uint2(640, 480);
+        context["VLR::pv_imageSize"]->setUint(size);
+        optix::uint2 gotSize = context["VLR::pv_imageSize"]->getUint2();
+        check(gotSize.x == 640 && gotSize.y == 480, "uint2 variable: %u, %u", gotSize.x, gotSize.y);
+
+        Backend::Buffer buffer = context->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, 16);
+        buffer->setElementSize(24);
+        check(buffer->getElementSize() == 24, "user element size");
+        Backend::Program program = context->createProgramFromPTXString("", "VLR::pathTracing");
+
+        Backend::GeometryInstance geomInst = context->createGeometryInstance();
+        geomInst["VLR::pv_vertexBuffer"]->set(buffer);
+        geomInst["VLR::pv_progDecodeHitPoint"]->set(program);
+        check(geomInst->queryVariable("VLR::pv_vertexBuffer")->getBuffer()->getId() == buffer->getId(), "buffer variable");
+        check(geomInst->queryVariable("VLR::pv_progDecodeHitPoint")->getProgram()->getId() == program->getId(), "program variable");
+        check(!context->queryVariable("VLR::pv_vertexBuffer"), "variables are per scope");
+
+        // JP: 値を設定し直すと以前に設定したオブジェクトへの参照は外れる。
+        // EN: Setting a value again drops the reference to the object set before.
+        geomInst["VLR::pv_vertexBuffer"]->setUint(7);
+        check(!geomInst["VLR::pv_vertexBuffer"]->getBuffer() && geomInst["VLR::pv_vertexBuffer"]->getUint() == 7, "variable type changes");
+
+        context->destroy();
+    }
+
+    VLR_TEST(HostBackend_Transform) {
+        Backend::Context context = Backend::createHostContext();
+
+        // JP: 逆行列を与えない場合はホストのコンテキストが求める。
+        // EN: The host context computes the inverse when it is not given.
+        const float matrix[] = {
+            2, 0, 0, 1,
+            0, 4, 0, 2,
+            0, 0, 8, 3,
+            0, 0, 0, 1
+        };
+        Backend::Transform transform = context->createTransform();
+        transform->setMatrix(false, matrix, nullptr);
+
+        float gotMatrix[16];
+        float gotInverse[16];
+        transform->getMatrix(true, gotMatrix, gotInverse);
+        check(gotMatrix[12] == 1.0f && gotMatrix[13] == 2.0f && gotMatrix[14] == 3.0f, "transposed translation");
+        check(std::fabs(gotInverse[0] - 0.5f) < 1e-6f && std::fabs(gotInverse[12] + 0.5f) < 1e-6f &&
+              std::fabs(gotInverse[14] + 0.375f) < 1e-6f, "computed inverse");
+
+        context->destroy();
+    }
+}
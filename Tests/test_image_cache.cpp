@@ -0,0 +1,99 @@
+﻿#include "test.h"
+
+#include "shader_nodes.h"
+
+// JP: ImageCacheが同じ画素データの画像を共有し、異なるデータやハッシュの衝突では共有しないこと、
+//     参照の無くなった画像を容量の範囲で保持して最も長く使われていないものから破棄することを確かめる。
+//     画像はCPUバックエンドのコンテキストで作り、外部データの返却コールバックで破棄を数える。
+// EN: Check that ImageCache shares images with the same pixel data and doesn't share them for different data or hash collisions,
+//     and that it keeps images without references within the capacity, discarding the least recently used ones first.
+//     Images are created with a context of the CPU backend, and destruction is counted with the release callback of external data.
+
+namespace {
+    using namespace VLR;
+    using namespace VLRTest;
+
+    const uint32_t Width = 16;
+    const uint32_t Height = 16;
+    const size_t DataSize = 4 * Width * Height;
+
+    void countRelease(const uint8_t* data, void* userData) {
+        ++*(uint32_t*)userData;
+    }
+
+    std::vector<uint8_t> createPixels(uint8_t seed) {
+        std::vector<uint8_t> pixels(DataSize);
+        for (uint32_t i = 0; i < DataSize; ++i)
+            pixels[i] = (uint8_t)(i * 7 + seed);
+        return pixels;
+    }
+
+    // JP: VLR.cppのshareImage()と同じ手順で画像をキャッシュに通す。
+    // EN: Pass an image through the cache in the same steps as shareImage() in VLR.cpp.
+    LinearImage2D* createSharedImage(Context &context, const std::vector<uint8_t> &pixels, uint32_t* numReleases) {
+        auto newImage = new LinearImage2D(context, pixels.data(), Width, Height, VLRDataFormat_RGBA8x4, false, countRelease, numReleases);
+        auto image = (LinearImage2D*)context.getImageCache().addOrAcquire(newImage->createImageCacheKey(), newImage, newImage->getDataSize(),
+                                                                           [newImage](const Image2D* cachedImage) {
+            return newImage->hasSameData(cachedImage);
+        });
+        if (image != newImage)
+            delete newImage;
+        return image;
+    }
+}
+
+
+
+VLR_TEST(ImageCache_HitAndMiss) {
+    check(LinearImage2D::canAdoptData(VLRDataFormat_RGBA8x4, false), "RGBA8 data is adopted without copying");
+
+    // JP: 画像は外部データを参照し、残った画像はコンテキストの破棄時に返却されるので、データとカウンターを先に作る。
+    // EN: Images reference the external data, and remaining images return it on destruction of the context, so create the data and the counter first.
+    uint32_t numReleases = 0;
+    std::vector<uint8_t> pixelsA = createPixels(0);
+    std::vector<uint8_t> pixelsA2 = pixelsA;
+    std::vector<uint8_t> pixelsB = createPixels(1);
+    Context context(false, false, 8, 0, nullptr, 0, VLRBackend_CPU, VLRRenderingMode_RGB);
+    ImageCache &cache = context.getImageCache();
+
+    // JP: 別の配列でも内容が同じなら既存の画像を返し、新しい画像はすぐに破棄される。
+    // EN: The existing image is returned for the same content even in a different array, and the new image is destroyed immediately.
+    LinearImage2D* imageA = createSharedImage(context, pixelsA, &numReleases);
+    LinearImage2D* imageA2 = createSharedImage(context, pixelsA2, &numReleases);
+    check(imageA2 == imageA && numReleases == 1, "the same content hits");
+    LinearImage2D* imageB = createSharedImage(context, pixelsB, &numReleases);
+    check(imageB != imageA && numReleases == 1, "different content misses");
+
+    // JP: キーが同じでも画素データの比較が一致しなければ共有しない。
+    // EN: Not shared if the comparison of pixel data doesn't match even with the same key.
+    auto collidingImage = new LinearImage2D(context, pixelsA.data(), Width, Height, VLRDataFormat_RGBA8x4, false, countRelease, &numReleases);
+    Image2D* acquired = cache.addOrAcquire(collidingImage->createImageCacheKey(), collidingImage, collidingImage->getDataSize(),
+                                           [](const Image2D*) { return false; });
+    check(acquired == collidingImage, "a hash collision is registered separately");
+
+    // JP: 共有中の画像は外せず、参照が1つになれば外せる。外した画像はキャッシュに管理されない。
+    // EN: A shared image cannot be detached, and can be once it has a single reference. A detached image is not managed by the cache.
+    check(!cache.detach(imageA), "a shared image cannot be detached");
+    check(cache.release(imageA) && cache.detach(imageA), "an image with a single reference can be detached");
+    check(!cache.release(imageA), "a detached image is not managed");
+    delete imageA;
+    check(numReleases == 2, "the detached image is destroyed by the caller");
+
+    // JP: 容量を1枚分にすると、参照の無い画像は最近解放された1枚だけが残る。
+    // EN: With the capacity of one image, only the most recently released image without references remains.
+    cache.setCapacity(DataSize);
+    check(cache.release(imageB) && numReleases == 2, "an image without references is kept within the capacity");
+    check(cache.release(collidingImage) && numReleases == 3, "the least recently used image is evicted beyond the capacity");
+    // JP: 追い出された画像のアドレスは再利用されうるので、ヒットかどうかは新しい画像が破棄されたかで判断する。
+    // EN: The address of an evicted image may be reused, so whether it hits is determined by whether the new image is destroyed.
+    createSharedImage(context, pixelsB, &numReleases);
+    check(numReleases == 3, "an evicted image misses");
+    LinearImage2D* reacquired = createSharedImage(context, pixelsA, &numReleases);
+    check(reacquired == collidingImage && numReleases == 4, "a kept image without references hits");
+
+    // JP: 容量が0なら参照が無くなった時点で破棄される。
+    // EN: With a capacity of 0, an image is destroyed as soon as it loses its references.
+    cache.setCapacity(0);
+    check(numReleases == 4, "referenced images are not discarded regardless of the capacity");
+    check(cache.release(reacquired) && numReleases == 5, "an image is destroyed on release with zero capacity");
+}
@@ -0,0 +1,139 @@
+﻿#include "test.h"
+
+#include "tiled_image.h"
+
+#include <cstdio>
+
+// JP: TileCacheが参照されているタイルも含めて予算を守り、最も長く使われていないタイルから追い出すことを確かめる。
+//     TiledImageFileはコンテキストに依存しないので、書き出したファイルから直接タイルを読む。
+// EN: Check that TileCache keeps the budget including referenced tiles, and evicts the least recently used tiles first.
+//     TiledImageFile doesn't depend on a context, so tiles are read directly from a written file.
+
+namespace {
+    using namespace VLR;
+    using namespace VLRTest;
+
+    const uint32_t Width = 256;
+    const uint32_t Height = 256;
+    const uint32_t TileSize = 32;
+    const uint32_t NumTilesX = Width / TileSize;
+    const uint32_t NumTiles = NumTilesX * (Height / TileSize);
+    const size_t TileDataSize = 4 * TileSize * TileSize;
+
+    // JP: 各画素に座標から決まる値を持つRGBA8の画像を1レベルだけ書き出す。
+    // EN: Write an RGBA8 image with values determined from coordinates at each pixel, with only one level.
+    bool writeTestImage(const char* filePath, TiledImageInfo* info) {
+        std::vector<uint8_t> pixels(4 * Width * Height);
+        for (uint32_t y = 0; y < Height; ++y) {
+            for (uint32_t x = 0; x < Width; ++x) {
+                uint8_t* pixel = &pixels[4 * (Width * y + x)];
+                pixel[0] = x & 0xFF;
+                pixel[1] = y & 0xFF;
+                pixel[2] = (x ^ y) & 0xFF;
+                pixel[3] = 255;
+            }
+        }
+        const uint8_t* levels[] = { pixels.data() };
+        if (!writeTiledImageFile(filePath, VLRDataFormat_RGBA8x4, false, Width, Height, TileSize, levels, 1))
+            return false;
+        return readTiledImageInfo(filePath, info);
+    }
+
+    bool tileMatches(const TileCache::TileData &tile, uint32_t tileX, uint32_t tileY) {
+        for (uint32_t row = 0; row < TileSize; ++row) {
+            for (uint32_t col = 0; col < TileSize; ++col) {
+                uint32_t x = TileSize * tileX + col;
+                uint32_t y = TileSize * tileY + row;
+                const uint8_t* pixel = tile->data() + 4 * (TileSize * row + col);
+                if (pixel[0] != (x & 0xFF) || pixel[1] != (y & 0xFF) || pixel[2] != ((x ^ y) & 0xFF) || pixel[3] != 255)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+
+VLR_TEST(TileCache_Eviction) {
+    const char* filePath = "test_tile_cache.tiled";
+    TiledImageInfo info;
+    if (!writeTestImage(filePath, &info)) {
+        check(false, "write a tiled image file");
+        return;
+    }
+
+    {
+        TiledImageFile file(filePath, info);
+        const uint32_t BudgetInTiles = 16;
+        TileCache cache;
+        cache.setBudget(BudgetInTiles * TileDataSize);
+        VLRTileCacheStatistics stats;
+
+        // JP: 参照を手放しながら全タイルを読むと、予算分のタイルだけが残る。
+        // EN: Reading all the tiles while releasing references leaves only tiles for the budget.
+        bool withinBudget = true;
+        bool contentMatched = true;
+        for (uint32_t i = 0; i < NumTiles; ++i) {
+            TileCache::TileData tile = cache.getTile(&file, 0, i % NumTilesX, i / NumTilesX);
+            contentMatched &= tileMatches(tile, i % NumTilesX, i / NumTilesX);
+            cache.getStatistics(&stats);
+            withinBudget &= stats.residentSize <= stats.budget;
+        }
+        check(contentMatched, "tiles have the content of the file");
+        check(withinBudget, "resident size stays within the budget while scanning");
+        cache.getStatistics(&stats);
+        check(stats.numMisses == NumTiles && stats.numResidentTiles == BudgetInTiles && stats.numEvictions == NumTiles - BudgetInTiles,
+              "misses %llu, resident tiles %u, evictions %llu after scanning %u tiles",
+              (unsigned long long)stats.numMisses, stats.numResidentTiles, (unsigned long long)stats.numEvictions, NumTiles);
+
+        // JP: 最近使ったタイルはヒットし、最も古いタイルは追い出されている。
+        // EN: A recently used tile hits, and the oldest tile has been evicted.
+        cache.getTile(&file, 0, (NumTiles - 1) % NumTilesX, (NumTiles - 1) / NumTilesX);
+        cache.getStatistics(&stats);
+        check(stats.numMisses == NumTiles, "the most recent tile hits");
+        cache.getTile(&file, 0, 0, 0);
+        cache.getStatistics(&stats);
+        check(stats.numMisses == NumTiles + 1, "the least recently used tile has been evicted");
+
+        // JP: 参照中のタイルは追い出されず予算に数えられるので、残りのタイルを読んでも予算を超えない。
+        // EN: Referenced tiles are not evicted and are counted in the budget, so reading the rest of the tiles doesn't exceed the budget.
+        const uint32_t NumPinnedTiles = 8;
+        std::vector<TileCache::TileData> pinnedTiles;
+        for (uint32_t i = 0; i < NumPinnedTiles; ++i)
+            pinnedTiles.push_back(cache.getTile(&file, 0, i % NumTilesX, i / NumTilesX));
+        withinBudget = true;
+        for (uint32_t i = NumPinnedTiles; i < NumTiles; ++i) {
+            bool overBudget;
+            cache.getTile(&file, 0, i % NumTilesX, i / NumTilesX, &overBudget);
+            cache.getStatistics(&stats);
+            withinBudget &= !overBudget && stats.residentSize <= stats.budget;
+        }
+        check(withinBudget, "resident size including %u referenced tiles stays within the budget", NumPinnedTiles);
+        uint64_t numMissesBefore = stats.numMisses;
+        for (uint32_t i = 0; i < NumPinnedTiles; ++i)
+            cache.getTile(&file, 0, i % NumTilesX, i / NumTilesX);
+        cache.getStatistics(&stats);
+        check(stats.numMisses == numMissesBefore, "referenced tiles are not evicted");
+        pinnedTiles.clear();
+
+        // JP: 予算を超える数のタイルを参照すると超過が報告され、参照を手放した後に予算まで追い出せる。
+        // EN: Referencing more tiles than the budget reports the excess, and tiles can be evicted down to the budget after releasing the references.
+        const uint32_t NumOverPinnedTiles = BudgetInTiles + 4;
+        bool reportedOverBudget = false;
+        for (uint32_t i = 0; i < NumOverPinnedTiles; ++i) {
+            bool overBudget;
+            pinnedTiles.push_back(cache.getTile(&file, 0, i % NumTilesX, i / NumTilesX, &overBudget));
+            reportedOverBudget |= overBudget;
+        }
+        cache.getStatistics(&stats);
+        check(reportedOverBudget && stats.residentSize == NumOverPinnedTiles * TileDataSize,
+              "referenced tiles beyond the budget are reported and counted (%llu bytes)", (unsigned long long)stats.residentSize);
+        pinnedTiles.clear();
+        cache.trim();
+        cache.getStatistics(&stats);
+        check(stats.residentSize <= stats.budget, "trimming after releasing references fits in the budget");
+    }
+
+    std::remove(filePath);
+}
@@ -0,0 +1,642 @@
+﻿// JP: GPUカーネルをホストコンパイラーでまとめてコンパイルする。
+//     ヘッダーで定義されるカーネル変数が一度だけ定義されるように単一の翻訳単位にまとめている。
+//     スペクトルレンダリング用にはkernels_spectral.cppがこのファイルをもう一度コンパイルする。
+// EN: Compile the GPU kernels together with the host compiler.
+//     They are put into a single translation unit so that kernel variables defined in headers are defined only once.
+//     kernels_spectral.cpp compiles this file once more for spectral rendering.
+#include "../GPU_kernels/materials.cu"
+#include "../GPU_kernels/shader_nodes.cu"
+#include "../GPU_kernels/cameras.cu"
+#include "../GPU_kernels/triangle_intersection.cu"
+#include "../GPU_kernels/infinite_sphere_intersection.cu"
+#include "../GPU_kernels/path_tracing.cu"
+
+#include "../cpu_renderer.h"
+
+#include <algorithm>
+
+namespace VLR {
+    namespace CPU {
+        VLR_RENDERING_MODE_NAMESPACE_BEGIN
+        struct ProgramEntry {
+            const char* name;
+            GenericProgram program;
+        };
+
+#define VLR_CPU_PROGRAM(name) { "VLR::" #name, (GenericProgram)&VLR::name }
+
+        static const ProgramEntry s_programTable[] = {
+            // materials.cu
+            VLR_CPU_PROGRAM(NullBSDF_setupBSDF),
+            VLR_CPU_PROGRAM(NullBSDF_getBaseColor),
+            VLR_CPU_PROGRAM(NullBSDF_matches),
+            VLR_CPU_PROGRAM(NullBSDF_sampleInternal),
+            VLR_CPU_PROGRAM(NullBSDF_evaluateInternal),
+            VLR_CPU_PROGRAM(NullBSDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(NullBSDF_weightInternal),
+            VLR_CPU_PROGRAM(MatteSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(MatteBRDF_getBaseColor),
+            VLR_CPU_PROGRAM(MatteBRDF_matches),
+            VLR_CPU_PROGRAM(MatteBRDF_sampleInternal),
+            VLR_CPU_PROGRAM(MatteBRDF_evaluateInternal),
+            VLR_CPU_PROGRAM(MatteBRDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(MatteBRDF_weightInternal),
+            VLR_CPU_PROGRAM(SpecularReflectionSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(SpecularBRDF_getBaseColor),
+            VLR_CPU_PROGRAM(SpecularBRDF_matches),
+            VLR_CPU_PROGRAM(SpecularBRDF_sampleInternal),
+            VLR_CPU_PROGRAM(SpecularBRDF_evaluateInternal),
+            VLR_CPU_PROGRAM(SpecularBRDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(SpecularBRDF_weightInternal),
+            VLR_CPU_PROGRAM(SpecularScatteringSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(SpecularBSDF_getBaseColor),
+            VLR_CPU_PROGRAM(SpecularBSDF_matches),
+            VLR_CPU_PROGRAM(SpecularBSDF_sampleInternal),
+            VLR_CPU_PROGRAM(SpecularBSDF_evaluateInternal),
+            VLR_CPU_PROGRAM(SpecularBSDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(SpecularBSDF_weightInternal),
+            VLR_CPU_PROGRAM(MicrofacetReflectionSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_getBaseColor),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_matches),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_sampleInternal),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_evaluateInternal),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(MicrofacetBRDF_weightInternal),
+            VLR_CPU_PROGRAM(MicrofacetScatteringSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_getBaseColor),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_matches),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_sampleInternal),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_evaluateInternal),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(MicrofacetBSDF_weightInternal),
+            VLR_CPU_PROGRAM(LambertianScatteringSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(LambertianBSDF_getBaseColor),
+            VLR_CPU_PROGRAM(LambertianBSDF_matches),
+            VLR_CPU_PROGRAM(LambertianBSDF_sampleInternal),
+            VLR_CPU_PROGRAM(LambertianBSDF_evaluateInternal),
+            VLR_CPU_PROGRAM(LambertianBSDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(LambertianBSDF_weightInternal),
+            VLR_CPU_PROGRAM(UE4SurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(OldStyleSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_getBaseColor),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_matches),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_sampleInternal),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_evaluateInternal),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(DiffuseAndSpecularBRDF_weightInternal),
+            VLR_CPU_PROGRAM(NullEDF_setupEDF),
+            VLR_CPU_PROGRAM(NullEDF_evaluateEmittanceInternal),
+            VLR_CPU_PROGRAM(NullEDF_evaluateInternal),
+            VLR_CPU_PROGRAM(DiffuseEmitterSurfaceMaterial_setupEDF),
+            VLR_CPU_PROGRAM(DiffuseEDF_evaluateEmittanceInternal),
+            VLR_CPU_PROGRAM(DiffuseEDF_evaluateInternal),
+            VLR_CPU_PROGRAM(MultiSurfaceMaterial_setupBSDF),
+            VLR_CPU_PROGRAM(MultiBSDF_getBaseColor),
+            VLR_CPU_PROGRAM(MultiBSDF_matches),
+            VLR_CPU_PROGRAM(MultiBSDF_sampleInternal),
+            VLR_CPU_PROGRAM(MultiBSDF_evaluateInternal),
+            VLR_CPU_PROGRAM(MultiBSDF_evaluatePDFInternal),
+            VLR_CPU_PROGRAM(MultiBSDF_weightInternal),
+            VLR_CPU_PROGRAM(MultiSurfaceMaterial_setupEDF),
+            VLR_CPU_PROGRAM(MultiEDF_evaluateEmittanceInternal),
+            VLR_CPU_PROGRAM(MultiEDF_evaluateInternal),
+            VLR_CPU_PROGRAM(EnvironmentEmitterSurfaceMaterial_setupEDF),
+            VLR_CPU_PROGRAM(EnvironmentEDF_evaluateEmittanceInternal),
+            VLR_CPU_PROGRAM(EnvironmentEDF_evaluateInternal),
+            // shader_nodes.cu
+            VLR_CPU_PROGRAM(GeometryShaderNode_Point3D),
+            VLR_CPU_PROGRAM(GeometryShaderNode_Normal3D),
+            VLR_CPU_PROGRAM(GeometryShaderNode_Vector3D),
+            VLR_CPU_PROGRAM(GeometryShaderNode_textureCoordinates),
+            VLR_CPU_PROGRAM(FloatShaderNode_float),
+            VLR_CPU_PROGRAM(Float2ShaderNode_float),
+            VLR_CPU_PROGRAM(Float2ShaderNode_float2),
+            VLR_CPU_PROGRAM(Float3ShaderNode_float),
+            VLR_CPU_PROGRAM(Float3ShaderNode_float2),
+            VLR_CPU_PROGRAM(Float3ShaderNode_float3),
+            VLR_CPU_PROGRAM(Float4ShaderNode_float),
+            VLR_CPU_PROGRAM(Float4ShaderNode_float2),
+            VLR_CPU_PROGRAM(Float4ShaderNode_float3),
+            VLR_CPU_PROGRAM(Float4ShaderNode_float4),
+            VLR_CPU_PROGRAM(ScaleAndOffsetFloatShaderNode_float),
+            VLR_CPU_PROGRAM(TripletSpectrumShaderNode_spectrum),
+            VLR_CPU_PROGRAM(RegularSampledSpectrumShaderNode_spectrum),
+            VLR_CPU_PROGRAM(IrregularSampledSpectrumShaderNode_spectrum),
+            VLR_CPU_PROGRAM(Vector3DToSpectrumShaderNode_spectrum),
+            VLR_CPU_PROGRAM(ScaleAndOffsetUVTextureMap2DShaderNode_textureCoordinates),
+            VLR_CPU_PROGRAM(Image2DTextureShaderNode_spectrum),
+            VLR_CPU_PROGRAM(Image2DTextureShaderNode_float),
+            VLR_CPU_PROGRAM(Image2DTextureShaderNode_float2),
+            VLR_CPU_PROGRAM(Image2DTextureShaderNode_float3),
+            VLR_CPU_PROGRAM(Image2DTextureShaderNode_float4),
+            VLR_CPU_PROGRAM(EnvironmentTextureShaderNode_spectrum),
+            // cameras.cu
+            VLR_CPU_PROGRAM(PerspectiveCamera_sampleLensPosition),
+            VLR_CPU_PROGRAM(PerspectiveCamera_sampleIDF),
+            VLR_CPU_PROGRAM(EquirectangularCamera_sampleLensPosition),
+            VLR_CPU_PROGRAM(EquirectangularCamera_sampleIDF),
+            // triangle_intersection.cu
+            VLR_CPU_PROGRAM(decodeHitPointForTriangle),
+            VLR_CPU_PROGRAM(decodeTexCoordForTriangle),
+            VLR_CPU_PROGRAM(sampleTriangleMesh),
+            // infinite_sphere_intersection.cu
+            VLR_CPU_PROGRAM(decodeHitPointForInfiniteSphere),
+            VLR_CPU_PROGRAM(decodeTexCoordForInfiniteSphere),
+            VLR_CPU_PROGRAM(sampleInfiniteSphere),
+            // path_tracing.cu
+            VLR_CPU_PROGRAM(pathTracing),
+            VLR_CPU_PROGRAM(pathTracingIteration),
+            VLR_CPU_PROGRAM(pathTracingMiss),
+            VLR_CPU_PROGRAM(shadowAnyHitDefault),
+            VLR_CPU_PROGRAM(anyHitWithAlpha),
+            VLR_CPU_PROGRAM(shadowAnyHitWithAlpha),
+            VLR_CPU_PROGRAM(exception),
+        };
+
+#undef VLR_CPU_PROGRAM
+
+        GenericProgram findProgram(const std::string &name) {
+            for (const ProgramEntry &entry : s_programTable) {
+                if (name == entry.name)
+                    return entry.program;
+            }
+            return nullptr;
+        }
+
+
+
+        static thread_local const KernelParameters* t_params;
+        static thread_local const GeometryInstance* t_curInstance;
+        static thread_local bool t_ignoreIntersection;
+        static thread_local bool t_terminateRay;
+
+        GenericProgram getProgram(int32_t programID) {
+            VLRAssert(programID >= 0 && (uint32_t)programID < t_params->numPrograms && t_params->programs[programID],
+                      "Program %d is not available on the CPU backend.", programID);
+            return t_params->programs[programID];
+        }
+
+        template <typename T>
+        static BufferView<T, 1> makeBufferView1D(const BufferRef &ref) {
+            return BufferView<T, 1>((T*)ref.data, ref.width);
+        }
+
+        template <typename T>
+        static BufferView<T, 2> makeBufferView2D(const BufferRef &ref) {
+            return BufferView<T, 2>((T*)ref.data, ref.width, ref.height);
+        }
+
+        static void setCurrentInstance(const GeometryInstance* inst, const HitPointParameter &hpParam) {
+            t_curInstance = inst;
+            a_hitPointParam = hpParam;
+            if (!inst)
+                return;
+
+            pv_vertexBuffer = makeBufferView1D<Vertex>(inst->vertexBuffer);
+            pv_triangleBuffer = makeBufferView1D<Shared::Triangle>(inst->triangleBuffer);
+            pv_sumImportances = inst->sumImportances;
+            pv_progDecodeTexCoord = ProgSigDecodeTexCoord(inst->progDecodeTexCoord);
+            pv_progDecodeHitPoint = ProgSigDecodeHitPoint(inst->progDecodeHitPoint);
+            pv_tangentType = inst->tangentType;
+            pv_nodeNormal = inst->nodeNormal;
+            pv_nodeAlpha = inst->nodeAlpha;
+            pv_materialIndex = inst->materialIndex;
+            pv_importance = inst->importance;
+        }
+
+        static HitPointParameter makeHitPointParameter(uint32_t primIndex, float b1, float b2) {
+            HitPointParameter ret;
+            ret.b0 = 1.0f - b1 - b2;
+            ret.b1 = b1;
+            ret.primIndex = primIndex;
+            return ret;
+        }
+
+        // JP: Any Hitプログラムを呼び出し、rtIgnoreIntersection()/rtTerminateRay()の結果を返す。
+        // EN: call an any hit program and return the result of rtIgnoreIntersection()/rtTerminateRay().
+        static AnyHitResult callAnyHitProgram(void (*program)()) {
+            t_ignoreIntersection = false;
+            t_terminateRay = false;
+            program();
+            if (t_ignoreIntersection)
+                return AnyHitResult::Ignore;
+            return t_terminateRay ? AnyHitResult::AcceptAndTerminate : AnyHitResult::Accept;
+        }
+
+        // JP: OptiXと同様に、レイトレースの呼び出しの前後で現在のレイとヒット情報を保存・復元する。
+        // EN: Save and restore the current ray and hit information around a trace call as OptiX does.
+        struct TraceStateGuard {
+            optix::Ray ray;
+            const GeometryInstance* instance;
+            HitPointParameter hpParam;
+
+            TraceStateGuard() : ray(sm_ray), instance(t_curInstance), hpParam(a_hitPointParam) {}
+            ~TraceStateGuard() {
+                sm_ray = ray;
+                setCurrentInstance(instance, hpParam);
+            }
+        };
+
+        static void traceRay(const Scene &scene, const optix::Ray &ray, Payload &payload) {
+            TraceStateGuard guard;
+            sm_ray = ray;
+            sm_payload = payload;
+
+            auto anyHit = [&scene](const Triangle &prim, float t, float b1, float b2) {
+                const GeometryInstance &inst = scene.getInstance(prim.instIndex);
+                if (!inst.nodeAlpha.isValid())
+                    return AnyHitResult::Accept;
+                setCurrentInstance(&inst, makeHitPointParameter(prim.primIndex, b1, b2));
+                return callAnyHitProgram(&anyHitWithAlpha);
+            };
+
+            RayHit isect;
+            if (scene.getAccelerator().intersect(asPoint3D(ray.origin), asVector3D(ray.direction), ray.tmin, ray.tmax, anyHit, &isect)) {
+                setCurrentInstance(&scene.getInstance(isect.instIndex), makeHitPointParameter(isect.primIndex, isect.b1, isect.b2));
+                sm_ray.tmax = isect.t;
+                pathTracingIteration();
+            }
+            else {
+                pathTracingMiss();
+            }
+
+            payload = sm_payload;
+        }
+
+        static void traceRay(const Scene &scene, const optix::Ray &ray, ShadowPayload &payload) {
+            TraceStateGuard guard;
+            sm_ray = ray;
+            sm_shadowPayload = payload;
+
+            auto anyHit = [&scene](const Triangle &prim, float t, float b1, float b2) {
+                const GeometryInstance &inst = scene.getInstance(prim.instIndex);
+                setCurrentInstance(&inst, makeHitPointParameter(prim.primIndex, b1, b2));
+                return callAnyHitProgram(inst.nodeAlpha.isValid() ? &shadowAnyHitWithAlpha : &shadowAnyHitDefault);
+            };
+
+            RayHit isect;
+            scene.getAccelerator().intersect(asPoint3D(ray.origin), asVector3D(ray.direction), ray.tmin, ray.tmax, anyHit, &isect);
+
+            payload = sm_shadowPayload;
+        }
+
+
+
+        static void setupKernelVariables(const KernelParameters &params) {
+            t_params = &params;
+            t_curInstance = nullptr;
+
+            pv_nodeProcedureSetBuffer = makeBufferView1D<NodeProcedureSet>(params.nodeProcedureSetBuffer);
+            pv_nodeDescriptorBuffer = makeBufferView1D<NodeDescriptor>(params.nodeDescriptorBuffer);
+            pv_spectrumNodeDescriptorBuffer = makeBufferView1D<SpectrumNodeDescriptor>(params.spectrumNodeDescriptorBuffer);
+            pv_bsdfProcedureSetBuffer = makeBufferView1D<BSDFProcedureSet>(params.bsdfProcedureSetBuffer);
+            pv_edfProcedureSetBuffer = makeBufferView1D<EDFProcedureSet>(params.edfProcedureSetBuffer);
+            pv_materialDescriptorBuffer = makeBufferView1D<SurfaceMaterialDescriptor>(params.materialDescriptorBuffer);
+
+            pv_topGroup = params.topGroup;
+            pv_lightImpDist = params.lightImpDist;
+            pv_surfaceLightDescriptorBuffer = makeBufferView1D<SurfaceLightDescriptor>(params.surfaceLightDescriptorBuffer);
+            pv_envLightDescriptor = params.envLightDescriptor;
+
+            pv_perspectiveCamera = params.perspectiveCamera;
+            pv_equirectangularCamera = params.equirectangularCamera;
+            pv_progSampleLensPosition = ProgSigSampleLensPosition(params.progSampleLensPosition);
+            pv_progSampleIDF = ProgSigSampleIDF(params.progSampleIDF);
+
+            pv_imageSize = params.imageSize;
+            pv_numAccumFrames = params.numAccumFrames;
+            pv_outputBuffer = makeBufferView2D<SpectrumStorage>(params.outputBuffer);
+            pv_compactOutputBuffer = makeBufferView2D<CompactXYZStorage>(params.compactOutputBuffer);
+            pv_accumulationFormat = params.accumulationFormat;
+            pv_pixelStatisticsBuffer = makeBufferView2D<PixelStatistics>(params.pixelStatisticsBuffer);
+            pv_adaptiveSampling = params.adaptiveSampling;
+        }
+
+        void pathTracing(const KernelParameters &params, const optix::uint2 &minIndex, const optix::uint2 &maxIndex, uint64_t rngSeed) {
+            setupKernelVariables(params);
+
+            KernelRNG rng(rngSeed);
+            for (uint32_t y = minIndex.y; y < maxIndex.y; ++y) {
+                for (uint32_t x = minIndex.x; x < maxIndex.x; ++x) {
+                    sm_launchIndex = optix::make_uint2(x, y);
+                    samplePath(sm_launchIndex, rng);
+                }
+            }
+        }
+
+
+
+        // JP: ウェーブフロント積分器で扱うパスの状態。
+        // EN: State of a path handled by the wavefront integrator.
+        struct WavefrontPath {
+            Payload payload;
+            optix::Ray ray;
+            optix::uint2 launchIndex;
+            WavelengthSamples initWavelengths;
+            uint32_t pathLength;
+        };
+
+        struct WavefrontHit {
+            uint32_t materialIndex;
+            uint32_t instIndex;
+            uint32_t primIndex;
+            uint32_t pathIndex;
+            float b1, b2;
+            float t;
+
+            bool operator<(const WavefrontHit &r) const {
+                if (materialIndex != r.materialIndex)
+                    return materialIndex < r.materialIndex;
+                if (instIndex != r.instIndex)
+                    return instIndex < r.instIndex;
+                return primIndex < r.primIndex;
+            }
+        };
+
+        // JP: 遅延された次のイベント推定のシャドウレイ。可視な場合にcontributionがパスに加算される。
+        // EN: Deferred shadow ray of next event estimation. contribution is added to the path when it is visible.
+        struct WavefrontShadowRay : NextEventShadowRay {
+            uint32_t pathIndex;
+        };
+
+        // JP: スレッドごとのキュー。タイル間でメモリーを再利用する。
+        // EN: Per-thread queues. Memory is reused across tiles.
+        struct WavefrontQueues {
+            std::vector<WavefrontPath> paths;
+            std::vector<uint32_t> activePathIndices;
+            std::vector<WavefrontHit> hits;
+            std::vector<uint32_t> missPathIndices;
+            std::vector<WavefrontShadowRay> shadowRays;
+            std::vector<Ray> rays;
+            std::vector<RayHit> rayHits;
+        };
+
+        static thread_local WavefrontQueues t_wavefrontQueues;
+
+        static Ray asTraversalRay(const optix::Ray &ray) {
+            Ray ret;
+            ret.org = asPoint3D(ray.origin);
+            ret.dir = asVector3D(ray.direction);
+            ret.tmin = ray.tmin;
+            ret.tmax = ray.tmax;
+            return ret;
+        }
+
+        // JP: アルファテストを行うインスタンスが無い場合は8本ずつのパケットでトレースする。
+        // EN: Trace in packets of 8 rays when there is no instance performing alpha testing.
+        static void tracePackets(const Scene &scene, WavefrontQueues &queues) {
+            const uint32_t NumRaysInPacket = 8;
+            uint32_t numRays = (uint32_t)queues.rays.size();
+            queues.rayHits.resize(numRays);
+            for (uint32_t i = 0; i < numRays; i += NumRaysInPacket)
+                scene.getAccelerator().intersectPacket(&queues.rays[i], std::min(NumRaysInPacket, numRays - i), &queues.rayHits[i]);
+        }
+
+        static void traceClosestHits(const Scene &scene, WavefrontQueues &queues) {
+            queues.hits.clear();
+            queues.missPathIndices.clear();
+
+            auto addResult = [&scene, &queues](uint32_t pathIndex, const RayHit &isect) {
+                if (isect.instIndex == InvalidIndex) {
+                    queues.missPathIndices.push_back(pathIndex);
+                    return;
+                }
+                WavefrontHit hit;
+                hit.materialIndex = scene.getInstance(isect.instIndex).materialIndex;
+                hit.instIndex = isect.instIndex;
+                hit.primIndex = isect.primIndex;
+                hit.pathIndex = pathIndex;
+                hit.b1 = isect.b1;
+                hit.b2 = isect.b2;
+                hit.t = isect.t;
+                queues.hits.push_back(hit);
+            };
+
+            if (!scene.hasAlphaInstances()) {
+                queues.rays.clear();
+                for (uint32_t pathIndex : queues.activePathIndices)
+                    queues.rays.push_back(asTraversalRay(queues.paths[pathIndex].ray));
+                tracePackets(scene, queues);
+                for (uint32_t i = 0; i < queues.activePathIndices.size(); ++i)
+                    addResult(queues.activePathIndices[i], queues.rayHits[i]);
+                return;
+            }
+
+            auto anyHit = [&scene](const Triangle &prim, float t, float b1, float b2) {
+                const GeometryInstance &inst = scene.getInstance(prim.instIndex);
+                if (!inst.nodeAlpha.isValid())
+                    return AnyHitResult::Accept;
+                setCurrentInstance(&inst, makeHitPointParameter(prim.primIndex, b1, b2));
+                return callAnyHitProgram(&anyHitWithAlpha);
+            };
+
+            for (uint32_t pathIndex : queues.activePathIndices) {
+                WavefrontPath &path = queues.paths[pathIndex];
+                const optix::Ray &ray = path.ray;
+
+                // JP: アルファテストのAny Hitプログラムはペイロードの乱数、波長とレイの錐だけを参照する。
+                // EN: The any hit program for alpha testing refers only to the random number generator, wavelengths and ray cone of the payload.
+                sm_ray = ray;
+                sm_payload.rng = path.payload.rng;
+                sm_payload.wls = path.payload.wls;
+                sm_payload.cone = path.payload.cone;
+
+                RayHit isect;
+                if (!scene.getAccelerator().intersect(asPoint3D(ray.origin), asVector3D(ray.direction), ray.tmin, ray.tmax, anyHit, &isect))
+                    isect.instIndex = InvalidIndex;
+                path.payload.rng = sm_payload.rng;
+
+                addResult(pathIndex, isect);
+            }
+        }
+
+        static void traceShadowRays(const Scene &scene, WavefrontQueues &queues) {
+            if (!scene.hasAlphaInstances()) {
+                queues.rays.clear();
+                for (const WavefrontShadowRay &shadowRay : queues.shadowRays)
+                    queues.rays.push_back(asTraversalRay(shadowRay.ray));
+                tracePackets(scene, queues);
+                for (uint32_t i = 0; i < queues.shadowRays.size(); ++i) {
+                    const WavefrontShadowRay &shadowRay = queues.shadowRays[i];
+                    if (queues.rayHits[i].instIndex == InvalidIndex)
+                        queues.paths[shadowRay.pathIndex].payload.contribution += shadowRay.contribution;
+                }
+                return;
+            }
+
+            auto anyHit = [&scene](const Triangle &prim, float t, float b1, float b2) {
+                const GeometryInstance &inst = scene.getInstance(prim.instIndex);
+                setCurrentInstance(&inst, makeHitPointParameter(prim.primIndex, b1, b2));
+                return callAnyHitProgram(inst.nodeAlpha.isValid() ? &shadowAnyHitWithAlpha : &shadowAnyHitDefault);
+            };
+
+            for (const WavefrontShadowRay &shadowRay : queues.shadowRays) {
+                const optix::Ray &ray = shadowRay.ray;
+                sm_ray = ray;
+                sm_shadowPayload.wls = shadowRay.wls;
+                sm_shadowPayload.fractionalVisibility = 1.0f;
+
+                RayHit isect;
+                scene.getAccelerator().intersect(asPoint3D(ray.origin), asVector3D(ray.direction), ray.tmin, ray.tmax, anyHit, &isect);
+
+                float fractionalVisibility = sm_shadowPayload.fractionalVisibility;
+                if (fractionalVisibility > 0)
+                    queues.paths[shadowRay.pathIndex].payload.contribution += shadowRay.contribution * fractionalVisibility;
+            }
+        }
+
+        // JP: ヒットをマテリアルごとのキューに並べ替え、キュー単位でシェーディングする。
+        //     同じキュー内では同じBSDF/EDFのプロシージャーが続けて呼ばれるため、分岐予測と命令キャッシュの効率が良い。
+        // EN: Sort hits into per-material queues, then shade queue by queue.
+        //     The same BSDF/EDF procedures are called in succession in a queue, which is friendly to branch prediction and instruction cache.
+        static void shadeHits(const Scene &scene, WavefrontQueues &queues) {
+            std::sort(queues.hits.begin(), queues.hits.end());
+
+            queues.shadowRays.clear();
+            for (uint32_t queueStart = 0; queueStart < queues.hits.size();) {
+                uint32_t materialIndex = queues.hits[queueStart].materialIndex;
+                const SurfaceMaterialDescriptor matDesc = pv_materialDescriptorBuffer[materialIndex];
+
+                uint32_t i = queueStart;
+                for (; i < queues.hits.size() && queues.hits[i].materialIndex == materialIndex; ++i) {
+                    const WavefrontHit &hit = queues.hits[i];
+                    WavefrontPath &path = queues.paths[hit.pathIndex];
+
+                    setCurrentInstance(&scene.getInstance(hit.instIndex), makeHitPointParameter(hit.primIndex, hit.b1, hit.b2));
+                    sm_ray = path.ray;
+                    sm_ray.tmax = hit.t;
+                    sm_payload = path.payload;
+
+                    // JP: pathTracingIteration()と同じシェーディングを行うが、シャドウレイはまとめてトレースするために遅延させる。
+                    //     マテリアル記述子はキュー内で共通なので一度だけ読む。
+                    // EN: Perform the same shading as pathTracingIteration() but defer the shadow ray to trace it together.
+                    //     The material descriptor is common in a queue, so it is read only once.
+                    WavefrontShadowRay shadowRay;
+                    if (shadeSurfaceHit(matDesc, &shadowRay)) {
+                        shadowRay.pathIndex = hit.pathIndex;
+                        queues.shadowRays.push_back(shadowRay);
+                    }
+
+                    path.payload = sm_payload;
+                }
+                queueStart = i;
+            }
+
+            setCurrentInstance(nullptr, HitPointParameter());
+            for (uint32_t pathIndex : queues.missPathIndices) {
+                WavefrontPath &path = queues.paths[pathIndex];
+                sm_ray = path.ray;
+                sm_payload = path.payload;
+                pathTracingMiss();
+                path.payload = sm_payload;
+            }
+        }
+
+        void wavefrontPathTracing(const KernelParameters &params, const optix::uint2 &minIndex, const optix::uint2 &maxIndex, uint64_t rngSeed) {
+            setupKernelVariables(params);
+            const Scene &scene = *params.topGroup;
+            WavefrontQueues &queues = t_wavefrontQueues;
+
+            // JP: 矩形内の全画素についてカメラレイを生成する。
+            //     パスは同時に生きているので、各パスの乱数はスレッドの乱数から生成した状態で初期化する。
+            // EN: Generate camera rays for all the pixels in the rectangle.
+            //     Paths are alive at the same time, so the random number generator of each path is initialized with a state generated from the thread's one.
+            KernelRNG rng(rngSeed);
+            queues.paths.clear();
+            queues.activePathIndices.clear();
+            for (uint32_t y = minIndex.y; y < maxIndex.y; ++y) {
+                for (uint32_t x = minIndex.x; x < maxIndex.x; ++x) {
+                    WavefrontPath path;
+                    path.launchIndex = optix::make_uint2(x, y);
+                    if (!beginPixelSample(path.launchIndex))
+                        continue;
+                    uint64_t pathSeed = (uint64_t)rng() << 32;
+                    pathSeed |= rng();
+                    generateCameraRay(path.launchIndex, KernelRNG(pathSeed), &path.ray, &path.payload);
+                    path.initWavelengths = path.payload.wls;
+                    path.pathLength = 0;
+                    queues.activePathIndices.push_back((uint32_t)queues.paths.size());
+                    queues.paths.push_back(path);
+                }
+            }
+
+            // JP: 全パスが終了するまで、トレース、シェーディング、シャドウレイのトレースを段階ごとにまとめて行う。
+            // EN: Perform tracing, shading and shadow ray tracing stage by stage for all paths until every path terminates.
+            while (!queues.activePathIndices.empty()) {
+                for (uint32_t pathIndex : queues.activePathIndices) {
+                    WavefrontPath &path = queues.paths[pathIndex];
+                    path.payload.terminate = true;
+                    ++path.pathLength;
+                    if (path.pathLength >= MaxPathLength)
+                        path.payload.maxLengthTerminate = true;
+                }
+
+                traceClosestHits(scene, queues);
+                shadeHits(scene, queues);
+                traceShadowRays(scene, queues);
+
+                uint32_t numActivePaths = 0;
+                for (uint32_t pathIndex : queues.activePathIndices) {
+                    WavefrontPath &path = queues.paths[pathIndex];
+                    if (path.payload.terminate)
+                        continue;
+                    VLRAssert(path.pathLength < MaxPathLength, "Path should be terminated... Something went wrong...");
+
+                    path.ray = optix::make_Ray(asOptiXType(path.payload.origin), asOptiXType(path.payload.direction), RayType::Scattered, 0.0f, FLT_MAX);
+                    queues.activePathIndices[numActivePaths++] = pathIndex;
+                }
+                queues.activePathIndices.resize(numActivePaths);
+            }
+
+            for (const WavefrontPath &path : queues.paths)
+                accumulatePixelSample(path.launchIndex, path.initWavelengths, path.payload.contribution);
+        }
+        VLR_RENDERING_MODE_NAMESPACE_END
+
+
+
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+        const KernelSet &getSpectralKernelSet() {
+#else
+        const KernelSet &getRGBKernelSet() {
+#endif
+            static const KernelSet kernelSet = { &findProgram, &pathTracing, &wavefrontPathTracing };
+            return kernelSet;
+        }
+    }
+
+
+
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
+    template <typename PayloadType>
+    void rtTrace(rtObject topObject, const optix::Ray &ray, PayloadType &payload) {
+        VLRAssert(topObject, "Top object is null.");
+        CPU::traceRay(*topObject, ray, payload);
+    }
+
+    void rtIgnoreIntersection() {
+        CPU::t_ignoreIntersection = true;
+    }
+
+    void rtTerminateRay() {
+        CPU::t_terminateRay = true;
+    }
+
+    static const Shared::StaticTransform &getCurrentTransform(RTtransformkind kind) {
+        VLRAssert(CPU::t_curInstance, "There is no current instance.");
+        return kind == RT_OBJECT_TO_WORLD ? CPU::t_curInstance->objectToWorld : CPU::t_curInstance->worldToObject;
+    }
+
+    optix::float3 rtTransformPoint(RTtransformkind kind, const optix::float3 &p) {
+        return asOptiXType(getCurrentTransform(kind) * asPoint3D(p));
+    }
+
+    optix::float3 rtTransformVector(RTtransformkind kind, const optix::float3 &v) {
+        return asOptiXType(getCurrentTransform(kind) * asVector3D(v));
+    }
+
+    optix::float3 rtTransformNormal(RTtransformkind kind, const optix::float3 &n) {
+        return asOptiXType(getCurrentTransform(kind) * asNormal3D(n));
+    }
+    VLR_RENDERING_MODE_NAMESPACE_END
+}
@@ -0,0 +1,6 @@
+﻿// JP: スペクトルレンダリング用にカーネルをコンパイルする。
+//     モードに依存する定義はインライン名前空間に入るので、kernels.cppの定義とは衝突しない。
+// EN: Compile the kernels for spectral rendering.
+//     Mode-dependent definitions go into an inline namespace, so they do not conflict with the definitions of kernels.cpp.
+#define VLR_USE_SPECTRAL_RENDERING
+#include "kernels.cpp"
@@ -0,0 +1,156 @@
+﻿#pragma once
+
+// JP: GPU_kernels以下のカーネルをホストコンパイラーでコンパイルしてCPUバックエンドから使うための
+//     OptiXデバイスAPIの最小限のエミュレーション。
+//     このヘッダーはkernel_common.cuhからホストコンパイル時のみインクルードされる。
+// EN: Minimal emulation of the OptiX device API to compile the kernels under GPU_kernels with the host compiler
+//     and use them from the CPU backend.
+//     This header is included from kernel_common.cuh only when compiling for the host.
+
+#include "../shared/shared.h"
+
+#if !defined(RT_PROGRAM)
+#   define RT_PROGRAM
+#endif
+#if !defined(RT_CALLABLE_PROGRAM)
+#   define RT_CALLABLE_PROGRAM
+#endif
+
+// JP: カーネルのグローバル変数はワーカースレッドごとの状態として扱う。
+//     セマンティクスやアノテーションはCPUバックエンド側で明示的に扱う。
+// EN: Treat the global variables of the kernels as per-worker-thread state.
+//     The CPU backend explicitly handles the semantics and annotations.
+#if !defined(rtDeclareVariable)
+#   define rtDeclareVariable(type, name, semantic, annotation) thread_local type name
+#endif
+#define rtBuffer thread_local VLR::CPU::BufferView
+
+namespace VLR {
+    namespace CPU {
+        class Scene;
+
+        typedef void (*GenericProgram)();
+
+        VLR_RENDERING_MODE_NAMESPACE_BEGIN
+        // JP: OptiXのプログラムIDに対応するホスト関数を取得する。
+        // EN: get the host function corresponding to an OptiX program ID.
+        GenericProgram getProgram(int32_t programID);
+        VLR_RENDERING_MODE_NAMESPACE_END
+
+        optix::float4 fetchTexture2D(int32_t textureID, float x, float y, float level);
+
+
+
+        template <typename T, int Dim = 1>
+        class BufferView;
+
+        template <typename T>
+        class BufferView<T, 1> {
+            T* m_data;
+            uint32_t m_size;
+
+        public:
+            BufferView() : m_data(nullptr), m_size(0) {}
+            BufferView(T* data, uint32_t size) : m_data(data), m_size(size) {}
+
+            T &operator[](uint32_t index) const {
+                VLRAssert(index < m_size, "Out of bounds: %u >= %u", index, m_size);
+                return m_data[index];
+            }
+
+            uint32_t size() const {
+                return m_size;
+            }
+        };
+
+        template <typename T>
+        class BufferView<T, 2> {
+            T* m_data;
+            uint32_t m_width;
+            uint32_t m_height;
+
+        public:
+            BufferView() : m_data(nullptr), m_width(0), m_height(0) {}
+            BufferView(T* data, uint32_t width, uint32_t height) : m_data(data), m_width(width), m_height(height) {}
+
+            T &operator[](const optix::uint2 &index) const {
+                VLRAssert(index.x < m_width && index.y < m_height, "Out of bounds: (%u, %u) >= (%u, %u)", index.x, index.y, m_width, m_height);
+                return m_data[index.y * m_width + index.x];
+            }
+
+            optix::uint2 size() const {
+                return optix::make_uint2(m_width, m_height);
+            }
+        };
+    }
+
+
+
+    // JP: 以下はレンダリングモードごとのカーネルの状態を参照するので、モードごとの名前空間に入れる。
+    // EN: The following refer to the state of the kernels per rendering mode, so put them into the namespace per mode.
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
+    template <typename FunctionType>
+    class rtCallableProgramId;
+
+    template <typename ReturnType, typename... ArgTypes>
+    class rtCallableProgramId<ReturnType(ArgTypes...)> {
+        typedef ReturnType (*FunctionPointer)(ArgTypes...);
+
+        FunctionPointer m_function;
+
+    public:
+        rtCallableProgramId() : m_function(nullptr) {}
+        explicit rtCallableProgramId(int32_t programID) : m_function((FunctionPointer)CPU::getProgram(programID)) {}
+
+        ReturnType operator()(ArgTypes... args) const {
+            VLRAssert(m_function, "Invalid callable program.");
+            return m_function(args...);
+        }
+    };
+
+    // JP: CPUではバインドされたCallable ProgramとIDによるCallable Programを区別する必要がない。
+    // EN: There is no need to distinguish bound callable programs from callable programs by ID on CPU.
+    template <typename FunctionType>
+    using rtCallableProgramX = rtCallableProgramId<FunctionType>;
+
+    typedef const CPU::Scene* rtObject;
+
+
+
+    template <typename PayloadType>
+    void rtTrace(rtObject topObject, const optix::Ray &ray, PayloadType &payload);
+
+    void rtIgnoreIntersection();
+    void rtTerminateRay();
+
+    optix::float3 rtTransformPoint(RTtransformkind kind, const optix::float3 &p);
+    optix::float3 rtTransformVector(RTtransformkind kind, const optix::float3 &v);
+    optix::float3 rtTransformNormal(RTtransformkind kind, const optix::float3 &n);
+    VLR_RENDERING_MODE_NAMESPACE_END
+
+    inline void rtPrintExceptionDetails() {}
+
+    inline float __int_as_float(int32_t x) {
+        float ret;
+        std::memcpy(&ret, &x, sizeof(x));
+        return ret;
+    }
+
+    inline int32_t __float_as_int(float x) {
+        int32_t ret;
+        std::memcpy(&ret, &x, sizeof(x));
+        return ret;
+    }
+
+    using optix::make_float2;
+}
+
+namespace optix {
+    template <typename T>
+    T rtTex2DLod(int32_t textureID, float x, float y, float level);
+
+    template <>
+    inline float4 rtTex2DLod<float4>(int32_t textureID, float x, float y, float level) {
+        return VLR::CPU::fetchTexture2D(textureID, x, y, level);
+    }
+}
@@ -1,6 +1,7 @@
 ﻿#include "kernel_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     // ----------------------------------------------------------------
     // PerspectiveCamera
 
@@ -34,6 +35,7 @@ namespace VLR {
         surfPt.v = ly;
         surfPt.texCoord = TexCoord2D::Zero();
         //surfPt.tc0Direction = Vector3D::Zero();
+        surfPt.texCoordFootprint = 0.0f;
 
         result->areaPDF = lensRadius > 0.0f ? 1.0f / (M_PIf * lensRadius * lensRadius) : 1.0f;
         result->posType = lensRadius > 0.0f ? DirectionType::LowFreq() : DirectionType::Delta0D();
@@ -91,6 +93,7 @@ namespace VLR {
         surfPt.v = 0;
         surfPt.texCoord = TexCoord2D::Zero();
         //surfPt.tc0Direction = Vector3D::Zero();
+        surfPt.texCoordFootprint = 0.0f;
 
         result->areaPDF = 1.0f;
         result->posType = DirectionType::Delta0D();
@@ -111,4 +114,5 @@ namespace VLR {
 
     // END: EquirectangularCamera
     // ----------------------------------------------------------------
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
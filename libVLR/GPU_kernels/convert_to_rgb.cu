@@ -1,21 +1,31 @@
 ﻿#include "../shared/shared.h"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     rtDeclareVariable(optix::uint2, sm_launchIndex, rtLaunchIndex, );
 
-    rtDeclareVariable(uint32_t, pv_numAccumFrames, , );
-
     rtBuffer<SpectrumStorage, 2> pv_spectrumBuffer;
+    rtBuffer<Shared::CompactXYZStorage, 2> pv_compactOutputBuffer;
+    rtDeclareVariable(VLRAccumulationFormat, pv_accumulationFormat, , );
+    rtBuffer<Shared::PixelStatistics, 2> pv_pixelStatisticsBuffer;
     rtBuffer<RGBSpectrum, 2> pv_RGBBuffer;
 
     // Ray Generation Program
     // TODO: port this kernel to ordinary CUDA kernel.
     RT_PROGRAM void convertToRGB() {
-        const DiscretizedSpectrum &spectrum = pv_spectrumBuffer[sm_launchIndex].getValue().result;
         float XYZ[3];
-        spectrum.toXYZ(XYZ);
+        if (pv_accumulationFormat == VLRAccumulationFormat_CompactXYZ) {
+            pv_compactOutputBuffer[sm_launchIndex].getXYZ(XYZ);
+        }
+        else {
+            const DiscretizedSpectrum &spectrum = pv_spectrumBuffer[sm_launchIndex].getValue().result;
+            spectrum.toXYZ(XYZ);
+        }
         VLRAssert(XYZ[0] >= 0.0f && XYZ[1] >= 0.0f && XYZ[2] >= 0.0f, "each value of XYZ must not be negative.");
-        float recNumAccums = 1.0f / pv_numAccumFrames;
+        // JP: 適応サンプリングによって画素ごとにサンプル数が異なる。
+        // EN: The number of samples differs per pixel due to adaptive sampling.
+        uint32_t numSamples = pv_pixelStatisticsBuffer[sm_launchIndex].numSamples;
+        float recNumAccums = numSamples > 0 ? 1.0f / numSamples : 0.0f;
         XYZ[0] *= recNumAccums;
         XYZ[1] *= recNumAccums;
         XYZ[2] *= recNumAccums;
@@ -24,4 +34,5 @@ namespace VLR {
         transformTristimulus(mat_XYZ_to_Rec709_D65, XYZ, RGB);
         pv_RGBBuffer[sm_launchIndex] = RGBSpectrum(RGB[0], RGB[1], RGB[2]); // not clamp out of gamut color.
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -1,6 +1,7 @@
 ﻿#include "light_transport_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     struct DebugRenderingPayload {
         TripletSpectrum value;
     };
@@ -15,6 +16,9 @@ namespace VLR {
     rtDeclareVariable(ProgSigSampleIDF, pv_progSampleIDF, , );
     rtBuffer<KernelRNG, 2> pv_rngBuffer;
     rtBuffer<SpectrumStorage, 2> pv_outputBuffer;
+    rtBuffer<CompactXYZStorage, 2> pv_compactOutputBuffer;
+    rtDeclareVariable(VLRAccumulationFormat, pv_accumulationFormat, , );
+    rtBuffer<PixelStatistics, 2> pv_pixelStatisticsBuffer;
 
 
 
@@ -84,7 +88,7 @@ namespace VLR {
     RT_PROGRAM void debugRenderingClosestHit() {
         SurfacePoint surfPt;
         float hypAreaPDF;
-        calcSurfacePoint(&surfPt, &hypAreaPDF);
+        calcSurfacePoint(RayCone(), &surfPt, &hypAreaPDF);
 
         sm_debugPayload.value = surfacePointAttributeToSpectrum(surfPt, pv_surfacePointAttribute);
     }
@@ -120,6 +124,7 @@ namespace VLR {
         surfPt.u = phi;
         surfPt.v = theta;
         surfPt.texCoord = TexCoord2D(phi / (2 * M_PIf), theta / M_PIf);
+        surfPt.texCoordFootprint = 0.0f;
 
         float hypAreaPDF = evaluateEnvironmentAreaPDF(phi, theta);
 
@@ -154,9 +159,23 @@ namespace VLR {
         rtTrace(pv_topGroup, ray, payload);
         pv_rngBuffer[sm_launchIndex] = rng;
 
-        if (pv_numAccumFrames == 1)
-            pv_outputBuffer[sm_launchIndex].reset();
-        pv_outputBuffer[sm_launchIndex].add(wls, payload.value.evaluate(wls));
+        if (pv_numAccumFrames == 1) {
+            if (pv_accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+                pv_compactOutputBuffer[sm_launchIndex].reset();
+            else
+                pv_outputBuffer[sm_launchIndex].reset();
+            pv_pixelStatisticsBuffer[sm_launchIndex].reset();
+        }
+        SampledSpectrum value = payload.value.evaluate(wls);
+        SpectrumStorage sample;
+        sample.add(wls, value);
+        float XYZ[3];
+        sample.getValue().result.toXYZ(XYZ);
+        if (pv_accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+            pv_compactOutputBuffer[sm_launchIndex].add(XYZ);
+        else
+            pv_outputBuffer[sm_launchIndex].add(wls, value);
+        pv_pixelStatisticsBuffer[sm_launchIndex].add(XYZ[1]);
     }
 
 
@@ -166,4 +185,5 @@ namespace VLR {
         //uint32_t code = rtGetExceptionCode();
         rtPrintExceptionDetails();
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -1,6 +1,10 @@
 ﻿#include "kernel_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
+    // JP: CPUバックエンドはこれらのプログラムを使わず独自に交差判定を行う。
+    // EN: The CPU backend doesn't use these programs and performs intersection tests on its own.
+#if defined(VLR_Device)
     // Intersection Program for Infinite Sphere
     RT_PROGRAM void intersectInfiniteSphere(int32_t primIdx) {
         float t = FLT_MAX;
@@ -24,6 +28,7 @@ namespace VLR {
         BoundingBox3D* bbox = (BoundingBox3D*)result;
         *bbox = BoundingBox3D(Point3D(-INFINITY), Point3D(INFINITY));
     }
+#endif
 
 
 
@@ -46,6 +51,7 @@ namespace VLR {
         surfPt->v = param.b1;
         surfPt->texCoord = TexCoord2D(phi / (2 * M_PIf), theta / M_PIf);
         //surfPt->tc0Direction = normalize(transform(RT_OBJECT_TO_WORLD, uDirection));
+        surfPt->texCoordFootprint = 0.0f;
 
         // calculate a hypothetical area PDF value in the case where the program sample this point as light.
         *hypAreaPDF = 0;
@@ -95,6 +101,7 @@ namespace VLR {
         surfPt.u = phi;
         surfPt.v = theta;
         surfPt.texCoord = TexCoord2D(phi / (2 * M_PIf), theta / M_PIf);
+        surfPt.texCoordFootprint = 0.0f;
 
         // JP: テクスチャー空間中のPDFを面積に関するものに変換する。
         // EN: convert the PDF in texture space to one with respect to area.
@@ -102,4 +109,5 @@ namespace VLR {
         result->areaPDF = uvPDF / (2 * M_PIf * M_PIf * std::sin(theta));
         result->posType = DirectionType::Emission() | DirectionType::LowFreq();
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
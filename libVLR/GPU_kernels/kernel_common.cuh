@@ -1,9 +1,13 @@
 ﻿#pragma once
 
 #include "../shared/shared.h"
+#if defined(VLR_Host)
+#include "../CPU_kernels/optix_emulation.h"
+#endif
 #include "random_distributions.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     using namespace Shared;
 
 
@@ -54,6 +58,9 @@ namespace VLR {
         float u, v; // Parameters used to identify the point on a surface, not texture coordinates.
         TexCoord2D texCoord;
         Vector3D tc0Direction;
+        // JP: この点でレイの錐が覆う幅をテクスチャー座標で表したもの。テクスチャーのミップレベルの選択に使う。0の場合は最も細かいレベルを使う。
+        // EN: Width covered by the ray cone at this point expressed in texture coordinates. Used to select a mip level of textures. The finest level is used if 0.
+        float texCoordFootprint;
         struct {
             bool isPoint : 1;
             bool atInfinity : 1;
@@ -304,7 +311,7 @@ namespace VLR {
         }
     }
 
-    RT_FUNCTION SampledSpectrum calcNode(ShaderNodeSocketID socket, const TripletSpectrum &defaultValue, const SurfacePoint &surfPt, const WavelengthSamples &wls) {
+    RT_FUNCTION SampledSpectrum calcNode(ShaderNodeSocketID socket, const TripletSpectrumData &defaultValue, const SurfacePoint &surfPt, const WavelengthSamples &wls) {
         if (socket.isValid()) {
             using ProgSigT = rtCallableProgramId<SampledSpectrum(const uint32_t*, uint32_t, const SurfacePoint &, const WavelengthSamples &)>;
 
@@ -324,7 +331,8 @@ namespace VLR {
             return program(data, socket.option, surfPt, wls);
         }
         else {
-            return defaultValue.evaluate(wls);
+            return getTripletSpectrum(defaultValue).evaluate(wls);
         }
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -3,6 +3,7 @@
 #include "kernel_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     // Context-scope Variables
     rtDeclareVariable(rtObject, pv_topGroup, , );
 
@@ -127,6 +128,22 @@ namespace VLR {
 
 
 
+    // JP: テクスチャーのミップレベルを選ぶためにパスに沿って追跡するレイの錐。
+    //     幅はレイの原点での錐の幅、広がり角は錐の全角。
+    // EN: Ray cone tracked along a path to select mip levels of textures.
+    //     The width is that of the cone at the ray origin, and the spread angle is the full angle of the cone.
+    struct RayCone {
+        float width;
+        float spreadAngle;
+
+        RT_FUNCTION RayCone() : width(0.0f), spreadAngle(0.0f) {}
+        RT_FUNCTION RayCone(float w, float angle) : width(w), spreadAngle(angle) {}
+
+        RT_FUNCTION float getWidthAt(float distance) const {
+            return width + spreadAngle * distance;
+        }
+    };
+
     struct Payload {
         struct {
             bool terminate : 1;
@@ -141,6 +158,7 @@ namespace VLR {
         Vector3D direction;
         float prevDirPDF;
         DirectionType prevSampledType;
+        RayCone cone;
     };
 
     struct ShadowPayload {
@@ -208,8 +226,8 @@ namespace VLR {
     // ----------------------------------------------------------------
     // Light
 
-    RT_FUNCTION bool testVisibility(const SurfacePoint &shadingSurfacePoint, const SurfacePoint &lightSurfacePoint,
-                                    Vector3D* shadowRayDir, float* squaredDistance, float* fractionalVisibility) {
+    RT_FUNCTION optix::Ray createShadowRay(const SurfacePoint &shadingSurfacePoint, const SurfacePoint &lightSurfacePoint,
+                                           Vector3D* shadowRayDir, float* squaredDistance) {
         VLRAssert(shadingSurfacePoint.atInfinity == false, "Shading point must be in finite region.");
 
         *shadowRayDir = lightSurfacePoint.calcDirectionFrom(shadingSurfacePoint.position, squaredDistance);
@@ -222,14 +240,18 @@ namespace VLR {
         if (!lightSurfacePoint.atInfinity)
             shadowRay.tmax = std::sqrt(*squaredDistance) * 0.9999f;
 
+        return shadowRay;
+    }
+
+    // JP: 可視な割合を返す。
+    // EN: Return the visible fraction.
+    RT_FUNCTION float traceShadowRay(const optix::Ray &shadowRay) {
         ShadowPayload shadowPayload;
         shadowPayload.wls = sm_payload.wls;
         shadowPayload.fractionalVisibility = 1.0f;
         rtTrace(pv_topGroup, shadowRay, shadowPayload);
 
-        *fractionalVisibility = shadowPayload.fractionalVisibility;
-
-        return *fractionalVisibility > 0;
+        return shadowPayload.fractionalVisibility;
     }
 
     RT_FUNCTION void selectSurfaceLight(float lightSample, SurfaceLight* light, float* lightProb, float* remapped) {
@@ -262,6 +284,16 @@ namespace VLR {
 
 
 
+    // JP: デコードされた点のtexCoordFootprintは単位長さあたりのテクスチャー座標の変化を持つ。
+    //     ヒット点でのレイの錐の幅を掛け、レイが斜めに当たるほどフットプリントを広げる。
+    // EN: texCoordFootprint of a decoded point holds the change of texture coordinates per unit length.
+    //     Multiply it by the width of the ray cone at the hit point, and widen the footprint as the ray hits more obliquely.
+    RT_FUNCTION void applyRayCone(const RayCone &cone, SurfacePoint* surfPt) {
+        float width = cone.getWidthAt(std::sqrt(surfPt->calcSquaredDistance(asPoint3D(sm_ray.origin))));
+        float cosTerm = absDot(asVector3D(sm_ray.direction), surfPt->geometricNormal);
+        surfPt->texCoordFootprint *= width / std::fmax(cosTerm, 1e-3f);
+    }
+
     RT_PROGRAM void shadowAnyHitDefault() {
         sm_shadowPayload.fractionalVisibility = 0.0f;
         rtTerminateRay();
@@ -273,6 +305,7 @@ namespace VLR {
         SurfacePoint surfPt;
         float hypAreaPDF;
         pv_progDecodeHitPoint(hitPointParam, &surfPt, &hypAreaPDF);
+        applyRayCone(sm_payload.cone, &surfPt);
 
         float alpha = calcNode(pv_nodeAlpha, 1.0f, surfPt, sm_payload.wls);
 
@@ -287,6 +320,7 @@ namespace VLR {
         SurfacePoint surfPt;
         float hypAreaPDF;
         pv_progDecodeHitPoint(hitPointParam, &surfPt, &hypAreaPDF);
+        applyRayCone(RayCone(), &surfPt);
 
         float alpha = calcNode(pv_nodeAlpha, 1.0f, surfPt, sm_shadowPayload.wls);
 
@@ -376,11 +410,13 @@ namespace VLR {
 
 
 
-    RT_FUNCTION void calcSurfacePoint(SurfacePoint* surfPt, float* hypAreaPDF) {
+    RT_FUNCTION void calcSurfacePoint(const RayCone &cone, SurfacePoint* surfPt, float* hypAreaPDF) {
         HitPointParameter hitPointParam = a_hitPointParam;
         pv_progDecodeHitPoint(hitPointParam, surfPt, hypAreaPDF);
+        applyRayCone(cone, surfPt);
 
         modifyTangent(surfPt);
         applyBumpMapping(fetchNormal(*surfPt), surfPt);
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -1,26 +1,44 @@
 ﻿#include "light_transport_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     // Context-scope Variables
     rtDeclareVariable(optix::uint2, pv_imageSize, , );
     rtDeclareVariable(uint32_t, pv_numAccumFrames, , );
+    rtDeclareVariable(uint64_t, pv_sampleIndex, , );
     rtDeclareVariable(ProgSigSampleLensPosition, pv_progSampleLensPosition, , );
     rtDeclareVariable(ProgSigSampleIDF, pv_progSampleIDF, , );
     rtBuffer<KernelRNG, 2> pv_rngBuffer;
     rtBuffer<SpectrumStorage, 2> pv_outputBuffer;
-
-
-
-    // Common Closest Hit Program for All Primitive Types and Materials
-    RT_PROGRAM void pathTracingIteration() {
+    rtBuffer<CompactXYZStorage, 2> pv_compactOutputBuffer;
+    rtDeclareVariable(VLRAccumulationFormat, pv_accumulationFormat, , );
+    rtBuffer<PixelStatistics, 2> pv_pixelStatisticsBuffer;
+    rtDeclareVariable(AdaptiveSamplingParameters, pv_adaptiveSampling, , );
+
+
+
+    // JP: 次のイベント推定のシャドウレイと、光源が可視な場合にパスに加算される寄与。
+    // EN: Shadow ray of next event estimation, and the contribution added to the path when the light is visible.
+    struct NextEventShadowRay {
+        optix::Ray ray;
+        WavelengthSamples wls;
+        SampledSpectrum contribution;
+    };
+
+    // JP: 現在のヒット点のシェーディング。sm_payloadを更新する。
+    //     shadowRayがnullptrの場合は次のイベント推定のシャドウレイをその場でトレースする。
+    //     そうでない場合はトレースせずにshadowRayに返し、シャドウレイがあるかを返り値で示す。
+    // EN: Shading of the current hit point. This updates sm_payload.
+    //     The shadow ray of next event estimation is traced on the spot if shadowRay is nullptr.
+    //     Otherwise it is returned in shadowRay without tracing, and the return value indicates whether there is a shadow ray.
+    RT_FUNCTION bool shadeSurfaceHit(const SurfaceMaterialDescriptor &matDesc, NextEventShadowRay* shadowRay) {
         KernelRNG &rng = sm_payload.rng;
         WavelengthSamples &wls = sm_payload.wls;
 
         SurfacePoint surfPt;
         float hypAreaPDF;
-        calcSurfacePoint(&surfPt, &hypAreaPDF);
+        calcSurfacePoint(sm_payload.cone, &surfPt, &hypAreaPDF);
 
-        const SurfaceMaterialDescriptor matDesc = pv_materialDescriptorBuffer[pv_materialIndex];
         BSDF bsdf(matDesc, surfPt, wls);
         EDF edf(matDesc, surfPt, wls);
 
@@ -42,18 +60,19 @@ namespace VLR {
             sm_payload.contribution += sm_payload.alpha * Le * MISWeight;
         }
         if (surfPt.atInfinity || sm_payload.maxLengthTerminate)
-            return;
+            return false;
 
         // Russian roulette
         float continueProb = std::fmin(sm_payload.alpha.importance(wls.selectedLambdaIndex()) / sm_payload.initImportance, 1.0f);
         if (rng.getFloat0cTo1o() >= continueProb)
-            return;
+            return false;
         sm_payload.alpha /= continueProb;
 
         Normal3D geomNormalLocal = surfPt.shadingFrame.toLocal(surfPt.geometricNormal);
         BSDFQuery fsQuery(dirOutLocal, geomNormalLocal, DirectionType::All(), wls);
 
         // Next Event Estimation (explicit light sampling)
+        bool hasShadowRay = false;
         if (bsdf.hasNonDelta()) {
             SurfaceLight light;
             float lightProb;
@@ -68,27 +87,39 @@ namespace VLR {
             EDF ledf(lightMatDesc, lpResult.surfPt, wls);
             SampledSpectrum M = ledf.evaluateEmittance();
 
-            Vector3D shadowRayDir;
-            float squaredDistance;
-            float fractionalVisibility;
-            if (M.hasNonZero() && testVisibility(surfPt, lpResult.surfPt, &shadowRayDir, &squaredDistance, &fractionalVisibility)) {
-                Vector3D shadowRayDir_l = lpResult.surfPt.toLocal(-shadowRayDir);
-                Vector3D shadowRayDir_sn = surfPt.toLocal(shadowRayDir);
-
-                SampledSpectrum Le = M * ledf.evaluate(EDFQuery(), shadowRayDir_l);
-                float lightPDF = lightProb * lpResult.areaPDF;
-
-                SampledSpectrum fs = bsdf.evaluate(fsQuery, shadowRayDir_sn);
-                float cosLight = lpResult.surfPt.calcCosTerm(-shadowRayDir);
-                float bsdfPDF = bsdf.evaluatePDF(fsQuery, shadowRayDir_sn) * cosLight / squaredDistance;
-
-                float MISWeight = 1.0f;
-                if (!lpResult.posType.isDelta() && !std::isinf(lightPDF))
-                    MISWeight = (lightPDF * lightPDF) / (lightPDF * lightPDF + bsdfPDF * bsdfPDF);
-
-                float G = fractionalVisibility * absDot(shadowRayDir_sn, geomNormalLocal) * cosLight / squaredDistance;
-                float scalarCoeff = G * MISWeight / lightPDF; // 直接contributionの計算式に入れるとCUDAのバグなのかおかしな結果になる。
-                sm_payload.contribution += sm_payload.alpha * Le * fs * scalarCoeff;
+            if (M.hasNonZero()) {
+                Vector3D shadowRayDir;
+                float squaredDistance;
+                optix::Ray nextEventRay = createShadowRay(surfPt, lpResult.surfPt, &shadowRayDir, &squaredDistance);
+                float fractionalVisibility = shadowRay ? 1.0f : traceShadowRay(nextEventRay);
+                if (fractionalVisibility > 0) {
+                    Vector3D shadowRayDir_l = lpResult.surfPt.toLocal(-shadowRayDir);
+                    Vector3D shadowRayDir_sn = surfPt.toLocal(shadowRayDir);
+
+                    SampledSpectrum Le = M * ledf.evaluate(EDFQuery(), shadowRayDir_l);
+                    float lightPDF = lightProb * lpResult.areaPDF;
+
+                    SampledSpectrum fs = bsdf.evaluate(fsQuery, shadowRayDir_sn);
+                    float cosLight = lpResult.surfPt.calcCosTerm(-shadowRayDir);
+                    float bsdfPDF = bsdf.evaluatePDF(fsQuery, shadowRayDir_sn) * cosLight / squaredDistance;
+
+                    float MISWeight = 1.0f;
+                    if (!lpResult.posType.isDelta() && !std::isinf(lightPDF))
+                        MISWeight = (lightPDF * lightPDF) / (lightPDF * lightPDF + bsdfPDF * bsdfPDF);
+
+                    float G = fractionalVisibility * absDot(shadowRayDir_sn, geomNormalLocal) * cosLight / squaredDistance;
+                    float scalarCoeff = G * MISWeight / lightPDF; // 直接contributionの計算式に入れるとCUDAのバグなのかおかしな結果になる。
+                    SampledSpectrum contribution = sm_payload.alpha * Le * fs * scalarCoeff;
+                    if (shadowRay) {
+                        shadowRay->ray = nextEventRay;
+                        shadowRay->wls = wls;
+                        shadowRay->contribution = contribution;
+                        hasShadowRay = contribution.hasNonZero();
+                    }
+                    else {
+                        sm_payload.contribution += contribution;
+                    }
+                }
             }
         }
 
@@ -96,7 +127,7 @@ namespace VLR {
         BSDFQueryResult fsResult;
         SampledSpectrum fs = bsdf.sample(fsQuery, sample, &fsResult);
         if (fs == SampledSpectrum::Zero() || fsResult.dirPDF == 0.0f)
-            return;
+            return hasShadowRay;
         if (fsResult.sampledType.isDispersive() && !wls.singleIsSelected()) {
             fsResult.dirPDF /= SampledSpectrum::NumComponents();
             wls.setSingleIsSelected();
@@ -111,6 +142,21 @@ namespace VLR {
         sm_payload.prevDirPDF = fsResult.dirPDF;
         sm_payload.prevSampledType = fsResult.sampledType;
         sm_payload.terminate = false;
+
+        // JP: レイの錐をヒット点まで進める。デルタ以外の散乱では、サンプルした方向のPDFの逆数を立体角とする錐の角度まで広げる。
+        // EN: Advance the ray cone to the hit point. For non-delta scattering, widen it to the angle of a cone whose solid angle is the reciprocal of the PDF of the sampled direction.
+        RayCone &cone = sm_payload.cone;
+        cone.width = cone.getWidthAt(std::sqrt(surfPt.calcSquaredDistance(asPoint3D(sm_ray.origin))));
+        if (!fsResult.sampledType.isDelta())
+            cone.spreadAngle = std::fmax(cone.spreadAngle, std::fmin(2 / std::sqrt(M_PIf * fsResult.dirPDF), M_PIf));
+
+        return hasShadowRay;
+    }
+
+    // Common Closest Hit Program for All Primitive Types and Materials
+    RT_PROGRAM void pathTracingIteration() {
+        const SurfaceMaterialDescriptor matDesc = pv_materialDescriptorBuffer[pv_materialIndex];
+        shadeSurfaceHit(matDesc, nullptr);
     }
 
 
@@ -144,6 +190,9 @@ namespace VLR {
         surfPt.u = phi;
         surfPt.v = theta;
         surfPt.texCoord = TexCoord2D(phi / (2 * M_PIf), theta / M_PIf);
+        // JP: テクスチャー座標のvは天頂角πに渡るので、錐の広がり角をπで割ったものがフットプリントになる。
+        // EN: v of the texture coordinates spans the polar angle of π, so the spread angle of the cone divided by π becomes the footprint.
+        surfPt.texCoordFootprint = sm_payload.cone.spreadAngle / M_PIf;
 
         float hypAreaPDF = evaluateEnvironmentAreaPDF(phi, theta);
 
@@ -171,11 +220,14 @@ namespace VLR {
 
 
 
-    // Common Ray Generation Program for All Camera Types
-    RT_PROGRAM void pathTracing() {
-        KernelRNG rng = pv_rngBuffer[sm_launchIndex];
+    const uint32_t MaxPathLength = 25;
+
+    // JP: 画素内の位置とレンズ上の位置をサンプルし、カメラから出るレイとパスの初期状態を生成する。
+    // EN: Sample a position in the pixel and on the lens, then generate a ray leaving the camera and the initial path state.
+    RT_FUNCTION void generateCameraRay(const optix::uint2 &launchIndex, const KernelRNG &initRNG, optix::Ray* ray, Payload* payload) {
+        KernelRNG rng = initRNG;
 
-        optix::float2 p = make_float2(sm_launchIndex.x + rng.getFloat0cTo1o(), sm_launchIndex.y + rng.getFloat0cTo1o());
+        optix::float2 p = make_float2(launchIndex.x + rng.getFloat0cTo1o(), launchIndex.y + rng.getFloat0cTo1o());
 
         float selectWLPDF;
         WavelengthSamples wls = WavelengthSamples::createWithEqualOffsets(rng.getFloat0cTo1o(), rng.getFloat0cTo1o(), &selectWLPDF);
@@ -188,20 +240,85 @@ namespace VLR {
         IDFQueryResult We1Result;
         SampledSpectrum We1 = pv_progSampleIDF(We0Result.surfPt, wls, We1Sample, &We1Result);
 
+        // JP: 隣の画素へ向かう方向との角度をレイの錐の広がり角とする。
+        // EN: Regard the angle to the direction toward the adjacent pixel as the spread angle of the ray cone.
+        IDFSample We1AdjacentSample((p.x + 1) / pv_imageSize.x, p.y / pv_imageSize.y);
+        IDFQueryResult We1AdjacentResult;
+        pv_progSampleIDF(We0Result.surfPt, wls, We1AdjacentSample, &We1AdjacentResult);
+        float spreadAngle = std::acos(clamp(dot(We1Result.dirLocal, We1AdjacentResult.dirLocal), -1.0f, 1.0f));
+
         Vector3D rayDir = We0Result.surfPt.fromLocal(We1Result.dirLocal);
         SampledSpectrum alpha = (We0 * We1) * (We0Result.surfPt.calcCosTerm(rayDir) / (We0Result.areaPDF * We1Result.dirPDF * selectWLPDF));
 
-        optix::Ray ray = optix::make_Ray(asOptiXType(We0Result.surfPt.position), asOptiXType(rayDir), RayType::Primary, 0.0f, FLT_MAX);
+        *ray = optix::make_Ray(asOptiXType(We0Result.surfPt.position), asOptiXType(rayDir), RayType::Primary, 0.0f, FLT_MAX);
+
+        payload->maxLengthTerminate = false;
+        payload->rng = rng;
+        payload->initImportance = alpha.importance(wls.selectedLambdaIndex());
+        payload->wls = wls;
+        payload->alpha = alpha;
+        payload->contribution = SampledSpectrum::Zero();
+        payload->cone = RayCone(0.0f, spreadAngle);
+    }
+
+    // JP: 収束した画素でも偏りを避けるため、この間隔のフレームごとにはサンプルする。
+    // EN: Sample even converged pixels every this number of frames to avoid bias.
+    const uint32_t AdaptiveSamplingRevisitInterval = 16;
+
+    // JP: 最初のフレームでは画素の蓄積値をリセットする。
+    //     適応サンプリングが有効な場合、相対誤差が閾値を下回った画素の優先度を下げてサンプルを省略する。
+    // EN: Reset the accumulated values of the pixel in the first frame.
+    //     When adaptive sampling is enabled, deprioritize pixels whose relative error is below the threshold by skipping samples.
+    RT_FUNCTION bool beginPixelSample(const optix::uint2 &launchIndex) {
+        PixelStatistics &pixelStats = pv_pixelStatisticsBuffer[launchIndex];
+        if (pv_numAccumFrames == 1) {
+            if (pv_accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+                pv_compactOutputBuffer[launchIndex].reset();
+            else
+                pv_outputBuffer[launchIndex].reset();
+            pixelStats.reset();
+            return true;
+        }
+
+        if (pv_adaptiveSampling.pixelErrorThreshold <= 0.0f ||
+            pixelStats.numSamples < pv_adaptiveSampling.minNumSamples ||
+            pv_numAccumFrames % AdaptiveSamplingRevisitInterval == 0)
+            return true;
 
+        return pixelStats.calcRelativeError() >= pv_adaptiveSampling.pixelErrorThreshold;
+    }
+
+    RT_FUNCTION void accumulatePixelSample(const optix::uint2 &launchIndex, const WavelengthSamples &wls, const SampledSpectrum &contribution) {
+        if (!contribution.allFinite()) {
+            vlrprintf("Pass %u, (%u, %u): Not a finite value.\n", pv_numAccumFrames, launchIndex.x, launchIndex.y);
+            return;
+        }
+
+        SpectrumStorage sample;
+        sample.add(wls, contribution);
+        float XYZ[3];
+        sample.getValue().result.toXYZ(XYZ);
+
+        // JP: コンパクトな形式ではサンプルのXYZだけを蓄積する。
+        // EN: Accumulate only XYZ of the sample in the compact format.
+        if (pv_accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+            pv_compactOutputBuffer[launchIndex].add(XYZ);
+        else
+            pv_outputBuffer[launchIndex].add(wls, contribution);
+        pv_pixelStatisticsBuffer[launchIndex].add(XYZ[1]);
+    }
+
+    // JP: 1本のパスをトレースして出力バッファーに蓄積する。rngは消費した分だけ進められる。
+    // EN: Trace a path and accumulate it to the output buffer. rng is advanced by the consumed amount.
+    RT_FUNCTION void samplePath(const optix::uint2 &launchIndex, KernelRNG &rng) {
+        if (!beginPixelSample(launchIndex))
+            return;
+
+        optix::Ray ray;
         Payload payload;
-        payload.maxLengthTerminate = false;
-        payload.rng = rng;
-        payload.initImportance = alpha.importance(wls.selectedLambdaIndex());
-        payload.wls = wls;
-        payload.alpha = alpha;
-        payload.contribution = SampledSpectrum::Zero();
-
-        const uint32_t MaxPathLength = 25;
+        generateCameraRay(launchIndex, rng, &ray, &payload);
+        WavelengthSamples wls = payload.wls;
+
         uint32_t pathLength = 0;
         while (true) {
             payload.terminate = true;
@@ -216,15 +333,27 @@ namespace VLR {
 
             ray = optix::make_Ray(asOptiXType(payload.origin), asOptiXType(payload.direction), RayType::Scattered, 0.0f, FLT_MAX);
         }
-        pv_rngBuffer[sm_launchIndex] = payload.rng;
-        if (!payload.contribution.allFinite()) {
-            vlrprintf("Pass %u, (%u, %u): Not a finite value.\n", pv_numAccumFrames, sm_launchIndex.x, sm_launchIndex.y);
-            return;
-        }
+        rng = payload.rng;
+        accumulatePixelSample(launchIndex, wls, payload.contribution);
+    }
+
+    // JP: サンプル番号と画素から乱数のシードを決める。前のフレームの乱数の状態を引き継がないので、
+    //     サンプル番号の範囲が重ならないプロセス間では乱数列も重ならない。
+    // EN: Determine a seed of random numbers from a sample index and a pixel. This doesn't carry over the random number state of the previous frame,
+    //     so random number sequences don't overlap between processes whose ranges of sample indices don't overlap.
+    RT_FUNCTION uint64_t calcPixelSampleSeed(uint64_t sampleIndex, const optix::uint2 &launchIndex) {
+        // SplitMix64
+        uint64_t z = sampleIndex * 0x9E3779B97F4A7C15ULL + ((uint64_t)launchIndex.y << 32 | launchIndex.x) + 591842031321323413ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
 
-        if (pv_numAccumFrames == 1)
-            pv_outputBuffer[sm_launchIndex].reset();
-        pv_outputBuffer[sm_launchIndex].add(wls, payload.contribution);
+    // Common Ray Generation Program for All Camera Types
+    RT_PROGRAM void pathTracing() {
+        KernelRNG rng(calcPixelSampleSeed(pv_sampleIndex, sm_launchIndex));
+        samplePath(sm_launchIndex, rng);
+        pv_rngBuffer[sm_launchIndex] = rng;
     }
 
 
@@ -234,4 +363,5 @@ namespace VLR {
         //uint32_t code = rtGetExceptionCode();
         rtPrintExceptionDetails();
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -3,11 +3,13 @@
 #include "../shared/basic_types_internal.h"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     class PCG32RNG {
         uint64_t state;
 
     public:
         RT_FUNCTION PCG32RNG() {}
+        RT_FUNCTION explicit PCG32RNG(uint64_t seed) : state(seed) {}
 
         RT_FUNCTION uint32_t operator()() {
             uint64_t oldstate = state;
@@ -170,4 +172,5 @@ namespace VLR {
         else
             *b0 -= offset;
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -1,6 +1,7 @@
 ﻿#include "kernel_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     RT_CALLABLE_PROGRAM Point3D GeometryShaderNode_Point3D(const uint32_t* rawNodeData, uint32_t option,
                                                            const SurfacePoint &surfPt, const WavelengthSamples &wls) {
         auto &nodeData = *(const GeometryShaderNode*)rawNodeData;
@@ -164,25 +165,27 @@ namespace VLR {
     RT_CALLABLE_PROGRAM SampledSpectrum TripletSpectrumShaderNode_spectrum(const uint32_t* rawNodeData, uint32_t option,
                                                                            const SurfacePoint &surfPt, const WavelengthSamples &wls) {
         auto &nodeData = *(const TripletSpectrumShaderNode*)rawNodeData;
-        return nodeData.value.evaluate(wls);
+        return getTripletSpectrum(nodeData.value).evaluate(wls);
     }
 
     RT_CALLABLE_PROGRAM SampledSpectrum RegularSampledSpectrumShaderNode_spectrum(const uint32_t* rawNodeData, uint32_t option,
                                                                                   const SurfacePoint &surfPt, const WavelengthSamples &wls) {
-        auto &nodeData = *(const RegularSampledSpectrumShaderNode*)rawNodeData;
 #if defined(VLR_USE_SPECTRAL_RENDERING)
+        auto &nodeData = *(const RegularSampledSpectrumShaderNode*)rawNodeData;
         return RegularSampledSpectrum(nodeData.minLambda, nodeData.maxLambda, nodeData.values, nodeData.numSamples).evaluate(wls);
 #else
+        auto &nodeData = *(const PreconvertedRGBSpectrumShaderNode*)rawNodeData;
         return nodeData.value.evaluate(wls);
 #endif
     }
 
     RT_CALLABLE_PROGRAM SampledSpectrum IrregularSampledSpectrumShaderNode_spectrum(const uint32_t* rawNodeData, uint32_t option,
                                                                                     const SurfacePoint &surfPt, const WavelengthSamples &wls) {
-        auto &nodeData = *(const IrregularSampledSpectrumShaderNode*)rawNodeData;
 #if defined(VLR_USE_SPECTRAL_RENDERING)
+        auto &nodeData = *(const IrregularSampledSpectrumShaderNode*)rawNodeData;
         return IrregularSampledSpectrum(nodeData.lambdas, nodeData.values, nodeData.numSamples).evaluate(wls);
 #else
+        auto &nodeData = *(const PreconvertedRGBSpectrumShaderNode*)rawNodeData;
         return nodeData.value.evaluate(wls);
 #endif
     }
@@ -217,20 +220,60 @@ namespace VLR {
 
 
 
+    // JP: 表面のテクスチャー座標でのフットプリントをテクスチャー座標ノードを通したものに変換し、テクセル数からミップレベルを求める。
+    //     ノードが繋がっている場合は、表面のテクスチャー座標をフットプリント分ずらして評価した差分からノードによる拡大率を求める。
+    // EN: Convert the footprint in texture coordinates of the surface into that through the texture coordinate node, then calculate the mip level from the number of texels.
+    //     When a node is connected, obtain the magnification by the node from the difference of evaluations with the surface texture coordinates shifted by the footprint.
+    RT_FUNCTION float calcTextureLOD(ShaderNodeSocketID nodeTexCoord, const Point3D &texCoord, uint32_t width, uint32_t height,
+                                     const SurfacePoint &surfPt, const WavelengthSamples &wls) {
+        float footprint = surfPt.texCoordFootprint;
+        if (footprint <= 0.0f)
+            return 0.0f;
+
+        if (nodeTexCoord.isValid()) {
+            SurfacePoint shiftedSurfPt = surfPt;
+            shiftedSurfPt.texCoord.u += footprint;
+            Point3D texCoordDu = calcNode(nodeTexCoord, texCoord, shiftedSurfPt, wls);
+            shiftedSurfPt.texCoord = surfPt.texCoord;
+            shiftedSurfPt.texCoord.v += footprint;
+            Point3D texCoordDv = calcNode(nodeTexCoord, texCoord, shiftedSurfPt, wls);
+            footprint = std::sqrt(std::fmax((texCoordDu - texCoord).sqLength(), (texCoordDv - texCoord).sqLength()));
+            if (footprint <= 0.0f)
+                return 0.0f;
+        }
+
+        return std::log2(footprint * std::sqrt((float)width * height));
+    }
+
     RT_CALLABLE_PROGRAM SampledSpectrum Image2DTextureShaderNode_spectrum(const uint32_t* rawNodeData, uint32_t option,
                                                                           const SurfacePoint &surfPt, const WavelengthSamples &wls) {
         auto &nodeData = *(const Image2DTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
         if (nodeData.format == VLRDataFormat_Gray32F ||
             nodeData.format == VLRDataFormat_Gray8 ||
             nodeData.format == VLRDataFormat_GrayA8x2)
             texValue.z = texValue.y = texValue.x;
 
 #if defined(VLR_USE_SPECTRAL_RENDERING)
+        if (nodeData.format == VLRDataFormat_uvsA16Fx4)
+            return UpsampledSpectrum(texValue.x, texValue.y, texValue.z).evaluate(wls);
         return UpsampledSpectrum(nodeData.spectrumType, nodeData.colorSpace, texValue.x, texValue.y, texValue.z).evaluate(wls);
 #else
+        if (nodeData.format == VLRDataFormat_uvsA16Fx4) {
+            // JP: (u, v, s)をXYZに戻す。sはX + Y + Zに当たる。
+            // EN: Convert (u, v, s) back into XYZ. s corresponds to X + Y + Z.
+            float uv[2] = { texValue.x, texValue.y };
+            float xy[2];
+            UpsampledSpectrum::uv_to_xy(uv, xy);
+            float b = texValue.z / UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR * UpsampledSpectrum::EqualEnergyReflectance();
+            float XYZ[3] = { xy[0] * b, xy[1] * b, (1 - xy[0] - xy[1]) * b };
+            float RGB[3];
+            transformToRenderingRGB(nodeData.spectrumType, XYZ, RGB);
+            return SampledSpectrum(std::fmax(0.0f, RGB[0]), std::fmax(0.0f, RGB[1]), std::fmax(0.0f, RGB[2]));
+        }
         return SampledSpectrum(texValue.x, texValue.y, texValue.z); // assume given data is in rendering RGB.
 #endif
     }
@@ -240,7 +283,8 @@ namespace VLR {
         auto &nodeData = *(const Image2DTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
 
         if (option == 0)
             return texValue.x;
@@ -259,7 +303,8 @@ namespace VLR {
         auto &nodeData = *(const Image2DTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
 
         if (option == 0)
             return optix::make_float2(texValue.x, texValue.y);
@@ -276,7 +321,8 @@ namespace VLR {
         auto &nodeData = *(const Image2DTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
 
         if (option == 0)
             return optix::make_float3(texValue.x, texValue.y, texValue.z);
@@ -291,7 +337,8 @@ namespace VLR {
         auto &nodeData = *(const Image2DTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
 
         return texValue;
     }
@@ -303,7 +350,8 @@ namespace VLR {
         auto &nodeData = *(const EnvironmentTextureShaderNode*)rawNodeData;
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, 0.0f);
+        float lod = calcTextureLOD(nodeData.nodeTexCoord, texCoord, nodeData.width, nodeData.height, surfPt, wls);
+        optix::float4 texValue = optix::rtTex2DLod<optix::float4>(nodeData.textureID, texCoord.x, texCoord.y, lod);
 
 #if defined(VLR_USE_SPECTRAL_RENDERING)
         return UpsampledSpectrum(VLRSpectrumType_LightSource, nodeData.colorSpace, texValue.x, texValue.y, texValue.z).evaluate(wls);
@@ -311,4 +359,5 @@ namespace VLR {
         return SampledSpectrum(texValue.x, texValue.y, texValue.z); // assume given data is in rendering RGB.
 #endif
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
@@ -0,0 +1,4 @@
+﻿// JP: スペクトルレンダリング用のPTXを生成する。
+// EN: Generate the PTX for spectral rendering.
+#define VLR_USE_SPECTRAL_RENDERING
+#include "../convert_to_rgb.cu"
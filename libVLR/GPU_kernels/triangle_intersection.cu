@@ -1,12 +1,16 @@
 ﻿#include "kernel_common.cuh"
 
 namespace VLR {
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
     // per GeometryInstance
     // closestHitProgramなどから呼ばれるdecodeHitPoint等で読み出すためにはGeometryInstanceレベルにバインドする必要がある。
     rtBuffer<Vertex> pv_vertexBuffer;
     rtBuffer<Triangle> pv_triangleBuffer;
     rtDeclareVariable(float, pv_sumImportances, , );
 
+    // JP: CPUバックエンドはこれらのプログラムを使わず独自に交差判定を行う。
+    // EN: The CPU backend doesn't use these programs and performs intersection tests on its own.
+#if defined(VLR_Device)
     // Intersection Program
     RT_PROGRAM void intersectTriangle(int32_t primIdx) {
         const Triangle &triangle = pv_triangleBuffer[primIdx];
@@ -58,6 +62,7 @@ namespace VLR {
         a_hitPointParam.b1 = bc.x;
         a_hitPointParam.primIndex = rtGetPrimitiveIndex();
     }
+#endif
 
 
 
@@ -89,6 +94,16 @@ namespace VLR {
         shadingNormal = normalize(transform(RT_OBJECT_TO_WORLD, shadingNormal));
         tc0Direction = normalize(transform(RT_OBJECT_TO_WORLD, tc0Direction));
 
+        // JP: ワールド空間での単位長さあたりのテクスチャー座標の変化を三角形の面積比から求める。
+        //     calcSurfacePoint()がこれにレイの錐の幅を掛けてフットプリントにする。
+        // EN: Calculate the change of texture coordinates per unit length in world space from the area ratio of the triangle.
+        //     calcSurfacePoint() multiplies this by the width of the ray cone to make the footprint.
+        float worldArea = cross(transform(RT_OBJECT_TO_WORLD, v1.position - v0.position),
+                                transform(RT_OBJECT_TO_WORLD, v2.position - v0.position)).length() / 2;
+        float texCoordArea = std::fabs((v1.texCoord.u - v0.texCoord.u) * (v2.texCoord.v - v0.texCoord.v) -
+                                       (v2.texCoord.u - v0.texCoord.u) * (v1.texCoord.v - v0.texCoord.v)) / 2;
+        float texCoordPerLength = worldArea > 0.0f ? std::sqrt(texCoordArea / worldArea) : 0.0f;
+
         // JP: 法線と接線が直交することを保証する。
         //     直交性の消失は重心座標補間によっておこる？
         // EN: guarantee the orthogonality between the normal and tangent.
@@ -105,6 +120,7 @@ namespace VLR {
         surfPt->v = b1;
         surfPt->texCoord = texCoord;
         surfPt->tc0Direction = tc0Direction;
+        surfPt->texCoordFootprint = texCoordPerLength;
     }
 
     // bound
@@ -173,5 +189,7 @@ namespace VLR {
         surfPt.v = b1;
         surfPt.texCoord = texCoord;
         surfPt.tc0Direction = tc0Direction;
+        surfPt.texCoordFootprint = 0.0f;
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
 }
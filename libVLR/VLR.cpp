@@ -1,14 +1,18 @@
 ﻿#pragma once
 
 #include "scene.h"
+#include "tiled_image.h"
+#include "resolve.h"
 
 typedef VLR::Object* VLRObject;
 
 typedef VLR::Context* VLRContext;
+typedef VLR::AccumulationSnapshot* VLRAccumulationSnapshot;
 
 typedef VLR::Image2D* VLRImage2D;
 typedef VLR::LinearImage2D* VLRLinearImage2D;
 typedef VLR::BlockCompressedImage2D* VLRBlockCompressedImage2D;
+typedef VLR::TiledImage2D* VLRTiledImage2D;
 
 typedef VLR::ShaderNode* VLRShaderNode;
 typedef VLR::GeometryShaderNode* VLRGeometryShaderNode;
@@ -130,6 +134,8 @@ VLR_API const char* vlrGetErrorMessage(VLRResult code) {
         return "Invalid Type";
     case VLR_ERROR_INCOMPATIBLE_NODE_TYPE:
         return "Incompatible Node Type";
+    case VLR_ERROR_INVALID_FILE:
+        return "Invalid File";
     default:
         VLRAssert_ShouldNotBeCalled();
         break;
@@ -140,8 +146,8 @@ VLR_API const char* vlrGetErrorMessage(VLRResult code) {
 
 
 
-VLR_API VLRResult vlrCreateContext(VLRContext* context, bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices) {
-    *context = new VLR::Context(logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices);
+VLR_API VLRResult vlrCreateContext(VLRContext* context, bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices, VLRBackend backend, VLRRenderingMode renderingMode) {
+    *context = new VLR::Context(logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices, backend, renderingMode);
 
     return VLR_ERROR_NO_ERROR;
 }
@@ -178,10 +184,142 @@ VLR_API VLRResult vlrContextGetOutputBufferSize(VLRContext context, uint32_t* wi
     return VLR_ERROR_NO_ERROR;
 }
 
-VLR_API VLRResult vlrContextRender(VLRContext context, VLRScene scene, VLRCamera camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames) {
+VLR_API VLRResult vlrContextGetBVHStatistics(VLRContext context, VLRBVHStatistics* stats) {
+    if (!context->getBVHStatistics(stats))
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetCPUIntegrator(VLRContext context, VLRCPUIntegrator integrator) {
+    if (!context->setCPUIntegrator(integrator))
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetCPUTileSize(VLRContext context, uint32_t width, uint32_t height) {
+    if (!context->setCPUTileSize(width, height))
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextGetCPUThreadStatistics(VLRContext context, VLRCPUThreadStatistics* stats, uint32_t maxNumThreads, uint32_t* numThreads) {
+    if (!context->getCPUThreadStatistics(stats, maxNumThreads, numThreads))
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSaveAccumulation(VLRContext context, const char* filepath) {
+    if (!context->saveAccumulation(filepath))
+        return VLR_ERROR_INVALID_FILE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextLoadAccumulation(VLRContext context, const char* filepath) {
+    if (!context->loadAccumulation(filepath))
+        return VLR_ERROR_INVALID_FILE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextMergeAccumulation(VLRContext context, const char* filepath) {
+    if (!context->mergeAccumulation(filepath))
+        return VLR_ERROR_INVALID_FILE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetSampleIndexOffset(VLRContext context, uint32_t offset) {
+    context->setSampleIndexOffset(offset);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetAccumulationFormat(VLRContext context, VLRAccumulationFormat format) {
+    if (!context->setAccumulationFormat(format))
+        return VLR_ERROR_INVALID_TYPE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetImageCacheCapacity(VLRContext context, uint64_t capacity) {
+    context->getImageCache().setCapacity((size_t)capacity);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetTileCacheBudget(VLRContext context, uint64_t budget) {
+    context->getTileCache().setBudget((size_t)budget);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextGetTileCacheStatistics(VLRContext context, VLRTileCacheStatistics* stats) {
+    context->getTileCache().getStatistics(stats);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextSetAdaptiveSampling(VLRContext context, float pixelErrorThreshold, uint32_t minNumSamples, float targetError) {
+    context->setAdaptiveSampling(pixelErrorThreshold, minNumSamples, targetError);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+static bool isValidResolveParameters(const VLRResolveParameters &params) {
+    return (params.format == VLRResolveFormat_LinearRGB || params.format == VLRResolveFormat_HalfRGBA || params.format == VLRResolveFormat_SRGB8) &&
+        (params.tonemapOperator == VLRTonemapOperator_Clamp || params.tonemapOperator == VLRTonemapOperator_Exponential ||
+         params.tonemapOperator == VLRTonemapOperator_Reinhard);
+}
+
+VLR_API VLRResult vlrContextResolve(VLRContext context, const VLRResolveParameters* params, void* dst) {
+    if (!isValidResolveParameters(*params))
+        return VLR_ERROR_INVALID_TYPE;
+    if (!context->resolve(*params, dst))
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextCreateAccumulationSnapshot(VLRContext context, VLRAccumulationSnapshot* snapshot) {
+    *snapshot = context->createAccumulationSnapshot();
+    if (*snapshot == nullptr)
+        return VLR_ERROR_INVALID_CONTEXT;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrContextRender(VLRContext context, VLRScene scene, VLRCamera camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames, bool* converged) {
     if (!scene->is<VLR::Scene>() || !camera->isMemberOf<VLR::Camera>())
         return VLR_ERROR_INVALID_TYPE;
-    context->render(*scene, camera, shrinkCoeff, firstFrame, numAccumFrames);
+    context->render(*scene, camera, shrinkCoeff, firstFrame, numAccumFrames, converged);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+
+
+VLR_API VLRResult vlrAccumulationSnapshotDestroy(VLRAccumulationSnapshot snapshot) {
+    delete snapshot;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrAccumulationSnapshotGetSize(VLRAccumulationSnapshot snapshot, uint32_t* width, uint32_t* height) {
+    *width = snapshot->getWidth();
+    *height = snapshot->getHeight();
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrAccumulationSnapshotResolve(VLRAccumulationSnapshot snapshot, const VLRResolveParameters* params, void* dst) {
+    if (!isValidResolveParameters(*params))
+        return VLR_ERROR_INVALID_TYPE;
+    snapshot->resolve(*params, dst);
 
     return VLR_ERROR_NO_ERROR;
 }
@@ -228,11 +366,47 @@ VLR_API VLRResult vlrImage2DHasAlpha(VLRImage2D image, bool* hasAlpha) {
     return VLR_ERROR_NO_ERROR;
 }
 
+VLR_API VLRResult vlrImage2DGenerateMipmaps(VLRImage2D image, VLRMipmapFilter filter) {
+    if (!image->isMemberOf<VLR::Image2D>())
+        return VLR_ERROR_INVALID_TYPE;
+    // JP: 共有された画像の変更は他の参照元にも見えてしまうので、キャッシュから外せない場合は失敗する。
+    // EN: Modifying a shared image would be visible from the other referrers, so fail if it cannot be removed from the cache.
+    if (!image->getContext().getImageCache().detach(image))
+        return VLR_ERROR_INVALID_TYPE;
+    if (!image->generateMipmaps(filter))
+        return VLR_ERROR_INVALID_TYPE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
 
 
+// JP: 内部形式の画素データが同じ画像が既にあれば、新しい画像を破棄してそれを共有する。
+// EN: If an image with the same pixel data in the internal format already exists, destroy the new image and share the existing one.
+template <typename ImageType>
+static ImageType* shareImage(VLR::Context &context, ImageType* newImage) {
+    auto image = (ImageType*)context.getImageCache().addOrAcquire(newImage->createImageCacheKey(), newImage, newImage->getDataSize(),
+                                                                  [newImage](const VLR::Image2D* cachedImage) {
+        return newImage->hasSameData(cachedImage);
+    });
+    if (image != newImage)
+        delete newImage;
+    return image;
+}
+
 VLR_API VLRResult vlrLinearImage2DCreate(VLRContext context, VLRLinearImage2D* image,
                                          uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma) {
-    *image = new VLR::LinearImage2D(*context, linearData, width, height, format, applyDegamma);
+    *image = shareImage(*context, new VLR::LinearImage2D(*context, linearData, width, height, format, applyDegamma));
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrLinearImage2DCreateFromExternalData(VLRContext context, VLRLinearImage2D* image,
+                                                         const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma,
+                                                         VLRImageDataReleaseCallback releaseCallback, void* userData) {
+    // JP: 同じ内容の画像が既にある場合、新しい画像と共に渡されたデータもすぐに返却される。
+    // EN: If an image with the same content already exists, the passed data is returned immediately along with the new image.
+    *image = shareImage(*context, new VLR::LinearImage2D(*context, linearData, width, height, format, applyDegamma, releaseCallback, userData));
 
     return VLR_ERROR_NO_ERROR;
 }
@@ -240,7 +414,30 @@ VLR_API VLRResult vlrLinearImage2DCreate(VLRContext context, VLRLinearImage2D* i
 VLR_API VLRResult vlrLinearImage2DDestroy(VLRContext context, VLRLinearImage2D image) {
     if (!image->is<VLR::LinearImage2D>())
         return VLR_ERROR_INVALID_TYPE;
-    delete image;
+    if (!context->getImageCache().release(image))
+        delete image;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrLinearImage2DWriteTiledImage(VLRLinearImage2D image, const char* filePath, uint32_t tileSize) {
+    if (!image->is<VLR::LinearImage2D>())
+        return VLR_ERROR_INVALID_TYPE;
+    if (tileSize == 0 || (tileSize & (tileSize - 1)) != 0)
+        return VLR_ERROR_INVALID_TYPE;
+    if (!image->writeTiledImage(filePath, tileSize))
+        return VLR_ERROR_INVALID_FILE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrConvertImageToUpsampledSpectrum(VLRContext context, VLRLinearImage2D image, VLRColorSpace colorSpace, VLRSpectrumType spectrumType,
+                                                     VLRLinearImage2D* convertedImage) {
+    if (!image->is<VLR::LinearImage2D>())
+        return VLR_ERROR_INVALID_TYPE;
+    *convertedImage = image->createUpsampledSpectrumImage2D(spectrumType, colorSpace);
+    if (*convertedImage == nullptr)
+        return VLR_ERROR_INVALID_TYPE;
 
     return VLR_ERROR_NO_ERROR;
 }
@@ -249,7 +446,7 @@ VLR_API VLRResult vlrLinearImage2DDestroy(VLRContext context, VLRLinearImage2D i
 
 VLR_API VLRResult vlrBlockCompressedImage2DCreate(VLRContext context, VLRBlockCompressedImage2D* image,
                                                   uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) {
-    *image = new VLR::BlockCompressedImage2D(*context, data, sizes, mipCount, width, height, dataFormat, applyDegamma);
+    *image = shareImage(*context, new VLR::BlockCompressedImage2D(*context, data, sizes, mipCount, width, height, dataFormat, applyDegamma));
 
     return VLR_ERROR_NO_ERROR;
 }
@@ -257,11 +454,50 @@ VLR_API VLRResult vlrBlockCompressedImage2DCreate(VLRContext context, VLRBlockCo
 VLR_API VLRResult vlrBlockCompressedImage2DDestroy(VLRContext context, VLRBlockCompressedImage2D image) {
     if (!image->is<VLR::BlockCompressedImage2D>())
         return VLR_ERROR_INVALID_TYPE;
+    if (!context->getImageCache().release(image))
+        delete image;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrConvertImageToBlockCompressed(VLRContext context, VLRLinearImage2D image, VLRDataFormat dataFormat, const char* cacheFilePath,
+                                                   VLRBlockCompressedImage2D* compressedImage) {
+    if (!image->is<VLR::LinearImage2D>())
+        return VLR_ERROR_INVALID_TYPE;
+    *compressedImage = image->createBlockCompressedImage2D(dataFormat, cacheFilePath);
+    if (*compressedImage == nullptr)
+        return VLR_ERROR_INVALID_TYPE;
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+
+
+VLR_API VLRResult vlrTiledImage2DCreate(VLRContext context, VLRTiledImage2D* image, const char* filePath) {
+    VLR::TiledImageInfo info;
+    if (!VLR::readTiledImageInfo(filePath, &info))
+        return VLR_ERROR_INVALID_FILE;
+    *image = new VLR::TiledImage2D(*context, filePath, info);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
+VLR_API VLRResult vlrTiledImage2DDestroy(VLRContext context, VLRTiledImage2D image) {
+    if (!image->is<VLR::TiledImage2D>())
+        return VLR_ERROR_INVALID_TYPE;
     delete image;
 
     return VLR_ERROR_NO_ERROR;
 }
 
+VLR_API VLRResult vlrTiledImage2DPrefetch(VLRTiledImage2D image, uint32_t mipLevel, float minU, float minV, float maxU, float maxV) {
+    if (!image->is<VLR::TiledImage2D>())
+        return VLR_ERROR_INVALID_TYPE;
+    image->prefetch(mipLevel, minU, minV, maxU, maxV);
+
+    return VLR_ERROR_NO_ERROR;
+}
+
 
 
 VLR_API VLRResult vlrShaderNodeGetSocket(VLRShaderNode node, VLRShaderNodeSocketType socketType, uint32_t index,
@@ -1575,8 +1811,20 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroup(VLRTriangleMeshSurf
 
 
 
+// JP: シーン階層と加速構造は現状では静的な変換のみを扱う。モーション変換などはノードに設定する時点で拒否する。
+// EN: The scene hierarchy and the acceleration structures currently handle only static transforms.
+//     Reject other transforms like motion transforms at the time they are set to a node.
+static bool isSupportedTransform(VLRTransformConst transform) {
+    if (transform->is<VLR::StaticTransform>())
+        return true;
+    vlrprintf("Only static transforms are supported for nodes in a scene.\n");
+    return false;
+}
+
 VLR_API VLRResult vlrInternalNodeCreate(VLRContext context, VLRInternalNode* node,
                                         const char* name, VLRTransform transform) {
+    if (!isSupportedTransform(transform))
+        return VLR_ERROR_INVALID_TYPE;
     *node = new VLR::InternalNode(*context, name, transform);
 
     return VLR_ERROR_NO_ERROR;
@@ -1593,6 +1841,8 @@ VLR_API VLRResult vlrInternalNodeDestroy(VLRContext context, VLRInternalNode nod
 VLR_API VLRResult vlrInternalNodeSetTransform(VLRInternalNode node, VLRTransform localToWorld) {
     if (!node->is<VLR::InternalNode>())
         return VLR_ERROR_INVALID_TYPE;
+    if (!isSupportedTransform(localToWorld))
+        return VLR_ERROR_INVALID_TYPE;
     node->setTransform(localToWorld);
 
     return VLR_ERROR_NO_ERROR;
@@ -1638,6 +1888,8 @@ VLR_API VLRResult vlrInternalNodeRemoveChild(VLRInternalNode node, VLRObject chi
 
 VLR_API VLRResult vlrSceneCreate(VLRContext context, VLRScene* scene,
                                  VLRTransform transform) {
+    if (!isSupportedTransform(transform))
+        return VLR_ERROR_INVALID_TYPE;
     *scene = new VLR::Scene(*context, transform);
 
     return VLR_ERROR_NO_ERROR;
@@ -1654,6 +1906,8 @@ VLR_API VLRResult vlrSceneDestroy(VLRContext context, VLRScene scene) {
 VLR_API VLRResult vlrSceneSetTransform(VLRScene scene, VLRTransform localToWorld) {
     if (!scene->is<VLR::Scene>())
         return VLR_ERROR_INVALID_TYPE;
+    if (!isSupportedTransform(localToWorld))
+        return VLR_ERROR_INVALID_TYPE;
     scene->setTransform(localToWorld);
 
     return VLR_ERROR_NO_ERROR;
@@ -1696,6 +1950,43 @@ VLR_API VLRResult vlrSceneSetEnvironment(VLRScene scene, VLREnvironmentEmitterSu
     return VLR_ERROR_NO_ERROR;
 }
 
+VLR_API VLRResult vlrSceneIntersect(VLRScene scene, const VLRRay* rays, uint32_t numRays, VLRHit* hits) {
+    static_assert(sizeof(VLRRay) == sizeof(VLR::CPU::Ray), "Sizes of VLRRay and VLR::CPU::Ray must match.");
+    if (!scene->is<VLR::Scene>())
+        return VLR_ERROR_INVALID_TYPE;
+
+    // JP: 内部の交差結果を公開用の形式に変換するための一時領域を抑えるため、一定数ずつ処理する。
+    // EN: Process a fixed number of rays at a time to limit the temporary storage to convert internal hits to the public format.
+    const uint32_t NumRaysPerChunk = 65536;
+    std::vector<VLR::CPU::RayHit> cpuHits(std::min(numRays, NumRaysPerChunk));
+    for (uint32_t start = 0; start < numRays; start += NumRaysPerChunk) {
+        uint32_t numRaysInChunk = std::min(NumRaysPerChunk, numRays - start);
+        scene->intersect((const VLR::CPU::Ray*)rays + start, numRaysInChunk, cpuHits.data());
+        for (uint32_t i = 0; i < numRaysInChunk; ++i) {
+            const VLR::CPU::RayHit &src = cpuHits[i];
+            VLRHit &dst = hits[start + i];
+            if (src.instIndex == VLR::CPU::InvalidIndex) {
+                dst.t = INFINITY;
+                dst.b1 = dst.b2 = 0.0f;
+                dst.surfaceNode = nullptr;
+                dst.materialGroupIndex = 0;
+                dst.primitiveIndex = 0;
+                continue;
+            }
+
+            const VLR::SHGeometryInstance* geomInst = scene->getHostGeometryInstance(src.instIndex);
+            dst.t = src.t;
+            dst.b1 = src.b1;
+            dst.b2 = src.b2;
+            dst.surfaceNode = const_cast<VLR::TriangleMeshSurfaceNode*>(geomInst->getTriangleMesh());
+            dst.materialGroupIndex = geomInst->getMaterialGroupIndex();
+            dst.primitiveIndex = src.primIndex;
+        }
+    }
+
+    return VLR_ERROR_NO_ERROR;
+}
+
 
 
 
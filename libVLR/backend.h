@@ -0,0 +1,292 @@
+﻿#pragma once
+
+#include "shared/basic_types_internal.h"
+
+// JP: レンダリングのバックエンドが保持するリソースとシーンのオブジェクトのインターフェース。
+//     libVLRはoptixppの代わりにこのインターフェースを通してバッファーやプログラム、ノードグラフを扱う。
+//     GPUバックエンドはOptiXのオブジェクトを包み(optix_backend.cpp)、CPUバックエンドはホストメモリ上に保持する(host_backend.cpp)。
+//     メソッドの名前と引数はoptixppに合わせてある。
+// EN: Interface of resources and scene objects held by a rendering backend.
+//     libVLR handles buffers, programs and the node graph through this interface instead of optixpp.
+//     The GPU backend wraps OptiX objects (optix_backend.cpp), and the CPU backend holds them in the host memory (host_backend.cpp).
+//     Names and arguments of methods follow optixpp.
+
+namespace VLR {
+    namespace Backend {
+        class ContextObj;
+        class VariableObj;
+        class BufferObj;
+        class TextureSamplerObj;
+        class ProgramObj;
+        class GeometryObj;
+        class GeometryTrianglesObj;
+        class GeometryInstanceObj;
+        class MaterialObj;
+        class GroupObj;
+        class GeometryGroupObj;
+        class TransformObj;
+        class AccelerationObj;
+
+        // JP: オブジェクトへの参照カウント付きのハンドル。オブジェクトの資源はdestroy()で明示的に解放する。
+        //     変数を持つオブジェクトのハンドルではoptixppと同様にoperator[]で変数を宣言または取得できる。
+        // EN: Reference-counted handle to an object. Resources of an object are explicitly released by destroy().
+        //     For a handle to an object having variables, operator[] declares or gets a variable similar to optixpp.
+        template <typename ObjectType>
+        class Handle {
+            std::shared_ptr<ObjectType> m_object;
+
+        public:
+            Handle() {}
+            Handle(std::nullptr_t) {}
+            Handle(const std::shared_ptr<ObjectType> &object) : m_object(object) {}
+
+            ObjectType* operator->() const {
+                VLRAssert(m_object, "Handle is null.");
+                return m_object.get();
+            }
+            ObjectType* get() const {
+                return m_object.get();
+            }
+            explicit operator bool() const {
+                return (bool)m_object;
+            }
+            bool operator==(const Handle &h) const {
+                return m_object == h.m_object;
+            }
+            bool operator!=(const Handle &h) const {
+                return m_object != h.m_object;
+            }
+            bool operator<(const Handle &h) const {
+                return m_object < h.m_object;
+            }
+
+            Handle<VariableObj> operator[](const std::string &name) const {
+                VLRAssert(m_object, "Handle is null.");
+                return m_object->declareVariable(name);
+            }
+        };
+
+        typedef Handle<ContextObj> Context;
+        typedef Handle<VariableObj> Variable;
+        typedef Handle<BufferObj> Buffer;
+        typedef Handle<TextureSamplerObj> TextureSampler;
+        typedef Handle<ProgramObj> Program;
+        typedef Handle<GeometryObj> Geometry;
+        typedef Handle<GeometryTrianglesObj> GeometryTriangles;
+        typedef Handle<GeometryInstanceObj> GeometryInstance;
+        typedef Handle<MaterialObj> Material;
+        typedef Handle<GroupObj> Group;
+        typedef Handle<GeometryGroupObj> GeometryGroup;
+        typedef Handle<TransformObj> Transform;
+        typedef Handle<AccelerationObj> Acceleration;
+
+
+
+        class DestroyableObj {
+        public:
+            virtual ~DestroyableObj() {}
+
+            virtual void destroy() = 0;
+        };
+
+        // JP: 変数を持つオブジェクト。
+        // EN: Object having variables.
+        class ScopedObj {
+        public:
+            virtual ~ScopedObj() {}
+
+            // JP: 宣言されていなければ宣言する。
+            // EN: Declare it if not declared.
+            virtual Variable declareVariable(const std::string &name) = 0;
+            // JP: 宣言されていない変数はnullを返す。
+            // EN: Returns null for an undeclared variable.
+            virtual Variable queryVariable(const std::string &name) const = 0;
+        };
+
+
+
+        class VariableObj {
+        public:
+            virtual ~VariableObj() {}
+
+            virtual void set(const Buffer &buffer) = 0;
+            virtual void set(const TextureSampler &sampler) = 0;
+            virtual void set(const Program &program) = 0;
+            virtual void set(const Group &group) = 0;
+            virtual Buffer getBuffer() const = 0;
+            virtual TextureSampler getTextureSampler() const = 0;
+            virtual Program getProgram() const = 0;
+            virtual Group getGroup() const = 0;
+
+            virtual void setFloat(float f) = 0;
+            virtual void setInt(int32_t i) = 0;
+            virtual void setUint(uint32_t u) = 0;
+            virtual void setUint(const optix::uint2 &u) = 0;
+            virtual float getFloat() const = 0;
+            virtual int32_t getInt() const = 0;
+            virtual uint32_t getUint() const = 0;
+            virtual optix::uint2 getUint2() const = 0;
+
+            virtual void setUserData(RTsize size, const void* ptr) = 0;
+            virtual void getUserData(RTsize size, void* ptr) const = 0;
+        };
+
+        class BufferObj : public DestroyableObj {
+        public:
+            virtual int32_t getId() const = 0;
+
+            virtual void setFormat(RTformat format) = 0;
+            virtual RTformat getFormat() const = 0;
+            virtual void setElementSize(RTsize size) = 0;
+            virtual RTsize getElementSize() const = 0;
+            virtual void setSize(RTsize width) = 0;
+            virtual void setSize(RTsize width, RTsize height) = 0;
+            virtual void getSize(RTsize &width) const = 0;
+            virtual void getSize(RTsize &width, RTsize &height) const = 0;
+            virtual uint32_t getDimensionality() const = 0;
+            virtual void setMipLevelCount(uint32_t levels) = 0;
+            virtual uint32_t getMipLevelCount() const = 0;
+            virtual void getMipLevelSize(uint32_t level, RTsize &width, RTsize &height) const = 0;
+
+            virtual void* map(uint32_t level = 0, uint32_t mapFlags = RT_BUFFER_MAP_READ_WRITE) = 0;
+            virtual void unmap(uint32_t level = 0) = 0;
+        };
+
+        class TextureSamplerObj : public DestroyableObj {
+        public:
+            virtual int32_t getId() const = 0;
+
+            virtual void setBuffer(const Buffer &buffer) = 0;
+            virtual Buffer getBuffer() const = 0;
+            virtual void setWrapMode(uint32_t dim, RTwrapmode mode) = 0;
+            virtual RTwrapmode getWrapMode(uint32_t dim) const = 0;
+            virtual void setFilteringModes(RTfiltermode minification, RTfiltermode magnification, RTfiltermode mipmapping) = 0;
+            virtual void getFilteringModes(RTfiltermode &minification, RTfiltermode &magnification, RTfiltermode &mipmapping) const = 0;
+            virtual void setReadMode(RTtexturereadmode mode) = 0;
+            virtual RTtexturereadmode getReadMode() const = 0;
+            virtual void setIndexingMode(RTtextureindexmode mode) = 0;
+            virtual RTtextureindexmode getIndexingMode() const = 0;
+            virtual void setMaxAnisotropy(float value) = 0;
+            virtual void setMipLevelCount(uint32_t count) = 0;
+        };
+
+        class ProgramObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual int32_t getId() const = 0;
+        };
+
+        class GeometryObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual void setPrimitiveCount(uint32_t count) = 0;
+            virtual void setIntersectionProgram(const Program &program) = 0;
+            virtual void setBoundingBoxProgram(const Program &program) = 0;
+        };
+
+        class GeometryTrianglesObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual void setPrimitiveCount(uint32_t count) = 0;
+            virtual void setTriangleIndices(const Buffer &indexBuffer, RTsize indexBufferByteOffset, RTsize triIndicesByteStride, RTformat triIndicesFormat) = 0;
+            virtual void setVertices(uint32_t numVertices, const Buffer &vertexBuffer, RTsize vertexBufferByteOffset, RTsize vertexByteStride, RTformat positionFormat) = 0;
+            virtual void setAttributeProgram(const Program &program) = 0;
+            virtual void setBuildFlags(RTgeometrybuildflags flags) = 0;
+        };
+
+        class MaterialObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual void setClosestHitProgram(uint32_t rayTypeIndex, const Program &program) = 0;
+            virtual void setAnyHitProgram(uint32_t rayTypeIndex, const Program &program) = 0;
+        };
+
+        class GeometryInstanceObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual void setGeometry(const Geometry &geometry) = 0;
+            virtual void setGeometryTriangles(const GeometryTriangles &geometryTriangles) = 0;
+            virtual void setMaterialCount(uint32_t count) = 0;
+            virtual void setMaterial(uint32_t index, const Material &material) = 0;
+        };
+
+        class AccelerationObj : public DestroyableObj {
+        public:
+            virtual void markDirty() = 0;
+        };
+
+        class GroupObj : public DestroyableObj {
+        public:
+            virtual void setAcceleration(const Acceleration &acceleration) = 0;
+            virtual void addChild(const Transform &transform) = 0;
+            virtual void addChild(const GeometryGroup &geomGroup) = 0;
+            virtual void removeChild(const Transform &transform) = 0;
+            virtual void removeChild(const GeometryGroup &geomGroup) = 0;
+        };
+
+        class GeometryGroupObj : public DestroyableObj {
+        public:
+            virtual void setAcceleration(const Acceleration &acceleration) = 0;
+            virtual void addChild(const GeometryInstance &geomInst) = 0;
+            virtual void removeChild(const GeometryInstance &geomInst) = 0;
+        };
+
+        // JP: 行列は行優先。transposeがtrueの場合は列優先として扱う。
+        // EN: Matrices are in row-major order. They are treated as column-major when transpose is true.
+        class TransformObj : public DestroyableObj {
+        public:
+            virtual void setChild(const GeometryGroup &geomGroup) = 0;
+            virtual void setMatrix(bool transpose, const float* matrix, const float* inverseMatrix) = 0;
+            virtual void getMatrix(bool transpose, float* matrix, float* inverseMatrix) const = 0;
+        };
+
+        class ContextObj : public DestroyableObj, public ScopedObj {
+        public:
+            virtual Buffer createBuffer(uint32_t type) = 0;
+            virtual Buffer createBuffer(uint32_t type, RTformat format) = 0;
+            virtual Buffer createBuffer(uint32_t type, RTformat format, RTsize width) = 0;
+            virtual Buffer createBuffer(uint32_t type, RTformat format, RTsize width, RTsize height) = 0;
+            // JP: グラフィックスAPIとの連携が無いバックエンドではnullを返す。
+            // EN: Returns null for a backend without interoperation with graphics APIs.
+            virtual Buffer createBufferFromGLBO(uint32_t type, uint32_t glBufferID) = 0;
+            virtual TextureSampler createTextureSampler() = 0;
+            virtual Program createProgramFromPTXString(const std::string &ptx, const std::string &programName) = 0;
+            virtual Geometry createGeometry() = 0;
+            virtual GeometryTriangles createGeometryTriangles() = 0;
+            virtual GeometryInstance createGeometryInstance() = 0;
+            virtual Material createMaterial() = 0;
+            virtual Group createGroup() = 0;
+            virtual GeometryGroup createGeometryGroup() = 0;
+            virtual Transform createTransform() = 0;
+            virtual Acceleration createAcceleration(const std::string &builder) = 0;
+
+            // JP: IDが無効な場合はnullを返す。
+            // EN: Returns null if the ID is invalid.
+            virtual Buffer getBufferFromId(int32_t bufferID) const = 0;
+            virtual TextureSampler getTextureSamplerFromId(int32_t samplerID) const = 0;
+
+            virtual void setEntryPointCount(uint32_t count) = 0;
+            virtual void setRayTypeCount(uint32_t count) = 0;
+            virtual void setRayGenerationProgram(uint32_t entryPointIndex, const Program &program) = 0;
+            virtual void setExceptionProgram(uint32_t entryPointIndex, const Program &program) = 0;
+            virtual void setMissProgram(uint32_t rayTypeIndex, const Program &program) = 0;
+            virtual void setStackSize(RTsize stackSize) = 0;
+            virtual RTsize getStackSize() const = 0;
+            virtual void setMaxTraceDepth(uint32_t maxDepth) = 0;
+            virtual void setMaxCallableProgramDepth(uint32_t maxDepth) = 0;
+            virtual void setPrintEnabled(bool enabled) = 0;
+            virtual void setPrintBufferSize(RTsize size) = 0;
+            virtual void setExceptionEnabled(RTexception exception, bool enabled) = 0;
+            virtual void setTimeoutCallback(RTtimeoutcallback callback, double minPollingSeconds) = 0;
+
+            virtual void validate() = 0;
+            // JP: ホストのコンテキストはカーネルを起動しない。CPUバックエンドのレンダラーがホスト関数を直接呼ぶ。
+            // EN: The host context doesn't launch kernels. The renderer of the CPU backend directly calls host functions.
+            virtual void launch(uint32_t entryPointIndex, RTsize width, RTsize height) = 0;
+        };
+
+
+
+        // JP: OptiXのコンテキストを包む。OptiXのDLLを読み込むのはこのバックエンドだけである。
+        // EN: Wraps an OptiX context. Only this backend loads the OptiX DLL.
+        Context createOptiXContext();
+        // JP: オブジェクトをホストメモリ上に保持するコンテキストを生成する。GPUやOptiXのDLLを必要としない。
+        // EN: Create a context holding objects in the host memory. Doesn't require a GPU or the OptiX DLL.
+        Context createHostContext();
+    }
+}
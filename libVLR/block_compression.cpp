@@ -0,0 +1,1441 @@
+﻿#include "block_compression.h"
+
+#include "image_filter.h"
+#include "image_cache.h"
+
+namespace VLR {
+    VLRDataFormat getDecompressedFormat(VLRDataFormat bcFormat) {
+        switch (bcFormat) {
+        case VLRDataFormat_BC1:
+        case VLRDataFormat_BC2:
+        case VLRDataFormat_BC3:
+        case VLRDataFormat_BC7:
+            return VLRDataFormat_RGBA8x4;
+        case VLRDataFormat_BC4:
+            return VLRDataFormat_Gray8;
+        case VLRDataFormat_BC4_Signed:
+            return VLRDataFormat_Gray32F;
+        case VLRDataFormat_BC5:
+        case VLRDataFormat_BC5_Signed:
+            return VLRDataFormat_RG32Fx2;
+        case VLRDataFormat_BC6H:
+        case VLRDataFormat_BC6H_Signed:
+            return VLRDataFormat_RGBA16Fx4;
+        default:
+            VLRAssert(false, "Specified data format is not block compressed format.");
+            return VLRDataFormat_RGBA8x4;
+        }
+    }
+
+    // JP: 128ビットのブロックを下位ビットから順に読む。
+    // EN: Read a 128-bit block sequentially from the lowest bit.
+    class BlockBitReader {
+        uint64_t m_low;
+        uint64_t m_high;
+        uint32_t m_position;
+
+    public:
+        BlockBitReader(const uint8_t* block) : m_position(0) {
+            std::memcpy(&m_low, block, sizeof(m_low));
+            std::memcpy(&m_high, block + sizeof(m_low), sizeof(m_high));
+        }
+
+        uint32_t read(uint32_t numBits) {
+            if (numBits == 0)
+                return 0;
+            uint64_t bits;
+            if (m_position >= 64)
+                bits = m_high >> (m_position - 64);
+            else if (m_position == 0)
+                bits = m_low;
+            else
+                bits = (m_low >> m_position) | (m_high << (64 - m_position));
+            m_position += numBits;
+            return (uint32_t)(bits & ((1ull << numBits) - 1));
+        }
+    };
+
+    static const uint32_t InterpolationWeights2[] = { 0, 21, 43, 64 };
+    static const uint32_t InterpolationWeights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static const uint32_t InterpolationWeights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    static const uint32_t* getInterpolationWeights(uint32_t numIndexBits) {
+        if (numIndexBits == 2)
+            return InterpolationWeights2;
+        else if (numIndexBits == 3)
+            return InterpolationWeights3;
+        return InterpolationWeights4;
+    }
+
+    // JP: BC6HとBC7で共有される2サブセットのパーティションと、各サブセットのアンカー(インデックスの最上位ビットが省略される画素)。
+    //     BC6Hは先頭の32個だけを使う。
+    // EN: Two-subset partitions shared by BC6H and BC7, and the anchor of each subset (the pixel whose index omits the most significant bit).
+    //     BC6H uses only the first 32 entries.
+    static const uint8_t PartitionTable2[64][16] = {
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 },
+        { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1 },
+        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 },
+        { 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1 },
+        { 0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0 },
+        { 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1 },
+        { 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0 },
+        { 0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0 },
+        { 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0 },
+        { 0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0 },
+        { 0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1 },
+        { 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0 },
+        { 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0 },
+        { 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1 },
+        { 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0 },
+        { 0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0 },
+        { 0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0 },
+        { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 },
+        { 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1 },
+        { 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0 },
+        { 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0 },
+        { 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0 },
+        { 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0 },
+        { 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1 },
+        { 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0 },
+        { 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0 },
+        { 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1 },
+        { 0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1 },
+        { 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1 },
+        { 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0 },
+        { 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0 },
+        { 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1 }
+    };
+
+    static const uint8_t AnchorTable2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+    };
+
+    static const uint8_t PartitionTable3[64][16] = {
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+        { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+        { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+        { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+        { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+        { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+        { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+        { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+        { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+        { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+        { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+        { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+        { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+    };
+
+    static const uint8_t AnchorTable3_1[64] = {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+    };
+
+    static const uint8_t AnchorTable3_2[64] = {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+    };
+
+
+
+    // JP: BC1のカラーブロックの4色。BC2とBC3のカラーブロックは常に4色モードで、パンチスルーアルファを持たない。
+    // EN: Four colors of a color block of BC1. The color blocks of BC2 and BC3 are always in the four-color mode without punch-through alpha.
+    static void buildColorPalette(uint32_t c0, uint32_t c1, bool allowsPunchThrough, uint32_t palette[4][4]) {
+        auto expand565 = [](uint32_t c, uint32_t rgba[4]) {
+            uint32_t r = (c >> 11) & 0x1F;
+            uint32_t g = (c >> 5) & 0x3F;
+            uint32_t b = c & 0x1F;
+            rgba[0] = (r << 3) | (r >> 2);
+            rgba[1] = (g << 2) | (g >> 4);
+            rgba[2] = (b << 3) | (b >> 2);
+            rgba[3] = 255;
+        };
+        expand565(c0, palette[0]);
+        expand565(c1, palette[1]);
+        if (c0 > c1 || !allowsPunchThrough) {
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = 255;
+        }
+        else {
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+                palette[3][c] = 0;
+            }
+            palette[2][3] = 255;
+            palette[3][3] = 0;
+        }
+    }
+
+    static void decodeColorBlock(const uint8_t* block, bool allowsPunchThrough, uint8_t texels[16][4]) {
+        uint32_t c0 = block[0] | (block[1] << 8);
+        uint32_t c1 = block[2] | (block[3] << 8);
+        uint32_t palette[4][4];
+        buildColorPalette(c0, c1, allowsPunchThrough, palette);
+
+        uint32_t indices;
+        std::memcpy(&indices, block + 4, sizeof(indices));
+        for (int i = 0; i < 16; ++i) {
+            const uint32_t* color = palette[(indices >> (2 * i)) & 0x3];
+            for (int c = 0; c < 4; ++c)
+                texels[i][c] = (uint8_t)color[c];
+        }
+    }
+
+    // JP: BC4の1チャンネルのブロックの8値。BC3のアルファブロックも同じ形式。
+    // EN: Eight values of a one-channel block of BC4. The alpha block of BC3 has the same format.
+    static void buildBC4Palette(uint32_t v0, uint32_t v1, uint32_t palette[8]) {
+        palette[0] = v0;
+        palette[1] = v1;
+        if (v0 > v1) {
+            for (int k = 2; k < 8; ++k)
+                palette[k] = ((8 - k) * v0 + (k - 1) * v1 + 3) / 7;
+        }
+        else {
+            for (int k = 2; k < 6; ++k)
+                palette[k] = ((6 - k) * v0 + (k - 1) * v1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static void decodeBC4Block(const uint8_t* block, uint8_t values[16]) {
+        uint32_t palette[8];
+        buildBC4Palette(block[0], block[1], palette);
+
+        uint64_t indices = 0;
+        std::memcpy(&indices, block + 2, 6);
+        for (int i = 0; i < 16; ++i)
+            values[i] = (uint8_t)palette[(indices >> (3 * i)) & 0x7];
+    }
+
+    // JP: BC4のブロックを正規化された値に展開する。符号付きの場合は-128を-127として扱い、[-1, 1]になる。
+    // EN: Decode a BC4 block into normalized values. In the signed case, -128 is treated as -127 and the values lie in [-1, 1].
+    static void decodeBC4Block(const uint8_t* block, bool isSigned, float values[16]) {
+        float v0, v1;
+        float minValue;
+        bool hasEightValues;
+        if (isSigned) {
+            int32_t s0 = (int8_t)block[0];
+            int32_t s1 = (int8_t)block[1];
+            v0 = std::max(s0, -127) / 127.0f;
+            v1 = std::max(s1, -127) / 127.0f;
+            minValue = -1.0f;
+            hasEightValues = s0 > s1;
+        }
+        else {
+            v0 = block[0] / 255.0f;
+            v1 = block[1] / 255.0f;
+            minValue = 0.0f;
+            hasEightValues = block[0] > block[1];
+        }
+
+        float palette[8];
+        palette[0] = v0;
+        palette[1] = v1;
+        if (hasEightValues) {
+            for (int k = 2; k < 8; ++k)
+                palette[k] = ((8 - k) * v0 + (k - 1) * v1) / 7;
+        }
+        else {
+            for (int k = 2; k < 6; ++k)
+                palette[k] = ((6 - k) * v0 + (k - 1) * v1) / 5;
+            palette[6] = minValue;
+            palette[7] = 1.0f;
+        }
+
+        uint64_t indices = 0;
+        std::memcpy(&indices, block + 2, 6);
+        for (int i = 0; i < 16; ++i)
+            values[i] = palette[(indices >> (3 * i)) & 0x7];
+    }
+
+
+
+    struct BC6HModeInfo {
+        bool isTransformed;
+        uint32_t numSubsets;
+        uint32_t endpointBits;
+        uint32_t deltaBits[3];
+    };
+
+    // JP: 仕様上のモード1から14の順。
+    // EN: In the order of the modes 1 to 14 in the specification.
+    static const BC6HModeInfo BC6HModeInfos[] = {
+        { true, 2, 10, { 5, 5, 5 } },
+        { true, 2, 7, { 6, 6, 6 } },
+        { true, 2, 11, { 5, 4, 4 } },
+        { true, 2, 11, { 4, 5, 4 } },
+        { true, 2, 11, { 4, 4, 5 } },
+        { true, 2, 9, { 5, 5, 5 } },
+        { true, 2, 8, { 6, 5, 5 } },
+        { true, 2, 8, { 5, 6, 5 } },
+        { true, 2, 8, { 5, 5, 6 } },
+        { false, 2, 6, { 6, 6, 6 } },
+        { false, 1, 10, { 10, 10, 10 } },
+        { true, 1, 11, { 9, 9, 9 } },
+        { true, 1, 12, { 8, 8, 8 } },
+        { true, 1, 16, { 4, 4, 4 } },
+    };
+
+    static int32_t signExtend(int32_t value, uint32_t numBits) {
+        uint32_t shift = 32 - numBits;
+        return (int32_t)((uint32_t)value << shift) >> shift;
+    }
+
+    static int32_t unquantizeBC6HEndpoint(int32_t value, uint32_t numBits, bool isSigned) {
+        if (!isSigned) {
+            if (numBits >= 15 || value == 0)
+                return value;
+            if (value == (1 << numBits) - 1)
+                return 0xFFFF;
+            return ((value << 16) + 0x8000) >> numBits;
+        }
+        else {
+            if (numBits >= 16)
+                return std::max(value, -0x7FFF);
+            bool negative = value < 0;
+            int32_t magnitude = negative ? -value : value;
+            int32_t unq;
+            if (magnitude == 0)
+                unq = 0;
+            else if (magnitude >= (1 << (numBits - 1)) - 1)
+                unq = 0x7FFF;
+            else
+                unq = ((magnitude << 15) + 0x4000) >> (numBits - 1);
+            return negative ? -unq : unq;
+        }
+    }
+
+    // JP: 補間した値をhalfのビット列にする。
+    // EN: Turn an interpolated value into a bit pattern of half.
+    static uint16_t finishUnquantizeBC6H(int32_t value, bool isSigned) {
+        if (!isSigned)
+            return (uint16_t)((value * 31) >> 6);
+        if (value < 0)
+            return (uint16_t)(0x8000 | (((-value) * 31) >> 5));
+        return (uint16_t)((value * 31) >> 5);
+    }
+
+    static void decodeBC6HBlock(const uint8_t* block, bool isSigned, uint16_t texels[16][4]) {
+        const uint16_t HalfOne = 0x3C00;
+        BlockBitReader reader(block);
+
+        uint32_t modeCode = reader.read(2);
+        if (modeCode > 1)
+            modeCode |= reader.read(3) << 2;
+        int32_t mode;
+        if (modeCode < 2)
+            mode = modeCode;
+        else if ((modeCode & 0x3) == 2)
+            mode = 2 + (modeCode >> 2);
+        else
+            mode = (modeCode >> 2) < 4 ? 10 + (modeCode >> 2) : -1;
+
+        // JP: 予約済みのモードは黒になる。
+        // EN: Reserved modes result in black.
+        if (mode < 0) {
+            for (int i = 0; i < 16; ++i) {
+                texels[i][0] = texels[i][1] = texels[i][2] = 0;
+                texels[i][3] = HalfOne;
+            }
+            return;
+        }
+
+        int32_t r[4] = {}, g[4] = {}, b[4] = {};
+        auto get = [&reader](int32_t &value, uint32_t numBits, uint32_t shift) {
+            value |= (int32_t)reader.read(numBits) << shift;
+        };
+        // JP: 上位ビットから逆順に格納されるフィールド。
+        // EN: Field stored in reverse order from the most significant bit.
+        auto getReversed = [&reader](int32_t &value, uint32_t numBits, uint32_t topBit) {
+            for (uint32_t i = 0; i < numBits; ++i)
+                value |= (int32_t)reader.read(1) << (topBit - i);
+        };
+
+        switch (mode) {
+        case 0:
+            get(g[2], 1, 4); get(b[2], 1, 4); get(b[3], 1, 4);
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 5, 0); get(g[3], 1, 4); get(g[2], 4, 0);
+            get(g[1], 5, 0); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 5, 0); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 5, 0); get(b[3], 1, 2);
+            get(r[3], 5, 0); get(b[3], 1, 3);
+            break;
+        case 1:
+            get(g[2], 1, 5); get(g[3], 1, 4); get(g[3], 1, 5);
+            get(r[0], 7, 0); get(b[3], 1, 0); get(b[3], 1, 1); get(b[2], 1, 4);
+            get(g[0], 7, 0); get(b[2], 1, 5); get(b[3], 1, 2); get(g[2], 1, 4);
+            get(b[0], 7, 0); get(b[3], 1, 3); get(b[3], 1, 5); get(b[3], 1, 4);
+            get(r[1], 6, 0); get(g[2], 4, 0);
+            get(g[1], 6, 0); get(g[3], 4, 0);
+            get(b[1], 6, 0); get(b[2], 4, 0);
+            get(r[2], 6, 0);
+            get(r[3], 6, 0);
+            break;
+        case 2:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 5, 0); get(r[0], 1, 10); get(g[2], 4, 0);
+            get(g[1], 4, 0); get(g[0], 1, 10); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 4, 0); get(b[0], 1, 10); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 5, 0); get(b[3], 1, 2);
+            get(r[3], 5, 0); get(b[3], 1, 3);
+            break;
+        case 3:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 4, 0); get(r[0], 1, 10); get(g[3], 1, 4); get(g[2], 4, 0);
+            get(g[1], 5, 0); get(g[0], 1, 10); get(g[3], 4, 0);
+            get(b[1], 4, 0); get(b[0], 1, 10); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 4, 0); get(b[3], 1, 0); get(b[3], 1, 2);
+            get(r[3], 4, 0); get(g[2], 1, 4); get(b[3], 1, 3);
+            break;
+        case 4:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 4, 0); get(r[0], 1, 10); get(b[2], 1, 4); get(g[2], 4, 0);
+            get(g[1], 4, 0); get(g[0], 1, 10); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 5, 0); get(b[0], 1, 10); get(b[2], 4, 0);
+            get(r[2], 4, 0); get(b[3], 1, 1); get(b[3], 1, 2);
+            get(r[3], 4, 0); get(b[3], 1, 4); get(b[3], 1, 3);
+            break;
+        case 5:
+            get(r[0], 9, 0); get(b[2], 1, 4);
+            get(g[0], 9, 0); get(g[2], 1, 4);
+            get(b[0], 9, 0); get(b[3], 1, 4);
+            get(r[1], 5, 0); get(g[3], 1, 4); get(g[2], 4, 0);
+            get(g[1], 5, 0); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 5, 0); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 5, 0); get(b[3], 1, 2);
+            get(r[3], 5, 0); get(b[3], 1, 3);
+            break;
+        case 6:
+            get(r[0], 8, 0); get(g[3], 1, 4); get(b[2], 1, 4);
+            get(g[0], 8, 0); get(b[3], 1, 2); get(g[2], 1, 4);
+            get(b[0], 8, 0); get(b[3], 1, 3); get(b[3], 1, 4);
+            get(r[1], 6, 0); get(g[2], 4, 0);
+            get(g[1], 5, 0); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 5, 0); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 6, 0);
+            get(r[3], 6, 0);
+            break;
+        case 7:
+            get(r[0], 8, 0); get(b[3], 1, 0); get(b[2], 1, 4);
+            get(g[0], 8, 0); get(g[2], 1, 5); get(g[2], 1, 4);
+            get(b[0], 8, 0); get(g[3], 1, 5); get(b[3], 1, 4);
+            get(r[1], 5, 0); get(g[3], 1, 4); get(g[2], 4, 0);
+            get(g[1], 6, 0); get(g[3], 4, 0);
+            get(b[1], 5, 0); get(b[3], 1, 1); get(b[2], 4, 0);
+            get(r[2], 5, 0); get(b[3], 1, 2);
+            get(r[3], 5, 0); get(b[3], 1, 3);
+            break;
+        case 8:
+            get(r[0], 8, 0); get(b[3], 1, 1); get(b[2], 1, 4);
+            get(g[0], 8, 0); get(b[2], 1, 5); get(g[2], 1, 4);
+            get(b[0], 8, 0); get(b[3], 1, 5); get(b[3], 1, 4);
+            get(r[1], 5, 0); get(g[3], 1, 4); get(g[2], 4, 0);
+            get(g[1], 5, 0); get(b[3], 1, 0); get(g[3], 4, 0);
+            get(b[1], 6, 0); get(b[2], 4, 0);
+            get(r[2], 5, 0); get(b[3], 1, 2);
+            get(r[3], 5, 0); get(b[3], 1, 3);
+            break;
+        case 9:
+            get(r[0], 6, 0); get(g[3], 1, 4); get(b[3], 1, 0); get(b[3], 1, 1); get(b[2], 1, 4);
+            get(g[0], 6, 0); get(g[2], 1, 5); get(b[2], 1, 5); get(b[3], 1, 2); get(g[2], 1, 4);
+            get(b[0], 6, 0); get(g[3], 1, 5); get(b[3], 1, 3); get(b[3], 1, 5); get(b[3], 1, 4);
+            get(r[1], 6, 0); get(g[2], 4, 0);
+            get(g[1], 6, 0); get(g[3], 4, 0);
+            get(b[1], 6, 0); get(b[2], 4, 0);
+            get(r[2], 6, 0);
+            get(r[3], 6, 0);
+            break;
+        case 10:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 10, 0); get(g[1], 10, 0); get(b[1], 10, 0);
+            break;
+        case 11:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 9, 0); get(r[0], 1, 10);
+            get(g[1], 9, 0); get(g[0], 1, 10);
+            get(b[1], 9, 0); get(b[0], 1, 10);
+            break;
+        case 12:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 8, 0); getReversed(r[0], 2, 11);
+            get(g[1], 8, 0); getReversed(g[0], 2, 11);
+            get(b[1], 8, 0); getReversed(b[0], 2, 11);
+            break;
+        case 13:
+            get(r[0], 10, 0); get(g[0], 10, 0); get(b[0], 10, 0);
+            get(r[1], 4, 0); getReversed(r[0], 6, 15);
+            get(g[1], 4, 0); getReversed(g[0], 6, 15);
+            get(b[1], 4, 0); getReversed(b[0], 6, 15);
+            break;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            break;
+        }
+
+        const BC6HModeInfo &info = BC6HModeInfos[mode];
+        uint32_t numEndpoints = 2 * info.numSubsets;
+        int32_t* components[] = { r, g, b };
+        for (int c = 0; c < 3; ++c) {
+            int32_t* e = components[c];
+            if (isSigned)
+                e[0] = signExtend(e[0], info.endpointBits);
+            // JP: 差分は常に符号付き。差分でないモードの端点は符号付き形式の場合のみ符号拡張する。
+            // EN: Deltas are always signed. Endpoints of non-delta modes are sign-extended only for the signed format.
+            if (info.isTransformed || isSigned) {
+                for (uint32_t i = 1; i < numEndpoints; ++i)
+                    e[i] = signExtend(e[i], info.deltaBits[c]);
+            }
+            if (info.isTransformed) {
+                uint32_t mask = (1 << info.endpointBits) - 1;
+                for (uint32_t i = 1; i < numEndpoints; ++i) {
+                    e[i] = (e[0] + e[i]) & mask;
+                    if (isSigned)
+                        e[i] = signExtend(e[i], info.endpointBits);
+                }
+            }
+            for (uint32_t i = 0; i < numEndpoints; ++i)
+                e[i] = unquantizeBC6HEndpoint(e[i], info.endpointBits, isSigned);
+        }
+
+        uint32_t partition = info.numSubsets == 2 ? reader.read(5) : 0;
+        uint32_t numIndexBits = info.numSubsets == 2 ? 3 : 4;
+        const uint32_t* weights = getInterpolationWeights(numIndexBits);
+        for (int i = 0; i < 16; ++i) {
+            uint32_t subset = info.numSubsets == 2 ? PartitionTable2[partition][i] : 0;
+            bool isAnchor = i == 0 || (subset == 1 && i == AnchorTable2[partition]);
+            int32_t weight = weights[reader.read(numIndexBits - isAnchor)];
+            for (int c = 0; c < 3; ++c) {
+                const int32_t* e = components[c];
+                int32_t value = ((64 - weight) * e[2 * subset + 0] + weight * e[2 * subset + 1] + 32) >> 6;
+                texels[i][c] = finishUnquantizeBC6H(value, isSigned);
+            }
+            texels[i][3] = HalfOne;
+        }
+    }
+
+
+
+    struct BC7ModeInfo {
+        uint32_t numSubsets;
+        uint32_t partitionBits;
+        uint32_t rotationBits;
+        uint32_t indexSelectionBits;
+        uint32_t colorBits;
+        uint32_t alphaBits;
+        bool hasEndpointPBits;
+        bool hasSharedPBits;
+        uint32_t indexBits;
+        uint32_t secondaryIndexBits;
+    };
+
+    static const BC7ModeInfo BC7ModeInfos[] = {
+        { 3, 4, 0, 0, 4, 0, true, false, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, false, true, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, false, false, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, true, false, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, false, false, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, false, false, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, true, false, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, true, false, 2, 0 },
+    };
+
+    static void decodeBC7Block(const uint8_t* block, uint8_t texels[16][4]) {
+        uint32_t mode = 0;
+        while (mode < 8 && (block[0] & (1 << mode)) == 0)
+            ++mode;
+        // JP: 不正なモードは透明な黒になる。
+        // EN: An invalid mode results in transparent black.
+        if (mode == 8) {
+            std::fill_n(&texels[0][0], 16 * 4, 0);
+            return;
+        }
+
+        const BC7ModeInfo &info = BC7ModeInfos[mode];
+        BlockBitReader reader(block);
+        reader.read(mode + 1);
+        uint32_t partition = reader.read(info.partitionBits);
+        uint32_t rotation = reader.read(info.rotationBits);
+        uint32_t indexSelection = reader.read(info.indexSelectionBits);
+
+        uint32_t numEndpoints = 2 * info.numSubsets;
+        uint32_t endpoints[6][4];
+        for (int c = 0; c < 3; ++c) {
+            for (uint32_t i = 0; i < numEndpoints; ++i)
+                endpoints[i][c] = reader.read(info.colorBits);
+        }
+        for (uint32_t i = 0; i < numEndpoints; ++i)
+            endpoints[i][3] = reader.read(info.alphaBits);
+
+        uint32_t colorBits = info.colorBits;
+        uint32_t alphaBits = info.alphaBits;
+        if (info.hasEndpointPBits || info.hasSharedPBits) {
+            uint32_t pBits[6];
+            if (info.hasEndpointPBits) {
+                for (uint32_t i = 0; i < numEndpoints; ++i)
+                    pBits[i] = reader.read(1);
+            }
+            else {
+                for (uint32_t s = 0; s < info.numSubsets; ++s)
+                    pBits[2 * s + 0] = pBits[2 * s + 1] = reader.read(1);
+            }
+            for (uint32_t i = 0; i < numEndpoints; ++i) {
+                for (int c = 0; c < 3; ++c)
+                    endpoints[i][c] = (endpoints[i][c] << 1) | pBits[i];
+                if (alphaBits > 0)
+                    endpoints[i][3] = (endpoints[i][3] << 1) | pBits[i];
+            }
+            ++colorBits;
+            if (alphaBits > 0)
+                ++alphaBits;
+        }
+
+        // JP: 上位ビットを下位に複製して8ビットに伸ばす。
+        // EN: Extend to 8 bits by replicating the upper bits to the lower bits.
+        for (uint32_t i = 0; i < numEndpoints; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                uint32_t value = endpoints[i][c] << (8 - colorBits);
+                endpoints[i][c] = value | (value >> colorBits);
+            }
+            if (alphaBits > 0) {
+                uint32_t value = endpoints[i][3] << (8 - alphaBits);
+                endpoints[i][3] = value | (value >> alphaBits);
+            }
+            else {
+                endpoints[i][3] = 255;
+            }
+        }
+
+        uint32_t anchors[3] = { 0, 0, 0 };
+        if (info.numSubsets == 2) {
+            anchors[1] = AnchorTable2[partition];
+        }
+        else if (info.numSubsets == 3) {
+            anchors[1] = AnchorTable3_1[partition];
+            anchors[2] = AnchorTable3_2[partition];
+        }
+        uint32_t subsets[16];
+        for (int i = 0; i < 16; ++i) {
+            if (info.numSubsets == 2)
+                subsets[i] = PartitionTable2[partition][i];
+            else if (info.numSubsets == 3)
+                subsets[i] = PartitionTable3[partition][i];
+            else
+                subsets[i] = 0;
+        }
+
+        uint32_t indices[16];
+        for (int i = 0; i < 16; ++i)
+            indices[i] = reader.read(info.indexBits - (i == anchors[subsets[i]]));
+        uint32_t secondaryIndices[16];
+        if (info.secondaryIndexBits > 0) {
+            for (int i = 0; i < 16; ++i)
+                secondaryIndices[i] = reader.read(info.secondaryIndexBits - (i == 0));
+        }
+
+        const uint32_t* primaryWeights = getInterpolationWeights(info.indexBits);
+        const uint32_t* secondaryWeights = getInterpolationWeights(info.secondaryIndexBits);
+        for (int i = 0; i < 16; ++i) {
+            uint32_t colorWeight = primaryWeights[indices[i]];
+            uint32_t alphaWeight = colorWeight;
+            if (info.secondaryIndexBits > 0) {
+                uint32_t secondaryWeight = secondaryWeights[secondaryIndices[i]];
+                if (indexSelection == 0)
+                    alphaWeight = secondaryWeight;
+                else
+                    colorWeight = secondaryWeight;
+            }
+
+            const uint32_t* e0 = endpoints[2 * subsets[i] + 0];
+            const uint32_t* e1 = endpoints[2 * subsets[i] + 1];
+            for (int c = 0; c < 3; ++c)
+                texels[i][c] = (uint8_t)(((64 - colorWeight) * e0[c] + colorWeight * e1[c] + 32) >> 6);
+            texels[i][3] = (uint8_t)(((64 - alphaWeight) * e0[3] + alphaWeight * e1[3] + 32) >> 6);
+
+            // JP: 回転はアルファと指定された色成分を入れ替える。
+            // EN: Rotation swaps alpha and the specified color component.
+            if (rotation > 0)
+                std::swap(texels[i][3], texels[i][rotation - 1]);
+        }
+    }
+
+
+
+    // JP: 1ブロックを展開形式の16画素(行優先)にする。
+    // EN: Decode one block into 16 pixels (row-major) in the decompressed format.
+    static void decodeBlock(const uint8_t* block, VLRDataFormat bcFormat, uint8_t* texels) {
+        switch (bcFormat) {
+        case VLRDataFormat_BC1: {
+            decodeColorBlock(block, true, (uint8_t(*)[4])texels);
+            break;
+        }
+        case VLRDataFormat_BC2: {
+            auto rgba = (uint8_t(*)[4])texels;
+            decodeColorBlock(block + 8, false, rgba);
+            uint64_t alphas;
+            std::memcpy(&alphas, block, sizeof(alphas));
+            for (int i = 0; i < 16; ++i)
+                rgba[i][3] = (uint8_t)(((alphas >> (4 * i)) & 0xF) * 17);
+            break;
+        }
+        case VLRDataFormat_BC3: {
+            auto rgba = (uint8_t(*)[4])texels;
+            decodeColorBlock(block + 8, false, rgba);
+            uint8_t alphas[16];
+            decodeBC4Block(block, alphas);
+            for (int i = 0; i < 16; ++i)
+                rgba[i][3] = alphas[i];
+            break;
+        }
+        case VLRDataFormat_BC4: {
+            decodeBC4Block(block, texels);
+            break;
+        }
+        case VLRDataFormat_BC4_Signed: {
+            decodeBC4Block(block, true, (float*)texels);
+            break;
+        }
+        case VLRDataFormat_BC5:
+        case VLRDataFormat_BC5_Signed: {
+            bool isSigned = bcFormat == VLRDataFormat_BC5_Signed;
+            float reds[16], greens[16];
+            decodeBC4Block(block + 0, isSigned, reds);
+            decodeBC4Block(block + 8, isSigned, greens);
+            auto rg = (float(*)[2])texels;
+            for (int i = 0; i < 16; ++i) {
+                rg[i][0] = reds[i];
+                rg[i][1] = greens[i];
+            }
+            break;
+        }
+        case VLRDataFormat_BC6H:
+        case VLRDataFormat_BC6H_Signed: {
+            decodeBC6HBlock(block, bcFormat == VLRDataFormat_BC6H_Signed, (uint16_t(*)[4])texels);
+            break;
+        }
+        case VLRDataFormat_BC7: {
+            decodeBC7Block(block, (uint8_t(*)[4])texels);
+            break;
+        }
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            break;
+        }
+    }
+
+    void decompressBlocks(const uint8_t* srcData, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint8_t* dstData) {
+        uint32_t widthInBlocks = nextMultiplierForPowOf2(width, 4);
+        uint32_t heightInBlocks = nextMultiplierForPowOf2(height, 4);
+        uint32_t blockSize = (bcFormat == VLRDataFormat_BC1 || bcFormat == VLRDataFormat_BC4 || bcFormat == VLRDataFormat_BC4_Signed) ? 8 : 16;
+        uint32_t stride;
+        switch (getDecompressedFormat(bcFormat)) {
+        case VLRDataFormat_Gray8:
+            stride = 1;
+            break;
+        case VLRDataFormat_RGBA8x4:
+        case VLRDataFormat_Gray32F:
+            stride = 4;
+            break;
+        case VLRDataFormat_RG32Fx2:
+        case VLRDataFormat_RGBA16Fx4:
+            stride = 8;
+            break;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return;
+        }
+
+        processRowsInParallel(16 * widthInBlocks, heightInBlocks, [&](uint32_t by) {
+            alignas(16) uint8_t texels[16 * 8];
+            uint32_t numRows = std::min<uint32_t>(4, height - 4 * by);
+            for (uint32_t bx = 0; bx < widthInBlocks; ++bx) {
+                decodeBlock(srcData + (widthInBlocks * by + bx) * blockSize, bcFormat, texels);
+                uint32_t numCols = std::min<uint32_t>(4, width - 4 * bx);
+                for (uint32_t ty = 0; ty < numRows; ++ty)
+                    std::copy_n(texels + 4 * stride * ty, stride * numCols, dstData + ((4 * by + ty) * width + 4 * bx) * stride);
+            }
+        });
+    }
+
+
+
+    bool isCompressibleFormat(VLRDataFormat bcFormat) {
+        return (bcFormat == VLRDataFormat_BC1 ||
+                bcFormat == VLRDataFormat_BC3 ||
+                bcFormat == VLRDataFormat_BC4 ||
+                bcFormat == VLRDataFormat_BC5 ||
+                bcFormat == VLRDataFormat_BC7);
+    }
+
+    size_t getCompressedSize(VLRDataFormat bcFormat, uint32_t width, uint32_t height) {
+        size_t blockSize = (bcFormat == VLRDataFormat_BC1 || bcFormat == VLRDataFormat_BC4 || bcFormat == VLRDataFormat_BC4_Signed) ? 8 : 16;
+        return blockSize * nextMultiplierForPowOf2(width, 4) * nextMultiplierForPowOf2(height, 4);
+    }
+
+    // JP: 128ビットのブロックに下位ビットから順に書く。
+    // EN: Write into a 128-bit block sequentially from the lowest bit.
+    class BlockBitWriter {
+        uint64_t m_low;
+        uint64_t m_high;
+        uint32_t m_position;
+
+    public:
+        BlockBitWriter() : m_low(0), m_high(0), m_position(0) {}
+
+        void write(uint32_t value, uint32_t numBits) {
+            uint64_t bits = value & ((1ull << numBits) - 1);
+            if (m_position >= 64) {
+                m_high |= bits << (m_position - 64);
+            }
+            else {
+                m_low |= bits << m_position;
+                if (m_position + numBits > 64)
+                    m_high |= bits >> (64 - m_position);
+            }
+            m_position += numBits;
+        }
+
+        void store(uint8_t* block) const {
+            std::memcpy(block, &m_low, sizeof(m_low));
+            std::memcpy(block + sizeof(m_low), &m_high, sizeof(m_high));
+        }
+    };
+
+    // JP: 画素の主成分の方向に沿った両端を端点の初期値にする。主成分はべき乗法で求める。
+    // EN: Use both ends along the principal component of the pixels as the initial endpoints. The principal component is computed by power iteration.
+    template <uint32_t N>
+    static void computeEndpointsAlongPrincipalAxis(const float (*pixels)[N], uint32_t numPixels, float e0[N], float e1[N]) {
+        float mean[N] = {};
+        float minValues[N], maxValues[N];
+        for (uint32_t c = 0; c < N; ++c) {
+            minValues[c] = INFINITY;
+            maxValues[c] = -INFINITY;
+        }
+        for (uint32_t p = 0; p < numPixels; ++p) {
+            for (uint32_t c = 0; c < N; ++c) {
+                mean[c] += pixels[p][c];
+                minValues[c] = std::min(minValues[c], pixels[p][c]);
+                maxValues[c] = std::max(maxValues[c], pixels[p][c]);
+            }
+        }
+        for (uint32_t c = 0; c < N; ++c)
+            mean[c] /= numPixels;
+
+        float covariance[N][N] = {};
+        for (uint32_t p = 0; p < numPixels; ++p) {
+            float d[N];
+            for (uint32_t c = 0; c < N; ++c)
+                d[c] = pixels[p][c] - mean[c];
+            for (uint32_t i = 0; i < N; ++i) {
+                for (uint32_t j = 0; j < N; ++j)
+                    covariance[i][j] += d[i] * d[j];
+            }
+        }
+
+        // JP: バウンディングボックスの対角線から始める。全画素が同じ色なら平均を両端にする。
+        // EN: Start from the diagonal of the bounding box. If all the pixels have the same color, use the mean for both ends.
+        float axis[N];
+        float length2 = 0.0f;
+        for (uint32_t c = 0; c < N; ++c) {
+            axis[c] = maxValues[c] - minValues[c];
+            length2 += axis[c] * axis[c];
+        }
+        if (length2 == 0.0f) {
+            for (uint32_t c = 0; c < N; ++c)
+                e0[c] = e1[c] = mean[c];
+            return;
+        }
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float invLength = 1.0f / std::sqrt(length2);
+            for (uint32_t c = 0; c < N; ++c)
+                axis[c] *= invLength;
+
+            float next[N] = {};
+            for (uint32_t i = 0; i < N; ++i) {
+                for (uint32_t j = 0; j < N; ++j)
+                    next[i] += covariance[i][j] * axis[j];
+            }
+            float nextLength2 = 0.0f;
+            for (uint32_t c = 0; c < N; ++c)
+                nextLength2 += next[c] * next[c];
+            if (nextLength2 < 1e-12f)
+                break;
+            std::copy_n(next, N, axis);
+            length2 = nextLength2;
+        }
+        float invLength = 1.0f / std::sqrt(length2);
+        for (uint32_t c = 0; c < N; ++c)
+            axis[c] *= invLength;
+
+        float minT = INFINITY;
+        float maxT = -INFINITY;
+        for (uint32_t p = 0; p < numPixels; ++p) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < N; ++c)
+                t += (pixels[p][c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (uint32_t c = 0; c < N; ++c) {
+            e0[c] = clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+            e1[c] = clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        }
+    }
+
+    // JP: 各画素の補間の重み(e1側)を固定して、二乗誤差が最小になる端点を求める。
+    // EN: Fix the interpolation weight (for e1) of each pixel and compute the endpoints minimizing the squared error.
+    template <uint32_t N>
+    static bool solveEndpoints(const float (*pixels)[N], const float* weights, uint32_t numPixels, float e0[N], float e1[N]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[N] = {}, bx[N] = {};
+        for (uint32_t p = 0; p < numPixels; ++p) {
+            float a = 1.0f - weights[p];
+            float b = weights[p];
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = 0; c < N; ++c) {
+                ax[c] += a * pixels[p][c];
+                bx[c] += b * pixels[p][c];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f)
+            return false;
+        float invDet = 1.0f / det;
+        for (uint32_t c = 0; c < N; ++c) {
+            e0[c] = clamp((ax[c] * bb - bx[c] * ab) * invDet, 0.0f, 255.0f);
+            e1[c] = clamp((bx[c] * aa - ax[c] * ab) * invDet, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // JP: 端点の推定、量子化、インデックスの選択、最小二乗法による端点の再推定を誤差が減らなくなるまで(最大3回)繰り返す。
+    // EN: The encoders below repeat endpoint estimation, quantization, index selection and endpoint re-estimation by least squares until the error stops decreasing (up to three times).
+    static constexpr int NumEndpointRefinements = 3;
+
+    static uint32_t quantizeTo565(const float rgb[3]) {
+        uint32_t r = (uint32_t)std::round(rgb[0] * 31 / 255.0f);
+        uint32_t g = (uint32_t)std::round(rgb[1] * 63 / 255.0f);
+        uint32_t b = (uint32_t)std::round(rgb[2] * 31 / 255.0f);
+        return (r << 11) | (g << 5) | b;
+    }
+
+    // JP: 各画素にパレットの最も近い色を選び、二乗誤差の合計を返す。3色モードでは透明な画素にインデックス3を使う。
+    // EN: Select the nearest color in the palette for each pixel and return the sum of squared errors. In the three-color mode, transparent pixels use the index 3.
+    static float selectColorIndices(const uint8_t texels[16][4], bool allowsPunchThrough, uint32_t c0, uint32_t c1, uint32_t* indices) {
+        uint32_t palette[4][4];
+        buildColorPalette(c0, c1, allowsPunchThrough, palette);
+        bool isThreeColorMode = allowsPunchThrough && c0 <= c1;
+
+        float error = 0.0f;
+        *indices = 0;
+        for (int i = 0; i < 16; ++i) {
+            uint32_t bestIndex = 3;
+            float bestDist2 = 0.0f;
+            if (!isThreeColorMode || texels[i][3] >= 128) {
+                bestDist2 = INFINITY;
+                for (uint32_t k = 0; k < (isThreeColorMode ? 3u : 4u); ++k) {
+                    float dist2 = 0.0f;
+                    for (int c = 0; c < 3; ++c) {
+                        float d = (float)texels[i][c] - (float)palette[k][c];
+                        dist2 += d * d;
+                    }
+                    if (dist2 < bestDist2) {
+                        bestDist2 = dist2;
+                        bestIndex = k;
+                    }
+                }
+            }
+            error += bestDist2;
+            *indices |= bestIndex << (2 * i);
+        }
+        return error;
+    }
+
+    // JP: パンチスルーアルファを許す場合(BC1)、アルファが128未満の画素は3色モードの透明色にする。
+    // EN: If punch-through alpha is allowed (BC1), pixels with alpha less than 128 use the transparent color of the three-color mode.
+    static void encodeColorBlock(const uint8_t texels[16][4], bool allowsPunchThrough, uint8_t* block) {
+        float pixels[16][3];
+        uint32_t pixelIndices[16];
+        uint32_t numPixels = 0;
+        bool hasTransparentPixels = false;
+        for (int i = 0; i < 16; ++i) {
+            if (allowsPunchThrough && texels[i][3] < 128) {
+                hasTransparentPixels = true;
+                continue;
+            }
+            for (int c = 0; c < 3; ++c)
+                pixels[numPixels][c] = texels[i][c];
+            pixelIndices[numPixels++] = i;
+        }
+
+        // JP: すべて透明な場合は3色モードで全画素にインデックス3を使う。
+        // EN: If all the pixels are transparent, use the index 3 for all the pixels in the three-color mode.
+        uint32_t c0 = 0;
+        uint32_t c1 = 0;
+        uint32_t indices = 0xFFFFFFFF;
+        if (numPixels > 0) {
+            float e0[3], e1[3];
+            computeEndpointsAlongPrincipalAxis<3>(pixels, numPixels, e0, e1);
+            float bestError = INFINITY;
+            for (int iteration = 0; iteration < NumEndpointRefinements; ++iteration) {
+                // JP: 4色モードはc0 > c1、3色モードはc0 <= c1で選ばれる。
+                // EN: The four-color mode is selected by c0 > c1, and the three-color mode by c0 <= c1.
+                uint32_t q0 = quantizeTo565(e0);
+                uint32_t q1 = quantizeTo565(e1);
+                if (hasTransparentPixels ? q0 > q1 : q0 < q1) {
+                    std::swap(q0, q1);
+                    std::swap(e0, e1);
+                }
+
+                uint32_t curIndices;
+                float error = selectColorIndices(texels, allowsPunchThrough, q0, q1, &curIndices);
+                if (error >= bestError)
+                    break;
+                bestError = error;
+                c0 = q0;
+                c1 = q1;
+                indices = curIndices;
+
+                bool isThreeColorMode = allowsPunchThrough && q0 <= q1;
+                static const float WeightsFourColors[] = { 0.0f, 1.0f, 1.0f / 3, 2.0f / 3 };
+                static const float WeightsThreeColors[] = { 0.0f, 1.0f, 0.5f, 0.0f };
+                float weights[16];
+                for (uint32_t p = 0; p < numPixels; ++p) {
+                    uint32_t index = (curIndices >> (2 * pixelIndices[p])) & 0x3;
+                    weights[p] = (isThreeColorMode ? WeightsThreeColors : WeightsFourColors)[index];
+                }
+                if (!solveEndpoints<3>(pixels, weights, numPixels, e0, e1))
+                    break;
+            }
+        }
+
+        block[0] = c0 & 0xFF;
+        block[1] = c0 >> 8;
+        block[2] = c1 & 0xFF;
+        block[3] = c1 >> 8;
+        std::memcpy(block + 4, &indices, sizeof(indices));
+    }
+
+    static float selectBC4Indices(const uint8_t values[16], uint32_t v0, uint32_t v1, uint64_t* indices) {
+        uint32_t palette[8];
+        buildBC4Palette(v0, v1, palette);
+
+        float error = 0.0f;
+        *indices = 0;
+        for (int i = 0; i < 16; ++i) {
+            uint32_t bestIndex = 0;
+            int32_t bestDist = INT32_MAX;
+            for (uint32_t k = 0; k < 8; ++k) {
+                int32_t dist = std::abs((int32_t)values[i] - (int32_t)palette[k]);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    bestIndex = k;
+                }
+            }
+            error += (float)(bestDist * bestDist);
+            *indices |= (uint64_t)bestIndex << (3 * i);
+        }
+        return error;
+    }
+
+    // JP: 最小値と最大値を端点にした8値のモードと、0と255以外の値の範囲を端点にした6値のモードのうち誤差の小さい方を使う。
+    // EN: Use whichever has the smaller error of the eight-value mode with the minimum and maximum as the endpoints,
+    //     and the six-value mode with the range of values other than 0 and 255 as the endpoints.
+    static void encodeBC4Block(const uint8_t values[16], uint8_t* block) {
+        uint32_t minValue = 255, maxValue = 0;
+        uint32_t minInnerValue = 255, maxInnerValue = 0;
+        for (int i = 0; i < 16; ++i) {
+            minValue = std::min<uint32_t>(minValue, values[i]);
+            maxValue = std::max<uint32_t>(maxValue, values[i]);
+            if (values[i] != 0 && values[i] != 255) {
+                minInnerValue = std::min<uint32_t>(minInnerValue, values[i]);
+                maxInnerValue = std::max<uint32_t>(maxInnerValue, values[i]);
+            }
+        }
+
+        uint32_t v0 = maxValue;
+        uint32_t v1 = minValue;
+        uint64_t indices;
+        float error = selectBC4Indices(values, v0, v1, &indices);
+        if ((minValue == 0 || maxValue == 255) && minInnerValue <= maxInnerValue) {
+            uint64_t sixValueIndices;
+            float sixValueError = selectBC4Indices(values, minInnerValue, maxInnerValue, &sixValueIndices);
+            if (sixValueError < error) {
+                v0 = minInnerValue;
+                v1 = maxInnerValue;
+                indices = sixValueIndices;
+            }
+        }
+
+        block[0] = (uint8_t)v0;
+        block[1] = (uint8_t)v1;
+        std::memcpy(block + 2, &indices, 6);
+    }
+
+    // JP: 7ビットの値とPビットの組み合わせで8ビットの端点に最も近いものを選ぶ。
+    // EN: Select the combination of 7-bit values and a p-bit closest to the 8-bit endpoint.
+    static void quantizeBC7Mode6Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t* pBit) {
+        float bestError = INFINITY;
+        for (uint32_t p = 0; p < 2; ++p) {
+            uint32_t values[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                values[c] = (uint32_t)clamp(std::round((endpoint[c] - p) / 2), 0.0f, 127.0f);
+                float d = (float)((values[c] << 1) | p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                std::copy_n(values, 4, quantized);
+                *pBit = p;
+            }
+        }
+    }
+
+    static float selectBC7Mode6Indices(const float pixels[16][4], const uint32_t endpoints[2][4], uint32_t indices[16]) {
+        float palette[16][4];
+        for (int k = 0; k < 16; ++k) {
+            uint32_t w = InterpolationWeights4[k];
+            for (int c = 0; c < 4; ++c)
+                palette[k][c] = (float)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+        }
+
+        float error = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float bestDist2 = INFINITY;
+            for (uint32_t k = 0; k < 16; ++k) {
+                float dist2 = 0.0f;
+                for (int c = 0; c < 4; ++c) {
+                    float d = pixels[i][c] - palette[k][c];
+                    dist2 += d * d;
+                }
+                if (dist2 < bestDist2) {
+                    bestDist2 = dist2;
+                    indices[i] = k;
+                }
+            }
+            error += bestDist2;
+        }
+        return error;
+    }
+
+    // JP: BC7はモード6(1サブセット、RGBA各7ビットと端点ごとのPビット、4ビットのインデックス)だけで符号化する。
+    // EN: BC7 is encoded only with the mode 6 (one subset, 7 bits per RGBA component with a p-bit per endpoint, 4-bit indices).
+    static void encodeBC7Block(const uint8_t texels[16][4], uint8_t* block) {
+        float pixels[16][4];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c)
+                pixels[i][c] = texels[i][c];
+        }
+
+        float e0[4], e1[4];
+        computeEndpointsAlongPrincipalAxis<4>(pixels, 16, e0, e1);
+        uint32_t bestValues[2][4];
+        uint32_t bestPBits[2];
+        uint32_t bestIndices[16];
+        float bestError = INFINITY;
+        for (int iteration = 0; iteration < NumEndpointRefinements; ++iteration) {
+            uint32_t values[2][4];
+            uint32_t pBits[2];
+            quantizeBC7Mode6Endpoint(e0, values[0], &pBits[0]);
+            quantizeBC7Mode6Endpoint(e1, values[1], &pBits[1]);
+            uint32_t endpoints[2][4];
+            for (int e = 0; e < 2; ++e) {
+                for (int c = 0; c < 4; ++c)
+                    endpoints[e][c] = (values[e][c] << 1) | pBits[e];
+            }
+
+            uint32_t indices[16];
+            float error = selectBC7Mode6Indices(pixels, endpoints, indices);
+            if (error >= bestError)
+                break;
+            bestError = error;
+            std::copy_n(&values[0][0], 8, &bestValues[0][0]);
+            std::copy_n(pBits, 2, bestPBits);
+            std::copy_n(indices, 16, bestIndices);
+
+            float weights[16];
+            for (int i = 0; i < 16; ++i)
+                weights[i] = InterpolationWeights4[indices[i]] / 64.0f;
+            if (!solveEndpoints<4>(pixels, weights, 16, e0, e1))
+                break;
+        }
+
+        // JP: アンカー(画素0)のインデックスの最上位ビットは0でなければならないので、必要なら端点を入れ替えてインデックスを反転する。
+        //     重みの表は対称なので復号結果は変わらない。
+        // EN: The most significant bit of the index of the anchor (pixel 0) must be 0, so swap the endpoints and invert the indices if necessary.
+        //     The weight table is symmetric, so the decoded result does not change.
+        if (bestIndices[0] >= 8) {
+            for (int c = 0; c < 4; ++c)
+                std::swap(bestValues[0][c], bestValues[1][c]);
+            std::swap(bestPBits[0], bestPBits[1]);
+            for (int i = 0; i < 16; ++i)
+                bestIndices[i] = 15 - bestIndices[i];
+        }
+
+        BlockBitWriter writer;
+        writer.write(1 << 6, 7);
+        for (int c = 0; c < 4; ++c) {
+            writer.write(bestValues[0][c], 7);
+            writer.write(bestValues[1][c], 7);
+        }
+        writer.write(bestPBits[0], 1);
+        writer.write(bestPBits[1], 1);
+        for (int i = 0; i < 16; ++i)
+            writer.write(bestIndices[i], i == 0 ? 3 : 4);
+        writer.store(block);
+    }
+
+    void compressBlocks(const uint8_t* srcData, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint8_t* dstData) {
+        VLRAssert(isCompressibleFormat(bcFormat), "Compression to the specified format is not supported.");
+        uint32_t widthInBlocks = nextMultiplierForPowOf2(width, 4);
+        uint32_t heightInBlocks = nextMultiplierForPowOf2(height, 4);
+        uint32_t blockSize = (bcFormat == VLRDataFormat_BC1 || bcFormat == VLRDataFormat_BC4) ? 8 : 16;
+        uint32_t numChannels = bcFormat == VLRDataFormat_BC4 ? 1 : (bcFormat == VLRDataFormat_BC5 ? 2 : 4);
+
+        processRowsInParallel(16 * widthInBlocks, heightInBlocks, [&](uint32_t by) {
+            for (uint32_t bx = 0; bx < widthInBlocks; ++bx) {
+                // JP: 画像からはみ出す部分は端の画素で埋める。
+                // EN: Fill the part outside the image with the edge pixels.
+                uint8_t texels[16][4] = {};
+                for (uint32_t ty = 0; ty < 4; ++ty) {
+                    uint32_t y = std::min(4 * by + ty, height - 1);
+                    for (uint32_t tx = 0; tx < 4; ++tx) {
+                        uint32_t x = std::min(4 * bx + tx, width - 1);
+                        const uint8_t* src = srcData + (width * y + x) * numChannels;
+                        std::copy_n(src, numChannels, texels[4 * ty + tx]);
+                    }
+                }
+
+                uint8_t* block = dstData + (widthInBlocks * by + bx) * blockSize;
+                switch (bcFormat) {
+                case VLRDataFormat_BC1: {
+                    encodeColorBlock(texels, true, block);
+                    break;
+                }
+                case VLRDataFormat_BC3: {
+                    uint8_t alphas[16];
+                    for (int i = 0; i < 16; ++i)
+                        alphas[i] = texels[i][3];
+                    encodeBC4Block(alphas, block);
+                    encodeColorBlock(texels, false, block + 8);
+                    break;
+                }
+                case VLRDataFormat_BC4:
+                case VLRDataFormat_BC5: {
+                    for (uint32_t c = 0; c < numChannels; ++c) {
+                        uint8_t values[16];
+                        for (int i = 0; i < 16; ++i)
+                            values[i] = texels[i][c];
+                        encodeBC4Block(values, block + 8 * c);
+                    }
+                    break;
+                }
+                case VLRDataFormat_BC7: {
+                    encodeBC7Block(texels, block);
+                    break;
+                }
+                default:
+                    VLRAssert_ShouldNotBeCalled();
+                    break;
+                }
+            }
+        });
+    }
+
+
+
+    static const char CompressedImageCacheMagic[4] = { 'V', 'L', 'B', 'C' };
+    // JP: 符号化の結果が変わる変更をした場合は上げて古いキャッシュを無効にする。
+    // EN: Increment this when making changes that alter encoded results to invalidate old caches.
+    static const uint32_t CompressedImageCacheVersion = 2;
+
+    // JP: dataSizeとdataHashは全レベルのデータの合計の大きさとハッシュで、途中で切れたり壊れたりしたファイルを弾く。
+    // EN: dataSize and dataHash are the total size and the hash of the data of all the levels to reject truncated or corrupted files.
+    struct CompressedImageCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t dataFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static uint64_t computeCompressedDataHash(const std::vector<std::vector<uint8_t>> &mipData) {
+        uint64_t hash = 0;
+        for (const auto &levelData : mipData)
+            hash = computeDataHash(levelData.data(), levelData.size(), hash);
+        return hash;
+    }
+
+    bool loadCompressedImageCache(const char* filePath, uint64_t key, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint32_t mipCount,
+                                  std::vector<std::vector<uint8_t>>* mipData) {
+        std::ifstream ifs(filePath, std::ios::in | std::ios::binary);
+        if (!ifs.is_open())
+            return false;
+
+        CompressedImageCacheHeader header;
+        if (!ifs.read((char*)&header, sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, CompressedImageCacheMagic, sizeof(header.magic)) != 0 ||
+            header.version != CompressedImageCacheVersion || header.key != key || header.dataFormat != (uint32_t)bcFormat ||
+            header.width != width || header.height != height || header.mipCount != mipCount)
+            return false;
+
+        std::vector<std::vector<uint8_t>> levels(mipCount);
+        uint64_t dataSize = 0;
+        for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel) {
+            uint32_t levelWidth = std::max<uint32_t>(width >> mipLevel, 1);
+            uint32_t levelHeight = std::max<uint32_t>(height >> mipLevel, 1);
+            levels[mipLevel].resize(getCompressedSize(bcFormat, levelWidth, levelHeight));
+            dataSize += levels[mipLevel].size();
+        }
+        if (header.dataSize != dataSize)
+            return false;
+
+        for (auto &levelData : levels) {
+            if (!ifs.read((char*)levelData.data(), levelData.size()))
+                return false;
+        }
+        if (ifs.peek() != std::ifstream::traits_type::eof() || computeCompressedDataHash(levels) != header.dataHash)
+            return false;
+        *mipData = std::move(levels);
+
+        return true;
+    }
+
+    bool saveCompressedImageCache(const char* filePath, uint64_t key, VLRDataFormat bcFormat, uint32_t width, uint32_t height,
+                                  const std::vector<std::vector<uint8_t>> &mipData) {
+        // JP: 一時ファイルに書き終えてから置き換えて、他のプロセスや書き込みの失敗で壊れたキャッシュが見えないようにする。
+        // EN: Replace after finishing writing to a temporary file so that a cache broken by another process or a failed write is never visible.
+        std::string tmpFilePath = std::string(filePath) + ".tmp";
+        std::ofstream ofs(tmpFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open())
+            return false;
+
+        CompressedImageCacheHeader header;
+        std::memcpy(header.magic, CompressedImageCacheMagic, sizeof(header.magic));
+        header.version = CompressedImageCacheVersion;
+        header.key = key;
+        header.dataFormat = bcFormat;
+        header.width = width;
+        header.height = height;
+        header.mipCount = (uint32_t)mipData.size();
+        header.dataSize = 0;
+        for (const auto &levelData : mipData)
+            header.dataSize += levelData.size();
+        header.dataHash = computeCompressedDataHash(mipData);
+        ofs.write((const char*)&header, sizeof(header));
+        for (const auto &levelData : mipData)
+            ofs.write((const char*)levelData.data(), levelData.size());
+        ofs.flush();
+        ofs.close();
+
+        if (ofs.fail() || !replaceFile(tmpFilePath, filePath)) {
+            std::remove(tmpFilePath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+}
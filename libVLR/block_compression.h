@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+namespace VLR {
+    // JP: ブロック圧縮形式を展開した先の内部形式。
+    //     BC1, BC2, BC3, BC7はRGBA8x4、BC4はGray8、BC4_SignedはGray32F([-1, 1])、BC5とBC5_SignedはRG32Fx2、BC6HとBC6H_SignedはRGBA16Fx4(アルファは1)。
+    // EN: Internal format to which a block-compressed format is decompressed.
+    //     BC1, BC2, BC3 and BC7 become RGBA8x4, BC4 becomes Gray8, BC4_Signed becomes Gray32F ([-1, 1]), BC5 and BC5_Signed become RG32Fx2, and BC6H and BC6H_Signed become RGBA16Fx4 (alpha is 1).
+    VLRDataFormat getDecompressedFormat(VLRDataFormat bcFormat);
+
+    // JP: 1ミップレベル分のブロック圧縮データを展開する。出力はwidth x heightの画素が行間に隙間無く並ぶ。
+    //     ブロックの行単位で並列に処理する。
+    // EN: Decompress block-compressed data for one mip level. The output has width x height pixels arranged without gaps between rows.
+    //     This processes rows of blocks in parallel.
+    void decompressBlocks(const uint8_t* srcData, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint8_t* dstData);
+
+    // JP: 圧縮に対応する形式(BC1, BC3, BC4, BC5, BC7)か。
+    // EN: Whether compression to the format (BC1, BC3, BC4, BC5, BC7) is supported.
+    bool isCompressibleFormat(VLRDataFormat bcFormat);
+
+    size_t getCompressedSize(VLRDataFormat bcFormat, uint32_t width, uint32_t height);
+
+    // JP: 1ミップレベル分の画像をブロック圧縮する。入力はBC1, BC3, BC7ではRGBA、BC4では1チャンネル、BC5では2チャンネルの8ビット値で、行間に隙間無く並ぶ。
+    //     ブロックの行単位で並列に処理する。BC7はモード6だけを使う。
+    // EN: Block-compress an image for one mip level. The input is 8-bit values of RGBA for BC1, BC3 and BC7, one channel for BC4, and two channels for BC5, arranged without gaps between rows.
+    //     This processes rows of blocks in parallel. BC7 uses only the mode 6.
+    void compressBlocks(const uint8_t* srcData, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint8_t* dstData);
+
+    // JP: 圧縮結果のキャッシュファイル。キー、形式、解像度、ミップレベル数がすべて一致し、全レベルを読めてデータの大きさとハッシュも一致した場合のみ成功する。
+    //     保存は一時ファイルに書いてから置き換える。
+    // EN: Cache file of compressed results. Loading succeeds only if the key, format, resolution and the number of mip levels all match,
+    //     and all the levels can be read with matching data size and hash.
+    //     Saving writes to a temporary file and then replaces.
+    bool loadCompressedImageCache(const char* filePath, uint64_t key, VLRDataFormat bcFormat, uint32_t width, uint32_t height, uint32_t mipCount,
+                                  std::vector<std::vector<uint8_t>>* mipData);
+    bool saveCompressedImageCache(const char* filePath, uint64_t key, VLRDataFormat bcFormat, uint32_t width, uint32_t height,
+                                  const std::vector<std::vector<uint8_t>> &mipData);
+}
@@ -3,6 +3,9 @@
 #include <random>
 
 #include "scene.h"
+#include "tiled_image.h"
+#include "cpu_renderer.h"
+#include "resolve.h"
 
 namespace VLR {
     std::string readTxtFile(const std::string& filepath) {
@@ -31,6 +34,7 @@ namespace VLR {
     defineClassID(Object, Image2D);
     defineClassID(Image2D, LinearImage2D);
     defineClassID(Image2D, BlockCompressedImage2D);
+    defineClassID(Image2D, TiledImage2D);
 
     defineClassID(Object, ShaderNode);
     defineClassID(ShaderNode, GeometryShaderNode);
@@ -100,39 +104,66 @@ namespace VLR {
             throw optix::Exception::makeException(code, 0);
     }
 
-    Context::Context(bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices) {
-        // JP: 使用するすべてのGPUがRTXをサポートしている(= Maxwell世代以降のGPU)か調べる。
-        // EN: check if all the GPUs to use support RTX (i.e. Maxwell or later generation GPU).
-        bool satisfyRequirements = true;
-        const int32_t* deviceIndices = devices;
-        if (devices == nullptr || numDevices == 0) {
-            rtDeviceGetDeviceCount(&numDevices);
-            auto _devices = new int32_t[numDevices];
-            for (int i = 0; i < numDevices; ++i)
-                _devices[i] = i;
-            deviceIndices = _devices;
-        }
-        for (int i = 0; i < numDevices; ++i) {
-            int32_t computeCapability[2];
-            checkError(rtDeviceGetAttribute(deviceIndices[i], RT_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY, sizeof(computeCapability), computeCapability));
-            satisfyRequirements &= computeCapability[0] >= 5;
-            if (!satisfyRequirements)
-                break;
-        }
-        if (devices == nullptr || numDevices == 0)
-            delete[] deviceIndices;
-        if (!satisfyRequirements) {
-            vlrprintf("Selected devices don't satisfy compute capability 5.0.\n");
-            checkError(RT_ERROR_INVALID_CONTEXT);
-            return;
-        }
+    // JP: スペクトルノードのデスクリプターの大きさはレンダリングモードによって異なる。
+    // EN: The size of a spectrum node descriptor differs by rendering mode.
+    static size_t getSpectrumNodeDescriptorSize(VLRRenderingMode renderingMode) {
+        if (renderingMode == VLRRenderingMode_Spectral)
+            return sizeof(Shared::SpectrumNodeDescriptorTemplate<VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL>);
+        else
+            return sizeof(Shared::SpectrumNodeDescriptorTemplate<VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_RGB>);
+    }
 
-        m_RTXEnabled = enableRTX;
-        int32_t RTXEnabled = m_RTXEnabled;
-        if (rtGlobalSetAttribute(RT_GLOBAL_ATTRIBUTE_ENABLE_RTX, sizeof(RTXEnabled), &RTXEnabled) == RT_SUCCESS)
-            vlrprintf("RTX %s\n", RTXEnabled ? "ON" : "OFF");
+    static uint32_t getSpectrumStorageSize(VLRRenderingMode renderingMode) {
+        if (renderingMode == VLRRenderingMode_Spectral)
+            return sizeof(SpectralRenderingTypes::SpectrumStorage);
         else
-            vlrprintf("failed to set the global attribute RT_GLOBAL_ATTRIBUTE_ENABLE_RTX.\n");
+            return sizeof(RGBRenderingTypes::SpectrumStorage);
+    }
+
+    Context::Context(bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices,
+                     VLRBackend backend, VLRRenderingMode renderingMode) {
+        m_backend = backend;
+        m_renderingMode = renderingMode;
+
+        // JP: CPUバックエンドはGPUを使わないので、デバイスの確認とRTXの設定を行わない。
+        // EN: The CPU backend doesn't use GPUs, so it skips checking devices and setting RTX.
+        if (m_backend == VLRBackend_CPU) {
+            m_RTXEnabled = false;
+        }
+        else {
+            // JP: 使用するすべてのGPUがRTXをサポートしている(= Maxwell世代以降のGPU)か調べる。
+            // EN: check if all the GPUs to use support RTX (i.e. Maxwell or later generation GPU).
+            bool satisfyRequirements = true;
+            const int32_t* deviceIndices = devices;
+            if (devices == nullptr || numDevices == 0) {
+                rtDeviceGetDeviceCount(&numDevices);
+                auto _devices = new int32_t[numDevices];
+                for (int i = 0; i < numDevices; ++i)
+                    _devices[i] = i;
+                deviceIndices = _devices;
+            }
+            for (int i = 0; i < numDevices; ++i) {
+                int32_t computeCapability[2];
+                checkError(rtDeviceGetAttribute(deviceIndices[i], RT_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY, sizeof(computeCapability), computeCapability));
+                satisfyRequirements &= computeCapability[0] >= 5;
+                if (!satisfyRequirements)
+                    break;
+            }
+            if (devices == nullptr || numDevices == 0)
+                delete[] deviceIndices;
+            if (!satisfyRequirements) {
+                vlrprintf("Selected devices don't satisfy compute capability 5.0.\n");
+                checkError(RT_ERROR_INVALID_CONTEXT);
+                return;
+            }
+
+            m_RTXEnabled = enableRTX;
+            int32_t RTXEnabled = m_RTXEnabled;
+            if (rtGlobalSetAttribute(RT_GLOBAL_ATTRIBUTE_ENABLE_RTX, sizeof(RTXEnabled), &RTXEnabled) == RT_SUCCESS)
+                vlrprintf("RTX %s\n", RTXEnabled ? "ON" : "OFF");
+            else
+                vlrprintf("failed to set the global attribute RT_GLOBAL_ATTRIBUTE_ENABLE_RTX.\n");
+        }
 
         vlrprintf("Start initializing VLR ...");
 
@@ -140,40 +171,53 @@ namespace VLR {
 
         m_ID = getInstanceID();
 
-        m_optixContext = optix::Context::create();
+        // JP: CPUバックエンドはシーンやバッファー、プログラムをホストメモリ上に保持するコンテキストを使う。
+        //     OptiXのコンテキストを生成しないので、GPUやOptiXのDLLがなくても動作する。
+        // EN: The CPU backend uses a context holding the scene, buffers and programs in the host memory.
+        //     It doesn't create an OptiX context, so it works without a GPU or the OptiX DLL.
+        if (m_backend == VLRBackend_CPU)
+            m_optixContext = Backend::createHostContext();
+        else
+            m_optixContext = Backend::createOptiXContext();
+
+        // JP: プログラムの生成時にホスト関数を登録するため、最初に生成しておく。
+        // EN: Create this first to register host functions on creating programs.
+        m_cpuRenderer = nullptr;
+        if (m_backend == VLRBackend_CPU)
+            m_cpuRenderer = new CPU::Renderer(*this);
 
         m_optixContext->setEntryPointCount(EntryPoint::NumEntryPoints);
         m_optixContext->setRayTypeCount(Shared::RayType::NumTypes);
 
         {
-            std::string ptx = readTxtFile(VLR_PTX_DIR"path_tracing.ptx");
+            std::string ptx = readPTX("path_tracing.ptx");
 
-            m_optixProgramShadowAnyHitDefault = m_optixContext->createProgramFromPTXString(ptx, "VLR::shadowAnyHitDefault");
-            m_optixProgramAnyHitWithAlpha = m_optixContext->createProgramFromPTXString(ptx, "VLR::anyHitWithAlpha");
-            m_optixProgramShadowAnyHitWithAlpha = m_optixContext->createProgramFromPTXString(ptx, "VLR::shadowAnyHitWithAlpha");
-            m_optixProgramPathTracingIteration = m_optixContext->createProgramFromPTXString(ptx, "VLR::pathTracingIteration");
+            m_optixProgramShadowAnyHitDefault = createProgramFromPTXString(ptx, "VLR::shadowAnyHitDefault");
+            m_optixProgramAnyHitWithAlpha = createProgramFromPTXString(ptx, "VLR::anyHitWithAlpha");
+            m_optixProgramShadowAnyHitWithAlpha = createProgramFromPTXString(ptx, "VLR::shadowAnyHitWithAlpha");
+            m_optixProgramPathTracingIteration = createProgramFromPTXString(ptx, "VLR::pathTracingIteration");
 
-            m_optixProgramPathTracing = m_optixContext->createProgramFromPTXString(ptx, "VLR::pathTracing");
-            m_optixProgramPathTracingMiss = m_optixContext->createProgramFromPTXString(ptx, "VLR::pathTracingMiss");
-            m_optixProgramException = m_optixContext->createProgramFromPTXString(ptx, "VLR::exception");
+            m_optixProgramPathTracing = createProgramFromPTXString(ptx, "VLR::pathTracing");
+            m_optixProgramPathTracingMiss = createProgramFromPTXString(ptx, "VLR::pathTracingMiss");
+            m_optixProgramException = createProgramFromPTXString(ptx, "VLR::exception");
         }
         m_optixContext->setRayGenerationProgram(EntryPoint::PathTracing, m_optixProgramPathTracing);
         m_optixContext->setExceptionProgram(EntryPoint::PathTracing, m_optixProgramException);
 
         {
-            std::string ptx = readTxtFile(VLR_PTX_DIR"debug_rendering.ptx");
+            std::string ptx = readPTX("debug_rendering.ptx");
 
-            m_optixProgramDebugRenderingClosestHit = m_optixContext->createProgramFromPTXString(ptx, "VLR::debugRenderingClosestHit");
-            m_optixProgramDebugRenderingMiss = m_optixContext->createProgramFromPTXString(ptx, "VLR::debugRenderingMiss");
-            m_optixProgramDebugRenderingRayGeneration = m_optixContext->createProgramFromPTXString(ptx, "VLR::debugRenderingRayGeneration");
-            m_optixProgramDebugRenderingException = m_optixContext->createProgramFromPTXString(ptx, "VLR::debugRenderingException");
+            m_optixProgramDebugRenderingClosestHit = createProgramFromPTXString(ptx, "VLR::debugRenderingClosestHit");
+            m_optixProgramDebugRenderingMiss = createProgramFromPTXString(ptx, "VLR::debugRenderingMiss");
+            m_optixProgramDebugRenderingRayGeneration = createProgramFromPTXString(ptx, "VLR::debugRenderingRayGeneration");
+            m_optixProgramDebugRenderingException = createProgramFromPTXString(ptx, "VLR::debugRenderingException");
         }
         m_optixContext->setRayGenerationProgram(EntryPoint::DebugRendering, m_optixProgramDebugRenderingRayGeneration);
         m_optixContext->setExceptionProgram(EntryPoint::DebugRendering, m_optixProgramDebugRenderingException);
 
         {
-            std::string ptx = readTxtFile(VLR_PTX_DIR"convert_to_rgb.ptx");
-            m_optixProgramConvertToRGB = m_optixContext->createProgramFromPTXString(ptx, "VLR::convertToRGB");
+            std::string ptx = readPTX("convert_to_rgb.ptx");
+            m_optixProgramConvertToRGB = createProgramFromPTXString(ptx, "VLR::convertToRGB");
         }
         m_optixContext->setRayGenerationProgram(EntryPoint::ConvertToRGB, m_optixProgramConvertToRGB);
 
@@ -204,8 +248,23 @@ namespace VLR {
             std::copy_n(UpsampledSpectrum::spectrum_data_points, NumSpectrumDataPoints, values);
             m_optixBufferUpsampledSpectrum_spectrum_data_points->unmap();
         }
+        m_optixBufferUpsampledSpectrum_spectrum_triangles = m_optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, UpsampledSpectrum::numTriangles);
+        m_optixBufferUpsampledSpectrum_spectrum_triangles->setElementSize(sizeof(UpsampledSpectrum::spectrum_triangle_t));
+        {
+            auto values = (UpsampledSpectrum::spectrum_triangle_t*)m_optixBufferUpsampledSpectrum_spectrum_triangles->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+            std::copy_n(UpsampledSpectrum::spectrum_triangles, UpsampledSpectrum::numTriangles, values);
+            m_optixBufferUpsampledSpectrum_spectrum_triangles->unmap();
+        }
+        m_optixBufferUpsampledSpectrum_adjacency_table = m_optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_SHORT, UpsampledSpectrum::NumAdjacencyTableEntries());
+        {
+            auto values = (uint16_t*)m_optixBufferUpsampledSpectrum_adjacency_table->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+            std::copy_n(UpsampledSpectrum::adjacency_table, UpsampledSpectrum::NumAdjacencyTableEntries(), values);
+            m_optixBufferUpsampledSpectrum_adjacency_table->unmap();
+        }
         m_optixContext["VLR::UpsampledSpectrum_spectrum_grid"]->set(m_optixBufferUpsampledSpectrum_spectrum_grid);
         m_optixContext["VLR::UpsampledSpectrum_spectrum_data_points"]->set(m_optixBufferUpsampledSpectrum_spectrum_data_points);
+        m_optixContext["VLR::UpsampledSpectrum_spectrum_triangles"]->set(m_optixBufferUpsampledSpectrum_spectrum_triangles);
+        m_optixContext["VLR::UpsampledSpectrum_adjacency_table"]->set(m_optixBufferUpsampledSpectrum_adjacency_table);
 
 
 
@@ -246,7 +305,7 @@ namespace VLR {
 
         m_maxNumSpectrumNodeDescriptors = 1024;
         m_optixSpectrumNodeDescriptorBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, m_maxNumSpectrumNodeDescriptors);
-        m_optixSpectrumNodeDescriptorBuffer->setElementSize(sizeof(Shared::SpectrumNodeDescriptor));
+        m_optixSpectrumNodeDescriptorBuffer->setElementSize(getSpectrumNodeDescriptorSize(m_renderingMode));
         m_spectrumNodeDescSlotManager.initialize(m_maxNumSpectrumNodeDescriptors);
 
         m_optixContext["VLR::pv_spectrumNodeDescriptorBuffer"]->set(m_optixSpectrumNodeDescriptorBuffer);
@@ -266,15 +325,15 @@ namespace VLR {
         m_optixContext["VLR::pv_edfProcedureSetBuffer"]->set(m_optixEDFProcedureSetBuffer);
 
         {
-            std::string ptx = readTxtFile(VLR_PTX_DIR"materials.ptx");
+            std::string ptx = readPTX("materials.ptx");
 
-            m_optixCallableProgramNullBSDF_setupBSDF = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_setupBSDF");
-            m_optixCallableProgramNullBSDF_getBaseColor = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_getBaseColor");
-            m_optixCallableProgramNullBSDF_matches = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_matches");
-            m_optixCallableProgramNullBSDF_sampleInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_sampleInternal");
-            m_optixCallableProgramNullBSDF_evaluateInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_evaluateInternal");
-            m_optixCallableProgramNullBSDF_evaluatePDFInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_evaluatePDFInternal");
-            m_optixCallableProgramNullBSDF_weightInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullBSDF_weightInternal");
+            m_optixCallableProgramNullBSDF_setupBSDF = createProgramFromPTXString(ptx, "VLR::NullBSDF_setupBSDF");
+            m_optixCallableProgramNullBSDF_getBaseColor = createProgramFromPTXString(ptx, "VLR::NullBSDF_getBaseColor");
+            m_optixCallableProgramNullBSDF_matches = createProgramFromPTXString(ptx, "VLR::NullBSDF_matches");
+            m_optixCallableProgramNullBSDF_sampleInternal = createProgramFromPTXString(ptx, "VLR::NullBSDF_sampleInternal");
+            m_optixCallableProgramNullBSDF_evaluateInternal = createProgramFromPTXString(ptx, "VLR::NullBSDF_evaluateInternal");
+            m_optixCallableProgramNullBSDF_evaluatePDFInternal = createProgramFromPTXString(ptx, "VLR::NullBSDF_evaluatePDFInternal");
+            m_optixCallableProgramNullBSDF_weightInternal = createProgramFromPTXString(ptx, "VLR::NullBSDF_weightInternal");
 
             Shared::BSDFProcedureSet bsdfProcSet;
             {
@@ -291,9 +350,9 @@ namespace VLR {
 
 
 
-            m_optixCallableProgramNullEDF_setupEDF = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullEDF_setupEDF");
-            m_optixCallableProgramNullEDF_evaluateEmittanceInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullEDF_evaluateEmittanceInternal");
-            m_optixCallableProgramNullEDF_evaluateInternal = m_optixContext->createProgramFromPTXString(ptx, "VLR::NullEDF_evaluateInternal");
+            m_optixCallableProgramNullEDF_setupEDF = createProgramFromPTXString(ptx, "VLR::NullEDF_setupEDF");
+            m_optixCallableProgramNullEDF_evaluateEmittanceInternal = createProgramFromPTXString(ptx, "VLR::NullEDF_evaluateEmittanceInternal");
+            m_optixCallableProgramNullEDF_evaluateInternal = createProgramFromPTXString(ptx, "VLR::NullEDF_evaluateInternal");
 
             Shared::EDFProcedureSet edfProcSet;
             {
@@ -312,6 +371,17 @@ namespace VLR {
 
         m_optixContext["VLR::pv_materialDescriptorBuffer"]->set(m_optixSurfaceMaterialDescriptorBuffer);
 
+        m_numAccumFrames = 0;
+        m_resumeAccumulation = false;
+        m_sampleIndexOffset = 0;
+        m_nextSampleIndex = 0;
+        m_accumulationFormat = VLRAccumulationFormat_Compensated;
+        m_optixContext["VLR::pv_accumulationFormat"]->setUserData(sizeof(m_accumulationFormat), &m_accumulationFormat);
+
+        m_targetError = 0.0f;
+        m_converged = false;
+        m_optixContext["VLR::pv_adaptiveSampling"]->setUserData(sizeof(m_adaptiveSampling), &m_adaptiveSampling);
+
         SurfaceNode::initialize(*this);
         ShaderNode::initialize(*this);
         SurfaceMaterial::initialize(*this);
@@ -319,6 +389,11 @@ namespace VLR {
 
         vlrprintf(" done.\n");
 
+        // JP: 以降はOptiXのスタックや出力の設定なので、CPUバックエンドでは不要。
+        // EN: The following is setup of the OptiX stack and output, so it is unnecessary for the CPU backend.
+        if (m_backend == VLRBackend_CPU)
+            return;
+
 
 
         RTsize defaultStackSize = m_optixContext->getStackSize();
@@ -365,9 +440,17 @@ namespace VLR {
     }
 
     Context::~Context() {
+        m_imageCache.clear();
+
+        if (m_pixelStatisticsBuffer)
+            m_pixelStatisticsBuffer->destroy();
+
         if (m_rngBuffer)
             m_rngBuffer->destroy();
 
+        if (m_compactOutputBuffer)
+            m_compactOutputBuffer->destroy();
+
         if (m_rawOutputBuffer)
             m_rawOutputBuffer->destroy();
 
@@ -414,6 +497,8 @@ namespace VLR {
         m_optixMaterialWithAlpha->destroy();
         m_optixMaterialDefault->destroy();
 
+        m_optixBufferUpsampledSpectrum_adjacency_table->destroy();
+        m_optixBufferUpsampledSpectrum_spectrum_triangles->destroy();
         m_optixBufferUpsampledSpectrum_spectrum_data_points->destroy();
         m_optixBufferUpsampledSpectrum_spectrum_grid->destroy();
 
@@ -433,21 +518,44 @@ namespace VLR {
         m_optixProgramAnyHitWithAlpha->destroy();
         m_optixProgramShadowAnyHitDefault->destroy();
 
+        delete m_cpuRenderer;
+
         m_optixContext->destroy();
     }
 
+    Backend::Program Context::createProgramFromPTXString(const std::string &ptx, const std::string &programName) {
+        Backend::Program program = m_optixContext->createProgramFromPTXString(ptx, programName);
+        if (m_cpuRenderer)
+            m_cpuRenderer->registerProgram(program->getId(), programName);
+        return program;
+    }
+
+    std::string Context::readPTX(const std::string &filename) const {
+        // JP: CPUバックエンドのプログラムは名前でホスト関数に対応付けるのでPTXを読まない。
+        // EN: Programs of the CPU backend are associated with host functions by name, so PTX is not read.
+        if (m_backend == VLRBackend_CPU)
+            return "";
+        // JP: スペクトルレンダリング用のPTXはspectralサブディレクトリに出力される。
+        // EN: PTXes for spectral rendering are output to the spectral subdirectory.
+        if (m_renderingMode == VLRRenderingMode_Spectral)
+            return readTxtFile(VLR_PTX_DIR"spectral/" + filename);
+        return readTxtFile(VLR_PTX_DIR + filename);
+    }
+
     void Context::bindOutputBuffer(uint32_t width, uint32_t height, uint32_t glBufferID) {
         if (m_outputBuffer)
             m_outputBuffer->destroy();
-        if (m_rawOutputBuffer)
-            m_rawOutputBuffer->destroy();
         if (m_rngBuffer)
             m_rngBuffer->destroy();
+        if (m_pixelStatisticsBuffer)
+            m_pixelStatisticsBuffer->destroy();
 
         m_width = width;
         m_height = height;
 
-        if (glBufferID > 0) {
+        // JP: CPUバックエンドはOpenGLのバッファーと連携しないので、IDを無視してホストメモリ上のバッファーに出力する。
+        // EN: The CPU backend doesn't interoperate with OpenGL buffers, so it ignores the ID and outputs to a buffer in the host memory.
+        if (glBufferID > 0 && m_backend != VLRBackend_CPU) {
             m_outputBuffer = m_optixContext->createBufferFromGLBO(RT_BUFFER_INPUT_OUTPUT, glBufferID);
             m_outputBuffer->setFormat(RT_FORMAT_USER);
             m_outputBuffer->setSize(m_width, m_height);
@@ -458,24 +566,15 @@ namespace VLR {
         m_outputBuffer->setElementSize(sizeof(RGBSpectrum));
         m_optixContext["VLR::pv_RGBBuffer"]->set(m_outputBuffer);
 
-        m_rawOutputBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, m_width, m_height);
-        m_rawOutputBuffer->setElementSize(sizeof(SpectrumStorage));
-        m_optixContext["VLR::pv_spectrumBuffer"]->set(m_rawOutputBuffer);
-        m_optixContext["VLR::pv_outputBuffer"]->set(m_rawOutputBuffer);
+        allocateAccumulationBuffers();
+
+        m_pixelStatisticsBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, m_width, m_height);
+        m_pixelStatisticsBuffer->setElementSize(sizeof(Shared::PixelStatistics));
+        m_optixContext["VLR::pv_pixelStatisticsBuffer"]->set(m_pixelStatisticsBuffer);
 
         m_rngBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, m_width, m_height);
         m_rngBuffer->setElementSize(sizeof(uint64_t));
-        {
-            std::mt19937_64 rng(591842031321323413);
-
-            auto dstData = (uint64_t*)m_rngBuffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
-            for (int y = 0; y < m_height; ++y) {
-                for (int x = 0; x < m_width; ++x) {
-                    dstData[y * m_width + x] = rng();
-                }
-            }
-            m_rngBuffer->unmap();
-        }
+        initializeRNGStates();
         //m_rngBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, m_width, m_height);
         //m_rngBuffer->setElementSize(sizeof(uint32_t) * 4);
         //{
@@ -496,6 +595,38 @@ namespace VLR {
         m_optixContext["VLR::pv_rngBuffer"]->set(m_rngBuffer);
     }
 
+    // JP: 使わない形式のバッファーも変数に割り当てる必要があるので1画素分だけ確保する。
+    // EN: A buffer of the unused format also needs to be assigned to the variables, so allocate it only for one pixel.
+    void Context::allocateAccumulationBuffers() {
+        if (m_rawOutputBuffer)
+            m_rawOutputBuffer->destroy();
+        if (m_compactOutputBuffer)
+            m_compactOutputBuffer->destroy();
+
+        bool compact = m_accumulationFormat == VLRAccumulationFormat_CompactXYZ;
+
+        m_rawOutputBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, compact ? 1 : m_width, compact ? 1 : m_height);
+        m_rawOutputBuffer->setElementSize(getSpectrumStorageSize(m_renderingMode));
+        m_optixContext["VLR::pv_spectrumBuffer"]->set(m_rawOutputBuffer);
+        m_optixContext["VLR::pv_outputBuffer"]->set(m_rawOutputBuffer);
+
+        m_compactOutputBuffer = m_optixContext->createBuffer(RT_BUFFER_INPUT_OUTPUT, RT_FORMAT_USER, compact ? m_width : 1, compact ? m_height : 1);
+        m_compactOutputBuffer->setElementSize(sizeof(Shared::CompactXYZStorage));
+        m_optixContext["VLR::pv_compactOutputBuffer"]->set(m_compactOutputBuffer);
+    }
+
+    void Context::initializeRNGStates() {
+        std::mt19937_64 rng(591842031321323413 + m_sampleIndexOffset);
+
+        auto dstData = (uint64_t*)m_rngBuffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+        for (int y = 0; y < m_height; ++y) {
+            for (int x = 0; x < m_width; ++x) {
+                dstData[y * m_width + x] = rng();
+            }
+        }
+        m_rngBuffer->unmap();
+    }
+
     void* Context::mapOutputBuffer() {
         if (!m_outputBuffer)
             return nullptr;
@@ -512,8 +643,380 @@ namespace VLR {
         *height = m_height;
     }
 
-    void Context::render(Scene &scene, Camera* camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames) {
-        optix::Context optixContext = getOptiXContext();
+    bool Context::getBVHStatistics(VLRBVHStatistics* stats) const {
+        if (!m_cpuRenderer)
+            return false;
+
+        const CPU::BVHStatistics &bvhStats = m_cpuRenderer->getBVHStatistics();
+        stats->buildTime = bvhStats.buildTime;
+        stats->numNodes = bvhStats.numNodes;
+        stats->numLeafNodes = bvhStats.numLeafNodes;
+        stats->maxDepth = bvhStats.maxDepth;
+        stats->SAHCost = bvhStats.SAHCost;
+
+        return true;
+    }
+
+    bool Context::setCPUIntegrator(VLRCPUIntegrator integrator) {
+        if (!m_cpuRenderer)
+            return false;
+
+        m_cpuRenderer->setIntegrator(integrator);
+
+        return true;
+    }
+
+    bool Context::setCPUTileSize(uint32_t width, uint32_t height) {
+        if (!m_cpuRenderer)
+            return false;
+
+        m_cpuRenderer->setTileSize(width, height);
+
+        return true;
+    }
+
+    bool Context::getCPUThreadStatistics(VLRCPUThreadStatistics* stats, uint32_t maxNumThreads, uint32_t* numThreads) const {
+        if (!m_cpuRenderer)
+            return false;
+
+        const std::vector<CPU::ThreadStatistics> &threadStats = m_cpuRenderer->getThreadStatistics();
+        *numThreads = (uint32_t)threadStats.size();
+        if (!stats)
+            return true;
+
+        for (uint32_t i = 0; i < std::min(*numThreads, maxNumThreads); ++i) {
+            stats[i].busyTime = threadStats[i].busyTime;
+            stats[i].idleTime = threadStats[i].idleTime;
+            stats[i].numTiles = threadStats[i].numTiles;
+            stats[i].numStolenTiles = threadStats[i].numStolenTiles;
+        }
+
+        return true;
+    }
+
+    // JP: 蓄積状態ファイルのヘッダー。レンダリングモード、蓄積形式や要素の大きさが異なる場合はファイルを共有できない。
+    // EN: Header of an accumulation state file. Files can't be shared between different rendering modes, accumulation formats or element sizes.
+    struct AccumulationFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t renderingMode;
+        uint32_t accumulationFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t numAccumFrames;
+        uint32_t spectrumStorageSize;
+        uint32_t rngStateSize;
+        uint32_t pixelStatisticsSize;
+        // JP: 蓄積に含まれるサンプル番号の範囲[sampleOffset, sampleOffset + sampleCount)。
+        //     マージで不連続になった場合はそれらを包む範囲を記録する。
+        // EN: Range of sample indices [sampleOffset, sampleOffset + sampleCount) contained in the accumulation.
+        //     Record the range enclosing them if they have become discontiguous by merging.
+        uint64_t sampleOffset;
+        uint64_t sampleCount;
+    };
+
+    static const char AccumulationFileMagic[4] = { 'V', 'L', 'R', 'A' };
+    static const uint32_t AccumulationFileVersion = 5;
+
+    static uint32_t getAccumulationStorageSize(VLRRenderingMode renderingMode, VLRAccumulationFormat format) {
+        return format == VLRAccumulationFormat_CompactXYZ ? sizeof(Shared::CompactXYZStorage) : getSpectrumStorageSize(renderingMode);
+    }
+
+    static bool readAccumulationFileHeader(std::ifstream &ifs, VLRRenderingMode renderingMode, VLRAccumulationFormat format, uint32_t width, uint32_t height,
+                                           AccumulationFileHeader* header) {
+        ifs.read((char*)header, sizeof(*header));
+        return !ifs.fail() &&
+            std::equal(AccumulationFileMagic, AccumulationFileMagic + 4, header->magic) &&
+            header->version == AccumulationFileVersion &&
+            header->renderingMode == renderingMode &&
+            header->accumulationFormat == format &&
+            header->width == width && header->height == height &&
+            header->spectrumStorageSize == getAccumulationStorageSize(renderingMode, format) &&
+            header->rngStateSize == sizeof(uint64_t) &&
+            header->pixelStatisticsSize == sizeof(Shared::PixelStatistics);
+    }
+
+    static bool writeBuffer(std::ofstream &ofs, const Backend::Buffer &buffer, size_t size) {
+        auto data = (const char*)buffer->map(0, RT_BUFFER_MAP_READ);
+        ofs.write(data, size);
+        buffer->unmap();
+        return !ofs.fail();
+    }
+
+    static bool readValues(std::ifstream &ifs, size_t size, std::vector<uint8_t>* values) {
+        values->resize(size);
+        ifs.read((char*)values->data(), size);
+        return !ifs.fail();
+    }
+
+    static void copyToBuffer(const Backend::Buffer &buffer, const std::vector<uint8_t> &values) {
+        auto data = (uint8_t*)buffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
+        std::copy(values.cbegin(), values.cend(), data);
+        buffer->unmap();
+    }
+
+    template <typename ValueType>
+    static void mergeBuffer(const Backend::Buffer &buffer, const ValueType* values, size_t numValues) {
+        auto dstValues = (ValueType*)buffer->map(0, RT_BUFFER_MAP_READ_WRITE);
+        for (size_t i = 0; i < numValues; ++i)
+            dstValues[i].merge(values[i]);
+        buffer->unmap();
+    }
+
+    bool Context::saveAccumulation(const std::string &filepath) {
+        if (!m_rawOutputBuffer)
+            return false;
+
+        // JP: 一時ファイルに書き終えてから置き換えて、書き込みに失敗しても前回のファイルを残す。
+        // EN: Replace after finishing writing to a temporary file, leaving the previous file when writing fails.
+        std::string tmpFilepath = filepath + ".tmp";
+        std::ofstream ofs(tmpFilepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (ofs.fail())
+            return false;
+
+        AccumulationFileHeader header;
+        std::copy_n(AccumulationFileMagic, 4, header.magic);
+        header.version = AccumulationFileVersion;
+        header.renderingMode = m_renderingMode;
+        header.accumulationFormat = m_accumulationFormat;
+        header.width = m_width;
+        header.height = m_height;
+        header.numAccumFrames = m_numAccumFrames;
+        header.spectrumStorageSize = getAccumulationStorageSize(m_renderingMode, m_accumulationFormat);
+        header.rngStateSize = sizeof(uint64_t);
+        header.pixelStatisticsSize = sizeof(Shared::PixelStatistics);
+        header.sampleOffset = m_sampleRanges.empty() ? m_nextSampleIndex : m_sampleRanges.front().begin;
+        header.sampleCount = m_sampleRanges.empty() ? 0 : m_sampleRanges.back().end - header.sampleOffset;
+        ofs.write((const char*)&header, sizeof(header));
+
+        // JP: 蓄積値は蓄積形式のまま、CompensatedSumの補償項も含めて書き出す。
+        // EN: Write accumulated values as is in the accumulation format including the compensation terms of CompensatedSum.
+        size_t numPixels = (size_t)m_width * m_height;
+        bool success =
+            writeBuffer(ofs, getAccumulationBuffer(), numPixels * header.spectrumStorageSize) &&
+            writeBuffer(ofs, m_rngBuffer, numPixels * header.rngStateSize) &&
+            writeBuffer(ofs, m_pixelStatisticsBuffer, numPixels * header.pixelStatisticsSize);
+        ofs.flush();
+        success &= !ofs.fail();
+        ofs.close();
+        success &= !ofs.fail();
+
+        if (!success || !replaceFile(tmpFilepath, filepath)) {
+            std::remove(tmpFilepath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Context::loadAccumulation(const std::string &filepath) {
+        if (!m_rawOutputBuffer)
+            return false;
+
+        std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
+        if (ifs.fail())
+            return false;
+
+        AccumulationFileHeader header;
+        if (!readAccumulationFileHeader(ifs, m_renderingMode, m_accumulationFormat, m_width, m_height, &header))
+            return false;
+
+        // JP: ファイル全体を読んで確かめてからバッファーに書き込み、壊れたファイルで現在の蓄積を失わないようにする。
+        // EN: Write to the buffers after reading and checking the whole file so that a broken file doesn't lose the current accumulation.
+        size_t numPixels = (size_t)m_width * m_height;
+        std::vector<uint8_t> values;
+        std::vector<uint8_t> rngStates;
+        std::vector<uint8_t> pixelStats;
+        if (!readValues(ifs, numPixels * header.spectrumStorageSize, &values) ||
+            !readValues(ifs, numPixels * header.rngStateSize, &rngStates) ||
+            !readValues(ifs, numPixels * header.pixelStatisticsSize, &pixelStats) ||
+            ifs.peek() != std::ifstream::traits_type::eof())
+            return false;
+
+        copyToBuffer(getAccumulationBuffer(), values);
+        copyToBuffer(m_rngBuffer, rngStates);
+        copyToBuffer(m_pixelStatisticsBuffer, pixelStats);
+
+        m_numAccumFrames = header.numAccumFrames;
+        m_sampleRanges.clear();
+        if (header.sampleCount > 0)
+            m_sampleRanges.push_back(SampleRange{ header.sampleOffset, header.sampleOffset + header.sampleCount });
+        m_nextSampleIndex = header.sampleOffset + header.sampleCount;
+        m_resumeAccumulation = true;
+
+        return true;
+    }
+
+    bool Context::mergeAccumulation(const std::string &filepath) {
+        if (!m_rawOutputBuffer)
+            return false;
+
+        std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
+        if (ifs.fail())
+            return false;
+
+        AccumulationFileHeader header;
+        if (!readAccumulationFileHeader(ifs, m_renderingMode, m_accumulationFormat, m_width, m_height, &header))
+            return false;
+
+        // JP: 同じファイルの二重のマージや、サンプル番号の範囲が現在の蓄積と重なるファイルは拒否する。
+        // EN: Reject merging the same file twice or a file whose range of sample indices overlaps with the current accumulation.
+        SampleRange range{ header.sampleOffset, header.sampleOffset + header.sampleCount };
+        if (range.end < range.begin)
+            return false;
+        auto itRange = std::lower_bound(m_sampleRanges.cbegin(), m_sampleRanges.cend(), range,
+                                        [](const SampleRange &a, const SampleRange &b) { return a.end <= b.begin; });
+        if (header.sampleCount > 0 && itRange != m_sampleRanges.cend() && itRange->begin < range.end)
+            return false;
+
+        // JP: 乱数の状態は読み飛ばし、現在のものを使い続ける。
+        // EN: Skip the random number states, and keep using the current ones.
+        size_t numPixels = (size_t)m_width * m_height;
+        bool compact = m_accumulationFormat == VLRAccumulationFormat_CompactXYZ;
+        // JP: 蓄積値の型はレンダリングモードと蓄積形式で決まるので、読み込みはバイト列として行う。
+        // EN: The type of accumulated values is determined by the rendering mode and the accumulation format, so read them as bytes.
+        std::vector<uint8_t> values(numPixels * header.spectrumStorageSize);
+        std::vector<Shared::PixelStatistics> pixelStats(numPixels);
+        ifs.read((char*)values.data(), values.size());
+        ifs.seekg(numPixels * header.rngStateSize, std::ios::cur);
+        ifs.read((char*)pixelStats.data(), numPixels * header.pixelStatisticsSize);
+        if (ifs.fail() || ifs.peek() != std::ifstream::traits_type::eof())
+            return false;
+
+        // JP: 蓄積値と画素ごとのサンプル数をそれぞれ足し合わせる。RGBへの変換は合計のサンプル数で割るので、
+        //     各ファイルの寄与はそのサンプル数で重み付けされる。
+        // EN: Sum the accumulated values and the numbers of samples per pixel respectively. Conversion to RGB divides by the total number of samples,
+        //     so the contribution of each file is weighted by its number of samples.
+        if (compact)
+            mergeBuffer(m_compactOutputBuffer, (const Shared::CompactXYZStorage*)values.data(), numPixels);
+        else if (m_renderingMode == VLRRenderingMode_Spectral)
+            mergeBuffer(m_rawOutputBuffer, (const SpectralRenderingTypes::SpectrumStorage*)values.data(), numPixels);
+        else
+            mergeBuffer(m_rawOutputBuffer, (const RGBRenderingTypes::SpectrumStorage*)values.data(), numPixels);
+        mergeBuffer(m_pixelStatisticsBuffer, pixelStats.data(), numPixels);
+
+        m_numAccumFrames += header.numAccumFrames;
+        if (header.sampleCount > 0)
+            m_sampleRanges.insert(itRange, range);
+        // JP: 蓄積を続ける場合にマージしたサンプルを再び生成しないよう、次のサンプル番号を範囲の後ろに進める。
+        // EN: Advance the next sample index past the range so that continuing the accumulation doesn't generate the merged samples again.
+        m_nextSampleIndex = std::max(m_nextSampleIndex, range.end);
+        m_resumeAccumulation = true;
+
+        resolveAccumulation();
+
+        return true;
+    }
+
+    void Context::setSampleIndexOffset(uint32_t offset) {
+        m_sampleIndexOffset = offset;
+        if (m_rngBuffer)
+            initializeRNGStates();
+        if (m_sampleRanges.empty())
+            m_nextSampleIndex = offset;
+    }
+
+    bool Context::setAccumulationFormat(VLRAccumulationFormat format) {
+        if (format != VLRAccumulationFormat_Compensated && format != VLRAccumulationFormat_CompactXYZ)
+            return false;
+
+        m_accumulationFormat = format;
+        m_optixContext["VLR::pv_accumulationFormat"]->setUserData(sizeof(m_accumulationFormat), &m_accumulationFormat);
+        if (m_rawOutputBuffer) {
+            allocateAccumulationBuffers();
+            m_numAccumFrames = 0;
+            m_sampleRanges.clear();
+            m_resumeAccumulation = false;
+        }
+
+        return true;
+    }
+
+    void Context::resolveAccumulation() {
+        optix::uint2 imageSize = optix::make_uint2(m_width, m_height);
+        m_optixContext["VLR::pv_imageSize"]->setUint(imageSize);
+
+        if (m_backend == VLRBackend_CPU)
+            m_cpuRenderer->resolve(imageSize);
+        else
+            m_optixContext->launch(EntryPoint::ConvertToRGB, imageSize.x, imageSize.y);
+    }
+
+    bool Context::resolve(const VLRResolveParameters &params, void* dst) {
+        if (!m_rawOutputBuffer)
+            return false;
+
+        ResolveSource src;
+        src.renderingMode = m_renderingMode;
+        src.accumulationFormat = m_accumulationFormat;
+        src.values = getAccumulationBuffer()->map(0, RT_BUFFER_MAP_READ);
+        src.pixelStats = (const Shared::PixelStatistics*)m_pixelStatisticsBuffer->map(0, RT_BUFFER_MAP_READ);
+        src.width = m_width;
+        src.height = m_height;
+
+        resolveOnHost(src, params, dst);
+
+        m_pixelStatisticsBuffer->unmap();
+        getAccumulationBuffer()->unmap();
+
+        return true;
+    }
+
+    AccumulationSnapshot* Context::createAccumulationSnapshot() {
+        if (!m_rawOutputBuffer)
+            return nullptr;
+
+        // JP: 写し取る前にサンプル数で割ったXYZにまとめ、蓄積形式のまま全体を複製しない。
+        // EN: Reduce to XYZ divided by the number of samples before copying instead of duplicating the whole buffer in the accumulation format.
+        ResolveSource src;
+        src.renderingMode = m_renderingMode;
+        src.accumulationFormat = m_accumulationFormat;
+        src.values = getAccumulationBuffer()->map(0, RT_BUFFER_MAP_READ);
+        src.pixelStats = (const Shared::PixelStatistics*)m_pixelStatisticsBuffer->map(0, RT_BUFFER_MAP_READ);
+        src.width = m_width;
+        src.height = m_height;
+
+        AccumulationSnapshot* ret = new AccumulationSnapshot(src);
+
+        m_pixelStatisticsBuffer->unmap();
+        getAccumulationBuffer()->unmap();
+
+        return ret;
+    }
+
+    void Context::setAdaptiveSampling(float pixelErrorThreshold, uint32_t minNumSamples, float targetError) {
+        m_adaptiveSampling.pixelErrorThreshold = pixelErrorThreshold;
+        m_adaptiveSampling.minNumSamples = std::max<uint32_t>(minNumSamples, 2);
+        m_targetError = targetError;
+        m_converged = false;
+        m_optixContext["VLR::pv_adaptiveSampling"]->setUserData(sizeof(m_adaptiveSampling), &m_adaptiveSampling);
+    }
+
+    // JP: 画像全体の誤差を評価するフレーム間隔。
+    // EN: Frame interval to evaluate the error of the whole image.
+    static const uint32_t RenderingErrorEvaluationInterval = 16;
+    // JP: 画素ごとの相対誤差の上限。有限なサンプルが2つ未満の画素は誤差が無限大になるので、
+    //     この値で頭打ちにして、少数の画素で平均が無限大に張り付かないようにする。
+    // EN: Upper limit of the relative error per pixel. The error of a pixel with fewer than 2 finite samples is infinite,
+    //     so clamp it to this value to keep a few pixels from pinning the average to infinity.
+    static const float MaxPixelRelativeError = 1.0f;
+
+    // JP: 画素ごとの相対誤差(上限で頭打ち)の平均。
+    // EN: Average of the relative errors per pixel clamped to the upper limit.
+    float Context::calcRenderingError(const optix::uint2 &imageSize) {
+        auto pixelStats = (const Shared::PixelStatistics*)m_pixelStatisticsBuffer->map(0, RT_BUFFER_MAP_READ);
+        double sumErrors = 0.0;
+        for (uint32_t y = 0; y < imageSize.y; ++y) {
+            for (uint32_t x = 0; x < imageSize.x; ++x)
+                sumErrors += std::fmin(pixelStats[y * m_width + x].calcRelativeError(), MaxPixelRelativeError);
+        }
+        m_pixelStatisticsBuffer->unmap();
+
+        return (float)(sumErrors / (imageSize.x * imageSize.y));
+    }
+
+    void Context::render(Scene &scene, Camera* camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames, bool* converged) {
+        Backend::Context optixContext = getOptiXContext();
 
         optix::uint2 imageSize = optix::make_uint2(m_width / shrinkCoeff, m_height / shrinkCoeff);
         if (firstFrame) {
@@ -522,7 +1025,13 @@ namespace VLR {
 
             optixContext["VLR::pv_imageSize"]->setUint(imageSize);
 
-            m_numAccumFrames = 0;
+            m_converged = false;
+            if (!m_resumeAccumulation) {
+                m_numAccumFrames = 0;
+                m_sampleRanges.clear();
+                m_nextSampleIndex = m_sampleIndexOffset;
+            }
+            m_resumeAccumulation = false;
         }
 
         ++m_numAccumFrames;
@@ -530,19 +1039,40 @@ namespace VLR {
         //optixContext["VLR::pv_numAccumFrames"]->setUint(m_numAccumFrames);
         optixContext["VLR::pv_numAccumFrames"]->setUserData(sizeof(m_numAccumFrames), &m_numAccumFrames);
 
+        // JP: 各フレームはサンプル番号を1つ消費し、乱数列はサンプル番号と画素(CPUではタイル)から決まる。
+        // EN: Each frame consumes a sample index, and random number sequences are determined by the sample index and the pixel (the tile on the CPU).
+        uint64_t sampleIndex = m_nextSampleIndex++;
+        if (!m_sampleRanges.empty() && m_sampleRanges.back().end == sampleIndex)
+            ++m_sampleRanges.back().end;
+        else
+            m_sampleRanges.push_back(SampleRange{ sampleIndex, sampleIndex + 1 });
+        optixContext["VLR::pv_sampleIndex"]->setUserData(sizeof(sampleIndex), &sampleIndex);
+
+        if (m_backend == VLRBackend_CPU) {
+            m_cpuRenderer->setFrameIndex(sampleIndex);
+            m_cpuRenderer->render(scene, imageSize, m_numAccumFrames, firstFrame);
+        }
+        else {
 #if defined(VLR_ENABLE_TIMEOUT_CALLBACK)
-        optixContext->setTimeoutCallback([]() { return 1; }, 0.1);
+            optixContext->setTimeoutCallback([]() { return 1; }, 0.1);
 #endif
 
 #if defined(VLR_ENABLE_VALIDATION)
-        optixContext->validate();
+            optixContext->validate();
 #endif
 
-        optixContext->launch(EntryPoint::PathTracing, imageSize.x, imageSize.y);
-        //Shared::SurfacePointAttribute attr = Shared::SurfacePointAttribute::ShadingFrameOrthogonality;
-        //optixContext["VLR::pv_surfacePointAttribute"]->setUserData(sizeof(attr), &attr);
-        //optixContext->launch(EntryPoint::DebugRendering, imageSize.x, imageSize.y);
-        optixContext->launch(EntryPoint::ConvertToRGB, imageSize.x, imageSize.y);
+            optixContext->launch(EntryPoint::PathTracing, imageSize.x, imageSize.y);
+            //Shared::SurfacePointAttribute attr = Shared::SurfacePointAttribute::ShadingFrameOrthogonality;
+            //optixContext["VLR::pv_surfacePointAttribute"]->setUserData(sizeof(attr), &attr);
+            //optixContext->launch(EntryPoint::DebugRendering, imageSize.x, imageSize.y);
+            optixContext->launch(EntryPoint::ConvertToRGB, imageSize.x, imageSize.y);
+        }
+
+        if (converged) {
+            if (m_targetError > 0.0f && m_numAccumFrames % RenderingErrorEvaluationInterval == 0)
+                m_converged = calcRenderingError(imageSize) <= m_targetError;
+            *converged = m_targetError > 0.0f && m_converged;
+        }
     }
 
 
@@ -598,10 +1128,11 @@ namespace VLR {
         m_spectrumNodeDescSlotManager.setNotInUse(index);
     }
 
-    void Context::updateSpectrumNodeDescriptor(uint32_t index, const Shared::SpectrumNodeDescriptor &nodeDesc) {
+    void Context::updateSpectrumNodeDescriptor(uint32_t index, const Shared::HostSpectrumNodeDescriptor &nodeDesc) {
         VLRAssert(m_spectrumNodeDescSlotManager.getUsage(index), "Invalid index.");
-        auto nodeDescs = (Shared::SpectrumNodeDescriptor*)m_optixSpectrumNodeDescriptorBuffer->map(0, RT_BUFFER_MAP_WRITE);
-        nodeDescs[index] = nodeDesc;
+        size_t nodeDescSize = getSpectrumNodeDescriptorSize(m_renderingMode);
+        auto nodeDescs = (uint8_t*)m_optixSpectrumNodeDescriptorBuffer->map(0, RT_BUFFER_MAP_WRITE);
+        std::memcpy(nodeDescs + nodeDescSize * index, &nodeDesc, nodeDescSize);
         m_optixSpectrumNodeDescriptorBuffer->unmap();
     }
 
@@ -671,10 +1202,10 @@ namespace VLR {
     // Miscellaneous
 
     template <typename RealType>
-    static optix::Buffer createBuffer(optix::Context &context, RTbuffertype type, RTsize width);
+    static Backend::Buffer createBuffer(Backend::Context &context, RTbuffertype type, RTsize width);
 
     template <>
-    static optix::Buffer createBuffer<float>(optix::Context &context, RTbuffertype type, RTsize width) {
+    static Backend::Buffer createBuffer<float>(Backend::Context &context, RTbuffertype type, RTsize width) {
         return context->createBuffer(type, RT_FORMAT_FLOAT, width);
     }
 
@@ -682,7 +1213,7 @@ namespace VLR {
 
     template <typename RealType>
     void DiscreteDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues) {
-        optix::Context optixContext = context.getOptiXContext();
+        Backend::Context optixContext = context.getOptiXContext();
 
         m_numValues = (uint32_t)numValues;
         m_PMF = createBuffer<RealType>(optixContext, RT_BUFFER_INPUT, m_numValues);
@@ -728,7 +1259,7 @@ namespace VLR {
 
     template <typename RealType>
     void RegularConstantContinuousDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues) {
-        optix::Context optixContext = context.getOptiXContext();
+        Backend::Context optixContext = context.getOptiXContext();
 
         m_numValues = (uint32_t)numValues;
         m_PDF = createBuffer<RealType>(optixContext, RT_BUFFER_INPUT, m_numValues);
@@ -773,7 +1304,7 @@ namespace VLR {
 
     template <typename RealType>
     void RegularConstantContinuousDistribution2DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numD1, size_t numD2) {
-        optix::Context optixContext = context.getOptiXContext();
+        Backend::Context optixContext = context.getOptiXContext();
 
         m_1DDists = new RegularConstantContinuousDistribution1DTemplate<RealType>[numD2];
         m_raw1DDists = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, numD2);
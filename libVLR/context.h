@@ -3,7 +3,10 @@
 #include <public_types.h>
 #include "shared/shared.h"
 
+#include "backend.h"
 #include "slot_manager.h"
+#include "image_cache.h"
+#include "tile_cache.h"
 
 #if defined(DEBUG)
 #   define VLR_PTX_DIR "resources/ptxes/Debug/"
@@ -18,6 +21,11 @@ namespace VLR {
 
     class Scene;
     class Camera;
+    class AccumulationSnapshot;
+
+    namespace CPU {
+        class Renderer;
+    }
 
     class Context {
         static uint32_t NextID;
@@ -26,84 +34,131 @@ namespace VLR {
         }
 
         uint32_t m_ID;
-        optix::Context m_optixContext;
+        VLRBackend m_backend;
+        VLRRenderingMode m_renderingMode;
+        Backend::Context m_optixContext;
         bool m_RTXEnabled;
 
-        optix::Program m_optixProgramShadowAnyHitDefault; // ---- Any Hit Program
-        optix::Program m_optixProgramAnyHitWithAlpha; // -------- Any Hit Program
-        optix::Program m_optixProgramShadowAnyHitWithAlpha; // -- Any Hit Program
-        optix::Program m_optixProgramPathTracingIteration; // --- Closest Hit Program
+        // JP: CPUバックエンドのシーンやリソースはoptixppのラッパーを通してホストメモリ上のエミュレーションのオブジェクトに保持する。
+        // EN: The scene and resources of the CPU backend are held in emulated objects in the host memory through the optixpp wrappers.
+        CPU::Renderer* m_cpuRenderer;
+
+        Backend::Program m_optixProgramShadowAnyHitDefault; // ---- Any Hit Program
+        Backend::Program m_optixProgramAnyHitWithAlpha; // -------- Any Hit Program
+        Backend::Program m_optixProgramShadowAnyHitWithAlpha; // -- Any Hit Program
+        Backend::Program m_optixProgramPathTracingIteration; // --- Closest Hit Program
 
-        optix::Program m_optixProgramPathTracing; // ------------ Ray Generation Program
-        optix::Program m_optixProgramPathTracingMiss; // -------- Miss Program
-        optix::Program m_optixProgramException; // -------------- Exception Program
+        Backend::Program m_optixProgramPathTracing; // ------------ Ray Generation Program
+        Backend::Program m_optixProgramPathTracingMiss; // -------- Miss Program
+        Backend::Program m_optixProgramException; // -------------- Exception Program
 
-        optix::Program m_optixProgramDebugRenderingClosestHit;
-        optix::Program m_optixProgramDebugRenderingMiss;
-        optix::Program m_optixProgramDebugRenderingRayGeneration;
-        optix::Program m_optixProgramDebugRenderingException;
+        Backend::Program m_optixProgramDebugRenderingClosestHit;
+        Backend::Program m_optixProgramDebugRenderingMiss;
+        Backend::Program m_optixProgramDebugRenderingRayGeneration;
+        Backend::Program m_optixProgramDebugRenderingException;
 
-        optix::Program m_optixProgramConvertToRGB; // ----------- Ray Generation Program (TODO: port to pure CUDA code)
+        Backend::Program m_optixProgramConvertToRGB; // ----------- Ray Generation Program (TODO: port to pure CUDA code)
 
-        optix::Buffer m_optixBufferUpsampledSpectrum_spectrum_grid;
-        optix::Buffer m_optixBufferUpsampledSpectrum_spectrum_data_points;
+        Backend::Buffer m_optixBufferUpsampledSpectrum_spectrum_grid;
+        Backend::Buffer m_optixBufferUpsampledSpectrum_spectrum_data_points;
+        Backend::Buffer m_optixBufferUpsampledSpectrum_spectrum_triangles;
+        Backend::Buffer m_optixBufferUpsampledSpectrum_adjacency_table;
 
-        optix::Material m_optixMaterialDefault;
-        optix::Material m_optixMaterialWithAlpha;
+        Backend::Material m_optixMaterialDefault;
+        Backend::Material m_optixMaterialWithAlpha;
 
-        optix::Buffer m_optixNodeProcedureSetBuffer;
+        Backend::Buffer m_optixNodeProcedureSetBuffer;
         uint32_t m_maxNumNodeProcSet;
         SlotManager m_nodeProcSetSlotManager;
 
-        optix::Buffer m_optixNodeDescriptorBuffer;
+        Backend::Buffer m_optixNodeDescriptorBuffer;
         uint32_t m_maxNumNodeDescriptors;
         SlotManager m_nodeDescSlotManager;
 
-        optix::Buffer m_optixSpectrumNodeDescriptorBuffer;
+        Backend::Buffer m_optixSpectrumNodeDescriptorBuffer;
         uint32_t m_maxNumSpectrumNodeDescriptors;
         SlotManager m_spectrumNodeDescSlotManager;
 
-        optix::Buffer m_optixBSDFProcedureSetBuffer;
+        Backend::Buffer m_optixBSDFProcedureSetBuffer;
         uint32_t m_maxNumBSDFProcSet;
         SlotManager m_bsdfProcSetSlotManager;
 
-        optix::Buffer m_optixEDFProcedureSetBuffer;
+        Backend::Buffer m_optixEDFProcedureSetBuffer;
         uint32_t m_maxNumEDFProcSet;
         SlotManager m_edfProcSetSlotManager;
 
-        optix::Program m_optixCallableProgramNullBSDF_setupBSDF;
-        optix::Program m_optixCallableProgramNullBSDF_getBaseColor;
-        optix::Program m_optixCallableProgramNullBSDF_matches;
-        optix::Program m_optixCallableProgramNullBSDF_sampleInternal;
-        optix::Program m_optixCallableProgramNullBSDF_evaluateInternal;
-        optix::Program m_optixCallableProgramNullBSDF_evaluatePDFInternal;
-        optix::Program m_optixCallableProgramNullBSDF_weightInternal;
+        Backend::Program m_optixCallableProgramNullBSDF_setupBSDF;
+        Backend::Program m_optixCallableProgramNullBSDF_getBaseColor;
+        Backend::Program m_optixCallableProgramNullBSDF_matches;
+        Backend::Program m_optixCallableProgramNullBSDF_sampleInternal;
+        Backend::Program m_optixCallableProgramNullBSDF_evaluateInternal;
+        Backend::Program m_optixCallableProgramNullBSDF_evaluatePDFInternal;
+        Backend::Program m_optixCallableProgramNullBSDF_weightInternal;
         uint32_t m_nullBSDFProcedureSetIndex;
 
-        optix::Program m_optixCallableProgramNullEDF_setupEDF;
-        optix::Program m_optixCallableProgramNullEDF_evaluateEmittanceInternal;
-        optix::Program m_optixCallableProgramNullEDF_evaluateInternal;
+        Backend::Program m_optixCallableProgramNullEDF_setupEDF;
+        Backend::Program m_optixCallableProgramNullEDF_evaluateEmittanceInternal;
+        Backend::Program m_optixCallableProgramNullEDF_evaluateInternal;
         uint32_t m_nullEDFProcedureSetIndex;
 
-        optix::Buffer m_optixSurfaceMaterialDescriptorBuffer;
+        Backend::Buffer m_optixSurfaceMaterialDescriptorBuffer;
         uint32_t m_maxNumSurfaceMaterialDescriptors;
         SlotManager m_surfMatDescSlotManager;
 
-        optix::Buffer m_rawOutputBuffer;
-        optix::Buffer m_outputBuffer;
-        optix::Buffer m_rngBuffer;
+        Backend::Buffer m_rawOutputBuffer;
+        Backend::Buffer m_compactOutputBuffer;
+        Backend::Buffer m_outputBuffer;
+        Backend::Buffer m_rngBuffer;
+        Backend::Buffer m_pixelStatisticsBuffer;
         uint32_t m_width;
         uint32_t m_height;
         uint32_t m_numAccumFrames;
+        bool m_resumeAccumulation;
+        uint32_t m_sampleIndexOffset;
+        // JP: 蓄積値に含まれるサンプル番号の範囲と、次のフレームのサンプル番号。
+        //     乱数列はサンプル番号から決まるので、範囲が重なる蓄積を足し合わせると同じサンプルを二重に数えることになる。
+        // EN: Ranges of sample indices contained in the accumulated values, and the sample index of the next frame.
+        //     Random number sequences are determined by sample indices, so merging accumulations with overlapping ranges counts the same samples twice.
+        struct SampleRange {
+            uint64_t begin;
+            uint64_t end;
+        };
+        std::vector<SampleRange> m_sampleRanges;
+        uint64_t m_nextSampleIndex;
+        VLRAccumulationFormat m_accumulationFormat;
+
+        Shared::AdaptiveSamplingParameters m_adaptiveSampling;
+        float m_targetError;
+        bool m_converged;
+
+        ImageCache m_imageCache;
+        TileCache m_tileCache;
+
+        void initializeRNGStates();
+        void allocateAccumulationBuffers();
+        const Backend::Buffer &getAccumulationBuffer() const {
+            return m_accumulationFormat == VLRAccumulationFormat_CompactXYZ ? m_compactOutputBuffer : m_rawOutputBuffer;
+        }
+        void resolveAccumulation();
+        float calcRenderingError(const optix::uint2 &imageSize);
 
     public:
-        Context(bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices);
+        Context(bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices,
+                VLRBackend backend, VLRRenderingMode renderingMode);
         ~Context();
 
         uint32_t getID() const {
             return m_ID;
         }
 
+        VLRBackend getBackend() const {
+            return m_backend;
+        }
+
+        VLRRenderingMode getRenderingMode() const {
+            return m_renderingMode;
+        }
+
         bool RTXEnabled() const {
             return m_RTXEnabled;
         }
@@ -112,17 +167,70 @@ namespace VLR {
         void* mapOutputBuffer();
         void unmapOutputBuffer();
         void getOutputBufferSize(uint32_t* width, uint32_t* height);
+        bool getBVHStatistics(VLRBVHStatistics* stats) const;
+        bool setCPUIntegrator(VLRCPUIntegrator integrator);
+        bool setCPUTileSize(uint32_t width, uint32_t height);
+        // JP: statsがnullptrの場合はスレッド数だけを返す。
+        // EN: Return only the number of threads in the case stats is nullptr.
+        bool getCPUThreadStatistics(VLRCPUThreadStatistics* stats, uint32_t maxNumThreads, uint32_t* numThreads) const;
+
+        // JP: 出力バッファーの蓄積値、乱数の状態、蓄積フレーム数をファイルに保存・復元する。
+        //     復元後、最初のrender()呼び出しはfirstFrameがtrueでもシーンの設定だけを行い、蓄積を継続する。
+        // EN: Save/restore the accumulated values of the output buffer, random number states and the number of accumulated frames to/from a file.
+        //     After restoring, the first call to render() only sets up the scene even if firstFrame is true, and continues the accumulation.
+        bool saveAccumulation(const std::string &filepath);
+        bool loadAccumulation(const std::string &filepath);
+        // JP: 別のプロセスで蓄積したファイルを現在の蓄積値に足し合わせ、出力バッファーを更新する。
+        //     最初のファイルはloadAccumulation()で読み込んでおく。
+        // EN: Add a file accumulated by another process to the current accumulated values, and update the output buffer.
+        //     Load the first file with loadAccumulation() beforehand.
+        bool mergeAccumulation(const std::string &filepath);
+        // JP: 複数のプロセスでサンプルを分担する際に、プロセスごとに異なるオフセットを与えて乱数列を無相関にする。
+        // EN: Give a different offset per process to decorrelate random number sequences when sharing samples among multiple processes.
+        void setSampleIndexOffset(uint32_t offset);
+        // JP: 蓄積形式を変更する。出力バッファーが既にある場合は蓄積バッファーを確保し直すので、蓄積値は失われる。
+        // EN: Change the accumulation format. Accumulation buffers are reallocated if the output buffer already exists, so accumulated values are lost.
+        bool setAccumulationFormat(VLRAccumulationFormat format);
+
+        // JP: targetErrorが0の場合は収束を判定しない。
+        // EN: Convergence is not determined when targetError is 0.
+        void setAdaptiveSampling(float pixelErrorThreshold, uint32_t minNumSamples, float targetError);
+
+        // JP: 蓄積バッファーをホストに読み出し、指定した形式の画像をdstに書き出す。出力バッファーが無い場合はfalseを返す。
+        // EN: Read the accumulation buffers to the host, and write an image of the specified format to dst. Return false if there is no output buffer.
+        bool resolve(const VLRResolveParameters &params, void* dst);
+        // JP: 蓄積バッファーをサンプル数で割ったXYZとしてホストに写し取る。出力バッファーが無い場合はnullptrを返す。
+        // EN: Copy the accumulation buffer to the host as XYZ divided by the number of samples. Return nullptr if there is no output buffer.
+        AccumulationSnapshot* createAccumulationSnapshot();
+
+        // JP: convergedがnullptrでない場合、画像全体の誤差が目標誤差を下回ったかを返す。
+        //     誤差は画素の統計情報の読み出しを伴うので一定のフレーム間隔でのみ評価し、その間は直前の結果を返す。
+        // EN: Return whether the error of the whole image has fallen below the target error if converged is not nullptr.
+        //     The error involves reading back the pixel statistics, so it is evaluated only at a fixed frame interval, returning the last result in between.
+        void render(Scene &scene, Camera* camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames, bool* converged);
+
+        ImageCache &getImageCache() {
+            return m_imageCache;
+        }
+        TileCache &getTileCache() {
+            return m_tileCache;
+        }
 
-        void render(Scene &scene, Camera* camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames);
-
-        const optix::Context &getOptiXContext() const {
+        const Backend::Context &getOptiXContext() const {
             return m_optixContext;
         }
 
-        const optix::Material &getOptiXMaterialDefault() const {
+        // JP: プログラムを生成し、CPUバックエンドの場合は対応するホスト関数を登録する。
+        // EN: create a program and register the corresponding host function in the case of the CPU backend.
+        Backend::Program createProgramFromPTXString(const std::string &ptx, const std::string &programName);
+        // JP: コンテキストのレンダリングモード用にコンパイルされたPTXを読み込む。
+        // EN: read a PTX compiled for the rendering mode of the context.
+        std::string readPTX(const std::string &filename) const;
+
+        const Backend::Material &getOptiXMaterialDefault() const {
             return m_optixMaterialDefault;
         }
-        const optix::Material &getOptiXMaterialWithAlpha() const {
+        const Backend::Material &getOptiXMaterialWithAlpha() const {
             return m_optixMaterialWithAlpha;
         }
 
@@ -136,7 +244,7 @@ namespace VLR {
 
         uint32_t allocateSpectrumNodeDescriptor();
         void releaseSpectrumNodeDescriptor(uint32_t index);
-        void updateSpectrumNodeDescriptor(uint32_t index, const Shared::SpectrumNodeDescriptor &nodeDesc);
+        void updateSpectrumNodeDescriptor(uint32_t index, const Shared::HostSpectrumNodeDescriptor &nodeDesc);
 
         uint32_t allocateBSDFProcedureSet();
         void releaseBSDFProcedureSet(uint32_t index);
@@ -146,11 +254,11 @@ namespace VLR {
         void releaseEDFProcedureSet(uint32_t index);
         void updateEDFProcedureSet(uint32_t index, const Shared::EDFProcedureSet &procSet);
 
-        const optix::Program &getOptixCallableProgramNullBSDF_setupBSDF() const {
+        const Backend::Program &getOptixCallableProgramNullBSDF_setupBSDF() const {
             return m_optixCallableProgramNullBSDF_setupBSDF;
         }
         uint32_t getNullBSDFProcedureSetIndex() const { return m_nullBSDFProcedureSetIndex; }
-        const optix::Program &getOptixCallableProgramNullEDF_setupEDF() const {
+        const Backend::Program &getOptixCallableProgramNullEDF_setupEDF() const {
             return m_optixCallableProgramNullEDF_setupEDF;
         }
         uint32_t getNullEDFProcedureSetIndex() const { return m_nullEDFProcedureSetIndex; }
@@ -224,8 +332,8 @@ namespace VLR {
 
     template <typename RealType>
     class DiscreteDistribution1DTemplate {
-        optix::Buffer m_PMF;
-        optix::Buffer m_CDF;
+        Backend::Buffer m_PMF;
+        Backend::Buffer m_CDF;
         RealType m_integral;
         uint32_t m_numValues;
 
@@ -242,8 +350,8 @@ namespace VLR {
 
     template <typename RealType>
     class RegularConstantContinuousDistribution1DTemplate {
-        optix::Buffer m_PDF;
-        optix::Buffer m_CDF;
+        Backend::Buffer m_PDF;
+        Backend::Buffer m_CDF;
         RealType m_integral;
         uint32_t m_numValues;
 
@@ -263,7 +371,7 @@ namespace VLR {
 
     template <typename RealType>
     class RegularConstantContinuousDistribution2DTemplate {
-        optix::Buffer m_raw1DDists;
+        Backend::Buffer m_raw1DDists;
         RegularConstantContinuousDistribution1DTemplate<RealType>* m_1DDists;
         RegularConstantContinuousDistribution1DTemplate<RealType> m_top1DDist;
 
@@ -0,0 +1,332 @@
+﻿#include "cpu_bvh.h"
+
+#include <thread>
+#include <atomic>
+#include <array>
+
+namespace VLR {
+    namespace CPU {
+        struct BVH::BuildNode {
+            BoundingBox3D bbox;
+            std::unique_ptr<BuildNode> children[2];
+            uint32_t start;
+            uint32_t end;
+            uint8_t axis;
+
+            bool isLeaf() const {
+                return !children[0];
+            }
+        };
+
+        struct BVH::BuildContext {
+            const std::vector<BoundingBox3D> &primBBoxes;
+            std::vector<Point3D> primCentroids;
+            std::vector<uint32_t> &primIndices;
+            // JP: 部分木の構築に追加で使えるスレッド数。
+            // EN: The number of additional threads available to build subtrees.
+            std::atomic<int32_t> numAvailableThreads;
+            uint32_t numThreads;
+
+            BuildContext(const std::vector<BoundingBox3D> &_primBBoxes, std::vector<uint32_t> &_primIndices, uint32_t _numThreads) :
+                primBBoxes(_primBBoxes), primIndices(_primIndices), numAvailableThreads(_numThreads - 1), numThreads(_numThreads) {}
+        };
+
+
+
+        // JP: 部分木を別スレッドで構築する、あるいはビン分割を複数スレッドで行う最小のプリミティブ数。
+        // EN: The minimum number of primitives to build a subtree on another thread or to bin with multiple threads.
+        static const uint32_t MinNumPrimitivesForParallelBuild = 4096;
+        static const uint32_t MinNumPrimitivesForParallelBinning = 65536;
+        // JP: トラバーサルのスタックが溢れないよう、これより深いノードでは中央値で分割する。
+        // EN: Split at the median at nodes deeper than this to avoid overflowing the traversal stack.
+        static const uint32_t MaxSAHDepth = 32;
+
+        struct Bin {
+            BoundingBox3D bbox;
+            uint32_t numPrimitives;
+
+            Bin() : numPrimitives(0) {}
+        };
+
+        static void binPrimitives(const std::vector<BoundingBox3D> &primBBoxes, const std::vector<Point3D> &primCentroids,
+                                  const std::vector<uint32_t> &primIndices, uint32_t start, uint32_t end,
+                                  const BoundingBox3D &centroidBBox, const float binScales[3],
+                                  Bin bins[3][BVH::NumBins]) {
+            for (uint32_t i = start; i < end; ++i) {
+                uint32_t primIdx = primIndices[i];
+                const BoundingBox3D &primBBox = primBBoxes[primIdx];
+                const Point3D &centroid = primCentroids[primIdx];
+                for (int dim = 0; dim < 3; ++dim) {
+                    uint32_t binIdx = std::min<uint32_t>((uint32_t)((centroid[dim] - centroidBBox.minP[dim]) * binScales[dim]), BVH::NumBins - 1);
+                    Bin &bin = bins[dim][binIdx];
+                    bin.bbox.unify(primBBox);
+                    ++bin.numPrimitives;
+                }
+            }
+        }
+
+        BVH::BuildNode* BVH::buildRecursive(BuildContext &context, uint32_t start, uint32_t end, uint32_t depth) {
+            BuildNode* node = new BuildNode();
+            node->start = start;
+            node->end = end;
+            node->axis = 0;
+
+            BoundingBox3D centroidBBox;
+            for (uint32_t i = start; i < end; ++i) {
+                uint32_t primIdx = context.primIndices[i];
+                node->bbox.unify(context.primBBoxes[primIdx]);
+                centroidBBox.unify(context.primCentroids[primIdx]);
+            }
+
+            uint32_t numPrimitives = end - start;
+            if (numPrimitives == 1)
+                return node;
+
+            uint32_t mid;
+            BoundingBox3D::Axis axis = centroidBBox.widestAxis();
+            if (centroidBBox.width(axis) <= 0.0f) {
+                // JP: 重心がすべて一致する場合は分割しようがないので、
+                //     最大数を超えるときのみプリミティブ数で半分に分ける。
+                // EN: There is no way to split when all centroids coincide,
+                //     so split in half by the number of primitives only when exceeding the maximum.
+                if (numPrimitives <= MaxNumPrimitivesInLeaf)
+                    return node;
+                mid = (start + end) / 2;
+            }
+            else {
+                float binScales[3];
+                for (int dim = 0; dim < 3; ++dim) {
+                    float width = centroidBBox.width((BoundingBox3D::Axis)dim);
+                    binScales[dim] = width > 0.0f ? NumBins / width : 0.0f;
+                }
+
+                Bin bins[3][NumBins];
+                uint32_t numBinningThreads = std::min(context.numThreads, numPrimitives / MinNumPrimitivesForParallelBinning);
+                if (numBinningThreads > 1) {
+                    std::vector<std::array<std::array<Bin, NumBins>, 3>> localBins(numBinningThreads);
+                    std::vector<std::thread> threads;
+                    for (uint32_t t = 0; t < numBinningThreads; ++t) {
+                        uint32_t chunkStart = start + (uint64_t)numPrimitives * t / numBinningThreads;
+                        uint32_t chunkEnd = start + (uint64_t)numPrimitives * (t + 1) / numBinningThreads;
+                        threads.emplace_back([&context, &centroidBBox, &binScales, &localBins, t, chunkStart, chunkEnd]() {
+                            Bin threadBins[3][NumBins];
+                            binPrimitives(context.primBBoxes, context.primCentroids, context.primIndices, chunkStart, chunkEnd,
+                                          centroidBBox, binScales, threadBins);
+                            for (int dim = 0; dim < 3; ++dim)
+                                std::copy_n(threadBins[dim], NumBins, localBins[t][dim].begin());
+                        });
+                    }
+                    for (auto &thread : threads)
+                        thread.join();
+
+                    for (uint32_t t = 0; t < numBinningThreads; ++t) {
+                        for (int dim = 0; dim < 3; ++dim) {
+                            for (uint32_t b = 0; b < NumBins; ++b) {
+                                const Bin &src = localBins[t][dim][b];
+                                bins[dim][b].bbox.unify(src.bbox);
+                                bins[dim][b].numPrimitives += src.numPrimitives;
+                            }
+                        }
+                    }
+                }
+                else {
+                    binPrimitives(context.primBBoxes, context.primCentroids, context.primIndices, start, end,
+                                  centroidBBox, binScales, bins);
+                }
+
+                // JP: 各軸のビン境界について左右から掃引してSAHコストを評価する。
+                // EN: Sweep from both sides to evaluate the SAH cost at each bin boundary of each axis.
+                float bestCost = INFINITY;
+                int32_t bestDim = -1;
+                uint32_t bestSplit = 0;
+                for (int dim = 0; dim < 3; ++dim) {
+                    if (binScales[dim] == 0.0f)
+                        continue;
+
+                    float rightAreas[NumBins];
+                    uint32_t rightCounts[NumBins];
+                    BoundingBox3D rightBBox;
+                    uint32_t rightCount = 0;
+                    for (uint32_t b = NumBins - 1; b > 0; --b) {
+                        rightBBox.unify(bins[dim][b].bbox);
+                        rightCount += bins[dim][b].numPrimitives;
+                        rightAreas[b] = rightCount > 0 ? rightBBox.surfaceArea() : 0.0f;
+                        rightCounts[b] = rightCount;
+                    }
+
+                    BoundingBox3D leftBBox;
+                    uint32_t leftCount = 0;
+                    for (uint32_t b = 1; b < NumBins; ++b) {
+                        leftBBox.unify(bins[dim][b - 1].bbox);
+                        leftCount += bins[dim][b - 1].numPrimitives;
+                        if (leftCount == 0 || rightCounts[b] == 0)
+                            continue;
+                        float cost = leftCount * leftBBox.surfaceArea() + rightCounts[b] * rightAreas[b];
+                        if (cost < bestCost) {
+                            bestCost = cost;
+                            bestDim = dim;
+                            bestSplit = b;
+                        }
+                    }
+                }
+
+                float nodeArea = node->bbox.surfaceArea();
+                float leafCost = IntersectionCost * numPrimitives;
+                bestCost = nodeArea > 0.0f ? (TraversalCost + IntersectionCost * bestCost / nodeArea) : INFINITY;
+                if (numPrimitives <= MaxNumPrimitivesInLeaf && leafCost <= bestCost)
+                    return node;
+
+                if (bestDim >= 0 && depth < MaxSAHDepth) {
+                    axis = (BoundingBox3D::Axis)bestDim;
+                    float binScale = binScales[bestDim];
+                    float minCoord = centroidBBox.minP[bestDim];
+                    auto itMid = std::partition(context.primIndices.begin() + start, context.primIndices.begin() + end,
+                                                [&context, bestDim, bestSplit, binScale, minCoord](uint32_t primIdx) {
+                        float coord = context.primCentroids[primIdx][bestDim];
+                        uint32_t binIdx = std::min<uint32_t>((uint32_t)((coord - minCoord) * binScale), NumBins - 1);
+                        return binIdx < bestSplit;
+                    });
+                    mid = (uint32_t)(itMid - context.primIndices.begin());
+                }
+                else {
+                    mid = start;
+                }
+
+                // JP: 数値誤差などで偏った分割になった場合は中央値で分割する。
+                // EN: Split at the median when the partition is degenerate due to numerical errors or so.
+                if (mid == start || mid == end) {
+                    mid = (start + end) / 2;
+                    std::nth_element(context.primIndices.begin() + start, context.primIndices.begin() + mid, context.primIndices.begin() + end,
+                                     [&context, axis](uint32_t a, uint32_t b) {
+                        return context.primCentroids[a][axis] < context.primCentroids[b][axis];
+                    });
+                }
+            }
+
+            node->axis = axis;
+
+            // JP: 十分に大きな部分木は空いているスレッドがあればそちらで構築する。
+            // EN: Build a sufficiently large subtree on another thread if there is an available one.
+            bool buildInParallel = false;
+            if (std::min(mid - start, end - mid) >= MinNumPrimitivesForParallelBuild) {
+                if (context.numAvailableThreads.fetch_sub(1) > 0)
+                    buildInParallel = true;
+                else
+                    context.numAvailableThreads.fetch_add(1);
+            }
+
+            if (buildInParallel) {
+                std::thread thread([&context, node, start, mid, depth]() {
+                    node->children[0].reset(buildRecursive(context, start, mid, depth + 1));
+                });
+                node->children[1].reset(buildRecursive(context, mid, end, depth + 1));
+                thread.join();
+                context.numAvailableThreads.fetch_add(1);
+            }
+            else {
+                node->children[0].reset(buildRecursive(context, start, mid, depth + 1));
+                node->children[1].reset(buildRecursive(context, mid, end, depth + 1));
+            }
+
+            return node;
+        }
+
+        uint32_t BVH::flatten(const BuildNode* buildNode, uint32_t depth, float rootArea) {
+            uint32_t nodeIdx = (uint32_t)m_nodes.size();
+            m_nodes.emplace_back();
+
+            m_statistics.maxDepth = std::max(m_statistics.maxDepth, depth);
+            float areaRatio = rootArea > 0.0f ? buildNode->bbox.surfaceArea() / rootArea : 1.0f;
+
+            if (buildNode->isLeaf()) {
+                uint32_t numPrimitives = buildNode->end - buildNode->start;
+                ++m_statistics.numLeafNodes;
+                m_statistics.SAHCost += IntersectionCost * numPrimitives * areaRatio;
+
+                Node &node = m_nodes[nodeIdx];
+                node.bbox = buildNode->bbox;
+                node.offset = buildNode->start;
+                node.numPrimitives = numPrimitives;
+                node.axis = 0;
+                return nodeIdx;
+            }
+
+            m_statistics.SAHCost += TraversalCost * areaRatio;
+
+            flatten(buildNode->children[0].get(), depth + 1, rootArea);
+            uint32_t secondChildIdx = flatten(buildNode->children[1].get(), depth + 1, rootArea);
+
+            Node &node = m_nodes[nodeIdx];
+            node.bbox = buildNode->bbox;
+            node.offset = secondChildIdx;
+            node.numPrimitives = 0;
+            node.axis = buildNode->axis;
+
+            return nodeIdx;
+        }
+
+        void BVH::build(const std::vector<BoundingBox3D> &primBBoxes, uint32_t numThreads) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            m_nodes.clear();
+            m_primIndices.clear();
+            m_statistics = BVHStatistics();
+
+            if (primBBoxes.empty())
+                return;
+
+            if (numThreads == 0)
+                numThreads = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+
+            uint32_t numPrimitives = (uint32_t)primBBoxes.size();
+            m_primIndices.resize(numPrimitives);
+            for (uint32_t i = 0; i < numPrimitives; ++i)
+                m_primIndices[i] = i;
+
+            BuildContext context(primBBoxes, m_primIndices, numThreads);
+            context.primCentroids.resize(numPrimitives);
+            for (uint32_t i = 0; i < numPrimitives; ++i)
+                context.primCentroids[i] = primBBoxes[i].centroid();
+
+            std::unique_ptr<BuildNode> root(buildRecursive(context, 0, numPrimitives, 0));
+
+            m_nodes.reserve(2 * numPrimitives);
+            flatten(root.get(), 0, root->bbox.surfaceArea());
+            m_statistics.numNodes = (uint32_t)m_nodes.size();
+
+            auto endTime = std::chrono::high_resolution_clock::now();
+            m_statistics.buildTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() * 1e-3f;
+        }
+
+        void BVH::refit(const std::vector<BoundingBox3D> &primBBoxes) {
+            VLRAssert(primBBoxes.size() == m_primIndices.size(), "The number of primitives must not change.");
+            if (m_nodes.empty())
+                return;
+
+            // JP: 子は常に親より後ろに配置されているので、逆順に辿れば子が先に更新される。
+            // EN: Children are always placed after their parent, so traversing in reverse order updates children first.
+            for (int32_t nodeIdx = (int32_t)m_nodes.size() - 1; nodeIdx >= 0; --nodeIdx) {
+                Node &node = m_nodes[nodeIdx];
+                node.bbox = BoundingBox3D();
+                if (node.numPrimitives > 0) {
+                    for (uint32_t i = 0; i < node.numPrimitives; ++i)
+                        node.bbox.unify(primBBoxes[m_primIndices[node.offset + i]]);
+                }
+                else {
+                    node.bbox.unify(m_nodes[nodeIdx + 1].bbox);
+                    node.bbox.unify(m_nodes[node.offset].bbox);
+                }
+            }
+
+            float rootArea = m_nodes[0].bbox.surfaceArea();
+            m_statistics.SAHCost = 0.0f;
+            for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+                float areaRatio = rootArea > 0.0f ? it->bbox.surfaceArea() / rootArea : 1.0f;
+                if (it->numPrimitives > 0)
+                    m_statistics.SAHCost += IntersectionCost * it->numPrimitives * areaRatio;
+                else
+                    m_statistics.SAHCost += TraversalCost * areaRatio;
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+namespace VLR {
+    namespace CPU {
+        struct BVHStatistics {
+            float buildTime; // milliseconds
+            uint32_t numNodes;
+            uint32_t numLeafNodes;
+            uint32_t maxDepth;
+            float SAHCost;
+
+            BVHStatistics() : buildTime(0.0f), numNodes(0), numLeafNodes(0), maxDepth(0), SAHCost(0.0f) {}
+        };
+
+
+
+        // JP: プリミティブのバウンディングボックス群に対するビン分割SAHによるBVH。
+        //     構築は大きなノードに対してビン分割と部分木の構築を複数スレッドで並列に行う。
+        // EN: BVH with the binned SAH over a set of primitive bounding boxes.
+        //     The build parallelizes binning and subtree construction with multiple threads for large nodes.
+        class BVH {
+        public:
+            struct Node {
+                BoundingBox3D bbox;
+                // JP: 葉の場合は最初のプリミティブのインデックス、中間ノードの場合は2番目の子のインデックス。
+                //     1番目の子は常に直後に配置される。
+                // EN: The index of the first primitive for a leaf, the index of the second child for an inner node.
+                //     The first child is always placed right after.
+                uint32_t offset;
+                uint16_t numPrimitives;
+                uint8_t axis;
+            };
+
+            static const uint32_t NumBins = 32;
+            static const uint32_t MaxNumPrimitivesInLeaf = 8;
+            static constexpr float TraversalCost = 1.0f;
+            static constexpr float IntersectionCost = 1.0f;
+
+        private:
+            struct BuildNode;
+            struct BuildContext;
+
+            std::vector<Node> m_nodes;
+            std::vector<uint32_t> m_primIndices;
+            BVHStatistics m_statistics;
+
+            static BuildNode* buildRecursive(BuildContext &context, uint32_t start, uint32_t end, uint32_t depth);
+            uint32_t flatten(const BuildNode* buildNode, uint32_t depth, float rootArea);
+
+        public:
+            // JP: numThreadsが0の場合はハードウェアスレッド数を使う。
+            // EN: use the number of hardware threads if numThreads is 0.
+            void build(const std::vector<BoundingBox3D> &primBBoxes, uint32_t numThreads = 0);
+            // JP: トポロジーを保ったまま、プリミティブのAABBに合わせてノードのAABBを下から更新しSAHコストを再計算する。
+            //     primBBoxesは構築時と同じ順序・個数でなければならない。
+            // EN: Update node AABBs bottom-up to fit the primitive AABBs while keeping the topology, and recompute the SAH cost.
+            //     primBBoxes must be in the same order and count as in building.
+            void refit(const std::vector<BoundingBox3D> &primBBoxes);
+
+            const std::vector<Node> &getNodes() const {
+                return m_nodes;
+            }
+            // JP: 葉ノードが参照する並び替え済みのプリミティブインデックス。
+            // EN: Sorted primitive indices referenced by leaf nodes.
+            const std::vector<uint32_t> &getPrimitiveIndices() const {
+                return m_primIndices;
+            }
+            const BVHStatistics &getStatistics() const {
+                return m_statistics;
+            }
+        };
+    }
+}
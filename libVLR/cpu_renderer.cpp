@@ -0,0 +1,808 @@
+﻿#include "cpu_renderer.h"
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <unordered_map>
+
+#include "context.h"
+#include "scene.h"
+#include "tiled_image.h"
+
+namespace VLR {
+    namespace CPU {
+        // ----------------------------------------------------------------
+        // Resource Resolver
+
+        struct Texture2D {
+            struct MipLevel {
+                const uint8_t* data;
+                uint32_t width;
+                uint32_t height;
+            };
+            std::vector<MipLevel> mipLevels;
+            RTformat format;
+            uint32_t texelSize;
+            // JP: タイル化画像の場合、各レベルのdataはnullptrで、テクセルはタイル単位で取得する。
+            // EN: For a tiled image, data of each level is nullptr and texels are obtained per tile.
+            const TiledImageFile* tiledFile;
+            uint32_t tileSize;
+            RTwrapmode wrapModes[2];
+            RTfiltermode filterMode;
+            RTfiltermode mipFilterMode;
+            bool degamma;
+        };
+
+        static uint32_t getTexelSize(RTformat format) {
+            switch (format) {
+            case RT_FORMAT_UNSIGNED_BYTE:
+                return 1;
+            case RT_FORMAT_UNSIGNED_BYTE2:
+                return 2;
+            case RT_FORMAT_UNSIGNED_BYTE3:
+                return 3;
+            case RT_FORMAT_UNSIGNED_BYTE4:
+            case RT_FORMAT_FLOAT:
+                return 4;
+            case RT_FORMAT_HALF4:
+            case RT_FORMAT_FLOAT2:
+                return 8;
+            case RT_FORMAT_FLOAT4:
+                return 16;
+            default:
+                return 0;
+            }
+        }
+
+        // JP: カーネルがIDで参照するホストのコンテキストのバッファーやテクスチャーをマップする。
+        //     レンダリング中に複数のスレッドから呼ばれるためマップ処理はロックで保護する。
+        // EN: Map buffers and textures of the host context referenced by ID from the kernels.
+        //     Mapping is protected by a lock since this is called from multiple threads during rendering.
+        class ResourceResolver {
+            Backend::Context m_optixContext;
+            TileCache* m_tileCache;
+            std::mutex m_mutex;
+            std::map<int32_t, Backend::Buffer> m_mappedBuffers;
+            std::map<int32_t, BufferRef> m_bufferRefs;
+            // JP: テクスチャーとして追加でマップしたレベル1以降のミップマップ。
+            // EN: Mipmaps of the level 1 and later additionally mapped for textures.
+            std::map<int32_t, std::vector<const uint8_t*>> m_mappedMipLevels;
+            std::map<int32_t, Texture2D> m_textures;
+
+            BufferRef mapBufferInternal(const Backend::Buffer &buffer, RTbuffermapflag mapFlag) {
+                int32_t bufferID = buffer->getId();
+                if (m_bufferRefs.count(bufferID))
+                    return m_bufferRefs.at(bufferID);
+
+                RTsize width = 0, height = 1;
+                if (buffer->getDimensionality() == 2)
+                    buffer->getSize(width, height);
+                else
+                    buffer->getSize(width);
+
+                BufferRef ref(buffer->map(0, mapFlag), (uint32_t)width, (uint32_t)height);
+                m_mappedBuffers[bufferID] = buffer;
+                m_bufferRefs[bufferID] = ref;
+
+                return ref;
+            }
+
+        public:
+            ResourceResolver(const Backend::Context &optixContext, TileCache* tileCache) : m_optixContext(optixContext), m_tileCache(tileCache) {}
+            ~ResourceResolver() {
+                for (auto it = m_mappedBuffers.begin(); it != m_mappedBuffers.end(); ++it) {
+                    if (m_mappedMipLevels.count(it->first)) {
+                        for (uint32_t mipLevel = (uint32_t)m_mappedMipLevels.at(it->first).size(); mipLevel > 0; --mipLevel)
+                            it->second->unmap(mipLevel);
+                    }
+                    it->second->unmap(0);
+                }
+            }
+
+            BufferRef mapBuffer(const Backend::Buffer &buffer, RTbuffermapflag mapFlag = RT_BUFFER_MAP_READ) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return mapBufferInternal(buffer, mapFlag);
+            }
+
+            BufferRef mapBuffer(int32_t bufferID) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_bufferRefs.count(bufferID))
+                    return m_bufferRefs.at(bufferID);
+                return mapBufferInternal(m_optixContext->getBufferFromId(bufferID), RT_BUFFER_MAP_READ);
+            }
+
+            TileCache* getTileCache() const {
+                return m_tileCache;
+            }
+
+            const Texture2D &getTexture(int32_t textureID) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_textures.count(textureID))
+                    return m_textures.at(textureID);
+
+                Backend::TextureSampler sampler = m_optixContext->getTextureSamplerFromId(textureID);
+                Backend::Buffer buffer = sampler->getBuffer();
+
+                Texture2D texture;
+                texture.format = buffer->getFormat();
+                texture.wrapModes[0] = sampler->getWrapMode(0);
+                texture.wrapModes[1] = sampler->getWrapMode(1);
+                RTfiltermode minFilter, magFilter, mipFilter;
+                sampler->getFilteringModes(minFilter, magFilter, mipFilter);
+                texture.filterMode = magFilter;
+                texture.mipFilterMode = mipFilter;
+                RTtexturereadmode readMode = sampler->getReadMode();
+                texture.degamma = (readMode == RT_TEXTURE_READ_ELEMENT_TYPE_SRGB ||
+                                   readMode == RT_TEXTURE_READ_NORMALIZED_FLOAT_SRGB);
+                texture.texelSize = getTexelSize(texture.format);
+                const TiledImage2D* tiledImage = m_tileCache->findImage(buffer->getId());
+                texture.tiledFile = tiledImage ? &tiledImage->getTiledFile() : nullptr;
+                texture.tileSize = 0;
+
+                if (texture.tiledFile) {
+                    // JP: タイル化画像のバッファーは形式を伝えるだけなのでマップしない。
+                    // EN: The buffer of a tiled image only conveys the format, so it isn't mapped.
+                    texture.tileSize = texture.tiledFile->getTileSize();
+                    for (uint32_t mipLevel = 0; mipLevel < texture.tiledFile->getMipCount(); ++mipLevel) {
+                        texture.mipLevels.push_back(Texture2D::MipLevel{ nullptr,
+                                                                         texture.tiledFile->getLevelWidth(mipLevel),
+                                                                         texture.tiledFile->getLevelHeight(mipLevel) });
+                    }
+                    m_textures[textureID] = texture;
+
+                    return m_textures.at(textureID);
+                }
+
+                switch (texture.format) {
+                case RT_FORMAT_UNSIGNED_BYTE:
+                case RT_FORMAT_UNSIGNED_BYTE2:
+                case RT_FORMAT_UNSIGNED_BYTE3:
+                case RT_FORMAT_UNSIGNED_BYTE4:
+                case RT_FORMAT_HALF4:
+                case RT_FORMAT_FLOAT:
+                case RT_FORMAT_FLOAT2:
+                case RT_FORMAT_FLOAT4: {
+                    // JP: レベル0は通常のバッファーと同様にマップし、残りのレベルは順に追加でマップする。
+                    // EN: Map the level 0 in the same way as ordinary buffers, then additionally map the remaining levels in order.
+                    BufferRef ref = mapBufferInternal(buffer, RT_BUFFER_MAP_READ);
+                    texture.mipLevels.push_back(Texture2D::MipLevel{ (const uint8_t*)ref.data, ref.width, ref.height });
+
+                    int32_t bufferID = buffer->getId();
+                    std::vector<const uint8_t*> &mipLevelData = m_mappedMipLevels[bufferID];
+                    uint32_t mipCount = buffer->getMipLevelCount();
+                    for (uint32_t mipLevel = (uint32_t)mipLevelData.size() + 1; mipLevel < mipCount; ++mipLevel)
+                        mipLevelData.push_back((const uint8_t*)buffer->map(mipLevel, RT_BUFFER_MAP_READ));
+                    for (uint32_t mipLevel = 1; mipLevel < mipCount; ++mipLevel) {
+                        RTsize width, height;
+                        buffer->getMipLevelSize(mipLevel, width, height);
+                        texture.mipLevels.push_back(Texture2D::MipLevel{ mipLevelData[mipLevel - 1], (uint32_t)width, (uint32_t)height });
+                    }
+                    break;
+                }
+                default:
+                    // JP: ブロック圧縮フォーマットなどは未対応。
+                    // EN: Block compressed formats and so on are not supported.
+                    vlrprintf("CPU backend: unsupported texture format: 0x%x\n", texture.format);
+                    break;
+                }
+
+                m_textures[textureID] = texture;
+
+                return m_textures.at(textureID);
+            }
+        };
+
+        // JP: ワーカースレッドごとのリゾルバーとキャッシュ。
+        //     キャッシュはレンダリングのたびにクリアする。
+        // EN: Resolver and caches per worker thread.
+        //     The caches are cleared for each rendering.
+        static thread_local ResourceResolver* t_resolver;
+        static thread_local std::unordered_map<int32_t, const void*> t_bufferCache;
+        static thread_local std::unordered_map<int32_t, const Texture2D*> t_textureCache;
+
+        // JP: タイル化画像のタイルをスレッドごとにダイレクトマップで保持し、TileCacheのロックを取る回数を減らす。
+        //     保持している参照はレンダリングの終わりか、保持しているタイルのせいでTileCacheが予算を超えた時点で手放す。
+        // EN: Hold tiles of tiled images per thread in a direct-mapped manner to reduce the number of taking the lock of TileCache.
+        //     The held references are released at the end of rendering, or when TileCache exceeds the budget due to held tiles.
+        struct TileSlot {
+            const TiledImageFile* file;
+            uint32_t mipLevel;
+            uint32_t tileX;
+            uint32_t tileY;
+            TileCache::TileData data;
+        };
+        static constexpr uint32_t NumTileSlots = 64;
+        static thread_local TileSlot t_tileSlots[NumTileSlots];
+
+        static void releaseTileSlots(const TileSlot* slotToKeep) {
+            for (uint32_t i = 0; i < NumTileSlots; ++i) {
+                if (&t_tileSlots[i] == slotToKeep)
+                    continue;
+                t_tileSlots[i].file = nullptr;
+                t_tileSlots[i].data.reset();
+            }
+        }
+
+        static void bindResolver(ResourceResolver* resolver) {
+            t_resolver = resolver;
+            t_bufferCache.clear();
+            t_textureCache.clear();
+            releaseTileSlots(nullptr);
+        }
+
+        const void* getBufferData(int32_t bufferID) {
+            auto it = t_bufferCache.find(bufferID);
+            if (it != t_bufferCache.end())
+                return it->second;
+
+            VLRAssert(t_resolver, "Resolver is not bound.");
+            const void* data = t_resolver->mapBuffer(bufferID).data;
+            t_bufferCache[bufferID] = data;
+            return data;
+        }
+
+        static int32_t wrapTexelCoordinate(int32_t c, int32_t size, RTwrapmode mode) {
+            switch (mode) {
+            case RT_WRAP_REPEAT:
+                c %= size;
+                return c < 0 ? c + size : c;
+            case RT_WRAP_MIRROR: {
+                int32_t period = 2 * size;
+                c %= period;
+                if (c < 0)
+                    c += period;
+                return c < size ? c : period - 1 - c;
+            }
+            case RT_WRAP_CLAMP_TO_BORDER:
+                return (c < 0 || c >= size) ? -1 : c;
+            case RT_WRAP_CLAMP_TO_EDGE:
+            default:
+                return std::min(std::max(c, 0), size - 1);
+            }
+        }
+
+        static optix::float4 fetchTexel(const Texture2D &texture, uint32_t mipLevel, int32_t x, int32_t y) {
+            const Texture2D::MipLevel &level = texture.mipLevels[mipLevel];
+            x = wrapTexelCoordinate(x, level.width, texture.wrapModes[0]);
+            y = wrapTexelCoordinate(y, level.height, texture.wrapModes[1]);
+            if (x < 0 || y < 0)
+                return optix::make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+            const uint8_t* texelData;
+            if (texture.tiledFile) {
+                uint32_t tileX = x / texture.tileSize;
+                uint32_t tileY = y / texture.tileSize;
+                TileSlot &slot = t_tileSlots[(tileX + 7 * tileY + 31 * mipLevel + ((uintptr_t)texture.tiledFile >> 6)) % NumTileSlots];
+                if (slot.file != texture.tiledFile || slot.mipLevel != mipLevel || slot.tileX != tileX || slot.tileY != tileY) {
+                    VLRAssert(t_resolver, "Resolver is not bound.");
+                    TileCache* tileCache = t_resolver->getTileCache();
+                    bool overBudget;
+                    slot.data = tileCache->getTile(texture.tiledFile, mipLevel, tileX, tileY, &overBudget);
+                    slot.file = texture.tiledFile;
+                    slot.mipLevel = mipLevel;
+                    slot.tileX = tileX;
+                    slot.tileY = tileY;
+
+                    // JP: スレッドが保持するタイルも予算に数えられるので、超えている場合は今読むタイル以外を手放して追い出せるようにする。
+                    //     したがってタイルのメモリーは、スレッドごとに読んでいる最中の1タイルを除き予算に収まる。
+                    // EN: Tiles held by threads are also counted in the budget, so when it is exceeded, release tiles except the one being read now so that they can be evicted.
+                    //     Therefore memory of tiles fits in the budget except for one tile per thread being read.
+                    if (overBudget) {
+                        releaseTileSlots(&slot);
+                        tileCache->trim();
+                    }
+                }
+                uint32_t index = (y - tileY * texture.tileSize) * texture.tileSize + (x - tileX * texture.tileSize);
+                texelData = slot.data->data() + texture.texelSize * index;
+            }
+            else {
+                uint32_t index = y * level.width + x;
+                texelData = level.data + texture.texelSize * index;
+            }
+
+            optix::float4 ret = optix::make_float4(0.0f, 0.0f, 0.0f, 1.0f);
+            switch (texture.format) {
+            case RT_FORMAT_UNSIGNED_BYTE: {
+                const uint8_t* texel = texelData;
+                ret.x = texel[0] / 255.0f;
+                break;
+            }
+            case RT_FORMAT_UNSIGNED_BYTE2: {
+                const uint8_t* texel = texelData;
+                ret.x = texel[0] / 255.0f;
+                ret.y = texel[1] / 255.0f;
+                break;
+            }
+            case RT_FORMAT_UNSIGNED_BYTE3: {
+                const uint8_t* texel = texelData;
+                ret.x = texel[0] / 255.0f;
+                ret.y = texel[1] / 255.0f;
+                ret.z = texel[2] / 255.0f;
+                break;
+            }
+            case RT_FORMAT_UNSIGNED_BYTE4: {
+                const uint8_t* texel = texelData;
+                ret.x = texel[0] / 255.0f;
+                ret.y = texel[1] / 255.0f;
+                ret.z = texel[2] / 255.0f;
+                ret.w = texel[3] / 255.0f;
+                break;
+            }
+            case RT_FORMAT_HALF4: {
+                const half* texel = (const half*)texelData;
+                ret = optix::make_float4((float)texel[0], (float)texel[1], (float)texel[2], (float)texel[3]);
+                break;
+            }
+            case RT_FORMAT_FLOAT: {
+                const float* texel = (const float*)texelData;
+                ret.x = texel[0];
+                break;
+            }
+            case RT_FORMAT_FLOAT2: {
+                const float* texel = (const float*)texelData;
+                ret.x = texel[0];
+                ret.y = texel[1];
+                break;
+            }
+            case RT_FORMAT_FLOAT4: {
+                const float* texel = (const float*)texelData;
+                ret = optix::make_float4(texel[0], texel[1], texel[2], texel[3]);
+                break;
+            }
+            default:
+                VLRAssert_ShouldNotBeCalled();
+                break;
+            }
+
+            if (texture.degamma) {
+                ret.x = sRGB_degamma(ret.x);
+                ret.y = sRGB_degamma(ret.y);
+                ret.z = sRGB_degamma(ret.z);
+            }
+
+            return ret;
+        }
+
+        static optix::float4 fetchTexelFiltered(const Texture2D &texture, uint32_t mipLevel, float x, float y) {
+            const Texture2D::MipLevel &level = texture.mipLevels[mipLevel];
+            float px = x * level.width;
+            float py = y * level.height;
+            if (texture.filterMode == RT_FILTER_NEAREST)
+                return fetchTexel(texture, mipLevel, (int32_t)std::floor(px), (int32_t)std::floor(py));
+
+            px -= 0.5f;
+            py -= 0.5f;
+            float fx = std::floor(px);
+            float fy = std::floor(py);
+            int32_t ix = (int32_t)fx;
+            int32_t iy = (int32_t)fy;
+            float tx = px - fx;
+            float ty = py - fy;
+
+            optix::float4 t00 = fetchTexel(texture, mipLevel, ix, iy);
+            optix::float4 t10 = fetchTexel(texture, mipLevel, ix + 1, iy);
+            optix::float4 t01 = fetchTexel(texture, mipLevel, ix, iy + 1);
+            optix::float4 t11 = fetchTexel(texture, mipLevel, ix + 1, iy + 1);
+
+            float w00 = (1 - tx) * (1 - ty);
+            float w10 = tx * (1 - ty);
+            float w01 = (1 - tx) * ty;
+            float w11 = tx * ty;
+            return optix::make_float4(w00 * t00.x + w10 * t10.x + w01 * t01.x + w11 * t11.x,
+                                      w00 * t00.y + w10 * t10.y + w01 * t01.y + w11 * t11.y,
+                                      w00 * t00.z + w10 * t10.z + w01 * t01.z + w11 * t11.z,
+                                      w00 * t00.w + w10 * t10.w + w01 * t01.w + w11 * t11.w);
+        }
+
+        // JP: 各レベル内はバイリニア(またはニアレスト)で、レベル間はサンプラーのミップマップフィルターに従う。
+        // EN: Bilinear (or nearest) within each level, and the mipmap filter of the sampler between levels.
+        optix::float4 fetchTexture2D(int32_t textureID, float x, float y, float level) {
+            const Texture2D* texture;
+            auto it = t_textureCache.find(textureID);
+            if (it != t_textureCache.end()) {
+                texture = it->second;
+            }
+            else {
+                VLRAssert(t_resolver, "Resolver is not bound.");
+                texture = &t_resolver->getTexture(textureID);
+                t_textureCache[textureID] = texture;
+            }
+
+            if (texture->mipLevels.empty())
+                return optix::make_float4(1.0f, 0.0f, 1.0f, 1.0f);
+
+            uint32_t maxLevel = (uint32_t)texture->mipLevels.size() - 1;
+            if (texture->mipFilterMode == RT_FILTER_NONE || maxLevel == 0)
+                return fetchTexelFiltered(*texture, 0, x, y);
+
+            level = std::min(std::max(level, 0.0f), (float)maxLevel);
+            if (texture->mipFilterMode == RT_FILTER_NEAREST)
+                return fetchTexelFiltered(*texture, (uint32_t)(level + 0.5f), x, y);
+
+            uint32_t level0 = (uint32_t)level;
+            uint32_t level1 = std::min(level0 + 1, maxLevel);
+            float t = level - level0;
+            optix::float4 v0 = fetchTexelFiltered(*texture, level0, x, y);
+            if (t == 0.0f)
+                return v0;
+            optix::float4 v1 = fetchTexelFiltered(*texture, level1, x, y);
+            return optix::make_float4((1 - t) * v0.x + t * v1.x,
+                                      (1 - t) * v0.y + t * v1.y,
+                                      (1 - t) * v0.z + t * v1.z,
+                                      (1 - t) * v0.w + t * v1.w);
+        }
+
+
+
+        // ----------------------------------------------------------------
+        // Renderer
+
+        // JP: レンダリング中ずっと待機しているスレッド群。フレームごとにスレッドを生成する代わりに、待機中のスレッドにジョブを渡して起こす。
+        //     呼び出し元のスレッドもスレッド番号0として処理に加わり、run()は全スレッドがジョブを終えるまで戻らない。
+        // EN: Threads waiting throughout rendering. Instead of creating threads per frame, pass a job to the waiting threads and wake them.
+        //     The calling thread also participates as the thread index 0, and run() doesn't return until all the threads finish the job.
+        class WorkerPool {
+            std::vector<std::thread> m_threads;
+            std::mutex m_mutex;
+            std::condition_variable m_jobAvailable;
+            std::condition_variable m_jobDone;
+            const std::function<void(uint32_t)>* m_job;
+            uint64_t m_jobSerial;
+            uint32_t m_numRunningThreads;
+            bool m_terminate;
+
+            void workerLoop(uint32_t threadIndex) {
+                uint64_t lastJobSerial = 0;
+                while (true) {
+                    const std::function<void(uint32_t)>* job;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_jobAvailable.wait(lock, [&]() { return m_terminate || m_jobSerial != lastJobSerial; });
+                        if (m_terminate)
+                            return;
+                        lastJobSerial = m_jobSerial;
+                        job = m_job;
+                    }
+
+                    (*job)(threadIndex);
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (--m_numRunningThreads == 0)
+                        m_jobDone.notify_one();
+                }
+            }
+
+        public:
+            WorkerPool(uint32_t numThreads) : m_job(nullptr), m_jobSerial(0), m_numRunningThreads(0), m_terminate(false) {
+                for (uint32_t i = 1; i < numThreads; ++i)
+                    m_threads.emplace_back(&WorkerPool::workerLoop, this, i);
+            }
+            ~WorkerPool() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_terminate = true;
+                }
+                m_jobAvailable.notify_all();
+                for (auto it = m_threads.begin(); it != m_threads.end(); ++it)
+                    it->join();
+            }
+
+            void run(const std::function<void(uint32_t)> &job) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_job = &job;
+                    m_numRunningThreads = (uint32_t)m_threads.size();
+                    ++m_jobSerial;
+                }
+                m_jobAvailable.notify_all();
+
+                job(0);
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobDone.wait(lock, [this]() { return m_numRunningThreads == 0; });
+                m_job = nullptr;
+            }
+        };
+
+        Renderer::Renderer(Context &context) :
+            m_context(context),
+            m_kernels(context.getRenderingMode() == VLRRenderingMode_Spectral ? getSpectralKernelSet() : getRGBKernelSet()),
+            m_integrator(VLRCPUIntegrator_Wavefront), m_tileWidth(0), m_tileHeight(0), m_frameIndex(0) {
+            m_numThreads = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+            m_workerPool.reset(new WorkerPool(m_numThreads));
+        }
+
+        Renderer::~Renderer() {
+        }
+
+        void Renderer::registerProgram(int32_t programID, const std::string &name) {
+            VLRAssert(programID >= 0, "Invalid program ID.");
+            if ((uint32_t)programID >= m_programs.size())
+                m_programs.resize(programID + 1, nullptr);
+            // JP: 交差判定やデバッグ描画など、CPUバックエンドに対応するものが無いプログラムはnullptrのままとなる。
+            // EN: Programs without a counterpart in the CPU backend like intersection and debug rendering remain nullptr.
+            m_programs[programID] = m_kernels.findProgram(name);
+        }
+
+        // JP: シーン階層のルートノードの加速構造を変更イベントに従って更新し、
+        //     TLASのinstIndexの順にホストのコンテキストのGeometryInstanceの変数を読み出す。
+        // EN: Update the acceleration structure of the root node of the scene hierarchy according to change events,
+        //     and read variables of GeometryInstances of the host context in the order of instIndex of the TLAS.
+        void Renderer::setupScene(VLR::Scene &scene, ResourceResolver &resolver) {
+            const RootNode &rootNode = scene.getRootNode();
+
+            std::vector<GeometryInstance> instances(rootNode.getNumHostGeometryInstances());
+            for (uint32_t i = 0; i < instances.size(); ++i) {
+                const Backend::GeometryInstance &optixGeomInst = rootNode.getHostGeometryInstance(i)->getOptiXObject();
+
+                GeometryInstance &inst = instances[i];
+                inst.vertexBufferID = optixGeomInst["VLR::pv_vertexBuffer"]->getBuffer()->getId();
+                inst.triangleBufferID = optixGeomInst["VLR::pv_triangleBuffer"]->getBuffer()->getId();
+                inst.vertexBuffer = resolver.mapBuffer(inst.vertexBufferID);
+                inst.triangleBuffer = resolver.mapBuffer(inst.triangleBufferID);
+                inst.sumImportances = optixGeomInst["VLR::pv_sumImportances"]->getFloat();
+                inst.progDecodeTexCoord = optixGeomInst["VLR::pv_progDecodeTexCoord"]->getProgram()->getId();
+                inst.progDecodeHitPoint = optixGeomInst["VLR::pv_progDecodeHitPoint"]->getProgram()->getId();
+                optixGeomInst["VLR::pv_tangentType"]->getUserData(sizeof(inst.tangentType), &inst.tangentType);
+                optixGeomInst["VLR::pv_nodeNormal"]->getUserData(sizeof(inst.nodeNormal), &inst.nodeNormal);
+                optixGeomInst["VLR::pv_nodeAlpha"]->getUserData(sizeof(inst.nodeAlpha), &inst.nodeAlpha);
+                optixGeomInst["VLR::pv_materialIndex"]->getUserData(sizeof(inst.materialIndex), &inst.materialIndex);
+                inst.importance = optixGeomInst["VLR::pv_importance"]->getFloat();
+                rootNode.getHostGeometryInstanceTransform(i, &inst.objectToWorld, &inst.worldToObject);
+            }
+
+            m_scene.setup(&rootNode.getHostAccelerator(), std::move(instances));
+            m_bvhStatistics = rootNode.getHostBVHStatistics();
+        }
+
+        template <typename SpectrumStorageType>
+        static void convertToRGB(VLRAccumulationFormat accumulationFormat, const BufferRef &spectrumBuffer, const BufferRef &compactBuffer,
+                                 const BufferRef &pixelStatisticsBuffer, const BufferRef &rgbBuffer,
+                                 const optix::uint2 &minIndex, const optix::uint2 &maxIndex) {
+            auto spectra = (SpectrumStorageType*)spectrumBuffer.data;
+            auto compactValues = (const Shared::CompactXYZStorage*)compactBuffer.data;
+            auto pixelStats = (const Shared::PixelStatistics*)pixelStatisticsBuffer.data;
+            auto rgbs = (RGBSpectrum*)rgbBuffer.data;
+            for (uint32_t y = minIndex.y; y < maxIndex.y; ++y) {
+                for (uint32_t x = minIndex.x; x < maxIndex.x; ++x) {
+                    uint32_t numSamples = pixelStats[y * pixelStatisticsBuffer.width + x].numSamples;
+                    float recNumAccums = numSamples > 0 ? 1.0f / numSamples : 0.0f;
+                    float XYZ[3];
+                    if (accumulationFormat == VLRAccumulationFormat_CompactXYZ) {
+                        compactValues[y * compactBuffer.width + x].getXYZ(XYZ);
+                    }
+                    else {
+                        const auto &spectrum = spectra[y * spectrumBuffer.width + x].getValue().result;
+                        spectrum.toXYZ(XYZ);
+                    }
+                    VLRAssert(XYZ[0] >= 0.0f && XYZ[1] >= 0.0f && XYZ[2] >= 0.0f, "each value of XYZ must not be negative.");
+                    XYZ[0] *= recNumAccums;
+                    XYZ[1] *= recNumAccums;
+                    XYZ[2] *= recNumAccums;
+                    float RGB[3];
+                    transformTristimulus(mat_XYZ_to_Rec709_D65, XYZ, RGB);
+                    rgbs[y * rgbBuffer.width + x] = RGBSpectrum(RGB[0], RGB[1], RGB[2]); // not clamp out of gamut color.
+                }
+            }
+        }
+
+        static void convertToRGB(VLRRenderingMode renderingMode, VLRAccumulationFormat accumulationFormat,
+                                 const BufferRef &spectrumBuffer, const BufferRef &compactBuffer,
+                                 const BufferRef &pixelStatisticsBuffer, const BufferRef &rgbBuffer,
+                                 const optix::uint2 &minIndex, const optix::uint2 &maxIndex) {
+            if (renderingMode == VLRRenderingMode_Spectral)
+                convertToRGB<SpectralRenderingTypes::SpectrumStorage>(accumulationFormat, spectrumBuffer, compactBuffer, pixelStatisticsBuffer, rgbBuffer,
+                                                                      minIndex, maxIndex);
+            else
+                convertToRGB<RGBRenderingTypes::SpectrumStorage>(accumulationFormat, spectrumBuffer, compactBuffer, pixelStatisticsBuffer, rgbBuffer,
+                                                                 minIndex, maxIndex);
+        }
+
+        // JP: スレッドごとのタイルのデック。各スレッドは画像の連続した範囲のタイルを先頭から処理し、
+        //     自分のデックが空になると他のスレッドのデックの末尾からタイルを盗む。
+        // EN: Per-thread tile deques. Each thread processes tiles of a contiguous range of the image from the front,
+        //     and steals tiles from the back of another thread's deque when its own deque becomes empty.
+        class WorkStealingTileScheduler {
+            struct TileDeque {
+                std::mutex mutex;
+                std::deque<uint32_t> tiles;
+            };
+
+            std::vector<std::unique_ptr<TileDeque>> m_deques;
+
+        public:
+            WorkStealingTileScheduler(uint32_t numThreads, uint32_t numTiles) {
+                m_deques.resize(numThreads);
+                for (uint32_t i = 0; i < numThreads; ++i) {
+                    m_deques[i].reset(new TileDeque());
+                    uint32_t beginTile = (uint64_t)numTiles * i / numThreads;
+                    uint32_t endTile = (uint64_t)numTiles * (i + 1) / numThreads;
+                    for (uint32_t tileIndex = beginTile; tileIndex < endTile; ++tileIndex)
+                        m_deques[i]->tiles.push_back(tileIndex);
+                }
+            }
+
+            // JP: タイルが残っていなければfalseを返す。処理中にタイルが追加されることはないので、その時点でスレッドは終了してよい。
+            // EN: Return false if no tile remains. Tiles are never added during processing, so the thread can finish at that point.
+            bool pop(uint32_t threadIndex, uint32_t* tileIndex, bool* stolen) {
+                {
+                    TileDeque &own = *m_deques[threadIndex];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (!own.tiles.empty()) {
+                        *tileIndex = own.tiles.front();
+                        own.tiles.pop_front();
+                        *stolen = false;
+                        return true;
+                    }
+                }
+
+                uint32_t numThreads = (uint32_t)m_deques.size();
+                for (uint32_t i = 1; i < numThreads; ++i) {
+                    TileDeque &victim = *m_deques[(threadIndex + i) % numThreads];
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (!victim.tiles.empty()) {
+                        *tileIndex = victim.tiles.back();
+                        victim.tiles.pop_back();
+                        *stolen = true;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+        };
+
+        // JP: フレームとタイルから乱数のシードを決める。どのスレッドがタイルを処理しても結果が変わらない。
+        // EN: Determine a seed of random numbers from a frame and a tile. The result doesn't depend on which thread processes the tile.
+        static uint64_t calcTileSeed(uint64_t frameIndex, uint32_t tileIndex) {
+            // SplitMix64
+            uint64_t z = frameIndex * 0x9E3779B97F4A7C15ULL + tileIndex + 591842031321323413ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        void Renderer::render(VLR::Scene &scene, const optix::uint2 &imageSize, uint32_t numAccumFrames, bool firstFrame) {
+            Backend::Context optixContext = m_context.getOptiXContext();
+
+            ResourceResolver resolver(optixContext, &m_context.getTileCache());
+
+            // JP: シーンの変更イベントでルートノードの加速構造が再構築または再フィットされた場合もインスタンスを取り直す。
+            // EN: Also re-collect the instances when the acceleration structure of the root node has been rebuilt or refitted
+            //     by change events of the scene.
+            bool acceleratorUpdated = scene.updateHostAccelerator();
+            if (firstFrame || acceleratorUpdated) {
+                setupScene(scene, resolver);
+            }
+            else {
+                // JP: マップされたアドレスはレンダリングごとに変わりうる。
+                // EN: Mapped addresses may change for each rendering.
+                for (uint32_t i = 0; i < m_scene.getNumInstances(); ++i) {
+                    GeometryInstance &inst = m_scene.getInstance(i);
+                    inst.vertexBuffer = resolver.mapBuffer(inst.vertexBufferID);
+                    inst.triangleBuffer = resolver.mapBuffer(inst.triangleBufferID);
+                }
+            }
+
+            KernelParameters params;
+            params.programs = m_programs.data();
+            params.numPrograms = (uint32_t)m_programs.size();
+
+            params.nodeProcedureSetBuffer = resolver.mapBuffer(optixContext["VLR::pv_nodeProcedureSetBuffer"]->getBuffer());
+            params.nodeDescriptorBuffer = resolver.mapBuffer(optixContext["VLR::pv_nodeDescriptorBuffer"]->getBuffer());
+            params.spectrumNodeDescriptorBuffer = resolver.mapBuffer(optixContext["VLR::pv_spectrumNodeDescriptorBuffer"]->getBuffer());
+            params.bsdfProcedureSetBuffer = resolver.mapBuffer(optixContext["VLR::pv_bsdfProcedureSetBuffer"]->getBuffer());
+            params.edfProcedureSetBuffer = resolver.mapBuffer(optixContext["VLR::pv_edfProcedureSetBuffer"]->getBuffer());
+            params.materialDescriptorBuffer = resolver.mapBuffer(optixContext["VLR::pv_materialDescriptorBuffer"]->getBuffer());
+
+            params.topGroup = &m_scene;
+            optixContext["VLR::pv_lightImpDist"]->getUserData(sizeof(params.lightImpDist), &params.lightImpDist);
+            params.surfaceLightDescriptorBuffer = resolver.mapBuffer(optixContext["VLR::pv_surfaceLightDescriptorBuffer"]->getBuffer());
+            optixContext["VLR::pv_envLightDescriptor"]->getUserData(sizeof(params.envLightDescriptor), &params.envLightDescriptor);
+
+            if (Backend::Variable var = optixContext->queryVariable("VLR::pv_perspectiveCamera"))
+                var->getUserData(sizeof(params.perspectiveCamera), &params.perspectiveCamera);
+            if (Backend::Variable var = optixContext->queryVariable("VLR::pv_equirectangularCamera"))
+                var->getUserData(sizeof(params.equirectangularCamera), &params.equirectangularCamera);
+            params.progSampleLensPosition = optixContext["VLR::pv_progSampleLensPosition"]->getProgram()->getId();
+            params.progSampleIDF = optixContext["VLR::pv_progSampleIDF"]->getProgram()->getId();
+
+            params.imageSize = imageSize;
+            params.numAccumFrames = numAccumFrames;
+            params.outputBuffer = resolver.mapBuffer(optixContext["VLR::pv_outputBuffer"]->getBuffer(), RT_BUFFER_MAP_READ_WRITE);
+            params.compactOutputBuffer = resolver.mapBuffer(optixContext["VLR::pv_compactOutputBuffer"]->getBuffer(), RT_BUFFER_MAP_READ_WRITE);
+            optixContext["VLR::pv_accumulationFormat"]->getUserData(sizeof(params.accumulationFormat), &params.accumulationFormat);
+            params.pixelStatisticsBuffer = resolver.mapBuffer(optixContext["VLR::pv_pixelStatisticsBuffer"]->getBuffer(), RT_BUFFER_MAP_READ_WRITE);
+            optixContext["VLR::pv_adaptiveSampling"]->getUserData(sizeof(params.adaptiveSampling), &params.adaptiveSampling);
+
+            BufferRef rgbBuffer = resolver.mapBuffer(optixContext["VLR::pv_RGBBuffer"]->getBuffer(), RT_BUFFER_MAP_READ_WRITE);
+
+            // JP: 画像をタイルに分割し、ワークスティーリングで各スレッドに割り当てる。
+            //     ウェーブフロント積分器ではタイル内のパスがまとめて処理されるので、マテリアルごとのキューが十分な長さになるよう大きなタイルを使う。
+            // EN: Divide the image into tiles, and assign them to threads with work stealing.
+            //     The wavefront integrator processes paths in a tile together, so use larger tiles to make per-material queues long enough.
+            const bool useWavefront = m_integrator == VLRCPUIntegrator_Wavefront;
+            const VLRRenderingMode renderingMode = m_context.getRenderingMode();
+            const uint32_t DefaultTileSize = useWavefront ? 64 : 16;
+            const uint32_t tileWidth = m_tileWidth > 0 ? m_tileWidth : DefaultTileSize;
+            const uint32_t tileHeight = m_tileHeight > 0 ? m_tileHeight : DefaultTileSize;
+            const uint32_t numTilesX = (imageSize.x + tileWidth - 1) / tileWidth;
+            const uint32_t numTilesY = (imageSize.y + tileHeight - 1) / tileHeight;
+            const uint32_t numTiles = numTilesX * numTilesY;
+            WorkStealingTileScheduler scheduler(m_numThreads, numTiles);
+            const uint64_t frameIndex = m_frameIndex++;
+
+            if (firstFrame || m_threadStatistics.size() != m_numThreads)
+                m_threadStatistics.assign(m_numThreads, ThreadStatistics());
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            std::vector<ThreadStatistics> frameStatistics(m_numThreads);
+
+            // JP: 隣り合うスレッドの統計が同じキャッシュラインに載るので、タイルごとの集計はローカル変数で行い最後に1回だけ書き込む。
+            // EN: Statistics of adjacent threads are on the same cache line, so tally per tile in local variables and write them only once at the end.
+            std::function<void(uint32_t)> processTiles = [&](uint32_t threadIndex) {
+                bindResolver(&resolver);
+
+                ThreadStatistics stats;
+                uint32_t tileIndex;
+                bool stolen;
+                while (scheduler.pop(threadIndex, &tileIndex, &stolen)) {
+                    auto tileStartTime = std::chrono::high_resolution_clock::now();
+
+                    uint32_t tileX = tileIndex % numTilesX;
+                    uint32_t tileY = tileIndex / numTilesX;
+                    optix::uint2 minIndex = optix::make_uint2(tileX * tileWidth, tileY * tileHeight);
+                    optix::uint2 maxIndex = optix::make_uint2(std::min(minIndex.x + tileWidth, imageSize.x),
+                                                              std::min(minIndex.y + tileHeight, imageSize.y));
+
+                    uint64_t rngSeed = calcTileSeed(frameIndex, tileIndex);
+                    if (useWavefront)
+                        m_kernels.wavefrontPathTracing(params, minIndex, maxIndex, rngSeed);
+                    else
+                        m_kernels.pathTracing(params, minIndex, maxIndex, rngSeed);
+                    convertToRGB(renderingMode, params.accumulationFormat, params.outputBuffer, params.compactOutputBuffer, params.pixelStatisticsBuffer, rgbBuffer,
+                                 minIndex, maxIndex);
+
+                    auto tileEndTime = std::chrono::high_resolution_clock::now();
+                    stats.busyTime += std::chrono::duration_cast<std::chrono::microseconds>(tileEndTime - tileStartTime).count() * 1e-3f;
+                    ++stats.numTiles;
+                    if (stolen)
+                        ++stats.numStolenTiles;
+                }
+                frameStatistics[threadIndex] = stats;
+
+                bindResolver(nullptr);
+            };
+
+            m_workerPool->run(processTiles);
+
+            // JP: フレーム全体の時間のうちタイルを処理していなかった時間をアイドル時間とする。
+            // EN: Regard the time not processing tiles out of the whole frame time as idle time.
+            auto endTime = std::chrono::high_resolution_clock::now();
+            float frameTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() * 1e-3f;
+            for (uint32_t i = 0; i < m_numThreads; ++i) {
+                const ThreadStatistics &stats = frameStatistics[i];
+                m_threadStatistics[i].busyTime += stats.busyTime;
+                m_threadStatistics[i].idleTime += std::max(frameTime - stats.busyTime, 0.0f);
+                m_threadStatistics[i].numTiles += stats.numTiles;
+                m_threadStatistics[i].numStolenTiles += stats.numStolenTiles;
+            }
+        }
+
+        void Renderer::resolve(const optix::uint2 &imageSize) {
+            Backend::Context optixContext = m_context.getOptiXContext();
+
+            ResourceResolver resolver(optixContext, &m_context.getTileCache());
+            BufferRef spectrumBuffer = resolver.mapBuffer(optixContext["VLR::pv_outputBuffer"]->getBuffer());
+            BufferRef compactBuffer = resolver.mapBuffer(optixContext["VLR::pv_compactOutputBuffer"]->getBuffer());
+            BufferRef pixelStatisticsBuffer = resolver.mapBuffer(optixContext["VLR::pv_pixelStatisticsBuffer"]->getBuffer());
+            BufferRef rgbBuffer = resolver.mapBuffer(optixContext["VLR::pv_RGBBuffer"]->getBuffer(), RT_BUFFER_MAP_READ_WRITE);
+            VLRAccumulationFormat accumulationFormat;
+            optixContext["VLR::pv_accumulationFormat"]->getUserData(sizeof(accumulationFormat), &accumulationFormat);
+            convertToRGB(m_context.getRenderingMode(), accumulationFormat, spectrumBuffer, compactBuffer, pixelStatisticsBuffer, rgbBuffer, optix::make_uint2(0, 0), imageSize);
+        }
+    }
+}
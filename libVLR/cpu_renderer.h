@@ -0,0 +1,224 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+#include "cpu_traversal.h"
+
+namespace VLR {
+    class Context;
+    class Scene;
+
+    namespace CPU {
+        typedef void (*GenericProgram)();
+
+
+
+        // JP: マップされたホストのコンテキストのバッファーのメモリ上の範囲。
+        // EN: The memory range of a mapped buffer of the host context.
+        struct BufferRef {
+            void* data;
+            uint32_t width;
+            uint32_t height;
+
+            BufferRef() : data(nullptr), width(0), height(0) {}
+            BufferRef(void* _data, uint32_t _width, uint32_t _height) : data(_data), width(_width), height(_height) {}
+        };
+
+
+
+        // JP: ホストのコンテキストのGeometryInstanceに設定された変数のコピー。
+        // EN: Copy of variables set to a GeometryInstance of the host context.
+        struct GeometryInstance {
+            int32_t vertexBufferID;
+            int32_t triangleBufferID;
+            BufferRef vertexBuffer;
+            BufferRef triangleBuffer;
+            float sumImportances;
+            int32_t progDecodeTexCoord;
+            int32_t progDecodeHitPoint;
+            Shared::TangentType tangentType;
+            Shared::ShaderNodeSocketID nodeNormal;
+            Shared::ShaderNodeSocketID nodeAlpha;
+            uint32_t materialIndex;
+            float importance;
+            Shared::StaticTransform objectToWorld;
+            Shared::StaticTransform worldToObject;
+        };
+
+
+
+        // JP: カーネルから参照されるシーン。加速構造はシーン階層のルートノードが持つものを参照する。
+        //     インスタンスはTLASのinstIndexの順に並ぶ。
+        // EN: Scene referenced by the kernels. Refers to the acceleration structure held by the root node of the scene hierarchy.
+        //     Instances are in the order of instIndex of the TLAS.
+        class Scene {
+            std::vector<GeometryInstance> m_instances;
+            const InstanceAccelerator* m_accelerator;
+            bool m_hasAlphaInstances;
+
+        public:
+            Scene() : m_accelerator(nullptr), m_hasAlphaInstances(false) {}
+
+            void setup(const InstanceAccelerator* accelerator, std::vector<GeometryInstance> &&instances) {
+                m_accelerator = accelerator;
+                m_instances = std::move(instances);
+                m_hasAlphaInstances = false;
+                for (const GeometryInstance &inst : m_instances)
+                    m_hasAlphaInstances |= inst.nodeAlpha.isValid();
+            }
+
+            GeometryInstance &getInstance(uint32_t index) {
+                return m_instances[index];
+            }
+            const GeometryInstance &getInstance(uint32_t index) const {
+                return m_instances[index];
+            }
+            uint32_t getNumInstances() const {
+                return (uint32_t)m_instances.size();
+            }
+
+            const InstanceAccelerator &getAccelerator() const {
+                VLRAssert(m_accelerator, "Scene is not set up.");
+                return *m_accelerator;
+            }
+            // JP: アルファテストを行うインスタンスが無ければAny Hitプログラムを呼ばずにトレースできる。
+            // EN: Rays can be traced without calling any hit programs if no instance performs alpha testing.
+            bool hasAlphaInstances() const {
+                return m_hasAlphaInstances;
+            }
+        };
+
+
+
+        // JP: カーネルから参照されるコンテキストスコープの変数。
+        // EN: Context-scope variables referenced by the kernels.
+        struct KernelParameters {
+            const GenericProgram* programs;
+            uint32_t numPrograms;
+
+            BufferRef nodeProcedureSetBuffer;
+            BufferRef nodeDescriptorBuffer;
+            BufferRef spectrumNodeDescriptorBuffer;
+            BufferRef bsdfProcedureSetBuffer;
+            BufferRef edfProcedureSetBuffer;
+            BufferRef materialDescriptorBuffer;
+
+            const Scene* topGroup;
+            Shared::DiscreteDistribution1D lightImpDist;
+            BufferRef surfaceLightDescriptorBuffer;
+            Shared::SurfaceLightDescriptor envLightDescriptor;
+
+            Shared::PerspectiveCamera perspectiveCamera;
+            Shared::EquirectangularCamera equirectangularCamera;
+            int32_t progSampleLensPosition;
+            int32_t progSampleIDF;
+
+            optix::uint2 imageSize;
+            uint32_t numAccumFrames;
+            BufferRef outputBuffer;
+            BufferRef compactOutputBuffer;
+            VLRAccumulationFormat accumulationFormat;
+            BufferRef pixelStatisticsBuffer;
+            Shared::AdaptiveSamplingParameters adaptiveSampling;
+
+            KernelParameters() {}
+        };
+
+        // JP: レンダリングモードごとにコンパイルされたカーネルの入口。
+        // EN: Entry points of the kernels compiled per rendering mode.
+        struct KernelSet {
+            // JP: 名前(例: "VLR::pathTracingIteration")に対応するホスト関数を取得する。
+            //     対応するものが無い場合はnullptrを返す。
+            // EN: get the host function corresponding to a name (e.g. "VLR::pathTracingIteration").
+            //     returns nullptr if there is no corresponding one.
+            GenericProgram (*findProgram)(const std::string &name);
+            // JP: 指定した矩形領域の画素に対してパストレーシングを1サンプル分実行する。
+            //     乱数はpv_rngBufferではなく、rngSeedで初期化した呼び出し固有の状態から生成する。
+            // EN: execute path tracing for one sample per pixel in the specified rectangle.
+            //     Random numbers are generated from a per-call state initialized with rngSeed instead of pv_rngBuffer.
+            void (*pathTracing)(const KernelParameters &params, const optix::uint2 &minIndex, const optix::uint2 &maxIndex, uint64_t rngSeed);
+            // JP: pathTracing()と同じ結果をウェーブフロント方式で計算する。
+            //     矩形内の全パスのレイをまとめてトレースし、ヒットをマテリアルごとにまとめてシェーディングする。
+            // EN: Compute the same result as pathTracing() in the wavefront manner.
+            //     Rays of all paths in the rectangle are traced together, and hits are shaded grouped by material.
+            void (*wavefrontPathTracing)(const KernelParameters &params, const optix::uint2 &minIndex, const optix::uint2 &maxIndex, uint64_t rngSeed);
+        };
+
+        // JP: CPU_kernels/kernels.cppとkernels_spectral.cppでそれぞれ定義される。
+        // EN: Defined in CPU_kernels/kernels.cpp and kernels_spectral.cpp respectively.
+        const KernelSet &getRGBKernelSet();
+        const KernelSet &getSpectralKernelSet();
+
+
+
+        // JP: レンダリングスレッドごとの統計情報。時間の単位はミリ秒。
+        // EN: Statistics per rendering thread. The unit of time is milliseconds.
+        struct ThreadStatistics {
+            float busyTime;
+            float idleTime;
+            uint32_t numTiles;
+            uint32_t numStolenTiles;
+
+            ThreadStatistics() : busyTime(0.0f), idleTime(0.0f), numTiles(0), numStolenTiles(0) {}
+        };
+
+
+
+        class ResourceResolver;
+        class WorkerPool;
+
+        class Renderer {
+            Context &m_context;
+            const KernelSet &m_kernels;
+            uint32_t m_numThreads;
+            VLRCPUIntegrator m_integrator;
+            uint32_t m_tileWidth;
+            uint32_t m_tileHeight;
+            uint64_t m_frameIndex;
+            std::vector<ThreadStatistics> m_threadStatistics;
+            // JP: レンダラーの寿命の間、m_numThreads - 1個のスレッドを保持して各フレームで再利用する。
+            // EN: Holds m_numThreads - 1 threads for the lifetime of the renderer, and reuses them in each frame.
+            std::unique_ptr<WorkerPool> m_workerPool;
+            std::vector<GenericProgram> m_programs;
+            Scene m_scene;
+            BVHStatistics m_bvhStatistics;
+
+            void setupScene(VLR::Scene &scene, ResourceResolver &resolver);
+
+        public:
+            Renderer(Context &context);
+            ~Renderer();
+
+            void registerProgram(int32_t programID, const std::string &name);
+            void setIntegrator(VLRCPUIntegrator integrator) {
+                m_integrator = integrator;
+            }
+            // JP: 0の場合は積分器ごとの既定の大きさを使う。
+            // EN: Use the default size for each integrator in the case of 0.
+            void setTileSize(uint32_t width, uint32_t height) {
+                m_tileWidth = width;
+                m_tileHeight = height;
+            }
+
+            void render(VLR::Scene &scene, const optix::uint2 &imageSize, uint32_t numAccumFrames, bool firstFrame);
+            // JP: レンダリングせずに出力バッファーの蓄積値をRGBに変換する。
+            // EN: Convert the accumulated values of the output buffer to RGB without rendering.
+            void resolve(const optix::uint2 &imageSize);
+
+            // JP: 最初のフレームでシーンを準備した際のもの。
+            // EN: The one when setting up the scene at the first frame.
+            const BVHStatistics &getBVHStatistics() const {
+                return m_bvhStatistics;
+            }
+            // JP: タイルごとの乱数のシードの元になる。コンテキストがフレームごとにサンプル番号を与える。
+            // EN: Source of the random number seed per tile. The context gives a sample index per frame.
+            void setFrameIndex(uint64_t frameIndex) {
+                m_frameIndex = frameIndex;
+            }
+            // JP: 最初のフレームからの累積値。
+            // EN: Accumulated values since the first frame.
+            const std::vector<ThreadStatistics> &getThreadStatistics() const {
+                return m_threadStatistics;
+            }
+        };
+    }
+}
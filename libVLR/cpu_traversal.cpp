@@ -0,0 +1,672 @@
+﻿#include "cpu_traversal.h"
+
+#include <thread>
+#include <atomic>
+#include <set>
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+namespace VLR {
+    namespace CPU {
+        bool isAVX2Available() {
+#if defined(_MSC_VER)
+            int32_t info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+
+            __cpuid(info, 1);
+            bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+            bool hasAVX = (info[2] & (1 << 28)) != 0;
+            bool hasFMA = (info[2] & (1 << 12)) != 0;
+            if (!hasOSXSAVE || !hasAVX || !hasFMA)
+                return false;
+
+            // JP: OSがYMMレジスターの状態を保存するかを確認する。
+            // EN: Check if the OS saves the states of YMM registers.
+            if ((_xgetbv(0) & 0x6) != 0x6)
+                return false;
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        }
+
+        bool isF16CAvailable() {
+#if defined(_MSC_VER)
+            int32_t info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 29)) != 0;
+#else
+            return __builtin_cpu_supports("f16c");
+#endif
+        }
+
+        static const bool s_useAVX2 = isAVX2Available();
+
+
+
+        uint32_t TriangleAccelerator::collapse(const std::vector<BVH::Node> &binaryNodes, uint32_t binaryNodeIdx) {
+            // JP: 子の数が幅に達するまで、表面積が最大の中間ノードの子をその子で置き換える。
+            // EN: Replace the inner child with the largest surface area with its children until the number of children reaches the width.
+            uint32_t children[Width];
+            uint32_t numChildren;
+            const BVH::Node &binaryNode = binaryNodes[binaryNodeIdx];
+            if (binaryNode.numPrimitives > 0) {
+                children[0] = binaryNodeIdx;
+                numChildren = 1;
+            }
+            else {
+                children[0] = binaryNodeIdx + 1;
+                children[1] = binaryNode.offset;
+                numChildren = 2;
+                while (numChildren < Width) {
+                    int32_t slotToOpen = -1;
+                    float maxArea = -1.0f;
+                    for (uint32_t slot = 0; slot < numChildren; ++slot) {
+                        const BVH::Node &child = binaryNodes[children[slot]];
+                        if (child.numPrimitives > 0)
+                            continue;
+                        float area = child.bbox.surfaceArea();
+                        if (area > maxArea) {
+                            maxArea = area;
+                            slotToOpen = slot;
+                        }
+                    }
+                    if (slotToOpen < 0)
+                        break;
+
+                    uint32_t childIdx = children[slotToOpen];
+                    children[slotToOpen] = childIdx + 1;
+                    children[numChildren++] = binaryNodes[childIdx].offset;
+                }
+            }
+
+            uint32_t nodeIdx = (uint32_t)m_nodes.size();
+            m_nodes.emplace_back();
+            {
+                WideNode &node = m_nodes[nodeIdx];
+                node.numChildren = numChildren;
+                for (uint32_t slot = 0; slot < Width; ++slot) {
+                    // JP: 空きスロットには決して交差しない空のAABBを入れておく。
+                    // EN: Put an empty AABB that never intersects into an unused slot.
+                    BoundingBox3D bbox = slot < numChildren ? binaryNodes[children[slot]].bbox : BoundingBox3D();
+                    for (int dim = 0; dim < 3; ++dim) {
+                        node.bounds[dim][slot] = bbox.minP[dim];
+                        node.bounds[dim + 3][slot] = bbox.maxP[dim];
+                    }
+                    node.children[slot] = 0;
+                    node.numTriangles[slot] = 0;
+                }
+            }
+
+            for (uint32_t slot = 0; slot < numChildren; ++slot) {
+                const BVH::Node &child = binaryNodes[children[slot]];
+                uint32_t childRef;
+                if (child.numPrimitives > 0)
+                    childRef = child.offset;
+                else
+                    childRef = collapse(binaryNodes, children[slot]);
+                // JP: 再帰呼び出しでm_nodesが再確保されうるので、ここで改めて参照を取る。
+                // EN: Take the reference again here since the recursive call can reallocate m_nodes.
+                WideNode &node = m_nodes[nodeIdx];
+                node.children[slot] = childRef;
+                node.numTriangles[slot] = child.numPrimitives;
+            }
+
+            return nodeIdx;
+        }
+
+        void TriangleAccelerator::build(std::vector<Triangle> &&triangles, uint32_t numThreads) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+
+            m_triangles.clear();
+            m_triangleIndices.clear();
+            m_nodes.clear();
+            m_bbox = BoundingBox3D();
+            m_builtSAHCost = 0.0f;
+            m_statistics = BVHStatistics();
+
+            if (triangles.empty())
+                return;
+
+            std::vector<BoundingBox3D> primBBoxes(triangles.size());
+            for (uint32_t i = 0; i < triangles.size(); ++i) {
+                const Triangle &tri = triangles[i];
+                primBBoxes[i] = BoundingBox3D(tri.p0);
+                primBBoxes[i].unify(tri.p1);
+                primBBoxes[i].unify(tri.p2);
+                m_bbox.unify(primBBoxes[i]);
+            }
+
+            BVH bvh;
+            bvh.build(primBBoxes, numThreads);
+
+            // JP: 葉ノードから連続して参照できるように三角形を並び替える。
+            // EN: Reorder triangles so that leaf nodes can reference them contiguously.
+            m_triangleIndices = bvh.getPrimitiveIndices();
+            m_triangles.resize(triangles.size());
+            for (uint32_t i = 0; i < m_triangleIndices.size(); ++i)
+                m_triangles[i] = triangles[m_triangleIndices[i]];
+            triangles.clear();
+
+            const std::vector<BVH::Node> &binaryNodes = bvh.getNodes();
+            m_nodes.reserve(binaryNodes.size() / 4 + 1);
+            collapse(binaryNodes, 0);
+            m_builtSAHCost = calcSAHCost();
+
+            // JP: 統計情報は畳み込み前の二分木のもの。構築時間は畳み込みを含む。
+            // EN: Statistics are of the binary tree before collapsing. The build time includes collapsing.
+            m_statistics = bvh.getStatistics();
+            auto endTime = std::chrono::high_resolution_clock::now();
+            m_statistics.buildTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() * 1e-3f;
+        }
+
+        float TriangleAccelerator::calcSAHCost() const {
+            float rootArea = m_bbox.surfaceArea();
+            float cost = 0.0f;
+            for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+                const WideNode &node = *it;
+                BoundingBox3D nodeBBox;
+                for (uint32_t slot = 0; slot < node.numChildren; ++slot) {
+                    BoundingBox3D childBBox(Point3D(node.bounds[0][slot], node.bounds[1][slot], node.bounds[2][slot]),
+                                            Point3D(node.bounds[3][slot], node.bounds[4][slot], node.bounds[5][slot]));
+                    nodeBBox.unify(childBBox);
+                    if (node.numTriangles[slot] > 0)
+                        cost += BVH::IntersectionCost * node.numTriangles[slot] * (rootArea > 0.0f ? childBBox.surfaceArea() / rootArea : 1.0f);
+                }
+                cost += BVH::TraversalCost * (rootArea > 0.0f ? nodeBBox.surfaceArea() / rootArea : 1.0f);
+            }
+            return cost;
+        }
+
+        bool TriangleAccelerator::update(std::vector<Triangle> &&triangles, uint32_t numThreads) {
+            if (triangles.size() != m_triangles.size() || m_nodes.empty()) {
+                build(std::move(triangles), numThreads);
+                return true;
+            }
+
+            m_bbox = BoundingBox3D();
+            for (uint32_t i = 0; i < m_triangles.size(); ++i) {
+                Triangle &tri = m_triangles[i];
+                tri = triangles[m_triangleIndices[i]];
+                m_bbox.unify(tri.p0);
+                m_bbox.unify(tri.p1);
+                m_bbox.unify(tri.p2);
+            }
+
+            // JP: 子ノードは常に親より後ろに配置されているので、逆順に辿れば子が先に更新される。
+            // EN: Child nodes are always placed after their parent, so traversing in reverse order updates children first.
+            for (int32_t nodeIdx = (int32_t)m_nodes.size() - 1; nodeIdx >= 0; --nodeIdx) {
+                WideNode &node = m_nodes[nodeIdx];
+                for (uint32_t slot = 0; slot < node.numChildren; ++slot) {
+                    BoundingBox3D bbox;
+                    if (node.numTriangles[slot] > 0) {
+                        for (uint32_t i = 0; i < node.numTriangles[slot]; ++i) {
+                            const Triangle &tri = m_triangles[node.children[slot] + i];
+                            bbox.unify(tri.p0);
+                            bbox.unify(tri.p1);
+                            bbox.unify(tri.p2);
+                        }
+                    }
+                    else {
+                        const WideNode &child = m_nodes[node.children[slot]];
+                        for (uint32_t childSlot = 0; childSlot < child.numChildren; ++childSlot) {
+                            bbox.unify(BoundingBox3D(Point3D(child.bounds[0][childSlot], child.bounds[1][childSlot], child.bounds[2][childSlot]),
+                                                     Point3D(child.bounds[3][childSlot], child.bounds[4][childSlot], child.bounds[5][childSlot])));
+                        }
+                    }
+                    for (int dim = 0; dim < 3; ++dim) {
+                        node.bounds[dim][slot] = bbox.minP[dim];
+                        node.bounds[dim + 3][slot] = bbox.maxP[dim];
+                    }
+                }
+            }
+
+            if (calcSAHCost() > MaxRefitSAHCostRatio * m_builtSAHCost) {
+                build(std::move(triangles), numThreads);
+                return true;
+            }
+
+            return false;
+        }
+
+
+
+        static bool intersectScalar(const TriangleAccelerator &accel, const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                                    AnyHitCallback anyHit, void* userData, RayHit* hit) {
+            typedef TriangleAccelerator::StackEntry StackEntry;
+            const std::vector<TriangleAccelerator::WideNode> &nodes = accel.getNodes();
+            const std::vector<Triangle> &triangles = accel.getTriangles();
+
+            WatertightRay wtRay(org, dir);
+            Vector3D invDir(safeInverse(dir.x), safeInverse(dir.y), safeInverse(dir.z));
+            uint32_t nearIdx[3], farIdx[3];
+            for (int dim = 0; dim < 3; ++dim) {
+                nearIdx[dim] = invDir[dim] >= 0.0f ? dim : dim + 3;
+                farIdx[dim] = invDir[dim] >= 0.0f ? dim + 3 : dim;
+            }
+
+            bool hitFound = false;
+            StackEntry stack[TriangleAccelerator::StackSize];
+            uint32_t stackIdx = 0;
+            stack[stackIdx++] = StackEntry{ 0, 0, tmin };
+            while (stackIdx > 0) {
+                StackEntry entry = stack[--stackIdx];
+                if (entry.tNear > tmax)
+                    continue;
+
+                if (entry.numTriangles > 0) {
+                    for (uint32_t i = 0; i < entry.numTriangles; ++i) {
+                        const Triangle &tri = triangles[entry.index + i];
+                        float t, b1, b2;
+                        if (!testRayVsTriangle(wtRay, tri, tmin, tmax, &t, &b1, &b2))
+                            continue;
+
+                        AnyHitResult res = anyHit ? anyHit(userData, tri, t, b1, b2) : AnyHitResult::Accept;
+                        if (res == AnyHitResult::Ignore)
+                            continue;
+
+                        tmax = t;
+                        hit->t = t;
+                        hit->b1 = b1;
+                        hit->b2 = b2;
+                        hit->instIndex = tri.instIndex;
+                        hit->primIndex = tri.primIndex;
+                        hitFound = true;
+                        if (res == AnyHitResult::AcceptAndTerminate)
+                            return true;
+                    }
+                    continue;
+                }
+
+                const TriangleAccelerator::WideNode &node = nodes[entry.index];
+                StackEntry hitChildren[TriangleAccelerator::Width];
+                uint32_t numHitChildren = 0;
+                for (uint32_t c = 0; c < node.numChildren; ++c) {
+                    float tNear = tmin;
+                    float tFar = INFINITY;
+                    for (int dim = 0; dim < 3; ++dim) {
+                        tNear = std::max(tNear, (node.bounds[nearIdx[dim]][c] - org[dim]) * invDir[dim]);
+                        tFar = std::min(tFar, (node.bounds[farIdx[dim]][c] - org[dim]) * invDir[dim]);
+                    }
+                    tFar = std::min(tFar * RobustFarScale, tmax);
+                    if (tNear <= tFar)
+                        hitChildren[numHitChildren++] = StackEntry{ node.children[c], node.numTriangles[c], tNear };
+                }
+                TriangleAccelerator::pushChildren(stack, &stackIdx, hitChildren, numHitChildren);
+            }
+
+            return hitFound;
+        }
+
+        bool TriangleAccelerator::intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                                            AnyHitCallback anyHit, void* userData, RayHit* hit) const {
+            if (m_nodes.empty())
+                return false;
+
+            if (s_useAVX2)
+                return AVX2::intersect(*this, org, dir, tmin, tmax, anyHit, userData, hit);
+            return intersectScalar(*this, org, dir, tmin, tmax, anyHit, userData, hit);
+        }
+
+        void TriangleAccelerator::intersectPacket(const Ray* rays, uint32_t numRays, RayHit* hits) const {
+            VLRAssert(numRays <= MaxNumRaysInPacket, "Too many rays in a packet: %u", numRays);
+            if (m_nodes.empty()) {
+                for (uint32_t i = 0; i < numRays; ++i)
+                    hits[i].instIndex = InvalidIndex;
+                return;
+            }
+
+            if (s_useAVX2) {
+                AVX2::intersectPacket(*this, rays, numRays, hits);
+                return;
+            }
+
+            for (uint32_t i = 0; i < numRays; ++i) {
+                const Ray &ray = rays[i];
+                if (!intersectScalar(*this, ray.org, ray.dir, ray.tmin, ray.tmax, nullptr, nullptr, &hits[i]))
+                    hits[i].instIndex = InvalidIndex;
+            }
+        }
+
+        // JP: 大量のレイを固定数ごとのタスクに分け、各スレッドがアトミックなカウンターからタスクを取って8本ずつ処理する。
+        // EN: Split a large number of rays into tasks of a fixed number of rays, and each thread takes tasks from an atomic counter to process 8 rays at a time.
+        template <typename PacketFunction>
+        static void intersectInPackets(uint32_t numRays, uint32_t numThreads, const PacketFunction &intersectPacket) {
+            const uint32_t NumRaysPerTask = 1024;
+            uint32_t numTasks = (numRays + NumRaysPerTask - 1) / NumRaysPerTask;
+            if (numThreads == 0)
+                numThreads = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+            numThreads = std::min(numThreads, numTasks);
+
+            std::atomic<uint32_t> taskCounter(0);
+            auto worker = [numRays, numTasks, &intersectPacket, &taskCounter]() {
+                const uint32_t NumRaysInPacket = TriangleAccelerator::MaxNumRaysInPacket;
+                while (true) {
+                    uint32_t taskIdx = taskCounter.fetch_add(1);
+                    if (taskIdx >= numTasks)
+                        break;
+                    uint32_t start = taskIdx * NumRaysPerTask;
+                    uint32_t end = std::min(start + NumRaysPerTask, numRays);
+                    for (uint32_t i = start; i < end; i += NumRaysInPacket)
+                        intersectPacket(i, std::min(NumRaysInPacket, end - i));
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (uint32_t i = 1; i < numThreads; ++i)
+                threads.emplace_back(worker);
+            worker();
+            for (auto &thread : threads)
+                thread.join();
+        }
+
+        void TriangleAccelerator::intersect(const Ray* rays, uint32_t numRays, RayHit* hits, uint32_t numThreads) const {
+            intersectInPackets(numRays, numThreads, [this, rays, hits](uint32_t start, uint32_t num) {
+                intersectPacket(rays + start, num, hits + start);
+            });
+        }
+
+
+
+        static inline bool intersectAABB(const BoundingBox3D &bbox, const Point3D &org, const Vector3D &invDir, float tmin, float tmax, float* tNear) {
+            float t0 = tmin;
+            float t1 = INFINITY;
+            for (int dim = 0; dim < 3; ++dim) {
+                float tA = (bbox.minP[dim] - org[dim]) * invDir[dim];
+                float tB = (bbox.maxP[dim] - org[dim]) * invDir[dim];
+                t0 = std::max(t0, std::min(tA, tB));
+                t1 = std::min(t1, std::max(tA, tB));
+            }
+            t1 = std::min(t1 * RobustFarScale, tmax);
+            *tNear = t0;
+            return t0 <= t1;
+        }
+
+        static BoundingBox3D calcWorldBoundingBox(const InstanceAccelerator::Instance &inst) {
+            const BoundingBox3D &bbox = inst.blas->getBoundingBox();
+            BoundingBox3D worldBBox;
+            for (int i = 0; i < 8; ++i) {
+                Point3D corner((i & 0x1) ? bbox.maxP.x : bbox.minP.x,
+                               (i & 0x2) ? bbox.maxP.y : bbox.minP.y,
+                               (i & 0x4) ? bbox.maxP.z : bbox.minP.z);
+                worldBBox.unify(inst.objectToWorld * corner);
+            }
+            return worldBBox;
+        }
+
+        void InstanceAccelerator::updateStatistics() {
+            m_statistics = m_bvh.getStatistics();
+
+            std::set<const TriangleAccelerator*> uniqueBLASes;
+            for (auto it = m_instances.cbegin(); it != m_instances.cend(); ++it)
+                uniqueBLASes.insert(it->blas);
+            uint32_t maxBLASDepth = 0;
+            for (auto it = uniqueBLASes.cbegin(); it != uniqueBLASes.cend(); ++it) {
+                const BVHStatistics &blasStats = (*it)->getStatistics();
+                m_statistics.numNodes += blasStats.numNodes;
+                m_statistics.numLeafNodes += blasStats.numLeafNodes;
+                maxBLASDepth = std::max(maxBLASDepth, blasStats.maxDepth);
+            }
+            m_statistics.maxDepth += maxBLASDepth;
+        }
+
+        void InstanceAccelerator::build(std::vector<Instance> &&instances, uint32_t numThreads) {
+            m_instances.clear();
+            m_instanceIndices.clear();
+            m_numInputInstances = (uint32_t)instances.size();
+            m_bvh = BVH();
+            m_builtSAHCost = 0.0f;
+            m_statistics = BVHStatistics();
+
+            // JP: 三角形を持たないBLASを参照するインスタンスは除く。
+            // EN: Exclude instances referencing a BLAS without triangles.
+            std::vector<BoundingBox3D> instBBoxes;
+            std::vector<uint32_t> validInstIndices;
+            for (uint32_t i = 0; i < instances.size(); ++i) {
+                Instance &inst = instances[i];
+                if (inst.blas->getNodes().empty())
+                    continue;
+
+                inst.worldBBox = calcWorldBoundingBox(inst);
+                instBBoxes.push_back(inst.worldBBox);
+                validInstIndices.push_back(i);
+            }
+
+            if (validInstIndices.empty()) {
+                instances.clear();
+                return;
+            }
+
+            m_bvh.build(instBBoxes, numThreads);
+
+            const std::vector<uint32_t> &primIndices = m_bvh.getPrimitiveIndices();
+            m_instances.resize(primIndices.size());
+            m_instanceIndices.resize(primIndices.size());
+            for (uint32_t i = 0; i < primIndices.size(); ++i) {
+                m_instanceIndices[i] = validInstIndices[primIndices[i]];
+                m_instances[i] = instances[m_instanceIndices[i]];
+            }
+            instances.clear();
+
+            m_builtSAHCost = m_bvh.getStatistics().SAHCost;
+            updateStatistics();
+        }
+
+        bool InstanceAccelerator::update(std::vector<Instance> &&instances, uint32_t numThreads) {
+            bool compositionChanged = instances.size() != m_numInputInstances;
+            uint32_t numValidInstances = 0;
+            for (auto it = instances.cbegin(); it != instances.cend() && !compositionChanged; ++it) {
+                if (!it->blas->getNodes().empty())
+                    ++numValidInstances;
+            }
+            compositionChanged |= numValidInstances != m_instances.size();
+            for (uint32_t i = 0; i < m_instances.size() && !compositionChanged; ++i)
+                compositionChanged |= instances[m_instanceIndices[i]].blas != m_instances[i].blas;
+            if (compositionChanged || m_instances.empty()) {
+                build(std::move(instances), numThreads);
+                return true;
+            }
+
+            const std::vector<uint32_t> &primIndices = m_bvh.getPrimitiveIndices();
+            std::vector<BoundingBox3D> instBBoxes(m_instances.size());
+            for (uint32_t i = 0; i < m_instances.size(); ++i) {
+                Instance &inst = m_instances[i];
+                inst = instances[m_instanceIndices[i]];
+                inst.worldBBox = calcWorldBoundingBox(inst);
+                instBBoxes[primIndices[i]] = inst.worldBBox;
+            }
+
+            m_bvh.refit(instBBoxes);
+            if (m_bvh.getStatistics().SAHCost > MaxRefitSAHCostRatio * m_builtSAHCost) {
+                build(std::move(instances), numThreads);
+                return true;
+            }
+
+            updateStatistics();
+            return false;
+        }
+
+        bool InstanceAccelerator::intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                                            AnyHitCallback anyHit, void* userData, RayHit* hit) const {
+            const std::vector<BVH::Node> &nodes = m_bvh.getNodes();
+            if (nodes.empty())
+                return false;
+
+            // JP: BLASから渡される三角形のinstIndexを全体でのインデックスに直してから呼び出し元のコールバックに渡す。
+            // EN: Convert instIndex of a triangle passed from a BLAS into the global index before passing it to the caller's callback.
+            struct AnyHitContext {
+                AnyHitCallback anyHit;
+                void* userData;
+                uint32_t instIndexOffset;
+                bool terminated;
+            };
+            AnyHitContext anyHitContext{ anyHit, userData, 0, false };
+            AnyHitCallback blasAnyHit = nullptr;
+            if (anyHit) {
+                blasAnyHit = [](void* userData, const Triangle &tri, float t, float b1, float b2) {
+                    AnyHitContext &context = *(AnyHitContext*)userData;
+                    Triangle globalTri = tri;
+                    globalTri.instIndex += context.instIndexOffset;
+                    AnyHitResult res = context.anyHit(context.userData, globalTri, t, b1, b2);
+                    if (res == AnyHitResult::AcceptAndTerminate)
+                        context.terminated = true;
+                    return res;
+                };
+            }
+
+            Vector3D invDir(safeInverse(dir.x), safeInverse(dir.y), safeInverse(dir.z));
+
+            bool hitFound = false;
+            struct StackEntry {
+                uint32_t index;
+                float tNear;
+            };
+            StackEntry stack[StackSize];
+            uint32_t stackIdx = 0;
+            float tNear;
+            if (intersectAABB(nodes[0].bbox, org, invDir, tmin, tmax, &tNear))
+                stack[stackIdx++] = StackEntry{ 0, tNear };
+            while (stackIdx > 0) {
+                StackEntry entry = stack[--stackIdx];
+                if (entry.tNear > tmax)
+                    continue;
+
+                const BVH::Node &node = nodes[entry.index];
+                if (node.numPrimitives > 0) {
+                    for (uint32_t i = 0; i < node.numPrimitives; ++i) {
+                        const Instance &inst = m_instances[node.offset + i];
+                        if (!intersectAABB(inst.worldBBox, org, invDir, tmin, tmax, &tNear))
+                            continue;
+
+                        // JP: アフィン変換ではパラメトリックな距離tは変わらないので、方向ベクトルは正規化しない。
+                        // EN: Parametric distance t does not change under an affine transform, so the direction is not normalized.
+                        Point3D localOrg = inst.worldToObject * org;
+                        Vector3D localDir = inst.worldToObject * dir;
+                        anyHitContext.instIndexOffset = inst.instIndexOffset;
+                        RayHit localHit;
+                        if (!inst.blas->intersect(localOrg, localDir, tmin, tmax, blasAnyHit, &anyHitContext, &localHit))
+                            continue;
+
+                        tmax = localHit.t;
+                        *hit = localHit;
+                        hit->instIndex += inst.instIndexOffset;
+                        hitFound = true;
+                        if (anyHitContext.terminated)
+                            return true;
+                    }
+                    continue;
+                }
+
+                StackEntry children[2];
+                uint32_t numHitChildren = 0;
+                const uint32_t childIndices[] = { entry.index + 1, node.offset };
+                for (int i = 0; i < 2; ++i) {
+                    if (intersectAABB(nodes[childIndices[i]].bbox, org, invDir, tmin, tmax, &tNear))
+                        children[numHitChildren++] = StackEntry{ childIndices[i], tNear };
+                }
+                if (numHitChildren == 2 && children[0].tNear < children[1].tNear)
+                    std::swap(children[0], children[1]);
+                for (uint32_t i = 0; i < numHitChildren; ++i)
+                    stack[stackIdx++] = children[i];
+            }
+
+            return hitFound;
+        }
+
+        void InstanceAccelerator::intersectPacket(const Ray* rays, uint32_t numRays, RayHit* hits) const {
+            VLRAssert(numRays <= TriangleAccelerator::MaxNumRaysInPacket, "Too many rays in a packet: %u", numRays);
+            for (uint32_t i = 0; i < numRays; ++i)
+                hits[i].instIndex = InvalidIndex;
+            const std::vector<BVH::Node> &nodes = m_bvh.getNodes();
+            if (nodes.empty() || numRays == 0)
+                return;
+
+            const uint32_t MaxNumRays = TriangleAccelerator::MaxNumRaysInPacket;
+            Vector3D invDirs[MaxNumRays];
+            float tmaxs[MaxNumRays];
+            for (uint32_t i = 0; i < numRays; ++i) {
+                const Ray &ray = rays[i];
+                invDirs[i] = Vector3D(safeInverse(ray.dir.x), safeInverse(ray.dir.y), safeInverse(ray.dir.z));
+                tmaxs[i] = ray.tmax;
+            }
+
+            // JP: 子を辿る順序は先頭のレイの方向で決める。
+            // EN: The order of visiting children is determined by the direction of the first ray.
+            uint32_t stack[StackSize];
+            uint32_t stackIdx = 0;
+            stack[stackIdx++] = 0;
+            while (stackIdx > 0) {
+                uint32_t nodeIdx = stack[--stackIdx];
+                const BVH::Node &node = nodes[nodeIdx];
+
+                bool anyRayHits = false;
+                for (uint32_t i = 0; i < numRays && !anyRayHits; ++i) {
+                    float tNear;
+                    anyRayHits = intersectAABB(node.bbox, rays[i].org, invDirs[i], rays[i].tmin, tmaxs[i], &tNear);
+                }
+                if (!anyRayHits)
+                    continue;
+
+                if (node.numPrimitives == 0) {
+                    if (rays[0].dir[node.axis] >= 0.0f) {
+                        stack[stackIdx++] = node.offset;
+                        stack[stackIdx++] = nodeIdx + 1;
+                    }
+                    else {
+                        stack[stackIdx++] = nodeIdx + 1;
+                        stack[stackIdx++] = node.offset;
+                    }
+                    continue;
+                }
+
+                for (uint32_t instIdx = 0; instIdx < node.numPrimitives; ++instIdx) {
+                    const Instance &inst = m_instances[node.offset + instIdx];
+
+                    // JP: インスタンスのAABBに交差するレイだけをオブジェクト空間に変換してBLASに渡す。
+                    // EN: Transform only the rays intersecting the AABB of the instance into object space to pass to the BLAS.
+                    Ray localRays[MaxNumRays];
+                    uint32_t laneIndices[MaxNumRays];
+                    uint32_t numLocalRays = 0;
+                    for (uint32_t i = 0; i < numRays; ++i) {
+                        const Ray &ray = rays[i];
+                        float tNear;
+                        if (!intersectAABB(inst.worldBBox, ray.org, invDirs[i], ray.tmin, tmaxs[i], &tNear))
+                            continue;
+                        Ray &localRay = localRays[numLocalRays];
+                        localRay.org = inst.worldToObject * ray.org;
+                        localRay.dir = inst.worldToObject * ray.dir;
+                        localRay.tmin = ray.tmin;
+                        localRay.tmax = tmaxs[i];
+                        laneIndices[numLocalRays++] = i;
+                    }
+                    if (numLocalRays == 0)
+                        continue;
+
+                    RayHit localHits[MaxNumRays];
+                    inst.blas->intersectPacket(localRays, numLocalRays, localHits);
+                    for (uint32_t i = 0; i < numLocalRays; ++i) {
+                        const RayHit &localHit = localHits[i];
+                        if (localHit.instIndex == InvalidIndex)
+                            continue;
+                        uint32_t lane = laneIndices[i];
+                        hits[lane] = localHit;
+                        hits[lane].instIndex += inst.instIndexOffset;
+                        tmaxs[lane] = localHit.t;
+                    }
+                }
+            }
+        }
+
+        void InstanceAccelerator::intersect(const Ray* rays, uint32_t numRays, RayHit* hits, uint32_t numThreads) const {
+            intersectInPackets(numRays, numThreads, [this, rays, hits](uint32_t start, uint32_t num) {
+                intersectPacket(rays + start, num, hits + start);
+            });
+        }
+    }
+}
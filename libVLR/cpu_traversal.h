@@ -0,0 +1,334 @@
+﻿#pragma once
+
+#include "cpu_bvh.h"
+
+namespace VLR {
+    namespace CPU {
+        enum class AnyHitResult {
+            Ignore = 0,
+            Accept,
+            AcceptAndTerminate,
+        };
+
+        struct Triangle {
+            Point3D p0, p1, p2;
+            uint32_t instIndex;
+            uint32_t primIndex;
+        };
+
+        struct Ray {
+            Point3D org;
+            Vector3D dir;
+            float tmin;
+            float tmax;
+        };
+
+        struct RayHit {
+            float t;
+            float b1, b2;
+            uint32_t instIndex;
+            uint32_t primIndex;
+        };
+
+        static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        // JP: 候補となる交差ごとに呼ばれる。nullptrの場合はすべての交差を受理する。
+        // EN: Called for each candidate intersection. All intersections are accepted if nullptr.
+        typedef AnyHitResult (*AnyHitCallback)(void* userData, const Triangle &tri, float t, float b1, float b2);
+
+
+
+        // JP: 方向成分が0の場合にNaNが生じないよう、無限大の代わりに大きな有限値を使う。
+        // EN: Use a large finite value instead of infinity to avoid NaN when a direction component is 0.
+        inline float safeInverse(float x) {
+            return x != 0.0f ? 1.0f / x : std::copysign(1e+30f, x);
+        }
+
+        // JP: AABBの遠い側の距離を丸め誤差の分だけ広げて、保守的な判定にする。(Ize, "Robust BVH Ray Traversal")
+        // EN: Extend the far distance of an AABB by the amount of rounding errors to make the test conservative. (Ize, "Robust BVH Ray Traversal")
+        const float RobustFarScale = 1.0000004f;
+
+        // JP: 再フィット後のSAHコストが構築時のこの倍率を超えた場合は再構築する。
+        // EN: Rebuild when the SAH cost after refitting exceeds this ratio to the one at build time.
+        const float MaxRefitSAHCostRatio = 1.5f;
+
+        // JP: Woop et al. "Watertight Ray/Triangle Intersection" のためにレイごとに前計算する値。
+        // EN: Per-ray precomputed values for Woop et al. "Watertight Ray/Triangle Intersection".
+        struct WatertightRay {
+            Point3D org;
+            uint32_t kx, ky, kz;
+            float Sx, Sy, Sz;
+
+            WatertightRay() {}
+            WatertightRay(const Point3D &_org, const Vector3D &dir) : org(_org) {
+                float absX = std::fabs(dir.x), absY = std::fabs(dir.y), absZ = std::fabs(dir.z);
+                kz = (absX > absY) ? (absX > absZ ? 0 : 2) : (absY > absZ ? 1 : 2);
+                kx = kz == 2 ? 0 : kz + 1;
+                ky = kx == 2 ? 0 : kx + 1;
+                // JP: 三角形の頂点順序(ワインディング)を保つ。
+                // EN: Preserve the winding of triangles.
+                if (dir[kz] < 0.0f)
+                    std::swap(kx, ky);
+                Sx = dir[kx] / dir[kz];
+                Sy = dir[ky] / dir[kz];
+                Sz = 1.0f / dir[kz];
+            }
+        };
+
+        // JP: 共有エッジや頂点を通るレイが隙間をすり抜けない交差判定。
+        //     b1, b2はそれぞれp1, p2に対する重心座標。
+        // EN: Intersection test where rays through a shared edge or vertex never slip through a gap.
+        //     b1 and b2 are barycentric coordinates for p1 and p2 respectively.
+        inline bool testRayVsTriangle(const WatertightRay &ray, const Triangle &tri, float tmin, float tmax,
+                                      float* t, float* b1, float* b2) {
+            Vector3D A = tri.p0 - ray.org;
+            Vector3D B = tri.p1 - ray.org;
+            Vector3D C = tri.p2 - ray.org;
+
+            float Ax = A[ray.kx] - ray.Sx * A[ray.kz];
+            float Ay = A[ray.ky] - ray.Sy * A[ray.kz];
+            float Bx = B[ray.kx] - ray.Sx * B[ray.kz];
+            float By = B[ray.ky] - ray.Sy * B[ray.kz];
+            float Cx = C[ray.kx] - ray.Sx * C[ray.kz];
+            float Cy = C[ray.ky] - ray.Sy * C[ray.kz];
+
+            float U = Cx * By - Cy * Bx;
+            float V = Ax * Cy - Ay * Cx;
+            float W = Bx * Ay - By * Ax;
+
+            // JP: エッジ上ちょうどの場合は倍精度で再計算する。
+            // EN: Recompute in double precision when exactly on an edge.
+            if (U == 0.0f || V == 0.0f || W == 0.0f) {
+                U = (float)((double)Cx * By - (double)Cy * Bx);
+                V = (float)((double)Ax * Cy - (double)Ay * Cx);
+                W = (float)((double)Bx * Ay - (double)By * Ax);
+            }
+
+            if ((U < 0.0f || V < 0.0f || W < 0.0f) && (U > 0.0f || V > 0.0f || W > 0.0f))
+                return false;
+
+            float det = U + V + W;
+            if (det == 0.0f)
+                return false;
+
+            float Az = ray.Sz * A[ray.kz];
+            float Bz = ray.Sz * B[ray.kz];
+            float Cz = ray.Sz * C[ray.kz];
+            float T = U * Az + V * Bz + W * Cz;
+
+            float invDet = 1.0f / det;
+            float tt = T * invDet;
+            if (!(tt >= tmin && tt <= tmax))
+                return false;
+
+            *t = tt;
+            *b1 = V * invDet;
+            *b2 = W * invDet;
+            return true;
+        }
+
+
+
+        // JP: 三角形群に対する8分木のBVHとトラバーサル。
+        //     二分木のSAH BVHを構築してから8分木に畳み込む。
+        //     AVX2が使える環境では8つの子ノードを、パケットの場合は8本のレイを同時に判定する。
+        // EN: 8-wide BVH over triangles and its traversal.
+        //     Builds a binary SAH BVH then collapses it into an 8-wide tree.
+        //     When AVX2 is available, 8 child nodes or, for packets, 8 rays are tested at once.
+        class TriangleAccelerator {
+        public:
+            static const uint32_t Width = 8;
+            static const uint32_t MaxNumRaysInPacket = 8;
+            static const uint32_t StackSize = 512;
+
+            struct WideNode {
+                // JP: 子ノードのAABBをSoAで持つ。minX, minY, minZ, maxX, maxY, maxZの順。
+                // EN: Child AABBs in SoA. In the order of minX, minY, minZ, maxX, maxY, maxZ.
+                float bounds[6][Width];
+                // JP: 中間ノードの子はノードインデックス、葉の子は最初の三角形のインデックス。
+                // EN: Node index for an inner child, the index of the first triangle for a leaf child.
+                uint32_t children[Width];
+                // JP: 中間ノードの子では0。
+                // EN: 0 for an inner child.
+                uint8_t numTriangles[Width];
+                uint32_t numChildren;
+            };
+
+            struct StackEntry {
+                uint32_t index;
+                uint32_t numTriangles;
+                float tNear;
+            };
+
+            // JP: 近い子ほど先に取り出されるように、交差した子を遠い順にスタックに積む。
+            // EN: Push the intersected children in far-to-near order so that nearer children are popped first.
+            static void pushChildren(StackEntry* stack, uint32_t* stackIdx, StackEntry* children, uint32_t numChildren) {
+                for (uint32_t i = 1; i < numChildren; ++i) {
+                    StackEntry entry = children[i];
+                    uint32_t j = i;
+                    for (; j > 0 && children[j - 1].tNear < entry.tNear; --j)
+                        children[j] = children[j - 1];
+                    children[j] = entry;
+                }
+                for (uint32_t i = 0; i < numChildren; ++i)
+                    stack[(*stackIdx)++] = children[i];
+            }
+
+        private:
+            std::vector<Triangle> m_triangles;
+            // JP: 並び替え後の三角形ごとの、構築時に渡された三角形のインデックス。
+            // EN: The index in triangles passed at build time for each reordered triangle.
+            std::vector<uint32_t> m_triangleIndices;
+            std::vector<WideNode> m_nodes;
+            BoundingBox3D m_bbox;
+            float m_builtSAHCost;
+            BVHStatistics m_statistics;
+
+            uint32_t collapse(const std::vector<BVH::Node> &binaryNodes, uint32_t binaryNodeIdx);
+            float calcSAHCost() const;
+
+        public:
+            TriangleAccelerator() : m_builtSAHCost(0.0f) {}
+
+            void build(std::vector<Triangle> &&triangles, uint32_t numThreads = 0);
+            // JP: 構築時と同じ順序・個数の三角形の位置の変化に対してAABBを下から再フィットする。
+            //     個数が異なる場合や、8分木のSAHコストが構築時からMaxRefitSAHCostRatio倍を超えて悪化した場合は再構築する。
+            //     再構築した場合にtrueを返す。
+            // EN: Refit AABBs bottom-up for changes of positions of triangles in the same order and count as in building.
+            //     Rebuild if the count differs or the SAH cost of the 8-wide tree has degraded beyond MaxRefitSAHCostRatio times the one at build time.
+            //     Returns true if rebuilt.
+            bool update(std::vector<Triangle> &&triangles, uint32_t numThreads = 0);
+
+            // JP: 最も近い受理された交差を求める。
+            // EN: Find the closest accepted intersection.
+            bool intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitCallback anyHit, void* userData, RayHit* hit) const;
+
+            template <typename AnyHitFunction>
+            bool intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitFunction &anyHit, RayHit* hit) const {
+                AnyHitCallback callback = [](void* userData, const Triangle &tri, float t, float b1, float b2) {
+                    return (*(AnyHitFunction*)userData)(tri, t, b1, b2);
+                };
+                return intersect(org, dir, tmin, tmax, callback, &anyHit, hit);
+            }
+
+            // JP: 最大8本のレイのパケットに対して最も近い交差を求める。
+            //     交差が無い場合はhits[i].instIndexがInvalidIndexとなる。
+            // EN: Find the closest intersections for a packet of up to 8 rays.
+            //     hits[i].instIndex becomes InvalidIndex when there is no intersection.
+            void intersectPacket(const Ray* rays, uint32_t numRays, RayHit* hits) const;
+
+            // JP: 大量のレイを8本ずつのパケットに分けて複数スレッドで処理する。
+            // EN: Process a large number of rays in packets of 8 rays with multiple threads.
+            void intersect(const Ray* rays, uint32_t numRays, RayHit* hits, uint32_t numThreads = 0) const;
+
+            const std::vector<Triangle> &getTriangles() const {
+                return m_triangles;
+            }
+            const std::vector<WideNode> &getNodes() const {
+                return m_nodes;
+            }
+            const BoundingBox3D &getBoundingBox() const {
+                return m_bbox;
+            }
+            const BVHStatistics &getStatistics() const {
+                return m_statistics;
+            }
+        };
+
+
+
+        // JP: インスタンスに対する2レベルの加速構造。
+        //     BLAS(TriangleAccelerator)はオブジェクト空間で構築され、複数のインスタンスから共有される。
+        //     TLASはインスタンスのワールド空間のAABBに対する二分木のBVHで、変換の更新時にはこれだけを再構築すれば良い。
+        // EN: Two-level acceleration structure over instances.
+        //     BLASes (TriangleAccelerator) are built in object space and shared by multiple instances.
+        //     The TLAS is a binary BVH over world-space AABBs of instances, and only it needs to be rebuilt on transform updates.
+        class InstanceAccelerator {
+        public:
+            static const uint32_t StackSize = 128;
+
+            struct Instance {
+                const TriangleAccelerator* blas;
+                Shared::StaticTransform objectToWorld;
+                Shared::StaticTransform worldToObject;
+                // JP: BLAS内の三角形のinstIndexに加算して、全体でのインスタンスインデックスとする。
+                // EN: Added to instIndex of triangles in the BLAS to make the global instance index.
+                uint32_t instIndexOffset;
+                BoundingBox3D worldBBox;
+            };
+
+        private:
+            std::vector<Instance> m_instances;
+            // JP: 並び替え後のインスタンスごとの、構築時に渡されたインスタンスのインデックス。
+            // EN: The index in instances passed at build time for each reordered instance.
+            std::vector<uint32_t> m_instanceIndices;
+            uint32_t m_numInputInstances;
+            BVH m_bvh;
+            float m_builtSAHCost;
+            BVHStatistics m_statistics;
+
+            void updateStatistics();
+
+        public:
+            InstanceAccelerator() : m_numInputInstances(0), m_builtSAHCost(0.0f) {}
+
+            // JP: worldBBoxは構築時に計算される。
+            // EN: worldBBox is computed in building.
+            void build(std::vector<Instance> &&instances, uint32_t numThreads = 0);
+            // JP: 構築時と同じ順序・個数・BLASのインスタンスの変換やBLASの変化に対してTLASを再フィットする。
+            //     構成が異なる場合やSAHコストが構築時からMaxRefitSAHCostRatio倍を超えて悪化した場合は再構築する。
+            //     再構築した場合にtrueを返す。
+            // EN: Refit the TLAS for changes of transforms or BLASes of instances in the same order, count and BLASes as in building.
+            //     Rebuild if the composition differs or the SAH cost has degraded beyond MaxRefitSAHCostRatio times the one at build time.
+            //     Returns true if rebuilt.
+            bool update(std::vector<Instance> &&instances, uint32_t numThreads = 0);
+
+            // JP: 最も近い受理された交差を求める。
+            //     anyHitに渡される三角形の座標はオブジェクト空間のもの。instIndexは全体でのインデックスとなる。
+            // EN: Find the closest accepted intersection.
+            //     Triangle coordinates passed to anyHit are in object space. instIndex is the global index.
+            bool intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitCallback anyHit, void* userData, RayHit* hit) const;
+
+            template <typename AnyHitFunction>
+            bool intersect(const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitFunction &anyHit, RayHit* hit) const {
+                AnyHitCallback callback = [](void* userData, const Triangle &tri, float t, float b1, float b2) {
+                    return (*(AnyHitFunction*)userData)(tri, t, b1, b2);
+                };
+                return intersect(org, dir, tmin, tmax, callback, &anyHit, hit);
+            }
+
+            void intersectPacket(const Ray* rays, uint32_t numRays, RayHit* hits) const;
+
+            void intersect(const Ray* rays, uint32_t numRays, RayHit* hits, uint32_t numThreads = 0) const;
+
+            const std::vector<Instance> &getInstances() const {
+                return m_instances;
+            }
+            // JP: 構築時間はTLASのみ。ノード数は重複を除いたBLASの分も含む。
+            //     最大深さはTLASと最も深いBLASの和。SAHコストはTLASのもの。
+            // EN: The build time is of the TLAS only. The numbers of nodes include those of the unique BLASes.
+            //     The maximum depth is the sum of those of the TLAS and the deepest BLAS. The SAH cost is of the TLAS.
+            const BVHStatistics &getStatistics() const {
+                return m_statistics;
+            }
+        };
+
+        bool isAVX2Available();
+        // JP: halfとfloatの変換命令。AVX2とは別の機能ビットなので、halfを扱うAVX2版の関数はこれも確認してから呼ぶ。
+        // EN: Conversion instructions between half and float. This is a separate feature bit from AVX2,
+        //     so check this as well before calling AVX2 functions handling half.
+        bool isF16CAvailable();
+
+        // JP: cpu_traversal_avx2.cppで定義されるAVX2版のカーネル。AVX2が使える場合のみ呼ぶ。
+        // EN: AVX2 kernels defined in cpu_traversal_avx2.cpp. Call only when AVX2 is available.
+        namespace AVX2 {
+            bool intersect(const TriangleAccelerator &accel, const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitCallback anyHit, void* userData, RayHit* hit);
+            void intersectPacket(const TriangleAccelerator &accel, const Ray* rays, uint32_t numRays, RayHit* hits);
+        }
+    }
+}
@@ -0,0 +1,324 @@
+﻿#include "cpu_traversal.h"
+
+// JP: このファイルはAVX2を有効にしてコンパイルする(MSVCでは/arch:AVX2)。
+//     呼び出し側は実行時にisAVX2Available()で確認してからここの関数を呼ぶ。
+// EN: This file is compiled with AVX2 enabled (/arch:AVX2 on MSVC).
+//     The caller checks isAVX2Available() at runtime before calling the functions here.
+#if !defined(__AVX2__)
+#   error "cpu_traversal_avx2.cpp must be compiled with AVX2 enabled."
+#endif
+
+#include <immintrin.h>
+
+namespace VLR {
+    namespace CPU {
+        namespace AVX2 {
+            typedef TriangleAccelerator::WideNode WideNode;
+            typedef TriangleAccelerator::StackEntry StackEntry;
+
+            bool intersect(const TriangleAccelerator &accel, const Point3D &org, const Vector3D &dir, float tmin, float tmax,
+                           AnyHitCallback anyHit, void* userData, RayHit* hit) {
+                const std::vector<WideNode> &nodes = accel.getNodes();
+                const std::vector<Triangle> &triangles = accel.getTriangles();
+
+                WatertightRay wtRay(org, dir);
+                Vector3D invDir(safeInverse(dir.x), safeInverse(dir.y), safeInverse(dir.z));
+                uint32_t nearIdx[3], farIdx[3];
+                __m256 orgV[3], invDirV[3];
+                for (int dim = 0; dim < 3; ++dim) {
+                    nearIdx[dim] = invDir[dim] >= 0.0f ? dim : dim + 3;
+                    farIdx[dim] = invDir[dim] >= 0.0f ? dim + 3 : dim;
+                    orgV[dim] = _mm256_set1_ps(org[dim]);
+                    invDirV[dim] = _mm256_set1_ps(invDir[dim]);
+                }
+                const __m256 tminV = _mm256_set1_ps(tmin);
+                const __m256 infV = _mm256_set1_ps(INFINITY);
+                const __m256 robustFarScaleV = _mm256_set1_ps(RobustFarScale);
+
+                bool hitFound = false;
+                StackEntry stack[TriangleAccelerator::StackSize];
+                uint32_t stackIdx = 0;
+                stack[stackIdx++] = StackEntry{ 0, 0, tmin };
+                while (stackIdx > 0) {
+                    StackEntry entry = stack[--stackIdx];
+                    if (entry.tNear > tmax)
+                        continue;
+
+                    if (entry.numTriangles > 0) {
+                        for (uint32_t i = 0; i < entry.numTriangles; ++i) {
+                            const Triangle &tri = triangles[entry.index + i];
+                            float t, b1, b2;
+                            if (!testRayVsTriangle(wtRay, tri, tmin, tmax, &t, &b1, &b2))
+                                continue;
+
+                            AnyHitResult res = anyHit ? anyHit(userData, tri, t, b1, b2) : AnyHitResult::Accept;
+                            if (res == AnyHitResult::Ignore)
+                                continue;
+
+                            tmax = t;
+                            hit->t = t;
+                            hit->b1 = b1;
+                            hit->b2 = b2;
+                            hit->instIndex = tri.instIndex;
+                            hit->primIndex = tri.primIndex;
+                            hitFound = true;
+                            if (res == AnyHitResult::AcceptAndTerminate)
+                                return true;
+                        }
+                        continue;
+                    }
+
+                    // JP: 8つの子のAABBを一度に判定する。
+                    // EN: Test AABBs of 8 children at once.
+                    const WideNode &node = nodes[entry.index];
+                    __m256 tNearV = tminV;
+                    __m256 tFarV = infV;
+                    for (int dim = 0; dim < 3; ++dim) {
+                        __m256 nearV = _mm256_loadu_ps(node.bounds[nearIdx[dim]]);
+                        __m256 farV = _mm256_loadu_ps(node.bounds[farIdx[dim]]);
+                        tNearV = _mm256_max_ps(tNearV, _mm256_mul_ps(_mm256_sub_ps(nearV, orgV[dim]), invDirV[dim]));
+                        tFarV = _mm256_min_ps(tFarV, _mm256_mul_ps(_mm256_sub_ps(farV, orgV[dim]), invDirV[dim]));
+                    }
+                    tFarV = _mm256_min_ps(_mm256_mul_ps(tFarV, robustFarScaleV), _mm256_set1_ps(tmax));
+                    uint32_t hitMask = _mm256_movemask_ps(_mm256_cmp_ps(tNearV, tFarV, _CMP_LE_OQ));
+                    hitMask &= (1u << node.numChildren) - 1;
+                    if (hitMask == 0)
+                        continue;
+
+                    alignas(32) float tNears[TriangleAccelerator::Width];
+                    _mm256_store_ps(tNears, tNearV);
+                    StackEntry hitChildren[TriangleAccelerator::Width];
+                    uint32_t numHitChildren = 0;
+                    for (uint32_t c = 0; c < node.numChildren; ++c) {
+                        if (hitMask & (1u << c))
+                            hitChildren[numHitChildren++] = StackEntry{ node.children[c], node.numTriangles[c], tNears[c] };
+                    }
+                    TriangleAccelerator::pushChildren(stack, &stackIdx, hitChildren, numHitChildren);
+                }
+
+                return hitFound;
+            }
+
+
+
+            // JP: レーンごとに異なる軸の成分を選ぶ。is0, is1はそれぞれ軸がx, yであるレーンのマスク。
+            // EN: Select a component of a different axis per lane. is0 and is1 are masks of lanes whose axis is x and y respectively.
+            static inline __m256 selectAxis(const __m256 v[3], __m256 is0, __m256 is1) {
+                return _mm256_blendv_ps(_mm256_blendv_ps(v[2], v[1], is1), v[0], is0);
+            }
+
+            static inline float horizontalMax(__m256 v) {
+                alignas(32) float values[8];
+                _mm256_store_ps(values, v);
+                float ret = values[0];
+                for (int i = 1; i < 8; ++i)
+                    ret = std::max(ret, values[i]);
+                return ret;
+            }
+
+            static inline float horizontalMin(__m256 v) {
+                alignas(32) float values[8];
+                _mm256_store_ps(values, v);
+                float ret = values[0];
+                for (int i = 1; i < 8; ++i)
+                    ret = std::min(ret, values[i]);
+                return ret;
+            }
+
+            void intersectPacket(const TriangleAccelerator &accel, const Ray* rays, uint32_t numRays, RayHit* hits) {
+                if (numRays == 0)
+                    return;
+
+                const std::vector<WideNode> &nodes = accel.getNodes();
+                const std::vector<Triangle> &triangles = accel.getTriangles();
+
+                // JP: レイをSoAに並べ替える。余ったレーンは非アクティブにする。
+                // EN: Rearrange rays into SoA. Remaining lanes are made inactive.
+                alignas(32) float orgs[3][8], invDirs[3][8], tmins[8], tmaxs[8];
+                alignas(32) float Ss[3][8];
+                alignas(32) int32_t ks[3][8];
+                WatertightRay wtRays[8];
+                for (uint32_t lane = 0; lane < 8; ++lane) {
+                    const Ray &ray = rays[std::min(lane, numRays - 1)];
+                    wtRays[lane] = WatertightRay(ray.org, ray.dir);
+                    const WatertightRay &wtRay = wtRays[lane];
+                    for (int dim = 0; dim < 3; ++dim) {
+                        orgs[dim][lane] = ray.org[dim];
+                        invDirs[dim][lane] = safeInverse(ray.dir[dim]);
+                    }
+                    tmins[lane] = ray.tmin;
+                    tmaxs[lane] = ray.tmax;
+                    ks[0][lane] = wtRay.kx;
+                    ks[1][lane] = wtRay.ky;
+                    ks[2][lane] = wtRay.kz;
+                    Ss[0][lane] = wtRay.Sx;
+                    Ss[1][lane] = wtRay.Sy;
+                    Ss[2][lane] = wtRay.Sz;
+                }
+
+                const __m256 activeV = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(numRays),
+                                                                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+                const uint32_t activeMask = _mm256_movemask_ps(activeV);
+                __m256 orgV[3], invDirV[3], kIs0V[3], kIs1V[3];
+                for (int dim = 0; dim < 3; ++dim) {
+                    orgV[dim] = _mm256_load_ps(orgs[dim]);
+                    invDirV[dim] = _mm256_load_ps(invDirs[dim]);
+                    __m256i kV = _mm256_load_si256((const __m256i*)ks[dim]);
+                    kIs0V[dim] = _mm256_castsi256_ps(_mm256_cmpeq_epi32(kV, _mm256_set1_epi32(0)));
+                    kIs1V[dim] = _mm256_castsi256_ps(_mm256_cmpeq_epi32(kV, _mm256_set1_epi32(1)));
+                }
+                const __m256 SxV = _mm256_load_ps(Ss[0]);
+                const __m256 SyV = _mm256_load_ps(Ss[1]);
+                const __m256 SzV = _mm256_load_ps(Ss[2]);
+                const __m256 tminV = _mm256_load_ps(tmins);
+                const __m256 zeroV = _mm256_setzero_ps();
+                const __m256 infV = _mm256_set1_ps(INFINITY);
+                const __m256 robustFarScaleV = _mm256_set1_ps(RobustFarScale);
+
+                __m256 hitTV = _mm256_load_ps(tmaxs);
+                __m256 hitB1V = zeroV;
+                __m256 hitB2V = zeroV;
+                __m256 hitTriV = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                float maxHitT = horizontalMax(_mm256_blendv_ps(_mm256_set1_ps(-INFINITY), hitTV, activeV));
+
+                StackEntry stack[TriangleAccelerator::StackSize];
+                uint32_t stackIdx = 0;
+                stack[stackIdx++] = StackEntry{ 0, 0, -INFINITY };
+                while (stackIdx > 0) {
+                    StackEntry entry = stack[--stackIdx];
+                    if (entry.tNear > maxHitT)
+                        continue;
+
+                    if (entry.numTriangles > 0) {
+                        for (uint32_t i = 0; i < entry.numTriangles; ++i) {
+                            uint32_t triIdx = entry.index + i;
+                            const Triangle &tri = triangles[triIdx];
+
+                            __m256 A[3], B[3], C[3];
+                            for (int dim = 0; dim < 3; ++dim) {
+                                A[dim] = _mm256_sub_ps(_mm256_set1_ps(tri.p0[dim]), orgV[dim]);
+                                B[dim] = _mm256_sub_ps(_mm256_set1_ps(tri.p1[dim]), orgV[dim]);
+                                C[dim] = _mm256_sub_ps(_mm256_set1_ps(tri.p2[dim]), orgV[dim]);
+                            }
+                            __m256 Akz = selectAxis(A, kIs0V[2], kIs1V[2]);
+                            __m256 Bkz = selectAxis(B, kIs0V[2], kIs1V[2]);
+                            __m256 Ckz = selectAxis(C, kIs0V[2], kIs1V[2]);
+                            __m256 Ax = _mm256_sub_ps(selectAxis(A, kIs0V[0], kIs1V[0]), _mm256_mul_ps(SxV, Akz));
+                            __m256 Ay = _mm256_sub_ps(selectAxis(A, kIs0V[1], kIs1V[1]), _mm256_mul_ps(SyV, Akz));
+                            __m256 Bx = _mm256_sub_ps(selectAxis(B, kIs0V[0], kIs1V[0]), _mm256_mul_ps(SxV, Bkz));
+                            __m256 By = _mm256_sub_ps(selectAxis(B, kIs0V[1], kIs1V[1]), _mm256_mul_ps(SyV, Bkz));
+                            __m256 Cx = _mm256_sub_ps(selectAxis(C, kIs0V[0], kIs1V[0]), _mm256_mul_ps(SxV, Ckz));
+                            __m256 Cy = _mm256_sub_ps(selectAxis(C, kIs0V[1], kIs1V[1]), _mm256_mul_ps(SyV, Ckz));
+
+                            __m256 U = _mm256_sub_ps(_mm256_mul_ps(Cx, By), _mm256_mul_ps(Cy, Bx));
+                            __m256 V = _mm256_sub_ps(_mm256_mul_ps(Ax, Cy), _mm256_mul_ps(Ay, Cx));
+                            __m256 W = _mm256_sub_ps(_mm256_mul_ps(Bx, Ay), _mm256_mul_ps(By, Ax));
+
+                            __m256 anyNegative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zeroV, _CMP_LT_OQ),
+                                                                           _mm256_cmp_ps(V, zeroV, _CMP_LT_OQ)),
+                                                              _mm256_cmp_ps(W, zeroV, _CMP_LT_OQ));
+                            __m256 anyPositive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zeroV, _CMP_GT_OQ),
+                                                                           _mm256_cmp_ps(V, zeroV, _CMP_GT_OQ)),
+                                                              _mm256_cmp_ps(W, zeroV, _CMP_GT_OQ));
+                            __m256 anyZero = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zeroV, _CMP_EQ_OQ),
+                                                                       _mm256_cmp_ps(V, zeroV, _CMP_EQ_OQ)),
+                                                          _mm256_cmp_ps(W, zeroV, _CMP_EQ_OQ));
+
+                            __m256 det = _mm256_add_ps(_mm256_add_ps(U, V), W);
+                            __m256 T = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(U, _mm256_mul_ps(SzV, Akz)),
+                                                                   _mm256_mul_ps(V, _mm256_mul_ps(SzV, Bkz))),
+                                                     _mm256_mul_ps(W, _mm256_mul_ps(SzV, Ckz)));
+                            __m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+                            __m256 t = _mm256_mul_ps(T, invDet);
+
+                            __m256 valid = _mm256_andnot_ps(_mm256_and_ps(anyNegative, anyPositive), activeV);
+                            valid = _mm256_andnot_ps(anyZero, valid);
+                            valid = _mm256_and_ps(valid, _mm256_cmp_ps(det, zeroV, _CMP_NEQ_OQ));
+                            valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, tminV, _CMP_GE_OQ));
+                            valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, hitTV, _CMP_LE_OQ));
+                            if (_mm256_movemask_ps(valid)) {
+                                hitTV = _mm256_blendv_ps(hitTV, t, valid);
+                                hitB1V = _mm256_blendv_ps(hitB1V, _mm256_mul_ps(V, invDet), valid);
+                                hitB2V = _mm256_blendv_ps(hitB2V, _mm256_mul_ps(W, invDet), valid);
+                                hitTriV = _mm256_blendv_ps(hitTriV, _mm256_castsi256_ps(_mm256_set1_epi32(triIdx)), valid);
+                            }
+
+                            // JP: エッジ上ちょうどのレーンはスカラー版で倍精度の再計算を行う。
+                            // EN: Lanes exactly on an edge fall back to the scalar version with double-precision recomputation.
+                            uint32_t zeroMask = _mm256_movemask_ps(anyZero) & activeMask;
+                            if (zeroMask) {
+                                alignas(32) float hitTs[8], hitB1s[8], hitB2s[8];
+                                alignas(32) int32_t hitTris[8];
+                                _mm256_store_ps(hitTs, hitTV);
+                                _mm256_store_ps(hitB1s, hitB1V);
+                                _mm256_store_ps(hitB2s, hitB2V);
+                                _mm256_store_si256((__m256i*)hitTris, _mm256_castps_si256(hitTriV));
+                                for (uint32_t lane = 0; lane < 8; ++lane) {
+                                    if ((zeroMask & (1u << lane)) == 0)
+                                        continue;
+                                    float tt, b1, b2;
+                                    if (testRayVsTriangle(wtRays[lane], tri, tmins[lane], hitTs[lane], &tt, &b1, &b2)) {
+                                        hitTs[lane] = tt;
+                                        hitB1s[lane] = b1;
+                                        hitB2s[lane] = b2;
+                                        hitTris[lane] = triIdx;
+                                    }
+                                }
+                                hitTV = _mm256_load_ps(hitTs);
+                                hitB1V = _mm256_load_ps(hitB1s);
+                                hitB2V = _mm256_load_ps(hitB2s);
+                                hitTriV = _mm256_castsi256_ps(_mm256_load_si256((const __m256i*)hitTris));
+                            }
+                        }
+                        maxHitT = horizontalMax(_mm256_blendv_ps(_mm256_set1_ps(-INFINITY), hitTV, activeV));
+                        continue;
+                    }
+
+                    // JP: 子ごとに8本のレイを一度に判定する。
+                    // EN: Test 8 rays at once for each child.
+                    const WideNode &node = nodes[entry.index];
+                    StackEntry hitChildren[TriangleAccelerator::Width];
+                    uint32_t numHitChildren = 0;
+                    for (uint32_t c = 0; c < node.numChildren; ++c) {
+                        __m256 tNearV = tminV;
+                        __m256 tFarV = infV;
+                        for (int dim = 0; dim < 3; ++dim) {
+                            __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bounds[dim][c]), orgV[dim]), invDirV[dim]);
+                            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.bounds[dim + 3][c]), orgV[dim]), invDirV[dim]);
+                            tNearV = _mm256_max_ps(tNearV, _mm256_min_ps(t0, t1));
+                            tFarV = _mm256_min_ps(tFarV, _mm256_max_ps(t0, t1));
+                        }
+                        tFarV = _mm256_min_ps(_mm256_mul_ps(tFarV, robustFarScaleV), hitTV);
+                        __m256 hitV = _mm256_and_ps(_mm256_cmp_ps(tNearV, tFarV, _CMP_LE_OQ), activeV);
+                        if (_mm256_movemask_ps(hitV) == 0)
+                            continue;
+
+                        float tNear = horizontalMin(_mm256_blendv_ps(infV, tNearV, hitV));
+                        hitChildren[numHitChildren++] = StackEntry{ node.children[c], node.numTriangles[c], tNear };
+                    }
+                    TriangleAccelerator::pushChildren(stack, &stackIdx, hitChildren, numHitChildren);
+                }
+
+                alignas(32) float hitTs[8], hitB1s[8], hitB2s[8];
+                alignas(32) int32_t hitTris[8];
+                _mm256_store_ps(hitTs, hitTV);
+                _mm256_store_ps(hitB1s, hitB1V);
+                _mm256_store_ps(hitB2s, hitB2V);
+                _mm256_store_si256((__m256i*)hitTris, _mm256_castps_si256(hitTriV));
+                for (uint32_t lane = 0; lane < numRays; ++lane) {
+                    RayHit &hit = hits[lane];
+                    if (hitTris[lane] < 0) {
+                        hit.instIndex = InvalidIndex;
+                        continue;
+                    }
+                    const Triangle &tri = triangles[hitTris[lane]];
+                    hit.t = hitTs[lane];
+                    hit.b1 = hitB1s[lane];
+                    hit.b2 = hitB2s[lane];
+                    hit.instIndex = tri.instIndex;
+                    hit.primIndex = tri.primIndex;
+                }
+            }
+        }
+    }
+}
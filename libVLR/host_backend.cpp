@@ -0,0 +1,823 @@
+﻿#include "backend.h"
+
+#include <mutex>
+
+namespace VLR {
+    namespace Backend {
+        static RTsize getFormatSize(RTformat format) {
+            switch (format) {
+            case RT_FORMAT_BYTE:
+            case RT_FORMAT_UNSIGNED_BYTE:
+                return 1;
+            case RT_FORMAT_BYTE2:
+            case RT_FORMAT_UNSIGNED_BYTE2:
+            case RT_FORMAT_SHORT:
+            case RT_FORMAT_UNSIGNED_SHORT:
+            case RT_FORMAT_HALF:
+                return 2;
+            case RT_FORMAT_BYTE3:
+            case RT_FORMAT_UNSIGNED_BYTE3:
+                return 3;
+            case RT_FORMAT_BYTE4:
+            case RT_FORMAT_UNSIGNED_BYTE4:
+            case RT_FORMAT_SHORT2:
+            case RT_FORMAT_UNSIGNED_SHORT2:
+            case RT_FORMAT_HALF2:
+            case RT_FORMAT_FLOAT:
+            case RT_FORMAT_INT:
+            case RT_FORMAT_UNSIGNED_INT:
+            case RT_FORMAT_BUFFER_ID:
+            case RT_FORMAT_PROGRAM_ID:
+                return 4;
+            case RT_FORMAT_SHORT3:
+            case RT_FORMAT_UNSIGNED_SHORT3:
+            case RT_FORMAT_HALF3:
+                return 6;
+            case RT_FORMAT_SHORT4:
+            case RT_FORMAT_UNSIGNED_SHORT4:
+            case RT_FORMAT_HALF4:
+            case RT_FORMAT_FLOAT2:
+            case RT_FORMAT_INT2:
+            case RT_FORMAT_UNSIGNED_INT2:
+            case RT_FORMAT_UNSIGNED_BC1:
+            case RT_FORMAT_UNSIGNED_BC4:
+            case RT_FORMAT_BC4:
+                return 8;
+            case RT_FORMAT_FLOAT3:
+            case RT_FORMAT_INT3:
+            case RT_FORMAT_UNSIGNED_INT3:
+                return 12;
+            case RT_FORMAT_FLOAT4:
+            case RT_FORMAT_INT4:
+            case RT_FORMAT_UNSIGNED_INT4:
+            case RT_FORMAT_UNSIGNED_BC2:
+            case RT_FORMAT_UNSIGNED_BC3:
+            case RT_FORMAT_UNSIGNED_BC5:
+            case RT_FORMAT_BC5:
+            case RT_FORMAT_UNSIGNED_BC6H:
+            case RT_FORMAT_BC6H:
+            case RT_FORMAT_UNSIGNED_BC7:
+                return 16;
+            default:
+                return 0;
+            }
+        }
+
+        // JP: 逆行列が与えられない場合に余因子展開で求める。
+        // EN: Compute the inverse by cofactor expansion when an inverse matrix is not given.
+        static bool invertMatrix(const float m[16], float inv[16]) {
+            float c[16];
+            c[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+            c[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+            c[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+            c[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+            c[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+            c[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+            c[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+            c[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+            c[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+            c[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+            c[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+            c[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+            c[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+            c[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+            c[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+            c[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+            float det = m[0] * c[0] + m[1] * c[4] + m[2] * c[8] + m[3] * c[12];
+            if (det == 0.0f)
+                return false;
+            for (int i = 0; i < 16; ++i)
+                inv[i] = c[i] / det;
+            return true;
+        }
+
+        static void copyMatrix(const float* src, bool transpose, float* dst) {
+            for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col)
+                    dst[4 * row + col] = transpose ? src[4 * col + row] : src[4 * row + col];
+            }
+        }
+
+        class HostBuffer;
+        class HostTextureSampler;
+
+        // JP: IDからバッファーとテクスチャーサンプラーを引く表。
+        //     CPUレンダラーのワーカースレッドからも引かれるのでロックで保護する。
+        // EN: Table to look up buffers and texture samplers from IDs.
+        //     Protect it by a lock since the worker threads of the CPU renderer also look up it.
+        class HostRegistry {
+            mutable std::mutex m_mutex;
+            std::map<int32_t, std::weak_ptr<HostBuffer>> m_buffers;
+            std::map<int32_t, std::weak_ptr<HostTextureSampler>> m_samplers;
+            int32_t m_nextBufferID;
+            int32_t m_nextSamplerID;
+            int32_t m_nextProgramID;
+
+        public:
+            HostRegistry() : m_nextBufferID(1), m_nextSamplerID(1), m_nextProgramID(1) {}
+
+            int32_t add(const std::shared_ptr<HostBuffer> &buffer) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                int32_t id = m_nextBufferID++;
+                m_buffers[id] = buffer;
+                return id;
+            }
+            int32_t add(const std::shared_ptr<HostTextureSampler> &sampler) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                int32_t id = m_nextSamplerID++;
+                m_samplers[id] = sampler;
+                return id;
+            }
+            int32_t allocateProgramID() {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_nextProgramID++;
+            }
+
+            void removeBuffer(int32_t id) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_buffers.erase(id);
+            }
+            void removeTextureSampler(int32_t id) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_samplers.erase(id);
+            }
+
+            std::shared_ptr<HostBuffer> getBuffer(int32_t id) const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_buffers.find(id);
+                if (it == m_buffers.cend())
+                    return nullptr;
+                return it->second.lock();
+            }
+            std::shared_ptr<HostTextureSampler> getTextureSampler(int32_t id) const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_samplers.find(id);
+                if (it == m_samplers.cend())
+                    return nullptr;
+                return it->second.lock();
+            }
+        };
+
+
+
+        // JP: 変数はオブジェクトへの参照か値のバイト列のどちらかを保持する。
+        // EN: A variable holds either a reference to an object or the bytes of a value.
+        class HostVariable : public VariableObj {
+            Buffer m_buffer;
+            TextureSampler m_sampler;
+            Program m_program;
+            Group m_group;
+            std::vector<uint8_t> m_data;
+
+            void clear() {
+                m_buffer = nullptr;
+                m_sampler = nullptr;
+                m_program = nullptr;
+                m_group = nullptr;
+                m_data.clear();
+            }
+
+            template <typename ValueType>
+            void setValue(const ValueType &value) {
+                setUserData(sizeof(value), &value);
+            }
+            template <typename ValueType>
+            ValueType getValue() const {
+                ValueType value;
+                getUserData(sizeof(value), &value);
+                return value;
+            }
+
+        public:
+            void set(const Buffer &buffer) override {
+                clear();
+                m_buffer = buffer;
+            }
+            void set(const TextureSampler &sampler) override {
+                clear();
+                m_sampler = sampler;
+            }
+            void set(const Program &program) override {
+                clear();
+                m_program = program;
+            }
+            void set(const Group &group) override {
+                clear();
+                m_group = group;
+            }
+            Buffer getBuffer() const override {
+                return m_buffer;
+            }
+            TextureSampler getTextureSampler() const override {
+                return m_sampler;
+            }
+            Program getProgram() const override {
+                return m_program;
+            }
+            Group getGroup() const override {
+                return m_group;
+            }
+
+            void setFloat(float f) override {
+                setValue(f);
+            }
+            void setInt(int32_t i) override {
+                setValue(i);
+            }
+            void setUint(uint32_t u) override {
+                setValue(u);
+            }
+            void setUint(const optix::uint2 &u) override {
+                setValue(u);
+            }
+            float getFloat() const override {
+                return getValue<float>();
+            }
+            int32_t getInt() const override {
+                return getValue<int32_t>();
+            }
+            uint32_t getUint() const override {
+                return getValue<uint32_t>();
+            }
+            optix::uint2 getUint2() const override {
+                return getValue<optix::uint2>();
+            }
+
+            void setUserData(RTsize size, const void* ptr) override {
+                clear();
+                auto bytes = reinterpret_cast<const uint8_t*>(ptr);
+                m_data.assign(bytes, bytes + size);
+            }
+            void getUserData(RTsize size, void* ptr) const override {
+                VLRAssert(size == m_data.size(), "Size mismatch: %u != %u.", (uint32_t)size, (uint32_t)m_data.size());
+                std::copy_n(m_data.data(), size, reinterpret_cast<uint8_t*>(ptr));
+            }
+        };
+
+        // JP: 変数を持つオブジェクトの共通部分。
+        // EN: Common part of objects having variables.
+        template <typename InterfaceObjectType>
+        class HostScopedObject : public InterfaceObjectType {
+            std::map<std::string, Variable> m_variables;
+
+        public:
+            Variable declareVariable(const std::string &name) override {
+                Variable &variable = m_variables[name];
+                if (!variable)
+                    variable = Variable(std::make_shared<HostVariable>());
+                return variable;
+            }
+            Variable queryVariable(const std::string &name) const override {
+                auto it = m_variables.find(name);
+                if (it == m_variables.cend())
+                    return nullptr;
+                return it->second;
+            }
+
+        protected:
+            void clearVariables() {
+                m_variables.clear();
+            }
+        };
+
+
+
+        class HostBuffer : public BufferObj {
+            std::shared_ptr<HostRegistry> m_registry;
+            int32_t m_id;
+            uint32_t m_type;
+            RTformat m_format;
+            RTsize m_elementSize;
+            uint32_t m_dimensionality;
+            RTsize m_size[2];
+            uint32_t m_mipLevelCount;
+            std::vector<std::vector<uint8_t>> m_levels;
+
+            RTsize getLevelSize(uint32_t level, uint32_t dim) const {
+                return std::max<RTsize>(m_size[dim] >> level, 1);
+            }
+
+        public:
+            HostBuffer(const std::shared_ptr<HostRegistry> &registry, uint32_t type) :
+                m_registry(registry), m_id(0), m_type(type),
+                m_format(RT_FORMAT_UNKNOWN), m_elementSize(0),
+                m_dimensionality(1), m_size{ 0, 1 }, m_mipLevelCount(1) {}
+
+            void setId(int32_t id) {
+                m_id = id;
+            }
+
+            void destroy() override {
+                m_levels.clear();
+                m_levels.shrink_to_fit();
+                m_registry->removeBuffer(m_id);
+            }
+
+            int32_t getId() const override {
+                return m_id;
+            }
+
+            void setFormat(RTformat format) override {
+                VLRAssert(format == RT_FORMAT_USER || getFormatSize(format) > 0, "Unsupported format: 0x%x.", format);
+                m_format = format;
+                m_elementSize = getFormatSize(format);
+            }
+            RTformat getFormat() const override {
+                return m_format;
+            }
+            void setElementSize(RTsize size) override {
+                VLRAssert(m_format == RT_FORMAT_USER, "Element size can be set only for RT_FORMAT_USER.");
+                m_elementSize = size;
+            }
+            RTsize getElementSize() const override {
+                return m_elementSize;
+            }
+            void setSize(RTsize width) override {
+                m_dimensionality = 1;
+                m_size[0] = width;
+                m_size[1] = 1;
+            }
+            void setSize(RTsize width, RTsize height) override {
+                m_dimensionality = 2;
+                m_size[0] = width;
+                m_size[1] = height;
+            }
+            void getSize(RTsize &width) const override {
+                VLRAssert(m_dimensionality == 1, "Dimensionality mismatch.");
+                width = m_size[0];
+            }
+            void getSize(RTsize &width, RTsize &height) const override {
+                VLRAssert(m_dimensionality == 2, "Dimensionality mismatch.");
+                width = m_size[0];
+                height = m_size[1];
+            }
+            uint32_t getDimensionality() const override {
+                return m_dimensionality;
+            }
+            void setMipLevelCount(uint32_t levels) override {
+                VLRAssert(levels > 0, "Number of mip levels must be at least 1.");
+                m_mipLevelCount = levels;
+            }
+            uint32_t getMipLevelCount() const override {
+                return m_mipLevelCount;
+            }
+            void getMipLevelSize(uint32_t level, RTsize &width, RTsize &height) const override {
+                VLRAssert(level < m_mipLevelCount, "Mip level is out of range.");
+                width = getLevelSize(level, 0);
+                height = getLevelSize(level, 1);
+            }
+
+            // JP: マップしたレベルの内容を現在の大きさに合わせる。大きさが変わらない限り内容は保たれる。
+            // EN: Fit the contents of a mapped level to the current size. The contents are kept as long as the size doesn't change.
+            void* map(uint32_t level, uint32_t mapFlags) override {
+                VLRAssert(level < m_mipLevelCount, "Mip level is out of range.");
+                if (m_levels.size() < m_mipLevelCount)
+                    m_levels.resize(m_mipLevelCount);
+                std::vector<uint8_t> &data = m_levels[level];
+                data.resize(m_elementSize * getLevelSize(level, 0) * getLevelSize(level, 1));
+                return data.data();
+            }
+            void unmap(uint32_t level) override {
+                VLRAssert(level < m_mipLevelCount, "Mip level is out of range.");
+            }
+        };
+
+        class HostTextureSampler : public TextureSamplerObj {
+            std::shared_ptr<HostRegistry> m_registry;
+            int32_t m_id;
+            Buffer m_buffer;
+            RTwrapmode m_wrapModes[3];
+            RTfiltermode m_minFilter;
+            RTfiltermode m_magFilter;
+            RTfiltermode m_mipFilter;
+            RTtexturereadmode m_readMode;
+            RTtextureindexmode m_indexingMode;
+            float m_maxAnisotropy;
+            uint32_t m_mipLevelCount;
+
+        public:
+            HostTextureSampler(const std::shared_ptr<HostRegistry> &registry) :
+                m_registry(registry), m_id(0),
+                m_wrapModes{ RT_WRAP_REPEAT, RT_WRAP_REPEAT, RT_WRAP_REPEAT },
+                m_minFilter(RT_FILTER_LINEAR), m_magFilter(RT_FILTER_LINEAR), m_mipFilter(RT_FILTER_NONE),
+                m_readMode(RT_TEXTURE_READ_NORMALIZED_FLOAT), m_indexingMode(RT_TEXTURE_INDEX_NORMALIZED_COORDINATES),
+                m_maxAnisotropy(1.0f), m_mipLevelCount(1) {}
+
+            void setId(int32_t id) {
+                m_id = id;
+            }
+
+            void destroy() override {
+                m_buffer = nullptr;
+                m_registry->removeTextureSampler(m_id);
+            }
+
+            int32_t getId() const override {
+                return m_id;
+            }
+
+            void setBuffer(const Buffer &buffer) override {
+                m_buffer = buffer;
+            }
+            Buffer getBuffer() const override {
+                return m_buffer;
+            }
+            void setWrapMode(uint32_t dim, RTwrapmode mode) override {
+                VLRAssert(dim < 3, "Dimension is out of range.");
+                m_wrapModes[dim] = mode;
+            }
+            RTwrapmode getWrapMode(uint32_t dim) const override {
+                VLRAssert(dim < 3, "Dimension is out of range.");
+                return m_wrapModes[dim];
+            }
+            void setFilteringModes(RTfiltermode minification, RTfiltermode magnification, RTfiltermode mipmapping) override {
+                m_minFilter = minification;
+                m_magFilter = magnification;
+                m_mipFilter = mipmapping;
+            }
+            void getFilteringModes(RTfiltermode &minification, RTfiltermode &magnification, RTfiltermode &mipmapping) const override {
+                minification = m_minFilter;
+                magnification = m_magFilter;
+                mipmapping = m_mipFilter;
+            }
+            void setReadMode(RTtexturereadmode mode) override {
+                m_readMode = mode;
+            }
+            RTtexturereadmode getReadMode() const override {
+                return m_readMode;
+            }
+            void setIndexingMode(RTtextureindexmode mode) override {
+                m_indexingMode = mode;
+            }
+            RTtextureindexmode getIndexingMode() const override {
+                return m_indexingMode;
+            }
+            void setMaxAnisotropy(float value) override {
+                m_maxAnisotropy = value;
+            }
+            void setMipLevelCount(uint32_t count) override {
+                m_mipLevelCount = count;
+            }
+        };
+
+        // JP: プログラムの実体はCPUレンダラーがIDに登録したホスト関数である。
+        // EN: The actual program is a host function the CPU renderer registers to the ID.
+        class HostProgram : public HostScopedObject<ProgramObj> {
+            int32_t m_id;
+
+        public:
+            HostProgram(int32_t id) : m_id(id) {}
+
+            void destroy() override {
+                clearVariables();
+            }
+
+            int32_t getId() const override {
+                return m_id;
+            }
+        };
+
+        class HostGeometry : public HostScopedObject<GeometryObj> {
+            uint32_t m_primitiveCount;
+            Program m_intersectionProgram;
+            Program m_boundingBoxProgram;
+
+        public:
+            HostGeometry() : m_primitiveCount(0) {}
+
+            void destroy() override {
+                clearVariables();
+                m_intersectionProgram = nullptr;
+                m_boundingBoxProgram = nullptr;
+            }
+
+            void setPrimitiveCount(uint32_t count) override {
+                m_primitiveCount = count;
+            }
+            void setIntersectionProgram(const Program &program) override {
+                m_intersectionProgram = program;
+            }
+            void setBoundingBoxProgram(const Program &program) override {
+                m_boundingBoxProgram = program;
+            }
+        };
+
+        class HostGeometryTriangles : public HostScopedObject<GeometryTrianglesObj> {
+            uint32_t m_primitiveCount;
+            Buffer m_indexBuffer;
+            Buffer m_vertexBuffer;
+            uint32_t m_numVertices;
+            Program m_attributeProgram;
+
+        public:
+            HostGeometryTriangles() : m_primitiveCount(0), m_numVertices(0) {}
+
+            void destroy() override {
+                clearVariables();
+                m_indexBuffer = nullptr;
+                m_vertexBuffer = nullptr;
+                m_attributeProgram = nullptr;
+            }
+
+            void setPrimitiveCount(uint32_t count) override {
+                m_primitiveCount = count;
+            }
+            void setTriangleIndices(const Buffer &indexBuffer, RTsize indexBufferByteOffset, RTsize triIndicesByteStride, RTformat triIndicesFormat) override {
+                m_indexBuffer = indexBuffer;
+            }
+            void setVertices(uint32_t numVertices, const Buffer &vertexBuffer, RTsize vertexBufferByteOffset, RTsize vertexByteStride, RTformat positionFormat) override {
+                m_numVertices = numVertices;
+                m_vertexBuffer = vertexBuffer;
+            }
+            void setAttributeProgram(const Program &program) override {
+                m_attributeProgram = program;
+            }
+            void setBuildFlags(RTgeometrybuildflags flags) override {
+            }
+        };
+
+        class HostMaterial : public HostScopedObject<MaterialObj> {
+            std::vector<Program> m_closestHitPrograms;
+            std::vector<Program> m_anyHitPrograms;
+
+            static void setProgram(std::vector<Program> &programs, uint32_t rayTypeIndex, const Program &program) {
+                if (programs.size() <= rayTypeIndex)
+                    programs.resize(rayTypeIndex + 1);
+                programs[rayTypeIndex] = program;
+            }
+
+        public:
+            void destroy() override {
+                clearVariables();
+                m_closestHitPrograms.clear();
+                m_anyHitPrograms.clear();
+            }
+
+            void setClosestHitProgram(uint32_t rayTypeIndex, const Program &program) override {
+                setProgram(m_closestHitPrograms, rayTypeIndex, program);
+            }
+            void setAnyHitProgram(uint32_t rayTypeIndex, const Program &program) override {
+                setProgram(m_anyHitPrograms, rayTypeIndex, program);
+            }
+        };
+
+        class HostGeometryInstance : public HostScopedObject<GeometryInstanceObj> {
+            Geometry m_geometry;
+            GeometryTriangles m_geometryTriangles;
+            std::vector<Material> m_materials;
+
+        public:
+            void destroy() override {
+                clearVariables();
+                m_geometry = nullptr;
+                m_geometryTriangles = nullptr;
+                m_materials.clear();
+            }
+
+            void setGeometry(const Geometry &geometry) override {
+                m_geometry = geometry;
+            }
+            void setGeometryTriangles(const GeometryTriangles &geometryTriangles) override {
+                m_geometryTriangles = geometryTriangles;
+            }
+            void setMaterialCount(uint32_t count) override {
+                m_materials.resize(count);
+            }
+            void setMaterial(uint32_t index, const Material &material) override {
+                VLRAssert(index < m_materials.size(), "Material index is out of range.");
+                m_materials[index] = material;
+            }
+        };
+
+        // JP: ホストの走査用の加速構造はシーンのルートノードが持つので、ここでは何も構築しない。
+        // EN: The root node of a scene has the acceleration structure for host traversal, so this builds nothing.
+        class HostAcceleration : public AccelerationObj {
+        public:
+            void destroy() override {
+            }
+
+            void markDirty() override {
+            }
+        };
+
+        class HostGeometryGroup : public GeometryGroupObj {
+            Acceleration m_acceleration;
+            std::vector<GeometryInstance> m_children;
+
+        public:
+            void destroy() override {
+                m_acceleration = nullptr;
+                m_children.clear();
+            }
+
+            void setAcceleration(const Acceleration &acceleration) override {
+                m_acceleration = acceleration;
+            }
+            void addChild(const GeometryInstance &geomInst) override {
+                m_children.push_back(geomInst);
+            }
+            void removeChild(const GeometryInstance &geomInst) override {
+                auto it = std::find(m_children.begin(), m_children.end(), geomInst);
+                VLRAssert(it != m_children.end(), "The geometry instance is not a child.");
+                m_children.erase(it);
+            }
+        };
+
+        class HostGroup : public GroupObj {
+            Acceleration m_acceleration;
+            std::vector<Transform> m_transforms;
+            std::vector<GeometryGroup> m_geomGroups;
+
+            template <typename ChildType>
+            static void removeChild(std::vector<ChildType> &children, const ChildType &child) {
+                auto it = std::find(children.begin(), children.end(), child);
+                VLRAssert(it != children.end(), "The object is not a child.");
+                children.erase(it);
+            }
+
+        public:
+            void destroy() override {
+                m_acceleration = nullptr;
+                m_transforms.clear();
+                m_geomGroups.clear();
+            }
+
+            void setAcceleration(const Acceleration &acceleration) override {
+                m_acceleration = acceleration;
+            }
+            void addChild(const Transform &transform) override {
+                m_transforms.push_back(transform);
+            }
+            void addChild(const GeometryGroup &geomGroup) override {
+                m_geomGroups.push_back(geomGroup);
+            }
+            void removeChild(const Transform &transform) override {
+                removeChild(m_transforms, transform);
+            }
+            void removeChild(const GeometryGroup &geomGroup) override {
+                removeChild(m_geomGroups, geomGroup);
+            }
+        };
+
+        class HostTransform : public TransformObj {
+            GeometryGroup m_child;
+            float m_matrix[16];
+            float m_inverseMatrix[16];
+
+        public:
+            HostTransform() {
+                for (int i = 0; i < 16; ++i) {
+                    m_matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+                    m_inverseMatrix[i] = m_matrix[i];
+                }
+            }
+
+            void destroy() override {
+                m_child = nullptr;
+            }
+
+            void setChild(const GeometryGroup &geomGroup) override {
+                m_child = geomGroup;
+            }
+            void setMatrix(bool transpose, const float* matrix, const float* inverseMatrix) override {
+                float newMatrix[16];
+                float newInverseMatrix[16];
+                copyMatrix(matrix, transpose, newMatrix);
+                if (inverseMatrix) {
+                    copyMatrix(inverseMatrix, transpose, newInverseMatrix);
+                }
+                else {
+                    bool invertible = invertMatrix(newMatrix, newInverseMatrix);
+                    VLRAssert(invertible, "The matrix is not invertible.");
+                }
+                std::copy_n(newMatrix, 16, m_matrix);
+                std::copy_n(newInverseMatrix, 16, m_inverseMatrix);
+            }
+            void getMatrix(bool transpose, float* matrix, float* inverseMatrix) const override {
+                if (matrix)
+                    copyMatrix(m_matrix, transpose, matrix);
+                if (inverseMatrix)
+                    copyMatrix(m_inverseMatrix, transpose, inverseMatrix);
+            }
+        };
+
+
+
+        class HostContext : public HostScopedObject<ContextObj> {
+            std::shared_ptr<HostRegistry> m_registry;
+            RTsize m_stackSize;
+
+        public:
+            HostContext() : m_registry(std::make_shared<HostRegistry>()), m_stackSize(0) {}
+
+            void destroy() override {
+                clearVariables();
+            }
+
+            Buffer createBuffer(uint32_t type) override {
+                auto buffer = std::make_shared<HostBuffer>(m_registry, type);
+                buffer->setId(m_registry->add(buffer));
+                return Buffer(buffer);
+            }
+            Buffer createBuffer(uint32_t type, RTformat format) override {
+                Buffer buffer = createBuffer(type);
+                buffer->setFormat(format);
+                return buffer;
+            }
+            Buffer createBuffer(uint32_t type, RTformat format, RTsize width) override {
+                Buffer buffer = createBuffer(type, format);
+                buffer->setSize(width);
+                return buffer;
+            }
+            Buffer createBuffer(uint32_t type, RTformat format, RTsize width, RTsize height) override {
+                Buffer buffer = createBuffer(type, format);
+                buffer->setSize(width, height);
+                return buffer;
+            }
+            Buffer createBufferFromGLBO(uint32_t type, uint32_t glBufferID) override {
+                return nullptr;
+            }
+            TextureSampler createTextureSampler() override {
+                auto sampler = std::make_shared<HostTextureSampler>(m_registry);
+                sampler->setId(m_registry->add(sampler));
+                return TextureSampler(sampler);
+            }
+            Program createProgramFromPTXString(const std::string &ptx, const std::string &programName) override {
+                return Program(std::make_shared<HostProgram>(m_registry->allocateProgramID()));
+            }
+            Geometry createGeometry() override {
+                return Geometry(std::make_shared<HostGeometry>());
+            }
+            GeometryTriangles createGeometryTriangles() override {
+                return GeometryTriangles(std::make_shared<HostGeometryTriangles>());
+            }
+            GeometryInstance createGeometryInstance() override {
+                return GeometryInstance(std::make_shared<HostGeometryInstance>());
+            }
+            Material createMaterial() override {
+                return Material(std::make_shared<HostMaterial>());
+            }
+            Group createGroup() override {
+                return Group(std::make_shared<HostGroup>());
+            }
+            GeometryGroup createGeometryGroup() override {
+                return GeometryGroup(std::make_shared<HostGeometryGroup>());
+            }
+            Transform createTransform() override {
+                return Transform(std::make_shared<HostTransform>());
+            }
+            Acceleration createAcceleration(const std::string &builder) override {
+                return Acceleration(std::make_shared<HostAcceleration>());
+            }
+
+            Buffer getBufferFromId(int32_t bufferID) const override {
+                return Buffer(m_registry->getBuffer(bufferID));
+            }
+            TextureSampler getTextureSamplerFromId(int32_t samplerID) const override {
+                return TextureSampler(m_registry->getTextureSampler(samplerID));
+            }
+
+            void setEntryPointCount(uint32_t count) override {
+            }
+            void setRayTypeCount(uint32_t count) override {
+            }
+            void setRayGenerationProgram(uint32_t entryPointIndex, const Program &program) override {
+            }
+            void setExceptionProgram(uint32_t entryPointIndex, const Program &program) override {
+            }
+            void setMissProgram(uint32_t rayTypeIndex, const Program &program) override {
+            }
+            void setStackSize(RTsize stackSize) override {
+                m_stackSize = stackSize;
+            }
+            RTsize getStackSize() const override {
+                return m_stackSize;
+            }
+            void setMaxTraceDepth(uint32_t maxDepth) override {
+            }
+            void setMaxCallableProgramDepth(uint32_t maxDepth) override {
+            }
+            void setPrintEnabled(bool enabled) override {
+            }
+            void setPrintBufferSize(RTsize size) override {
+            }
+            void setExceptionEnabled(RTexception exception, bool enabled) override {
+            }
+            void setTimeoutCallback(RTtimeoutcallback callback, double minPollingSeconds) override {
+            }
+
+            void validate() override {
+            }
+            void launch(uint32_t entryPointIndex, RTsize width, RTsize height) override {
+                VLRAssert_ShouldNotBeCalled();
+            }
+        };
+
+
+
+        Context createHostContext() {
+            return Context(std::make_shared<HostContext>());
+        }
+    }
+}
@@ -0,0 +1,180 @@
+﻿#include "image_cache.h"
+
+#include "shader_nodes.h"
+#include "image_filter.h"
+
+namespace VLR {
+    uint64_t computeDataHash(const uint8_t* data, size_t size, uint64_t hash) {
+        const uint64_t Multiplier = 0x9E3779B97F4A7C15;
+        size_t numWords = size / sizeof(uint64_t);
+        for (size_t i = 0; i < numWords; ++i) {
+            uint64_t word;
+            std::memcpy(&word, data + sizeof(uint64_t) * i, sizeof(word));
+            hash = (hash ^ word) * Multiplier;
+            hash ^= hash >> 29;
+        }
+        for (size_t i = sizeof(uint64_t) * numWords; i < size; ++i) {
+            hash = (hash ^ data[i]) * Multiplier;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    uint64_t computeContentHash(const uint8_t* data, size_t size) {
+        const size_t ChunkSize = 1 << 20;
+        uint32_t numChunks = (uint32_t)((size + ChunkSize - 1) / ChunkSize);
+        std::vector<uint64_t> chunkHashes(numChunks);
+        processRowsInParallel(ChunkSize / sizeof(uint64_t), numChunks, [&](uint32_t chunkIdx) {
+            size_t offset = ChunkSize * chunkIdx;
+            chunkHashes[chunkIdx] = computeDataHash(data + offset, std::min(ChunkSize, size - offset), chunkIdx);
+        });
+        return computeDataHash((const uint8_t*)chunkHashes.data(), sizeof(uint64_t) * numChunks, size);
+    }
+
+
+
+    ImageCache::Key ImageCache::createLinearImageKey(const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) {
+        Key key;
+        key.hash = computeContentHash(linearData, sizesOfDataFormats[dataFormat] * width * height);
+        key.width = width;
+        key.height = height;
+        key.dataFormat = dataFormat;
+        key.applyDegamma = applyDegamma;
+        return key;
+    }
+
+    ImageCache::Key ImageCache::createBlockCompressedImageKey(const uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+                                                              VLRDataFormat dataFormat, bool applyDegamma) {
+        // JP: ミップレベル数の違いもキーに含める。
+        // EN: The difference in the number of mip levels is also included in the key.
+        std::vector<uint64_t> levelHashes(mipCount);
+        for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel)
+            levelHashes[mipLevel] = computeContentHash(data[mipLevel], sizes[mipLevel]);
+
+        Key key;
+        key.hash = computeDataHash((const uint8_t*)levelHashes.data(), sizeof(uint64_t) * mipCount, mipCount);
+        key.width = width;
+        key.height = height;
+        key.dataFormat = dataFormat;
+        key.applyDegamma = applyDegamma;
+        return key;
+    }
+
+    ImageCache::ImageCache() : m_unreferencedSize(0), m_capacity(512 * 1024 * 1024) {
+    }
+
+    ImageCache::~ImageCache() {
+        VLRAssert(m_entries.empty(), "Image cache must be cleared before destruction.");
+    }
+
+    void ImageCache::evict(size_t capacity, std::vector<Image2D*>* evictedImages) {
+        while (m_unreferencedSize > capacity) {
+            const Image2D* image = m_unreferencedImages.back();
+            m_unreferencedImages.pop_back();
+
+            auto position = m_positions.find(image);
+            const Entry &entry = position->second->second;
+            m_unreferencedSize -= entry.size;
+            evictedImages->push_back(entry.image);
+            m_entries.erase(position->second);
+            m_positions.erase(position);
+        }
+    }
+
+    Image2D* ImageCache::addOrAcquire(const Key &key, Image2D* image, size_t size, const DataComparator &hasSameData) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto range = m_entries.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            Entry &entry = it->second;
+            if (!hasSameData(entry.image))
+                continue;
+
+            if (entry.refCount == 0) {
+                m_unreferencedImages.erase(entry.unreferencedPosition);
+                m_unreferencedSize -= entry.size;
+            }
+            ++entry.refCount;
+
+            return entry.image;
+        }
+
+        Entry entry;
+        entry.image = image;
+        entry.size = size;
+        entry.refCount = 1;
+        m_positions[image] = m_entries.insert(std::make_pair(key, entry));
+
+        return image;
+    }
+
+    bool ImageCache::release(Image2D* image) {
+        std::vector<Image2D*> evictedImages;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto position = m_positions.find(image);
+            if (position == m_positions.end())
+                return false;
+
+            Entry &entry = position->second->second;
+            VLRAssert(entry.refCount > 0, "Reference count is already 0.");
+            --entry.refCount;
+            if (entry.refCount == 0) {
+                m_unreferencedImages.push_front(image);
+                entry.unreferencedPosition = m_unreferencedImages.begin();
+                m_unreferencedSize += entry.size;
+                evict(m_capacity, &evictedImages);
+            }
+        }
+
+        for (Image2D* evictedImage : evictedImages)
+            delete evictedImage;
+
+        return true;
+    }
+
+    bool ImageCache::detach(const Image2D* image) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto position = m_positions.find(image);
+        if (position == m_positions.end())
+            return true;
+
+        const Entry &entry = position->second->second;
+        if (entry.refCount > 1)
+            return false;
+        VLRAssert(entry.refCount == 1, "Detaching an image without references.");
+
+        m_entries.erase(position->second);
+        m_positions.erase(position);
+
+        return true;
+    }
+
+    void ImageCache::setCapacity(size_t capacity) {
+        std::vector<Image2D*> evictedImages;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_capacity = capacity;
+            evict(m_capacity, &evictedImages);
+        }
+
+        for (Image2D* evictedImage : evictedImages)
+            delete evictedImage;
+    }
+
+    void ImageCache::clear() {
+        std::vector<Image2D*> images;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto &it : m_entries)
+                images.push_back(it.second.image);
+            m_entries.clear();
+            m_positions.clear();
+            m_unreferencedImages.clear();
+            m_unreferencedSize = 0;
+        }
+
+        for (Image2D* image : images)
+            delete image;
+    }
+}
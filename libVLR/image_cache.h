@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+#include <mutex>
+
+namespace VLR {
+    // JP: 64ビット単位で混ぜ合わせるハッシュ。hashに前のデータのハッシュを渡すと続けて混ぜ合わせる。
+    // EN: Hash mixing in 64-bit units. Passing the hash of preceding data as hash continues mixing.
+    uint64_t computeDataHash(const uint8_t* data, size_t size, uint64_t hash);
+    // JP: 大きなデータをチャンクに分けて並列にハッシュし、チャンクのハッシュを混ぜ合わせる。computeDataHash()とは別の値になる。
+    // EN: Hash large data by splitting it into chunks hashed in parallel, then mix the chunk hashes. The value differs from computeDataHash().
+    uint64_t computeContentHash(const uint8_t* data, size_t size);
+
+
+
+    class Image2D;
+
+    // JP: 画素データの内容をキーにした画像のキャッシュ。同じ内容の画像の生成には既存の画像を共有して返す。
+    //     キーはハッシュなので、共有する前に画素データ全体を比べて衝突を除く。
+    //     画像は参照カウントで管理し、参照が無くなった画像は容量の範囲で最近使われた順に保持して、同じ内容の再生成に備える。
+    //     容量を超えると最も長く使われていないものから破棄する。参照中の画像は容量に関わらず破棄しない。
+    //     共有された画像は変更できない。generateMipmaps()などの変更の前にdetach()でキャッシュから外す。
+    //     複数のスレッドから画像を作れるようにロックで保護する。
+    // EN: Cache of images keyed by the content of the pixel data. Creating an image with the same content returns the existing image shared.
+    //     The key is a hash, so the whole pixel data is compared to rule out collisions before sharing.
+    //     Images are reference-counted, and images no longer referenced are kept in the order of recent use within the capacity, ready for recreation with the same content.
+    //     Exceeding the capacity discards the least recently used ones. Referenced images are never discarded regardless of the capacity.
+    //     A shared image is immutable. Remove it from the cache with detach() before modifications like generateMipmaps().
+    //     Protected by a lock so that images can be created from multiple threads.
+    class ImageCache {
+    public:
+        struct Key {
+            uint64_t hash;
+            uint32_t width;
+            uint32_t height;
+            VLRDataFormat dataFormat;
+            bool applyDegamma;
+
+            bool operator<(const Key &r) const {
+                if (hash != r.hash)
+                    return hash < r.hash;
+                if (width != r.width)
+                    return width < r.width;
+                if (height != r.height)
+                    return height < r.height;
+                if (dataFormat != r.dataFormat)
+                    return dataFormat < r.dataFormat;
+                return applyDegamma < r.applyDegamma;
+            }
+        };
+
+        // JP: 登録済みの画像が新しい画像と同じ画素データを持つかを返す関数。
+        // EN: Function returning whether a registered image has the same pixel data as the new image.
+        typedef std::function<bool(const Image2D*)> DataComparator;
+
+        static Key createLinearImageKey(const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma);
+        static Key createBlockCompressedImageKey(const uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+                                                 VLRDataFormat dataFormat, bool applyDegamma);
+
+    private:
+        struct Entry {
+            Image2D* image;
+            size_t size;
+            uint32_t refCount;
+            std::list<const Image2D*>::iterator unreferencedPosition;
+        };
+
+        mutable std::mutex m_mutex;
+        // JP: ハッシュが衝突した別の内容の画像も同じキーで保持できるようにする。
+        // EN: Allow holding images with different contents whose hashes collide under the same key.
+        std::multimap<Key, Entry> m_entries;
+        std::map<const Image2D*, std::multimap<Key, Entry>::iterator> m_positions;
+        // JP: 参照の無い画像。先頭が最近解放されたもの。
+        // EN: Images without references. The head is the most recently released one.
+        std::list<const Image2D*> m_unreferencedImages;
+        size_t m_unreferencedSize;
+        size_t m_capacity;
+
+        // JP: 追い出した画像はロックの外で破棄するように返す。破棄がコールバックを呼び、そこから再びキャッシュが使われうるため。
+        // EN: Evicted images are returned to be destroyed outside the lock, since destruction calls callbacks, which may use the cache again.
+        void evict(size_t capacity, std::vector<Image2D*>* evictedImages);
+
+    public:
+        ImageCache();
+        ~ImageCache();
+
+        // JP: 新しく作った画像を参照数1で登録して返す。
+        //     同じキーで画素データも同じ画像が既にある場合は、その参照を増やして代わりに返すので、呼び出し側は渡した画像を破棄する。
+        //     sizeは画素データの大きさ。
+        // EN: Register a newly created image with a reference count of 1 and return it.
+        //     If an image with the same key and the same pixel data already exists, this returns it instead after incrementing its reference count,
+        //     so the caller destroys the passed image.
+        //     size is the size of the pixel data.
+        Image2D* addOrAcquire(const Key &key, Image2D* image, size_t size, const DataComparator &hasSameData);
+        // JP: 参照を減らす。キャッシュが管理していない画像の場合はfalseを返し、呼び出し側が破棄する。
+        // EN: Decrement the reference count. Return false if the image is not managed by the cache, in which case the caller destroys it.
+        bool release(Image2D* image);
+        // JP: 変更する画像をキャッシュから外し、以後は共有しない。他から共有されている場合は外せないのでfalseを返す。
+        //     キャッシュが管理していない画像の場合は何もせずにtrueを返す。
+        // EN: Remove an image about to be modified from the cache, never sharing it afterward. Return false if it is shared by others since it cannot be removed.
+        //     Return true without doing anything if the image is not managed by the cache.
+        bool detach(const Image2D* image);
+
+        // JP: 参照の無い画像を保持する容量(バイト)。0の場合は参照が無くなった時点で破棄する。
+        // EN: Capacity (in bytes) to keep images without references. If 0, images are discarded as soon as they lose their references.
+        void setCapacity(size_t capacity);
+        // JP: 参照の有無に関わらずすべての画像を破棄する。コンテキストの破棄時に呼ぶ。
+        // EN: Discard all the images regardless of their references. Called on destruction of the context.
+        void clear();
+    };
+}
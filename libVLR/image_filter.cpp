@@ -0,0 +1,249 @@
+﻿#include "image_filter.h"
+
+namespace VLR {
+    static float sinc(float x) {
+        if (std::fabs(x) < 1e-6f)
+            return 1.0f;
+        x *= (float)M_PI;
+        return std::sin(x) / x;
+    }
+
+    // JP: 第1種変形ベッセル関数I0の級数展開。
+    // EN: Series expansion of the modified Bessel function of the first kind I0.
+    static double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        double halfX = 0.5 * x;
+        for (int k = 1; k < 32; ++k) {
+            term *= (halfX / k) * (halfX / k);
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    // JP: Kaiser窓付きsinc(幅3, α = 4)とLanczos3の半径。
+    // EN: Radii of the Kaiser-windowed sinc (width 3, alpha = 4) and Lanczos3.
+    static constexpr float KaiserRadius = 3.0f;
+    static constexpr float KaiserAlpha = 4.0f;
+    static constexpr float LanczosRadius = 3.0f;
+
+    static float getFilterRadius(VLRMipmapFilter filter) {
+        switch (filter) {
+        case VLRMipmapFilter_Box:
+            return 0.5f;
+        case VLRMipmapFilter_Kaiser:
+            return KaiserRadius;
+        case VLRMipmapFilter_Lanczos:
+            return LanczosRadius;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return 0.5f;
+        }
+    }
+
+    static float evaluateFilter(VLRMipmapFilter filter, float x) {
+        switch (filter) {
+        case VLRMipmapFilter_Kaiser: {
+            float t = x / KaiserRadius;
+            if (std::fabs(t) >= 1.0f)
+                return 0.0f;
+            static const double invI0Alpha = 1.0 / besselI0(KaiserAlpha);
+            return sinc(x) * (float)(besselI0(KaiserAlpha * std::sqrt(1.0 - t * t)) * invI0Alpha);
+        }
+        case VLRMipmapFilter_Lanczos:
+            if (std::fabs(x) >= LanczosRadius)
+                return 0.0f;
+            return sinc(x) * sinc(x / LanczosRadius);
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return 0.0f;
+        }
+    }
+
+    // JP: 1次元のリサンプルの重み。出力画素ごとにnumTaps個の入力画素のインデックスと正規化された重みを持つ。
+    //     両端が全出力画素で重み0になるタップは取り除く(整数倍の縮小のBoxなど)。
+    // EN: Weights of 1D resampling. Each output pixel has numTaps indices of input pixels and normalized weights.
+    //     Taps at both ends with zero weight for all output pixels are removed (e.g. Box with integer minification ratios).
+    struct FilterWeights {
+        uint32_t numTaps;
+        std::vector<uint32_t> indices;
+        std::vector<float> weights;
+
+        FilterWeights(uint32_t srcSize, uint32_t dstSize, VLRMipmapFilter filter) {
+            float scale = (float)srcSize / dstSize;
+            float filterScale = std::max(scale, 1.0f);
+            float support = getFilterRadius(filter) * (filter == VLRMipmapFilter_Box ? scale : filterScale);
+            uint32_t maxNumTaps = (uint32_t)std::ceil(2 * support) + 1;
+            std::vector<uint32_t> fullIndices(dstSize * maxNumTaps);
+            std::vector<float> fullWeights(dstSize * maxNumTaps);
+
+            uint32_t firstTap = maxNumTaps;
+            uint32_t lastTap = 0;
+            for (uint32_t i = 0; i < dstSize; ++i) {
+                float center = (i + 0.5f) * scale;
+                int32_t first = (int32_t)std::floor(center - support);
+                uint32_t* dstIndices = &fullIndices[i * maxNumTaps];
+                float* dstWeights = &fullWeights[i * maxNumTaps];
+                float sumWeights = 0.0f;
+                for (uint32_t t = 0; t < maxNumTaps; ++t) {
+                    int32_t j = first + (int32_t)t;
+                    float weight;
+                    if (filter == VLRMipmapFilter_Box)
+                        weight = std::max(0.0f, std::min<float>(j + 1, center + support) - std::max<float>(j, center - support));
+                    else
+                        weight = evaluateFilter(filter, (j + 0.5f - center) / filterScale);
+                    dstIndices[t] = (uint32_t)std::min(std::max(j, 0), (int32_t)srcSize - 1);
+                    dstWeights[t] = weight;
+                    sumWeights += weight;
+                    if (weight != 0.0f) {
+                        firstTap = std::min(firstTap, t);
+                        lastTap = std::max(lastTap, t);
+                    }
+                }
+                for (uint32_t t = 0; t < maxNumTaps; ++t)
+                    dstWeights[t] /= sumWeights;
+            }
+
+            numTaps = lastTap - firstTap + 1;
+            indices.resize(dstSize * numTaps);
+            weights.resize(dstSize * numTaps);
+            for (uint32_t i = 0; i < dstSize; ++i) {
+                std::copy_n(&fullIndices[i * maxNumTaps + firstTap], numTaps, &indices[i * numTaps]);
+                std::copy_n(&fullWeights[i * maxNumTaps + firstTap], numTaps, &weights[i * numTaps]);
+            }
+        }
+    };
+
+    // JP: チャンネル数をコンパイル時に固定して、画素内のループを展開、ベクトル化しやすくする。
+    // EN: Fix the number of channels at compile time so that the loop within a pixel is easy to unroll and vectorize.
+    template <uint32_t NumChannels>
+    static void filterRow(const float* srcRow, const FilterWeights &weightsX, uint32_t dstWidth, float* dstRow) {
+        uint32_t numTaps = weightsX.numTaps;
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const uint32_t* indices = &weightsX.indices[x * numTaps];
+            const float* weights = &weightsX.weights[x * numTaps];
+            float sum[NumChannels] = {};
+            for (uint32_t t = 0; t < numTaps; ++t) {
+                const float* src = srcRow + NumChannels * indices[t];
+                for (uint32_t c = 0; c < NumChannels; ++c)
+                    sum[c] += weights[t] * src[c];
+            }
+            std::copy_n(sum, NumChannels, dstRow + NumChannels * x);
+        }
+    }
+
+    // JP: 4チャンネルでは1画素がちょうどSSEの1レジスターに収まるので、タップごとに画素全体を積和する。
+    //     スカラー版ではコンパイラーが画素内のループを自動ベクトル化しても、タップの添字による間接参照のためにレジスターを跨いだ並べ替えが残りやすい。
+    // EN: With 4 channels a pixel fits exactly in an SSE register, so multiply-add the whole pixel per tap.
+    //     Even if the compiler auto-vectorizes the loop within a pixel in the scalar version, shuffles across registers tend to remain due to the indirection via tap indices.
+    template <>
+    void filterRow<4>(const float* srcRow, const FilterWeights &weightsX, uint32_t dstWidth, float* dstRow) {
+        uint32_t numTaps = weightsX.numTaps;
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const uint32_t* indices = &weightsX.indices[x * numTaps];
+            const float* weights = &weightsX.weights[x * numTaps];
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t t = 0; t < numTaps; ++t)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(srcRow + 4 * indices[t])));
+            _mm_storeu_ps(dstRow + 4 * x, sum);
+        }
+    }
+
+    // JP: 垂直方向のフィルターの1タップ分。行は連続しているのでチャンネル数によらず4要素ずつ処理する。
+    // EN: One tap of the vertical filter. Rows are contiguous, so process 4 elements at a time regardless of the number of channels.
+    static void accumulateRow(const float* srcRow, float weight, uint32_t rowLength, float* dstRow) {
+        __m128 w = _mm_set1_ps(weight);
+        uint32_t i = 0;
+        for (; i + 4 <= rowLength; i += 4)
+            _mm_storeu_ps(dstRow + i, _mm_add_ps(_mm_loadu_ps(dstRow + i), _mm_mul_ps(w, _mm_loadu_ps(srcRow + i))));
+        for (; i < rowLength; ++i)
+            dstRow[i] += weight * srcRow[i];
+    }
+
+    static void filterRow(const float* srcRow, const FilterWeights &weightsX, uint32_t numChannels, uint32_t dstWidth, float* dstRow) {
+        switch (numChannels) {
+        case 1:
+            filterRow<1>(srcRow, weightsX, dstWidth, dstRow);
+            break;
+        case 2:
+            filterRow<2>(srcRow, weightsX, dstWidth, dstRow);
+            break;
+        case 4:
+            filterRow<4>(srcRow, weightsX, dstWidth, dstRow);
+            break;
+        default: {
+            uint32_t numTaps = weightsX.numTaps;
+            for (uint32_t x = 0; x < dstWidth; ++x) {
+                const uint32_t* indices = &weightsX.indices[x * numTaps];
+                const float* weights = &weightsX.weights[x * numTaps];
+                float* dst = dstRow + numChannels * x;
+                std::fill_n(dst, numChannels, 0.0f);
+                for (uint32_t t = 0; t < numTaps; ++t) {
+                    const float* src = srcRow + numChannels * indices[t];
+                    for (uint32_t c = 0; c < numChannels; ++c)
+                        dst[c] += weights[t] * src[c];
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    void resampleImage(const float* srcData, uint32_t srcWidth, uint32_t srcHeight, uint32_t numChannels, VLRMipmapFilter filter,
+                       float* dstData, uint32_t dstWidth, uint32_t dstHeight) {
+        uint32_t srcRowLength = numChannels * srcWidth;
+        uint32_t dstRowLength = numChannels * dstWidth;
+        auto loadRow = [&](uint32_t y, float* row) {
+            std::copy_n(srcData + srcRowLength * y, srcRowLength, row);
+        };
+        auto storeRow = [&](uint32_t y, const float* row) {
+            std::copy_n(row, dstRowLength, dstData + dstRowLength * y);
+        };
+        resampleRows(srcWidth, srcHeight, numChannels, filter, dstWidth, dstHeight, loadRow, storeRow);
+    }
+
+    void resampleRows(uint32_t srcWidth, uint32_t srcHeight, uint32_t numChannels, VLRMipmapFilter filter, uint32_t dstWidth, uint32_t dstHeight,
+                      const std::function<void(uint32_t, float*)> &loadRow, const std::function<void(uint32_t, const float*)> &storeRow) {
+        FilterWeights weightsX(srcWidth, dstWidth, filter);
+        FilterWeights weightsY(srcHeight, dstHeight, filter);
+
+        // JP: 帯を大きくするほど境界で重複して読む入力の行の割合が減り、作業用のメモリーが増える。
+        // EN: Larger bands reduce the proportion of input rows loaded redundantly at boundaries but increase working memory.
+        const uint32_t NumRowsPerBand = 32;
+        uint32_t numBands = (dstHeight + NumRowsPerBand - 1) / NumRowsPerBand;
+        uint32_t srcRowLength = numChannels * srcWidth;
+        uint32_t rowLength = numChannels * dstWidth;
+        uint32_t numSrcPixelsPerBand = (uint32_t)std::min<uint64_t>((uint64_t)srcWidth * (srcHeight + numBands - 1) / numBands, UINT32_MAX);
+        processRowsInParallel(numSrcPixelsPerBand, numBands, [&](uint32_t band) {
+            uint32_t yBegin = NumRowsPerBand * band;
+            uint32_t yEnd = std::min(yBegin + NumRowsPerBand, dstHeight);
+            uint32_t srcYBegin = srcHeight;
+            uint32_t srcYEnd = 0;
+            for (uint32_t i = weightsY.numTaps * yBegin; i < weightsY.numTaps * yEnd; ++i) {
+                srcYBegin = std::min(srcYBegin, weightsY.indices[i]);
+                srcYEnd = std::max(srcYEnd, weightsY.indices[i] + 1);
+            }
+
+            // JP: 帯が参照する入力の行を水平方向にフィルターしてから、垂直方向にフィルターする。
+            // EN: Filter the input rows referenced by the band horizontally, then vertically.
+            std::vector<float> srcRow(srcRowLength);
+            std::vector<float> tempData(rowLength * (srcYEnd - srcYBegin));
+            for (uint32_t srcY = srcYBegin; srcY < srcYEnd; ++srcY) {
+                loadRow(srcY, srcRow.data());
+                filterRow(srcRow.data(), weightsX, numChannels, dstWidth, tempData.data() + rowLength * (srcY - srcYBegin));
+            }
+
+            std::vector<float> dstRow(rowLength);
+            for (uint32_t y = yBegin; y < yEnd; ++y) {
+                const uint32_t* indices = &weightsY.indices[y * weightsY.numTaps];
+                const float* weights = &weightsY.weights[y * weightsY.numTaps];
+                std::fill(dstRow.begin(), dstRow.end(), 0.0f);
+                for (uint32_t t = 0; t < weightsY.numTaps; ++t)
+                    accumulateRow(tempData.data() + rowLength * (indices[t] - srcYBegin), weights[t], rowLength, dstRow.data());
+                storeRow(y, dstRow.data());
+            }
+        });
+    }
+}
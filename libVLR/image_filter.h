@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+#include <thread>
+#include <atomic>
+#include <functional>
+
+namespace VLR {
+    // JP: 行ごとの処理を複数のスレッドに分配する。小さな画像ではスレッド生成のコストの方が大きいので分割を控える。
+    // EN: Distribute per-row processing to multiple threads. Small images are split less since the cost of creating threads dominates.
+    template <typename FuncProcessRow>
+    void processRowsInParallel(uint32_t width, uint32_t height, FuncProcessRow func) {
+        const uint64_t MinNumPixelsPerThread = 1 << 16;
+        uint32_t numThreads = std::min<uint32_t>(std::thread::hardware_concurrency(), height);
+        numThreads = (uint32_t)std::max<uint64_t>(1, std::min<uint64_t>(numThreads, (uint64_t)width * height / MinNumPixelsPerThread));
+        std::atomic<uint32_t> rowCounter(0);
+        auto worker = [&]() {
+            while (true) {
+                uint32_t y = rowCounter.fetch_add(1);
+                if (y >= height)
+                    break;
+                func(y);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < numThreads; ++i)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    // JP: 画素あたりnumChannels個のfloatが並ぶ画像を分離可能なフィルターでリサンプルする。
+    //     水平、垂直の順に1次元のフィルターをかけ、それぞれ行単位で並列に処理する。画像の端はクランプする。
+    //     縮小時はフィルターの幅を縮小率に合わせて広げる。Boxは各出力画素が覆う領域の面積平均になる。
+    // EN: Resample an image with numChannels floats per pixel using a separable filter.
+    //     This applies 1D filters horizontally and then vertically, processing each pass row by row in parallel. The image edges are clamped.
+    //     When minifying, the filter width is widened by the minification ratio. Box results in the area average over the region covered by each output pixel.
+    void resampleImage(const float* srcData, uint32_t srcWidth, uint32_t srcHeight, uint32_t numChannels, VLRMipmapFilter filter,
+                       float* dstData, uint32_t dstWidth, uint32_t dstHeight);
+
+    // JP: resampleImage()と同じリサンプルを画像全体をfloatで持たずに行う。
+    //     出力の行を帯に分けて帯単位で並列に処理し、各帯は必要な入力の行だけをloadRowでfloatの行として受け取り、結果の行をstoreRowに渡す。
+    //     loadRow、storeRowは異なる行に対して複数のスレッドから同時に呼ばれる。帯の境界の入力の行は複数回読まれることがある。
+    // EN: Perform the same resampling as resampleImage() without holding the whole image in floats.
+    //     This splits output rows into bands processed in parallel. Each band receives only the input rows it needs as float rows via loadRow, and passes the result rows to storeRow.
+    //     loadRow and storeRow are called concurrently from multiple threads for different rows. Input rows at band boundaries may be loaded more than once.
+    void resampleRows(uint32_t srcWidth, uint32_t srcHeight, uint32_t numChannels, VLRMipmapFilter filter, uint32_t dstWidth, uint32_t dstHeight,
+                      const std::function<void(uint32_t, float*)> &loadRow, const std::function<void(uint32_t, const float*)> &storeRow);
+}
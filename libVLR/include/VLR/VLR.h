@@ -6,6 +6,7 @@
 #define VLR_ERROR_INVALID_CONTEXT        0x80000001
 #define VLR_ERROR_INVALID_TYPE           0x80000002
 #define VLR_ERROR_INCOMPATIBLE_NODE_TYPE 0x80000003
+#define VLR_ERROR_INVALID_FILE           0x80000004
 
 extern "C" {
     typedef uint32_t VLRResult;
@@ -14,10 +15,12 @@ extern "C" {
     typedef struct VLRObject_API* VLRObject;
 
     typedef struct VLRContext_API* VLRContext;
+    typedef struct VLRAccumulationSnapshot_API* VLRAccumulationSnapshot;
 
     typedef struct VLRImage2D_API* VLRImage2D;
     typedef struct VLRLinearImage2D_API* VLRLinearImage2D;
     typedef struct VLRBlockCompressedImage2D_API* VLRBlockCompressedImage2D;
+    typedef struct VLRTiledImage2D_API* VLRTiledImage2D;
 
     typedef struct VLRShaderNode_API* VLRShaderNode;
     typedef struct VLRGeometryShaderNode_API* VLRGeometryShaderNode;
@@ -62,6 +65,18 @@ extern "C" {
     typedef struct VLREquirectangularCamera_API* VLREquirectangularCamera;
 #endif
 
+    // JP: vlrSceneIntersectの結果。交差が無い場合はsurfaceNodeがnullptrとなる。
+    //     b1, b2は三角形の2番目と3番目の頂点に対する重心座標。
+    // EN: The result of vlrSceneIntersect. surfaceNode is nullptr when there is no intersection.
+    //     b1 and b2 are barycentric coordinates for the second and third vertices of the triangle.
+    struct VLRHit {
+        float t;
+        float b1, b2;
+        VLRTriangleMeshSurfaceNode surfaceNode;
+        uint32_t materialGroupIndex;
+        uint32_t primitiveIndex;
+    };
+
 
 
     VLR_API VLRResult vlrPrintDevices();
@@ -69,14 +84,53 @@ extern "C" {
 
     VLR_API const char* vlrGetErrorMessage(VLRResult code);
 
-    VLR_API VLRResult vlrCreateContext(VLRContext* context, bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices);
+    VLR_API VLRResult vlrCreateContext(VLRContext* context, bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize, const int32_t* devices, uint32_t numDevices, VLRBackend backend, VLRRenderingMode renderingMode);
     VLR_API VLRResult vlrDestroyContext(VLRContext context);
 
     VLR_API VLRResult vlrContextBindOutputBuffer(VLRContext context, uint32_t width, uint32_t height, uint32_t bufferID);
     VLR_API VLRResult vlrContextMapOutputBuffer(VLRContext context, void** ptr);
     VLR_API VLRResult vlrContextUnmapOutputBuffer(VLRContext context);
     VLR_API VLRResult vlrContextGetOutputBufferSize(VLRContext context, uint32_t* width, uint32_t* height);
-    VLR_API VLRResult vlrContextRender(VLRContext context, VLRScene scene, VLRCamera camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames);
+    VLR_API VLRResult vlrContextGetBVHStatistics(VLRContext context, VLRBVHStatistics* stats);
+    VLR_API VLRResult vlrContextSetCPUIntegrator(VLRContext context, VLRCPUIntegrator integrator);
+    VLR_API VLRResult vlrContextSetCPUTileSize(VLRContext context, uint32_t width, uint32_t height);
+    VLR_API VLRResult vlrContextGetCPUThreadStatistics(VLRContext context, VLRCPUThreadStatistics* stats, uint32_t maxNumThreads, uint32_t* numThreads);
+    VLR_API VLRResult vlrContextSaveAccumulation(VLRContext context, const char* filepath);
+    VLR_API VLRResult vlrContextLoadAccumulation(VLRContext context, const char* filepath);
+    VLR_API VLRResult vlrContextMergeAccumulation(VLRContext context, const char* filepath);
+    VLR_API VLRResult vlrContextSetSampleIndexOffset(VLRContext context, uint32_t offset);
+    VLR_API VLRResult vlrContextSetAccumulationFormat(VLRContext context, VLRAccumulationFormat format);
+    // JP: vlrLinearImage2DCreate*とvlrBlockCompressedImage2DCreateは画素データの内容が同じ画像を共有して返す。
+    //     共有された画像は作成と同じ回数だけ破棄すると参照が無くなり、capacity(バイト、既定は512MiB)の範囲で再作成に備えて保持される。
+    //     共有中の画像にはvlrImage2DGenerateMipmapsを使えない。
+    // EN: vlrLinearImage2DCreate* and vlrBlockCompressedImage2DCreate return a shared image for the same pixel data content.
+    //     A shared image loses its references after being destroyed as many times as created, and is kept for recreation within capacity (bytes, 512MiB by default).
+    //     vlrImage2DGenerateMipmaps cannot be used for an image while it is shared.
+    VLR_API VLRResult vlrContextSetImageCacheCapacity(VLRContext context, uint64_t capacity);
+    // JP: タイル化画像のタイルを保持する予算(バイト、既定は2GiB)。超えると最も長く使われていないタイルから追い出す。
+    //     レンダリング中のスレッドが参照しているタイルも数え、各スレッドが読んでいる最中の1タイルを除いて予算に収める。
+    //     タイル単位の読み込みはCPUバックエンドだけが行い、OptiXバックエンドは全レベルを転送するのでこの予算の対象外。
+    // EN: Budget (bytes, 2GiB by default) to hold tiles of tiled images. Exceeding it evicts the least recently used tiles first.
+    //     Tiles referenced by rendering threads are counted too, and tiles fit in the budget except for one tile per thread being read.
+    //     Only the CPU backend reads per tile, and the OptiX backend transfers all the levels, so it is not subject to this budget.
+    VLR_API VLRResult vlrContextSetTileCacheBudget(VLRContext context, uint64_t budget);
+    VLR_API VLRResult vlrContextGetTileCacheStatistics(VLRContext context, VLRTileCacheStatistics* stats);
+    VLR_API VLRResult vlrContextSetAdaptiveSampling(VLRContext context, float pixelErrorThreshold, uint32_t minNumSamples, float targetError);
+    VLR_API VLRResult vlrContextResolve(VLRContext context, const VLRResolveParameters* params, void* dst);
+    // JP: 蓄積バッファーをサンプル数で割ったXYZとしてホストに写し取る。スナップショットはコンテキストから独立しているので、
+    //     レンダリングを続けながら別のスレッドでvlrAccumulationSnapshotResolveを呼べる。
+    // EN: Copy the accumulation buffer to the host as XYZ divided by the number of samples. A snapshot is independent of the context,
+    //     so vlrAccumulationSnapshotResolve can be called on another thread while rendering continues.
+    VLR_API VLRResult vlrContextCreateAccumulationSnapshot(VLRContext context, VLRAccumulationSnapshot* snapshot);
+    VLR_API VLRResult vlrContextRender(VLRContext context, VLRScene scene, VLRCamera camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames, bool* converged);
+
+
+
+    VLR_API VLRResult vlrAccumulationSnapshotDestroy(VLRAccumulationSnapshot snapshot);
+    VLR_API VLRResult vlrAccumulationSnapshotGetSize(VLRAccumulationSnapshot snapshot, uint32_t* width, uint32_t* height);
+    // JP: vlrContextResolveと同じ処理をスナップショットに対して行う。
+    // EN: Perform the same process as vlrContextResolve on a snapshot.
+    VLR_API VLRResult vlrAccumulationSnapshotResolve(VLRAccumulationSnapshot snapshot, const VLRResolveParameters* params, void* dst);
 
 
 
@@ -85,14 +139,51 @@ extern "C" {
     VLR_API VLRResult vlrImage2DGetStride(VLRImage2D image, uint32_t* stride);
     VLR_API VLRResult vlrImage2DGetDataFormat(VLRImage2D image, VLRDataFormat* format);
     VLR_API VLRResult vlrImage2DHasAlpha(VLRImage2D image, bool* hasAlpha);
+    // JP: レベル0から1x1までのミップマップを生成する。フィルタリングは線形な値に対して行う。ブロック圧縮画像には使えない。
+    //     色でない値を持つ形式(uvsA16Fx4, RG32Fx2, Gray32F)はfilterに関わらずBoxを使う。
+    //     画像は以後共有されなくなる。他の作成で共有されている画像にはVLR_ERROR_INVALID_TYPEを返す。
+    // EN: Generate mipmaps from the level 0 down to 1x1. Filtering is done on linear values. This cannot be used for block compressed images.
+    //     Formats holding non-color values (uvsA16Fx4, RG32Fx2, Gray32F) use Box regardless of filter.
+    //     The image is no longer shared afterward. VLR_ERROR_INVALID_TYPE is returned for an image shared by another creation.
+    VLR_API VLRResult vlrImage2DGenerateMipmaps(VLRImage2D image, VLRMipmapFilter filter);
 
     VLR_API VLRResult vlrLinearImage2DCreate(VLRContext context, VLRLinearImage2D* image,
                                              uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma);
+    // JP: linearDataをコピーせずに参照する画像を作る。内部形式への変換やホストでのデガンマが必要な場合は変換後すぐにreleaseCallbackが呼ばれ、
+    //     そうでない場合は画像の破棄時に呼ばれる。内容が同じ画像を共有した場合もすぐに呼ばれる。
+    //     releaseCallbackがnullptrの場合、呼び出し側は画像の破棄までデータを保持する必要がある。
+    // EN: Create an image referencing linearData without copying it. releaseCallback is called right after conversion if conversion to the internal format
+    //     or degamma on the host is required, and otherwise on destruction of the image. It is also called right away when an image with the same content is shared.
+    //     If releaseCallback is nullptr, the caller must keep the data until the image is destroyed.
+    VLR_API VLRResult vlrLinearImage2DCreateFromExternalData(VLRContext context, VLRLinearImage2D* image,
+                                                             const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma,
+                                                             VLRImageDataReleaseCallback releaseCallback, void* userData);
     VLR_API VLRResult vlrLinearImage2DDestroy(VLRContext context, VLRLinearImage2D image);
+    VLR_API VLRResult vlrConvertImageToUpsampledSpectrum(VLRContext context, VLRLinearImage2D image, VLRColorSpace colorSpace, VLRSpectrumType spectrumType,
+                                                         VLRLinearImage2D* convertedImage);
+    // JP: レベル0とvlrImage2DGenerateMipmapsで作ったレベルをtileSize(2のべき乗)ごとのタイルに分けてファイルに書き出す。
+    // EN: Split the level 0 and levels made by vlrImage2DGenerateMipmaps into tiles of tileSize (a power of two) and write them to a file.
+    VLR_API VLRResult vlrLinearImage2DWriteTiledImage(VLRLinearImage2D image, const char* filePath, uint32_t tileSize);
 
     VLR_API VLRResult vlrBlockCompressedImage2DCreate(VLRContext context, VLRBlockCompressedImage2D* image,
                                                       uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma);
     VLR_API VLRResult vlrBlockCompressedImage2DDestroy(VLRContext context, VLRBlockCompressedImage2D image);
+    // JP: 線形画像をミップチェーンごとブロック圧縮する。dataFormatはBC1, BC3, BC4, BC5, BC7のいずれか。
+    //     cacheFilePathがnullptrでない場合、内容が一致する圧縮結果をそのファイルから読み込み、無ければ書き出す。
+    // EN: Block-compress a linear image together with its mip chain. dataFormat is one of BC1, BC3, BC4, BC5 and BC7.
+    //     If cacheFilePath is not nullptr, a compressed result with matching content is loaded from the file, or written to it if not present.
+    VLR_API VLRResult vlrConvertImageToBlockCompressed(VLRContext context, VLRLinearImage2D image, VLRDataFormat dataFormat, const char* cacheFilePath,
+                                                       VLRBlockCompressedImage2D* compressedImage);
+
+    // JP: vlrLinearImage2DWriteTiledImageで書き出したファイルを参照する画像を作る。画素データはタイル単位で必要になった時点で読み込む。
+    //     CPUバックエンドではレンダリング中に参照されたタイルだけを読み込み、OptiXバックエンドでは全レベルを読み込んで転送する。
+    // EN: Create an image referencing a file written by vlrLinearImage2DWriteTiledImage. Pixel data is read per tile at the time it is needed.
+    //     The CPU backend reads only tiles referenced during rendering, and the OptiX backend reads and transfers all the levels.
+    VLR_API VLRResult vlrTiledImage2DCreate(VLRContext context, VLRTiledImage2D* image, const char* filePath);
+    VLR_API VLRResult vlrTiledImage2DDestroy(VLRContext context, VLRTiledImage2D image);
+    // JP: 正規化テクスチャー座標の範囲を覆うタイルを事前に読み込む。
+    // EN: Load tiles covering a range in normalized texture coordinates in advance.
+    VLR_API VLRResult vlrTiledImage2DPrefetch(VLRTiledImage2D image, uint32_t mipLevel, float minU, float minV, float maxU, float maxV);
 
 
 
@@ -309,6 +400,7 @@ extern "C" {
     VLR_API VLRResult vlrSceneAddChild(VLRScene scene, VLRObject child);
     VLR_API VLRResult vlrSceneRemoveChild(VLRScene scene, VLRObject child);
     VLR_API VLRResult vlrSceneSetEnvironment(VLRScene scene, VLREnvironmentEmitterSurfaceMaterial material);
+    VLR_API VLRResult vlrSceneIntersect(VLRScene scene, const VLRRay* rays, uint32_t numRays, VLRHit* hits);
 
 
 
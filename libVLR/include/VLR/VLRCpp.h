@@ -15,6 +15,7 @@ namespace VLRCpp {
     VLR_DECLARE_HOLDER_AND_REFERENCE(Image2D);
     VLR_DECLARE_HOLDER_AND_REFERENCE(LinearImage2D);
     VLR_DECLARE_HOLDER_AND_REFERENCE(BlockCompressedImage2D);
+    VLR_DECLARE_HOLDER_AND_REFERENCE(TiledImage2D);
 
     VLR_DECLARE_HOLDER_AND_REFERENCE(ShaderNode);
     VLR_DECLARE_HOLDER_AND_REFERENCE(GeometryShaderNode);
@@ -72,6 +73,31 @@ namespace VLRCpp {
 
 
 
+    // JP: コンテキストから独立しているので、コンテキストへの参照は持たない。
+    // EN: This doesn't hold a reference to the context since this is independent of it.
+    class AccumulationSnapshot {
+        VLRAccumulationSnapshot m_raw;
+
+    public:
+        AccumulationSnapshot(VLRAccumulationSnapshot raw) : m_raw(raw) {}
+        ~AccumulationSnapshot() {
+            errorCheck(vlrAccumulationSnapshotDestroy(m_raw));
+        }
+
+        void getSize(uint32_t* width, uint32_t* height) const {
+            errorCheck(vlrAccumulationSnapshotGetSize(m_raw, width, height));
+        }
+
+        // JP: dstにはスナップショットの幅 x 高さの画素分の大きさが必要。
+        // EN: dst needs the size of the width x height pixels of the snapshot.
+        void resolve(const VLRResolveParameters &params, void* dst) const {
+            errorCheck(vlrAccumulationSnapshotResolve(m_raw, &params, dst));
+        }
+    };
+    typedef std::shared_ptr<AccumulationSnapshot> AccumulationSnapshotRef;
+
+
+
     class Object : public std::enable_shared_from_this<Object> {
     protected:
         ContextConstRef m_context;
@@ -115,6 +141,10 @@ namespace VLRCpp {
             errorCheck(vlrImage2DHasAlpha((VLRImage2D)m_raw, &hasAlpha));
             return hasAlpha;
         }
+
+        void generateMipmaps(VLRMipmapFilter filter) const {
+            errorCheck(vlrImage2DGenerateMipmaps((VLRImage2D)m_raw, filter));
+        }
     };
 
 
@@ -125,9 +155,23 @@ namespace VLRCpp {
             Image2DHolder(context) {
             errorCheck(vlrLinearImage2DCreate(getRaw(m_context), (VLRLinearImage2D*)&m_raw, const_cast<uint8_t*>(linearData), width, height, format, applyDegamma));
         }
+        LinearImage2DHolder(const ContextConstRef &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma,
+                            VLRImageDataReleaseCallback releaseCallback, void* userData) :
+            Image2DHolder(context) {
+            errorCheck(vlrLinearImage2DCreateFromExternalData(getRaw(m_context), (VLRLinearImage2D*)&m_raw, linearData, width, height, format, applyDegamma,
+                                                              releaseCallback, userData));
+        }
+        LinearImage2DHolder(const ContextConstRef &context, const LinearImage2DRef &image, VLRColorSpace colorSpace, VLRSpectrumType spectrumType) :
+            Image2DHolder(context) {
+            errorCheck(vlrConvertImageToUpsampledSpectrum(getRaw(m_context), (VLRLinearImage2D)image->get(), colorSpace, spectrumType, (VLRLinearImage2D*)&m_raw));
+        }
         ~LinearImage2DHolder() {
             errorCheck(vlrLinearImage2DDestroy(getRaw(m_context), (VLRLinearImage2D)m_raw));
         }
+
+        void writeTiledImage(const char* filePath, uint32_t tileSize) const {
+            errorCheck(vlrLinearImage2DWriteTiledImage((VLRLinearImage2D)m_raw, filePath, tileSize));
+        }
     };
 
 
@@ -138,6 +182,10 @@ namespace VLRCpp {
             Image2DHolder(context) {
             errorCheck(vlrBlockCompressedImage2DCreate(getRaw(m_context), (VLRBlockCompressedImage2D*)&m_raw, const_cast<uint8_t**>(data), const_cast<size_t*>(sizes), mipCount, width, height, dataFormat, applyDegamma));
         }
+        BlockCompressedImage2DHolder(const ContextConstRef &context, const LinearImage2DRef &image, VLRDataFormat dataFormat, const char* cacheFilePath) :
+            Image2DHolder(context) {
+            errorCheck(vlrConvertImageToBlockCompressed(getRaw(m_context), (VLRLinearImage2D)image->get(), dataFormat, cacheFilePath, (VLRBlockCompressedImage2D*)&m_raw));
+        }
         ~BlockCompressedImage2DHolder() {
             errorCheck(vlrBlockCompressedImage2DDestroy(getRaw(m_context), (VLRBlockCompressedImage2D)m_raw));
         }
@@ -145,6 +193,23 @@ namespace VLRCpp {
 
 
 
+    class TiledImage2DHolder : public Image2DHolder {
+    public:
+        TiledImage2DHolder(const ContextConstRef &context, const char* filePath) :
+            Image2DHolder(context) {
+            errorCheck(vlrTiledImage2DCreate(getRaw(m_context), (VLRTiledImage2D*)&m_raw, filePath));
+        }
+        ~TiledImage2DHolder() {
+            errorCheck(vlrTiledImage2DDestroy(getRaw(m_context), (VLRTiledImage2D)m_raw));
+        }
+
+        void prefetch(uint32_t mipLevel, float minU, float minV, float maxU, float maxV) const {
+            errorCheck(vlrTiledImage2DPrefetch((VLRTiledImage2D)m_raw, mipLevel, minU, minV, maxU, maxV));
+        }
+    };
+
+
+
     struct ShaderNodeSocket {
         ShaderNodeRef node;
         VLRShaderNodeSocketInfo socketInfo;
@@ -1081,6 +1146,10 @@ namespace VLRCpp {
             m_matEnv = matEnv;
             errorCheck(vlrSceneSetEnvironment((VLRScene)m_raw, (VLREnvironmentEmitterSurfaceMaterial)m_matEnv->get()));
         }
+
+        void intersect(const VLRRay* rays, uint32_t numRays, VLRHit* hits) const {
+            errorCheck(vlrSceneIntersect((VLRScene)m_raw, rays, numRays, hits));
+        }
     };
 
 
@@ -1201,16 +1270,17 @@ namespace VLRCpp {
         Context() {}
 
         void initialize(bool logging, bool enableRTX, uint32_t maxCallableDepth, uint32_t stackSize,
-                        const int32_t* devices, uint32_t numDevices) {
-            errorCheck(vlrCreateContext(&m_rawContext, logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices));
+                        const int32_t* devices, uint32_t numDevices, VLRBackend backend, VLRRenderingMode renderingMode) {
+            errorCheck(vlrCreateContext(&m_rawContext, logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices, backend, renderingMode));
             m_geomShaderNode = std::make_shared<GeometryShaderNodeHolder>(shared_from_this());
         }
 
     public:
         static ContextRef create(bool logging, bool enableRTX = true, uint32_t maxCallableDepth = 8, uint32_t stackSize = 0,
-                                 const int32_t* devices = nullptr, uint32_t numDevices = 0) {
+                                 const int32_t* devices = nullptr, uint32_t numDevices = 0, VLRBackend backend = VLRBackend_OptiX,
+                                 VLRRenderingMode renderingMode = VLRRenderingMode_RGB) {
             auto ret = std::shared_ptr<Context>(new Context());
-            ret->initialize(logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices);
+            ret->initialize(logging, enableRTX, maxCallableDepth, stackSize, devices, numDevices, backend, renderingMode);
             return ret;
         }
 
@@ -1240,8 +1310,75 @@ namespace VLRCpp {
             errorCheck(vlrContextGetOutputBufferSize(m_rawContext, width, height));
         }
 
-        void render(const SceneRef &scene, const CameraRef &camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames) const {
-            errorCheck(vlrContextRender(m_rawContext, (VLRScene)scene->get(), (VLRCamera)camera->get(), shrinkCoeff, firstFrame, numAccumFrames));
+        void getBVHStatistics(VLRBVHStatistics* stats) const {
+            errorCheck(vlrContextGetBVHStatistics(m_rawContext, stats));
+        }
+
+        void setCPUIntegrator(VLRCPUIntegrator integrator) const {
+            errorCheck(vlrContextSetCPUIntegrator(m_rawContext, integrator));
+        }
+
+        void setCPUTileSize(uint32_t width, uint32_t height) const {
+            errorCheck(vlrContextSetCPUTileSize(m_rawContext, width, height));
+        }
+
+        void getCPUThreadStatistics(std::vector<VLRCPUThreadStatistics>* stats) const {
+            uint32_t numThreads;
+            errorCheck(vlrContextGetCPUThreadStatistics(m_rawContext, nullptr, 0, &numThreads));
+            stats->resize(numThreads);
+            errorCheck(vlrContextGetCPUThreadStatistics(m_rawContext, stats->data(), numThreads, &numThreads));
+        }
+
+        void saveAccumulation(const std::string &filepath) const {
+            errorCheck(vlrContextSaveAccumulation(m_rawContext, filepath.c_str()));
+        }
+
+        void loadAccumulation(const std::string &filepath) const {
+            errorCheck(vlrContextLoadAccumulation(m_rawContext, filepath.c_str()));
+        }
+
+        void mergeAccumulation(const std::string &filepath) const {
+            errorCheck(vlrContextMergeAccumulation(m_rawContext, filepath.c_str()));
+        }
+
+        void setSampleIndexOffset(uint32_t offset) const {
+            errorCheck(vlrContextSetSampleIndexOffset(m_rawContext, offset));
+        }
+
+        void setAccumulationFormat(VLRAccumulationFormat format) const {
+            errorCheck(vlrContextSetAccumulationFormat(m_rawContext, format));
+        }
+
+        void setImageCacheCapacity(uint64_t capacity) const {
+            errorCheck(vlrContextSetImageCacheCapacity(m_rawContext, capacity));
+        }
+
+        void setTileCacheBudget(uint64_t budget) const {
+            errorCheck(vlrContextSetTileCacheBudget(m_rawContext, budget));
+        }
+
+        void getTileCacheStatistics(VLRTileCacheStatistics* stats) const {
+            errorCheck(vlrContextGetTileCacheStatistics(m_rawContext, stats));
+        }
+
+        void setAdaptiveSampling(float pixelErrorThreshold, uint32_t minNumSamples, float targetError) const {
+            errorCheck(vlrContextSetAdaptiveSampling(m_rawContext, pixelErrorThreshold, minNumSamples, targetError));
+        }
+
+        // JP: dstには出力バッファーの幅 x 高さの画素分の大きさが必要。
+        // EN: dst needs the size of the width x height pixels of the output buffer.
+        void resolve(const VLRResolveParameters &params, void* dst) const {
+            errorCheck(vlrContextResolve(m_rawContext, &params, dst));
+        }
+
+        AccumulationSnapshotRef createAccumulationSnapshot() const {
+            VLRAccumulationSnapshot snapshot;
+            errorCheck(vlrContextCreateAccumulationSnapshot(m_rawContext, &snapshot));
+            return std::make_shared<AccumulationSnapshot>(snapshot);
+        }
+
+        void render(const SceneRef &scene, const CameraRef &camera, uint32_t shrinkCoeff, bool firstFrame, uint32_t* numAccumFrames, bool* converged = nullptr) const {
+            errorCheck(vlrContextRender(m_rawContext, (VLRScene)scene->get(), (VLRCamera)camera->get(), shrinkCoeff, firstFrame, numAccumFrames, converged));
         }
 
 
@@ -1250,10 +1387,27 @@ namespace VLRCpp {
             return std::make_shared<LinearImage2DHolder>(shared_from_this(), linearData, width, height, format, applyDegamma);
         }
 
+        LinearImage2DRef createLinearImage2D(const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma,
+                                             VLRImageDataReleaseCallback releaseCallback, void* userData) const {
+            return std::make_shared<LinearImage2DHolder>(shared_from_this(), linearData, width, height, format, applyDegamma, releaseCallback, userData);
+        }
+
+        LinearImage2DRef convertImageToUpsampledSpectrum(const LinearImage2DRef &image, VLRColorSpace colorSpace, VLRSpectrumType spectrumType) const {
+            return std::make_shared<LinearImage2DHolder>(shared_from_this(), image, colorSpace, spectrumType);
+        }
+
         BlockCompressedImage2DRef createBlockCompressedImage2D(uint8_t** data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height, VLRDataFormat format, bool applyDegamma) const {
             return std::make_shared<BlockCompressedImage2DHolder>(shared_from_this(), data, sizes, mipCount, width, height, format, applyDegamma);
         }
 
+        BlockCompressedImage2DRef convertImageToBlockCompressed(const LinearImage2DRef &image, VLRDataFormat format, const char* cacheFilePath = nullptr) const {
+            return std::make_shared<BlockCompressedImage2DHolder>(shared_from_this(), image, format, cacheFilePath);
+        }
+
+        TiledImage2DRef createTiledImage2D(const char* filePath) const {
+            return std::make_shared<TiledImage2DHolder>(shared_from_this(), filePath);
+        }
+
 
 
         GeometryShaderNodeRef createGeometryShaderNode() const {
@@ -2,6 +2,113 @@
 
 #include "common.h"
 
+// JP: コンテキストのバックエンド。CPUバックエンドはGPUやOptiXのDLLを必要とせず、
+//     出力バッファーはOpenGLのバッファーと連携しないのでマップして取得する。
+// EN: Backend of a context. The CPU backend requires neither a GPU nor the OptiX DLL,
+//     and its output buffer doesn't interoperate with OpenGL buffers, so get it by mapping.
+enum VLRBackend {
+    VLRBackend_OptiX = 0,
+    VLRBackend_CPU,
+};
+
+// JP: コンテキストのレンダリングモード。コンテキストの生成時に決まり、以降は変更できない。
+//     RGBは3チャンネルで、Spectralは波長サンプルでライトトランスポートを計算する。
+// EN: Rendering mode of a context. Determined at the creation of a context and cannot be changed afterward.
+//     RGB computes light transport with three channels, and Spectral computes it with wavelength samples.
+enum VLRRenderingMode {
+    VLRRenderingMode_RGB = 0,
+    VLRRenderingMode_Spectral,
+};
+
+// JP: CPUバックエンドの積分器。
+//     Megakernelはパスごとに再帰的にトレースとシェーディングを行い、Wavefrontは多数のパスをまとめて段階ごとに処理する。
+// EN: Integrator of the CPU backend.
+//     Megakernel traces and shades each path recursively, and Wavefront processes many paths together stage by stage.
+enum VLRCPUIntegrator {
+    VLRCPUIntegrator_Megakernel = 0,
+    VLRCPUIntegrator_Wavefront,
+};
+
+// JP: 出力バッファーの画素ごとの蓄積形式。
+//     Compensatedは蓄積値をそのままの形(スペクトルレンダリングでは16ビンのスペクトル)で補償項付きのfloatとして保持する。
+//     CompactXYZは各サンプルをその場でXYZに変換し、倍精度で足し合わせる。ビンごとの値は失われるが、スペクトルレンダリングではメモリが大幅に減る。
+//     画素あたりの蓄積値の大きさと、1e7サンプル蓄積時の合計値の最大相対誤差(合成データによる測定値):
+//                        スペクトル      RGB      誤差
+//     Compensated        128 bytes       24 bytes 1e-7
+//     CompactXYZ          24 bytes       24 bytes 7e-11
+// EN: Accumulation format per pixel of the output buffer.
+//     Compensated holds accumulated values as they are (16-bin spectrum in spectral rendering) as floats with compensation terms.
+//     CompactXYZ converts each sample to XYZ on the fly and sums them in double precision. Per-bin values are lost, but memory is greatly reduced in spectral rendering.
+//     Size of the accumulated value per pixel and the maximum relative error of the sum after accumulating 1e7 samples (measured with synthetic data):
+//                        Spectral        RGB      Error
+//     Compensated        128 bytes       24 bytes 1e-7
+//     CompactXYZ          24 bytes       24 bytes 7e-11
+enum VLRAccumulationFormat {
+    VLRAccumulationFormat_Compensated = 0,
+    VLRAccumulationFormat_CompactXYZ,
+};
+
+// JP: vlrContextResolveの出力形式。画素は行間に隙間無く並ぶ。
+//     LinearRGBはfloat x 3、HalfRGBAはhalf x 4(アルファは1)、SRGB8はRGBAの順のuint8_t x 4(アルファは255)。
+// EN: Output format of vlrContextResolve. Pixels are arranged without gaps between rows.
+//     LinearRGB is float x 3, HalfRGBA is half x 4 (alpha is 1), and SRGB8 is uint8_t x 4 in RGBA order (alpha is 255).
+enum VLRResolveFormat {
+    VLRResolveFormat_LinearRGB = 0,
+    VLRResolveFormat_HalfRGBA,
+    VLRResolveFormat_SRGB8,
+};
+
+// JP: SRGB8出力でガンマ補正の前に適用するトーンマップ。
+//     Clampは1で切り詰め、Exponentialは1 - exp(-x)、Reinhardはx / (1 + x)。
+// EN: Tonemapping applied before gamma correction for SRGB8 output.
+//     Clamp clips at 1, Exponential is 1 - exp(-x), and Reinhard is x / (1 + x).
+enum VLRTonemapOperator {
+    VLRTonemapOperator_Clamp = 0,
+    VLRTonemapOperator_Exponential,
+    VLRTonemapOperator_Reinhard,
+};
+
+// JP: exposureはすべての出力形式で線形なRGBに掛ける係数。
+//     tonemapOperatorとditherはSRGB8出力にだけ使われ、ditherは8x8の組織的ディザーを量子化の前に加える。
+// EN: exposure is a factor multiplied to linear RGB for all output formats.
+//     tonemapOperator and dither are used only for SRGB8 output, and dither adds 8x8 ordered dithering before quantization.
+struct VLRResolveParameters {
+    VLRResolveFormat format;
+    float exposure;
+    VLRTonemapOperator tonemapOperator;
+    bool dither;
+};
+
+// JP: ホスト側で構築されたBVHの統計情報。buildTimeの単位はミリ秒。
+// EN: Statistics of the BVH built on the host. The unit of buildTime is milliseconds.
+struct VLRBVHStatistics {
+    float buildTime;
+    uint32_t numNodes;
+    uint32_t numLeafNodes;
+    uint32_t maxDepth;
+    float SAHCost;
+};
+
+// JP: CPUバックエンドのレンダリングスレッドごとの統計情報。最初のフレームからの累積値で、時間の単位はミリ秒。
+// EN: Statistics per rendering thread of the CPU backend. Accumulated values since the first frame, and the unit of time is milliseconds.
+struct VLRCPUThreadStatistics {
+    float busyTime;
+    float idleTime;
+    uint32_t numTiles;
+    uint32_t numStolenTiles;
+};
+
+// JP: タイル化画像のタイルキャッシュの統計情報。大きさの単位はバイトで、要求数、ミス数、追い出し数はコンテキストの作成からの累積値。
+// EN: Statistics of the tile cache for tiled images. The unit of sizes is bytes, and the numbers of requests, misses and evictions are accumulated since the creation of the context.
+struct VLRTileCacheStatistics {
+    uint64_t budget;
+    uint64_t residentSize;
+    uint64_t numRequests;
+    uint64_t numMisses;
+    uint64_t numEvictions;
+    uint32_t numResidentTiles;
+};
+
 enum VLRSpectrumType {
     VLRSpectrumType_Reflectance = 0,
     VLRSpectrumType_Transmittance = VLRSpectrumType_Reflectance,
@@ -39,11 +146,20 @@ enum VLRDataFormat {
     VLRDataFormat_BC6H,
     VLRDataFormat_BC6H_Signed,
     VLRDataFormat_BC7,
+    VLRDataFormat_uvsA16Fx4,
     NumVLRDataFormats
 };
 
 
 
+// JP: vlrLinearImage2DCreateFromExternalDataで引き取った画像データを返却するときに呼ばれる。
+//     dataは渡したポインターそのもので、呼び出し側はここでメモリーの解放やファイルのアンマップを行う。
+// EN: Called when returning image data adopted by vlrLinearImage2DCreateFromExternalData.
+//     data is the passed pointer itself, and the caller frees the memory or unmaps the file here.
+typedef void (*VLRImageDataReleaseCallback)(const uint8_t* data, void* userData);
+
+
+
 enum VLRShaderNodeSocketType {
     VLRShaderNodeSocketType_float = 0,
     VLRShaderNodeSocketType_float2,
@@ -70,6 +186,14 @@ enum VLRTextureFilter {
     VLRTextureFilter_None
 };
 
+// JP: ミップマップ生成に使う縮小フィルター。KaiserはKaiser窓付きsinc(幅3)、LanczosはLanczos3。
+// EN: Minification filter used for mipmap generation. Kaiser is a Kaiser-windowed sinc (width 3), and Lanczos is Lanczos3.
+enum VLRMipmapFilter {
+    VLRMipmapFilter_Box = 0,
+    VLRMipmapFilter_Kaiser,
+    VLRMipmapFilter_Lanczos,
+};
+
 enum VLRTextureWrapMode {
     VLRTextureWrapMode_Repeat = 0,
     VLRTextureWrapMode_ClampToEdge,
@@ -128,3 +252,10 @@ struct VLRVertex {
     VLRVector3D tc0Direction;
     VLRTexCoord2D texCoord;
 };
+
+struct VLRRay {
+    VLRPoint3D origin;
+    VLRVector3D direction;
+    float tmin;
+    float tmax;
+};
@@ -3,19 +3,17 @@
 namespace VLR {
     // static
     void SurfaceMaterial::commonInitializeProcedure(Context &context, const char* identifiers[10], OptiXProgramSet* programSet) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"materials.ptx");
-
-        optix::Context optixContext = context.getOptiXContext();
+        std::string ptx = context.readPTX("materials.ptx");
 
         if (identifiers[0] && identifiers[1] && identifiers[2] && identifiers[3] && identifiers[4] && identifiers[5] && identifiers[6]) {
-            programSet->callableProgramSetupBSDF = optixContext->createProgramFromPTXString(ptx, identifiers[0]);
+            programSet->callableProgramSetupBSDF = context.createProgramFromPTXString(ptx, identifiers[0]);
 
-            programSet->callableProgramBSDFGetBaseColor = optixContext->createProgramFromPTXString(ptx, identifiers[1]);
-            programSet->callableProgramBSDFmatches = optixContext->createProgramFromPTXString(ptx, identifiers[2]);
-            programSet->callableProgramBSDFSampleInternal = optixContext->createProgramFromPTXString(ptx, identifiers[3]);
-            programSet->callableProgramBSDFEvaluateInternal = optixContext->createProgramFromPTXString(ptx, identifiers[4]);
-            programSet->callableProgramBSDFEvaluatePDFInternal = optixContext->createProgramFromPTXString(ptx, identifiers[5]);
-            programSet->callableProgramBSDFWeightInternal = optixContext->createProgramFromPTXString(ptx, identifiers[6]);
+            programSet->callableProgramBSDFGetBaseColor = context.createProgramFromPTXString(ptx, identifiers[1]);
+            programSet->callableProgramBSDFmatches = context.createProgramFromPTXString(ptx, identifiers[2]);
+            programSet->callableProgramBSDFSampleInternal = context.createProgramFromPTXString(ptx, identifiers[3]);
+            programSet->callableProgramBSDFEvaluateInternal = context.createProgramFromPTXString(ptx, identifiers[4]);
+            programSet->callableProgramBSDFEvaluatePDFInternal = context.createProgramFromPTXString(ptx, identifiers[5]);
+            programSet->callableProgramBSDFWeightInternal = context.createProgramFromPTXString(ptx, identifiers[6]);
 
             Shared::BSDFProcedureSet bsdfProcSet;
             {
@@ -31,10 +29,10 @@ namespace VLR {
         }
 
         if (identifiers[7] && identifiers[8] && identifiers[9]) {
-            programSet->callableProgramSetupEDF = optixContext->createProgramFromPTXString(ptx, identifiers[7]);
+            programSet->callableProgramSetupEDF = context.createProgramFromPTXString(ptx, identifiers[7]);
 
-            programSet->callableProgramEDFEvaluateEmittanceInternal = optixContext->createProgramFromPTXString(ptx, identifiers[8]);
-            programSet->callableProgramEDFEvaluateInternal = optixContext->createProgramFromPTXString(ptx, identifiers[9]);
+            programSet->callableProgramEDFEvaluateEmittanceInternal = context.createProgramFromPTXString(ptx, identifiers[8]);
+            programSet->callableProgramEDFEvaluateInternal = context.createProgramFromPTXString(ptx, identifiers[9]);
 
             Shared::EDFProcedureSet edfProcSet;
             {
@@ -163,7 +161,7 @@ namespace VLR {
     }
 
     MatteSurfaceMaterial::MatteSurfaceMaterial(Context &context) :
-        SurfaceMaterial(context), m_immAlbedo(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)) {
+        SurfaceMaterial(context), m_immAlbedo(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)) {
         setupMaterialDescriptor();
     }
 
@@ -191,7 +189,7 @@ namespace VLR {
     }
 
     void MatteSurfaceMaterial::setImmediateValueAlbedo(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immAlbedo = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immAlbedo = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -227,9 +225,9 @@ namespace VLR {
 
     SpecularReflectionSurfaceMaterial::SpecularReflectionSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immCoeffR(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
-        m_immEta(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
-        m_imm_k(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 0.0f, 0.0f, 0.0f)) {
+        m_immCoeffR(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
+        m_immEta(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
+        m_imm_k(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 0.0f, 0.0f, 0.0f)) {
         setupMaterialDescriptor();
     }
 
@@ -261,7 +259,7 @@ namespace VLR {
     }
 
     void SpecularReflectionSurfaceMaterial::setImmediateValueCoeffR(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immCoeffR = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);;
+        m_immCoeffR = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);;
         setupMaterialDescriptor();
     }
 
@@ -274,7 +272,7 @@ namespace VLR {
     }
 
     void SpecularReflectionSurfaceMaterial::setImmediateValueEta(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEta = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEta = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -287,7 +285,7 @@ namespace VLR {
     }
 
     void SpecularReflectionSurfaceMaterial::setImmediateValue_k(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_imm_k = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_imm_k = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -323,9 +321,9 @@ namespace VLR {
 
     SpecularScatteringSurfaceMaterial::SpecularScatteringSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immCoeff(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
-        m_immEtaExt(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
-        m_immEtaInt(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.5f, 1.5f, 1.5f)) {
+        m_immCoeff(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
+        m_immEtaExt(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
+        m_immEtaInt(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.5f, 1.5f, 1.5f)) {
         setupMaterialDescriptor();
     }
 
@@ -357,7 +355,7 @@ namespace VLR {
     }
 
     void SpecularScatteringSurfaceMaterial::setImmediateValueCoeff(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immCoeff = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immCoeff = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -370,7 +368,7 @@ namespace VLR {
     }
 
     void SpecularScatteringSurfaceMaterial::setImmediateValueEtaExt(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEtaExt = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEtaExt = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -383,7 +381,7 @@ namespace VLR {
     }
 
     void SpecularScatteringSurfaceMaterial::setImmediateValueEtaInt(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEtaInt = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEtaInt = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -419,8 +417,8 @@ namespace VLR {
 
     MicrofacetReflectionSurfaceMaterial::MicrofacetReflectionSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immEta(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
-        m_imm_k(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 0.0f, 0.0f, 0.0f)),
+        m_immEta(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
+        m_imm_k(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 0.0f, 0.0f, 0.0f)),
         m_immRoughness(0.1f), m_immAnisotropy(0.0f), m_immRotation(0.0f) {
         setupMaterialDescriptor();
     }
@@ -455,7 +453,7 @@ namespace VLR {
     }
 
     void MicrofacetReflectionSurfaceMaterial::setImmediateValueEta(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEta = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEta = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -468,7 +466,7 @@ namespace VLR {
     }
 
     void MicrofacetReflectionSurfaceMaterial::setImmediateValue_k(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_imm_k = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_imm_k = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -527,9 +525,9 @@ namespace VLR {
 
     MicrofacetScatteringSurfaceMaterial::MicrofacetScatteringSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immCoeff(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
-        m_immEtaExt(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
-        m_immEtaInt(createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.5f, 1.5f, 1.5f)),
+        m_immCoeff(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)),
+        m_immEtaExt(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.0f, 1.0f, 1.0f)),
+        m_immEtaInt(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, VLRColorSpace_Rec709_D65, 1.5f, 1.5f, 1.5f)),
         m_immRoughness(0.1f), m_immAnisotropy(0.0f), m_immRotation(0.0f) {
         setupMaterialDescriptor();
     }
@@ -566,7 +564,7 @@ namespace VLR {
     }
 
     void MicrofacetScatteringSurfaceMaterial::setImmediateValueCoeff(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immCoeff = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immCoeff = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -579,7 +577,7 @@ namespace VLR {
     }
 
     void MicrofacetScatteringSurfaceMaterial::setImmediateValueEtaExt(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEtaExt = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEtaExt = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -592,7 +590,7 @@ namespace VLR {
     }
 
     void MicrofacetScatteringSurfaceMaterial::setImmediateValueEtaInt(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEtaInt = createTripletSpectrum(VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
+        m_immEtaInt = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_IndexOfRefraction, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -651,7 +649,7 @@ namespace VLR {
 
     LambertianScatteringSurfaceMaterial::LambertianScatteringSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immCoeff(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)), m_immF0(0.04f) {
+        m_immCoeff(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.8f, 0.8f, 0.8f)), m_immF0(0.04f) {
         setupMaterialDescriptor();
     }
 
@@ -681,7 +679,7 @@ namespace VLR {
     }
 
     void LambertianScatteringSurfaceMaterial::setImmediateValueCoeff(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immCoeff = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immCoeff = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -730,7 +728,7 @@ namespace VLR {
 
     UE4SurfaceMaterial::UE4SurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immBaseColor(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)), m_immOcculusion(0.0f), m_immRoughness(0.1f), m_immMetallic(0.0f) {
+        m_immBaseColor(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)), m_immOcculusion(0.0f), m_immRoughness(0.1f), m_immMetallic(0.0f) {
         setupMaterialDescriptor();
     }
 
@@ -762,7 +760,7 @@ namespace VLR {
     }
 
     void UE4SurfaceMaterial::setImmediateValueBaseColor(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immBaseColor = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immBaseColor = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -821,8 +819,8 @@ namespace VLR {
 
     OldStyleSurfaceMaterial::OldStyleSurfaceMaterial(Context &context) :
         SurfaceMaterial(context),
-        m_immDiffuseColor(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)),
-        m_immSpecularColor(createTripletSpectrum(VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.04f, 0.04f, 0.04f)),
+        m_immDiffuseColor(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.18f, 0.18f, 0.18f)),
+        m_immSpecularColor(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_Reflectance, VLRColorSpace_Rec709_D65, 0.04f, 0.04f, 0.04f)),
         m_immGlossiness(0.9f) {
         setupMaterialDescriptor();
     }
@@ -855,7 +853,7 @@ namespace VLR {
     }
 
     void OldStyleSurfaceMaterial::setImmediateValueDiffuseColor(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immDiffuseColor = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immDiffuseColor = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -868,7 +866,7 @@ namespace VLR {
     }
 
     void OldStyleSurfaceMaterial::setImmediateValueSpecularColor(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immSpecularColor = createTripletSpectrum(VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
+        m_immSpecularColor = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_Reflectance, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -916,7 +914,7 @@ namespace VLR {
     }
 
     DiffuseEmitterSurfaceMaterial::DiffuseEmitterSurfaceMaterial(Context &context) :
-        SurfaceMaterial(context), m_immEmittance(createTripletSpectrum(VLRSpectrumType_LightSource, VLRColorSpace_Rec709_D65, M_PI, M_PI, M_PI)) {
+        SurfaceMaterial(context), m_immEmittance(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_LightSource, VLRColorSpace_Rec709_D65, M_PI, M_PI, M_PI)) {
         setupMaterialDescriptor();
     }
 
@@ -944,7 +942,7 @@ namespace VLR {
     }
 
     void DiffuseEmitterSurfaceMaterial::setImmediateValueEmittance(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEmittance = createTripletSpectrum(VLRSpectrumType_LightSource, colorSpace, e0, e1, e2);
+        m_immEmittance = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_LightSource, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
     }
 
@@ -1049,7 +1047,7 @@ namespace VLR {
 
     EnvironmentEmitterSurfaceMaterial::EnvironmentEmitterSurfaceMaterial(Context &context) :
         SurfaceMaterial(context), m_nodeEmittanceTextured(nullptr), m_nodeEmittanceConstant(nullptr),
-        m_immEmittance(createTripletSpectrum(VLRSpectrumType_LightSource, VLRColorSpace_Rec709_D65, M_PI, M_PI, M_PI)), m_immScale(1.0f) {
+        m_immEmittance(createTripletSpectrumData(context.getRenderingMode(), VLRSpectrumType_LightSource, VLRColorSpace_Rec709_D65, M_PI, M_PI, M_PI)), m_immScale(1.0f) {
         setupMaterialDescriptor();
     }
 
@@ -1096,7 +1094,7 @@ namespace VLR {
     }
 
     void EnvironmentEmitterSurfaceMaterial::setImmediateValueEmittance(VLRColorSpace colorSpace, float e0, float e1, float e2) {
-        m_immEmittance = createTripletSpectrum(VLRSpectrumType_LightSource, colorSpace, e0, e1, e2);
+        m_immEmittance = createTripletSpectrumData(m_context.getRenderingMode(), VLRSpectrumType_LightSource, colorSpace, e0, e1, e2);
         setupMaterialDescriptor();
         if (m_importanceMap.isInitialized())
             m_importanceMap.finalize(m_context);
@@ -6,18 +6,18 @@ namespace VLR {
     class SurfaceMaterial : public Object {
     protected:
         struct OptiXProgramSet {
-            optix::Program callableProgramSetupBSDF;
-            optix::Program callableProgramBSDFGetBaseColor;
-            optix::Program callableProgramBSDFmatches;
-            optix::Program callableProgramBSDFSampleInternal;
-            optix::Program callableProgramBSDFEvaluateInternal;
-            optix::Program callableProgramBSDFEvaluatePDFInternal;
-            optix::Program callableProgramBSDFWeightInternal;
+            Backend::Program callableProgramSetupBSDF;
+            Backend::Program callableProgramBSDFGetBaseColor;
+            Backend::Program callableProgramBSDFmatches;
+            Backend::Program callableProgramBSDFSampleInternal;
+            Backend::Program callableProgramBSDFEvaluateInternal;
+            Backend::Program callableProgramBSDFEvaluatePDFInternal;
+            Backend::Program callableProgramBSDFWeightInternal;
             uint32_t bsdfProcedureSetIndex;
 
-            optix::Program callableProgramSetupEDF;
-            optix::Program callableProgramEDFEvaluateEmittanceInternal;
-            optix::Program callableProgramEDFEvaluateInternal;
+            Backend::Program callableProgramSetupEDF;
+            Backend::Program callableProgramEDFEvaluateEmittanceInternal;
+            Backend::Program callableProgramEDFEvaluateInternal;
             uint32_t edfProcedureSetIndex;
         };
 
@@ -50,7 +50,7 @@ namespace VLR {
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
 
         ShaderNodeSocketIdentifier m_nodeAlbedo;
-        TripletSpectrum m_immAlbedo;
+        TripletSpectrumData m_immAlbedo;
 
         void setupMaterialDescriptor() const;
 
@@ -76,9 +76,9 @@ namespace VLR {
         ShaderNodeSocketIdentifier m_nodeCoeffR;
         ShaderNodeSocketIdentifier m_nodeEta;
         ShaderNodeSocketIdentifier m_node_k;
-        TripletSpectrum m_immCoeffR;
-        TripletSpectrum m_immEta;
-        TripletSpectrum m_imm_k;
+        TripletSpectrumData m_immCoeffR;
+        TripletSpectrumData m_immEta;
+        TripletSpectrumData m_imm_k;
 
         void setupMaterialDescriptor() const;
 
@@ -108,9 +108,9 @@ namespace VLR {
         ShaderNodeSocketIdentifier m_nodeCoeff;
         ShaderNodeSocketIdentifier m_nodeEtaExt;
         ShaderNodeSocketIdentifier m_nodeEtaInt;
-        TripletSpectrum m_immCoeff;
-        TripletSpectrum m_immEtaExt;
-        TripletSpectrum m_immEtaInt;
+        TripletSpectrumData m_immCoeff;
+        TripletSpectrumData m_immEtaExt;
+        TripletSpectrumData m_immEtaInt;
 
         void setupMaterialDescriptor() const;
 
@@ -140,8 +140,8 @@ namespace VLR {
         ShaderNodeSocketIdentifier m_nodeEta;
         ShaderNodeSocketIdentifier m_node_k;
         ShaderNodeSocketIdentifier m_nodeRoughnessAnisotropyRotation;
-        TripletSpectrum m_immEta;
-        TripletSpectrum m_imm_k;
+        TripletSpectrumData m_immEta;
+        TripletSpectrumData m_imm_k;
         float m_immRoughness;
         float m_immAnisotropy;
         float m_immRotation;
@@ -177,9 +177,9 @@ namespace VLR {
         ShaderNodeSocketIdentifier m_nodeEtaExt;
         ShaderNodeSocketIdentifier m_nodeEtaInt;
         ShaderNodeSocketIdentifier m_nodeRoughnessAnisotropyRotation;
-        TripletSpectrum m_immCoeff;
-        TripletSpectrum m_immEtaExt;
-        TripletSpectrum m_immEtaInt;
+        TripletSpectrumData m_immCoeff;
+        TripletSpectrumData m_immEtaExt;
+        TripletSpectrumData m_immEtaInt;
         float m_immRoughness;
         float m_immAnisotropy;
         float m_immRotation;
@@ -215,7 +215,7 @@ namespace VLR {
 
         ShaderNodeSocketIdentifier m_nodeCoeff;
         ShaderNodeSocketIdentifier m_nodeF0;
-        TripletSpectrum m_immCoeff;
+        TripletSpectrumData m_immCoeff;
         float m_immF0;
 
         void setupMaterialDescriptor() const;
@@ -243,7 +243,7 @@ namespace VLR {
 
         ShaderNodeSocketIdentifier m_nodeBaseColor;
         ShaderNodeSocketIdentifier m_nodeOcclusionRoughnessMetallic;
-        TripletSpectrum m_immBaseColor;
+        TripletSpectrumData m_immBaseColor;
         float m_immOcculusion;
         float m_immRoughness;
         float m_immMetallic;
@@ -276,8 +276,8 @@ namespace VLR {
         ShaderNodeSocketIdentifier m_nodeDiffuseColor;
         ShaderNodeSocketIdentifier m_nodeSpecularColor;
         ShaderNodeSocketIdentifier m_nodeGlossiness;
-        TripletSpectrum m_immDiffuseColor;
-        TripletSpectrum m_immSpecularColor;
+        TripletSpectrumData m_immDiffuseColor;
+        TripletSpectrumData m_immSpecularColor;
         float m_immGlossiness;
 
         void setupMaterialDescriptor() const;
@@ -306,7 +306,7 @@ namespace VLR {
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
 
         ShaderNodeSocketIdentifier m_nodeEmittance;
-        TripletSpectrum m_immEmittance;
+        TripletSpectrumData m_immEmittance;
 
         void setupMaterialDescriptor() const;
 
@@ -358,7 +358,7 @@ namespace VLR {
 
         const EnvironmentTextureShaderNode* m_nodeEmittanceTextured;
         const ShaderNode* m_nodeEmittanceConstant;
-        TripletSpectrum m_immEmittance;
+        TripletSpectrumData m_immEmittance;
         RegularConstantContinuousDistribution2D m_importanceMap;
         float m_immScale;
 
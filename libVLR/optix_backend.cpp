@@ -0,0 +1,526 @@
+﻿#include "backend.h"
+
+namespace VLR {
+    namespace Backend {
+        // JP: ラッパーから包んでいるOptiXのオブジェクトを取り出す。別のバックエンドのオブジェクトを渡すのは誤り。
+        // EN: Take out the wrapped OptiX object from a wrapper. Passing an object of another backend is an error.
+        template <typename WrapperType, typename HandleType>
+        static typename WrapperType::RawType unwrap(const HandleType &handle) {
+            if (!handle)
+                return typename WrapperType::RawType();
+            auto wrapper = dynamic_cast<WrapperType*>(handle.get());
+            VLRAssert(wrapper, "The object belongs to another backend.");
+            return wrapper->getRaw();
+        }
+
+        template <typename WrapperType>
+        static Handle<typename WrapperType::InterfaceType> wrap(const typename WrapperType::RawType &raw) {
+            if (!raw)
+                return nullptr;
+            return Handle<typename WrapperType::InterfaceType>(std::make_shared<WrapperType>(raw));
+        }
+
+        template <typename RawObjectType, typename InterfaceObjectType>
+        class OptiXWrapper : public InterfaceObjectType {
+        protected:
+            optix::Handle<RawObjectType> m_raw;
+
+        public:
+            typedef optix::Handle<RawObjectType> RawType;
+            typedef InterfaceObjectType InterfaceType;
+
+            OptiXWrapper(const RawType &raw) : m_raw(raw) {}
+
+            const RawType &getRaw() const {
+                return m_raw;
+            }
+        };
+
+        class OptiXVariable;
+
+        // JP: 変数を持つオブジェクトのラッパー。
+        // EN: Wrapper of an object having variables.
+        template <typename RawObjectType, typename InterfaceObjectType>
+        class OptiXScopedWrapper : public OptiXWrapper<RawObjectType, InterfaceObjectType> {
+        public:
+            using OptiXWrapper<RawObjectType, InterfaceObjectType>::OptiXWrapper;
+
+            Variable declareVariable(const std::string &name) override {
+                return wrap<OptiXVariable>(this->m_raw[name]);
+            }
+            Variable queryVariable(const std::string &name) const override {
+                return wrap<OptiXVariable>(this->m_raw->queryVariable(name));
+            }
+        };
+
+
+
+        class OptiXBuffer : public OptiXWrapper<optix::BufferObj, BufferObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            int32_t getId() const override {
+                return m_raw->getId();
+            }
+
+            void setFormat(RTformat format) override {
+                m_raw->setFormat(format);
+            }
+            RTformat getFormat() const override {
+                return m_raw->getFormat();
+            }
+            void setElementSize(RTsize size) override {
+                m_raw->setElementSize(size);
+            }
+            RTsize getElementSize() const override {
+                return m_raw->getElementSize();
+            }
+            void setSize(RTsize width) override {
+                m_raw->setSize(width);
+            }
+            void setSize(RTsize width, RTsize height) override {
+                m_raw->setSize(width, height);
+            }
+            void getSize(RTsize &width) const override {
+                m_raw->getSize(width);
+            }
+            void getSize(RTsize &width, RTsize &height) const override {
+                m_raw->getSize(width, height);
+            }
+            uint32_t getDimensionality() const override {
+                return m_raw->getDimensionality();
+            }
+            void setMipLevelCount(uint32_t levels) override {
+                m_raw->setMipLevelCount(levels);
+            }
+            uint32_t getMipLevelCount() const override {
+                return m_raw->getMipLevelCount();
+            }
+            void getMipLevelSize(uint32_t level, RTsize &width, RTsize &height) const override {
+                m_raw->getMipLevelSize(level, width, height);
+            }
+
+            void* map(uint32_t level, uint32_t mapFlags) override {
+                return m_raw->map(level, mapFlags);
+            }
+            void unmap(uint32_t level) override {
+                m_raw->unmap(level);
+            }
+        };
+
+        class OptiXTextureSampler : public OptiXWrapper<optix::TextureSamplerObj, TextureSamplerObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            int32_t getId() const override {
+                return m_raw->getId();
+            }
+
+            void setBuffer(const Buffer &buffer) override {
+                m_raw->setBuffer(unwrap<OptiXBuffer>(buffer));
+            }
+            Buffer getBuffer() const override {
+                return wrap<OptiXBuffer>(m_raw->getBuffer());
+            }
+            void setWrapMode(uint32_t dim, RTwrapmode mode) override {
+                m_raw->setWrapMode(dim, mode);
+            }
+            RTwrapmode getWrapMode(uint32_t dim) const override {
+                return m_raw->getWrapMode(dim);
+            }
+            void setFilteringModes(RTfiltermode minification, RTfiltermode magnification, RTfiltermode mipmapping) override {
+                m_raw->setFilteringModes(minification, magnification, mipmapping);
+            }
+            void getFilteringModes(RTfiltermode &minification, RTfiltermode &magnification, RTfiltermode &mipmapping) const override {
+                m_raw->getFilteringModes(minification, magnification, mipmapping);
+            }
+            void setReadMode(RTtexturereadmode mode) override {
+                m_raw->setReadMode(mode);
+            }
+            RTtexturereadmode getReadMode() const override {
+                return m_raw->getReadMode();
+            }
+            void setIndexingMode(RTtextureindexmode mode) override {
+                m_raw->setIndexingMode(mode);
+            }
+            RTtextureindexmode getIndexingMode() const override {
+                return m_raw->getIndexingMode();
+            }
+            void setMaxAnisotropy(float value) override {
+                m_raw->setMaxAnisotropy(value);
+            }
+            void setMipLevelCount(uint32_t count) override {
+                m_raw->setMipLevelCount(count);
+            }
+        };
+
+        class OptiXProgram : public OptiXScopedWrapper<optix::ProgramObj, ProgramObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            int32_t getId() const override {
+                return m_raw->getId();
+            }
+        };
+
+        class OptiXAcceleration : public OptiXWrapper<optix::AccelerationObj, AccelerationObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void markDirty() override {
+                m_raw->markDirty();
+            }
+        };
+
+        class OptiXGeometryInstance;
+        class OptiXTransform;
+
+        class OptiXGeometryGroup : public OptiXWrapper<optix::GeometryGroupObj, GeometryGroupObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setAcceleration(const Acceleration &acceleration) override {
+                m_raw->setAcceleration(unwrap<OptiXAcceleration>(acceleration));
+            }
+            void addChild(const GeometryInstance &geomInst) override;
+            void removeChild(const GeometryInstance &geomInst) override;
+        };
+
+        class OptiXGroup : public OptiXWrapper<optix::GroupObj, GroupObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setAcceleration(const Acceleration &acceleration) override {
+                m_raw->setAcceleration(unwrap<OptiXAcceleration>(acceleration));
+            }
+            void addChild(const Transform &transform) override;
+            void addChild(const GeometryGroup &geomGroup) override {
+                m_raw->addChild(unwrap<OptiXGeometryGroup>(geomGroup));
+            }
+            void removeChild(const Transform &transform) override;
+            void removeChild(const GeometryGroup &geomGroup) override {
+                m_raw->removeChild(unwrap<OptiXGeometryGroup>(geomGroup));
+            }
+        };
+
+        class OptiXVariable : public OptiXWrapper<optix::VariableObj, VariableObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void set(const Buffer &buffer) override {
+                m_raw->set(unwrap<OptiXBuffer>(buffer));
+            }
+            void set(const TextureSampler &sampler) override {
+                m_raw->set(unwrap<OptiXTextureSampler>(sampler));
+            }
+            void set(const Program &program) override {
+                m_raw->set(unwrap<OptiXProgram>(program));
+            }
+            void set(const Group &group) override {
+                m_raw->set(unwrap<OptiXGroup>(group));
+            }
+            Buffer getBuffer() const override {
+                return wrap<OptiXBuffer>(m_raw->getBuffer());
+            }
+            TextureSampler getTextureSampler() const override {
+                return wrap<OptiXTextureSampler>(m_raw->getTextureSampler());
+            }
+            Program getProgram() const override {
+                return wrap<OptiXProgram>(m_raw->getProgram());
+            }
+            Group getGroup() const override {
+                return wrap<OptiXGroup>(m_raw->getGroup());
+            }
+
+            void setFloat(float f) override {
+                m_raw->setFloat(f);
+            }
+            void setInt(int32_t i) override {
+                m_raw->setInt(i);
+            }
+            void setUint(uint32_t u) override {
+                m_raw->setUint(u);
+            }
+            void setUint(const optix::uint2 &u) override {
+                m_raw->setUint(u);
+            }
+            float getFloat() const override {
+                return m_raw->getFloat();
+            }
+            int32_t getInt() const override {
+                return m_raw->getInt();
+            }
+            uint32_t getUint() const override {
+                return m_raw->getUint();
+            }
+            optix::uint2 getUint2() const override {
+                return m_raw->getUint2();
+            }
+
+            void setUserData(RTsize size, const void* ptr) override {
+                m_raw->setUserData(size, ptr);
+            }
+            void getUserData(RTsize size, void* ptr) const override {
+                m_raw->getUserData(size, ptr);
+            }
+        };
+
+        class OptiXGeometry : public OptiXScopedWrapper<optix::GeometryObj, GeometryObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setPrimitiveCount(uint32_t count) override {
+                m_raw->setPrimitiveCount(count);
+            }
+            void setIntersectionProgram(const Program &program) override {
+                m_raw->setIntersectionProgram(unwrap<OptiXProgram>(program));
+            }
+            void setBoundingBoxProgram(const Program &program) override {
+                m_raw->setBoundingBoxProgram(unwrap<OptiXProgram>(program));
+            }
+        };
+
+        class OptiXGeometryTriangles : public OptiXScopedWrapper<optix::GeometryTrianglesObj, GeometryTrianglesObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setPrimitiveCount(uint32_t count) override {
+                m_raw->setPrimitiveCount(count);
+            }
+            void setTriangleIndices(const Buffer &indexBuffer, RTsize indexBufferByteOffset, RTsize triIndicesByteStride, RTformat triIndicesFormat) override {
+                m_raw->setTriangleIndices(unwrap<OptiXBuffer>(indexBuffer), indexBufferByteOffset, triIndicesByteStride, triIndicesFormat);
+            }
+            void setVertices(uint32_t numVertices, const Buffer &vertexBuffer, RTsize vertexBufferByteOffset, RTsize vertexByteStride, RTformat positionFormat) override {
+                m_raw->setVertices(numVertices, unwrap<OptiXBuffer>(vertexBuffer), vertexBufferByteOffset, vertexByteStride, positionFormat);
+            }
+            void setAttributeProgram(const Program &program) override {
+                m_raw->setAttributeProgram(unwrap<OptiXProgram>(program));
+            }
+            void setBuildFlags(RTgeometrybuildflags flags) override {
+                m_raw->setBuildFlags(flags);
+            }
+        };
+
+        class OptiXMaterial : public OptiXScopedWrapper<optix::MaterialObj, MaterialObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setClosestHitProgram(uint32_t rayTypeIndex, const Program &program) override {
+                m_raw->setClosestHitProgram(rayTypeIndex, unwrap<OptiXProgram>(program));
+            }
+            void setAnyHitProgram(uint32_t rayTypeIndex, const Program &program) override {
+                m_raw->setAnyHitProgram(rayTypeIndex, unwrap<OptiXProgram>(program));
+            }
+        };
+
+        class OptiXGeometryInstance : public OptiXScopedWrapper<optix::GeometryInstanceObj, GeometryInstanceObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setGeometry(const Geometry &geometry) override {
+                m_raw->setGeometry(unwrap<OptiXGeometry>(geometry));
+            }
+            void setGeometryTriangles(const GeometryTriangles &geometryTriangles) override {
+                m_raw->setGeometryTriangles(unwrap<OptiXGeometryTriangles>(geometryTriangles));
+            }
+            void setMaterialCount(uint32_t count) override {
+                m_raw->setMaterialCount(count);
+            }
+            void setMaterial(uint32_t index, const Material &material) override {
+                m_raw->setMaterial(index, unwrap<OptiXMaterial>(material));
+            }
+        };
+
+        class OptiXTransform : public OptiXWrapper<optix::TransformObj, TransformObj> {
+        public:
+            using OptiXWrapper::OptiXWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            void setChild(const GeometryGroup &geomGroup) override {
+                m_raw->setChild(unwrap<OptiXGeometryGroup>(geomGroup));
+            }
+            void setMatrix(bool transpose, const float* matrix, const float* inverseMatrix) override {
+                m_raw->setMatrix(transpose, matrix, inverseMatrix);
+            }
+            void getMatrix(bool transpose, float* matrix, float* inverseMatrix) const override {
+                m_raw->getMatrix(transpose, matrix, inverseMatrix);
+            }
+        };
+
+        void OptiXGeometryGroup::addChild(const GeometryInstance &geomInst) {
+            m_raw->addChild(unwrap<OptiXGeometryInstance>(geomInst));
+        }
+
+        void OptiXGeometryGroup::removeChild(const GeometryInstance &geomInst) {
+            m_raw->removeChild(unwrap<OptiXGeometryInstance>(geomInst));
+        }
+
+        void OptiXGroup::addChild(const Transform &transform) {
+            m_raw->addChild(unwrap<OptiXTransform>(transform));
+        }
+
+        void OptiXGroup::removeChild(const Transform &transform) {
+            m_raw->removeChild(unwrap<OptiXTransform>(transform));
+        }
+
+
+
+        class OptiXContext : public OptiXScopedWrapper<optix::ContextObj, ContextObj> {
+        public:
+            using OptiXScopedWrapper::OptiXScopedWrapper;
+
+            void destroy() override {
+                m_raw->destroy();
+            }
+
+            Buffer createBuffer(uint32_t type) override {
+                return wrap<OptiXBuffer>(m_raw->createBuffer(type));
+            }
+            Buffer createBuffer(uint32_t type, RTformat format) override {
+                return wrap<OptiXBuffer>(m_raw->createBuffer(type, format));
+            }
+            Buffer createBuffer(uint32_t type, RTformat format, RTsize width) override {
+                return wrap<OptiXBuffer>(m_raw->createBuffer(type, format, width));
+            }
+            Buffer createBuffer(uint32_t type, RTformat format, RTsize width, RTsize height) override {
+                return wrap<OptiXBuffer>(m_raw->createBuffer(type, format, width, height));
+            }
+            Buffer createBufferFromGLBO(uint32_t type, uint32_t glBufferID) override {
+                return wrap<OptiXBuffer>(m_raw->createBufferFromGLBO(type, glBufferID));
+            }
+            TextureSampler createTextureSampler() override {
+                return wrap<OptiXTextureSampler>(m_raw->createTextureSampler());
+            }
+            Program createProgramFromPTXString(const std::string &ptx, const std::string &programName) override {
+                return wrap<OptiXProgram>(m_raw->createProgramFromPTXString(ptx, programName));
+            }
+            Geometry createGeometry() override {
+                return wrap<OptiXGeometry>(m_raw->createGeometry());
+            }
+            GeometryTriangles createGeometryTriangles() override {
+                return wrap<OptiXGeometryTriangles>(m_raw->createGeometryTriangles());
+            }
+            GeometryInstance createGeometryInstance() override {
+                return wrap<OptiXGeometryInstance>(m_raw->createGeometryInstance());
+            }
+            Material createMaterial() override {
+                return wrap<OptiXMaterial>(m_raw->createMaterial());
+            }
+            Group createGroup() override {
+                return wrap<OptiXGroup>(m_raw->createGroup());
+            }
+            GeometryGroup createGeometryGroup() override {
+                return wrap<OptiXGeometryGroup>(m_raw->createGeometryGroup());
+            }
+            Transform createTransform() override {
+                return wrap<OptiXTransform>(m_raw->createTransform());
+            }
+            Acceleration createAcceleration(const std::string &builder) override {
+                return wrap<OptiXAcceleration>(m_raw->createAcceleration(builder.c_str()));
+            }
+
+            Buffer getBufferFromId(int32_t bufferID) const override {
+                return wrap<OptiXBuffer>(m_raw->getBufferFromId(bufferID));
+            }
+            TextureSampler getTextureSamplerFromId(int32_t samplerID) const override {
+                return wrap<OptiXTextureSampler>(m_raw->getTextureSamplerFromId(samplerID));
+            }
+
+            void setEntryPointCount(uint32_t count) override {
+                m_raw->setEntryPointCount(count);
+            }
+            void setRayTypeCount(uint32_t count) override {
+                m_raw->setRayTypeCount(count);
+            }
+            void setRayGenerationProgram(uint32_t entryPointIndex, const Program &program) override {
+                m_raw->setRayGenerationProgram(entryPointIndex, unwrap<OptiXProgram>(program));
+            }
+            void setExceptionProgram(uint32_t entryPointIndex, const Program &program) override {
+                m_raw->setExceptionProgram(entryPointIndex, unwrap<OptiXProgram>(program));
+            }
+            void setMissProgram(uint32_t rayTypeIndex, const Program &program) override {
+                m_raw->setMissProgram(rayTypeIndex, unwrap<OptiXProgram>(program));
+            }
+            void setStackSize(RTsize stackSize) override {
+                m_raw->setStackSize(stackSize);
+            }
+            RTsize getStackSize() const override {
+                return m_raw->getStackSize();
+            }
+            void setMaxTraceDepth(uint32_t maxDepth) override {
+                m_raw->setMaxTraceDepth(maxDepth);
+            }
+            void setMaxCallableProgramDepth(uint32_t maxDepth) override {
+                m_raw->setMaxCallableProgramDepth(maxDepth);
+            }
+            void setPrintEnabled(bool enabled) override {
+                m_raw->setPrintEnabled(enabled);
+            }
+            void setPrintBufferSize(RTsize size) override {
+                m_raw->setPrintBufferSize(size);
+            }
+            void setExceptionEnabled(RTexception exception, bool enabled) override {
+                m_raw->setExceptionEnabled(exception, enabled);
+            }
+            void setTimeoutCallback(RTtimeoutcallback callback, double minPollingSeconds) override {
+                m_raw->setTimeoutCallback(callback, minPollingSeconds);
+            }
+
+            void validate() override {
+                m_raw->validate();
+            }
+            void launch(uint32_t entryPointIndex, RTsize width, RTsize height) override {
+                m_raw->launch(entryPointIndex, width, height);
+            }
+        };
+
+
+
+        Context createOptiXContext() {
+            return wrap<OptiXContext>(optix::Context::create());
+        }
+    }
+}
@@ -0,0 +1,319 @@
+﻿#include "resolve.h"
+
+#include <thread>
+#include <atomic>
+
+namespace VLR {
+    // JP: sRGBのガンマ曲線を線形補間で引く表の分割数。8ビットへの量子化に対して誤差は十分小さい。
+    // EN: Number of divisions of the table to look up the sRGB gamma curve with linear interpolation. The error is small enough for 8-bit quantization.
+    static const uint32_t NumGammaTableDivisions = 4096;
+
+    struct GammaTable {
+        // JP: 入力がちょうど1のときも補間の右端を読めるように1要素多く持つ。
+        // EN: Have one extra entry so that the right end of the interpolation can be read even when the input is exactly 1.
+        float values[NumGammaTableDivisions + 2];
+
+        GammaTable() {
+            for (uint32_t i = 0; i < NumGammaTableDivisions + 2; ++i)
+                values[i] = sRGB_gamma(std::fmin((float)i / NumGammaTableDivisions, 1.0f));
+        }
+    };
+
+    static const uint8_t BayerMatrix8x8[8][8] = {
+        { 0, 32,  8, 40,  2, 34, 10, 42 },
+        { 48, 16, 56, 24, 50, 18, 58, 26 },
+        { 12, 44,  4, 36, 14, 46,  6, 38 },
+        { 60, 28, 52, 20, 62, 30, 54, 22 },
+        { 3, 35, 11, 43,  1, 33,  9, 41 },
+        { 51, 19, 59, 27, 49, 17, 57, 25 },
+        { 15, 47,  7, 39, 13, 45,  5, 37 },
+        { 63, 31, 55, 23, 61, 29, 53, 21 },
+    };
+
+    // JP: 0以下の入力に対するexp()。Cody-Waiteの範囲縮小とCephesのexpfの多項式を使う。
+    // EN: exp() for non-positive inputs. Use the range reduction of Cody-Waite and the polynomial of expf in Cephes.
+    static inline __m128 expNonPositive(__m128 x) {
+        x = _mm_max_ps(x, _mm_set1_ps(-87.0f));
+        __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+        __m128 fn = _mm_cvtepi32_ps(n);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+        r = _mm_add_ps(r, _mm_mul_ps(fn, _mm_set1_ps(2.12194440e-4f)));
+
+        __m128 p = _mm_set1_ps(1.9875691500e-4f);
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507e-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+        p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), _mm_add_ps(r, _mm_set1_ps(1.0f)));
+
+        __m128i scale = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+        return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+    }
+
+    // JP: 負の値とNaNを0にしてからトーンマップし、[0, 1]に収める。
+    // EN: Tonemap after making negative values and NaN zero, and fit the result into [0, 1].
+    static inline __m128 tonemap(VLRTonemapOperator op, __m128 v) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        v = _mm_max_ps(v, zero);
+        switch (op) {
+        case VLRTonemapOperator_Exponential:
+            v = _mm_sub_ps(one, expNonPositive(_mm_sub_ps(zero, v)));
+            break;
+        case VLRTonemapOperator_Reinhard:
+            // JP: v / (1 + v)と等価だが、無限大に対してもNaNにならない。
+            // EN: Equivalent to v / (1 + v) but doesn't become NaN for infinity.
+            v = _mm_sub_ps(one, _mm_div_ps(one, _mm_add_ps(one, v)));
+            break;
+        default:
+            break;
+        }
+        return _mm_min_ps(_mm_max_ps(v, zero), one);
+    }
+
+    static inline __m128 applyGamma(const GammaTable &table, __m128 v) {
+        __m128 fIdx = _mm_mul_ps(v, _mm_set1_ps((float)NumGammaTableDivisions));
+        __m128i idx = _mm_cvttps_epi32(fIdx);
+        __m128 t = _mm_sub_ps(fIdx, _mm_cvtepi32_ps(idx));
+        alignas(16) int32_t idxs[4];
+        _mm_store_si128((__m128i*)idxs, idx);
+        const float* values = table.values;
+        __m128 v0 = _mm_setr_ps(values[idxs[0]], values[idxs[1]], values[idxs[2]], values[idxs[3]]);
+        __m128 v1 = _mm_setr_ps(values[idxs[0] + 1], values[idxs[1] + 1], values[idxs[2] + 1], values[idxs[3] + 1]);
+        return _mm_add_ps(v0, _mm_mul_ps(t, _mm_sub_ps(v1, v0)));
+    }
+
+    // JP: floatからhalfへの最近接偶数丸めによる変換。各32ビットレーンの下位16ビットに結果が入る。
+    //     符号ビットを算術シフトで広げているので、_mm_packs_epi32()でそのまま16ビットに詰められる。
+    // EN: Conversion from float to half with round-to-nearest-even. The results are in the lower 16 bits of each 32-bit lane.
+    //     The sign bit is extended by the arithmetic shift, so _mm_packs_epi32() can pack them into 16 bits as is.
+    static inline __m128i convertToHalf(__m128 v) {
+        const __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+        __m128 sign = _mm_and_ps(v, _mm_set1_ps(-0.0f));
+        __m128 absV = _mm_xor_ps(v, sign);
+        __m128i absBits = _mm_castps_si128(absV);
+
+        __m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absV, absV));
+        __m128i infOrNaN = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+        __m128i isRegular = _mm_cmpgt_epi32(f16Max, absBits);
+        __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+
+        __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absV, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+        __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+        __m128i bits = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNaN));
+        return _mm_or_si128(bits, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    static uint32_t getResolvedPixelSize(VLRResolveFormat format) {
+        switch (format) {
+        case VLRResolveFormat_LinearRGB:
+            return sizeof(float) * 3;
+        case VLRResolveFormat_HalfRGBA:
+            return sizeof(uint16_t) * 4;
+        case VLRResolveFormat_SRGB8:
+            return sizeof(uint32_t);
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return 0;
+        }
+    }
+
+    static void getAccumulatedXYZ(const Shared::CompactXYZStorage &value, float XYZ[3]) {
+        value.getXYZ(XYZ);
+    }
+
+    template <typename SpectrumStorageType>
+    static void getAccumulatedXYZ(const SpectrumStorageType &value, float XYZ[3]) {
+        value.getValue().result.toXYZ(XYZ);
+    }
+
+    // JP: 画素ごとの分岐を避けるため、蓄積値の型と出力形式ごとに実体化する。
+    // EN: Instantiate per type of accumulated values and output format to avoid branches per pixel.
+    template <typename AccumulationType, VLRResolveFormat format>
+    static void resolveRow(const ResolveSource &src, const VLRResolveParameters &params, const GammaTable &gammaTable,
+                           uint32_t y, uint8_t* dstRow) {
+        const uint32_t pixelSize = getResolvedPixelSize(format);
+        auto values = (AccumulationType*)src.values;
+
+        __m128 dither[2];
+        for (int i = 0; i < 2; ++i) {
+            const uint8_t* thresholds = BayerMatrix8x8[y % 8] + 4 * i;
+            dither[i] = params.dither ?
+                _mm_setr_ps((thresholds[0] + 0.5f) / 64 - 0.5f, (thresholds[1] + 0.5f) / 64 - 0.5f,
+                            (thresholds[2] + 0.5f) / 64 - 0.5f, (thresholds[3] + 0.5f) / 64 - 0.5f) :
+                _mm_setzero_ps();
+        }
+
+        for (uint32_t x = 0; x < src.width; x += 4) {
+            uint32_t numPixels = std::min<uint32_t>(src.width - x, 4);
+
+            // JP: 4画素分のXYZを集めてSoAにする。サンプル数の逆数に露出を掛けたものでスケールする。
+            // EN: Gather XYZ of 4 pixels into SoA. Scale by the reciprocal of the number of samples multiplied by the exposure.
+            alignas(16) float XYZs[3][4] = {};
+            alignas(16) int32_t numSamples[4] = {};
+            for (uint32_t i = 0; i < numPixels; ++i) {
+                uint32_t index = y * src.width + x + i;
+                float XYZ[3];
+                getAccumulatedXYZ(values[index], XYZ);
+                XYZs[0][i] = XYZ[0];
+                XYZs[1][i] = XYZ[1];
+                XYZs[2][i] = XYZ[2];
+                numSamples[i] = src.pixelStats ? src.pixelStats[index].numSamples : 1;
+            }
+            __m128 fNumSamples = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)numSamples));
+            __m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(params.exposure), fNumSamples),
+                                      _mm_cmpgt_ps(fNumSamples, _mm_setzero_ps()));
+            __m128 X = _mm_mul_ps(_mm_load_ps(XYZs[0]), scale);
+            __m128 Y = _mm_mul_ps(_mm_load_ps(XYZs[1]), scale);
+            __m128 Z = _mm_mul_ps(_mm_load_ps(XYZs[2]), scale);
+
+            const float* mat = mat_XYZ_to_Rec709_D65;
+            __m128 rgb[3];
+            for (int c = 0; c < 3; ++c) {
+                rgb[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[c + 0]), X),
+                                               _mm_mul_ps(_mm_set1_ps(mat[c + 3]), Y)),
+                                    _mm_mul_ps(_mm_set1_ps(mat[c + 6]), Z));
+            }
+
+            // JP: 端数の画素は一旦ブロックに書き出してからコピーする。
+            // EN: Write pixels of the remainder to the block once, then copy them.
+            alignas(16) uint8_t block[4 * sizeof(float) * 3];
+            uint8_t* dstPixels = numPixels == 4 ? dstRow + pixelSize * x : block;
+            switch (format) {
+            case VLRResolveFormat_LinearRGB: {
+                alignas(16) float values[3][4];
+                for (int c = 0; c < 3; ++c)
+                    _mm_store_ps(values[c], rgb[c]);
+                auto dstValues = (float*)dstPixels;
+                for (int i = 0; i < 4; ++i) {
+                    dstValues[3 * i + 0] = values[0][i];
+                    dstValues[3 * i + 1] = values[1][i];
+                    dstValues[3 * i + 2] = values[2][i];
+                }
+                break;
+            }
+            case VLRResolveFormat_HalfRGBA: {
+                __m128i rg = _mm_unpacklo_epi16(_mm_packs_epi32(convertToHalf(rgb[0]), _mm_setzero_si128()),
+                                                _mm_packs_epi32(convertToHalf(rgb[1]), _mm_setzero_si128()));
+                __m128i ba = _mm_unpacklo_epi16(_mm_packs_epi32(convertToHalf(rgb[2]), _mm_setzero_si128()),
+                                                _mm_set1_epi16(0x3C00));
+                _mm_storeu_si128((__m128i*)dstPixels + 0, _mm_unpacklo_epi32(rg, ba));
+                _mm_storeu_si128((__m128i*)dstPixels + 1, _mm_unpackhi_epi32(rg, ba));
+                break;
+            }
+            case VLRResolveFormat_SRGB8: {
+                // JP: ディザーが無い場合は従来通りfloor(v * 256)を255で頭打ちにする。
+                // EN: Clamp floor(v * 256) to 255 as before when there is no dithering.
+                __m128i packed = _mm_set1_epi32(0xFF000000);
+                for (int c = 0; c < 3; ++c) {
+                    __m128 v = applyGamma(gammaTable, tonemap(params.tonemapOperator, rgb[c]));
+                    v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(256.0f)), dither[(x / 4) % 2]);
+                    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+                    packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvttps_epi32(v), 8 * c));
+                }
+                _mm_storeu_si128((__m128i*)dstPixels, packed);
+                break;
+            }
+            default:
+                VLRAssert_ShouldNotBeCalled();
+                break;
+            }
+
+            if (numPixels < 4)
+                std::copy_n(block, pixelSize * numPixels, dstRow + pixelSize * x);
+        }
+    }
+
+    typedef void (*ResolveRowFunction)(const ResolveSource &, const VLRResolveParameters &, const GammaTable &, uint32_t, uint8_t*);
+
+    template <typename AccumulationType>
+    static ResolveRowFunction getResolveRowFunction(VLRResolveFormat format) {
+        switch (format) {
+        case VLRResolveFormat_LinearRGB:
+            return &resolveRow<AccumulationType, VLRResolveFormat_LinearRGB>;
+        case VLRResolveFormat_HalfRGBA:
+            return &resolveRow<AccumulationType, VLRResolveFormat_HalfRGBA>;
+        case VLRResolveFormat_SRGB8:
+            return &resolveRow<AccumulationType, VLRResolveFormat_SRGB8>;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return nullptr;
+        }
+    }
+
+    void resolveOnHost(const ResolveSource &src, const VLRResolveParameters &params, void* dst) {
+        static const GammaTable gammaTable;
+
+        const uint32_t pixelSize = getResolvedPixelSize(params.format);
+        ResolveRowFunction resolveRowFunc;
+        if (src.accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+            resolveRowFunc = getResolveRowFunction<Shared::CompactXYZStorage>(params.format);
+        else if (src.renderingMode == VLRRenderingMode_Spectral)
+            resolveRowFunc = getResolveRowFunction<SpectralRenderingTypes::SpectrumStorage>(params.format);
+        else
+            resolveRowFunc = getResolveRowFunction<RGBRenderingTypes::SpectrumStorage>(params.format);
+
+        uint32_t numThreads = std::max<uint32_t>(1, std::min<uint32_t>(std::thread::hardware_concurrency(), src.height));
+        std::atomic<uint32_t> rowCounter(0);
+        auto worker = [&]() {
+            while (true) {
+                uint32_t y = rowCounter.fetch_add(1);
+                if (y >= src.height)
+                    break;
+                resolveRowFunc(src, params, gammaTable, y, (uint8_t*)dst + pixelSize * src.width * y);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < numThreads; ++i)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+
+
+    template <typename AccumulationType>
+    static void averageToXYZ(const ResolveSource &src, Shared::CompactXYZStorage* dstValues) {
+        auto values = (const AccumulationType*)src.values;
+        size_t numPixels = (size_t)src.width * src.height;
+        for (size_t i = 0; i < numPixels; ++i) {
+            uint32_t numSamples = src.pixelStats[i].numSamples;
+            float XYZ[3] = { 0.0f, 0.0f, 0.0f };
+            if (numSamples > 0) {
+                getAccumulatedXYZ(values[i], XYZ);
+                for (int c = 0; c < 3; ++c)
+                    XYZ[c] /= numSamples;
+            }
+            dstValues[i].reset();
+            dstValues[i].add(XYZ);
+        }
+    }
+
+    AccumulationSnapshot::AccumulationSnapshot(const ResolveSource &src) :
+        m_values((size_t)src.width * src.height) {
+        if (src.accumulationFormat == VLRAccumulationFormat_CompactXYZ)
+            averageToXYZ<Shared::CompactXYZStorage>(src, m_values.data());
+        else if (src.renderingMode == VLRRenderingMode_Spectral)
+            averageToXYZ<SpectralRenderingTypes::SpectrumStorage>(src, m_values.data());
+        else
+            averageToXYZ<RGBRenderingTypes::SpectrumStorage>(src, m_values.data());
+
+        m_source.renderingMode = src.renderingMode;
+        m_source.accumulationFormat = VLRAccumulationFormat_CompactXYZ;
+        m_source.values = m_values.data();
+        m_source.pixelStats = nullptr;
+        m_source.width = src.width;
+        m_source.height = src.height;
+    }
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+namespace VLR {
+    // JP: ホスト側の解決処理が読む蓄積バッファー。valuesの要素の型はレンダリングモードと蓄積形式で決まる。
+    //     pixelStatsがnullptrの場合、valuesはサンプル数で割った後のCompactXYZStorageとする。
+    // EN: Accumulation buffers read by the resolve on the host. The element type of values is determined by the rendering mode and the accumulation format.
+    //     values are assumed to be CompactXYZStorage already divided by the number of samples if pixelStats is nullptr.
+    struct ResolveSource {
+        VLRRenderingMode renderingMode;
+        VLRAccumulationFormat accumulationFormat;
+        void* values;
+        const Shared::PixelStatistics* pixelStats;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // JP: 蓄積値からRGBへの変換、露出、トーンマップ、ガンマ補正、量子化を1パスで行う。
+    //     行単位でホストのスレッドに分配し、各行は4画素ずつSSEで処理する。
+    //     dstにはwidth * height画素分の大きさがあり、行間に隙間は無いものとする。
+    // EN: Perform conversion from the accumulated values to RGB, exposure, tonemapping, gamma correction and quantization in one pass.
+    //     Rows are distributed over host threads, and each row is processed 4 pixels at a time with SSE.
+    //     dst is assumed to have the size of width * height pixels without gaps between rows.
+    void resolveOnHost(const ResolveSource &src, const VLRResolveParameters &params, void* dst);
+
+
+
+    // JP: 蓄積バッファーをサンプル数で割ったXYZ(24B/画素)としてホストに写し取ったもの。コンテキストから独立しているので、
+    //     レンダリングを続けながら別のスレッドで解決できる。蓄積形式そのままの写しやCompensatedSumの補償項は持たない。
+    // EN: Copy of the accumulation buffer on the host as XYZ divided by the number of samples (24B per pixel). This is independent of the context,
+    //     so this can be resolved on another thread while rendering continues. This doesn't hold a raw copy in the accumulation format
+    //     nor the compensation terms of CompensatedSum.
+    class AccumulationSnapshot {
+        std::vector<Shared::CompactXYZStorage> m_values;
+        ResolveSource m_source;
+
+    public:
+        AccumulationSnapshot(const ResolveSource &src);
+
+        uint32_t getWidth() const {
+            return m_source.width;
+        }
+        uint32_t getHeight() const {
+            return m_source.height;
+        }
+
+        void resolve(const VLRResolveParameters &params, void* dst) const {
+            resolveOnHost(m_source, params, dst);
+        }
+    };
+}
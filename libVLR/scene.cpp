@@ -1,20 +1,6 @@
 ﻿#include "scene.h"
 
 namespace VLR {
-    static std::string readTxtFile(const std::string& filepath) {
-        std::ifstream ifs;
-        ifs.open(filepath, std::ios::in);
-        if (ifs.fail())
-            return "";
-
-        std::stringstream sstream;
-        sstream << ifs.rdbuf();
-
-        return std::string(sstream.str());
-    };
-
-
-
     // ----------------------------------------------------------------
     // Shallow Hierarchy
 
@@ -24,13 +10,9 @@ namespace VLR {
         status.hasGeometryDescendant = transform->hasGeometryDescendant(&descendant);
         m_transforms[transform] = status;
         if (status.hasGeometryDescendant) {
-            optix::Transform optixTransform = transform->getOptiXObject();
+            Backend::Transform optixTransform = transform->getOptiXObject();
             optixTransform->setChild(descendant->getOptiXObject());
 
-            RTobject trChild;
-            rtTransformGetChild(optixTransform->get(), &trChild);
-            VLRAssert(trChild, "Transform must have a child.");
-
             m_optixGroup->addChild(optixTransform);
             m_optixAcceleration->markDirty();
             ++m_numValidTransforms;
@@ -52,7 +34,7 @@ namespace VLR {
         VLRAssert(m_transforms.count(transform), "transform 0x%p is not a child.", transform);
         TransformStatus &status = m_transforms.at(transform);
         SHGeometryGroup* descendant;
-        optix::Transform optixTransform = transform->getOptiXObject();
+        Backend::Transform optixTransform = transform->getOptiXObject();
         if (status.hasGeometryDescendant) {
             if (!transform->hasGeometryDescendant()) {
                 m_optixGroup->removeChild(optixTransform);
@@ -65,22 +47,22 @@ namespace VLR {
             if (transform->hasGeometryDescendant(&descendant)) {
                 optixTransform->setChild(descendant->getOptiXObject());
 
-                RTobject trChild;
-                rtTransformGetChild(optixTransform->get(), &trChild);
-                VLRAssert(trChild, "Transform must have a child.");
-
                 m_optixGroup->addChild(optixTransform);
                 m_optixAcceleration->markDirty();
                 status.hasGeometryDescendant = true;
                 ++m_numValidTransforms;
             }
         }
+        // JP: 子孫のジオメトリが変化した場合もAABBが変わりうる。
+        // EN: The AABB can change also when the descendant geometry has changed.
+        if (status.hasGeometryDescendant)
+            m_optixAcceleration->markDirty();
     }
 
     void SHGroup::addChild(SHGeometryGroup* geomGroup) {
         m_geomGroups.insert(geomGroup);
 
-        optix::GeometryGroup optixGeomGroup = geomGroup->getOptiXObject();
+        Backend::GeometryGroup optixGeomGroup = geomGroup->getOptiXObject();
 
         m_optixGroup->addChild(optixGeomGroup);
         m_optixAcceleration->markDirty();
@@ -89,191 +71,54 @@ namespace VLR {
     void SHGroup::removeChild(SHGeometryGroup* geomGroup) {
         m_geomGroups.erase(geomGroup);
 
-        optix::GeometryGroup optixGeomGroup = geomGroup->getOptiXObject();
+        Backend::GeometryGroup optixGeomGroup = geomGroup->getOptiXObject();
 
         m_optixGroup->removeChild(optixGeomGroup);
         m_optixAcceleration->markDirty();
     }
 
-    void SHGroup::printOptiXHierarchy() {
-        std::stack<RTobject> stackRTObjects;
-        std::stack<RTobjecttype> stackRTObjectTypes;
-
-        std::set<RTgroup> groupList;
-        std::set<RTtransform> transformList;
-        std::set<RTgeometrygroup> geometryGroupList;
-        std::set<RTgeometryinstance> geometryInstanceList;
-
-        stackRTObjects.push(m_optixGroup->get());
-        stackRTObjectTypes.push(RT_OBJECTTYPE_GROUP);
-        while (!stackRTObjects.empty()) {
-            RTobject object = stackRTObjects.top();
-            RTobjecttype objType = stackRTObjectTypes.top();
-            stackRTObjects.pop();
-            stackRTObjectTypes.pop();
-
-            vlrprintf("0x%p: ", object);
-
-            switch (objType) {
-            case RT_OBJECTTYPE_GROUP: {
-                auto group = (RTgroup)object;
-                vlrprintf("Group\n");
-
-                groupList.insert(group);
-
-                uint32_t numChildren;
-                rtGroupGetChildCount(group, &numChildren);
-                for (int i = numChildren - 1; i >= 0; --i) {
-                    RTobject childObject = nullptr;
-                    RTobjecttype childObjType;
-                    rtGroupGetChild(group, i, &childObject);
-                    rtGroupGetChildType(group, i, &childObjType);
-
-                    vlrprintf("- %u: 0x%p\n", i, childObject);
-
-                    stackRTObjects.push(childObject);
-                    stackRTObjectTypes.push(childObjType);
-                }
-
-                break;
-            }
-            case RT_OBJECTTYPE_TRANSFORM: {
-                auto transform = (RTtransform)object;
-                vlrprintf("Transform\n");
-
-                transformList.insert(transform);
-
-                RTobject childObject = nullptr;
-                RTobjecttype childObjType;
-                rtTransformGetChild(transform, &childObject);
-                rtTransformGetChildType(transform, &childObjType);
-
-                vlrprintf("- 0x%p\n", childObject);
-
-                stackRTObjects.push(childObject);
-                stackRTObjectTypes.push(childObjType);
-
-                break;
-            }
-            case RT_OBJECTTYPE_SELECTOR: {
-                VLRAssert_NotImplemented();
-                break;
-            }
-            case RT_OBJECTTYPE_GEOMETRY_GROUP: {
-                auto geometryGroup = (RTgeometrygroup)object;
-                vlrprintf("GeometryGroup\n");
-
-                geometryGroupList.insert(geometryGroup);
-
-                uint32_t numChildren;
-                rtGeometryGroupGetChildCount(geometryGroup, &numChildren);
-                for (int i = numChildren - 1; i >= 0; --i) {
-                    RTgeometryinstance childObject = nullptr;
-                    rtGeometryGroupGetChild(geometryGroup, i, &childObject);
-
-                    vlrprintf("- %u: 0x%p\n", i, childObject);
-
-                    stackRTObjects.push(childObject);
-                    stackRTObjectTypes.push(RT_OBJECTTYPE_GEOMETRY_INSTANCE);
-                }
-
-                break;
-            }
-            case RT_OBJECTTYPE_GEOMETRY_INSTANCE: {
-                auto geometryInstance = (RTgeometryinstance)object;
-                vlrprintf("GeometryInstance\n");
-
-                RTgeometry geometry = nullptr;
-                RTgeometrytriangles geometryTriangles = nullptr;
-                rtGeometryInstanceGetGeometry(geometryInstance, &geometry);
-                rtGeometryInstanceGetGeometryTriangles(geometryInstance, &geometryTriangles);
-                VLRAssert((geometry != nullptr) ^ (geometryTriangles != nullptr), "Only one Geometry or GeometryTriangles node can be attached to a GeometryInstance at once.");
-                uint32_t numPrims;
-                if (geometry) {
-                    rtGeometryGetPrimitiveCount(geometry, &numPrims);
-                    vlrprintf("- Geometry 0x%p: %u [primitives]\n", geometry, numPrims);
-                }
-                if (geometryTriangles) {
-                    rtGeometryTrianglesGetPrimitiveCount(geometryTriangles, &numPrims);
-                    vlrprintf("- GeometryTriangles 0x%p: %u [primitives]\n", geometryTriangles, numPrims);
-                }
-
-                geometryInstanceList.insert(geometryInstance);
-
-                break;
-            }
-            default:
-                vlrprintf("\n");
-                VLRAssert_ShouldNotBeCalled();
-                break;
-            }
-
-            vlrprintf("\n");
-        }
-
-
-
-        vlrprintf("Groups:\n");
-        for (auto group : groupList) {
-            vlrprintf("  0x%p:\n", group);
-            uint32_t numChildren;
-            rtGroupGetChildCount(group, &numChildren);
-            RTacceleration acceleration;
-            rtGroupGetAcceleration(group, &acceleration);
-            int32_t isDirty = 0;
-            rtAccelerationIsDirty(acceleration, &isDirty);
-            vlrprintf("  Status: %s\n", isDirty ? "dirty" : "");
-            for (int i = 0; i < numChildren; ++i) {
-                RTobject childObject = nullptr;
-                rtGroupGetChild(group, i, &childObject);
-
-                vlrprintf("  - %u: 0x%p\n", i, childObject);
-            }
-        }
-
-        vlrprintf("Transforms:\n");
-        for (auto transform : transformList) {
-            vlrprintf("  0x%p:\n", transform);
-            RTobject childObject = nullptr;
-            rtTransformGetChild(transform, &childObject);
-            float mat[16];
-            float invMat[16];
-            rtTransformGetMatrix(transform, true, mat, invMat);
-            vlrprintf("    Matrix\n");
-            vlrprintf("      %g, %g, %g, %g\n", mat[0], mat[4], mat[8], mat[12]);
-            vlrprintf("      %g, %g, %g, %g\n", mat[1], mat[5], mat[9], mat[13]);
-            vlrprintf("      %g, %g, %g, %g\n", mat[2], mat[6], mat[10], mat[14]);
-            vlrprintf("      %g, %g, %g, %g\n", mat[3], mat[7], mat[11], mat[15]);
-            vlrprintf("    Inverse Matrix\n");
-            vlrprintf("      %g, %g, %g, %g\n", invMat[0], invMat[4], invMat[8], invMat[12]);
-            vlrprintf("      %g, %g, %g, %g\n", invMat[1], invMat[5], invMat[9], invMat[13]);
-            vlrprintf("      %g, %g, %g, %g\n", invMat[2], invMat[6], invMat[10], invMat[14]);
-            vlrprintf("      %g, %g, %g, %g\n", invMat[3], invMat[7], invMat[11], invMat[15]);
-
-            vlrprintf("  - 0x%p\n", childObject);
+    void SHGroup::getGeometryChildren(std::vector<std::pair<const SHTransform*, const SHGeometryGroup*>>* children) const {
+        for (auto it = m_transforms.cbegin(); it != m_transforms.cend(); ++it) {
+            if (!it->second.hasGeometryDescendant)
+                continue;
+            SHGeometryGroup* descendant;
+            it->first->hasGeometryDescendant(&descendant);
+            children->emplace_back(it->first, descendant);
         }
+        for (auto it = m_geomGroups.cbegin(); it != m_geomGroups.cend(); ++it)
+            children->emplace_back(nullptr, *it);
+    }
 
-        vlrprintf("GeometryGroups:\n");
-        for (auto geometryGroup : geometryGroupList) {
-            vlrprintf("  0x%p:\n", geometryGroup);
-            uint32_t numChildren;
-            rtGeometryGroupGetChildCount(geometryGroup, &numChildren);
-            RTacceleration acceleration;
-            rtGeometryGroupGetAcceleration(geometryGroup, &acceleration);
-            int32_t isDirty = 0;
-            rtAccelerationIsDirty(acceleration, &isDirty);
-            vlrprintf("  Status: %s\n", isDirty ? "dirty" : "");
-            for (int i = 0; i < numChildren; ++i) {
-                RTgeometryinstance childObject = nullptr;
-                rtGeometryGroupGetChild(geometryGroup, i, &childObject);
-
-                vlrprintf("  - %u: 0x%p\n", i, childObject);
+    void SHGroup::printOptiXHierarchy() {
+        vlrprintf("Group 0x%p: %u transforms (%u valid), %u geometry groups\n",
+                  this, (uint32_t)m_transforms.size(), m_numValidTransforms, (uint32_t)m_geomGroups.size());
+
+        std::vector<std::pair<const SHTransform*, const SHGeometryGroup*>> children;
+        getGeometryChildren(&children);
+        for (const auto &child : children) {
+            const SHTransform* transform = child.first;
+            const SHGeometryGroup* geomGroup = child.second;
+            if (transform) {
+                vlrprintf("- Transform 0x%p: %s\n", transform, transform->getName().c_str());
+                float mat[16];
+                float invMat[16];
+                transform->getStaticTransform().getArrays(mat, invMat);
+                vlrprintf("    Matrix\n");
+                vlrprintf("      %g, %g, %g, %g\n", mat[0], mat[4], mat[8], mat[12]);
+                vlrprintf("      %g, %g, %g, %g\n", mat[1], mat[5], mat[9], mat[13]);
+                vlrprintf("      %g, %g, %g, %g\n", mat[2], mat[6], mat[10], mat[14]);
+                vlrprintf("      %g, %g, %g, %g\n", mat[3], mat[7], mat[11], mat[15]);
+                vlrprintf("    Inverse Matrix\n");
+                vlrprintf("      %g, %g, %g, %g\n", invMat[0], invMat[4], invMat[8], invMat[12]);
+                vlrprintf("      %g, %g, %g, %g\n", invMat[1], invMat[5], invMat[9], invMat[13]);
+                vlrprintf("      %g, %g, %g, %g\n", invMat[2], invMat[6], invMat[10], invMat[14]);
+                vlrprintf("      %g, %g, %g, %g\n", invMat[3], invMat[7], invMat[11], invMat[15]);
             }
-        }
 
-        vlrprintf("GeometryInstances:\n");
-        for (auto geometryInstance : geometryInstanceList) {
-            vlrprintf("  0x%p:\n", geometryInstance);
+            uint32_t numInstances = geomGroup->getNumInstances();
+            vlrprintf("  GeometryGroup 0x%p: %u instances\n", geomGroup, numInstances);
+            for (int i = 0; i < numInstances; ++i)
+                vlrprintf("  - %u: GeometryInstance 0x%p\n", i, geomGroup->getGeometryInstanceAt(i));
         }
     }
 
@@ -324,7 +169,8 @@ namespace VLR {
     }
 
     bool SHTransform::isStatic() const {
-        // TODO: implement
+        // JP: 静的でない変換はAPIでノードに設定する時点で拒否されるため、連結した変換は常に静的である。
+        // EN: Chained transforms are always static since non-static transforms are rejected when set to a node via the API.
         return true;
     }
 
@@ -377,6 +223,11 @@ namespace VLR {
         m_optixAcceleration->markDirty();
     }
 
+    void SHGeometryGroup::updateGeometryInstance(const SHGeometryInstance* instance) {
+        VLRAssert(m_instances.count(instance), "instance 0x%p is not a child.", instance);
+        m_optixAcceleration->markDirty();
+    }
+
     // END: Shallow Hierarchy
     // ----------------------------------------------------------------
 
@@ -410,24 +261,22 @@ namespace VLR {
 
     // static
     void TriangleMeshSurfaceNode::initialize(Context &context) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"triangle_intersection.ptx");
+        std::string ptx = context.readPTX("triangle_intersection.ptx");
 
         OptiXProgramSet programSet;
 
-        optix::Context optixContext = context.getOptiXContext();
-
         if (context.RTXEnabled()) {
-            programSet.programCalcAttributeForTriangle = optixContext->createProgramFromPTXString(ptx, "VLR::calcAttributeForTriangle");
+            programSet.programCalcAttributeForTriangle = context.createProgramFromPTXString(ptx, "VLR::calcAttributeForTriangle");
         }
         else {
-            programSet.programIntersectTriangle = optixContext->createProgramFromPTXString(ptx, "VLR::intersectTriangle");
-            programSet.programCalcBBoxForTriangle = optixContext->createProgramFromPTXString(ptx, "VLR::calcBBoxForTriangle");
+            programSet.programIntersectTriangle = context.createProgramFromPTXString(ptx, "VLR::intersectTriangle");
+            programSet.programCalcBBoxForTriangle = context.createProgramFromPTXString(ptx, "VLR::calcBBoxForTriangle");
         }
 
-        programSet.callableProgramDecodeHitPointForTriangle = optixContext->createProgramFromPTXString(ptx, "VLR::decodeHitPointForTriangle");
-        programSet.callableProgramDecodeTexCoordForTriangle = optixContext->createProgramFromPTXString(ptx, "VLR::decodeTexCoordForTriangle");
+        programSet.callableProgramDecodeHitPointForTriangle = context.createProgramFromPTXString(ptx, "VLR::decodeHitPointForTriangle");
+        programSet.callableProgramDecodeTexCoordForTriangle = context.createProgramFromPTXString(ptx, "VLR::decodeTexCoordForTriangle");
 
-        programSet.callableProgramSampleTriangleMesh = optixContext->createProgramFromPTXString(ptx, "VLR::sampleTriangleMesh");
+        programSet.callableProgramSampleTriangleMesh = context.createProgramFromPTXString(ptx, "VLR::sampleTriangleMesh");
 
         OptiXProgramSets[context.getID()] = programSet;
     }
@@ -492,28 +341,80 @@ namespace VLR {
         parent->childUpdateEvent(ParentNode::UpdateEvent::GeometryRemoved, delta);
     }
 
+    // JP: 三角形ごとの面積を求め、その合計を返す。
+    // EN: Calculate the area of each triangle, and return their sum.
+    static float calcTriangleAreas(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, std::vector<float>* areas) {
+        uint32_t numTriangles = (uint32_t)indices.size() / 3;
+        areas->resize(numTriangles);
+        CompensatedSum<float> sum(0.0f);
+        for (uint32_t i = 0; i < numTriangles; ++i) {
+            const Vertex (&v)[3] = { vertices[indices[3 * i + 0]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]] };
+            (*areas)[i] = std::fmax(0.0f, 0.5f * cross(v[1].position - v[0].position, v[2].position - v[0].position).length());
+            sum += (*areas)[i];
+        }
+        return sum.result;
+    }
+
     void TriangleMeshSurfaceNode::setVertices(std::vector<Vertex> &&vertices) {
+        // JP: マテリアルグループ追加後に頂点数を保ったまま更新する場合は、既存のバッファーを書き換えて
+        //     トポロジーが変わらないことを親に通知する。加速構造は再フィットで済む。
+        // EN: When updating with the same number of vertices after adding material groups, overwrite the existing buffer
+        //     and notify parents that the topology is unchanged. Acceleration structures can be refitted.
+        bool updateInPlace = !m_optixGeometries.empty() && vertices.size() == m_vertices.size();
+
         m_vertices = vertices;
 
-        optix::Context optixContext = m_context.getOptiXContext();
-        m_optixVertexBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, m_vertices.size());
-        m_optixVertexBuffer->setElementSize(sizeof(Vertex));
+        Backend::Context optixContext = m_context.getOptiXContext();
+        if (!updateInPlace) {
+            m_optixVertexBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, m_vertices.size());
+            m_optixVertexBuffer->setElementSize(sizeof(Vertex));
+        }
         {
             auto dstVertices = (Vertex*)m_optixVertexBuffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
             std::copy_n((Vertex*)m_vertices.data(), m_vertices.size(), dstVertices);
             m_optixVertexBuffer->unmap();
         }
 
-        // TODO: 頂点情報更新時の処理。(IndexBufferとの整合性など)
+        if (updateInPlace) {
+            // JP: 発光するマテリアルグループは三角形の面積が変わるので、面積に基づく分布と面積の合計を作り直す。
+            //     分布のバッファーが変わるので、ジオメトリインスタンスが持つ面光源の記述子も更新する。
+            // EN: Triangle areas of emitting material groups change, so rebuild the area-based distribution and the sum of the areas.
+            //     Buffers of the distribution change, so also update the surface light descriptor held by the geometry instance.
+            for (uint32_t i = 0; i < m_optixGeometries.size(); ++i) {
+                if (!m_materials[i]->isEmitting())
+                    continue;
+
+                OptiXGeometry &geom = m_optixGeometries[i];
+                std::vector<float> areas;
+                float sumImportances = calcTriangleAreas(m_vertices, geom.indices, &areas);
+                geom.primDist.finalize(m_context);
+                geom.primDist.initialize(m_context, areas.data(), areas.size());
+
+                SHGeometryInstance* geomInst = m_shGeometryInstances[i];
+                Shared::SurfaceLightDescriptor lightDesc;
+                geomInst->getSurfaceLightDescriptor(&lightDesc);
+                geom.primDist.getInternalType(&lightDesc.body.asMeshLight.primDistribution);
+                geomInst->setSurfaceLightDescriptor(lightDesc);
+                geomInst->getOptiXObject()["VLR::pv_sumImportances"]->setFloat(sumImportances);
+            }
+
+            std::set<SHGeometryInstance*> delta;
+            for (auto it = m_shGeometryInstances.cbegin(); it != m_shGeometryInstances.cend(); ++it)
+                delta.insert(*it);
+            for (auto it = m_parents.cbegin(); it != m_parents.cend(); ++it) {
+                ParentNode* parent = *it;
+                parent->childUpdateEvent(ParentNode::UpdateEvent::GeometryUpdated, delta);
+            }
+        }
     }
 
     void TriangleMeshSurfaceNode::addMaterialGroup(std::vector<uint32_t> &&indices, const SurfaceMaterial* material, 
                                                    const ShaderNodeSocketIdentifier &nodeNormal, const ShaderNodeSocketIdentifier &nodeAlpha, VLRTangentType tangentType) {
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
         const OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
         OptiXGeometry geom;
-        CompensatedSum<float> sumImportances(0.0f);
+        float sumImportances;
         {
             geom.indices = std::move(indices);
             uint32_t numTriangles = (uint32_t)geom.indices.size() / 3;
@@ -531,8 +432,6 @@ namespace VLR {
             geom.optixIndexBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_USER, numTriangles);
             geom.optixIndexBuffer->setElementSize(sizeof(Shared::Triangle));
 
-            std::vector<float> areas;
-            areas.resize(numTriangles);
             {
                 auto dstTriangles = (Shared::Triangle*)geom.optixIndexBuffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
                 for (auto i = 0; i < numTriangles; ++i) {
@@ -541,14 +440,13 @@ namespace VLR {
                     uint32_t i2 = geom.indices[3 * i + 2];
 
                     dstTriangles[i] = Shared::Triangle{ i0, i1, i2 };
-
-                    const Vertex (&v)[3] = { m_vertices[i0], m_vertices[i1], m_vertices[i2] };
-                    areas[i] = std::fmax(0.0f, 0.5f * cross(v[1].position - v[0].position, v[2].position - v[0].position).length());
-                    sumImportances += areas[i];
                 }
                 geom.optixIndexBuffer->unmap();
             }
 
+            std::vector<float> areas;
+            sumImportances = calcTriangleAreas(m_vertices, geom.indices, &areas);
+
             if (m_context.RTXEnabled()) {
                 geom.optixGeometryTriangles->setPrimitiveCount(numTriangles);
                 // TODO: share the same index buffer with different offsets.
@@ -594,9 +492,9 @@ namespace VLR {
         lightDesc.sampleFunc = progSet.callableProgramSampleTriangleMesh->getId();
         lightDesc.importance = material->isEmitting() ? 1.0f : 0.0f; // TODO:
 
-        SHGeometryInstance* geomInst = new SHGeometryInstance(m_context, lightDesc);
+        SHGeometryInstance* geomInst = new SHGeometryInstance(m_context, lightDesc, this, (uint32_t)m_optixGeometries.size() - 1);
         {
-            optix::GeometryInstance optixGeomInst = geomInst->getOptiXObject();
+            Backend::GeometryInstance optixGeomInst = geomInst->getOptiXObject();
             if (m_context.RTXEnabled())
                 optixGeomInst->setGeometryTriangles(geom.optixGeometryTriangles);
             else
@@ -605,7 +503,7 @@ namespace VLR {
 
             optixGeomInst["VLR::pv_vertexBuffer"]->set(m_optixVertexBuffer);
             optixGeomInst["VLR::pv_triangleBuffer"]->set(geom.optixIndexBuffer);
-            optixGeomInst["VLR::pv_sumImportances"]->setFloat(sumImportances.result);
+            optixGeomInst["VLR::pv_sumImportances"]->setFloat(sumImportances);
 
             optixGeomInst["VLR::pv_progDecodeTexCoord"]->set(progSet.callableProgramDecodeTexCoordForTriangle);
             optixGeomInst["VLR::pv_progDecodeHitPoint"]->set(progSet.callableProgramDecodeHitPointForTriangle);
@@ -649,19 +547,17 @@ namespace VLR {
 
     // static
     void InfiniteSphereSurfaceNode::initialize(Context &context) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"infinite_sphere_intersection.ptx");
+        std::string ptx = context.readPTX("infinite_sphere_intersection.ptx");
 
         OptiXProgramSet programSet;
 
-        optix::Context optixContext = context.getOptiXContext();
-
-        programSet.programIntersectInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::intersectInfiniteSphere");
-        programSet.programCalcBBoxForInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::calcBBoxForInfiniteSphere");
+        programSet.programIntersectInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::intersectInfiniteSphere");
+        programSet.programCalcBBoxForInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::calcBBoxForInfiniteSphere");
 
-        programSet.callableProgramDecodeHitPointForInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::decodeHitPointForInfiniteSphere");
-        programSet.callableProgramDecodeTexCoordForInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::decodeTexCoordForInfiniteSphere");
+        programSet.callableProgramDecodeHitPointForInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::decodeHitPointForInfiniteSphere");
+        programSet.callableProgramDecodeTexCoordForInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::decodeTexCoordForInfiniteSphere");
 
-        programSet.callableProgramSampleInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::sampleInfiniteSphere");
+        programSet.callableProgramSampleInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::sampleInfiniteSphere");
 
         OptiXProgramSets[context.getID()] = programSet;
     }
@@ -683,7 +579,7 @@ namespace VLR {
 
     InfiniteSphereSurfaceNode::InfiniteSphereSurfaceNode(Context &context, const std::string &name, SurfaceMaterial* material) : 
         SurfaceNode(context, name), m_material(material) {
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
         const OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
         m_optixGeometry = optixContext->createGeometry();
@@ -699,7 +595,7 @@ namespace VLR {
 
         m_shGeometryInstance = new SHGeometryInstance(m_context, lightDesc);
         {
-            optix::GeometryInstance optixGeomInst = m_shGeometryInstance->getOptiXObject();
+            Backend::GeometryInstance optixGeomInst = m_shGeometryInstance->getOptiXObject();
             optixGeomInst->setGeometry(m_optixGeometry);
             optixGeomInst->setMaterialCount(1);
             optixGeomInst->setMaterial(0, m_context.getOptiXMaterialDefault());
@@ -882,7 +778,8 @@ namespace VLR {
             break;
         }
         case UpdateEvent::GeometryAdded:
-        case UpdateEvent::GeometryRemoved: {
+        case UpdateEvent::GeometryRemoved:
+        case UpdateEvent::GeometryUpdated: {
             std::set<SHTransform*> delta;
             for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
                 SHTransform* shtr = m_shTransforms.at(*it);
@@ -957,6 +854,24 @@ namespace VLR {
 
             break;
         }
+        case UpdateEvent::GeometryUpdated: {
+            // JP: GeometryGroupの子の構成は変わらないが、AABBが変わりうる。
+            SHTransform* selfTransform = m_shTransforms.at(nullptr);
+            std::vector<TransformAndGeometryInstance> geomInstDelta;
+            for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
+                m_shGeomGroup.updateGeometryInstance(*it);
+                geomInstDelta.push_back(TransformAndGeometryInstance{ selfTransform, *it });
+            }
+
+            std::set<SHTransform*> delta;
+            delta.insert(selfTransform);
+            for (auto it = m_parents.cbegin(); it != m_parents.cend(); ++it) {
+                ParentNode* parent = *it;
+                parent->childUpdateEvent(eventType, delta, geomInstDelta);
+            }
+
+            break;
+        }
         default:
             VLRAssert_ShouldNotBeCalled();
             break;
@@ -1031,6 +946,19 @@ namespace VLR {
 
 
 
+    void RootNode::updateSurfaceLight(const SHGeometryInstance* geomInst) {
+        auto it = m_surfaceLights.find(geomInst);
+        if (it == m_surfaceLights.end())
+            return;
+
+        // JP: 変換は親から与えられたものを保ち、面積に基づく分布だけを取り直す。
+        // EN: Keep the transform given from parents, and only fetch the area-based distribution again.
+        Shared::SurfaceLightDescriptor lightDesc;
+        geomInst->getSurfaceLightDescriptor(&lightDesc);
+        it->second.body.asMeshLight.primDistribution = lightDesc.body.asMeshLight.primDistribution;
+        m_surfaceLightsAreSetup = false;
+    }
+
     void RootNode::childUpdateEvent(UpdateEvent eventType, const std::set<SHTransform*>& childDelta, const std::vector<TransformAndGeometryInstance> &childGeomInstDelta) {
         switch (eventType) {
         case UpdateEvent::TransformAdded: {
@@ -1076,6 +1004,8 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
 
             // JP: SHGroupにもSHTransformを追加する。
             for (auto it = delta.cbegin(); it != delta.cend(); ++it) {
@@ -1096,6 +1026,8 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
 
             // JP: 子InternalNodeが持つSHTransformがつながっているSHTransformを削除。
             std::set<SHTransform*> delta;
@@ -1148,6 +1080,7 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostTLASNeedsRefit = true;
 
             break;
         }
@@ -1185,6 +1118,8 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
 
             break;
         }
@@ -1205,6 +1140,22 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
+
+            break;
+        }
+        case UpdateEvent::GeometryUpdated: {
+            for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
+                SHTransform* shtr = m_shTransforms.at(*it);
+                m_shGroup.updateChild(shtr);
+            }
+
+            for (auto it = childGeomInstDelta.cbegin(); it != childGeomInstDelta.cend(); ++it) {
+                m_hostDeformedGeometryInstances.insert(it->geomInstance);
+                updateSurfaceLight(it->geomInstance);
+            }
+            m_hostTLASNeedsRefit = true;
 
             break;
         }
@@ -1248,6 +1199,8 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
 
             break;
         }
@@ -1272,6 +1225,20 @@ namespace VLR {
                 }
             }
             m_surfaceLightsAreSetup = false;
+            m_hostBLASesAreDirty = true;
+            m_hostTLASIsDirty = true;
+
+            break;
+        }
+        case UpdateEvent::GeometryUpdated: {
+            SHTransform* selfTransform = m_shTransforms.at(nullptr);
+            for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
+                m_shGeomGroup.updateGeometryInstance(*it);
+                m_hostDeformedGeometryInstances.insert(*it);
+                updateSurfaceLight(*it);
+            }
+            m_shGroup.updateChild(selfTransform);
+            m_hostTLASNeedsRefit = true;
 
             break;
         }
@@ -1282,7 +1249,8 @@ namespace VLR {
     }
 
     RootNode::RootNode(Context &context, const Transform* localToWorld) :
-        ParentNode(context, "Root", localToWorld), m_shGroup(context), m_surfaceLightsAreSetup(false) {
+        ParentNode(context, "Root", localToWorld), m_shGroup(context), m_surfaceLightsAreSetup(false),
+        m_hostBLASesAreDirty(true), m_hostTLASIsDirty(true), m_hostTLASNeedsRefit(false) {
         SHTransform* shtr = m_shTransforms[0];
         m_shGroup.addChild(shtr);
     }
@@ -1297,8 +1265,14 @@ namespace VLR {
         }
     }
 
+    void RootNode::setTransform(const Transform* localToWorld) {
+        ParentNode::setTransform(localToWorld);
+
+        m_hostTLASNeedsRefit = true;
+    }
+
     void RootNode::set() {
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
 
         optixContext["VLR::pv_topGroup"]->set(m_shGroup.getOptiXObject());
 
@@ -1335,15 +1309,143 @@ namespace VLR {
         optixContext["VLR::pv_surfaceLightDescriptorBuffer"]->set(m_optixSurfaceLightDescriptorBuffer);
     }
 
+    // JP: BLASはオブジェクト空間で構築し、instIndexはSHGeometryGroup内でのインデックスとする。
+    // EN: Build a BLAS in object space, and instIndex is the index in the SHGeometryGroup.
+    static void collectHostTriangles(const std::vector<const SHGeometryInstance*> &geomInstances, std::vector<CPU::Triangle>* triangles) {
+        for (uint32_t instIdx = 0; instIdx < geomInstances.size(); ++instIdx) {
+            const SHGeometryInstance* geomInst = geomInstances[instIdx];
+            const TriangleMeshSurfaceNode* triangleMesh = geomInst->getTriangleMesh();
+
+            const std::vector<Vertex> &vertices = triangleMesh->getVertices();
+            const std::vector<uint32_t> &indices = triangleMesh->getIndices(geomInst->getMaterialGroupIndex());
+            uint32_t numTriangles = (uint32_t)indices.size() / 3;
+            for (uint32_t primIdx = 0; primIdx < numTriangles; ++primIdx) {
+                CPU::Triangle tri;
+                tri.p0 = vertices[indices[3 * primIdx + 0]].position;
+                tri.p1 = vertices[indices[3 * primIdx + 1]].position;
+                tri.p2 = vertices[indices[3 * primIdx + 2]].position;
+                tri.instIndex = instIdx;
+                tri.primIndex = primIdx;
+                triangles->push_back(tri);
+            }
+        }
+    }
+
+    void RootNode::setupHostAccelerator() {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::pair<const SHTransform*, const SHGeometryGroup*>> children;
+        m_shGroup.getGeometryChildren(&children);
+
+        // JP: 子のインスタンス構成が変わったSHGeometryGroupのBLASのみを再構築し、参照されなくなったものは破棄する。
+        //     構成が変わらず頂点のみが変化したBLASは再フィットする。
+        // EN: Rebuild only BLASes of SHGeometryGroups whose child instances have changed, and discard ones no longer referenced.
+        //     Refit BLASes whose vertices only have changed while keeping the composition.
+        if (m_hostBLASesAreDirty || !m_hostDeformedGeometryInstances.empty()) {
+            std::set<const SHGeometryGroup*> geomGroups;
+            for (auto it = children.cbegin(); it != children.cend(); ++it)
+                geomGroups.insert(it->second);
+
+            for (auto it = m_hostBLASes.begin(); it != m_hostBLASes.end();) {
+                if (geomGroups.count(it->first))
+                    ++it;
+                else
+                    it = m_hostBLASes.erase(it);
+            }
+
+            for (auto it = geomGroups.cbegin(); it != geomGroups.cend(); ++it) {
+                const SHGeometryGroup* geomGroup = *it;
+
+                std::vector<const SHGeometryInstance*> geomInstances;
+                bool deformed = false;
+                for (uint32_t i = 0; i < geomGroup->getNumInstances(); ++i) {
+                    const SHGeometryInstance* geomInst = geomGroup->getGeometryInstanceAt(i);
+                    if (geomInst->getTriangleMesh()) {
+                        geomInstances.push_back(geomInst);
+                        deformed |= m_hostDeformedGeometryInstances.count(geomInst) > 0;
+                    }
+                }
+
+                auto itBLAS = m_hostBLASes.find(geomGroup);
+                if (itBLAS != m_hostBLASes.end() && itBLAS->second.geomInstances == geomInstances) {
+                    if (deformed) {
+                        std::vector<CPU::Triangle> triangles;
+                        collectHostTriangles(geomInstances, &triangles);
+                        itBLAS->second.accelerator.update(std::move(triangles));
+                    }
+                    continue;
+                }
+
+                HostBLAS &blas = m_hostBLASes[geomGroup];
+                blas.geomInstances = geomInstances;
+
+                std::vector<CPU::Triangle> triangles;
+                collectHostTriangles(geomInstances, &triangles);
+                blas.accelerator.build(std::move(triangles));
+            }
+
+            m_hostBLASesAreDirty = false;
+            m_hostDeformedGeometryInstances.clear();
+        }
+
+        m_hostGeometryInstances.clear();
+        std::vector<CPU::InstanceAccelerator::Instance> instances;
+        for (auto it = children.cbegin(); it != children.cend(); ++it) {
+            const HostBLAS &blas = m_hostBLASes.at(it->second);
+
+            CPU::InstanceAccelerator::Instance inst;
+            inst.blas = &blas.accelerator;
+            if (it->first) {
+                if (it->first->isStatic()) {
+                    StaticTransform tr = it->first->getStaticTransform();
+                    float mat[16], invMat[16];
+                    tr.getArrays(mat, invMat);
+                    inst.objectToWorld = Shared::StaticTransform(Matrix4x4(mat));
+                    inst.worldToObject = Shared::StaticTransform(Matrix4x4(invMat));
+                }
+                else {
+                    VLRAssert_ShouldNotBeCalled();
+                }
+            }
+            inst.instIndexOffset = (uint32_t)m_hostGeometryInstances.size();
+            for (auto itInst = blas.geomInstances.cbegin(); itInst != blas.geomInstances.cend(); ++itInst)
+                m_hostGeometryInstances.push_back(HostGeometryInstance{ *itInst, inst.objectToWorld, inst.worldToObject });
+            instances.push_back(inst);
+        }
+
+        if (m_hostTLASIsDirty)
+            m_hostTLAS.build(std::move(instances));
+        else
+            m_hostTLAS.update(std::move(instances));
+        m_hostTLASIsDirty = false;
+        m_hostTLASNeedsRefit = false;
+
+        m_hostBVHStatistics = m_hostTLAS.getStatistics();
+        auto endTime = std::chrono::high_resolution_clock::now();
+        m_hostBVHStatistics.buildTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count() * 1e-3f;
+    }
+
+    bool RootNode::updateHostAccelerator() {
+        if (!m_hostBLASesAreDirty && m_hostDeformedGeometryInstances.empty() &&
+            !m_hostTLASIsDirty && !m_hostTLASNeedsRefit)
+            return false;
+        setupHostAccelerator();
+        return true;
+    }
+
+    void RootNode::intersect(const CPU::Ray* rays, uint32_t numRays, CPU::RayHit* hits) {
+        updateHostAccelerator();
+
+        m_hostTLAS.intersect(rays, numRays, hits);
+    }
+
 
 
     Scene::Scene(Context &context, const Transform* localToWorld) : 
     Object(context), m_rootNode(context, localToWorld), m_matEnv(nullptr) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"infinite_sphere_intersection.ptx");
-
-        optix::Context optixContext = context.getOptiXContext();
+        std::string ptx = context.readPTX("infinite_sphere_intersection.ptx");
 
-        m_callableProgramSampleInfiniteSphere = optixContext->createProgramFromPTXString(ptx, "VLR::sampleInfiniteSphere");
+        m_callableProgramSampleInfiniteSphere = context.createProgramFromPTXString(ptx, "VLR::sampleInfiniteSphere");
     }
 
     Scene::~Scene() {
@@ -1357,7 +1459,7 @@ namespace VLR {
     void Scene::set() {
         m_rootNode.set();
 
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
 
         Shared::SurfaceLightDescriptor envLight;
         envLight.importance = 0.0f;
@@ -1391,14 +1493,12 @@ namespace VLR {
 
     // static
     void PerspectiveCamera::initialize(Context &context) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"cameras.ptx");
+        std::string ptx = context.readPTX("cameras.ptx");
 
         OptiXProgramSet programSet;
 
-        optix::Context optixContext = context.getOptiXContext();
-
-        programSet.callableProgramSampleLensPosition = optixContext->createProgramFromPTXString(ptx, "VLR::PerspectiveCamera_sampleLensPosition");
-        programSet.callableProgramSampleIDF = optixContext->createProgramFromPTXString(ptx, "VLR::PerspectiveCamera_sampleIDF");
+        programSet.callableProgramSampleLensPosition = context.createProgramFromPTXString(ptx, "VLR::PerspectiveCamera_sampleLensPosition");
+        programSet.callableProgramSampleIDF = context.createProgramFromPTXString(ptx, "VLR::PerspectiveCamera_sampleIDF");
 
         OptiXProgramSets[context.getID()] = programSet;
     }
@@ -1426,7 +1526,7 @@ namespace VLR {
     }
 
     void PerspectiveCamera::set() const {
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
         OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
         optixContext["VLR::pv_perspectiveCamera"]->setUserData(sizeof(Shared::PerspectiveCamera), &m_data);
@@ -1440,14 +1540,12 @@ namespace VLR {
 
     // static
     void EquirectangularCamera::initialize(Context &context) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"cameras.ptx");
+        std::string ptx = context.readPTX("cameras.ptx");
 
         OptiXProgramSet programSet;
 
-        optix::Context optixContext = context.getOptiXContext();
-
-        programSet.callableProgramSampleLensPosition = optixContext->createProgramFromPTXString(ptx, "VLR::EquirectangularCamera_sampleLensPosition");
-        programSet.callableProgramSampleIDF = optixContext->createProgramFromPTXString(ptx, "VLR::EquirectangularCamera_sampleIDF");
+        programSet.callableProgramSampleLensPosition = context.createProgramFromPTXString(ptx, "VLR::EquirectangularCamera_sampleLensPosition");
+        programSet.callableProgramSampleIDF = context.createProgramFromPTXString(ptx, "VLR::EquirectangularCamera_sampleIDF");
 
         OptiXProgramSets[context.getID()] = programSet;
     }
@@ -1472,7 +1570,7 @@ namespace VLR {
     }
 
     void EquirectangularCamera::set() const {
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
         OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
         optixContext["VLR::pv_equirectangularCamera"]->setUserData(sizeof(Shared::EquirectangularCamera), &m_data);
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "materials.h"
+#include "cpu_traversal.h"
 
 namespace VLR {
     class Transform : public TypeAwareClass {
@@ -47,10 +48,11 @@ namespace VLR {
     class SHTransform;
     class SHGeometryGroup;
     class SHGeometryInstance;
+    class TriangleMeshSurfaceNode;
 
     class SHGroup {
-        optix::Group m_optixGroup;
-        optix::Acceleration m_optixAcceleration;
+        Backend::Group m_optixGroup;
+        Backend::Acceleration m_optixAcceleration;
         struct TransformStatus {
             bool hasGeometryDescendant;
         };
@@ -60,7 +62,7 @@ namespace VLR {
 
     public:
         SHGroup(Context &context) : m_numValidTransforms(0) {
-            optix::Context optixContext = context.getOptiXContext();
+            Backend::Context optixContext = context.getOptiXContext();
             m_optixGroup = optixContext->createGroup();
             m_optixAcceleration = optixContext->createAcceleration("Trbvh");
             m_optixGroup->setAcceleration(m_optixAcceleration);
@@ -77,7 +79,13 @@ namespace VLR {
         void addChild(SHGeometryGroup* geomGroup);
         void removeChild(SHGeometryGroup* geomGroup);
 
-        const optix::Group &getOptiXObject() const {
+        // JP: ジオメトリを持つ子をTransformとGeometryGroupの組として列挙する。
+        //     直接の子であるGeometryGroupのTransformはnullptrとなる。
+        // EN: Enumerate children having geometry as pairs of Transform and GeometryGroup.
+        //     Transform is nullptr for a GeometryGroup which is a direct child.
+        void getGeometryChildren(std::vector<std::pair<const SHTransform*, const SHGeometryGroup*>>* children) const;
+
+        const Backend::Group &getOptiXObject() const {
             return m_optixGroup;
         }
 
@@ -86,7 +94,7 @@ namespace VLR {
 
     class SHTransform {
         std::string m_name;
-        optix::Transform m_optixTransform;
+        Backend::Transform m_optixTransform;
 
         StaticTransform m_transform;
         union {
@@ -100,7 +108,7 @@ namespace VLR {
     public:
         SHTransform(const std::string &name, Context &context, const StaticTransform &transform, const SHTransform* childTransform) :
             m_name(name), m_transform(transform), m_childTransform(childTransform), m_childIsTransform(childTransform != nullptr) {
-            optix::Context optixContext = context.getOptiXContext();
+            Backend::Context optixContext = context.getOptiXContext();
             m_optixTransform = optixContext->createTransform();
 
             resolveTransform();
@@ -122,19 +130,19 @@ namespace VLR {
         void setChild(SHGeometryGroup* geomGroup);
         bool hasGeometryDescendant(SHGeometryGroup** descendant = nullptr) const;
 
-        const optix::Transform &getOptiXObject() const {
+        const Backend::Transform &getOptiXObject() const {
             return m_optixTransform;
         }
     };
 
     class SHGeometryGroup {
-        optix::GeometryGroup m_optixGeometryGroup;
-        optix::Acceleration m_optixAcceleration;
+        Backend::GeometryGroup m_optixGeometryGroup;
+        Backend::Acceleration m_optixAcceleration;
         std::set<const SHGeometryInstance*> m_instances;
 
     public:
         SHGeometryGroup(Context &context) {
-            optix::Context optixContext = context.getOptiXContext();
+            Backend::Context optixContext = context.getOptiXContext();
             m_optixGeometryGroup = optixContext->createGeometryGroup();
             m_optixAcceleration = optixContext->createAcceleration("Trbvh");
             m_optixGeometryGroup->setAcceleration(m_optixAcceleration);
@@ -146,6 +154,7 @@ namespace VLR {
 
         void addGeometryInstance(const SHGeometryInstance* instance);
         void removeGeometryInstance(const SHGeometryInstance* instance);
+        void updateGeometryInstance(const SHGeometryInstance* instance);
         const SHGeometryInstance* getGeometryInstanceAt(uint32_t index) const {
             auto it = m_instances.cbegin();
             std::advance(it, index);
@@ -155,18 +164,22 @@ namespace VLR {
             return (uint32_t)m_instances.size();
         }
 
-        const optix::GeometryGroup &getOptiXObject() const {
+        const Backend::GeometryGroup &getOptiXObject() const {
             return m_optixGeometryGroup;
         }
     };
 
     class SHGeometryInstance {
-        optix::GeometryInstance m_optixGeometryInstance;
+        Backend::GeometryInstance m_optixGeometryInstance;
         Shared::SurfaceLightDescriptor m_surfaceLightDescriptor;
+        const TriangleMeshSurfaceNode* m_triangleMesh;
+        uint32_t m_materialGroupIndex;
 
     public:
-        SHGeometryInstance(Context &context, const Shared::SurfaceLightDescriptor &lightDesc) : m_surfaceLightDescriptor(lightDesc) {
-            optix::Context optixContext = context.getOptiXContext();
+        SHGeometryInstance(Context &context, const Shared::SurfaceLightDescriptor &lightDesc,
+                           const TriangleMeshSurfaceNode* triangleMesh = nullptr, uint32_t materialGroupIndex = 0) :
+            m_surfaceLightDescriptor(lightDesc), m_triangleMesh(triangleMesh), m_materialGroupIndex(materialGroupIndex) {
+            Backend::Context optixContext = context.getOptiXContext();
             m_optixGeometryInstance = optixContext->createGeometryInstance();
         }
         ~SHGeometryInstance() {
@@ -176,8 +189,22 @@ namespace VLR {
         void getSurfaceLightDescriptor(Shared::SurfaceLightDescriptor* lightDesc) const {
             *lightDesc = m_surfaceLightDescriptor;
         }
+        // JP: 頂点の更新で面光源の分布が作り直された際に呼ばれる。
+        // EN: Called when the distribution of a surface light is rebuilt by a vertex update.
+        void setSurfaceLightDescriptor(const Shared::SurfaceLightDescriptor &lightDesc) {
+            m_surfaceLightDescriptor = lightDesc;
+        }
 
-        const optix::GeometryInstance &getOptiXObject() const {
+        // JP: 三角形メッシュ以外のジオメトリではnullptrを返す。
+        // EN: Returns nullptr for geometry other than triangle meshes.
+        const TriangleMeshSurfaceNode* getTriangleMesh() const {
+            return m_triangleMesh;
+        }
+        uint32_t getMaterialGroupIndex() const {
+            return m_materialGroupIndex;
+        }
+
+        const Backend::GeometryInstance &getOptiXObject() const {
             return m_optixGeometryInstance;
         }
     };
@@ -240,26 +267,26 @@ namespace VLR {
 
     class TriangleMeshSurfaceNode : public SurfaceNode {
         struct OptiXProgramSet {
-            optix::Program programCalcAttributeForTriangle; // Attribute Program
-            optix::Program programIntersectTriangle; // Intersection Program
-            optix::Program programCalcBBoxForTriangle; // Bounding Box Program
-            optix::Program callableProgramDecodeHitPointForTriangle;
-            optix::Program callableProgramDecodeTexCoordForTriangle;
-            optix::Program callableProgramSampleTriangleMesh;
+            Backend::Program programCalcAttributeForTriangle; // Attribute Program
+            Backend::Program programIntersectTriangle; // Intersection Program
+            Backend::Program programCalcBBoxForTriangle; // Bounding Box Program
+            Backend::Program callableProgramDecodeHitPointForTriangle;
+            Backend::Program callableProgramDecodeTexCoordForTriangle;
+            Backend::Program callableProgramSampleTriangleMesh;
         };
 
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
 
         struct OptiXGeometry {
             std::vector<uint32_t> indices;
-            optix::Buffer optixIndexBuffer;
-            optix::GeometryTriangles optixGeometryTriangles;
-            optix::Geometry optixGeometry;
+            Backend::Buffer optixIndexBuffer;
+            Backend::GeometryTriangles optixGeometryTriangles;
+            Backend::Geometry optixGeometry;
             DiscreteDistribution1D primDist;
         };
 
         std::vector<Vertex> m_vertices;
-        optix::Buffer m_optixVertexBuffer;
+        Backend::Buffer m_optixVertexBuffer;
         std::vector<OptiXGeometry> m_optixGeometries;
         std::vector<const SurfaceMaterial*> m_materials;
         std::vector<ShaderNodeSocketIdentifier> m_nodeNormals;
@@ -286,22 +313,29 @@ namespace VLR {
         void setVertices(std::vector<Vertex> &&vertices);
         void addMaterialGroup(std::vector<uint32_t> &&indices, const SurfaceMaterial* material, 
                               const ShaderNodeSocketIdentifier &nodeNormal, const ShaderNodeSocketIdentifier &alpha, VLRTangentType tangentType);
+
+        const std::vector<Vertex> &getVertices() const {
+            return m_vertices;
+        }
+        const std::vector<uint32_t> &getIndices(uint32_t materialGroupIndex) const {
+            return m_optixGeometries[materialGroupIndex].indices;
+        }
     };
 
 
 
     class InfiniteSphereSurfaceNode : public SurfaceNode {
         struct OptiXProgramSet {
-            optix::Program programIntersectInfiniteSphere; // Intersection Program
-            optix::Program programCalcBBoxForInfiniteSphere; // Bounding Box Program
-            optix::Program callableProgramDecodeHitPointForInfiniteSphere;
-            optix::Program callableProgramDecodeTexCoordForInfiniteSphere;
-            optix::Program callableProgramSampleInfiniteSphere;
+            Backend::Program programIntersectInfiniteSphere; // Intersection Program
+            Backend::Program programCalcBBoxForInfiniteSphere; // Bounding Box Program
+            Backend::Program callableProgramDecodeHitPointForInfiniteSphere;
+            Backend::Program callableProgramDecodeTexCoordForInfiniteSphere;
+            Backend::Program callableProgramSampleInfiniteSphere;
         };
 
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
 
-        optix::Geometry m_optixGeometry;
+        Backend::Geometry m_optixGeometry;
         SurfaceMaterial* m_material;
         SHGeometryInstance* m_shGeometryInstance;
 
@@ -357,6 +391,7 @@ namespace VLR {
             TransformUpdated,
             GeometryAdded,
             GeometryRemoved,
+            GeometryUpdated,
         };
 
         virtual void childUpdateEvent(UpdateEvent eventType, const std::set<SHTransform*> &childDelta, const std::vector<TransformAndGeometryInstance> &childGeomInstDelta) = 0;
@@ -397,10 +432,41 @@ namespace VLR {
     class RootNode : public ParentNode {
         SHGroup m_shGroup;
         std::map<const SHGeometryInstance*, Shared::SurfaceLightDescriptor> m_surfaceLights;
-        optix::Buffer m_optixSurfaceLightDescriptorBuffer;
+        Backend::Buffer m_optixSurfaceLightDescriptorBuffer;
         DiscreteDistribution1D m_surfaceLightImpDist;
         bool m_surfaceLightsAreSetup;
 
+        // JP: ホスト側でのレイクエリー用の2レベルの加速構造。SHGeometryGroupごとにBLASを持ち、TLASはSHTransformに対して構築する。
+        //     シーンの変更時に無効化され、次のクエリーで再構築される。変換の更新ではTLASのみを再構築する。
+        // EN: Two-level acceleration structure for ray queries on the host. Has a BLAS per SHGeometryGroup and builds the TLAS over SHTransforms.
+        //     Invalidated on scene changes and rebuilt at the next query. Only the TLAS is rebuilt on transform updates.
+        struct HostBLAS {
+            std::vector<const SHGeometryInstance*> geomInstances;
+            CPU::TriangleAccelerator accelerator;
+        };
+        std::map<const SHGeometryGroup*, HostBLAS> m_hostBLASes;
+        CPU::InstanceAccelerator m_hostTLAS;
+        // JP: TLASのinstIndexに対応するジオメトリインスタンスとその変換。
+        // EN: Geometry instances and their transforms corresponding to instIndex of the TLAS.
+        struct HostGeometryInstance {
+            const SHGeometryInstance* geomInstance;
+            Shared::StaticTransform objectToWorld;
+            Shared::StaticTransform worldToObject;
+        };
+        std::vector<HostGeometryInstance> m_hostGeometryInstances;
+        CPU::BVHStatistics m_hostBVHStatistics;
+        bool m_hostBLASesAreDirty;
+        bool m_hostTLASIsDirty;
+        // JP: 構成を保ったまま変換や頂点が変化した場合は再フィットで済ませる。
+        // EN: Refitting suffices when transforms or vertices change while keeping the composition.
+        std::set<const SHGeometryInstance*> m_hostDeformedGeometryInstances;
+        bool m_hostTLASNeedsRefit;
+
+        void setupHostAccelerator();
+        // JP: 変形したジオメトリインスタンスが面光源であれば、作り直された分布を記述子に反映する。
+        // EN: Reflect the rebuilt distribution to the descriptor if the deformed geometry instance is a surface light.
+        void updateSurfaceLight(const SHGeometryInstance* geomInst);
+
         void childUpdateEvent(UpdateEvent eventType, const std::set<SHTransform*>& childDelta, const std::vector<TransformAndGeometryInstance> &childGeomInstDelta) override;
         void childUpdateEvent(UpdateEvent eventType, const std::set<SHGeometryInstance*> &childDelta) override;
 
@@ -411,14 +477,41 @@ namespace VLR {
         RootNode(Context &context, const Transform* localToWorld);
         ~RootNode();
 
+        void setTransform(const Transform* localToWorld) override;
+
         void set();
+
+        // JP: シーンの変更イベントで無効化されていれば、ホスト側の加速構造を再構築または再フィットする。
+        //     再構築か再フィットかはMaxRefitSAHCostRatioに基づいて各加速構造が決める。更新した場合にtrueを返す。
+        // EN: Rebuild or refit the acceleration structure on the host if it has been invalidated by change events of the scene.
+        //     Each acceleration structure decides between rebuilding and refitting based on MaxRefitSAHCostRatio. Returns true if updated.
+        bool updateHostAccelerator();
+        void intersect(const CPU::Ray* rays, uint32_t numRays, CPU::RayHit* hits);
+        const CPU::InstanceAccelerator &getHostAccelerator() const {
+            return m_hostTLAS;
+        }
+        uint32_t getNumHostGeometryInstances() const {
+            return (uint32_t)m_hostGeometryInstances.size();
+        }
+        const SHGeometryInstance* getHostGeometryInstance(uint32_t instIndex) const {
+            return m_hostGeometryInstances[instIndex].geomInstance;
+        }
+        void getHostGeometryInstanceTransform(uint32_t instIndex, Shared::StaticTransform* objectToWorld, Shared::StaticTransform* worldToObject) const {
+            *objectToWorld = m_hostGeometryInstances[instIndex].objectToWorld;
+            *worldToObject = m_hostGeometryInstances[instIndex].worldToObject;
+        }
+        // JP: 構築時間は最後の更新でのBLASとTLASの構築全体のもの。
+        // EN: The build time is of the whole build of BLASes and the TLAS in the last update.
+        const CPU::BVHStatistics &getHostBVHStatistics() const {
+            return m_hostBVHStatistics;
+        }
     };
 
 
 
     class Scene : public Object {
         RootNode m_rootNode;
-        optix::Program m_callableProgramSampleInfiniteSphere;
+        Backend::Program m_callableProgramSampleInfiniteSphere;
         EnvironmentEmitterSurfaceMaterial* m_matEnv;
 
     public:
@@ -449,6 +542,26 @@ namespace VLR {
         void setEnvironment(EnvironmentEmitterSurfaceMaterial* matEnv);
 
         void set();
+
+        // JP: 三角形メッシュに対してレイの最も近い交差をホスト上で求める。
+        //     交差が無い場合はhits[i].instIndexがCPU::InvalidIndexとなる。
+        // EN: Find the closest intersections of rays against triangle meshes on the host.
+        //     hits[i].instIndex becomes CPU::InvalidIndex when there is no intersection.
+        void intersect(const CPU::Ray* rays, uint32_t numRays, CPU::RayHit* hits) {
+            m_rootNode.intersect(rays, numRays, hits);
+        }
+        const SHGeometryInstance* getHostGeometryInstance(uint32_t instIndex) const {
+            return m_rootNode.getHostGeometryInstance(instIndex);
+        }
+
+        // JP: CPUバックエンドのレンダラーはルートノードの加速構造を使ってレンダリングする。
+        // EN: The renderer of the CPU backend renders using the acceleration structure of the root node.
+        bool updateHostAccelerator() {
+            return m_rootNode.updateHostAccelerator();
+        }
+        const RootNode &getRootNode() const {
+            return m_rootNode;
+        }
     };
 
 
@@ -473,8 +586,8 @@ namespace VLR {
 
     class PerspectiveCamera : public Camera {
         struct OptiXProgramSet {
-            optix::Program callableProgramSampleLensPosition;
-            optix::Program callableProgramSampleIDF;
+            Backend::Program callableProgramSampleLensPosition;
+            Backend::Program callableProgramSampleIDF;
         };
 
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
@@ -547,8 +660,8 @@ namespace VLR {
 
     class EquirectangularCamera : public Camera {
         struct OptiXProgramSet {
-            optix::Program callableProgramSampleLensPosition;
-            optix::Program callableProgramSampleIDF;
+            Backend::Program callableProgramSampleLensPosition;
+            Backend::Program callableProgramSampleIDF;
         };
 
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
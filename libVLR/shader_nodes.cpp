@@ -1,5 +1,10 @@
 ﻿#include "shader_nodes.h"
 
+#include "cpu_traversal.h"
+#include "image_filter.h"
+#include "block_compression.h"
+#include "tiled_image.h"
+
 namespace VLR {
     const size_t sizesOfDataFormats[(uint32_t)NumVLRDataFormats] = {
     sizeof(RGB8x3),
@@ -20,7 +25,8 @@ namespace VLR {
     0,
     0,
     0,
-    0
+    0,
+    sizeof(uvsA16Fx4),
     };
 
     VLRDataFormat Image2D::getInternalFormat(VLRDataFormat inputFormat) {
@@ -63,6 +69,8 @@ namespace VLR {
             return VLRDataFormat_BC6H_Signed;
         case VLRDataFormat_BC7:
             return VLRDataFormat_BC7;
+        case VLRDataFormat_uvsA16Fx4:
+            return VLRDataFormat_uvsA16Fx4;
         default:
             VLRAssert(false, "Data format is invalid.");
             break;
@@ -70,6 +78,35 @@ namespace VLR {
         return VLRDataFormat_RGBA8x4;
     }
 
+    RTformat Image2D::getOptiXFormat(VLRDataFormat dataFormat) {
+        switch (dataFormat) {
+        case VLRDataFormat_RGB8x3:
+            return RT_FORMAT_UNSIGNED_BYTE3;
+        case VLRDataFormat_RGB_8x4:
+            return RT_FORMAT_UNSIGNED_BYTE4;
+        case VLRDataFormat_RGBA8x4:
+            return RT_FORMAT_UNSIGNED_BYTE4;
+        case VLRDataFormat_RGBA16Fx4:
+            return RT_FORMAT_HALF4;
+        case VLRDataFormat_RGBA32Fx4:
+            return RT_FORMAT_FLOAT4;
+        case VLRDataFormat_RG32Fx2:
+            return RT_FORMAT_FLOAT2;
+        case VLRDataFormat_Gray32F:
+            return RT_FORMAT_FLOAT;
+        case VLRDataFormat_Gray8:
+            return RT_FORMAT_UNSIGNED_BYTE;
+        case VLRDataFormat_GrayA8x2:
+            return RT_FORMAT_UNSIGNED_BYTE2;
+        case VLRDataFormat_uvsA16Fx4:
+            return RT_FORMAT_HALF4;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            break;
+        }
+        return RT_FORMAT_UNKNOWN;
+    }
+
     Image2D::Image2D(Context &context, uint32_t width, uint32_t height, VLRDataFormat originalDataFormat, bool applyDegamma) :
         Object(context), m_width(width), m_height(height), m_originalDataFormat(originalDataFormat), m_initOptiXObject(false) {
         m_dataFormat = getInternalFormat(m_originalDataFormat);
@@ -95,11 +132,11 @@ namespace VLR {
             m_optixDataBuffer->destroy();
     }
 
-    optix::Buffer Image2D::getOptiXObject() const {
+    Backend::Buffer Image2D::getOptiXObject() const {
         if (m_initOptiXObject)
             return m_optixDataBuffer;
 
-        optix::Context optixContext = m_context.getOptiXContext();
+        Backend::Context optixContext = m_context.getOptiXContext();
 
         if (m_dataFormat >= VLRDataFormat_BC1 && m_dataFormat <= VLRDataFormat_BC7) {
             uint32_t widthInBlocks = nextMultiplierForPowOf2(m_width, 4);
@@ -142,338 +179,707 @@ namespace VLR {
             }
         }
         else {
-            switch (m_dataFormat) {
-            case VLRDataFormat_RGB8x3:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BYTE3, m_width, m_height);
-                break;
-            case VLRDataFormat_RGB_8x4:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BYTE4, m_width, m_height);
-                break;
-            case VLRDataFormat_RGBA8x4:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BYTE4, m_width, m_height);
-                break;
+            m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, getOptiXFormat(m_dataFormat), m_width, m_height);
+        }
+
+        m_initOptiXObject = true;
+
+        return m_optixDataBuffer;
+    }
+
+
+
+    template <typename SrcType, typename DstType, typename FuncProcessRow>
+    static void processAllRows(const uint8_t* srcData, uint8_t* dstData, uint32_t width, uint32_t height, FuncProcessRow func) {
+        auto srcHead = (const SrcType*)srcData;
+        auto dstHead = (DstType*)dstData;
+        processRowsInParallel(width, height, [&](uint32_t y) {
+            func(srcHead + width * y, dstHead + width * y);
+        });
+    }
+    
+    bool LinearImage2D::canAdoptData(VLRDataFormat dataFormat, bool applyDegamma) {
+        if (Image2D::getInternalFormat(dataFormat) != dataFormat)
+            return false;
+        if (applyDegamma) {
+            switch (dataFormat) {
             case VLRDataFormat_RGBA16Fx4:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_HALF4, m_width, m_height);
-                break;
             case VLRDataFormat_RGBA32Fx4:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_FLOAT4, m_width, m_height);
-                break;
             case VLRDataFormat_RG32Fx2:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_FLOAT2, m_width, m_height);
-                break;
             case VLRDataFormat_Gray32F:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_FLOAT, m_width, m_height);
-                break;
-            case VLRDataFormat_Gray8:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BYTE, m_width, m_height);
-                break;
             case VLRDataFormat_GrayA8x2:
-                m_optixDataBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, RT_FORMAT_UNSIGNED_BYTE2, m_width, m_height);
-                break;
+                return false;
             default:
-                VLRAssert_ShouldNotBeCalled();
                 break;
             }
         }
+        return true;
+    }
 
-        m_initOptiXObject = true;
+    LinearImage2D::LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) :
+        Image2D(context, width, height, Image2D::getInternalFormat(dataFormat), applyDegamma),
+        m_data(nullptr), m_releaseCallback(nullptr), m_releaseUserData(nullptr), m_copyDone(false) {
+        convert(linearData, dataFormat, applyDegamma);
+    }
+
+    LinearImage2D::LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma,
+                                 VLRImageDataReleaseCallback releaseCallback, void* userData) :
+        Image2D(context, width, height, Image2D::getInternalFormat(dataFormat), applyDegamma),
+        m_data(nullptr), m_releaseCallback(nullptr), m_releaseUserData(nullptr), m_copyDone(false) {
+        if (canAdoptData(dataFormat, applyDegamma)) {
+            m_data = linearData;
+            m_releaseCallback = releaseCallback;
+            m_releaseUserData = userData;
+        }
+        else {
+            convert(linearData, dataFormat, applyDegamma);
+            if (releaseCallback)
+                releaseCallback(linearData, userData);
+        }
+    }
 
-        return m_optixDataBuffer;
+    LinearImage2D::LinearImage2D(Context &context, std::vector<uint8_t> &&data, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) :
+        Image2D(context, width, height, dataFormat, applyDegamma),
+        m_ownedData(std::move(data)), m_releaseCallback(nullptr), m_releaseUserData(nullptr), m_copyDone(false) {
+        VLRAssert(Image2D::getInternalFormat(dataFormat) == dataFormat, "Data format must be an internal format.");
+        VLRAssert(m_ownedData.size() == getStride() * width * height, "Data size does not match the image size.");
+        m_data = m_ownedData.data();
     }
 
+    LinearImage2D::~LinearImage2D() {
+        if (m_releaseCallback)
+            m_releaseCallback(m_data, m_releaseUserData);
+    }
 
+    ImageCache::Key LinearImage2D::createImageCacheKey() const {
+        return ImageCache::createLinearImageKey(m_data, getWidth(), getHeight(), getDataFormat(), needsDegamma());
+    }
 
-    template <typename SrcType, typename DstType>
-    using FuncProcessPixel = void (*)(const SrcType &src, DstType &dst);
-    
-    template <typename SrcType, typename DstType>
-    void processAllPixels(const uint8_t* srcData, uint8_t* dstData, uint32_t width, uint32_t height, FuncProcessPixel<SrcType, DstType> func) {
-        auto srcHead = (const SrcType*)srcData;
-        auto dstHead = (DstType*)dstData;
-        for (int y = 0; y < height; ++y) {
-            auto srcLineHead = srcHead + width * y;
-            auto dstLineHead = dstHead + width * y;
-            for (int x = 0; x < width; ++x) {
-                auto &src = *(srcLineHead + x);
-                auto &dst = *(dstLineHead + x);
-                func(src, dst);
-            }
-        }
+    size_t LinearImage2D::getDataSize() const {
+        return (size_t)getStride() * getWidth() * getHeight();
     }
-    
-    LinearImage2D::LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) :
-        Image2D(context, width, height, Image2D::getInternalFormat(dataFormat), applyDegamma), m_copyDone(false) {
-        m_data.resize(getStride() * getWidth() * getHeight());
+
+    bool LinearImage2D::hasSameData(const Image2D* image) const {
+        if (!image->is<LinearImage2D>())
+            return false;
+        auto linearImage = (const LinearImage2D*)image;
+        return (linearImage->getWidth() == getWidth() && linearImage->getHeight() == getHeight() &&
+                linearImage->getDataFormat() == getDataFormat() && linearImage->needsDegamma() == needsDegamma() &&
+                linearImage->m_mipData == m_mipData &&
+                std::memcmp(linearImage->m_data, m_data, getDataSize()) == 0);
+    }
+
+    void LinearImage2D::convert(const uint8_t* linearData, VLRDataFormat dataFormat, bool applyDegamma) {
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        m_ownedData.resize(getStride() * width * height);
+        m_data = m_ownedData.data();
+        uint8_t* dstData = m_ownedData.data();
+
+        // JP: 各行の先頭からAVX2版で変換し、残りをスカラーで処理する。
+        // EN: Convert each row from its head with the AVX2 version, then process the rest in scalar.
+        bool useAVX2 = CPU::isAVX2Available();
+        bool useAVX2F16C = useAVX2 && CPU::isF16CAvailable();
 
         switch (dataFormat) {
         case VLRDataFormat_RGB8x3: {
-            FuncProcessPixel<RGB8x3, RGBA8x4> funcAsIs = [](const RGB8x3 &src, RGBA8x4 &dst) {
-                dst.r = src.r;
-                dst.g = src.g;
-                dst.b = src.b;
-                dst.a = 255;
-            };
-            processAllPixels(linearData, m_data.data(), width, height, funcAsIs);
+            processAllRows<RGB8x3, RGBA8x4>(linearData, dstData, width, height, [&](const RGB8x3* src, RGBA8x4* dst) {
+                uint32_t x = useAVX2 ? AVX2::convertRGB8x3ToRGBA8x4(src, width, dst) : 0;
+                for (; x < width; ++x)
+                    dst[x] = RGBA8x4{ src[x].r, src[x].g, src[x].b, 255 };
+            });
             break;
         }
         case VLRDataFormat_RGB_8x4: {
-            FuncProcessPixel<RGB_8x4, RGBA8x4> funcAsIs = [](const RGB_8x4 &src, RGBA8x4 &dst) {
-                dst.r = src.r;
-                dst.g = src.g;
-                dst.b = src.b;
-                dst.a = 255;
-            };
-            processAllPixels(linearData, m_data.data(), width, height, funcAsIs);
+            processAllRows<RGB_8x4, RGBA8x4>(linearData, dstData, width, height, [&](const RGB_8x4* src, RGBA8x4* dst) {
+                uint32_t x = useAVX2 ? AVX2::convertRGB_8x4ToRGBA8x4(src, width, dst) : 0;
+                for (; x < width; ++x)
+                    dst[x] = RGBA8x4{ src[x].r, src[x].g, src[x].b, 255 };
+            });
             break;
         }
         case VLRDataFormat_RGBA8x4: {
             auto srcHead = (const RGBA8x4*)linearData;
-            auto dstHead = (RGBA8x4*)m_data.data();
+            auto dstHead = (RGBA8x4*)dstData;
             std::copy_n(srcHead, width * height, dstHead);
             break;
         }
         case VLRDataFormat_RGBA16Fx4: {
             if (applyDegamma) {
-                FuncProcessPixel<RGBA16Fx4, RGBA16Fx4> funcApplyDegamma = [](const RGBA16Fx4 &src, RGBA16Fx4 &dst) {
-                    dst.r = (half)sRGB_degamma((float)src.r);
-                    dst.g = (half)sRGB_degamma((float)src.g);
-                    dst.b = (half)sRGB_degamma((float)src.b);
-                    dst.a = src.a;
-                };
-                processAllPixels(linearData, m_data.data(), width, height, funcApplyDegamma);
+                processAllRows<RGBA16Fx4, RGBA16Fx4>(linearData, dstData, width, height, [&](const RGBA16Fx4* src, RGBA16Fx4* dst) {
+                    uint32_t x = useAVX2F16C ? AVX2::applyDegamma(src, width, dst) : 0;
+                    for (; x < width; ++x) {
+                        dst[x].r = (half)sRGB_degamma((float)src[x].r);
+                        dst[x].g = (half)sRGB_degamma((float)src[x].g);
+                        dst[x].b = (half)sRGB_degamma((float)src[x].b);
+                        dst[x].a = src[x].a;
+                    }
+                });
             }
             else {
                 auto srcHead = (const RGBA16Fx4*)linearData;
-                auto dstHead = (RGBA16Fx4*)m_data.data();
+                auto dstHead = (RGBA16Fx4*)dstData;
                 std::copy_n(srcHead, width * height, dstHead);
             }
             break;
         }
         case VLRDataFormat_RGBA32Fx4: {
             if (applyDegamma) {
-                FuncProcessPixel<RGBA32Fx4, RGBA32Fx4> funcApplyDegamma = [](const RGBA32Fx4 &src, RGBA32Fx4 &dst) {
-                    dst.r = sRGB_degamma(src.r);
-                    dst.g = sRGB_degamma(src.g);
-                    dst.b = sRGB_degamma(src.b);
-                    dst.a = src.a;
-                };
-                processAllPixels(linearData, m_data.data(), width, height, funcApplyDegamma);
+                processAllRows<RGBA32Fx4, RGBA32Fx4>(linearData, dstData, width, height, [&](const RGBA32Fx4* src, RGBA32Fx4* dst) {
+                    uint32_t x = useAVX2 ? AVX2::applyDegamma(src, width, dst) : 0;
+                    for (; x < width; ++x) {
+                        dst[x].r = sRGB_degamma(src[x].r);
+                        dst[x].g = sRGB_degamma(src[x].g);
+                        dst[x].b = sRGB_degamma(src[x].b);
+                        dst[x].a = src[x].a;
+                    }
+                });
             }
             else {
                 auto srcHead = (const RGBA32Fx4*)linearData;
-                auto dstHead = (RGBA32Fx4*)m_data.data();
-                std::copy_n(srcHead, width * height, dstHead);
-            }
-            break;
-        }
-        case VLRDataFormat_RG32Fx2: {
-            if (applyDegamma) {
-                FuncProcessPixel<RG32Fx2, RG32Fx2> funcApplyDegamma = [](const RG32Fx2 &src, RG32Fx2 &dst) {
-                    dst.r = sRGB_degamma(src.r);
-                    dst.g = sRGB_degamma(src.g);
-                };
-                processAllPixels(linearData, m_data.data(), width, height, funcApplyDegamma);
-            }
-            else {
-                auto srcHead = (const RG32Fx2*)linearData;
-                auto dstHead = (RG32Fx2*)m_data.data();
+                auto dstHead = (RGBA32Fx4*)dstData;
                 std::copy_n(srcHead, width * height, dstHead);
             }
             break;
         }
+        case VLRDataFormat_RG32Fx2:
         case VLRDataFormat_Gray32F: {
             if (applyDegamma) {
-                FuncProcessPixel<Gray32F, Gray32F> funcApplyDegamma = [](const Gray32F &src, Gray32F &dst) {
-                    dst.v = sRGB_degamma(src.v);
-                };
-                processAllPixels(linearData, m_data.data(), width, height, funcApplyDegamma);
+                // JP: どちらも全成分をデガンマするのでfloatの列として扱う。
+                // EN: Both formats degamma all the components, so treat them as arrays of floats.
+                uint32_t numComponents = (uint32_t)(sizesOfDataFormats[dataFormat] / sizeof(float));
+                uint32_t numValues = numComponents * width;
+                processAllRows<float, float>(linearData, dstData, numValues, height, [&](const float* src, float* dst) {
+                    uint32_t i = useAVX2 ? AVX2::applyDegamma(src, numValues, dst) : 0;
+                    for (; i < numValues; ++i)
+                        dst[i] = sRGB_degamma(src[i]);
+                });
             }
             else {
-                auto srcHead = (const Gray32F*)linearData;
-                auto dstHead = (Gray32F*)m_data.data();
-                std::copy_n(srcHead, width * height, dstHead);
+                std::copy_n(linearData, sizesOfDataFormats[dataFormat] * width * height, dstData);
             }
             break;
         }
         case VLRDataFormat_Gray8: {
             auto srcHead = (const Gray8*)linearData;
-            auto dstHead = (Gray8*)m_data.data();
+            auto dstHead = (Gray8*)dstData;
             std::copy_n(srcHead, width * height, dstHead);
             break;
         }
         case VLRDataFormat_GrayA8x2: {
             if (applyDegamma) {
-                FuncProcessPixel<GrayA8x2, GrayA8x2> funcApplyDegamma = [](const GrayA8x2 &src, GrayA8x2 &dst) {
-                    dst.v = std::min<uint32_t>(255, 256 * sRGB_degamma(src.v / 255.0f));
-                    dst.a = src.a;
-                };
-                processAllPixels(linearData, m_data.data(), width, height, funcApplyDegamma);
+                uint8_t degammaTable[256];
+                for (int i = 0; i < 256; ++i)
+                    degammaTable[i] = std::min<uint32_t>(255, 256 * sRGB_degamma(i / 255.0f));
+                processAllRows<GrayA8x2, GrayA8x2>(linearData, dstData, width, height, [&](const GrayA8x2* src, GrayA8x2* dst) {
+                    for (uint32_t x = 0; x < width; ++x)
+                        dst[x] = GrayA8x2{ degammaTable[src[x].v], src[x].a };
+                });
             }
             else {
                 auto srcHead = (const GrayA8x2*)linearData;
-                auto dstHead = (GrayA8x2*)m_data.data();
+                auto dstHead = (GrayA8x2*)dstData;
                 std::copy_n(srcHead, width * height, dstHead);
             }
             break;
         }
+        case VLRDataFormat_uvsA16Fx4: {
+            auto srcHead = (const uvsA16Fx4*)linearData;
+            auto dstHead = (uvsA16Fx4*)dstData;
+            std::copy_n(srcHead, width * height, dstHead);
+            break;
+        }
         default:
             VLRAssert(false, "Data format is invalid.");
             break;
         }
     }
 
-    Image2D* LinearImage2D::createShrinkedImage2D(uint32_t width, uint32_t height) const {
+    static uint32_t getNumComponents(VLRDataFormat format) {
+        switch (format) {
+        case VLRDataFormat_RGBA8x4:
+        case VLRDataFormat_RGBA16Fx4:
+        case VLRDataFormat_RGBA32Fx4:
+        case VLRDataFormat_uvsA16Fx4:
+            return 4;
+        case VLRDataFormat_RG32Fx2:
+        case VLRDataFormat_GrayA8x2:
+            return 2;
+        case VLRDataFormat_Gray32F:
+        case VLRDataFormat_Gray8:
+            return 1;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return 0;
+        }
+    }
+
+    // JP: 色でない値を持つ形式。アップサンプルしたスペクトルの係数や符号付きのBC4/BC5を展開した値では、
+    //     リンギングによる行き過ぎが無意味な値や範囲外の値になるので、Kaiser、Lanczosの代わりにBoxで縮小する。
+    //     Boxは入力の凸結合なので、値は元の範囲に収まる。
+    // EN: Formats holding non-color values. For coefficients of upsampled spectra and values decompressed from signed BC4/BC5,
+    //     overshoot from ringing results in meaningless or out-of-range values, so they are shrunk with Box instead of Kaiser and Lanczos.
+    //     Box is a convex combination of the inputs, so values stay within the original range.
+    static VLRMipmapFilter getFilterForFormat(VLRDataFormat format, VLRMipmapFilter filter) {
+        bool isColorFormat = format != VLRDataFormat_uvsA16Fx4 && format != VLRDataFormat_RG32Fx2 && format != VLRDataFormat_Gray32F;
+        return isColorFormat ? filter : VLRMipmapFilter_Box;
+    }
+
+    // JP: 内部形式の画素の行と成分ごとのfloatの行を相互に変換する。変換表は構築時に一度だけ作り、複数のスレッドから行ごとに使える。
+    //     デコードはdegammaが真の場合、8ビットの色成分をテクスチャーユニットと同様に線形に戻す。
+    //     エンコードの8ビットへの量子化はガンマ空間での丸めになるよう、各段の境界を線形な値で二分探索する。
+    //     エンコードは値を形式の有効な範囲に収める。色は0以上(halfでは最大値以下)、アルファは[0, 1]、
+    //     uvsA16Fx4のu, vはスペクトルのグリッドの範囲に収める。
+    // EN: Convert between rows of pixels in an internal format and rows of floats per component. The tables are built once at construction, and rows can be converted from multiple threads.
+    //     If degamma is true, decoding makes 8-bit color components linear like the texture unit does.
+    //     Quantization to 8 bits in encoding binary-searches the boundaries of the steps in linear values so that it rounds in gamma space.
+    //     Encoding clamps values to the valid range of the format. Colors are clamped to 0 or more (and the maximum for half), alpha to [0, 1],
+    //     and u, v of uvsA16Fx4 to the range of the spectrum grid.
+    class PixelRowConverter {
+        VLRDataFormat m_format;
+        uint32_t m_numComponents;
+        bool m_hasAlpha;
+        bool m_useAVX2F16C;
+        float m_colorTable[256];
+        float m_alphaTable[256];
+        float m_colorBoundaries[255];
+
+    public:
+        PixelRowConverter(VLRDataFormat format, bool hasAlpha, bool degamma) :
+            m_format(format), m_numComponents(VLR::getNumComponents(format)), m_hasAlpha(hasAlpha),
+            m_useAVX2F16C(CPU::isAVX2Available() && CPU::isF16CAvailable()) {
+            for (int i = 0; i < 256; ++i) {
+                m_alphaTable[i] = i / 255.0f;
+                m_colorTable[i] = degamma ? sRGB_degamma(m_alphaTable[i]) : m_alphaTable[i];
+            }
+            for (int i = 0; i < 255; ++i) {
+                float value = (i + 0.5f) / 255.0f;
+                m_colorBoundaries[i] = degamma ? sRGB_degamma(value) : value;
+            }
+        }
+
+        uint32_t getNumComponents() const {
+            return m_numComponents;
+        }
+
+        void decode(const uint8_t* srcRow, uint32_t width, float* dstRow) const {
+            uint32_t rowLength = m_numComponents * width;
+            switch (m_format) {
+            case VLRDataFormat_RGBA8x4:
+            case VLRDataFormat_GrayA8x2:
+            case VLRDataFormat_Gray8: {
+                for (uint32_t i = 0; i < rowLength; ++i) {
+                    bool isAlpha = m_hasAlpha && i % m_numComponents == m_numComponents - 1;
+                    dstRow[i] = isAlpha ? m_alphaTable[srcRow[i]] : m_colorTable[srcRow[i]];
+                }
+                break;
+            }
+            case VLRDataFormat_RGBA16Fx4:
+            case VLRDataFormat_uvsA16Fx4: {
+                const half* src = (const half*)srcRow;
+                uint32_t i = m_useAVX2F16C ? AVX2::convertHalfToFloat(src, rowLength, dstRow) : 0;
+                for (; i < rowLength; ++i)
+                    dstRow[i] = src[i];
+                break;
+            }
+            case VLRDataFormat_RGBA32Fx4:
+            case VLRDataFormat_RG32Fx2:
+            case VLRDataFormat_Gray32F: {
+                std::copy_n((const float*)srcRow, rowLength, dstRow);
+                break;
+            }
+            default:
+                VLRAssert_ShouldNotBeCalled();
+                break;
+            }
+        }
+
+        void encode(const float* srcRow, uint32_t width, uint8_t* dstRow) const {
+            uint32_t rowLength = m_numComponents * width;
+            switch (m_format) {
+            case VLRDataFormat_RGBA8x4:
+            case VLRDataFormat_GrayA8x2:
+            case VLRDataFormat_Gray8: {
+                for (uint32_t i = 0; i < rowLength; ++i) {
+                    bool isAlpha = m_hasAlpha && i % m_numComponents == m_numComponents - 1;
+                    if (isAlpha)
+                        dstRow[i] = (uint8_t)std::min(std::max(std::round(srcRow[i] * 255.0f), 0.0f), 255.0f);
+                    else
+                        dstRow[i] = (uint8_t)(std::upper_bound(m_colorBoundaries, m_colorBoundaries + 255, srcRow[i]) - m_colorBoundaries);
+                }
+                break;
+            }
+            case VLRDataFormat_RGBA16Fx4:
+            case VLRDataFormat_RGBA32Fx4: {
+                float maxValue = m_format == VLRDataFormat_RGBA16Fx4 ? (float)std::numeric_limits<half>::max() : std::numeric_limits<float>::max();
+                for (uint32_t i = 0; i < rowLength; ++i) {
+                    bool isAlpha = m_hasAlpha && i % m_numComponents == m_numComponents - 1;
+                    float value = std::min(std::max(srcRow[i], 0.0f), isAlpha ? 1.0f : maxValue);
+                    if (m_format == VLRDataFormat_RGBA16Fx4)
+                        ((half*)dstRow)[i] = (half)value;
+                    else
+                        ((float*)dstRow)[i] = value;
+                }
+                break;
+            }
+            case VLRDataFormat_uvsA16Fx4: {
+                const float maxValues[] = {
+                    (float)UpsampledSpectrum::GridWidth(), (float)UpsampledSpectrum::GridHeight(), (float)std::numeric_limits<half>::max(), 1.0f
+                };
+                half* dst = (half*)dstRow;
+                for (uint32_t i = 0; i < rowLength; ++i)
+                    dst[i] = (half)std::min(std::max(srcRow[i], 0.0f), maxValues[i % 4]);
+                break;
+            }
+            case VLRDataFormat_RG32Fx2:
+            case VLRDataFormat_Gray32F: {
+                // JP: 符号付きの値を持ちうるので切り詰めない。Boxでの縮小は元の範囲を保つ。
+                // EN: These may hold signed values, so don't clamp. Shrinking with Box keeps the original range.
+                std::copy_n(srcRow, rowLength, (float*)dstRow);
+                break;
+            }
+            default:
+                VLRAssert_ShouldNotBeCalled();
+                break;
+            }
+        }
+    };
+
+    static void decodeToFloat(const uint8_t* srcData, VLRDataFormat format, bool hasAlpha, bool degamma, uint32_t width, uint32_t height, float* dstData) {
+        PixelRowConverter converter(format, hasAlpha, degamma);
+        uint32_t srcRowSize = (uint32_t)sizesOfDataFormats[format] * width;
+        uint32_t dstRowLength = converter.getNumComponents() * width;
+        processRowsInParallel(width, height, [&](uint32_t y) {
+            converter.decode(srcData + srcRowSize * y, width, dstData + dstRowLength * y);
+        });
+    }
+
+    static void encodeFromFloat(const float* srcData, VLRDataFormat format, bool hasAlpha, bool degamma, uint32_t width, uint32_t height, uint8_t* dstData) {
+        PixelRowConverter converter(format, hasAlpha, degamma);
+        uint32_t srcRowLength = converter.getNumComponents() * width;
+        uint32_t dstRowSize = (uint32_t)sizesOfDataFormats[format] * width;
+        processRowsInParallel(width, height, [&](uint32_t y) {
+            converter.encode(srcData + srcRowLength * y, width, dstData + dstRowSize * y);
+        });
+    }
+
+    Image2D* LinearImage2D::createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const {
+        VLRDataFormat format = getDataFormat();
         uint32_t orgWidth = getWidth();
         uint32_t orgHeight = getHeight();
         uint32_t stride = getStride();
-        VLRAssert(width < orgWidth && height < orgHeight, "Image size must be smaller than the original.");
+        VLRAssert(width <= orgWidth && height <= orgHeight, "Image size must not be larger than the original.");
         std::vector<uint8_t> data;
         data.resize(stride * width * height);
 
-        float deltaOrgX = orgWidth / width;
-        float deltaOrgY = orgHeight / height;
-        for (int y = 0; y < height; ++y) {
-            float top = deltaOrgY * y;
-            float bottom = deltaOrgY * (y + 1);
-            uint32_t topPix = (uint32_t)top;
-            uint32_t bottomPix = (uint32_t)ceilf(bottom) - 1;
-
-            for (int x = 0; x < width; ++x) {
-                float left = deltaOrgX * x;
-                float right = deltaOrgX * (x + 1);
-                uint32_t leftPix = (uint32_t)left;
-                uint32_t rightPix = (uint32_t)ceilf(right) - 1;
-
-                float area = (bottom - top) * (right - left);
-
-                // UL, UR, LL, LR
-                float weightsCorners[] = {
-                    (leftPix + 1 - left) * (topPix + 1 - top),
-                    (right - rightPix) * (topPix + 1 - top),
-                    (leftPix + 1 - left) * (bottom - bottomPix),
-                    (right - rightPix) * (bottom - bottomPix)
-                };
-                // Top, Left, Right, Bottom
-                float weightsEdges[] = {
-                    topPix + 1 - top,
-                    leftPix + 1 - left,
-                    right - rightPix,
-                    bottom - bottomPix
-                };
-
-                switch (getDataFormat()) {
-                case VLRDataFormat_RGBA16Fx4: {
-                    CompensatedSum<float> sumR(0), sumG(0), sumB(0), sumA(0);
-                    RGBA16Fx4 pix;
-
-                    uint32_t corners[] = { leftPix, topPix, rightPix, topPix, leftPix, bottomPix, rightPix, bottomPix };
-                    for (int i = 0; i < 4; ++i) {
-                        pix = get<RGBA16Fx4>(corners[2 * i + 0], corners[2 * i + 1]);
-                        sumR += weightsCorners[i] * float(pix.r);
-                        sumG += weightsCorners[i] * float(pix.g);
-                        sumB += weightsCorners[i] * float(pix.b);
-                        sumA += weightsCorners[i] * float(pix.a);
-                    }
+        // JP: 各行を線形な値のfloatに展開しながら分離可能なフィルターで縮小し、元の形式に戻す。
+        //     縮小率が整数でなくても、Boxは各出力画素が覆う領域の面積平均になる。
+        // EN: Shrink with a separable filter while expanding each row into linear floats, then return to the original format.
+        //     Box results in the area average over the region covered by each output pixel even for non-integer ratios.
+        PixelRowConverter converter(format, hasAlpha(), needsDegamma());
+        auto loadRow = [&](uint32_t y, float* row) {
+            converter.decode(m_data + stride * orgWidth * y, orgWidth, row);
+        };
+        auto storeRow = [&](uint32_t y, const float* row) {
+            converter.encode(row, width, data.data() + stride * width * y);
+        };
+        resampleRows(orgWidth, orgHeight, converter.getNumComponents(), getFilterForFormat(format, filter), width, height, loadRow, storeRow);
 
-                    for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                        pix = get<RGBA16Fx4>(x, topPix);
-                        sumR += weightsEdges[0] * float(pix.r);
-                        sumG += weightsEdges[0] * float(pix.g);
-                        sumB += weightsEdges[0] * float(pix.b);
-                        sumA += weightsEdges[0] * float(pix.a);
-
-                        pix = get<RGBA16Fx4>(x, bottomPix);
-                        sumR += weightsEdges[3] * float(pix.r);
-                        sumG += weightsEdges[3] * float(pix.g);
-                        sumB += weightsEdges[3] * float(pix.b);
-                        sumA += weightsEdges[3] * float(pix.a);
-                    }
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        pix = get<RGBA16Fx4>(leftPix, y);
-                        sumR += weightsEdges[1] * float(pix.r);
-                        sumG += weightsEdges[1] * float(pix.g);
-                        sumB += weightsEdges[1] * float(pix.b);
-                        sumA += weightsEdges[1] * float(pix.a);
-
-                        pix = get<RGBA16Fx4>(rightPix, y);
-                        sumR += weightsEdges[2] * float(pix.r);
-                        sumG += weightsEdges[2] * float(pix.g);
-                        sumB += weightsEdges[2] * float(pix.b);
-                        sumA += weightsEdges[2] * float(pix.a);
-                    }
+        return new LinearImage2D(m_context, std::move(data), width, height, format, needsDegamma());
+    }
 
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                            pix = get<RGBA16Fx4>(x, y);
-                            sumR += float(pix.r);
-                            sumG += float(pix.g);
-                            sumB += float(pix.b);
-                            sumA += float(pix.a);
-                        }
-                    }
+    Image2D* LinearImage2D::createLuminanceImage2D() const {
+        VLRDataFormat format = getDataFormat();
 
-                    *(RGBA16Fx4*)&data[(y * width + x) * stride] = RGBA16Fx4{ half(sumR / area), half(sumG / area), half(sumB / area), half(sumA / area) };
-                    break;
-                }
-                default:
-                    VLRAssert_ShouldNotBeCalled();
-                    break;
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        uint32_t stride = getStride();
+        std::vector<uint8_t> data;
+        data.resize(sizeof(float) * width * height);
+
+        // JP: RGを持つ形式はBを0、グレースケールの形式はその値を輝度とする。
+        //     uvsA16Fx4はsがX + Y + Zに比例するので、u, vから求めた色度yを掛けてYとする。
+        // EN: Formats with RG take B as 0, and grayscale formats take their value as luminance.
+        //     s of uvsA16Fx4 is proportional to X + Y + Z, so multiply it by the chromaticity y derived from u, v to obtain Y.
+        PixelRowConverter converter(format, hasAlpha(), needsDegamma());
+        uint32_t numComponents = converter.getNumComponents();
+        processRowsInParallel(width, height, [&](uint32_t y) {
+            std::vector<float> row(numComponents * width);
+            converter.decode(m_data + stride * width * y, width, row.data());
+            float* dstRow = (float*)data.data() + width * y;
+            for (uint32_t x = 0; x < width; ++x) {
+                const float* pix = row.data() + numComponents * x;
+                if (format == VLRDataFormat_uvsA16Fx4) {
+                    float xy[2];
+                    UpsampledSpectrum::uv_to_xy(pix, xy);
+                    float brightness = pix[2] * UpsampledSpectrum::EqualEnergyReflectance() / (float)UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR;
+                    dstRow[x] = std::max(xy[1], 0.0f) * brightness;
                 }
+                else if (numComponents == 4)
+                    dstRow[x] = mat_Rec709_D65_to_XYZ[1] * pix[0] + mat_Rec709_D65_to_XYZ[4] * pix[1] + mat_Rec709_D65_to_XYZ[7] * pix[2];
+                else if (format == VLRDataFormat_RG32Fx2)
+                    dstRow[x] = mat_Rec709_D65_to_XYZ[1] * pix[0] + mat_Rec709_D65_to_XYZ[4] * pix[1];
+                else
+                    dstRow[x] = pix[0];
             }
+        });
+
+        return new LinearImage2D(m_context, std::move(data), width, height, VLRDataFormat_Gray32F);
+    }
+
+    LinearImage2D* LinearImage2D::createUpsampledSpectrumImage2D(VLRSpectrumType spectrumType, VLRColorSpace colorSpace) const {
+        VLRDataFormat srcFormat = getDataFormat();
+        if (srcFormat != VLRDataFormat_RGBA8x4 &&
+            srcFormat != VLRDataFormat_RGBA16Fx4 &&
+            srcFormat != VLRDataFormat_RGBA32Fx4)
+            return nullptr;
+
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        uint32_t srcStride = getStride();
+
+        // JP: sRGBのデガンマは先に済ませ、以降は線形な色空間として扱う。
+        //     8ビットの場合はテクスチャーユニットが行うデガンマも含めて表引きにする。
+        // EN: Apply sRGB degamma first and treat the color space as linear afterward.
+        //     8-bit values are looked up from a table that also includes the degamma done by the texture unit.
+        bool applyDegamma = colorSpace == VLRColorSpace_Rec709_D65_sRGBGamma;
+        VLRColorSpace linearColorSpace = applyDegamma ? VLRColorSpace_Rec709_D65 : colorSpace;
+        float degammaTable[256];
+        for (int i = 0; i < 256; ++i) {
+            float value = i / 255.0f;
+            if (needsDegamma())
+                value = sRGB_degamma(value);
+            if (applyDegamma)
+                value = sRGB_degamma(value);
+            degammaTable[i] = value;
         }
 
-        return new LinearImage2D(m_context, data.data(), width, height, getDataFormat(), false);
+        float matToXYZ[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+        if (linearColorSpace == VLRColorSpace_Rec709_D65)
+            std::copy_n(spectrumType == VLRSpectrumType_LightSource ? mat_Rec709_D65_to_XYZ : mat_Rec709_E_to_XYZ, 9, matToXYZ);
+
+        // JP: AVX2版はxyYと、表引きできない値のデガンマを扱わない。出力がhalfなのでF16Cも必要とする。
+        // EN: The AVX2 version handles neither xyY nor degamma of values that cannot be looked up from the table.
+        //     The output is half, so this also requires F16C.
+        bool useAVX2 = CPU::isAVX2Available() && CPU::isF16CAvailable() &&
+            linearColorSpace != VLRColorSpace_xyY &&
+            (srcFormat == VLRDataFormat_RGBA8x4 || !applyDegamma);
+
+        auto convertPixel = [&](uint32_t x, uint32_t y, uvsA16Fx4 &dst) {
+            float rgba[4];
+            switch (srcFormat) {
+            case VLRDataFormat_RGBA8x4: {
+                RGBA8x4 pix = get<RGBA8x4>(x, y);
+                rgba[0] = degammaTable[pix.r];
+                rgba[1] = degammaTable[pix.g];
+                rgba[2] = degammaTable[pix.b];
+                rgba[3] = pix.a / 255.0f;
+                break;
+            }
+            case VLRDataFormat_RGBA16Fx4: {
+                RGBA16Fx4 pix = get<RGBA16Fx4>(x, y);
+                rgba[0] = pix.r;
+                rgba[1] = pix.g;
+                rgba[2] = pix.b;
+                rgba[3] = pix.a;
+                break;
+            }
+            case VLRDataFormat_RGBA32Fx4: {
+                RGBA32Fx4 pix = get<RGBA32Fx4>(x, y);
+                rgba[0] = pix.r;
+                rgba[1] = pix.g;
+                rgba[2] = pix.b;
+                rgba[3] = pix.a;
+                break;
+            }
+            default:
+                VLRAssert_ShouldNotBeCalled();
+                break;
+            }
+            if (applyDegamma && srcFormat != VLRDataFormat_RGBA8x4) {
+                for (int i = 0; i < 3; ++i)
+                    rgba[i] = sRGB_degamma(rgba[i]);
+            }
+
+            float uvs[3];
+            UpsampledSpectrum::computeUVS(spectrumType, linearColorSpace, rgba[0], rgba[1], rgba[2], uvs);
+            dst = uvsA16Fx4{ half(uvs[0]), half(uvs[1]), half(uvs[2]), half(rgba[3]) };
+        };
+
+        std::vector<uint8_t> data;
+        data.resize(sizeof(uvsA16Fx4) * width * height);
+
+        processRowsInParallel(width, height, [&](uint32_t y) {
+            auto dstRow = (uvsA16Fx4*)data.data() + width * y;
+            uint32_t x = 0;
+            if (useAVX2)
+                x = AVX2::convertToUpsampledSpectrum(m_data + srcStride * width * y, srcFormat, degammaTable, matToXYZ, width, dstRow);
+            for (; x < width; ++x)
+                convertPixel(x, y, dstRow[x]);
+        });
+
+        return new LinearImage2D(m_context, std::move(data), width, height, VLRDataFormat_uvsA16Fx4);
     }
 
-    Image2D* LinearImage2D::createLuminanceImage2D() const {
+    void* LinearImage2D::createLinearImageData() const {
+        size_t size = getStride() * getWidth() * getHeight();
+        uint8_t* ret = new uint8_t[size];
+        std::copy_n(m_data, size, ret);
+        return ret;
+    }
+
+    bool LinearImage2D::generateMipmaps(VLRMipmapFilter filter) {
+        VLRDataFormat format = getDataFormat();
+        uint32_t numComponents = getNumComponents(format);
         uint32_t width = getWidth();
         uint32_t height = getHeight();
-        uint32_t stride;
-        VLRDataFormat newDataFormat;
-        switch (getDataFormat()) {
-        case VLRDataFormat_RGBA16Fx4: {
-            stride = sizeof(float);
-            newDataFormat = VLRDataFormat_Gray32F;
-            break;
+
+        // JP: 各レベルは量子化前の1つ上のレベルから作る。
+        // EN: Each level is made from the level one above before quantization.
+        std::vector<float> srcLevel(numComponents * width * height);
+        decodeToFloat(m_data, format, hasAlpha(), needsDegamma(), width, height, srcLevel.data());
+
+        m_mipData.clear();
+        while (width > 1 || height > 1) {
+            uint32_t dstWidth = std::max<uint32_t>(width / 2, 1);
+            uint32_t dstHeight = std::max<uint32_t>(height / 2, 1);
+            std::vector<float> dstLevel(numComponents * dstWidth * dstHeight);
+            resampleImage(srcLevel.data(), width, height, numComponents, getFilterForFormat(format, filter), dstLevel.data(), dstWidth, dstHeight);
+
+            std::vector<uint8_t> data(getStride() * dstWidth * dstHeight);
+            encodeFromFloat(dstLevel.data(), format, hasAlpha(), needsDegamma(), dstWidth, dstHeight, data.data());
+            m_mipData.push_back(std::move(data));
+
+            srcLevel = std::move(dstLevel);
+            width = dstWidth;
+            height = dstHeight;
         }
-        default:
-            VLRAssert_ShouldNotBeCalled();
-            break;
+
+        // JP: 既にアップロード済みの場合はすべてのレベルを転送し直す。
+        // EN: Transfer all the levels again if already uploaded.
+        if (m_copyDone) {
+            m_copyDone = false;
+            getOptiXObject();
         }
-        std::vector<uint8_t> data;
-        data.resize(stride * width * height);
 
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                switch (getDataFormat()) {
-                case VLRDataFormat_RGBA16Fx4: {
-                    RGBA16Fx4 pix = get<RGBA16Fx4>(x, y);
-                    float Y = mat_Rec709_D65_to_XYZ[1] * pix.r + mat_Rec709_D65_to_XYZ[4] * pix.g + mat_Rec709_D65_to_XYZ[7] * pix.b;
-                    *(float*)&data[(y * width + x) * stride] = Y;
-                    break;
+        return true;
+    }
+
+    BlockCompressedImage2D* LinearImage2D::createBlockCompressedImage2D(VLRDataFormat bcFormat, const char* cacheFilePath) const {
+        VLRDataFormat format = getDataFormat();
+        if (!isCompressibleFormat(bcFormat) || format == VLRDataFormat_uvsA16Fx4)
+            return nullptr;
+
+        uint32_t numComponents = getNumComponents(format);
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        uint32_t mipCount = 1 + countTrailingZeroes(prevPowerOf2(std::max(width, height)));
+
+        // JP: ガンマ付きの8ビットの画像はガンマ空間のまま圧縮してテクスチャーユニットでデガンマする。
+        //     BC5はデガンマできないので線形な値で圧縮する。
+        // EN: Compress an 8-bit image with gamma as is in gamma space and let the texture unit degamma it.
+        //     BC5 cannot be degammaed, so compress linear values.
+        bool keepsGamma = needsDegamma() && bcFormat != VLRDataFormat_BC5;
+
+        uint64_t key = computeDataHash(m_data, getStride() * width * height, 0);
+        for (const auto &mipData : m_mipData)
+            key = computeDataHash(mipData.data(), mipData.size(), key);
+        const uint32_t params[] = { (uint32_t)format, width, height, (uint32_t)needsDegamma(), (uint32_t)bcFormat };
+        key = computeDataHash((const uint8_t*)params, sizeof(params), key);
+
+        std::vector<std::vector<uint8_t>> compressedData;
+        if (cacheFilePath && loadCompressedImageCache(cacheFilePath, key, bcFormat, width, height, mipCount, &compressedData))
+            return new BlockCompressedImage2D(m_context, std::move(compressedData), width, height, bcFormat, keepsGamma);
+
+        uint32_t numChannels = bcFormat == VLRDataFormat_BC4 ? 1 : (bcFormat == VLRDataFormat_BC5 ? 2 : 4);
+        VLRDataFormat encodedFormat = numChannels == 4 ? VLRDataFormat_RGBA8x4 : (numChannels == 2 ? VLRDataFormat_GrayA8x2 : VLRDataFormat_Gray8);
+
+        std::vector<float> level(numComponents * width * height);
+        decodeToFloat(m_data, format, hasAlpha(), needsDegamma(), width, height, level.data());
+        compressedData.resize(mipCount);
+        for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel) {
+            uint32_t levelWidth = std::max<uint32_t>(width >> mipLevel, 1);
+            uint32_t levelHeight = std::max<uint32_t>(height >> mipLevel, 1);
+            if (mipLevel > 0) {
+                std::vector<float> nextLevel(numComponents * levelWidth * levelHeight);
+                if (mipLevel <= m_mipData.size())
+                    decodeToFloat(m_mipData[mipLevel - 1].data(), format, hasAlpha(), needsDegamma(), levelWidth, levelHeight, nextLevel.data());
+                else
+                    resampleImage(level.data(), std::max<uint32_t>(width >> (mipLevel - 1), 1), std::max<uint32_t>(height >> (mipLevel - 1), 1), numComponents,
+                                  VLRMipmapFilter_Box, nextLevel.data(), levelWidth, levelHeight);
+                level = std::move(nextLevel);
+            }
+
+            // JP: 成分を圧縮形式のチャンネルに割り当てる。グレースケールはRGBに複製し、無いアルファは1にする。
+            //     BC4は先頭の成分、BC5は先頭の2成分を使う。
+            // EN: Assign components to the channels of the compressed format. Grayscale is replicated to RGB and missing alpha becomes 1.
+            //     BC4 uses the first component and BC5 the first two components.
+            uint32_t numPixels = levelWidth * levelHeight;
+            std::vector<float> channels(numChannels * numPixels);
+            for (uint32_t i = 0; i < numPixels; ++i) {
+                const float* src = level.data() + numComponents * i;
+                float* dst = channels.data() + numChannels * i;
+                if (numChannels == 4) {
+                    if (numComponents == 4) {
+                        std::copy_n(src, 4, dst);
+                    }
+                    else if (format == VLRDataFormat_RG32Fx2) {
+                        dst[0] = src[0];
+                        dst[1] = src[1];
+                        dst[2] = 0.0f;
+                        dst[3] = 1.0f;
+                    }
+                    else {
+                        dst[0] = dst[1] = dst[2] = src[0];
+                        dst[3] = numComponents == 2 ? src[1] : 1.0f;
+                    }
                 }
-                default:
-                    VLRAssert_ShouldNotBeCalled();
-                    break;
+                else {
+                    for (uint32_t c = 0; c < numChannels; ++c)
+                        dst[c] = src[std::min(c, numComponents - 1)];
                 }
             }
+
+            std::vector<uint8_t> encodedData(numChannels * numPixels);
+            encodeFromFloat(channels.data(), encodedFormat, numChannels == 4, keepsGamma, levelWidth, levelHeight, encodedData.data());
+
+            compressedData[mipLevel].resize(getCompressedSize(bcFormat, levelWidth, levelHeight));
+            compressBlocks(encodedData.data(), bcFormat, levelWidth, levelHeight, compressedData[mipLevel].data());
         }
 
-        return new LinearImage2D(m_context, data.data(), width, height, newDataFormat, false);
+        if (cacheFilePath && !saveCompressedImageCache(cacheFilePath, key, bcFormat, width, height, compressedData))
+            vlrprintf("Failed to write the compressed image cache: %s\n", cacheFilePath);
+
+        return new BlockCompressedImage2D(m_context, std::move(compressedData), width, height, bcFormat, keepsGamma);
     }
 
-    void* LinearImage2D::createLinearImageData() const {
-        uint8_t* ret = new uint8_t[m_data.size()];
-        std::copy(m_data.cbegin(), m_data.cend(), ret);
-        return ret;
+    bool LinearImage2D::writeTiledImage(const char* filePath, uint32_t tileSize) const {
+        std::vector<const uint8_t*> levels;
+        levels.push_back(m_data);
+        for (const auto &mipData : m_mipData)
+            levels.push_back(mipData.data());
+
+        return writeTiledImageFile(filePath, getDataFormat(), needsDegamma(), getWidth(), getHeight(), tileSize,
+                                   levels.data(), (uint32_t)levels.size());
     }
 
-    optix::Buffer LinearImage2D::getOptiXObject() const {
-        optix::Buffer buffer = Image2D::getOptiXObject();
+    Backend::Buffer LinearImage2D::getOptiXObject() const {
+        Backend::Buffer buffer = Image2D::getOptiXObject();
         if (!m_copyDone) {
+            uint32_t mipCount = 1 + (uint32_t)m_mipData.size();
+            buffer->setMipLevelCount(mipCount);
+
             auto dstData = (uint8_t*)buffer->map(0, RT_BUFFER_MAP_WRITE_DISCARD);
-            std::copy(m_data.cbegin(), m_data.cend(), dstData);
-            buffer->unmap();
+            std::copy_n(m_data, getStride() * getWidth() * getHeight(), dstData);
+            for (uint32_t mipLevel = 1; mipLevel < mipCount; ++mipLevel) {
+                const auto &mipData = m_mipData[mipLevel - 1];
+                dstData = (uint8_t*)buffer->map(mipLevel, RT_BUFFER_MAP_WRITE_DISCARD);
+                std::copy(mipData.cbegin(), mipData.cend(), dstData);
+            }
+
+            for (int32_t mipLevel = mipCount - 1; mipLevel >= 0; --mipLevel)
+                buffer->unmap(mipLevel);
+
             m_copyDone = true;
         }
         return buffer;
@@ -491,28 +897,86 @@ namespace VLR {
         }
     }
 
-    Image2D* BlockCompressedImage2D::createShrinkedImage2D(uint32_t width, uint32_t height) const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+    BlockCompressedImage2D::BlockCompressedImage2D(Context &context, std::vector<std::vector<uint8_t>> &&data, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma) :
+        Image2D(context, width, height, Image2D::getInternalFormat(dataFormat), applyDegamma), m_data(std::move(data)), m_copyDone(false) {
+        VLRAssert(dataFormat >= VLRDataFormat_BC1 && dataFormat <= VLRDataFormat_BC7, "Specified data format is not block compressed format.");
+    }
+
+    ImageCache::Key BlockCompressedImage2D::createImageCacheKey() const {
+        std::vector<const uint8_t*> data(m_data.size());
+        std::vector<size_t> sizes(m_data.size());
+        for (uint32_t mipLevel = 0; mipLevel < m_data.size(); ++mipLevel) {
+            data[mipLevel] = m_data[mipLevel].data();
+            sizes[mipLevel] = m_data[mipLevel].size();
+        }
+        return ImageCache::createBlockCompressedImageKey(data.data(), sizes.data(), (uint32_t)m_data.size(), getWidth(), getHeight(),
+                                                         getDataFormat(), needsDegamma());
+    }
+
+    size_t BlockCompressedImage2D::getDataSize() const {
+        size_t size = 0;
+        for (const auto &levelData : m_data)
+            size += levelData.size();
+        return size;
+    }
+
+    bool BlockCompressedImage2D::hasSameData(const Image2D* image) const {
+        if (!image->is<BlockCompressedImage2D>())
+            return false;
+        auto bcImage = (const BlockCompressedImage2D*)image;
+        return (bcImage->getWidth() == getWidth() && bcImage->getHeight() == getHeight() &&
+                bcImage->getDataFormat() == getDataFormat() && bcImage->needsDegamma() == needsDegamma() &&
+                bcImage->m_data == m_data);
+    }
+
+    LinearImage2D* BlockCompressedImage2D::createDecompressedImage2D() const {
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        VLRDataFormat decompressedFormat = getDecompressedFormat(getDataFormat());
+        std::vector<uint8_t> data;
+        data.resize(sizesOfDataFormats[decompressedFormat] * width * height);
+        decompressBlocks(m_data[0].data(), getDataFormat(), width, height, data.data());
+
+        return new LinearImage2D(m_context, std::move(data), width, height, decompressedFormat, needsDegamma());
+    }
+
+    Image2D* BlockCompressedImage2D::createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const {
+        LinearImage2D* decompressedImage = createDecompressedImage2D();
+        Image2D* ret = decompressedImage->createShrinkedImage2D(width, height, filter);
+        delete decompressedImage;
+        return ret;
     }
 
     Image2D* BlockCompressedImage2D::createLuminanceImage2D() const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+        LinearImage2D* decompressedImage = createDecompressedImage2D();
+        Image2D* ret = decompressedImage->createLuminanceImage2D();
+        delete decompressedImage;
+        return ret;
     }
 
     void* BlockCompressedImage2D::createLinearImageData() const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+        LinearImage2D* decompressedImage = createDecompressedImage2D();
+        void* ret = decompressedImage->createLinearImageData();
+        delete decompressedImage;
+        return ret;
+    }
+
+    bool BlockCompressedImage2D::generateMipmaps(VLRMipmapFilter filter) {
+        return false;
     }
 
-    optix::Buffer BlockCompressedImage2D::getOptiXObject() const {
-        optix::Buffer buffer = Image2D::getOptiXObject();
+    Backend::Buffer BlockCompressedImage2D::getOptiXObject() const {
+        Backend::Buffer buffer = Image2D::getOptiXObject();
         if (!m_copyDone) {
             // JP: OptiXのBCブロックカウントの計算がおかしいらしく。
             //     非2のべき乗テクスチャーだとサイズがずれる。
             //     要問い合わせ。
-            int32_t mipCount = 1;// m_data.size();
+            //     2のべき乗の場合は読み込んだミップマップをすべて使う。
+            // EN: OptiX seems to compute BC block counts incorrectly,
+            //     so sizes mismatch for non-power-of-two textures.
+            //     All loaded mipmaps are used for power-of-two sizes.
+            bool isPowerOf2 = (getWidth() & (getWidth() - 1)) == 0 && (getHeight() & (getHeight() - 1)) == 0;
+            int32_t mipCount = isPowerOf2 ? (int32_t)m_data.size() : 1;
 
             buffer->setMipLevelCount(mipCount);
             auto dstData = new uint8_t*[mipCount];
@@ -553,13 +1017,11 @@ namespace VLR {
 
     // static 
     void ShaderNode::commonInitializeProcedure(Context &context, const char** identifiers, uint32_t numIDs, OptiXProgramSet* programSet) {
-        std::string ptx = readTxtFile(VLR_PTX_DIR"shader_nodes.ptx");
-
-        optix::Context optixContext = context.getOptiXContext();
+        std::string ptx = context.readPTX("shader_nodes.ptx");
 
         Shared::NodeProcedureSet nodeProcSet;
         for (int i = 0; i < numIDs; ++i) {
-            programSet->callablePrograms[i] = optixContext->createProgramFromPTXString(ptx, identifiers[i]);
+            programSet->callablePrograms[i] = context.createProgramFromPTXString(ptx, identifiers[i]);
             nodeProcSet.progs[i] = programSet->callablePrograms[i]->getId();
         }
 
@@ -1103,10 +1565,10 @@ namespace VLR {
     void TripletSpectrumShaderNode::setupNodeDescriptor() const {
         OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
-        Shared::SpectrumNodeDescriptor nodeDesc;
+        Shared::HostSpectrumNodeDescriptor nodeDesc;
         nodeDesc.procSetIndex = progSet.nodeProcedureSetIndex;
         auto &nodeData = *nodeDesc.getData<Shared::TripletSpectrumShaderNode>();
-        nodeData.value = createTripletSpectrum(m_spectrumType, m_colorSpace, m_immE0, m_immE1, m_immE2);
+        nodeData.value = createTripletSpectrumData(m_context.getRenderingMode(), m_spectrumType, m_colorSpace, m_immE0, m_immE1, m_immE2);
 
         m_context.updateSpectrumNodeDescriptor(m_nodeIndex, nodeDesc);
     }
@@ -1164,23 +1626,25 @@ namespace VLR {
     void RegularSampledSpectrumShaderNode::setupNodeDescriptor() const {
         OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
-        Shared::SpectrumNodeDescriptor nodeDesc;
+        Shared::HostSpectrumNodeDescriptor nodeDesc;
         nodeDesc.procSetIndex = progSet.nodeProcedureSetIndex;
-        auto &nodeData = *nodeDesc.getData<Shared::RegularSampledSpectrumShaderNode>();
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-        VLRAssert(m_numSamples <= lengthof(nodeData.values), "Number of sample points must not be greater than %u.", lengthof(nodeData.values));
-        nodeData.minLambda = m_minLambda;
-        nodeData.maxLambda = m_maxLambda;
-        std::copy_n(m_values, m_numSamples, nodeData.values);
-        nodeData.numSamples = m_numSamples;
-#else
-        RegularSampledSpectrum spectrum(m_minLambda, m_maxLambda, m_values, m_numSamples);
-        float XYZ[3];
-        spectrum.toXYZ(XYZ);
-        float RGB[3];
-        transformToRenderingRGB(m_spectrumType, XYZ, RGB);
-        nodeData.value = RGBSpectrum(std::fmax(0.0f, RGB[0]), std::fmax(0.0f, RGB[1]), std::fmax(0.0f, RGB[2]));
-#endif
+        if (m_context.getRenderingMode() == VLRRenderingMode_Spectral) {
+            auto &nodeData = *nodeDesc.getData<Shared::RegularSampledSpectrumShaderNode>();
+            VLRAssert(m_numSamples <= lengthof(nodeData.values), "Number of sample points must not be greater than %u.", lengthof(nodeData.values));
+            nodeData.minLambda = m_minLambda;
+            nodeData.maxLambda = m_maxLambda;
+            std::copy_n(m_values, m_numSamples, nodeData.values);
+            nodeData.numSamples = m_numSamples;
+        }
+        else {
+            auto &nodeData = *nodeDesc.getData<Shared::PreconvertedRGBSpectrumShaderNode>();
+            RegularSampledSpectrum spectrum(m_minLambda, m_maxLambda, m_values, m_numSamples);
+            float XYZ[3];
+            spectrum.toXYZ(XYZ);
+            float RGB[3];
+            transformToRenderingRGB(m_spectrumType, XYZ, RGB);
+            nodeData.value = RGBSpectrum(std::fmax(0.0f, RGB[0]), std::fmax(0.0f, RGB[1]), std::fmax(0.0f, RGB[2]));
+        }
 
         m_context.updateSpectrumNodeDescriptor(m_nodeIndex, nodeDesc);
     }
@@ -1238,22 +1702,24 @@ namespace VLR {
     void IrregularSampledSpectrumShaderNode::setupNodeDescriptor() const {
         OptiXProgramSet &progSet = OptiXProgramSets.at(m_context.getID());
 
-        Shared::SpectrumNodeDescriptor nodeDesc;
+        Shared::HostSpectrumNodeDescriptor nodeDesc;
         nodeDesc.procSetIndex = progSet.nodeProcedureSetIndex;
-        auto &nodeData = *nodeDesc.getData<Shared::IrregularSampledSpectrumShaderNode>();
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-        VLRAssert(m_numSamples <= lengthof(nodeData.values), "Number of sample points must not be greater than %u.", lengthof(nodeData.values));
-        std::copy_n(m_lambdas, m_numSamples, nodeData.lambdas);
-        std::copy_n(m_values, m_numSamples, nodeData.values);
-        nodeData.numSamples = m_numSamples;
-#else
-        IrregularSampledSpectrum spectrum(m_lambdas, m_values, m_numSamples);
-        float XYZ[3];
-        spectrum.toXYZ(XYZ);
-        float RGB[3];
-        transformToRenderingRGB(m_spectrumType, XYZ, RGB);
-        nodeData.value = RGBSpectrum(std::fmax(0.0f, RGB[0]), std::fmax(0.0f, RGB[1]), std::fmax(0.0f, RGB[2]));
-#endif
+        if (m_context.getRenderingMode() == VLRRenderingMode_Spectral) {
+            auto &nodeData = *nodeDesc.getData<Shared::IrregularSampledSpectrumShaderNode>();
+            VLRAssert(m_numSamples <= lengthof(nodeData.values), "Number of sample points must not be greater than %u.", lengthof(nodeData.values));
+            std::copy_n(m_lambdas, m_numSamples, nodeData.lambdas);
+            std::copy_n(m_values, m_numSamples, nodeData.values);
+            nodeData.numSamples = m_numSamples;
+        }
+        else {
+            auto &nodeData = *nodeDesc.getData<Shared::PreconvertedRGBSpectrumShaderNode>();
+            IrregularSampledSpectrum spectrum(m_lambdas, m_values, m_numSamples);
+            float XYZ[3];
+            spectrum.toXYZ(XYZ);
+            float RGB[3];
+            transformToRenderingRGB(m_spectrumType, XYZ, RGB);
+            nodeData.value = RGBSpectrum(std::fmax(0.0f, RGB[0]), std::fmax(0.0f, RGB[1]), std::fmax(0.0f, RGB[2]));
+        }
 
         m_context.updateSpectrumNodeDescriptor(m_nodeIndex, nodeDesc);
     }
@@ -1417,7 +1883,7 @@ namespace VLR {
 
     Image2DTextureShaderNode::Image2DTextureShaderNode(Context &context) :
         ShaderNode(context), m_image(nullptr), m_spectrumType(VLRSpectrumType_Reflectance), m_colorSpace(VLRColorSpace_Rec709_D65) {
-        optix::Context optixContext = context.getOptiXContext();
+        Backend::Context optixContext = context.getOptiXContext();
         m_optixTextureSampler = optixContext->createTextureSampler();
         m_optixTextureSampler->setBuffer(NullImages.at(m_context.getID())->getOptiXObject());
         m_optixTextureSampler->setWrapMode(0, RT_WRAP_REPEAT);
@@ -1445,6 +1911,8 @@ namespace VLR {
         nodeData.spectrumType = m_spectrumType;
         nodeData.colorSpace = m_colorSpace;
         nodeData.nodeTexCoord = m_nodeTexCoord.getSharedType();
+        nodeData.width = m_image ? m_image->getWidth() : 1;
+        nodeData.height = m_image ? m_image->getHeight() : 1;
 
         m_context.updateNodeDescriptor(m_nodeIndex, nodeDesc);
     }
@@ -1504,7 +1972,7 @@ namespace VLR {
 
     EnvironmentTextureShaderNode::EnvironmentTextureShaderNode(Context &context) :
         ShaderNode(context), m_image(nullptr), m_colorSpace(VLRColorSpace_Rec709_D65) {
-        optix::Context optixContext = context.getOptiXContext();
+        Backend::Context optixContext = context.getOptiXContext();
         m_optixTextureSampler = optixContext->createTextureSampler();
         m_optixTextureSampler->setWrapMode(0, RT_WRAP_REPEAT);
         m_optixTextureSampler->setWrapMode(1, RT_WRAP_REPEAT);
@@ -1529,6 +1997,8 @@ namespace VLR {
         nodeData.textureID = m_optixTextureSampler->getId();
         nodeData.colorSpace = m_colorSpace;
         nodeData.nodeTexCoord = m_nodeTexCoord.getSharedType();
+        nodeData.width = m_image ? m_image->getWidth() : 1;
+        nodeData.height = m_image ? m_image->getHeight() : 1;
 
         m_context.updateNodeDescriptor(m_nodeIndex, nodeDesc);
     }
@@ -1560,7 +2030,7 @@ namespace VLR {
     void EnvironmentTextureShaderNode::createImportanceMap(RegularConstantContinuousDistribution2D* importanceMap) const {
         uint32_t mapWidth = m_image->getWidth() / 4;
         uint32_t mapHeight = m_image->getHeight() / 4;
-        Image2D* shrinkedImage = m_image->createShrinkedImage2D(mapWidth, mapHeight);
+        Image2D* shrinkedImage = m_image->createShrinkedImage2D(mapWidth, mapHeight, VLRMipmapFilter_Box);
         Image2D* shrinkedYImage = shrinkedImage->createLuminanceImage2D();
         delete shrinkedImage;
         float* linearData = (float*)shrinkedYImage->createLinearImageData();
@@ -12,6 +12,7 @@ namespace VLR {
     struct Gray32F { float v; };
     struct Gray8 { uint8_t v; };
     struct GrayA8x2 { uint8_t v; uint8_t a; };
+    struct uvsA16Fx4 { half u, v, s, a; };
 
     extern const size_t sizesOfDataFormats[(uint32_t)VLRDataFormat::NumVLRDataFormats];
 
@@ -20,7 +21,7 @@ namespace VLR {
         VLRDataFormat m_originalDataFormat;
         VLRDataFormat m_dataFormat;
         bool m_needsDegamma;
-        mutable optix::Buffer m_optixDataBuffer;
+        mutable Backend::Buffer m_optixDataBuffer;
         mutable bool m_initOptiXObject;
 
     public:
@@ -28,13 +29,19 @@ namespace VLR {
         virtual const ClassIdentifier &getClass() const { return ClassID; }
 
         static VLRDataFormat getInternalFormat(VLRDataFormat inputFormat);
+        // JP: ブロック圧縮でない内部形式に対応するOptiXのバッファー形式。
+        // EN: OptiX buffer format corresponding to an internal format that is not block-compressed.
+        static RTformat getOptiXFormat(VLRDataFormat dataFormat);
 
         Image2D(Context &context, uint32_t width, uint32_t height, VLRDataFormat originalDataFormat, bool applyDegamma);
         virtual ~Image2D();
 
-        virtual Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const = 0;
+        // JP: 線形な値に対してフィルターをかけて縮小した、同じ形式の画像を作る。Boxは面積平均、Lanczos、Kaiserは高周波を抑えつつ鮮鋭さを保つ。
+        // EN: Create an image of the same format shrunk by filtering linear values. Box is the area average, and Lanczos and Kaiser suppress high frequencies while keeping sharpness.
+        virtual Image2D* createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const = 0;
         virtual Image2D* createLuminanceImage2D() const = 0;
         virtual void* createLinearImageData() const = 0;
+        virtual bool generateMipmaps(VLRMipmapFilter filter) = 0;
 
         uint32_t getWidth() const {
             return m_width;
@@ -56,57 +63,152 @@ namespace VLR {
                     m_dataFormat == VLRDataFormat_BC1 ||
                     m_dataFormat == VLRDataFormat_BC2 ||
                     m_dataFormat == VLRDataFormat_BC3 ||
-                    m_dataFormat == VLRDataFormat_BC7);
+                    m_dataFormat == VLRDataFormat_BC7 ||
+                    m_dataFormat == VLRDataFormat_uvsA16Fx4);
         }
         bool needsDegamma() const {
             return m_needsDegamma;
         }
 
-        virtual optix::Buffer getOptiXObject() const;
+        virtual Backend::Buffer getOptiXObject() const;
     };
 
 
 
+    class BlockCompressedImage2D;
+
     class LinearImage2D : public Image2D {
-        std::vector<uint8_t> m_data;
+        // JP: m_dataは自前のm_ownedDataか、呼び出し側から引き取ったデータを指す。
+        //     引き取ったデータは破棄時にm_releaseCallbackで呼び出し側に返す。
+        // EN: m_data points to either m_ownedData or data adopted from the caller.
+        //     Adopted data is returned to the caller with m_releaseCallback on destruction.
+        std::vector<uint8_t> m_ownedData;
+        const uint8_t* m_data;
+        VLRImageDataReleaseCallback m_releaseCallback;
+        void* m_releaseUserData;
+        // JP: レベル1以降のミップマップ。
+        // EN: Mipmaps of the level 1 and later.
+        std::vector<std::vector<uint8_t>> m_mipData;
         mutable bool m_copyDone;
 
+        void convert(const uint8_t* linearData, VLRDataFormat dataFormat, bool applyDegamma);
+
     public:
         static const ClassIdentifier ClassID;
         virtual const ClassIdentifier &getClass() const { return ClassID; }
 
+        // JP: 内部形式への変換もホストでのデガンマも不要で、入力をそのまま保持できるか。
+        // EN: Whether the input can be held as is, needing neither conversion to the internal format nor degamma on the host.
+        static bool canAdoptData(VLRDataFormat dataFormat, bool applyDegamma);
+
         // EN: "linearData" means data layout is linear, it doesn't mean gamma curve.
         LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma);
+        // JP: canAdoptData()が真の場合はlinearDataをコピーせずに参照し、破棄時にreleaseCallbackを呼ぶ。
+        //     そうでない場合は変換したデータを保持し、コンストラクター内でreleaseCallbackを呼ぶ。
+        // EN: If canAdoptData() is true, this references linearData without copying and calls releaseCallback on destruction.
+        //     Otherwise, this holds the converted data and calls releaseCallback in the constructor.
+        LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma,
+                      VLRImageDataReleaseCallback releaseCallback, void* userData);
+        // JP: ライブラリ内部で作った内部形式のデータを引き取る。applyDegammaはデータ自体には適用せず、テクスチャーユニットでのデガンマの指定にだけ使う。
+        // EN: Take over data in the internal format created inside the library. applyDegamma is not applied to the data itself but only specifies degamma by the texture unit.
+        LinearImage2D(Context &context, std::vector<uint8_t> &&data, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma = false);
+        ~LinearImage2D();
+
+        // JP: 画像キャッシュのキーと画素データの大きさ。内部形式の画素データから求める。
+        // EN: Key for the image cache and the size of the pixel data. Computed from the pixel data in the internal format.
+        ImageCache::Key createImageCacheKey() const;
+        size_t getDataSize() const;
+        // JP: 画像キャッシュで共有する前に、画素データ全体が一致するかを比べる。
+        // EN: Compare whether the whole pixel data matches before sharing through the image cache.
+        bool hasSameData(const Image2D* image) const;
 
         template <typename PixelType>
         PixelType get(uint32_t x, uint32_t y) const {
-            return *(PixelType*)(m_data.data() + (y * getWidth() + x) * getStride());
+            return *(PixelType*)(m_data + (y * getWidth() + x) * getStride());
         }
 
-        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const override;
+        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const override;
         Image2D* createLuminanceImage2D() const override;
         void* createLinearImageData() const override;
-
-        optix::Buffer getOptiXObject() const override;
+        bool generateMipmaps(VLRMipmapFilter filter) override;
+
+        // JP: 各ピクセルをアップサンプルしたスペクトルの係数に変換した画像(uvsA16Fx4)を作る。
+        //     テクスチャーの参照ごとにUpsampledSpectrumを構築する処理を省ける。
+        // EN: Create an image (uvsA16Fx4) by converting each pixel into the coefficients of the upsampled spectrum.
+        //     This saves constructing UpsampledSpectrum for every texture fetch.
+        LinearImage2D* createUpsampledSpectrumImage2D(VLRSpectrumType spectrumType, VLRColorSpace colorSpace) const;
+
+        // JP: ミップチェーン全体をブロック圧縮した画像を作る。対応する形式はBC1, BC3, BC4, BC5, BC7で、それ以外にはnullptrを返す。
+        //     generateMipmaps()で作ったレベルがあればそれを、無ければボックスフィルターで縮小したレベルを圧縮する。
+        //     cacheFilePathを指定した場合、画像の内容と圧縮の設定から求めたキーが一致するキャッシュがあれば読み込み、無ければ圧縮結果を書き出す。
+        // EN: Create an image by block-compressing the whole mip chain. Supported formats are BC1, BC3, BC4, BC5 and BC7, and nullptr is returned for the others.
+        //     This compresses levels made by generateMipmaps() if any, otherwise levels shrunk with the box filter.
+        //     If cacheFilePath is specified, this loads the cache if its key computed from the image content and the compression settings matches, otherwise writes the compressed result.
+        BlockCompressedImage2D* createBlockCompressedImage2D(VLRDataFormat bcFormat, const char* cacheFilePath) const;
+
+        // JP: レベル0とgenerateMipmaps()で作ったレベルを、TiledImage2Dで読めるタイル化画像のファイルに書き出す。
+        // EN: Write the level 0 and levels made by generateMipmaps() to a tiled image file readable by TiledImage2D.
+        bool writeTiledImage(const char* filePath, uint32_t tileSize) const;
+
+        Backend::Buffer getOptiXObject() const override;
     };
 
 
 
+    // JP: shader_nodes_avx2.cppで定義されるAVX2版の変換。AVX2が使える場合のみ呼ぶ。
+    //     ブロック単位で先頭から処理し、処理したピクセル(または値)の数を返す。残りは呼び出し側がスカラーで処理する。
+    // EN: AVX2 conversions defined in shader_nodes_avx2.cpp. Call only when AVX2 is available.
+    //     These process from the head in blocks and return the number of processed pixels (or values). The caller processes the rest in scalar.
+    namespace AVX2 {
+        uint32_t convertToUpsampledSpectrum(const uint8_t* srcRow, VLRDataFormat srcFormat, const float degammaTable[256], const float matToXYZ[9],
+                                            uint32_t numPixels, uvsA16Fx4* dstRow);
+
+        uint32_t convertRGB8x3ToRGBA8x4(const RGB8x3* srcRow, uint32_t numPixels, RGBA8x4* dstRow);
+        uint32_t convertRGB_8x4ToRGBA8x4(const RGB_8x4* srcRow, uint32_t numPixels, RGBA8x4* dstRow);
+        // JP: アルファ以外の成分にsRGBのデガンマを適用する。powfの代わりに多項式近似を使う(相対誤差は入力が100まで1e-6未満、halfの最大値まで3e-6未満)。
+        // EN: Apply sRGB degamma to components other than alpha. This uses a polynomial approximation instead of powf (relative error below 1e-6 for inputs up to 100, below 3e-6 up to the maximum of half).
+        uint32_t applyDegamma(const RGBA16Fx4* srcRow, uint32_t numPixels, RGBA16Fx4* dstRow);
+        uint32_t applyDegamma(const RGBA32Fx4* srcRow, uint32_t numPixels, RGBA32Fx4* dstRow);
+        // JP: 全成分にデガンマを適用する。RG32Fx2とGray32Fに使う。
+        // EN: Apply degamma to all components. This is used for RG32Fx2 and Gray32F.
+        uint32_t applyDegamma(const float* srcValues, uint32_t numValues, float* dstValues);
+
+        uint32_t convertHalfToFloat(const half* srcValues, uint32_t numValues, float* dstValues);
+    }
+
+
+
     class BlockCompressedImage2D : public Image2D {
         std::vector<std::vector<uint8_t>> m_data;
         mutable bool m_copyDone;
 
+        // JP: レベル0をCPUで展開したLinearImage2Dを作る。縮小、輝度、線形データの出力はこれに委ねる。
+        // EN: Create a LinearImage2D by decompressing the level 0 on the CPU. Shrinking, luminance and linear data export are delegated to it.
+        LinearImage2D* createDecompressedImage2D() const;
+
     public:
         static const ClassIdentifier ClassID;
         virtual const ClassIdentifier &getClass() const { return ClassID; }
 
         BlockCompressedImage2D(Context &context, const uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma);
-
-        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const override;
+        // JP: ライブラリ内部で圧縮したミップチェーンを引き取る。
+        // EN: Take over a mip chain compressed inside the library.
+        BlockCompressedImage2D(Context &context, std::vector<std::vector<uint8_t>> &&data, uint32_t width, uint32_t height, VLRDataFormat dataFormat, bool applyDegamma);
+
+        // JP: 画像キャッシュのキーと画素データの大きさ。内部形式の画素データから求める。
+        // EN: Key for the image cache and the size of the pixel data. Computed from the pixel data in the internal format.
+        ImageCache::Key createImageCacheKey() const;
+        size_t getDataSize() const;
+        // JP: 画像キャッシュで共有する前に、画素データ全体が一致するかを比べる。
+        // EN: Compare whether the whole pixel data matches before sharing through the image cache.
+        bool hasSameData(const Image2D* image) const;
+
+        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const override;
         Image2D* createLuminanceImage2D() const override;
         void* createLinearImageData() const override;
+        bool generateMipmaps(VLRMipmapFilter filter) override;
 
-        optix::Buffer getOptiXObject() const override;
+        Backend::Buffer getOptiXObject() const override;
     };
 
 
@@ -157,7 +259,7 @@ namespace VLR {
     class ShaderNode : public Object {
     protected:
         struct OptiXProgramSet {
-            optix::Program callablePrograms[16];
+            Backend::Program callablePrograms[16];
             uint32_t nodeProcedureSetIndex;
         };
 
@@ -602,7 +704,7 @@ namespace VLR {
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
         static std::map<uint32_t, LinearImage2D*> NullImages;
 
-        optix::TextureSampler m_optixTextureSampler;
+        Backend::TextureSampler m_optixTextureSampler;
         VLRSpectrumType m_spectrumType;
         VLRColorSpace m_colorSpace;
         const Image2D* m_image;
@@ -651,7 +753,7 @@ namespace VLR {
     class EnvironmentTextureShaderNode : public ShaderNode {
         static std::map<uint32_t, OptiXProgramSet> OptiXProgramSets;
 
-        optix::TextureSampler m_optixTextureSampler;
+        Backend::TextureSampler m_optixTextureSampler;
         VLRColorSpace m_colorSpace;
         const Image2D* m_image;
         ShaderNodeSocketIdentifier m_nodeTexCoord;
@@ -0,0 +1,236 @@
+﻿#include "shader_nodes.h"
+
+// JP: このファイルはAVX2を有効にしてコンパイルする(MSVCでは/arch:AVX2)。
+//     呼び出し側は実行時にisAVX2Available()で確認してからここの関数を呼ぶ。halfを扱う関数はisF16CAvailable()も確認する。
+// EN: This file is compiled with AVX2 enabled (/arch:AVX2 on MSVC).
+//     The caller checks isAVX2Available() at runtime before calling the functions here.
+//     Functions handling half also require isF16CAvailable().
+#if !defined(__AVX2__)
+#   error "shader_nodes_avx2.cpp must be compiled with AVX2 enabled."
+#endif
+
+#include <immintrin.h>
+
+namespace VLR {
+    namespace AVX2 {
+        // JP: 各128ビットレーン内で4x4の転置を行う。2回適用すると元に戻る。
+        // EN: Transpose 4x4 within each 128-bit lane. Applying this twice restores the original.
+        static inline void transpose4x4(__m256 &v0, __m256 &v1, __m256 &v2, __m256 &v3) {
+            __m256 t0 = _mm256_unpacklo_ps(v0, v1);
+            __m256 t1 = _mm256_unpackhi_ps(v0, v1);
+            __m256 t2 = _mm256_unpacklo_ps(v2, v3);
+            __m256 t3 = _mm256_unpackhi_ps(v2, v3);
+            v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+            v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+
+        uint32_t convertToUpsampledSpectrum(const uint8_t* srcRow, VLRDataFormat srcFormat, const float degammaTable[256], const float matToXYZ[9],
+                                            uint32_t numPixels, uvsA16Fx4* dstRow) {
+            __m256 mat[9];
+            for (int i = 0; i < 9; ++i)
+                mat[i] = _mm256_set1_ps(matToXYZ[i]);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 defaultXY = _mm256_set1_ps(0.3333f);
+            const __m256 sScale = _mm256_set1_ps((float)(UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR / UpsampledSpectrum::EqualEnergyReflectance()));
+            const __m256 maxByte = _mm256_set1_ps(255.0f);
+            // JP: UpsampledSpectrum::xy_to_uv()の係数。
+            // EN: Coefficients of UpsampledSpectrum::xy_to_uv().
+            const __m256 uvCoeffs[6] = {
+                _mm256_set1_ps(16.730260708356887f), _mm256_set1_ps(7.7801960340706f), _mm256_set1_ps(-2.170152247475828f),
+                _mm256_set1_ps(-7.530081094743006f), _mm256_set1_ps(16.192422314095225f), _mm256_set1_ps(1.1125529268825947f)
+            };
+
+            uint32_t numBlocks = numPixels / 8;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                // JP: 2ピクセルずつ4本のレジスターに読み込み、転置してR, G, B, Aに分ける。
+                // EN: Load 2 pixels into each of 4 registers, then transpose them into R, G, B and A.
+                __m256 v[4];
+                switch (srcFormat) {
+                case VLRDataFormat_RGBA8x4: {
+                    const uint8_t* src = srcRow + sizeof(RGBA8x4) * 8 * blockIdx;
+                    for (int i = 0; i < 4; ++i) {
+                        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + 8 * i)));
+                        __m256 color = _mm256_i32gather_ps(degammaTable, indices, sizeof(float));
+                        __m256 alpha = _mm256_div_ps(_mm256_cvtepi32_ps(indices), maxByte);
+                        v[i] = _mm256_blend_ps(color, alpha, 0x88);
+                    }
+                    break;
+                }
+                case VLRDataFormat_RGBA16Fx4: {
+                    const uint8_t* src = srcRow + sizeof(RGBA16Fx4) * 8 * blockIdx;
+                    for (int i = 0; i < 4; ++i)
+                        v[i] = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + 16 * i)));
+                    break;
+                }
+                case VLRDataFormat_RGBA32Fx4: {
+                    const uint8_t* src = srcRow + sizeof(RGBA32Fx4) * 8 * blockIdx;
+                    for (int i = 0; i < 4; ++i)
+                        v[i] = _mm256_loadu_ps((const float*)(src + 32 * i));
+                    break;
+                }
+                default:
+                    VLRAssert_ShouldNotBeCalled();
+                    return 0;
+                }
+                transpose4x4(v[0], v[1], v[2], v[3]);
+
+                __m256 X = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mat[0], v[0]), _mm256_mul_ps(mat[3], v[1])), _mm256_mul_ps(mat[6], v[2]));
+                __m256 Y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mat[1], v[0]), _mm256_mul_ps(mat[4], v[1])), _mm256_mul_ps(mat[7], v[2]));
+                __m256 Z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mat[2], v[0]), _mm256_mul_ps(mat[5], v[1])), _mm256_mul_ps(mat[8], v[2]));
+
+                __m256 sum = _mm256_add_ps(_mm256_add_ps(X, Y), Z);
+                __m256 x = _mm256_div_ps(X, sum);
+                __m256 y = _mm256_div_ps(Y, sum);
+                __m256 brightness = _mm256_div_ps(Y, y);
+                __m256 isBlack = _mm256_cmp_ps(Y, zero, _CMP_EQ_OQ);
+                x = _mm256_blendv_ps(x, defaultXY, isBlack);
+                y = _mm256_blendv_ps(y, defaultXY, isBlack);
+                brightness = _mm256_blendv_ps(brightness, zero, isBlack);
+
+                v[0] = _mm256_fmadd_ps(uvCoeffs[0], x, _mm256_fmadd_ps(uvCoeffs[1], y, uvCoeffs[2]));
+                v[1] = _mm256_fmadd_ps(uvCoeffs[3], x, _mm256_fmadd_ps(uvCoeffs[4], y, uvCoeffs[5]));
+                v[2] = _mm256_mul_ps(brightness, sScale);
+
+                transpose4x4(v[0], v[1], v[2], v[3]);
+                uvsA16Fx4* dst = dstRow + 8 * blockIdx;
+                for (int i = 0; i < 4; ++i)
+                    _mm_storeu_si128((__m128i*)(dst + 2 * i), _mm256_cvtps_ph(v[i], _MM_FROUND_TO_NEAREST_INT));
+            }
+
+            return 8 * numBlocks;
+        }
+
+
+
+        uint32_t convertRGB8x3ToRGBA8x4(const RGB8x3* srcRow, uint32_t numPixels, RGBA8x4* dstRow) {
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+            // JP: 16ピクセル(48バイト)を3回で読み込み、12バイトずつ4ピクセルに展開する。
+            // EN: Load 16 pixels (48 bytes) in 3 loads, then expand each 12 bytes into 4 pixels.
+            uint32_t numBlocks = numPixels / 16;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                auto src = (const __m128i*)(srcRow + 16 * blockIdx);
+                auto dst = (__m128i*)(dstRow + 16 * blockIdx);
+                __m128i v0 = _mm_loadu_si128(src + 0);
+                __m128i v1 = _mm_loadu_si128(src + 1);
+                __m128i v2 = _mm_loadu_si128(src + 2);
+                _mm_storeu_si128(dst + 0, _mm_or_si128(_mm_shuffle_epi8(v0, shuffle), alpha));
+                _mm_storeu_si128(dst + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(v1, v0, 12), shuffle), alpha));
+                _mm_storeu_si128(dst + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(v2, v1, 8), shuffle), alpha));
+                _mm_storeu_si128(dst + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v2, 4), shuffle), alpha));
+            }
+
+            return 16 * numBlocks;
+        }
+
+        uint32_t convertRGB_8x4ToRGBA8x4(const RGB_8x4* srcRow, uint32_t numPixels, RGBA8x4* dstRow) {
+            const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+
+            uint32_t numBlocks = numPixels / 8;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(srcRow + 8 * blockIdx));
+                _mm256_storeu_si256((__m256i*)(dstRow + 8 * blockIdx), _mm256_or_si256(v, alpha));
+            }
+
+            return 8 * numBlocks;
+        }
+
+
+
+        // JP: sRGB_degamma()のベクトル版。pow(t, 2.4)をexp2(2.4 * log2(t))として多項式で評価する。
+        //     log2は仮数を[1/√2, √2)に寄せてatanhの級数、exp2は丸めた整数部を指数に足し、端数部をテイラー展開で求める。
+        // EN: Vector version of sRGB_degamma(). This evaluates pow(t, 2.4) as exp2(2.4 * log2(t)) with polynomials.
+        //     log2 brings the mantissa into [1/sqrt(2), sqrt(2)) and uses the atanh series, and exp2 adds the rounded integer part to the exponent
+        //     and computes the fractional part with the Taylor expansion.
+        static inline __m256 sRGB_degamma(__m256 value) {
+            const __m256 one = _mm256_set1_ps(1.0f);
+
+            __m256 t = _mm256_div_ps(_mm256_add_ps(value, _mm256_set1_ps(0.055f)), _mm256_set1_ps(1.055f));
+
+            __m256i bits = _mm256_castps_si256(t);
+            __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+            __m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                                                  _mm256_castps_si256(one)));
+            __m256 isLarge = _mm256_cmp_ps(mantissa, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+            mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), isLarge);
+            exponent = _mm256_sub_epi32(exponent, _mm256_castps_si256(isLarge));
+
+            // log2(m) = 2 / ln(2) * (s + s^3 / 3 + s^5 / 5 + ...), s = (m - 1) / (m + 1)
+            __m256 s = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+            __m256 s2 = _mm256_mul_ps(s, s);
+            __m256 logPoly = _mm256_set1_ps(0.32059889f);
+            logPoly = _mm256_fmadd_ps(logPoly, s2, _mm256_set1_ps(0.41219858f));
+            logPoly = _mm256_fmadd_ps(logPoly, s2, _mm256_set1_ps(0.57707802f));
+            logPoly = _mm256_fmadd_ps(logPoly, s2, _mm256_set1_ps(0.96179670f));
+            logPoly = _mm256_fmadd_ps(logPoly, s2, _mm256_set1_ps(2.88539008f));
+            __m256 log2t = _mm256_fmadd_ps(logPoly, s, _mm256_cvtepi32_ps(exponent));
+
+            __m256 y = _mm256_mul_ps(log2t, _mm256_set1_ps(2.4f));
+            y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+            __m256 n = _mm256_round_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256 f = _mm256_sub_ps(y, n);
+
+            // 2^f = sum (f * ln(2))^k / k!, |f| <= 0.5
+            __m256 expPoly = _mm256_set1_ps(1.5252734e-5f);
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(1.5403530e-4f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(1.3333558e-3f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(9.6181291e-3f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(5.5504109e-2f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(2.4022651e-1f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, _mm256_set1_ps(6.9314718e-1f));
+            expPoly = _mm256_fmadd_ps(expPoly, f, one);
+            __m256 powered = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(expPoly),
+                                                                  _mm256_slli_epi32(_mm256_cvtps_epi32(n), 23)));
+
+            __m256 isLinear = _mm256_cmp_ps(value, _mm256_set1_ps(0.04045f), _CMP_LE_OQ);
+            return _mm256_blendv_ps(powered, _mm256_div_ps(value, _mm256_set1_ps(12.92f)), isLinear);
+        }
+
+        uint32_t applyDegamma(const RGBA16Fx4* srcRow, uint32_t numPixels, RGBA16Fx4* dstRow) {
+            uint32_t numBlocks = numPixels / 2;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(srcRow + 2 * blockIdx)));
+                v = _mm256_blend_ps(sRGB_degamma(v), v, 0x88);
+                _mm_storeu_si128((__m128i*)(dstRow + 2 * blockIdx), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+            }
+
+            return 2 * numBlocks;
+        }
+
+        uint32_t applyDegamma(const RGBA32Fx4* srcRow, uint32_t numPixels, RGBA32Fx4* dstRow) {
+            uint32_t numBlocks = numPixels / 2;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                __m256 v = _mm256_loadu_ps((const float*)(srcRow + 2 * blockIdx));
+                v = _mm256_blend_ps(sRGB_degamma(v), v, 0x88);
+                _mm256_storeu_ps((float*)(dstRow + 2 * blockIdx), v);
+            }
+
+            return 2 * numBlocks;
+        }
+
+        uint32_t applyDegamma(const float* srcValues, uint32_t numValues, float* dstValues) {
+            uint32_t numBlocks = numValues / 8;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                __m256 v = _mm256_loadu_ps(srcValues + 8 * blockIdx);
+                _mm256_storeu_ps(dstValues + 8 * blockIdx, sRGB_degamma(v));
+            }
+
+            return 8 * numBlocks;
+        }
+
+
+
+        uint32_t convertHalfToFloat(const half* srcValues, uint32_t numValues, float* dstValues) {
+            uint32_t numBlocks = numValues / 8;
+            for (uint32_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(srcValues + 8 * blockIdx));
+                _mm256_storeu_ps(dstValues + 8 * blockIdx, _mm256_cvtph_ps(v));
+            }
+
+            return 8 * numBlocks;
+        }
+    }
+}
@@ -10,7 +10,23 @@
 #define VLR_Color_System_CIE_2012_2deg  2
 #define VLR_Color_System_CIE_2012_10deg 3
 
-//#define VLR_USE_SPECTRAL_RENDERING
+// JP: カーネルはRGBレンダリングとスペクトルレンダリング(VLR_USE_SPECTRAL_RENDERINGを定義)の2通りにコンパイルされる。
+//     ホスト側ではモードに依存する定義をインライン名前空間に入れて、両方を同じバイナリにリンクできるようにする。
+//     デバイス側ではモードごとに別のPTXになるので、OptiXから見える名前は変えない。
+// EN: The kernels are compiled twice, for RGB rendering and spectral rendering (defining VLR_USE_SPECTRAL_RENDERING).
+//     On the host, mode-dependent definitions are put into an inline namespace so that both can be linked into the same binary.
+//     On the device, each mode results in separate PTXes, so the names seen from OptiX are not changed.
+#if defined(VLR_Host)
+#   if defined(VLR_USE_SPECTRAL_RENDERING)
+#       define VLR_RENDERING_MODE_NAMESPACE_BEGIN inline namespace SpectralRendering {
+#   else
+#       define VLR_RENDERING_MODE_NAMESPACE_BEGIN inline namespace RGBRendering {
+#   endif
+#   define VLR_RENDERING_MODE_NAMESPACE_END }
+#else
+#   define VLR_RENDERING_MODE_NAMESPACE_BEGIN
+#   define VLR_RENDERING_MODE_NAMESPACE_END
+#endif
 #define VLR_Color_System_is_based_on VLR_Color_System_CIE_1931_2deg
 static constexpr uint32_t NumSpectralSamples = 4;
 static constexpr uint32_t NumStrataForStorage = 16;
@@ -35,6 +51,7 @@ static constexpr uint32_t NumStrataForStorage = 16;
 
 #if defined(VLR_Host)
 
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -44,6 +61,7 @@ static constexpr uint32_t NumStrataForStorage = 16;
 #include <array>
 #include <vector>
 #include <deque>
+#include <list>
 #include <map>
 #include <set>
 #include <stack>
@@ -188,6 +206,13 @@ namespace VLR {
             result = sumTemp;
             return *this;
         }
+        // JP: 別の総和を補償項も含めて加える。
+        // EN: Add another sum including its compensation term.
+        RT_FUNCTION CompensatedSum &operator+=(const CompensatedSum &v) {
+            *this += v.result;
+            *this += -v.comp;
+            return *this;
+        }
         RT_FUNCTION operator RealType() const { return result; };
     };
 
@@ -230,6 +255,20 @@ namespace VLR {
     std::unique_ptr<T> createUnique(ArgTypes&&... args) {
         return std::unique_ptr<T>(new T(std::forward<ArgTypes>(args)...));
     }
+
+
+
+    // JP: srcPathのファイルの名前をdstPathに変える。dstPathが既に存在する場合は置き換える。
+    //     書き終えた一時ファイルをこれで置き換えれば、書き込み途中で失敗しても元のファイルが壊れない。
+    // EN: Rename the file at srcPath to dstPath. dstPath is replaced if it already exists.
+    //     Replacing with a completely written temporary file by this keeps the original file intact even if writing fails midway.
+    inline bool replaceFile(const std::string &srcPath, const std::string &dstPath) {
+#if defined(VLR_Platform_Windows_MSVC)
+        return MoveFileExA(srcPath.c_str(), dstPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return std::rename(srcPath.c_str(), dstPath.c_str()) == 0;
+#endif
+    }
 #endif
 }
 
@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include "common_internal.h"
+
+#if defined(VLR_Host)
+
+namespace VLR {
+    // JP: ホストでスペクトルの演算をSIMD化するための固定長のfloatベクトル。16要素は4要素のベクトル4つで表す。
+    //     このヘッダーはAVX2を有効にした翻訳単位にも含まれるので、翻訳単位ごとに定義が変わらないようSSE2だけを使う。
+    //     比較の結果は各要素に対応するビットのマスクで返す。
+    // EN: Fixed-length float vectors to vectorize spectrum operations on the host. 16 elements are represented by four 4-element vectors.
+    //     This header is also included in translation units with AVX2 enabled, so only SSE2 is used to keep the definitions the same across translation units.
+    //     Comparisons return a mask with a bit for each element.
+    template <uint32_t N>
+    struct HostFloatN;
+
+
+
+    namespace HostSIMDDetail {
+        static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+        static inline float horizontalMax(__m128 v) {
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+        static inline float horizontalMin(__m128 v) {
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+        static inline float horizontalSum(__m128 v) {
+            v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_cvtss_f32(v);
+        }
+        static inline __m128 abs(__m128 v) {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+        }
+    }
+
+
+
+    template <>
+    struct HostFloatN<4> {
+        __m128 v;
+
+        static HostFloatN load(const float* p) { return HostFloatN{ _mm_loadu_ps(p) }; }
+        static HostFloatN set1(float s) { return HostFloatN{ _mm_set1_ps(s) }; }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+
+        HostFloatN operator-() const { return HostFloatN{ _mm_xor_ps(v, _mm_set1_ps(-0.0f)) }; }
+        HostFloatN operator+(const HostFloatN &b) const { return HostFloatN{ _mm_add_ps(v, b.v) }; }
+        HostFloatN operator-(const HostFloatN &b) const { return HostFloatN{ _mm_sub_ps(v, b.v) }; }
+        HostFloatN operator*(const HostFloatN &b) const { return HostFloatN{ _mm_mul_ps(v, b.v) }; }
+        HostFloatN operator/(const HostFloatN &b) const { return HostFloatN{ _mm_div_ps(v, b.v) }; }
+
+        // JP: bが正の要素のみ除算し、それ以外は0にする。
+        // EN: Divide only the elements where b is positive, otherwise 0.
+        HostFloatN safeDivide(const HostFloatN &b) const {
+            return HostFloatN{ _mm_and_ps(_mm_cmpgt_ps(b.v, _mm_setzero_ps()), _mm_div_ps(v, b.v)) };
+        }
+        HostFloatN replaceNaN(float value) const {
+            return HostFloatN{ HostSIMDDetail::select(_mm_cmpord_ps(v, v), v, _mm_set1_ps(value)) };
+        }
+
+        uint32_t notEqualMask(const HostFloatN &b) const { return _mm_movemask_ps(_mm_cmpneq_ps(v, b.v)); }
+        uint32_t lessThanMask(const HostFloatN &b) const { return _mm_movemask_ps(_mm_cmplt_ps(v, b.v)); }
+        uint32_t nanMask() const { return _mm_movemask_ps(_mm_cmpunord_ps(v, v)); }
+        uint32_t infMask() const { return _mm_movemask_ps(_mm_cmpeq_ps(HostSIMDDetail::abs(v), _mm_set1_ps(INFINITY))); }
+
+        float horizontalMax() const { return HostSIMDDetail::horizontalMax(v); }
+        float horizontalMin() const { return HostSIMDDetail::horizontalMin(v); }
+        float horizontalSum() const { return HostSIMDDetail::horizontalSum(v); }
+
+        static constexpr uint32_t AllMask() { return 0xF; }
+    };
+
+
+
+    template <>
+    struct HostFloatN<16> {
+        HostFloatN<4> v[4];
+
+        static HostFloatN load(const float* p) {
+            return HostFloatN{ { HostFloatN<4>::load(p), HostFloatN<4>::load(p + 4), HostFloatN<4>::load(p + 8), HostFloatN<4>::load(p + 12) } };
+        }
+        static HostFloatN set1(float s) {
+            HostFloatN<4> sv = HostFloatN<4>::set1(s);
+            return HostFloatN{ { sv, sv, sv, sv } };
+        }
+        void store(float* p) const {
+            for (int i = 0; i < 4; ++i)
+                v[i].store(p + 4 * i);
+        }
+
+        HostFloatN operator-() const { return HostFloatN{ { -v[0], -v[1], -v[2], -v[3] } }; }
+        HostFloatN operator+(const HostFloatN &b) const { return HostFloatN{ { v[0] + b.v[0], v[1] + b.v[1], v[2] + b.v[2], v[3] + b.v[3] } }; }
+        HostFloatN operator-(const HostFloatN &b) const { return HostFloatN{ { v[0] - b.v[0], v[1] - b.v[1], v[2] - b.v[2], v[3] - b.v[3] } }; }
+        HostFloatN operator*(const HostFloatN &b) const { return HostFloatN{ { v[0] * b.v[0], v[1] * b.v[1], v[2] * b.v[2], v[3] * b.v[3] } }; }
+        HostFloatN operator/(const HostFloatN &b) const { return HostFloatN{ { v[0] / b.v[0], v[1] / b.v[1], v[2] / b.v[2], v[3] / b.v[3] } }; }
+
+        HostFloatN replaceNaN(float value) const {
+            return HostFloatN{ { v[0].replaceNaN(value), v[1].replaceNaN(value), v[2].replaceNaN(value), v[3].replaceNaN(value) } };
+        }
+
+        uint32_t notEqualMask(const HostFloatN &b) const {
+            return (v[0].notEqualMask(b.v[0]) | (v[1].notEqualMask(b.v[1]) << 4) |
+                    (v[2].notEqualMask(b.v[2]) << 8) | (v[3].notEqualMask(b.v[3]) << 12));
+        }
+        uint32_t lessThanMask(const HostFloatN &b) const {
+            return (v[0].lessThanMask(b.v[0]) | (v[1].lessThanMask(b.v[1]) << 4) |
+                    (v[2].lessThanMask(b.v[2]) << 8) | (v[3].lessThanMask(b.v[3]) << 12));
+        }
+        uint32_t nanMask() const {
+            return v[0].nanMask() | (v[1].nanMask() << 4) | (v[2].nanMask() << 8) | (v[3].nanMask() << 12);
+        }
+        uint32_t infMask() const {
+            return v[0].infMask() | (v[1].infMask() << 4) | (v[2].infMask() << 8) | (v[3].infMask() << 12);
+        }
+
+        float horizontalMax() const {
+            return HostSIMDDetail::horizontalMax(_mm_max_ps(_mm_max_ps(v[0].v, v[1].v), _mm_max_ps(v[2].v, v[3].v)));
+        }
+        float horizontalMin() const {
+            return HostSIMDDetail::horizontalMin(_mm_min_ps(_mm_min_ps(v[0].v, v[1].v), _mm_min_ps(v[2].v, v[3].v)));
+        }
+        float horizontalSum() const {
+            return HostSIMDDetail::horizontalSum(_mm_add_ps(_mm_add_ps(v[0].v, v[1].v), _mm_add_ps(v[2].v, v[3].v)));
+        }
+
+        static constexpr uint32_t AllMask() { return 0xFFFF; }
+    };
+}
+
+#endif
@@ -230,6 +230,11 @@ namespace VLR {
             return *this;
         }
 
+        RT_FUNCTION RGBStorageTemplate &merge(const RGBStorageTemplate &v) {
+            value += v.value;
+            return *this;
+        }
+
         RT_FUNCTION CompensatedSum<ValueType> &getValue() {
             return value;
         }
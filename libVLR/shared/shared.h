@@ -33,25 +33,46 @@ namespace VLR {
     };
 #endif
 
+    // JP: レンダリングモードごとのスペクトル関連の型。
+    //     ホスト側ではモードに依存しないコードがこれらを通して両方のモードを扱う。
+    // EN: Spectrum-related types per rendering mode.
+    //     On the host, mode-independent code deals with both modes through these.
+    struct RGBRenderingTypes {
+        using WavelengthSamples = RGBWavelengthSamplesTemplate<float>;
+        using SampledSpectrum = RGBSpectrumTemplate<float>;
+        using DiscretizedSpectrum = RGBSpectrumTemplate<float>;
+        using SpectrumStorage = RGBStorageTemplate<float>;
+        using TripletSpectrum = RGBSpectrum;
+    };
+
+    struct SpectralRenderingTypes {
+        using WavelengthSamples = WavelengthSamplesTemplate<float, NumSpectralSamples>;
+        using SampledSpectrum = SampledSpectrumTemplate<float, NumSpectralSamples>;
+        using DiscretizedSpectrum = DiscretizedSpectrumTemplate<float, NumStrataForStorage>;
+        using SpectrumStorage = SpectrumStorageTemplate<float, NumStrataForStorage>;
+        using TripletSpectrum = UpsampledSpectrum;
+    };
+
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
 #if defined(VLR_USE_SPECTRAL_RENDERING)
-    using WavelengthSamples = WavelengthSamplesTemplate<float, NumSpectralSamples>;
-    using SampledSpectrum = SampledSpectrumTemplate<float, NumSpectralSamples>;
-    using DiscretizedSpectrum = DiscretizedSpectrumTemplate<float, NumStrataForStorage>;
-    using SpectrumStorage = SpectrumStorageTemplate<float, NumStrataForStorage>;
-    using TripletSpectrum = UpsampledSpectrum;
+    using RenderingTypes = SpectralRenderingTypes;
 #else
-    using WavelengthSamples = RGBWavelengthSamplesTemplate<float>;
-    using SampledSpectrum = RGBSpectrumTemplate<float>;
-    using DiscretizedSpectrum = RGBSpectrumTemplate<float>;
-    using SpectrumStorage = RGBStorageTemplate<float>;
-    using TripletSpectrum = RGBSpectrum;
+    using RenderingTypes = RGBRenderingTypes;
 #endif
+    using WavelengthSamples = RenderingTypes::WavelengthSamples;
+    using SampledSpectrum = RenderingTypes::SampledSpectrum;
+    using DiscretizedSpectrum = RenderingTypes::DiscretizedSpectrum;
+    using SpectrumStorage = RenderingTypes::SpectrumStorage;
+    using TripletSpectrum = RenderingTypes::TripletSpectrum;
+    VLR_RENDERING_MODE_NAMESPACE_END
 
     using DiscretizedSpectrumAlwaysSpectral = DiscretizedSpectrumTemplate<float, NumStrataForStorage>;
 
 #if defined(VLR_Device)
     rtBuffer<UpsampledSpectrum::spectrum_grid_cell_t, 1> UpsampledSpectrum_spectrum_grid;
     rtBuffer<UpsampledSpectrum::spectrum_data_point_t, 1> UpsampledSpectrum_spectrum_data_points;
+    rtBuffer<UpsampledSpectrum::spectrum_triangle_t, 1> UpsampledSpectrum_spectrum_triangles;
+    rtBuffer<uint16_t, 1> UpsampledSpectrum_adjacency_table;
 
 
     rtDeclareVariable(DiscretizedSpectrumAlwaysSpectral::CMF, DiscretizedSpectrum_xbar, , );
@@ -60,10 +81,19 @@ namespace VLR {
     rtDeclareVariable(float, DiscretizedSpectrum_integralCMF, , );
 #endif
 
-    RT_FUNCTION HOST_INLINE TripletSpectrum createTripletSpectrum(VLRSpectrumType spectrumType, VLRColorSpace colorSpace, float e0, float e1, float e2) {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-        return UpsampledSpectrum(spectrumType, colorSpace, e0, e1, e2);
-#else
+    // JP: 定数のスペクトル。RGBレンダリングでは描画用のRGB、スペクトルレンダリングではアップサンプルされたスペクトルとして解釈する。
+    //     どちらも同じ大きさなので、マテリアルなどのデスクリプターのレイアウトはモードに依存しない。
+    // EN: Constant spectrum. Interpreted as rendering RGB in RGB rendering, and as an upsampled spectrum in spectral rendering.
+    //     Both have the same size, so the layouts of descriptors like materials do not depend on the mode.
+    union TripletSpectrumData {
+        RGBSpectrum asRGB;
+        UpsampledSpectrum asUpsampled;
+
+        RT_FUNCTION TripletSpectrumData() {}
+    };
+    static_assert(sizeof(RGBSpectrum) == sizeof(UpsampledSpectrum), "Unexpected Size");
+
+    RT_FUNCTION HOST_INLINE RGBSpectrum createRGBTripletSpectrum(VLRSpectrumType spectrumType, VLRColorSpace colorSpace, float e0, float e1, float e2) {
         float XYZ[3];
 
         switch (colorSpace) {
@@ -118,8 +148,68 @@ namespace VLR {
         float RGB[3];
         transformToRenderingRGB(spectrumType, XYZ, RGB);
         return RGBSpectrum(RGB[0], RGB[1], RGB[2]);
+    }
+
+    VLR_RENDERING_MODE_NAMESPACE_BEGIN
+    RT_FUNCTION HOST_INLINE TripletSpectrum createTripletSpectrum(VLRSpectrumType spectrumType, VLRColorSpace colorSpace, float e0, float e1, float e2) {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+        return UpsampledSpectrum(spectrumType, colorSpace, e0, e1, e2);
+#else
+        return createRGBTripletSpectrum(spectrumType, colorSpace, e0, e1, e2);
+#endif
+    }
+
+    RT_FUNCTION HOST_INLINE const TripletSpectrum &getTripletSpectrum(const TripletSpectrumData &data) {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+        return data.asUpsampled;
+#else
+        return data.asRGB;
 #endif
     }
+    VLR_RENDERING_MODE_NAMESPACE_END
+
+#if defined(VLR_Host)
+    inline TripletSpectrumData createTripletSpectrumData(VLRRenderingMode renderingMode,
+                                                         VLRSpectrumType spectrumType, VLRColorSpace colorSpace, float e0, float e1, float e2) {
+        TripletSpectrumData ret;
+        if (renderingMode == VLRRenderingMode_Spectral)
+            ret.asUpsampled = UpsampledSpectrum(spectrumType, colorSpace, e0, e1, e2);
+        else
+            ret.asRGB = createRGBTripletSpectrum(spectrumType, colorSpace, e0, e1, e2);
+        return ret;
+    }
+#endif
+
+
+
+#if defined(VLR_Host)
+    namespace CPU {
+        // JP: CPUバックエンドでバッファーIDに対応するデータを取得する。
+        // EN: get the data corresponding to a buffer ID in the CPU backend.
+        const void* getBufferData(int32_t bufferID);
+    }
+
+    // JP: ホスト側のrtBufferId。デバイス側と同じくIDのみを保持する。
+    //     Shared内の型をCPUバックエンドのカーネルからも使えるようにインデックスアクセスを可能にしておく。
+    // EN: host-side rtBufferId. This holds only an ID as the device-side one does.
+    //     It allows index access so that the types in Shared can be used by the CPU backend's kernels as well.
+    template <typename T, int Dim = 1>
+    class rtBufferId {
+        int32_t m_id;
+
+    public:
+        rtBufferId() = default;
+        rtBufferId(int32_t id) : m_id(id) {}
+
+        int32_t getId() const {
+            return m_id;
+        }
+
+        const T &operator[](uint32_t index) const {
+            return ((const T*)CPU::getBufferData(m_id))[index];
+        }
+    };
+#endif
 
 
 
@@ -314,14 +404,12 @@ namespace VLR {
             }
         };
 
-        struct SpectrumNodeDescriptor {
+#define VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_RGB (3)
+#define VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL (63)
+        template <uint32_t NumSlots>
+        struct SpectrumNodeDescriptorTemplate {
             uint32_t procSetIndex;
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-#   define VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS (63)
-#else
-#   define VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS (3)
-#endif
-            uint32_t data[VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS];
+            uint32_t data[NumSlots];
 
             template <typename T>
             T* getData() const {
@@ -330,6 +418,20 @@ namespace VLR {
             }
         };
 
+        VLR_RENDERING_MODE_NAMESPACE_BEGIN
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+        using SpectrumNodeDescriptor = SpectrumNodeDescriptorTemplate<VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL>;
+#else
+        using SpectrumNodeDescriptor = SpectrumNodeDescriptorTemplate<VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_RGB>;
+#endif
+        VLR_RENDERING_MODE_NAMESPACE_END
+
+        // JP: ホスト側ではモードによらず大きい方のレイアウトでデスクリプターを組み立て、
+        //     バッファーにはその先頭からコンテキストのモードのデスクリプターの大きさ分を書き込む。
+        // EN: The host assembles descriptors in the larger layout regardless of the mode,
+        //     and writes the size of a descriptor of the context's mode from its beginning to the buffer.
+        using HostSpectrumNodeDescriptor = SpectrumNodeDescriptorTemplate<VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL>;
+
 
 
         struct BSDFProcedureSet {
@@ -445,6 +547,100 @@ namespace VLR {
             RT_FUNCTION constexpr RayType(Value v = Primary) : value(v) {}
         };
 
+        // JP: 画素ごとのサンプルの輝度の統計。
+        //     二乗和から分散を求めると平均が大きい画素で桁落ちするので、Welfordの方法で平均と偏差平方和を更新する。
+        // EN: Luminance statistics of samples per pixel.
+        //     Computing the variance from the sum of squares suffers from cancellation for pixels with large means,
+        //     so update the mean and the sum of squared deviations with Welford's method.
+        struct PixelStatistics {
+            float meanLuminance;
+            float sumSquaredDeviations;
+            uint32_t numSamples;
+
+            RT_FUNCTION void reset() {
+                meanLuminance = 0.0f;
+                sumSquaredDeviations = 0.0f;
+                numSamples = 0;
+            }
+
+            RT_FUNCTION void add(float luminance) {
+                ++numSamples;
+                float delta = luminance - meanLuminance;
+                meanLuminance += delta / numSamples;
+                sumSquaredDeviations += delta * (luminance - meanLuminance);
+            }
+
+            // JP: Chanらの方法で2つの統計を結合する。
+            // EN: Combine two statistics with the method by Chan et al.
+            RT_FUNCTION void merge(const PixelStatistics &v) {
+                if (v.numSamples == 0)
+                    return;
+                if (numSamples == 0) {
+                    *this = v;
+                    return;
+                }
+                float n = (float)numSamples;
+                float vn = (float)v.numSamples;
+                float totalN = n + vn;
+                float delta = v.meanLuminance - meanLuminance;
+                meanLuminance += delta * (vn / totalN);
+                sumSquaredDeviations += v.sumSquaredDeviations + delta * delta * (n * vn / totalN);
+                numSamples += v.numSamples;
+            }
+
+            // JP: 平均の標準誤差を平均で割った相対誤差。真っ黒な画素は収束しているとみなす。
+            // EN: Relative error which is the standard error of the mean divided by the mean. A pure black pixel is regarded as converged.
+            RT_FUNCTION float calcRelativeError() const {
+                if (numSamples < 2)
+                    return INFINITY;
+                float variance = std::fmax(sumSquaredDeviations, 0.0f) / (numSamples - 1);
+                if (meanLuminance <= 0.0f)
+                    return variance > 0.0f ? INFINITY : 0.0f;
+                return std::sqrt(variance / numSamples) / meanLuminance;
+            }
+        };
+
+        // JP: VLRAccumulationFormat_CompactXYZで使う画素ごとの蓄積値。
+        //     各サンプルはfloatのXYZに変換した後に倍精度で足し合わせるので補償項は不要。
+        // EN: Accumulated value per pixel used with VLRAccumulationFormat_CompactXYZ.
+        //     Each sample is converted to XYZ in float and then summed in double precision, so compensation terms are unnecessary.
+        struct CompactXYZStorage {
+            double XYZ[3];
+
+            RT_FUNCTION void reset() {
+                XYZ[0] = XYZ[1] = XYZ[2] = 0.0;
+            }
+
+            RT_FUNCTION void add(const float sampleXYZ[3]) {
+                XYZ[0] += sampleXYZ[0];
+                XYZ[1] += sampleXYZ[1];
+                XYZ[2] += sampleXYZ[2];
+            }
+
+            RT_FUNCTION void merge(const CompactXYZStorage &v) {
+                XYZ[0] += v.XYZ[0];
+                XYZ[1] += v.XYZ[1];
+                XYZ[2] += v.XYZ[2];
+            }
+
+            RT_FUNCTION void getXYZ(float dstXYZ[3]) const {
+                dstXYZ[0] = (float)XYZ[0];
+                dstXYZ[1] = (float)XYZ[1];
+                dstXYZ[2] = (float)XYZ[2];
+            }
+        };
+
+        // JP: pixelErrorThresholdが0の場合は適応サンプリングを行わない。
+        //     minNumSamples未満のサンプル数の画素は常にサンプルする。
+        // EN: Adaptive sampling is not performed when pixelErrorThreshold is 0.
+        //     Pixels with fewer than minNumSamples samples are always sampled.
+        struct AdaptiveSamplingParameters {
+            float pixelErrorThreshold;
+            uint32_t minNumSamples;
+
+            RT_FUNCTION AdaptiveSamplingParameters() : pixelErrorThreshold(0.0f), minNumSamples(16) {}
+        };
+
         struct SurfacePointAttribute {
             enum Value {
                 GeometricNormal = 0,
@@ -529,36 +725,28 @@ namespace VLR {
             float immOffset;
         };
 
-#if defined(VLR_USE_SPECTRAL_RENDERING)
         struct TripletSpectrumShaderNode {
-            UpsampledSpectrum value;
+            TripletSpectrumData value;
         };
 
         struct RegularSampledSpectrumShaderNode {
             float minLambda;
             float maxLambda;
-            float values[VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS - 3];
+            float values[VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL - 3];
             uint32_t numSamples;
         };
 
         struct IrregularSampledSpectrumShaderNode {
-            float lambdas[(VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS - 1) / 2];
-            float values[(VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS - 1) / 2];
+            float lambdas[(VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL - 1) / 2];
+            float values[(VLR_MAX_NUM_SPECTRUM_NODE_DESCRIPTOR_SLOTS_SPECTRAL - 1) / 2];
             uint32_t numSamples;
         };
-#else
-        struct TripletSpectrumShaderNode {
-            RGBSpectrum value;
-        };
-
-        struct RegularSampledSpectrumShaderNode {
-            RGBSpectrum value;
-        };
 
-        struct IrregularSampledSpectrumShaderNode {
+        // JP: RGBレンダリングではサンプルされたスペクトルをホスト側で描画用のRGBに変換しておく。
+        // EN: In RGB rendering, sampled spectra are converted to rendering RGB on the host beforehand.
+        struct PreconvertedRGBSpectrumShaderNode {
             RGBSpectrum value;
         };
-#endif
 
         struct Vector3DToSpectrumShaderNode {
             ShaderNodeSocketID nodeVector3D;
@@ -578,12 +766,16 @@ namespace VLR {
             VLRSpectrumType spectrumType;
             VLRColorSpace colorSpace;
             ShaderNodeSocketID nodeTexCoord;
+            uint32_t width;
+            uint32_t height;
         };
 
         struct EnvironmentTextureShaderNode {
             int32_t textureID;
             VLRColorSpace colorSpace;
             ShaderNodeSocketID nodeTexCoord;
+            uint32_t width;
+            uint32_t height;
         };
 
         // END: Shader Nodes
@@ -596,33 +788,33 @@ namespace VLR {
 
         struct MatteSurfaceMaterial {
             ShaderNodeSocketID nodeAlbedo;
-            TripletSpectrum immAlbedo;
+            TripletSpectrumData immAlbedo;
         };
 
         struct SpecularReflectionSurfaceMaterial {
             ShaderNodeSocketID nodeCoeffR;
             ShaderNodeSocketID nodeEta;
             ShaderNodeSocketID node_k;
-            TripletSpectrum immCoeffR;
-            TripletSpectrum immEta;
-            TripletSpectrum imm_k;
+            TripletSpectrumData immCoeffR;
+            TripletSpectrumData immEta;
+            TripletSpectrumData imm_k;
         };
 
         struct SpecularScatteringSurfaceMaterial {
             ShaderNodeSocketID nodeCoeff;
             ShaderNodeSocketID nodeEtaExt;
             ShaderNodeSocketID nodeEtaInt;
-            TripletSpectrum immCoeff;
-            TripletSpectrum immEtaExt;
-            TripletSpectrum immEtaInt;
+            TripletSpectrumData immCoeff;
+            TripletSpectrumData immEtaExt;
+            TripletSpectrumData immEtaInt;
         };
 
         struct MicrofacetReflectionSurfaceMaterial {
             ShaderNodeSocketID nodeEta;
             ShaderNodeSocketID node_k;
             ShaderNodeSocketID nodeRoughnessAnisotropyRotation;
-            TripletSpectrum immEta;
-            TripletSpectrum imm_k;
+            TripletSpectrumData immEta;
+            TripletSpectrumData imm_k;
             float immRoughness;
             float immAnisotropy;
             float immRotation;
@@ -633,9 +825,9 @@ namespace VLR {
             ShaderNodeSocketID nodeEtaExt;
             ShaderNodeSocketID nodeEtaInt;
             ShaderNodeSocketID nodeRoughnessAnisotropyRotation;
-            TripletSpectrum immCoeff;
-            TripletSpectrum immEtaExt;
-            TripletSpectrum immEtaInt;
+            TripletSpectrumData immCoeff;
+            TripletSpectrumData immEtaExt;
+            TripletSpectrumData immEtaInt;
             float immRoughness;
             float immAnisotropy;
             float immRotation;
@@ -644,14 +836,14 @@ namespace VLR {
         struct LambertianScatteringSurfaceMaterial {
             ShaderNodeSocketID nodeCoeff;
             ShaderNodeSocketID nodeF0;
-            TripletSpectrum immCoeff;
+            TripletSpectrumData immCoeff;
             float immF0;
         };
 
         struct UE4SurfaceMaterial {
             ShaderNodeSocketID nodeBaseColor;
             ShaderNodeSocketID nodeOcclusionRoughnessMetallic;
-            TripletSpectrum immBaseColor;
+            TripletSpectrumData immBaseColor;
             float immOcclusion;
             float immRoughness;
             float immMetallic;
@@ -661,14 +853,14 @@ namespace VLR {
             ShaderNodeSocketID nodeDiffuseColor;
             ShaderNodeSocketID nodeSpecularColor;
             ShaderNodeSocketID nodeGlossiness;
-            TripletSpectrum immDiffuseColor;
-            TripletSpectrum immSpecularColor;
+            TripletSpectrumData immDiffuseColor;
+            TripletSpectrumData immSpecularColor;
             float immGlossiness;
         };
 
         struct DiffuseEmitterSurfaceMaterial {
             ShaderNodeSocketID nodeEmittance;
-            TripletSpectrum immEmittance;
+            TripletSpectrumData immEmittance;
         };
 
         struct MultiSurfaceMaterial {
@@ -678,7 +870,7 @@ namespace VLR {
 
         struct EnvironmentEmitterSurfaceMaterial {
             ShaderNodeSocketID nodeEmittance;
-            TripletSpectrum immEmittance;
+            TripletSpectrumData immEmittance;
             float immScale;
         };
 
@@ -196,6 +196,7 @@ namespace VLR {
     void initializeColorSystem() {
         if (!s_initialized) {
             DiscretizedSpectrumTemplate<float, NumStrataForStorage>::initialize();
+            UpsampledSpectrumTemplate<float, NumSpectralSamples>::initialize();
 
             CompensatedSum<float> cum(0);
             for (int i = 1; i < NumCMFSamples; ++i)
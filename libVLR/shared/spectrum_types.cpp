@@ -4,6 +4,8 @@ namespace VLR {
 #if defined(VLR_Device)
 #   define spectrum_grid UpsampledSpectrum_spectrum_grid
 #   define spectrum_data_points UpsampledSpectrum_spectrum_data_points
+#   define spectrum_triangles UpsampledSpectrum_spectrum_triangles
+#   define adjacency_table UpsampledSpectrum_adjacency_table
 #endif
 
     template <typename RealType, uint32_t NumSpectralSamples>
@@ -20,7 +22,6 @@ namespace VLR {
 
         const spectrum_grid_cell_t &cell = spectrum_grid[cellIdx];
         const uint8_t* indices = cell.idx;
-        const uint8_t numPoints = cell.num_points;
 
         if (cell.inside) { // fast path for normal inner quads:
             // the layout of the vertices in the quad is:
@@ -37,51 +38,48 @@ namespace VLR {
             m_t = (uint16_t)std::fmax(t * (UINT16_MAX - 1), (RealType)0);
         }
         else {
-            // need to go through triangulation :(
-            // we get the indices in such an order that they form a triangle fan around idx[0].
-            // compute barycentric coordinates of our xy* point for all triangles in the fan:
-            const RealType ex = u - spectrum_data_points[indices[0]].uv[0];
-            const RealType ey = v - spectrum_data_points[indices[0]].uv[1];
-            float e0x = spectrum_data_points[indices[1]].uv[0] - spectrum_data_points[indices[0]].uv[0];
-            float e0y = spectrum_data_points[indices[1]].uv[1] - spectrum_data_points[indices[0]].uv[1];
-            RealType uu = e0x * ey - ex * e0y;
-            for (int i = 1; i < numPoints; ++i) {
-                uint32_t idx = indices[i % (numPoints - 1) + 1];
-                float e1x = spectrum_data_points[idx].uv[0] - spectrum_data_points[indices[0]].uv[0];
-                float e1y = spectrum_data_points[idx].uv[1] - spectrum_data_points[indices[0]].uv[1];
-                RealType vv = ex * e1y - e1x * ey;
-
-                // TODO: with some sign magic, this division could be deferred to the last iteration!
-                const float area = e0x * e1y - e1x * e0y;
-                // normalise
-                const RealType b0 = uu / area;
-                const RealType b1 = vv / area;
-                float b2 = 1.0f - b0 - b1;
-                // outside spectral locus (quantized version at least) or outside grid
-                //if (b0 < 0.0 || b1 < 0.0 || b2 < 0.0) {
-                if (b0 < -1e-6 || b1 < -1e-6 || b2 < -1e-6) {
-                    uu = -vv;
-                    e0x = e1x;
-                    e0y = e1y;
+            // JP: 分割セルと交差する三角形だけを、除算済みの重心座標の係数を使って扇と同じ順序で調べる。
+            //     候補の一覧は保守的に作ってあるので、点を含む三角形はすべて候補の範囲にあり、扇を辿った場合と同じ三角形が選ばれる。
+            //     スペクトル軌跡の境界の上の点は丸めによってどの候補にもわずかに含まれないことがあるので、
+            //     その場合は重心座標の最小値が最も大きい、つまり最も近い候補を選ぶ。
+            // EN: Test only triangles intersecting the sub-cell in the same order as the fan using the coefficients of barycentric coordinates with the division done.
+            //     The candidate lists are built conservatively, so all triangles containing the point are in the candidate range,
+            //     and the same triangle as walking the fan is selected.
+            //     A point on the boundary of the spectral locus can be slightly outside all the candidates due to rounding,
+            //     so the candidate with the largest minimum barycentric coordinate, that is the closest one, is selected in that case.
+            const uint32_t tableWidth = GridWidth() * AdjacencyTableResolution();
+            const uint32_t su = std::min<uint32_t>(u * AdjacencyTableResolution(), tableWidth - 1);
+            const uint32_t sv = std::min<uint32_t>(v * AdjacencyTableResolution(), GridHeight() * AdjacencyTableResolution() - 1);
+            const uint16_t entry = adjacency_table[sv * tableWidth + su];
+            const uint32_t firstTriIdx = entry & ((1 << AdjacencyTableIndexBits()) - 1);
+            const uint32_t numCandidates = entry >> AdjacencyTableIndexBits();
+            RealType closestMinB = -INFINITY;
+            for (uint32_t i = 0; i < numCandidates; ++i) {
+                const spectrum_triangle_t &tri = spectrum_triangles[firstTriIdx + i];
+                const RealType ex = u - tri.origin[0];
+                const RealType ey = v - tri.origin[1];
+                const RealType b0 = tri.b0[0] * ex + tri.b0[1] * ey;
+                const RealType b1 = tri.b1[0] * ex + tri.b1[1] * ey;
+                const RealType b2 = 1.0f - b0 - b1;
+                const RealType minB = std::fmin(std::fmin(b0, b1), b2);
+                if (minB <= closestMinB)
                     continue;
-                }
 
-                m_adjIndices = (((uint32_t)UINT8_MAX << 24) |
-                                ((uint32_t)indices[0] << 16) |
-                                ((uint32_t)indices[i] << 8) |
-                                ((uint32_t)idx << 0));
+                m_adjIndices = tri.adjIndices;
                 m_s = (uint16_t)std::fmax(b0 * (UINT16_MAX - 1), (RealType)0);
                 m_t = (uint16_t)std::fmax(b1 * (UINT16_MAX - 1), (RealType)0);
-                break;
+                closestMinB = minB;
+                if (minB >= -1e-6)
+                    break;
             }
         }
         VLRAssert((m_adjIndices && 0xFF) != UINT8_MAX, "Adjacent points must be selected at this point.");
     }
 
     template <typename RealType, uint32_t NumSpectralSamples>
-    RT_FUNCTION constexpr UpsampledSpectrumTemplate<RealType, NumSpectralSamples>::UpsampledSpectrumTemplate(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2) {
+    RT_FUNCTION void UpsampledSpectrumTemplate<RealType, NumSpectralSamples>::computeUVAndBrightness(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2,
+                                                                                                  RealType uv[2], RealType* brightness) {
         RealType xy[2];
-        RealType brightness;
         switch (space) {
         case VLRColorSpace_Rec709_D65_sRGBGamma: {
             e0 = sRGB_degamma(e0);
@@ -121,11 +119,11 @@ namespace VLR {
         case VLRColorSpace_xyY: {
             xy[0] = e0;
             xy[1] = e1;
-            brightness = e2 / e1;
+            *brightness = e2 / e1;
             if (e2 == 0) {
                 xy[0] = (RealType)0.3333;
                 xy[1] = (RealType)0.3333;
-                brightness = 0;
+                *brightness = 0;
             }
             break;
         }
@@ -136,9 +134,15 @@ namespace VLR {
         // TODO: Contain a factor for solid of natural reflectance.
         //if (spType == VLRSpectrumType_Reflectance)
         //    brightness = std::min(brightness, evaluateMaximumBrightness(x, y));
-        m_scale = brightness / EqualEnergyReflectance();
-        RealType uv[2];
         xy_to_uv(xy, uv);
+    }
+
+    template <typename RealType, uint32_t NumSpectralSamples>
+    RT_FUNCTION constexpr UpsampledSpectrumTemplate<RealType, NumSpectralSamples>::UpsampledSpectrumTemplate(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2) {
+        RealType uv[2];
+        RealType brightness;
+        computeUVAndBrightness(spType, space, e0, e1, e2, uv, &brightness);
+        m_scale = brightness / EqualEnergyReflectance();
         VLRAssert(std::isfinite(uv[0]) && std::isfinite(uv[1]) && std::isfinite(m_scale), "Invalid value.");
 
         computeAdjacents(uv[0], uv[1]);
@@ -189,10 +193,137 @@ namespace VLR {
         return ret * m_scale;
     }
 
+#if defined(VLR_Host)
+    template <> UpsampledSpectrumTemplate<float, NumSpectralSamples>::spectrum_triangle_t UpsampledSpectrumTemplate<float, NumSpectralSamples>::spectrum_triangles[UpsampledSpectrumTemplate<float, NumSpectralSamples>::MaxNumTriangles()];
+    template <> uint16_t UpsampledSpectrumTemplate<float, NumSpectralSamples>::adjacency_table[UpsampledSpectrumTemplate<float, NumSpectralSamples>::NumAdjacencyTableEntries()];
+    template <> uint32_t UpsampledSpectrumTemplate<float, NumSpectralSamples>::numTriangles;
+
+    template <typename RealType, uint32_t NumSpectralSamples>
+    void UpsampledSpectrumTemplate<RealType, NumSpectralSamples>::initialize() {
+        // JP: 三角形の数の上限は格子の大きさから決まるので、表の要素に詰められることをコンパイル時に確かめる。
+        // EN: The maximum number of triangles is determined by the grid size, so check at compile time that they can be packed into an entry of the table.
+        static_assert(MaxNumTriangles() <= (1u << AdjacencyTableIndexBits()),
+                      "The index of the first triangle doesn't fit in the adjacency table entry.");
+        static_assert(MaxNumPointsPerCell() - 1 < (1u << (16 - AdjacencyTableIndexBits())),
+                      "The number of triangles doesn't fit in the adjacency table entry.");
+
+        const uint32_t resolution = AdjacencyTableResolution();
+        const uint32_t tableWidth = GridWidth() * resolution;
+        std::fill_n(adjacency_table, NumAdjacencyTableEntries(), 0);
+
+        numTriangles = 0;
+        for (uint32_t vi = 0; vi < GridHeight(); ++vi) {
+            for (uint32_t ui = 0; ui < GridWidth(); ++ui) {
+                const spectrum_grid_cell_t &cell = spectrum_grid[ui + GridWidth() * vi];
+                if (cell.inside || cell.num_points < 3)
+                    continue;
+
+                // JP: computeAdjacents()の扇と同じ順序、同じ頂点の並びで三角形を登録する。
+                // EN: Register triangles in the same order and with the same vertex order as the fan in computeAdjacents().
+                const uint8_t* indices = cell.idx;
+                const uint32_t baseTriIdx = numTriangles;
+                const float* p0 = spectrum_data_points[indices[0]].uv;
+                for (int i = 1; i < cell.num_points; ++i) {
+                    uint32_t idx = indices[i % (cell.num_points - 1) + 1];
+                    const float* pA = spectrum_data_points[indices[i]].uv;
+                    const float* pB = spectrum_data_points[idx].uv;
+                    // JP: 細長い三角形で係数の精度を保つため倍精度で計算する。
+                    // EN: Compute in double precision to keep the precision of the coefficients for thin triangles.
+                    const double eAx = (double)pA[0] - p0[0];
+                    const double eAy = (double)pA[1] - p0[1];
+                    const double eBx = (double)pB[0] - p0[0];
+                    const double eBy = (double)pB[1] - p0[1];
+                    const double area = eAx * eBy - eBx * eAy;
+
+                    VLRAssert(numTriangles < MaxNumTriangles(), "Too many triangles.");
+                    spectrum_triangle_t &tri = spectrum_triangles[numTriangles++];
+                    tri.adjIndices = (((uint32_t)UINT8_MAX << 24) |
+                                      ((uint32_t)indices[0] << 16) |
+                                      ((uint32_t)indices[i] << 8) |
+                                      ((uint32_t)idx << 0));
+                    // b0 = (eA x (uv - p0)) / area, b1 = ((uv - p0) x eB) / area
+                    tri.origin[0] = p0[0];
+                    tri.origin[1] = p0[1];
+                    tri.b0[0] = -eAy / area;
+                    tri.b0[1] = eAx / area;
+                    tri.b1[0] = eBy / area;
+                    tri.b1[1] = -eBx / area;
+                }
+
+                // JP: 分割セルと交差する三角形の範囲を求める(保守的ラスタライズ)。
+                //     computeAdjacents()は重心座標が-1e-6以上の点を三角形に含むので、重心座標で余裕Marginだけ広げた三角形と、
+                //     添字の計算の丸めの分だけ広げた分割セルで分離軸判定を行う。凸多角形同士なので分離軸は三角形の3辺と座標軸で足り、
+                //     分離できなければ交差するとみなす。広げた三角形の頂点は各頂点を重心から(1 + 3 * Margin)倍に離した位置にある。
+                //     これにより扇のどれかの三角形に含まれる点は、必ずその三角形を候補に持つ分割セルに入る。
+                // EN: Find the range of triangles intersecting a sub-cell (conservative rasterization).
+                //     computeAdjacents() treats a point with barycentric coordinates of -1e-6 or more as inside, so the separating axis test is done
+                //     between the triangle grown by Margin in barycentric coordinates and the sub-cell grown by rounding of the index computation.
+                //     The three edges of the triangle and the coordinate axes suffice as separating axes for two convex polygons,
+                //     and they are considered to intersect if not separated. Vertices of the grown triangle are scaled by (1 + 3 * Margin) from the centroid.
+                //     This way a point contained in any triangle of the fan always falls into a sub-cell that has the triangle as a candidate.
+                const RealType Margin = 1e-3f;
+                const RealType SubCellMargin = 1e-4f;
+                for (uint32_t sy = 0; sy < resolution; ++sy) {
+                    for (uint32_t sx = 0; sx < resolution; ++sx) {
+                        const RealType us[2] = { ui + (RealType)sx / resolution - SubCellMargin, ui + (RealType)(sx + 1) / resolution + SubCellMargin };
+                        const RealType vs[2] = { vi + (RealType)sy / resolution - SubCellMargin, vi + (RealType)(sy + 1) / resolution + SubCellMargin };
+                        uint32_t minTriIdx = UINT32_MAX;
+                        uint32_t maxTriIdx = 0;
+                        for (uint32_t triIdx = baseTriIdx; triIdx < numTriangles; ++triIdx) {
+                            const spectrum_triangle_t &tri = spectrum_triangles[triIdx];
+                            const float* ps[3] = {
+                                p0,
+                                spectrum_data_points[(tri.adjIndices >> 8) & 0xFF].uv,
+                                spectrum_data_points[(tri.adjIndices >> 0) & 0xFF].uv
+                            };
+                            RealType grownMin[2] = { INFINITY, INFINITY };
+                            RealType grownMax[2] = { -INFINITY, -INFINITY };
+                            for (int dim = 0; dim < 2; ++dim) {
+                                const RealType centroid = (ps[0][dim] + ps[1][dim] + ps[2][dim]) / 3;
+                                for (int k = 0; k < 3; ++k) {
+                                    const RealType p = centroid + (1 + 3 * Margin) * (ps[k][dim] - centroid);
+                                    grownMin[dim] = std::fmin(grownMin[dim], p);
+                                    grownMax[dim] = std::fmax(grownMax[dim], p);
+                                }
+                            }
+                            if (grownMax[0] < us[0] || grownMin[0] > us[1] || grownMax[1] < vs[0] || grownMin[1] > vs[1])
+                                continue;
+
+                            bool separated[3] = { true, true, true };
+                            for (int c = 0; c < 4; ++c) {
+                                const RealType ex = us[c % 2] - tri.origin[0];
+                                const RealType ey = vs[c / 2] - tri.origin[1];
+                                const RealType b0 = tri.b0[0] * ex + tri.b0[1] * ey;
+                                const RealType b1 = tri.b1[0] * ex + tri.b1[1] * ey;
+                                const RealType b2 = 1 - b0 - b1;
+                                separated[0] &= b0 < -Margin;
+                                separated[1] &= b1 < -Margin;
+                                separated[2] &= b2 < -Margin;
+                            }
+                            // JP: 面積0の三角形では係数が有限でなく、扇でも選ばれることはない。
+                            // EN: Coefficients of a triangle with zero area are not finite, and such a triangle is never selected by the fan either.
+                            if (separated[0] || separated[1] || separated[2] || !std::isfinite(tri.b0[0]) || !std::isfinite(tri.b1[0]))
+                                continue;
+
+                            minTriIdx = std::min(minTriIdx, triIdx);
+                            maxTriIdx = std::max(maxTriIdx, triIdx);
+                        }
+                        if (minTriIdx <= maxTriIdx)
+                            adjacency_table[(vi * resolution + sy) * tableWidth + (ui * resolution + sx)] =
+                            ((maxTriIdx - minTriIdx + 1) << AdjacencyTableIndexBits()) | minTriIdx;
+                    }
+                }
+            }
+        }
+    }
+#endif
+
     template class UpsampledSpectrumTemplate<float, NumSpectralSamples>;
     //template class UpsampledSpectrumTemplate<double, NumSpectralSamples>;
 
 #if defined(VLR_Device)
+#   undef adjacency_table
+#   undef spectrum_triangles
 #   undef spectrum_data_points
 #   undef spectrum_grid
 #endif
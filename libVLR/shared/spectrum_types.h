@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "spectrum_base.h"
+#include "host_simd.h"
 
 namespace VLR {
     template <typename RealType, uint32_t NumSpectralSamples>
@@ -132,10 +133,7 @@ namespace VLR {
             return SampledSpectrumTemplate(vals);
         }
         RT_FUNCTION friend inline SampledSpectrumTemplate operator*(RealType s, const SampledSpectrumTemplate &c) {
-            RealType vals[NumSpectralSamples];
-            for (int i = 0; i < NumSpectralSamples; ++i)
-                vals[i] = c.values[i] * s;
-            return SampledSpectrumTemplate(vals);
+            return c * s;
         }
 
         RT_FUNCTION SampledSpectrumTemplate &operator+=(const SampledSpectrumTemplate &c) {
@@ -265,6 +263,150 @@ namespace VLR {
         RT_FUNCTION static constexpr SampledSpectrumTemplate NaN() { return SampledSpectrumTemplate(VLR_NAN); }
     };
 
+#if defined(VLR_Host)
+    // JP: ホスト向けにSSEで実装した演算。
+    //     avgValue()とimportance()は総和の順序が変わらないようにスカラーのままにしている。
+    // EN: Operations implemented with SSE for the host.
+    //     avgValue() and importance() are kept scalar so that the summation order doesn't change.
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator-() const {
+        SampledSpectrumTemplate ret;
+        (-HostFloatN<4>::load(values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator+(const SampledSpectrumTemplate &c) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) + HostFloatN<4>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator-(const SampledSpectrumTemplate &c) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) - HostFloatN<4>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator*(const SampledSpectrumTemplate &c) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) * HostFloatN<4>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator/(const SampledSpectrumTemplate &c) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) / HostFloatN<4>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::safeDivide(const SampledSpectrumTemplate &c) const {
+        SampledSpectrumTemplate ret;
+        HostFloatN<4>::load(values).safeDivide(HostFloatN<4>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator*(float s) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) * HostFloatN<4>::set1(s)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> SampledSpectrumTemplate<float, 4>::operator/(float s) const {
+        SampledSpectrumTemplate ret;
+        (HostFloatN<4>::load(values) * HostFloatN<4>::set1(1 / s)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator+=(const SampledSpectrumTemplate &c) {
+        (HostFloatN<4>::load(values) + HostFloatN<4>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator-=(const SampledSpectrumTemplate &c) {
+        (HostFloatN<4>::load(values) - HostFloatN<4>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator*=(const SampledSpectrumTemplate &c) {
+        (HostFloatN<4>::load(values) * HostFloatN<4>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator/=(const SampledSpectrumTemplate &c) {
+        (HostFloatN<4>::load(values) / HostFloatN<4>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator*=(float s) {
+        (HostFloatN<4>::load(values) * HostFloatN<4>::set1(s)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline SampledSpectrumTemplate<float, 4> &SampledSpectrumTemplate<float, 4>::operator/=(float s) {
+        (HostFloatN<4>::load(values) * HostFloatN<4>::set1(1 / s)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::operator==(const SampledSpectrumTemplate &c) const {
+        return HostFloatN<4>::load(values).notEqualMask(HostFloatN<4>::load(c.values)) == 0;
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::operator!=(const SampledSpectrumTemplate &c) const {
+        return HostFloatN<4>::load(values).notEqualMask(HostFloatN<4>::load(c.values)) != 0;
+    }
+
+    template <>
+    inline float SampledSpectrumTemplate<float, 4>::maxValue() const {
+        HostFloatN<4> v = HostFloatN<4>::load(values);
+        if (v.nanMask() == HostFloatN<4>::AllMask())
+            return values[0];
+        return v.replaceNaN(-INFINITY).horizontalMax();
+    }
+
+    template <>
+    inline float SampledSpectrumTemplate<float, 4>::minValue() const {
+        HostFloatN<4> v = HostFloatN<4>::load(values);
+        if (v.nanMask() == HostFloatN<4>::AllMask())
+            return values[0];
+        return v.replaceNaN(INFINITY).horizontalMin();
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::hasNonZero() const {
+        return HostFloatN<4>::load(values).notEqualMask(HostFloatN<4>::set1(0.0f)) != 0;
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::hasNaN() const {
+        return HostFloatN<4>::load(values).nanMask() != 0;
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::hasInf() const {
+        return HostFloatN<4>::load(values).infMask() != 0;
+    }
+
+    template <>
+    inline bool SampledSpectrumTemplate<float, 4>::hasNegative() const {
+        return HostFloatN<4>::load(values).lessThanMask(HostFloatN<4>::set1(0.0f)) != 0;
+    }
+#endif
+
     template <typename RealType, uint32_t NumSpectralSamples>
     RT_FUNCTION constexpr SampledSpectrumTemplate<RealType, NumSpectralSamples> min(const SampledSpectrumTemplate<RealType, NumSpectralSamples> &value, RealType minValue) {
         SampledSpectrumTemplate<RealType, NumSpectralSamples> ret;
@@ -303,11 +445,26 @@ namespace VLR {
         RealType m_scale;
 
         RT_FUNCTION void computeAdjacents(RealType u, RealType v);
+        RT_FUNCTION static void computeUVAndBrightness(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2,
+                                                       RealType uv[2], RealType* brightness);
 
     public:
         RT_FUNCTION constexpr UpsampledSpectrumTemplate(uint32_t adjIndices, uint16_t s, uint16_t t, RealType scale) :
         m_adjIndices(adjIndices), m_s((RealType)s / (UINT16_MAX - 1)), m_t((RealType)t / (UINT16_MAX - 1)), m_scale(scale) {}
         RT_FUNCTION constexpr UpsampledSpectrumTemplate(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2);
+        // JP: uvs16Fx3(uvsA16Fx4)フォーマットの値から構築する。
+        // EN: Construct from a value in uvs16Fx3 (uvsA16Fx4) format.
+        RT_FUNCTION UpsampledSpectrumTemplate(RealType u, RealType v, RealType s) : m_scale(s / (RealType)UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR) {
+            computeAdjacents(u, v);
+        }
+
+        // JP: 色をuvs16Fx3(uvsA16Fx4)フォーマットの値に変換する。
+        // EN: Convert a color into a value in uvs16Fx3 (uvsA16Fx4) format.
+        RT_FUNCTION static void computeUVS(VLRSpectrumType spType, VLRColorSpace space, RealType e0, RealType e1, RealType e2, RealType uvs[3]) {
+            RealType brightness;
+            computeUVAndBrightness(spType, space, e0, e1, e2, uvs, &brightness);
+            uvs[2] = brightness / EqualEnergyReflectance() * (RealType)UPSAMPLED_CONTINOUS_SPECTRUM_SCALE_FACTOR;
+        }
 
         RT_FUNCTION SampledSpectrumTemplate<RealType, NumSpectralSamples> evaluate(const WavelengthSamplesTemplate<RealType, NumSpectralSamples> &wls) const;
 
@@ -316,13 +473,22 @@ namespace VLR {
         RT_FUNCTION static constexpr uint32_t NumWavelengthSamples() { return 95; }
         RT_FUNCTION static constexpr uint32_t GridWidth() { return 12; }
         RT_FUNCTION static constexpr uint32_t GridHeight() { return 14; }
+        RT_FUNCTION static constexpr uint32_t AdjacencyTableResolution() { return 16; }
+        RT_FUNCTION static constexpr uint32_t NumAdjacencyTableEntries() {
+            return GridWidth() * AdjacencyTableResolution() * GridHeight() * AdjacencyTableResolution();
+        }
+        RT_FUNCTION static constexpr uint32_t MaxNumPointsPerCell() { return 6; }
+        // JP: 扇を持つセルが全て最大の頂点数を持つ場合の三角形の数。
+        // EN: The number of triangles in the case all the cells with fans have the maximum number of points.
+        RT_FUNCTION static constexpr uint32_t MaxNumTriangles() { return GridWidth() * GridHeight() * (MaxNumPointsPerCell() - 1); }
+        RT_FUNCTION static constexpr uint32_t AdjacencyTableIndexBits() { return 10; }
 
         // Grid cells. Laid out in row-major format.
         // num_points = 0 for cells without data points.
         struct spectrum_grid_cell_t {
             uint8_t inside;
             uint8_t num_points;
-            uint8_t idx[6];
+            uint8_t idx[MaxNumPointsPerCell()];
         };
 
         // Grid data points.
@@ -332,9 +498,30 @@ namespace VLR {
             float spectrum[95]; // X+Y+Z = 1
         };
 
+        // Triangles of the fans in cells that are not inner quads.
+        // Barycentric coordinates are linear functions of uv relative to the fan center: b = coeffs[0] * (u - origin[0]) + coeffs[1] * (v - origin[1]).
+        // Keeping the origin separate avoids cancellation with the large coefficients of thin triangles.
+        struct spectrum_triangle_t {
+            uint32_t adjIndices;
+            float origin[2];
+            float b0[2];
+            float b1[2];
+        };
+
+        // JP: 格子の各セルをAdjacencyTableResolution()^2に分割した表。分割セルと交差する三角形の範囲を保守的に持つ。
+        //     下位AdjacencyTableIndexBits()ビットが最初の三角形の番号、残りの上位ビットが三角形の数で、内側の四角形のセルでは使われない。
+        //     候補は1つのセルの扇の中に限られるので、三角形の数はMaxNumPointsPerCell() - 1以下である。
+        // EN: Table subdividing each grid cell into AdjacencyTableResolution()^2. It conservatively holds the range of triangles intersecting a sub-cell.
+        //     The lower AdjacencyTableIndexBits() bits are the index of the first triangle and the remaining upper bits are the number of triangles,
+        //     unused for cells of inner quads. Candidates are limited to the fan of a single cell, so the number of triangles is at most MaxNumPointsPerCell() - 1.
 #if defined(VLR_Host)
         static const spectrum_grid_cell_t spectrum_grid[];
         static const spectrum_data_point_t spectrum_data_points[];
+        static spectrum_triangle_t spectrum_triangles[];
+        static uint16_t adjacency_table[];
+        static uint32_t numTriangles;
+
+        static void initialize();
 #endif
 
         // This is 1 over the integral over either CMF.
@@ -438,10 +625,7 @@ namespace VLR {
             return DiscretizedSpectrumTemplate(vals);
         }
         RT_FUNCTION friend inline DiscretizedSpectrumTemplate operator*(RealType s, const DiscretizedSpectrumTemplate &c) {
-            RealType vals[NumStrataForStorage];
-            for (int i = 0; i < NumStrataForStorage; ++i)
-                vals[i] = c.values[i] * s;
-            return DiscretizedSpectrumTemplate(vals);
+            return c * s;
         }
 
         RT_FUNCTION DiscretizedSpectrumTemplate &operator+=(const DiscretizedSpectrumTemplate &c) {
@@ -548,6 +732,117 @@ namespace VLR {
 #endif
     };
 
+#if defined(VLR_Host)
+    // JP: ホスト向けにHostFloatN<16>で実装した演算。
+    // EN: Operations implemented with HostFloatN<16> for the host.
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrumTemplate<float, 16>::operator-() const {
+        DiscretizedSpectrumTemplate ret;
+        (-HostFloatN<16>::load(values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrumTemplate<float, 16>::operator+(const DiscretizedSpectrumTemplate &c) const {
+        DiscretizedSpectrumTemplate ret;
+        (HostFloatN<16>::load(values) + HostFloatN<16>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrumTemplate<float, 16>::operator-(const DiscretizedSpectrumTemplate &c) const {
+        DiscretizedSpectrumTemplate ret;
+        (HostFloatN<16>::load(values) - HostFloatN<16>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrumTemplate<float, 16>::operator*(const DiscretizedSpectrumTemplate &c) const {
+        DiscretizedSpectrumTemplate ret;
+        (HostFloatN<16>::load(values) * HostFloatN<16>::load(c.values)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> DiscretizedSpectrumTemplate<float, 16>::operator*(float s) const {
+        DiscretizedSpectrumTemplate ret;
+        (HostFloatN<16>::load(values) * HostFloatN<16>::set1(s)).store(ret.values);
+        return ret;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> &DiscretizedSpectrumTemplate<float, 16>::operator+=(const DiscretizedSpectrumTemplate &c) {
+        (HostFloatN<16>::load(values) + HostFloatN<16>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> &DiscretizedSpectrumTemplate<float, 16>::operator*=(const DiscretizedSpectrumTemplate &c) {
+        (HostFloatN<16>::load(values) * HostFloatN<16>::load(c.values)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline DiscretizedSpectrumTemplate<float, 16> &DiscretizedSpectrumTemplate<float, 16>::operator*=(float s) {
+        (HostFloatN<16>::load(values) * HostFloatN<16>::set1(s)).store(values);
+        return *this;
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::operator==(const DiscretizedSpectrumTemplate &c) const {
+        return HostFloatN<16>::load(values).notEqualMask(HostFloatN<16>::load(c.values)) == 0;
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::operator!=(const DiscretizedSpectrumTemplate &c) const {
+        return HostFloatN<16>::load(values).notEqualMask(HostFloatN<16>::load(c.values)) != 0;
+    }
+
+    template <>
+    inline float DiscretizedSpectrumTemplate<float, 16>::maxValue() const {
+        HostFloatN<16> v = HostFloatN<16>::load(values);
+        if (v.nanMask() == HostFloatN<16>::AllMask())
+            return values[0];
+        return v.replaceNaN(-INFINITY).horizontalMax();
+    }
+
+    template <>
+    inline float DiscretizedSpectrumTemplate<float, 16>::minValue() const {
+        HostFloatN<16> v = HostFloatN<16>::load(values);
+        if (v.nanMask() == HostFloatN<16>::AllMask())
+            return values[0];
+        return v.replaceNaN(INFINITY).horizontalMin();
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::hasNonZero() const {
+        return HostFloatN<16>::load(values).notEqualMask(HostFloatN<16>::set1(0.0f)) != 0;
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::hasNaN() const {
+        return HostFloatN<16>::load(values).nanMask() != 0;
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::hasInf() const {
+        return HostFloatN<16>::load(values).infMask() != 0;
+    }
+
+    template <>
+    inline bool DiscretizedSpectrumTemplate<float, 16>::hasNegative() const {
+        return HostFloatN<16>::load(values).lessThanMask(HostFloatN<16>::set1(0.0f)) != 0;
+    }
+
+    template <>
+    inline void DiscretizedSpectrumTemplate<float, 16>::toXYZ(float XYZ[3]) const {
+        HostFloatN<16> v = HostFloatN<16>::load(values);
+        XYZ[0] = (HostFloatN<16>::load(xbar.values) * v).horizontalSum() / integralCMF;
+        XYZ[1] = (HostFloatN<16>::load(ybar.values) * v).horizontalSum() / integralCMF;
+        XYZ[2] = (HostFloatN<16>::load(zbar.values) * v).horizontalSum() / integralCMF;
+    }
+#endif
+
 
 
     template <typename RealType, uint32_t NumStrataForStorage>
@@ -574,6 +869,11 @@ namespace VLR {
             return *this;
         }
 
+        RT_FUNCTION SpectrumStorageTemplate &merge(const SpectrumStorageTemplate &v) {
+            value += v.value;
+            return *this;
+        }
+
         RT_FUNCTION CompensatedSum<ValueType> &getValue() {
             return value;
         }
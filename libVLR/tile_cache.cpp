@@ -0,0 +1,138 @@
+﻿#include "tile_cache.h"
+
+#include "tiled_image.h"
+
+namespace VLR {
+    TileCache::TileCache() :
+        m_residentSize(0), m_budget((size_t)2 * 1024 * 1024 * 1024),
+        m_numRequests(0), m_numMisses(0), m_numEvictions(0) {
+    }
+
+    TileCache::~TileCache() {
+        // JP: タイルの削除子がm_residentSizeに触れるので、メンバーの破棄より先にエントリーを消す。
+        // EN: Erase the entries before destruction of members since the deleters of tiles touch m_residentSize.
+        m_entries.clear();
+        m_recentKeys.clear();
+    }
+
+    void TileCache::evict(size_t budget) {
+        // JP: キャッシュ以外の参照があるタイルは追い出してもメモリーが減らないので飛ばす。
+        //     エントリーを消して最後の参照が無くなると、削除子がm_residentSizeを減らす。
+        // EN: Skip tiles with references other than the cache since evicting them does not reduce memory.
+        //     Erasing an entry releases the last reference, then the deleter decreases m_residentSize.
+        auto keyIt = m_recentKeys.end();
+        while (m_residentSize > budget && keyIt != m_recentKeys.begin()) {
+            --keyIt;
+            auto it = m_entries.find(*keyIt);
+            if (it->second.data.use_count() > 1)
+                continue;
+
+            m_entries.erase(it);
+            keyIt = m_recentKeys.erase(keyIt);
+            ++m_numEvictions;
+        }
+    }
+
+    void TileCache::registerImage(int32_t bufferID, const TiledImage2D* image) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_images[bufferID] = image;
+    }
+
+    void TileCache::unregisterImage(const TiledImage2D* image) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_images.begin(); it != m_images.end();) {
+            if (it->second == image)
+                it = m_images.erase(it);
+            else
+                ++it;
+        }
+
+        // JP: キーはファイルのアドレスが先頭なので、その画像のタイルは連続して並ぶ。
+        // EN: Keys begin with the address of the file, so tiles of the image are arranged contiguously.
+        const TiledImageFile* file = &image->getTiledFile();
+        Key firstKey = { file, 0, 0, 0 };
+        auto it = m_entries.lower_bound(firstKey);
+        while (it != m_entries.end() && it->first.file == file) {
+            m_recentKeys.erase(it->second.position);
+            it = m_entries.erase(it);
+        }
+    }
+
+    const TiledImage2D* TileCache::findImage(int32_t bufferID) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_images.find(bufferID);
+        if (it == m_images.end())
+            return nullptr;
+        return it->second;
+    }
+
+    TileCache::TileData TileCache::getTile(const TiledImageFile* file, uint32_t mipLevel, uint32_t tileX, uint32_t tileY, bool* overBudget) {
+        Key key = { file, mipLevel, tileX, tileY };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_numRequests;
+            auto it = m_entries.find(key);
+            if (it != m_entries.end()) {
+                m_recentKeys.splice(m_recentKeys.begin(), m_recentKeys, it->second.position);
+                if (overBudget)
+                    *overBudget = m_residentSize > m_budget;
+                return it->second.data;
+            }
+            ++m_numMisses;
+        }
+
+        TileData loadedData = file->loadTile(mipLevel, tileX, tileY);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // JP: 読み込み中に別のスレッドが同じタイルを登録した場合はそちらを使う。
+        // EN: Use the tile registered by another thread during reading if any.
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_recentKeys.splice(m_recentKeys.begin(), m_recentKeys, it->second.position);
+            if (overBudget)
+                *overBudget = m_residentSize > m_budget;
+            return it->second.data;
+        }
+
+        // JP: 最後の参照が無くなった時点で合計から引く削除子を付けて包む。
+        // EN: Wrap with a deleter subtracting from the total at the time the last reference is gone.
+        size_t size = loadedData->size();
+        std::atomic<size_t>* residentSize = &m_residentSize;
+        TileData data(loadedData.get(), [loadedData, size, residentSize](const std::vector<uint8_t>*) {
+            *residentSize -= size;
+        });
+        m_residentSize += size;
+
+        m_recentKeys.push_front(key);
+        Entry entry;
+        entry.data = data;
+        entry.position = m_recentKeys.begin();
+        m_entries[key] = entry;
+        evict(m_budget);
+        if (overBudget)
+            *overBudget = m_residentSize > m_budget;
+
+        return data;
+    }
+
+    void TileCache::trim() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        evict(m_budget);
+    }
+
+    void TileCache::setBudget(size_t budget) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = budget;
+        evict(m_budget);
+    }
+
+    void TileCache::getStatistics(VLRTileCacheStatistics* stats) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats->budget = m_budget;
+        stats->residentSize = m_residentSize;
+        stats->numRequests = m_numRequests;
+        stats->numMisses = m_numMisses;
+        stats->numEvictions = m_numEvictions;
+        stats->numResidentTiles = (uint32_t)m_entries.size();
+    }
+}
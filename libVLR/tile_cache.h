@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+#include <mutex>
+#include <atomic>
+
+namespace VLR {
+    class TiledImage2D;
+    class TiledImageFile;
+
+    // JP: タイル化画像のタイルを必要になった時点でファイルから読み込んで保持するキャッシュ。
+    //     保持するタイルの合計が予算(バイト)を超えると最も長く使われていないタイルから追い出す。
+    //     取得済みの参照が残っているタイルは解放できないので追い出さず、参照が無くなるまで合計に数える。
+    //     レンダリング中に複数のスレッドから呼ばれるためロックで保護し、ファイルの読み込み中はロックを外す。
+    // EN: Cache that loads tiles of tiled images from files at the time they are needed, and holds them.
+    //     When the total of held tiles exceeds the budget (in bytes), the least recently used tiles are evicted first.
+    //     A tile with already obtained references remaining cannot be freed, so it is not evicted and is counted in the total until the references are gone.
+    //     Protected by a lock since this is called from multiple threads during rendering, and the lock is released while reading files.
+    class TileCache {
+    public:
+        typedef std::shared_ptr<const std::vector<uint8_t>> TileData;
+
+    private:
+        struct Key {
+            const TiledImageFile* file;
+            uint32_t mipLevel;
+            uint32_t tileX;
+            uint32_t tileY;
+
+            bool operator<(const Key &r) const {
+                if (file != r.file)
+                    return file < r.file;
+                if (mipLevel != r.mipLevel)
+                    return mipLevel < r.mipLevel;
+                if (tileY != r.tileY)
+                    return tileY < r.tileY;
+                return tileX < r.tileX;
+            }
+        };
+
+        struct Entry {
+            TileData data;
+            std::list<Key>::iterator position;
+        };
+
+        mutable std::mutex m_mutex;
+        std::map<Key, Entry> m_entries;
+        // JP: 先頭が最近使われたタイル。
+        // EN: The head is the most recently used tile.
+        std::list<Key> m_recentKeys;
+        // JP: CPUバックエンドがテクスチャーのバッファーIDからタイル化画像を引くための登録。
+        // EN: Registration for the CPU backend to look up a tiled image from the buffer ID of a texture.
+        std::map<int32_t, const TiledImage2D*> m_images;
+        // JP: 参照が残っていて生きているタイルの合計。参照が無くなった時点で減らすため、ロックの外でも更新される。
+        // EN: Total of tiles alive with remaining references. Updated outside the lock too since it is decreased when the references are gone.
+        std::atomic<size_t> m_residentSize;
+        size_t m_budget;
+        uint64_t m_numRequests;
+        uint64_t m_numMisses;
+        uint64_t m_numEvictions;
+
+        void evict(size_t budget);
+
+    public:
+        TileCache();
+        ~TileCache();
+
+        void registerImage(int32_t bufferID, const TiledImage2D* image);
+        // JP: 登録を外し、その画像のタイルをすべて追い出す。画像の破棄時に呼ぶ。
+        // EN: Remove the registration and evict all the tiles of the image. Called on destruction of the image.
+        void unregisterImage(const TiledImage2D* image);
+        const TiledImage2D* findImage(int32_t bufferID) const;
+
+        // JP: タイルを返す。保持していない場合はファイルから読み込む。
+        //     overBudgetがnullptrでない場合、参照されているタイルのせいで予算を超えたままかを返す。
+        // EN: Return a tile. It is read from the file if not held.
+        //     If overBudget is not nullptr, return whether the budget is still exceeded due to referenced tiles.
+        TileData getTile(const TiledImageFile* file, uint32_t mipLevel, uint32_t tileX, uint32_t tileY, bool* overBudget = nullptr);
+        // JP: 参照が手放されたタイルを予算に収まるまで追い出す。
+        // EN: Evict tiles whose references have been released until they fit in the budget.
+        void trim();
+
+        void setBudget(size_t budget);
+        void getStatistics(VLRTileCacheStatistics* stats) const;
+    };
+}
@@ -0,0 +1,254 @@
+﻿#include "tiled_image.h"
+
+namespace VLR {
+    static const char TiledImageMagic[4] = { 'V', 'L', 'T', 'I' };
+    static const uint32_t TiledImageVersion = 1;
+
+    struct TiledImageHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t dataFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t mipCount;
+        uint32_t needsDegamma;
+    };
+
+    static uint64_t countTiles(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t mipCount) {
+        uint64_t numTiles = 0;
+        for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel) {
+            uint32_t levelWidth = std::max<uint32_t>(width >> mipLevel, 1);
+            uint32_t levelHeight = std::max<uint32_t>(height >> mipLevel, 1);
+            numTiles += (uint64_t)((levelWidth + tileSize - 1) / tileSize) * ((levelHeight + tileSize - 1) / tileSize);
+        }
+        return numTiles;
+    }
+
+    static bool isTileableFormat(VLRDataFormat dataFormat) {
+        return dataFormat < NumVLRDataFormats && sizesOfDataFormats[dataFormat] > 0 &&
+            Image2D::getInternalFormat(dataFormat) == dataFormat;
+    }
+
+    bool writeTiledImageFile(const char* filePath, VLRDataFormat dataFormat, bool needsDegamma, uint32_t width, uint32_t height, uint32_t tileSize,
+                             const uint8_t* const* levels, uint32_t mipCount) {
+        if (!isTileableFormat(dataFormat) || tileSize == 0 || (tileSize & (tileSize - 1)) != 0 || mipCount == 0)
+            return false;
+
+        std::ofstream ofs(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open())
+            return false;
+
+        TiledImageHeader header;
+        std::memcpy(header.magic, TiledImageMagic, sizeof(header.magic));
+        header.version = TiledImageVersion;
+        header.dataFormat = dataFormat;
+        header.width = width;
+        header.height = height;
+        header.tileSize = tileSize;
+        header.mipCount = mipCount;
+        header.needsDegamma = needsDegamma;
+        ofs.write((const char*)&header, sizeof(header));
+
+        size_t stride = sizesOfDataFormats[dataFormat];
+        std::vector<uint8_t> tile(stride * tileSize * tileSize);
+        for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel) {
+            uint32_t levelWidth = std::max<uint32_t>(width >> mipLevel, 1);
+            uint32_t levelHeight = std::max<uint32_t>(height >> mipLevel, 1);
+            const uint8_t* levelData = levels[mipLevel];
+            for (uint32_t tileY = 0; tileY < levelHeight; tileY += tileSize) {
+                for (uint32_t tileX = 0; tileX < levelWidth; tileX += tileSize) {
+                    uint32_t validWidth = std::min(tileSize, levelWidth - tileX);
+                    for (uint32_t y = 0; y < tileSize; ++y) {
+                        uint32_t srcY = std::min(tileY + y, levelHeight - 1);
+                        const uint8_t* srcRow = levelData + stride * ((size_t)levelWidth * srcY + tileX);
+                        uint8_t* dstRow = tile.data() + stride * tileSize * y;
+                        std::copy_n(srcRow, stride * validWidth, dstRow);
+                        for (uint32_t x = validWidth; x < tileSize; ++x)
+                            std::copy_n(srcRow + stride * (validWidth - 1), stride, dstRow + stride * x);
+                    }
+                    ofs.write((const char*)tile.data(), tile.size());
+                }
+            }
+        }
+
+        return ofs.good();
+    }
+
+    bool readTiledImageInfo(const char* filePath, TiledImageInfo* info) {
+        std::ifstream ifs(filePath, std::ios::in | std::ios::binary);
+        if (!ifs.is_open())
+            return false;
+
+        TiledImageHeader header;
+        if (!ifs.read((char*)&header, sizeof(header)))
+            return false;
+        if (std::memcmp(header.magic, TiledImageMagic, sizeof(header.magic)) != 0 || header.version != TiledImageVersion)
+            return false;
+
+        VLRDataFormat dataFormat = (VLRDataFormat)header.dataFormat;
+        if (!isTileableFormat(dataFormat) || header.width == 0 || header.height == 0 ||
+            header.tileSize == 0 || (header.tileSize & (header.tileSize - 1)) != 0)
+            return false;
+        uint32_t maxMipCount = 1 + countTrailingZeroes(prevPowerOf2(std::max(header.width, header.height)));
+        if (header.mipCount == 0 || header.mipCount > maxMipCount)
+            return false;
+
+        uint64_t tileDataSize = (uint64_t)sizesOfDataFormats[dataFormat] * header.tileSize * header.tileSize;
+        uint64_t fileSize = sizeof(header) + countTiles(header.width, header.height, header.tileSize, header.mipCount) * tileDataSize;
+        ifs.seekg(0, std::ios::end);
+        if ((uint64_t)ifs.tellg() != fileSize)
+            return false;
+
+        info->dataFormat = dataFormat;
+        info->width = header.width;
+        info->height = header.height;
+        info->tileSize = header.tileSize;
+        info->mipCount = header.mipCount;
+        info->needsDegamma = header.needsDegamma != 0;
+
+        return true;
+    }
+
+
+
+    TiledImageFile::TiledImageFile(const char* filePath, const TiledImageInfo &info) :
+        m_filePath(filePath), m_width(info.width), m_height(info.height), m_stride(sizesOfDataFormats[info.dataFormat]),
+        m_tileSize(info.tileSize), m_mipCount(info.mipCount) {
+        m_firstTileIndices.resize(m_mipCount);
+        for (uint32_t mipLevel = 0; mipLevel < m_mipCount; ++mipLevel)
+            m_firstTileIndices[mipLevel] = countTiles(m_width, m_height, m_tileSize, mipLevel);
+        m_file.open(m_filePath, std::ios::in | std::ios::binary);
+    }
+
+    TileCache::TileData TiledImageFile::loadTile(uint32_t mipLevel, uint32_t tileX, uint32_t tileY) const {
+        size_t tileDataSize = (size_t)m_stride * m_tileSize * m_tileSize;
+        uint64_t tileIndex = m_firstTileIndices[mipLevel] + (uint64_t)getNumTilesX(mipLevel) * tileY + tileX;
+        auto data = std::make_shared<std::vector<uint8_t>>(tileDataSize);
+
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        m_file.clear();
+        m_file.seekg(sizeof(TiledImageHeader) + tileDataSize * tileIndex);
+        if (!m_file.read((char*)data->data(), tileDataSize)) {
+            vlrprintf("Failed to read a tile (level %u, %u, %u): %s\n", mipLevel, tileX, tileY, m_filePath.c_str());
+            std::fill(data->begin(), data->end(), 0);
+        }
+
+        return data;
+    }
+
+
+
+    TiledImage2D::TiledImage2D(Context &context, const char* filePath, const TiledImageInfo &info) :
+        Image2D(context, info.width, info.height, info.dataFormat, info.needsDegamma),
+        m_tiledFile(filePath, info), m_copyDone(false) {
+    }
+
+    TiledImage2D::~TiledImage2D() {
+        m_context.getTileCache().unregisterImage(this);
+        if (m_placeholderBuffer)
+            m_placeholderBuffer->destroy();
+    }
+
+    void TiledImage2D::prefetch(uint32_t mipLevel, float minU, float minV, float maxU, float maxV) const {
+        mipLevel = std::min(mipLevel, getMipCount() - 1);
+        int32_t numTilesX = getNumTilesX(mipLevel);
+        int32_t numTilesY = getNumTilesY(mipLevel);
+        float tilesPerU = (float)getLevelWidth(mipLevel) / getTileSize();
+        float tilesPerV = (float)getLevelHeight(mipLevel) / getTileSize();
+        int32_t minTileX = std::min(std::max((int32_t)std::floor(minU * tilesPerU), 0), numTilesX - 1);
+        int32_t minTileY = std::min(std::max((int32_t)std::floor(minV * tilesPerV), 0), numTilesY - 1);
+        int32_t maxTileX = std::min(std::max((int32_t)std::floor(maxU * tilesPerU), 0), numTilesX - 1);
+        int32_t maxTileY = std::min(std::max((int32_t)std::floor(maxV * tilesPerV), 0), numTilesY - 1);
+
+        TileCache &tileCache = m_context.getTileCache();
+        for (int32_t tileY = minTileY; tileY <= maxTileY; ++tileY) {
+            for (int32_t tileX = minTileX; tileX <= maxTileX; ++tileX)
+                tileCache.getTile(&m_tiledFile, mipLevel, tileX, tileY);
+        }
+    }
+
+    void TiledImage2D::assembleLevel(uint32_t mipLevel, uint8_t* dstData) const {
+        uint32_t stride = getStride();
+        uint32_t tileSize = getTileSize();
+        uint32_t levelWidth = getLevelWidth(mipLevel);
+        uint32_t levelHeight = getLevelHeight(mipLevel);
+        for (uint32_t tileY = 0; tileY < getNumTilesY(mipLevel); ++tileY) {
+            for (uint32_t tileX = 0; tileX < getNumTilesX(mipLevel); ++tileX) {
+                TileCache::TileData tile = m_tiledFile.loadTile(mipLevel, tileX, tileY);
+                uint32_t x = tileSize * tileX;
+                uint32_t y = tileSize * tileY;
+                uint32_t validWidth = std::min(tileSize, levelWidth - x);
+                uint32_t validHeight = std::min(tileSize, levelHeight - y);
+                for (uint32_t row = 0; row < validHeight; ++row)
+                    std::copy_n(tile->data() + stride * tileSize * row, stride * validWidth,
+                                dstData + stride * ((size_t)levelWidth * (y + row) + x));
+            }
+        }
+    }
+
+    LinearImage2D* TiledImage2D::createLevelImage2D(uint32_t mipLevel) const {
+        uint32_t levelWidth = getLevelWidth(mipLevel);
+        uint32_t levelHeight = getLevelHeight(mipLevel);
+        std::vector<uint8_t> data(getStride() * (size_t)levelWidth * levelHeight);
+        assembleLevel(mipLevel, data.data());
+
+        return new LinearImage2D(m_context, std::move(data), levelWidth, levelHeight, getDataFormat(), needsDegamma());
+    }
+
+    Image2D* TiledImage2D::createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const {
+        uint32_t mipLevel = getMipCount() - 1;
+        while (mipLevel > 0 && (getLevelWidth(mipLevel) < width || getLevelHeight(mipLevel) < height))
+            --mipLevel;
+
+        LinearImage2D* levelImage = createLevelImage2D(mipLevel);
+        Image2D* ret = levelImage->createShrinkedImage2D(width, height, filter);
+        delete levelImage;
+        return ret;
+    }
+
+    Image2D* TiledImage2D::createLuminanceImage2D() const {
+        LinearImage2D* levelImage = createLevelImage2D(0);
+        Image2D* ret = levelImage->createLuminanceImage2D();
+        delete levelImage;
+        return ret;
+    }
+
+    void* TiledImage2D::createLinearImageData() const {
+        uint8_t* ret = new uint8_t[getStride() * (size_t)getWidth() * getHeight()];
+        assembleLevel(0, ret);
+        return ret;
+    }
+
+    bool TiledImage2D::generateMipmaps(VLRMipmapFilter filter) {
+        return false;
+    }
+
+    Backend::Buffer TiledImage2D::getOptiXObject() const {
+        // JP: CPUバックエンドには形式だけを伝える1x1のバッファーを渡し、バッファーIDからこの画像を引けるように登録する。
+        // EN: Pass a 1x1 buffer conveying only the format to the CPU backend, and register so that this image can be looked up from the buffer ID.
+        if (m_context.getBackend() == VLRBackend_CPU) {
+            if (!m_placeholderBuffer) {
+                Backend::Context optixContext = m_context.getOptiXContext();
+                m_placeholderBuffer = optixContext->createBuffer(RT_BUFFER_INPUT, Image2D::getOptiXFormat(getDataFormat()), 1, 1);
+                m_context.getTileCache().registerImage(m_placeholderBuffer->getId(), this);
+            }
+            return m_placeholderBuffer;
+        }
+
+        // JP: OptiXバックエンドではページングせず、全レベルを組み立てて転送する。タイルキャッシュの予算は関係しない。
+        // EN: The OptiX backend does not page, and assembles and transfers all the levels. The budget of the tile cache is irrelevant.
+        Backend::Buffer buffer = Image2D::getOptiXObject();
+        if (!m_copyDone) {
+            buffer->setMipLevelCount(getMipCount());
+            for (uint32_t mipLevel = 0; mipLevel < getMipCount(); ++mipLevel)
+                assembleLevel(mipLevel, (uint8_t*)buffer->map(mipLevel, RT_BUFFER_MAP_WRITE_DISCARD));
+
+            for (int32_t mipLevel = getMipCount() - 1; mipLevel >= 0; --mipLevel)
+                buffer->unmap(mipLevel);
+
+            m_copyDone = true;
+        }
+        return buffer;
+    }
+}
@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include "shader_nodes.h"
+
+namespace VLR {
+    struct TiledImageInfo {
+        VLRDataFormat dataFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileSize;
+        uint32_t mipCount;
+        bool needsDegamma;
+    };
+
+    // JP: タイル化画像のファイル。ヘッダーに続いて各ミップレベルのタイルを行優先で並べる。
+    //     タイルは常にtileSize x tileSizeで、画像の端からはみ出す部分は端の画素で埋める。タイルの位置はヘッダーから計算できる。
+    //     levelsは内部形式の各レベルのデータで、レベルmの大きさはmax(width >> m, 1) x max(height >> m, 1)。
+    // EN: File of a tiled image. Tiles of each mip level are arranged in row-major order following the header.
+    //     A tile is always tileSize x tileSize, and the part outside the image is filled with edge pixels. Tile positions can be computed from the header.
+    //     levels is the data of each level in the internal format, and the size of the level m is max(width >> m, 1) x max(height >> m, 1).
+    bool writeTiledImageFile(const char* filePath, VLRDataFormat dataFormat, bool needsDegamma, uint32_t width, uint32_t height, uint32_t tileSize,
+                             const uint8_t* const* levels, uint32_t mipCount);
+    // JP: ヘッダーを読み、形式とファイルの大きさが正しいかを確かめる。
+    // EN: Read the header, and check whether the format and the file size are valid.
+    bool readTiledImageInfo(const char* filePath, TiledImageInfo* info);
+
+
+
+    // JP: タイル化画像のファイルの大きさの情報とタイルの読み込み。コンテキストに依存しないので、TileCacheはこのクラスを単位にタイルを保持する。
+    // EN: Size information of a tiled image file and reading of tiles. This doesn't depend on a context, so TileCache holds tiles in units of this class.
+    class TiledImageFile {
+        std::string m_filePath;
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_stride;
+        uint32_t m_tileSize;
+        uint32_t m_mipCount;
+        // JP: 各レベルの先頭のタイルの通し番号。
+        // EN: Serial number of the first tile of each level.
+        std::vector<uint64_t> m_firstTileIndices;
+        mutable std::mutex m_fileMutex;
+        mutable std::ifstream m_file;
+
+    public:
+        TiledImageFile(const char* filePath, const TiledImageInfo &info);
+
+        uint32_t getTileSize() const {
+            return m_tileSize;
+        }
+        uint32_t getMipCount() const {
+            return m_mipCount;
+        }
+        uint32_t getLevelWidth(uint32_t mipLevel) const {
+            return std::max<uint32_t>(m_width >> mipLevel, 1);
+        }
+        uint32_t getLevelHeight(uint32_t mipLevel) const {
+            return std::max<uint32_t>(m_height >> mipLevel, 1);
+        }
+        uint32_t getNumTilesX(uint32_t mipLevel) const {
+            return (getLevelWidth(mipLevel) + m_tileSize - 1) / m_tileSize;
+        }
+        uint32_t getNumTilesY(uint32_t mipLevel) const {
+            return (getLevelHeight(mipLevel) + m_tileSize - 1) / m_tileSize;
+        }
+
+        // JP: タイルをファイルから読む。読めなかった場合は0で埋めたタイルを返す。
+        // EN: Read a tile from the file. A tile filled with 0 is returned if it cannot be read.
+        TileCache::TileData loadTile(uint32_t mipLevel, uint32_t tileX, uint32_t tileY) const;
+    };
+
+
+
+    // JP: タイル化画像のファイルを参照する画像。画素データは保持せず、コンテキストのTileCacheを通じてタイル単位で読み込む。
+    //     CPUバックエンドでは参照されたタイルだけをレンダリング中に読み込む。
+    //     OptiXのテクスチャーは要求に応じたページングができないので、OptiXバックエンドでは全レベルを組み立てて転送する。
+    // EN: Image referencing a tiled image file. This doesn't hold pixel data, and reads it per tile through the TileCache of the context.
+    //     The CPU backend reads only the referenced tiles during rendering.
+    //     OptiX textures cannot page on demand, so the OptiX backend assembles and transfers all the levels.
+    class TiledImage2D : public Image2D {
+        TiledImageFile m_tiledFile;
+        mutable Backend::Buffer m_placeholderBuffer;
+        mutable bool m_copyDone;
+
+        // JP: キャッシュを通さずにレベル全体を組み立てる。dstDataは行間に隙間無く並ぶ。
+        // EN: Assemble the whole level without going through the cache. dstData is arranged without gaps between rows.
+        void assembleLevel(uint32_t mipLevel, uint8_t* dstData) const;
+        LinearImage2D* createLevelImage2D(uint32_t mipLevel) const;
+
+    public:
+        static const ClassIdentifier ClassID;
+        virtual const ClassIdentifier &getClass() const { return ClassID; }
+
+        TiledImage2D(Context &context, const char* filePath, const TiledImageInfo &info);
+        ~TiledImage2D();
+
+        const TiledImageFile &getTiledFile() const {
+            return m_tiledFile;
+        }
+        uint32_t getTileSize() const {
+            return m_tiledFile.getTileSize();
+        }
+        uint32_t getMipCount() const {
+            return m_tiledFile.getMipCount();
+        }
+        uint32_t getLevelWidth(uint32_t mipLevel) const {
+            return m_tiledFile.getLevelWidth(mipLevel);
+        }
+        uint32_t getLevelHeight(uint32_t mipLevel) const {
+            return m_tiledFile.getLevelHeight(mipLevel);
+        }
+        uint32_t getNumTilesX(uint32_t mipLevel) const {
+            return m_tiledFile.getNumTilesX(mipLevel);
+        }
+        uint32_t getNumTilesY(uint32_t mipLevel) const {
+            return m_tiledFile.getNumTilesY(mipLevel);
+        }
+        // JP: 正規化テクスチャー座標の範囲[minU, maxU] x [minV, maxV]を覆うタイルを事前に読み込む。
+        //     描画前にホスト側で分かっている参照範囲を渡して、レンダリング中の読み込みを減らす。
+        // EN: Load tiles covering the range [minU, maxU] x [minV, maxV] in normalized texture coordinates in advance.
+        //     Passing a reference range known on the host before drawing reduces reading during rendering.
+        void prefetch(uint32_t mipLevel, float minU, float minV, float maxU, float maxV) const;
+
+        // JP: 縮小は目標以上の大きさを持つ最小のレベルから行う。
+        // EN: Shrinking is done from the smallest level that is at least as large as the target.
+        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height, VLRMipmapFilter filter) const override;
+        Image2D* createLuminanceImage2D() const override;
+        void* createLinearImageData() const override;
+        bool generateMipmaps(VLRMipmapFilter filter) override;
+
+        Backend::Buffer getOptiXObject() const override;
+    };
+}